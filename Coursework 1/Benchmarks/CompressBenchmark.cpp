@@ -0,0 +1,50 @@
+//
+// CompressBenchmark.cpp
+//
+
+// Quality and throughput of CGDTextureCompressor - each image is compressed to BC1, BC3, BC5 and BC7 with a full mip chain on the job system and the PSNR of mip 0 and the encode rate are reported per image and format, along with the mip chain generation rate of each filter (see CGDTextureCompressor::benchmark).  Usage: CompressBenchmark [min PSNR] [images...].  The images default to the scene's BMP textures.  Returns 1 if an image cannot be read or compresses below the minimum PSNR (default 28 dB).
+
+#include <stdafx.h>
+#include <CGDJobSystem.h>
+#include <CGDTextureCompressor.h>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <iostream>
+
+using namespace std;
+
+
+int main(int argc, char *argv[]) {
+
+	double minPSNR = (argc > 1) ? atof(argv[1]) : 28.0;
+	vector<string> files(argv + min(argc, 2), argv + argc);
+
+	if (minPSNR < 0.0) {
+
+		cout << "usage: CompressBenchmark [min PSNR] [images...]\n";
+		return 1;
+	}
+
+	if (files.empty()) {
+
+		files.push_back("Resources/Textures/dropship_texture.bmp");
+		files.push_back("Resources/Textures/normalmap.bmp");
+		files.push_back("Resources/Textures/heightmap1.bmp");
+	}
+
+	CGDJobSystem *jobSystem = CGDJobSystem::CreateJobSystem();
+	CGDTextureCompressor *compressor = (jobSystem) ? CGDTextureCompressor::CreateTextureCompressor(jobSystem) : nullptr;
+
+	if (!compressor)
+		return 1;
+
+	bool ok = compressor->benchmark(files, minPSNR);
+
+	compressor->release();
+	jobSystem->release();
+
+	cout << (ok ? "\ncompression benchmark passed\n" : "\ncompression benchmark FAILED - an image could not be read or compressed below the minimum PSNR\n");
+
+	return ok ? 0 : 1;
+}
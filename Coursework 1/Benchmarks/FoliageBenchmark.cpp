@@ -0,0 +1,63 @@
+//
+// FoliageBenchmark.cpp
+//
+
+// Throughput of CGDFoliageScatter - foliage is scattered with spacing 1 over a square ground thinned by a density map (heightmap2.bmp) and placed on the Terrain height map (heightmap1.bmp).  The ground is sized from the mean density so about the given number of instances are generated, and the generation rate and the per-frame cluster selection and streaming costs are reported (see CGDFoliageScatter::benchmark).  Usage: FoliageBenchmark [instances] [frames].  Returns 1 if the maps cannot be read or nothing is generated.
+
+#include <stdafx.h>
+#include <CGDFoliageScatter.h>
+#include <CGDScatterMap.h>
+#include <CGDJobSystem.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
+using namespace std;
+
+
+int main(int argc, char *argv[]) {
+
+	int instances = (argc > 1) ? atoi(argv[1]) : 1000000;
+	int frames = (argc > 2) ? atoi(argv[2]) : 600;
+
+	if (instances <= 0 || frames <= 0) {
+
+		cout << "usage: FoliageBenchmark [instances] [frames]\n";
+		return 1;
+	}
+
+	CGDScatterMap *densityMap = CGDScatterMap::LoadScatterMap("Resources/Textures/heightmap2.bmp");
+	CGDScatterMap *heightMap = CGDScatterMap::LoadScatterMap("Resources/Textures/heightmap1.bmp", 5.0f);
+
+	if (!densityMap || !heightMap) {
+
+		cout << "\nfoliage benchmark FAILED - cannot read the density or height map\n";
+		return 1;
+	}
+
+	// Poisson-disk sampling with spacing 1 keeps about 0.79 instances per unit area before thinning
+	float side = sqrtf((float)instances / (0.79f * max(densityMap->mean(), 0.01f)));
+
+	CGDFoliageScatterDesc desc;
+
+	desc.bounds[0][0] = -0.5f * side; desc.bounds[0][1] = -0.5f * side;
+	desc.bounds[1][0] = 0.5f * side; desc.bounds[1][1] = 0.5f * side;
+	desc.densityMap = densityMap;
+	desc.heightMap = heightMap;
+
+	CGDJobSystem *jobSystem = CGDJobSystem::CreateJobSystem();
+	CGDFoliageScatter *scatter = CGDFoliageScatter::CreateFoliageScatter(desc, jobSystem);
+
+	densityMap->release();
+	heightMap->release();
+
+	bool ok = scatter->benchmark((uint32_t)frames);
+
+	scatter->release();
+	jobSystem->release();
+
+	cout << (ok ? "\nfoliage benchmark passed\n" : "\nfoliage benchmark FAILED - no instances were generated\n");
+
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,200 @@
+//
+// JobSystemBenchmark.cpp
+//
+
+// Scheduling overhead and scaling of CGDJobSystem - throughput of empty jobs submitted from the main thread and from inside jobs, parallelFor splitting at grain 1, a runAfter dependency chain and a compute-bound parallelFor against the same loop run serially.  Usage: JobSystemBenchmark [jobs].  Returns 1 if any job is lost or run twice.  Speedups depend on the hardware threads available (reported) so they are not checked.
+
+#include <stdafx.h>
+#include <CGDClock.h>
+#include <CGDJobSystem.h>
+#include <atomic>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+#include <iostream>
+#include <iomanip>
+
+using namespace std;
+
+
+namespace {
+
+	double elapsedMs(gu_time_index start) {
+
+		return double(CGDClock::ActualTime() - start) * 1.0e3 / double(CGDClock::ActualTimeFrequency());
+	}
+
+	void report(const char *name, double value, const char *units) {
+
+		cout << "  " << left << setw(36) << name << right << setw(10) << value << " " << units << "\n";
+	}
+
+	// Compute-bound body for the scaling test
+	void computeRange(float *v, uint32_t begin, uint32_t end) {
+
+		for (uint32_t i = begin; i < end; i++) {
+
+			float x = float(i) * 0.001f;
+
+			for (int k = 0; k < 32; k++)
+				x = x * 0.99f + 0.5f;
+
+			v[i] = x;
+		}
+	}
+}
+
+
+int main(int argc, char *argv[]) {
+
+	int jobs = (argc > 1) ? atoi(argv[1]) : 200000;
+
+	if (jobs <= 0) {
+
+		cout << "usage: JobSystemBenchmark [jobs]\n";
+		return 1;
+	}
+
+	uint32_t hardwareThreads = thread::hardware_concurrency();
+	bool ok = true;
+
+	cout << fixed << setprecision(2);
+	cout << "Job system benchmark: " << jobs << " jobs, " << hardwareThreads << " hardware threads\n";
+
+	vector<uint32_t> workerCounts;
+
+	workerCounts.push_back(1);
+
+	if (hardwareThreads > 2)
+		workerCounts.push_back(hardwareThreads - 1);
+
+	for (size_t w = 0; w < workerCounts.size(); w++) {
+
+		CGDJobSystem *jobSystem = CGDJobSystem::CreateJobSystem(workerCounts[w]);
+
+		if (!jobSystem)
+			return 1;
+
+		cout << "\n" << workerCounts[w] << " workers\n";
+
+		// empty jobs submitted from the main thread
+		{
+			atomic<int> n(0);
+			CGDJobCounter counter;
+
+			gu_time_index t = CGDClock::ActualTime();
+
+			for (int i = 0; i < jobs; i++)
+				jobSystem->run([&n]() { n.fetch_add(1, memory_order_relaxed); }, &counter);
+
+			jobSystem->wait(&counter);
+
+			double ms = elapsedMs(t);
+
+			ok = ok && n == jobs;
+			report("jobs from the main thread", jobs / (ms * 1.0e3), "M jobs/s");
+		}
+
+		// jobs spawned from inside jobs (each pushes onto its own deque and the rest steal)
+		{
+			const int fanOut = 64;
+			int outerJobs = (jobs + fanOut - 1) / fanOut;
+
+			atomic<int> n(0);
+			CGDJobCounter counter;
+
+			gu_time_index t = CGDClock::ActualTime();
+
+			for (int i = 0; i < outerJobs; i++) {
+
+				jobSystem->run([&]() {
+
+					for (int k = 0; k < fanOut; k++)
+						jobSystem->run([&n]() { n.fetch_add(1, memory_order_relaxed); }, &counter);
+
+				}, &counter);
+			}
+
+			jobSystem->wait(&counter);
+
+			double ms = elapsedMs(t);
+
+			ok = ok && n == outerJobs * fanOut;
+			report("jobs from inside jobs", outerJobs * (fanOut + 1) / (ms * 1.0e3), "M jobs/s");
+		}
+
+		// parallelFor split down to single indices
+		{
+			atomic<uint32_t> n(0);
+
+			gu_time_index t = CGDClock::ActualTime();
+
+			jobSystem->parallelFor(0, (uint32_t)jobs, 1, [&n](uint32_t begin, uint32_t end) { n.fetch_add(end - begin, memory_order_relaxed); });
+
+			double ms = elapsedMs(t);
+
+			ok = ok && n == (uint32_t)jobs;
+			report("parallelFor ranges (grain 1)", jobs / (ms * 1.0e3), "M ranges/s");
+		}
+
+		// runAfter chain - each link is queued by the completion of the previous one
+		{
+			const int links = 10000;
+
+			vector<CGDJobCounter> counters(links);
+			atomic<int> next(0);
+			atomic<int> outOfOrder(0);
+
+			gu_time_index t = CGDClock::ActualTime();
+
+			jobSystem->run([&next]() { next++; }, &counters[0]);
+
+			for (int i = 1; i < links; i++)
+				jobSystem->runAfter(&counters[i - 1], [&next, &outOfOrder, i]() { if (next++ != i) outOfOrder++; }, &counters[i]);
+
+			jobSystem->wait(&counters[links - 1]);
+
+			double ms = elapsedMs(t);
+
+			ok = ok && next == links && outOfOrder == 0;
+			report("runAfter chain", ms * 1.0e6 / links, "ns per link");
+		}
+
+		// compute-bound parallelFor against the serial loop
+		{
+			const uint32_t n = 1 << 20;
+			const int reps = 10;
+
+			vector<float> serial(n), parallel(n);
+
+			gu_time_index t = CGDClock::ActualTime();
+
+			for (int r = 0; r < reps; r++)
+				computeRange(serial.data(), 0, n);
+
+			double serialMs = elapsedMs(t) / reps;
+
+			float *v = parallel.data();
+
+			t = CGDClock::ActualTime();
+
+			for (int r = 0; r < reps; r++)
+				jobSystem->parallelFor(0, n, 0, [v](uint32_t begin, uint32_t end) { computeRange(v, begin, end); });
+
+			double parallelMs = elapsedMs(t) / reps;
+
+			ok = ok && serial == parallel;
+
+			report("parallelFor 1M compute (serial)", serialMs, "ms");
+			report("parallelFor 1M compute (parallel)", parallelMs, "ms");
+			report("speedup", serialMs / parallelMs, "x");
+		}
+
+		jobSystem->reportStats();
+		jobSystem->release();
+	}
+
+	cout << (ok ? "\njob system benchmark passed\n" : "\njob system benchmark FAILED - jobs lost, repeated or run out of order\n");
+
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,77 @@
+//
+// LightBenchmark.cpp
+//
+
+// Throughput of CGDClusteredLighting - light counts from 256 to 16384 are scattered over a 200 x 200 unit ground (a quarter of them spot lights pointing down) and assigned to the clusters of a 1280 x 720 view of it for the given number of frames, and the assignment time per frame of the reference and the fast path is reported (see CGDClusteredLighting::benchmark).  Usage: LightBenchmark [frames].  Returns 1 if the fast path does not match the reference or misses a light at any count.
+
+#include <stdafx.h>
+#include <CGDClusteredLighting.h>
+#include <CGDSoftwareShaders.h>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+using namespace std;
+
+
+int main(int argc, char *argv[]) {
+
+	int frames = (argc > 1) ? atoi(argv[1]) : 30;
+
+	if (frames <= 0) {
+
+		cout << "usage: LightBenchmark [frames]\n";
+		return 1;
+	}
+
+	float eye[3] = { 0.0f, 15.0f, -40.0f }, at[3] = { 0.0f, 0.0f, 20.0f }, up[3] = { 0.0f, 1.0f, 0.0f };
+	CGDSoftwareMatrix view = CGDSoftwareMatrix::LookAtLH(eye, at, up);
+	CGDSoftwareMatrix proj = CGDSoftwareMatrix::PerspectiveFovLH(0.25f * 3.14f, 1280.0f / 720.0f, 1.0f, 1000.0f);
+	bool ok = true;
+
+	for (uint32_t count = 256; count <= 16384; count *= 4) {
+
+		vector<CGDLight> lights;
+		uint32_t state = 1;
+
+		// Uniform random number in [0, 1) (xorshift)
+		auto random = [&state]() {
+
+			state ^= state << 13;
+			state ^= state >> 17;
+			state ^= state << 5;
+
+			return (float)(state >> 8) / 16777216.0f;
+		};
+
+		for (uint32_t i = 0; i < count; i++) {
+
+			float position[3] = { (random() - 0.5f) * 200.0f, random() * 10.0f - 2.0f, (random() - 0.5f) * 200.0f };
+			float colour[3] = { random(), random(), random() };
+
+			if (i % 4 == 3) {
+
+				float direction[3] = { random() - 0.5f, -1.0f, random() - 0.5f };
+
+				lights.push_back(CGDSpotLight(position, direction, 4.0f + random() * 12.0f, 0.2f, 0.2f + random() * 1.2f, colour));
+
+			} else {
+
+				lights.push_back(CGDPointLight(position, 2.0f + random() * 8.0f, colour));
+			}
+		}
+
+		CGDClusteredLighting *lighting = CGDClusteredLighting::CreateClusteredLighting();
+
+		lighting->setView(&view.m[0][0], &proj.m[0][0]);
+
+		if (!lighting->benchmark(lights.data(), count, (uint32_t)frames))
+			ok = false;
+
+		lighting->release();
+	}
+
+	cout << (ok ? "\nlight benchmark passed\n" : "\nlight benchmark FAILED - the fast path does not match the reference or misses a light\n");
+
+	return ok ? 0 : 1;
+}
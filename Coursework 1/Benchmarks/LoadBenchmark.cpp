@@ -0,0 +1,43 @@
+//
+// LoadBenchmark.cpp
+//
+
+// Image loading time of CGDImageLoader - every file in a directory is read, decoded and given its mip chain on the calling thread and then on the job system, and the time of each file and the total time of each pass are reported (see CGDImageLoader::benchmark).  Usage: LoadBenchmark [directory].  The directory defaults to Resources/Textures.  Files that are not images are skipped.  Returns 1 if the directory cannot be read, it holds no images or an image fails to load.
+
+#include <stdafx.h>
+#include <CGDImageLoader.h>
+#include <CGDJobSystem.h>
+#include <string>
+#include <vector>
+#include <iostream>
+
+using namespace std;
+
+
+int main(int argc, char *argv[]) {
+
+	string directory = (argc > 1) ? argv[1] : "Resources/Textures";
+	vector<string> files;
+
+	if (!CGDImageLoader::ListFiles(directory, files)) {
+
+		cout << "Cannot read the image directory " << directory << "\n";
+		cout << "usage: LoadBenchmark [directory]\n";
+		return 1;
+	}
+
+	CGDJobSystem *jobSystem = CGDJobSystem::CreateJobSystem();
+	CGDImageLoader *loader = (jobSystem) ? CGDImageLoader::CreateImageLoader(jobSystem) : nullptr;
+
+	if (!loader)
+		return 1;
+
+	bool ok = loader->benchmark(files);
+
+	loader->release();
+	jobSystem->release();
+
+	cout << (ok ? "\nload benchmark passed\n" : "\nload benchmark FAILED - no images were found or an image failed to load\n");
+
+	return ok ? 0 : 1;
+}
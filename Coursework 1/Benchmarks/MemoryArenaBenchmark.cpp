@@ -0,0 +1,197 @@
+
+//
+// MemoryArenaBenchmark.cpp
+//
+
+// Cost of GUMemoryArena and GUObjectPool against the (tracked) heap they replace - per-frame scratch allocations from a frame arena and from GUScratchScope against malloc / free, and object pool create / destroy against new / delete.  Usage: MemoryArenaBenchmark [frames].  Returns 1 if the arena or pool make heap allocations once they have reached their working size.
+
+#include <stdafx.h>
+#include <CGDClock.h>
+#include <GUMemoryArena.h>
+#include <GUObjectPool.h>
+#include <cstdlib>
+#include <vector>
+#include <random>
+#include <iostream>
+#include <iomanip>
+
+using namespace std;
+
+
+namespace {
+
+	struct Particle {
+
+		float			position[3];
+		float			velocity[3];
+		float			age;
+		float			lifetime;
+
+		Particle(float t) : age(0.0f), lifetime(t) {
+
+			for (int i = 0; i < 3; i++)
+				position[i] = velocity[i] = 0.0f;
+		}
+	};
+
+	const int			allocationsPerFrame = 1000;
+	const int			particlesPerFrame = 1000;
+
+	double elapsedNs(gu_time_index start) {
+
+		return double(CGDClock::ActualTime() - start) * 1.0e9 / double(CGDClock::ActualTimeFrequency());
+	}
+
+	void report(const char *name, double heapNs, double arenaNs) {
+
+		cout << "  " << left << setw(28) << name << right << setw(10) << heapNs << " ns heap  " << setw(8) << arenaNs << " ns  " << setw(6) << (heapNs / arenaNs) << "x\n";
+	}
+
+	volatile uintptr_t sink;
+}
+
+
+int main(int argc, char *argv[]) {
+
+	int frames = (argc > 1) ? atoi(argv[1]) : 2000;
+
+	if (frames <= 0) {
+
+		cout << "usage: MemoryArenaBenchmark [frames]\n";
+		return 1;
+	}
+
+	// allocation sizes typical of per-frame scratch data
+	mt19937 rng(7);
+	uniform_int_distribution<size_t> sizeDistribution(16, 1024);
+	vector<size_t> sizes(allocationsPerFrame);
+
+	for (auto& s : sizes)
+		s = sizeDistribution(rng);
+
+	vector<void*> blocks(allocationsPerFrame);
+	gu_time_index t;
+	bool ok = true;
+
+	cout << fixed << setprecision(1);
+	cout << "GUMemoryArena / GUObjectPool, " << frames << " frames of " << allocationsPerFrame << " allocations\n";
+
+
+	// frame scratch - heap
+	t = CGDClock::ActualTime();
+
+	for (int f = 0; f < frames; f++) {
+
+		for (int i = 0; i < allocationsPerFrame; i++)
+			blocks[i] = malloc(sizes[i]);
+
+		for (int i = 0; i < allocationsPerFrame; i++)
+			free(blocks[i]);
+	}
+
+	double heapNs = elapsedNs(t) / (double(frames) * allocationsPerFrame);
+
+
+	// frame scratch - frame arena reset once per frame
+	GUMemoryArena *arena = GUMemoryArena::CreateArena(64 * 1024);
+
+	if (!arena) {
+
+		cout << "Cannot create arena\n";
+		return 1;
+	}
+
+	// the first frame sizes the arena
+	for (int i = 0; i < allocationsPerFrame; i++)
+		arena->allocate(sizes[i]);
+
+	arena->reset();
+
+	uint64_t arenaHeap = gu_memory_get_stats(gu_mem_arena).allocations;
+
+	t = CGDClock::ActualTime();
+
+	for (int f = 0; f < frames; f++) {
+
+		for (int i = 0; i < allocationsPerFrame; i++)
+			sink = (uintptr_t)arena->allocate(sizes[i]);
+
+		arena->reset();
+	}
+
+	double arenaNs = elapsedNs(t) / (double(frames) * allocationsPerFrame);
+
+	ok = ok && gu_memory_get_stats(gu_mem_arena).allocations == arenaHeap && arena->blockCount() == 1;
+	report("frame arena", heapNs, arenaNs);
+
+	arena->release();
+
+
+	// scratch scopes - a scope per allocation as a replacement for short lived malloc / free pairs
+	GUMemoryArena::ThreadScratch();
+	arenaHeap = gu_memory_get_stats(gu_mem_arena).allocations;
+
+	t = CGDClock::ActualTime();
+
+	for (int f = 0; f < frames; f++) {
+
+		for (int i = 0; i < allocationsPerFrame; i++) {
+
+			GUScratchScope scope;
+			sink = (uintptr_t)scope.allocate(sizes[i]);
+		}
+	}
+
+	double scratchNs = elapsedNs(t) / (double(frames) * allocationsPerFrame);
+
+	ok = ok && gu_memory_get_stats(gu_mem_arena).allocations == arenaHeap;
+	report("scratch scope", heapNs, scratchNs);
+
+	GUMemoryArena::ReleaseThreadScratch();
+
+
+	// particles - new / delete
+	vector<Particle*> particles(particlesPerFrame);
+
+	t = CGDClock::ActualTime();
+
+	for (int f = 0; f < frames; f++) {
+
+		for (int i = 0; i < particlesPerFrame; i++)
+			particles[i] = new Particle(float(i));
+
+		for (int i = 0; i < particlesPerFrame; i++)
+			delete particles[i];
+	}
+
+	double newNs = elapsedNs(t) / (double(frames) * particlesPerFrame);
+
+
+	// particles - object pool
+	{
+		GUObjectPool<Particle> pool(256);
+		pool.reserve(particlesPerFrame);
+
+		arenaHeap = gu_memory_get_stats(gu_mem_arena).allocations;
+
+		t = CGDClock::ActualTime();
+
+		for (int f = 0; f < frames; f++) {
+
+			for (int i = 0; i < particlesPerFrame; i++)
+				particles[i] = pool.create(float(i));
+
+			for (int i = 0; i < particlesPerFrame; i++)
+				pool.destroy(particles[i]);
+		}
+
+		double poolNs = elapsedNs(t) / (double(frames) * particlesPerFrame);
+
+		ok = ok && gu_memory_get_stats(gu_mem_arena).allocations == arenaHeap;
+		report("object pool", newNs, poolNs);
+	}
+
+	cout << (ok ? "\nmemory arena benchmark passed\n" : "\nmemory arena benchmark FAILED - heap allocations in the steady state\n");
+
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,188 @@
+
+//
+// MemoryBenchmark.cpp
+//
+
+// Multi-threaded stress test of the GUMemory allocation tracker.  Each thread allocates and frees blocks of random size under rotating memory tags, and hands a share of its blocks to the next thread to free so records are removed from the side table by a thread other than the one that added them.  The cost per allocate / free pair is compared with the CRT on 1 thread and on every hardware thread (at least 4).  Usage: MemoryBenchmark [operationsPerThread] [threads].  Returns 1 if the tracked live bytes or allocation counts do not balance once all blocks have been freed.
+
+#include <stdafx.h>
+#include <CGDClock.h>
+#include <GUMemory.h>
+#include <cstdlib>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <random>
+#include <iostream>
+#include <iomanip>
+
+// the CRT baseline calls malloc / free directly rather than through the tracking defines
+#undef malloc
+#undef free
+
+using namespace std;
+
+
+namespace {
+
+	typedef void* (*AllocFn)(size_t);
+	typedef void (*FreeFn)(void*);
+
+	// Blocks handed from one thread to the next to free
+	struct Mailbox {
+
+		mutex				lock;
+		vector<void*>		blocks;
+	};
+
+	double elapsedNs(gu_time_index start) {
+
+		return double(CGDClock::ActualTime() - start) * 1.0e9 / double(CGDClock::ActualTimeFrequency());
+	}
+
+	void stressThread(unsigned int index, unsigned int numThreads, uint64_t operations, AllocFn allocFn, FreeFn freeFn, vector<Mailbox>& mailboxes) {
+
+		mt19937 rng(index + 1);
+		uniform_int_distribution<size_t> size(16, 4096);
+
+		const size_t liveBlocks = 256;
+		vector<void*> live;
+		live.reserve(liveBlocks);
+
+		Mailbox& next = mailboxes[(index + 1) % numThreads];
+		Mailbox& mine = mailboxes[index];
+
+		vector<void*> incoming;
+
+		for (uint64_t i = 0; i < operations; i++) {
+
+			gu_memory_set_tag((gu_memory_tag)(i % gu_mem_num_tags));
+
+			void *p = allocFn(size(rng));
+			static_cast<char*>(p)[0] = 1;
+			live.push_back(p);
+
+			if (live.size() == liveBlocks) {
+
+				// free half here and pass a quarter to the next thread
+				for (size_t b = 0; b < liveBlocks / 2; b++)
+					freeFn(live[b]);
+
+				{
+					lock_guard<mutex> lock(next.lock);
+					next.blocks.insert(next.blocks.end(), live.begin() + liveBlocks / 2, live.begin() + liveBlocks * 3 / 4);
+				}
+
+				live.erase(live.begin(), live.begin() + liveBlocks * 3 / 4);
+
+				{
+					lock_guard<mutex> lock(mine.lock);
+					incoming.swap(mine.blocks);
+				}
+
+				for (auto b : incoming)
+					freeFn(b);
+
+				incoming.clear();
+			}
+		}
+
+		for (auto b : live)
+			freeFn(b);
+
+		gu_memory_set_tag(gu_mem_general);
+	}
+
+	// Return the average cost (ns) of an allocate / free pair
+	double runStress(unsigned int numThreads, uint64_t operations, AllocFn allocFn, FreeFn freeFn) {
+
+		vector<Mailbox> mailboxes(numThreads);
+		vector<thread> threads;
+
+		gu_time_index t = CGDClock::ActualTime();
+
+		for (unsigned int i = 0; i < numThreads; i++)
+			threads.push_back(thread(stressThread, i, numThreads, operations, allocFn, freeFn, ref(mailboxes)));
+
+		for (auto& th : threads)
+			th.join();
+
+		// blocks left in mailboxes by threads that finished first
+		for (auto& m : mailboxes)
+			for (auto b : m.blocks)
+				freeFn(b);
+
+		return elapsedNs(t) / double(operations * numThreads);
+	}
+
+	void* crtMalloc(size_t n) { return malloc(n); }
+	void crtFree(void *p) { free(p); }
+}
+
+
+int main(int argc, char *argv[]) {
+
+	uint64_t operations = (argc > 1) ? strtoull(argv[1], nullptr, 10) : 2000000;
+	unsigned int numThreads = (argc > 2) ? (unsigned int)atoi(argv[2]) : max(4u, thread::hardware_concurrency());
+
+	if (operations == 0 || numThreads == 0) {
+
+		cout << "usage: MemoryBenchmark [operationsPerThread] [threads]\n";
+		return 1;
+	}
+
+	cout << fixed << setprecision(1);
+	cout << "GUMemory, " << operations << " allocations per thread, " << thread::hardware_concurrency() << " hardware threads\n";
+
+	// warm up so one-off runtime allocations (thread start up, stream buffers) happen before the counters are sampled
+	runStress(numThreads, 1000, gu_malloc, gu_free);
+
+	vector<gu_memory_stats> beforeTags(gu_mem_num_tags);
+	gu_memory_stats before = gu_memory_get_total_stats();
+
+	for (int tag = 0; tag < gu_mem_num_tags; tag++)
+		beforeTags[tag] = gu_memory_get_stats((gu_memory_tag)tag);
+
+	double crt1 = runStress(1, operations, crtMalloc, crtFree);
+	double gu1 = runStress(1, operations, gu_malloc, gu_free);
+	double crtN = runStress(numThreads, operations, crtMalloc, crtFree);
+	double guN = runStress(numThreads, operations, gu_malloc, gu_free);
+
+	cout << "  threads        crt (ns)   tracked (ns)   overhead\n";
+	cout << "  " << setw(7) << 1 << setw(14) << crt1 << setw(15) << gu1 << setw(10) << (gu1 / crt1) << "x\n";
+	cout << "  " << setw(7) << numThreads << setw(14) << crtN << setw(15) << guN << setw(10) << (guN / crtN) << "x\n";
+
+	// every tracked block has been freed so the live bytes return to where they started and each tag saw the same number of allocations and frees
+	gu_memory_stats after = gu_memory_get_total_stats();
+	uint64_t expected = operations * (1 + numThreads);
+	bool ok = (after.live_bytes == before.live_bytes);
+
+	uint64_t tagAllocations = 0;
+
+	for (int tag = 0; tag < gu_mem_num_tags; tag++) {
+
+		gu_memory_stats s = gu_memory_get_stats((gu_memory_tag)tag);
+
+		uint64_t allocations = s.allocations - beforeTags[tag].allocations;
+		uint64_t deallocations = s.deallocations - beforeTags[tag].deallocations;
+
+		if (s.live_bytes != beforeTags[tag].live_bytes || allocations < deallocations) {
+
+			cout << "  tag " << gu_memory_tag_name((gu_memory_tag)tag) << " does not balance: live bytes " << beforeTags[tag].live_bytes << " -> " << s.live_bytes << "\n";
+			ok = false;
+		}
+
+		tagAllocations += allocations - deallocations;
+	}
+
+	// allocations made by the benchmark itself (threads, mailboxes) are freed too so the net count is 0
+	if (after.allocations - before.allocations < expected || tagAllocations != 0 || after.allocations - after.deallocations != before.allocations - before.deallocations) {
+
+		cout << "  allocation counts do not balance: " << (after.allocations - before.allocations) << " allocations, " << (after.deallocations - before.deallocations) << " frees\n";
+		ok = false;
+	}
+
+	cout << (ok ? "\nmemory benchmark passed\n" : "\nmemory benchmark FAILED\n");
+
+	return ok ? 0 : 1;
+}
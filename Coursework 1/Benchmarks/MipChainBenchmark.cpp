@@ -0,0 +1,106 @@
+//
+// MipChainBenchmark.cpp
+//
+
+// Throughput of GUMipChain - the full mip chain of each image is built with the box and Kaiser filters using the options the loader would choose (see gu_mip_default_options) and the best of several runs is reported in mip 0 Mpixels per second.  Images with transparent texels also report the alpha test coverage of each mip.  Usage: MipChainBenchmark [runs] [images...].  The images default to a colour texture, a normal map, a height map and an alpha tested texture from the scene.  Returns 1 if an image cannot be read or a mip down to 8x8 strays more than 0.02 from the alpha test coverage of mip 0.
+
+#include <stdafx.h>
+#include <CGDClock.h>
+#include <GUImageDecoder.h>
+#include <GUMipChain.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <iomanip>
+
+using namespace std;
+
+
+int main(int argc, char *argv[]) {
+
+	int runs = (argc > 1) ? atoi(argv[1]) : 5;
+	vector<string> files(argv + min(argc, 2), argv + argc);
+
+	if (runs <= 0) {
+
+		cout << "usage: MipChainBenchmark [runs] [images...]\n";
+		return 1;
+	}
+
+	if (files.empty()) {
+
+		files.push_back("Resources/Textures/dropship_texture.bmp");
+		files.push_back("Resources/Textures/normalmap.bmp");
+		files.push_back("Resources/Textures/heightmap1.bmp");
+		files.push_back("Resources/Textures/tree.tif");
+	}
+
+	static const char *contentNames[] = { "colour", "linear", "normal" };
+	bool ok = true;
+
+	cout << fixed << setprecision(2);
+	cout << "Mip chain benchmark: best of " << runs << " runs\n";
+
+	for (size_t i = 0; i < files.size(); i++) {
+
+		uint32_t width, height;
+		vector<uint8_t> rgba;
+
+		if (!gu_image_read_rgba(files[i].c_str(), width, height, rgba)) {
+
+			cout << "Cannot read " << files[i] << "\n";
+			ok = false;
+			continue;
+		}
+
+		gu_mip_options options = gu_mip_default_options(files[i].c_str(), width, height, rgba.data());
+
+		cout << "\n" << files[i] << " " << width << "x" << height << " (" << contentNames[options.content] << ((options.alphaTestRef > 0.0f) ? ", alpha tested" : "") << ")\n";
+
+		for (int filter = gu_mip_box; filter <= gu_mip_kaiser; filter++) {
+
+			vector<vector<uint8_t> > mips;
+			double best = 1.0e30;
+
+			options.filter = (gu_mip_filter)filter;
+
+			for (int r = 0; r < runs; r++) {
+
+				gu_time_index start = CGDClock::ActualTime();
+
+				gu_mip_generate(width, height, rgba.data(), options, mips);
+
+				best = min(best, (double)(CGDClock::ActualTime() - start) / (double)CGDClock::ActualTimeFrequency());
+			}
+
+			cout << "  " << left << setw(8) << ((filter == gu_mip_box) ? "box" : "Kaiser") << right << setw(10) << (double)width * height / max(best, 1e-9) / 1.0e6 << " Mpixels/s (" << mips.size() << " mips)\n";
+
+			if (options.alphaTestRef <= 0.0f)
+				continue;
+
+			float coverage = gu_mip_alpha_coverage(width, height, rgba.data(), options.alphaTestRef);
+
+			cout << "    alpha test coverage";
+
+			for (size_t m = 0; m < mips.size(); m++) {
+
+				uint32_t w = max(width >> m, 1u), h = max(height >> m, 1u);
+				float c = gu_mip_alpha_coverage(w, h, mips[m].data(), options.alphaTestRef);
+
+				cout << " " << setprecision(3) << c;
+
+				if (w >= 8 && h >= 8 && fabs(c - coverage) > 0.02f)
+					ok = false;
+			}
+
+			cout << setprecision(2) << "\n";
+		}
+	}
+
+	cout << (ok ? "\nmip chain benchmark passed\n" : "\nmip chain benchmark FAILED - an image could not be read or alpha test coverage was not preserved\n");
+
+	return ok ? 0 : 1;
+}
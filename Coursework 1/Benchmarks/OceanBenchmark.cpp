@@ -0,0 +1,48 @@
+//
+// OceanBenchmark.cpp
+//
+
+// Throughput of CGDOcean - each FFT resolution from 64 to 512 is updated for the given number of frames with Scene's ocean settings, and the update time per frame of the reference implementation, the SSE FFT and the SSE FFT on the job system is reported along with the difference of the fast path from the reference (see CGDOcean::benchmark).  Usage: OceanBenchmark [frames].  Returns 1 if the fast path does not match the reference at any resolution.
+
+#include <stdafx.h>
+#include <CGDOcean.h>
+#include <CGDJobSystem.h>
+#include <cstdlib>
+#include <iostream>
+
+using namespace std;
+
+
+int main(int argc, char *argv[]) {
+
+	int frames = (argc > 1) ? atoi(argv[1]) : 120;
+
+	if (frames <= 0) {
+
+		cout << "usage: OceanBenchmark [frames]\n";
+		return 1;
+	}
+
+	CGDJobSystem *jobSystem = CGDJobSystem::CreateJobSystem();
+	bool ok = true;
+
+	for (uint32_t resolution = 64; resolution <= 512; resolution *= 2) {
+
+		CGDOceanDesc desc;
+
+		desc.resolution = resolution;
+
+		CGDOcean *ocean = CGDOcean::CreateOcean(desc, jobSystem);
+
+		if (!ocean->benchmark((uint32_t)frames))
+			ok = false;
+
+		ocean->release();
+	}
+
+	jobSystem->release();
+
+	cout << (ok ? "\nocean benchmark passed\n" : "\nocean benchmark FAILED - the fast path does not match the reference\n");
+
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,63 @@
+//
+// PostBenchmark.cpp
+//
+
+// Throughput of CGDPostProcess - the bloom and depth of field chain runs on the first 1280 x 720 frame of the headless scene and its depth buffer, and the time of each pass is reported with the scalar reference, the SSE fast path and the SSE fast path on the job system (see CGDPostProcess::benchmark).  Usage: PostBenchmark [frames] [golden prefix].  If a golden prefix is given the reference image of each stage is compared with <golden prefix><stage>.png, or written there if it does not exist.  Returns 1 if the fast path does not match the reference or a reference image does not match its golden image.
+
+#include <stdafx.h>
+#include <CGDPostProcess.h>
+#include <CGDJobSystem.h>
+#include <HeadlessScene.h>
+#include <CGDSoftwareRasterizer.h>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <iostream>
+
+using namespace std;
+
+
+int main(int argc, char *argv[]) {
+
+	int frames = (argc > 1) ? atoi(argv[1]) : 60;
+	string goldenPrefix = (argc > 2) ? argv[2] : "";
+
+	if (frames <= 0) {
+
+		cout << "usage: PostBenchmark [frames] [golden prefix]\n";
+		return 1;
+	}
+
+	HeadlessScene *headlessScene = HeadlessScene::CreateHeadlessScene(1280, 720);
+
+	if (!headlessScene) {
+
+		cout << "\npost-processing benchmark FAILED - cannot create the headless scene\n";
+		return 1;
+	}
+
+	headlessScene->renderFrame(1.0 / 60.0);
+
+	CGDSoftwareRasterizer *rasterizer = headlessScene->getRasterizer();
+	uint32_t width = rasterizer->getWidth();
+	uint32_t height = rasterizer->getHeight();
+	vector<uint32_t> rgba(width * height);
+	CGDPostImage scene;
+
+	rasterizer->readColour(rgba.data());
+	scene.fromRGBA8(width, height, rgba.data());
+
+	CGDJobSystem *jobSystem = CGDJobSystem::CreateJobSystem();
+	CGDPostProcess *postProcess = CGDPostProcess::CreatePostProcess(width, height, CGDPostProcessDesc(), jobSystem);
+
+	// The rasterizer's depth rows are padded to a multiple of 4 floats
+	bool ok = postProcess->benchmark(scene, rasterizer->getDepthBuffer(), (width + 3) & ~3u, (uint32_t)frames, goldenPrefix);
+
+	postProcess->release();
+	jobSystem->release();
+	headlessScene->release();
+
+	cout << (ok ? "\npost-processing benchmark passed\n" : "\npost-processing benchmark FAILED - the fast path does not match the reference or a golden image differs\n");
+
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,167 @@
+
+//
+// ProfilerBenchmark.cpp
+//
+
+// Cost of recording a CGDProfiler zone (two timestamps and a push into the calling thread's ring buffer) on one and on all hardware threads, and of taking a snapshot of a full ring while its thread is recording.  Usage: ProfilerBenchmark [zones] [maxNsPerZone].  Returns 1 if the average cost of an empty zone on any thread exceeds maxNsPerZone (default 50).  Almost all of an empty zone is its two timestamp reads, which measured 19-24 ns each on the virtual machines the tests run on (an empty zone of 40-51 ns), so the ctest run passes a higher limit (see CMakeLists.txt).
+
+#include <stdafx.h>
+#include <CGDClock.h>
+#include <CGDProfiler.h>
+#include <cstdlib>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <iostream>
+#include <iomanip>
+
+using namespace std;
+
+
+static double elapsedNs(gu_time_index start) {
+
+	return double(CGDClock::ActualTime() - start) * 1.0e9 / double(CGDClock::ActualTimeFrequency());
+}
+
+
+// Return the average cost (ns) of an empty zone on the calling thread - the best of 5 runs after a pass over the ring buffer so its pages are resident
+static double timeEmptyZones(uint64_t zones) {
+
+	for (uint32_t i = 0; i < CGDProfileThreadBuffer::capacity; i++) {
+
+		CGDProfileZone zone("warm");
+	}
+
+	double best = 0.0;
+
+	for (int run = 0; run < 5; run++) {
+
+		gu_time_index t = CGDClock::ActualTime();
+
+		for (uint64_t i = 0; i < zones; i++) {
+
+			CGDProfileZone zone("empty");
+		}
+
+		double ns = elapsedNs(t) / double(zones);
+		best = (run == 0) ? ns : min(best, ns);
+	}
+
+	return best;
+}
+
+
+// Return the average cost (ns) of reading the profiler timestamp.  A zone reads it twice so this is the floor of the zone cost (the time stamp counter is slow to read on some virtual machines)
+static double timeTimestamps(uint64_t reads) {
+
+	uint64_t sum = 0;
+	gu_time_index t = CGDClock::ActualTime();
+
+	for (uint64_t i = 0; i < reads; i++)
+		sum += CGDProfiler::Now();
+
+	double ns = elapsedNs(t) / double(reads);
+
+	// keep the reads live
+	if (sum == 0)
+		cout << "";
+
+	return ns;
+}
+
+
+// Return the average cost (ns) of a zone containing a nested zone and a counter, per recorded event
+static double timeNestedZones(uint64_t zones) {
+
+	gu_time_index t = CGDClock::ActualTime();
+
+	for (uint64_t i = 0; i < zones; i++) {
+
+		CGDProfileZone outer("outer");
+		CGDProfileZone inner("inner");
+		CGDProfiler::Counter("counter", (int64_t)i);
+	}
+
+	return elapsedNs(t) / double(zones * 3);
+}
+
+
+int main(int argc, char *argv[]) {
+
+	uint64_t zones = (argc > 1) ? strtoull(argv[1], nullptr, 10) : 20000000;
+	double maxNsPerZone = (argc > 2) ? atof(argv[2]) : 50.0;
+
+	if (zones == 0) {
+
+		cout << "usage: ProfilerBenchmark [zones] [maxNsPerZone]\n";
+		return 1;
+	}
+
+	bool ok = true;
+
+	cout << fixed << setprecision(2);
+	cout << "CGDProfiler, " << zones << " zones per run\n";
+
+	double timestamp = timeTimestamps(zones);
+	double single = timeEmptyZones(zones);
+
+	ok = ok && single <= maxNsPerZone;
+
+	cout << "  timestamp read                   " << setw(8) << timestamp << " ns\n";
+	cout << "  empty zone (1 thread)            " << setw(8) << single << " ns\n";
+	cout << "  nested zones + counter per event " << setw(8) << timeNestedZones(zones / 3) << " ns\n";
+
+	// one recording thread per hardware thread - the buffers are per-thread so the cost should not grow with the number of threads.  Skipped on a single core where the threads would time each other
+	unsigned int numThreads = thread::hardware_concurrency();
+
+	if (numThreads > 1) {
+
+		vector<double> threadNs(numThreads, 0.0);
+		vector<thread> threads;
+
+		for (unsigned int i = 0; i < numThreads; i++)
+			threads.push_back(thread([&, i]() { threadNs[i] = timeEmptyZones(zones / numThreads); }));
+
+		for (auto& t : threads)
+			t.join();
+
+		double worst = 0.0;
+
+		for (auto ns : threadNs)
+			worst = max(worst, ns);
+
+		ok = ok && worst <= maxNsPerZone;
+
+		cout << "  empty zone (" << numThreads << " threads, worst)   " << setw(8) << worst << " ns\n";
+	}
+
+	// snapshot a full ring while its thread records.  On a single core the reader and the recording thread share the core so the zone cost is only reported with more than one
+	atomic<bool> done(false);
+	CGDProfileThreadBuffer *buffer = CGDProfiler::ThreadBuffer();
+
+	thread reader([&]() {
+
+		uint64_t snapshots = 0;
+		size_t events = 0;
+		gu_time_index t = CGDClock::ActualTime();
+
+		while (!done.load() || snapshots == 0) {
+
+			events += buffer->snapshot().size();
+			snapshots++;
+		}
+
+		cout << "  snapshot of a full ring          " << setw(8) << (elapsedNs(t) / double(snapshots) / 1000.0) << " us  (" << (events / snapshots) << " of " << CGDProfileThreadBuffer::capacity << " events)\n";
+	});
+
+	double whileReading = timeEmptyZones(zones);
+	done.store(true);
+	reader.join();
+
+	if (numThreads > 1)
+		cout << "  empty zone while snapshotting    " << setw(8) << whileReading << " ns\n";
+
+	cout << (ok ? "\nprofiler benchmark passed\n" : "\nprofiler benchmark FAILED - zones cost more than the limit\n");
+
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,222 @@
+
+//
+// QuaternionBatchBenchmark.cpp
+//
+
+// Throughput of the GUQuaternionBatch (SoA / SSE) kernels against the equivalent per-element scalar loop over an array of structures.  Usage: QuaternionBatchBenchmark [count] [iterations].  Each batch result is compared with the scalar result and 1 is returned if they differ by more than the kernels' documented accuracy.
+
+#include <stdafx.h>
+#include <CGDClock.h>
+#include <CoreStructures/GUQuaternionBatch.h>
+#include <cstdlib>
+#include <vector>
+#include <random>
+#include <iostream>
+#include <iomanip>
+
+using namespace std;
+using namespace CoreStructures;
+
+
+namespace {
+
+	// AoS layout of the scalar baseline
+	struct Quat {
+
+		float s, i, j, k;
+	};
+
+	struct Vec3 {
+
+		float x, y, z;
+	};
+
+	double elapsedMs(gu_time_index start) {
+
+		return double(CGDClock::ActualTime() - start) * 1000.0 / double(CGDClock::ActualTimeFrequency());
+	}
+
+	void report(const char *name, size_t count, int iterations, double scalarMs, double batchMs, double maxDifference) {
+
+		double scalarRate = double(count) * iterations / (scalarMs * 1.0e3);
+		double batchRate = double(count) * iterations / (batchMs * 1.0e3);
+
+		cout << "  " << left << setw(20) << name << right << fixed << setprecision(1)
+			<< setw(10) << scalarRate << " M/s scalar  "
+			<< setw(10) << batchRate << " M/s batch  "
+			<< setw(6) << setprecision(2) << (batchRate / scalarRate) << "x  max diff "
+			<< scientific << setprecision(1) << maxDifference << fixed << "\n";
+	}
+}
+
+
+int main(int argc, char *argv[]) {
+
+	size_t count = (argc > 1) ? size_t(strtoull(argv[1], nullptr, 10)) : 100000;
+	int iterations = (argc > 2) ? atoi(argv[2]) : 100;
+
+	if (count == 0 || iterations <= 0) {
+
+		cout << "usage: QuaternionBatchBenchmark [count] [iterations]\n";
+		return 1;
+	}
+
+#ifdef __GU_QUATERNION_BATCH_SSE__
+	cout << "GUQuaternionBatch (SSE), " << count << " elements x " << iterations << " iterations\n";
+#else
+	cout << "GUQuaternionBatch (scalar), " << count << " elements x " << iterations << " iterations\n";
+#endif
+
+	mt19937 rng(42);
+	normal_distribution<float> N(0.0f, 1.0f);
+
+	vector<Quat> a(count), b(count), c(count);
+	vector<Vec3> v(count), w(count);
+
+	for (size_t x = 0; x < count; x++) {
+
+		Quat *q[2] = { &a[x], &b[x] };
+
+		for (int qIndex = 0; qIndex < 2; qIndex++) {
+
+			Quat& r = *q[qIndex];
+			r.s = N(rng); r.i = N(rng); r.j = N(rng); r.k = N(rng);
+
+			float l = 1.0f / sqrtf(r.s*r.s + r.i*r.i + r.j*r.j + r.k*r.k);
+			r.s *= l; r.i *= l; r.j *= l; r.k *= l;
+		}
+
+		v[x].x = N(rng); v[x].y = N(rng); v[x].z = N(rng);
+	}
+
+	// SoA copies
+	GUQuaternionArray A(count), B(count), C(count), D(count);
+
+	for (size_t x = 0; x < count; x++) {
+
+		A.soa().s[x] = a[x].s; A.soa().i[x] = a[x].i; A.soa().j[x] = a[x].j; A.soa().k[x] = a[x].k;
+		B.soa().s[x] = b[x].s; B.soa().i[x] = b[x].i; B.soa().j[x] = b[x].j; B.soa().k[x] = b[x].k;
+	}
+
+	vector<float> vx(count), vy(count), vz(count), ox(count), oy(count), oz(count);
+
+	for (size_t x = 0; x < count; x++) {
+
+		vx[x] = v[x].x; vy[x] = v[x].y; vz[x] = v[x].z;
+	}
+
+	GUVector3SoA V(vx.data(), vy.data(), vz.data()), O(ox.data(), oy.data(), oz.data());
+
+	// accumulate the maximum component difference between the batch (SoA) and scalar (AoS) results
+	auto quatDifference = [&](const vector<Quat>& q, GUQuaternionArray& Q) {
+
+		double d = 0.0;
+
+		for (size_t x = 0; x < count; x++) {
+
+			d = max(d, double(fabsf(q[x].s - Q.soa().s[x])));
+			d = max(d, double(fabsf(q[x].i - Q.soa().i[x])));
+			d = max(d, double(fabsf(q[x].j - Q.soa().j[x])));
+			d = max(d, double(fabsf(q[x].k - Q.soa().k[x])));
+		}
+
+		return d;
+	};
+
+	bool ok = true;
+	gu_time_index t;
+	double scalarMs, batchMs, diff;
+
+
+	// multiply
+	t = CGDClock::ActualTime();
+	for (int it = 0; it < iterations; it++)
+		for (size_t x = 0; x < count; x++)
+			gu_batch_internal::mul(a[x].s, a[x].i, a[x].j, a[x].k, b[x].s, b[x].i, b[x].j, b[x].k, &c[x].s, &c[x].i, &c[x].j, &c[x].k);
+	scalarMs = elapsedMs(t);
+
+	t = CGDClock::ActualTime();
+	for (int it = 0; it < iterations; it++)
+		gu_quat_multiply(A.soa(), B.soa(), C.soa(), count);
+	batchMs = elapsedMs(t);
+
+	diff = quatDifference(c, C);
+	ok = ok && diff < 1.0e-6;
+	report("multiply", count, iterations, scalarMs, batchMs, diff);
+
+
+	// normalise (of the products, which have drifted from unit length by rounding)
+	t = CGDClock::ActualTime();
+	for (int it = 0; it < iterations; it++) {
+
+		for (size_t x = 0; x < count; x++) {
+
+			Quat& q = c[x];
+			float inv = 1.0f / sqrtf(q.s*q.s + q.i*q.i + q.j*q.j + q.k*q.k);
+			q.s *= inv; q.i *= inv; q.j *= inv; q.k *= inv;
+		}
+	}
+	scalarMs = elapsedMs(t);
+
+	t = CGDClock::ActualTime();
+	for (int it = 0; it < iterations; it++)
+		gu_quat_normalise(C.soa(), count);
+	batchMs = elapsedMs(t);
+
+	diff = quatDifference(c, C);
+	ok = ok && diff < 1.0e-6;
+	report("normalise", count, iterations, scalarMs, batchMs, diff);
+
+
+	// slerp
+	t = CGDClock::ActualTime();
+	for (int it = 0; it < iterations; it++)
+		for (size_t x = 0; x < count; x++)
+			gu_batch_internal::slerp(a[x].s, a[x].i, a[x].j, a[x].k, b[x].s, b[x].i, b[x].j, b[x].k, 0.3f, &c[x].s, &c[x].i, &c[x].j, &c[x].k);
+	scalarMs = elapsedMs(t);
+
+	t = CGDClock::ActualTime();
+	for (int it = 0; it < iterations; it++)
+		gu_quat_slerp(A.soa(), B.soa(), 0.3f, D.soa(), count);
+	batchMs = elapsedMs(t);
+
+	diff = quatDifference(c, D);
+	ok = ok && diff < 1.0e-5;
+	report("slerp", count, iterations, scalarMs, batchMs, diff);
+
+
+	// per-element rotation
+	t = CGDClock::ActualTime();
+	for (int it = 0; it < iterations; it++)
+		for (size_t x = 0; x < count; x++)
+			gu_batch_internal::rotate(a[x].s, a[x].i, a[x].j, a[x].k, v[x].x, v[x].y, v[x].z, &w[x].x, &w[x].y, &w[x].z);
+	scalarMs = elapsedMs(t);
+
+	t = CGDClock::ActualTime();
+	for (int it = 0; it < iterations; it++)
+		gu_quat_rotate(A.soa(), V, O, count);
+	batchMs = elapsedMs(t);
+
+	diff = 0.0;
+	for (size_t x = 0; x < count; x++)
+		diff = max(diff, double(max(fabsf(w[x].x - ox[x]), max(fabsf(w[x].y - oy[x]), fabsf(w[x].z - oz[x])))));
+
+	ok = ok && diff < 1.0e-5;
+	report("rotate", count, iterations, scalarMs, batchMs, diff);
+
+
+	// dual quaternion point transform <A, B> (B is not a valid translation part but the cost is the same)
+	GUDualQuaternionSoA Q(A.soa(), B.soa());
+
+	t = CGDClock::ActualTime();
+	for (int it = 0; it < iterations; it++)
+		gu_dualquat_transform(Q, V, O, count);
+	batchMs = elapsedMs(t);
+
+	cout << "  " << left << setw(20) << "dualquat transform" << right << setw(31) << setprecision(1) << (double(count) * iterations / (batchMs * 1.0e3)) << " M/s batch\n";
+
+
+	cout << (ok ? "\nquaternion batch benchmark passed\n" : "\nquaternion batch benchmark FAILED - batch and scalar results differ\n");
+
+	return ok ? 0 : 1;
+}
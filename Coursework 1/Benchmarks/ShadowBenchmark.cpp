@@ -0,0 +1,103 @@
+//
+// ShadowBenchmark.cpp
+//
+
+// Cost of CGDCascadedShadows - the camera path is replayed with the cascades Scene uses for the sun and stand-ins for its casters (the bridge and sphere, static, and the dropship and 40 bushes, dynamic), with the cascades refitted every frame and with cached static cascades.  The update time per frame and each cascade's refits, static redraws and casters drawn are reported (see CGDCascadedShadows::reportStats).  Usage: ShadowBenchmark [camera path].  Returns 1 if the path cannot be loaded or caching does not reduce the static caster redraws.
+
+#include <stdafx.h>
+#include <CGDCascadedShadows.h>
+#include <CGDCameraPath.h>
+#include <CGDSoftwareShaders.h>
+#include <CGDClock.h>
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+
+int main(int argc, char *argv[]) {
+
+	string pathName = (argc > 1) ? argv[1] : "Resources/Benchmarks/flythrough.txt";
+	CGDCameraPath *path = CGDCameraPath::LoadCameraPath(pathName);
+
+	if (!path || path->keyframeCount() == 0) {
+
+		cout << "\nshadow benchmark FAILED - cannot read the camera path " << pathName << "\n";
+		return 1;
+	}
+
+	CGDSoftwareMatrix projMatrix = CGDSoftwareMatrix::PerspectiveFovLH(0.25f * 3.14f, 1.0f, 1.0f, 1000.0f);
+	const float lightDirection[3] = { 250.0f, -130.0f, -145.0f }; // the sun shines from its position towards the scene centre
+
+	// Casters - bridge, sphere, dropship (circling the centre) and bushes
+	vector<CGDShadowCaster> casters(43);
+	uint32_t state = 1;
+
+	for (uint32_t i = 0; i < 40; i++) {
+
+		float angle, distance;
+
+		state ^= state << 13; state ^= state >> 17; state ^= state << 5;
+		angle = (float)(state >> 8) / 16777216.0f * 6.2832f;
+		state ^= state << 13; state ^= state >> 17; state ^= state << 5;
+		distance = 25.0f + (float)(state >> 8) / 16777216.0f * 20.0f;
+
+		CGDShadowCaster bush = { { cosf(angle) * distance, -1.0f, sinf(angle) * distance, 1.5f }, false };
+		casters[3 + i] = bush;
+	}
+
+	CGDShadowCaster bridge = { { 0.0f, 0.0f, 12.0f, 12.0f }, true }, sphere = { { 0.0f, 0.0f, 0.0f, 5.0f }, true };
+
+	casters[0] = bridge;
+	casters[1] = sphere;
+
+	uint64_t staticRedraws[2] = { 0, 0 };
+
+	for (int cached = 0; cached < 2; cached++) {
+
+		CGDShadowDesc desc;
+
+		desc.cacheStatic = (cached != 0);
+
+		CGDCascadedShadows *shadows = CGDCascadedShadows::CreateCascadedShadows(desc);
+		size_t frames = path->keyframeCount();
+		gu_time_interval updateTime = 0;
+
+		for (size_t f = 0; f < frames; f++) {
+
+			const CGDCameraKeyframe& k = path->keyframe(f);
+			float at[3] = { k.position[0] + k.direction[0], k.position[1] + k.direction[1], k.position[2] + k.direction[2] };
+			float up[3] = { 0.0f, 1.0f, 0.0f };
+			CGDSoftwareMatrix viewMatrix = CGDSoftwareMatrix::LookAtLH(k.position, at, up);
+			float dropshipAngle = (float)f * 0.01f;
+			CGDShadowCaster dropship = { { 40.0f * cosf(dropshipAngle), 20.0f, -40.0f * sinf(dropshipAngle), 8.0f }, false };
+
+			casters[2] = dropship;
+
+			gu_time_index start = CGDClock::ActualTime();
+
+			shadows->update(&viewMatrix.m[0][0], &projMatrix.m[0][0], lightDirection, casters.data(), (uint32_t)casters.size());
+			updateTime += CGDClock::ActualTime() - start;
+		}
+
+		for (uint32_t i = 0; i < shadows->getCascadeCount(); i++)
+			staticRedraws[cached] += shadows->getStats(i).staticRedraws;
+
+		cout << "\n" << ((cached) ? "Cached static cascades" : "Cascades refitted every frame") << " over " << frames << " frames: " << fixed << setprecision(3) << (double)updateTime * 1000000.0 / (double)CGDClock::ActualTimeFrequency() / (double)frames << " us per update" << endl;
+		shadows->reportStats();
+
+		shadows->release();
+	}
+
+	path->release();
+
+	bool ok = staticRedraws[1] < staticRedraws[0];
+
+	cout << (ok ? "\nshadow benchmark passed\n" : "\nshadow benchmark FAILED - caching does not reduce the static caster redraws\n");
+
+	return ok ? 0 : 1;
+}
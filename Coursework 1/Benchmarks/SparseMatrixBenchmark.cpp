@@ -0,0 +1,212 @@
+
+//
+// SparseMatrixBenchmark.cpp
+//
+
+// Benchmark the CoreStructures sparse matrix model on regular grid meshes of 10k to 5M vertices - Laplacian construction, SpMV, the PCG solver and the AMD-ordered sparse Cholesky factorisation of the implicit smoothing system (I + lambda L).  Usage: SparseMatrixBenchmark [numVertices...] [-cholesky maxVertices].  The sparse Cholesky factor of the larger meshes needs several GB so it is only run up to maxVertices (default 1M).  Returns 1 if any solve fails or does not reach the residual tolerance.
+
+#include <stdafx.h>
+#include <CGDClock.h>
+#include <CoreStructures/matrix_sparse.h>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <iostream>
+#include <iomanip>
+
+using namespace std;
+using namespace CoreStructures;
+
+
+static double elapsedMs(gu_time_index start) {
+
+	return double(CGDClock::ActualTime() - start) * 1000.0 / double(CGDClock::ActualTimeFrequency());
+}
+
+
+// Build a (w x h) vertex grid triangulated with 2 faces per quad.  Positions are stored as 4 floats per vertex (x, y, z, w)
+static void buildGrid(unsigned int w, unsigned int h, vector<float>& positions, vector<int>& faces) {
+
+	positions.resize(size_t(w) * h * 4);
+	faces.clear();
+	faces.reserve(size_t(w - 1) * (h - 1) * 6);
+
+	for (unsigned int j = 0; j < h; j++) {
+
+		for (unsigned int i = 0; i < w; i++) {
+
+			float *p = &positions[(size_t(j) * w + i) * 4];
+			p[0] = float(i);
+			p[1] = 0.1f * sinf(float(i) * 0.3f) * cosf(float(j) * 0.2f);
+			p[2] = float(j);
+			p[3] = 1.0f;
+		}
+	}
+
+	for (unsigned int j = 0; j + 1 < h; j++) {
+
+		for (unsigned int i = 0; i + 1 < w; i++) {
+
+			int v0 = int(j * w + i), v1 = v0 + 1, v2 = v0 + int(w), v3 = v2 + 1;
+
+			faces.push_back(v0); faces.push_back(v2); faces.push_back(v1);
+			faces.push_back(v1); faces.push_back(v2); faces.push_back(v3);
+		}
+	}
+}
+
+
+static double relativeResidual(const sparse_matrix<double>& A, const vector<double>& x, const vector<double>& b) {
+
+	vector<double> r = b;
+	A.spmv(x.data(), r.data(), -1.0, 1.0);
+
+	double rr = 0.0, bb = 0.0;
+
+	for (size_t i = 0; i < b.size(); i++) {
+
+		rr += r[i] * r[i];
+		bb += b[i] * b[i];
+	}
+
+	return (bb > 0.0) ? sqrt(rr / bb) : sqrt(rr);
+}
+
+
+// Run the benchmark for a single grid.  Returns false if a solve fails
+static bool benchmarkMesh(unsigned int targetVertices, unsigned int choleskyLimit) {
+
+	unsigned int w = max(2u, (unsigned int)(sqrt(double(targetVertices)) + 0.5));
+	unsigned int h = max(2u, targetVertices / w);
+	unsigned int n = w * h;
+
+	vector<float> positions;
+	vector<int> faces;
+	buildGrid(w, h, positions, faces);
+
+	unsigned int numFaces = (unsigned int)(faces.size() / 3);
+
+	cout << "\n" << n << " vertices (" << w << " x " << h << "), " << numFaces << " faces\n";
+
+	gu_time_index t = CGDClock::ActualTime();
+	sparse_matrix<double> L = uniform_laplacian<double>(n, faces.data(), numFaces);
+	cout << "  uniform laplacian      " << setw(10) << fixed << setprecision(2) << elapsedMs(t) << " ms  nnz = " << L.nnz() << "\n";
+
+	// GUVector4's constructors live in the Windows CoreStructures library.  cotangent_laplacian only reads x, y and z so the packed float positions are used directly
+	t = CGDClock::ActualTime();
+	sparse_matrix<double> Lc = cotangent_laplacian<double>(n, reinterpret_cast<const GUVector4*>(positions.data()), faces.data(), numFaces);
+	cout << "  cotangent laplacian    " << setw(10) << elapsedMs(t) << " ms  nnz = " << Lc.nnz() << "\n";
+
+	sparse_matrix<double> A = smoothing_system(L, 0.5);
+
+	vector<double> x(n), y(n, 0.0), b(n);
+
+	for (unsigned int i = 0; i < n; i++) {
+
+		x[i] = double(i % 17) * 0.125;
+		b[i] = positions[size_t(i) * 4 + 1];
+	}
+
+	const int spmvRuns = 20;
+
+	t = CGDClock::ActualTime();
+	for (int k = 0; k < spmvRuns; k++)
+		A.spmv(x.data(), y.data());
+	double spmvMs = elapsedMs(t) / spmvRuns;
+
+	cout << "  spmv                   " << setw(10) << spmvMs << " ms  " << setprecision(1) << (double(A.nnz()) / (spmvMs * 1.0e3)) << " Mnnz/s\n" << setprecision(2);
+
+	bool ok = true;
+
+	vector<double> xp;
+	unsigned int iterations = 0;
+	double residual = 0.0;
+
+	t = CGDClock::ActualTime();
+	gu_pcg_state pcgState = pcg_solve(A, b, &xp, gu_precond_jacobi, 1.0e-8, 2000, &iterations, &residual);
+	double pcgMs = elapsedMs(t);
+	double pcgResidual = relativeResidual(A, xp, b);
+
+	cout << "  pcg (jacobi)           " << setw(10) << pcgMs << " ms  " << iterations << " iterations, residual " << scientific << setprecision(2) << pcgResidual << fixed << "\n";
+
+	if (pcgState != gu_pcg_converged || pcgResidual > 1.0e-6) {
+
+		cout << "  FAILED: pcg did not converge (" << pcgState << ")\n";
+		ok = false;
+	}
+
+	if (n > choleskyLimit) {
+
+		cout << "  cholesky               skipped (above -cholesky " << choleskyLimit << ")\n";
+		return ok;
+	}
+
+	sparse_cholesky<double> chol;
+
+	t = CGDClock::ActualTime();
+	gu_cholesky_state cState = chol.analyse(A, true);
+	double analyseMs = elapsedMs(t);
+
+	if (cState == gu_cholesky_okay) {
+
+		t = CGDClock::ActualTime();
+		cState = chol.factorise(A);
+	}
+
+	double factoriseMs = elapsedMs(t);
+
+	if (cState != gu_cholesky_okay) {
+
+		cout << "  FAILED: cholesky factorisation failed\n";
+		return false;
+	}
+
+	t = CGDClock::ActualTime();
+	vector<double> xc = chol.solve(b);
+	double solveMs = elapsedMs(t);
+	double cResidual = xc.empty() ? 1.0 : relativeResidual(A, xc, b);
+
+	cout << "  cholesky analyse (amd) " << setw(10) << analyseMs << " ms  nnz(L) = " << chol.nnz_L() << "\n";
+	cout << "  cholesky factorise     " << setw(10) << factoriseMs << " ms\n";
+	cout << "  cholesky solve         " << setw(10) << solveMs << " ms  residual " << scientific << setprecision(2) << cResidual << fixed << "\n";
+
+	if (cResidual > 1.0e-8) {
+
+		cout << "  FAILED: cholesky residual too large\n";
+		ok = false;
+	}
+
+	return ok;
+}
+
+
+int main(int argc, char *argv[]) {
+
+	vector<unsigned int> sizes;
+	unsigned int choleskyLimit = 1000000;
+
+	for (int i = 1; i < argc; i++) {
+
+		if (strcmp(argv[i], "-cholesky") == 0 && i + 1 < argc)
+			choleskyLimit = (unsigned int)strtoul(argv[++i], nullptr, 10);
+		else
+			sizes.push_back((unsigned int)strtoul(argv[i], nullptr, 10));
+	}
+
+	if (sizes.empty()) {
+
+		sizes.push_back(10000);
+		sizes.push_back(100000);
+		sizes.push_back(1000000);
+		sizes.push_back(5000000);
+	}
+
+	bool ok = true;
+
+	for (size_t i = 0; i < sizes.size(); i++)
+		ok = benchmarkMesh(sizes[i], choleskyLimit) && ok;
+
+	cout << (ok ? "\nsparse matrix benchmark passed\n" : "\nsparse matrix benchmark FAILED\n");
+
+	return ok ? 0 : 1;
+}
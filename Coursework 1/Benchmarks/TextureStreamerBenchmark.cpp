@@ -0,0 +1,133 @@
+//
+// TextureStreamerBenchmark.cpp
+//
+
+// Load latency and memory saved by CGDTextureStreamer on a camera fly-by.  A row of 512 x 512 RGBA textures, each mapped across a 10 unit surface, is passed by a camera at 60 frames per second and every texture within 100 units requests the mip MipForDistance gives for it.  Loads go through CGDFakeStreamingBackend on the job system with a simulated I/O time, so the numbers measure the streamer's scheduling rather than a disk.  Usage: TextureStreamerBenchmark [textures] [frames] [budget KB] [load us].  Reports the update cost, load latency, resident memory against full residency and the detail shortfall (mips below the requested detail, averaged over requested textures).  Returns 1 if the budget is exceeded, a load fails or the backend sees an out of order commit.
+
+#include <stdafx.h>
+#include <CGDClock.h>
+#include <CGDJobSystem.h>
+#include <CGDTextureStreamer.h>
+#include "../Tests/CGDFakeStreamingBackend.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+#include <iostream>
+#include <iomanip>
+
+using namespace std;
+
+
+int main(int argc, char *argv[]) {
+
+	int textures = (argc > 1) ? atoi(argv[1]) : 64;
+	int frames = (argc > 2) ? atoi(argv[2]) : 600;
+	int budgetKB = (argc > 3) ? atoi(argv[3]) : 8192;
+	int loadMicroseconds = (argc > 4) ? atoi(argv[4]) : 2000;
+
+	if (textures <= 0 || frames <= 0 || budgetKB <= 0 || loadMicroseconds < 0) {
+
+		cout << "usage: TextureStreamerBenchmark [textures] [frames] [budget KB] [load us]\n";
+		return 1;
+	}
+
+	const float spacing = 10.0f;
+	const float viewDistance = 100.0f;
+	const float fovY = 0.25f * 3.14159265f;
+	const float viewportHeight = 720.0f;
+	const gu_seconds frameTime = 1.0 / 60.0;
+
+	uint32_t workers = max(thread::hardware_concurrency(), 2u) - 1;
+	CGDJobSystem *jobSystem = CGDJobSystem::CreateJobSystem(workers);
+	CGDFakeStreamingBackend *backend = CGDFakeStreamingBackend::CreateFakeStreamingBackend((uint32_t)loadMicroseconds);
+	CGDTextureStreamer *streamer = (jobSystem) ? CGDTextureStreamer::CreateTextureStreamer(backend, (size_t)budgetKB * 1024, jobSystem) : nullptr;
+
+	if (!streamer)
+		return 1;
+
+	vector<uint32_t> ids;
+
+	for (int i = 0; i < textures; i++) {
+
+		CGDStreamedTextureDesc desc;
+		void *texture = backend->createTexture(512, 512, 4, desc);
+
+		ids.push_back(streamer->registerTexture(desc, texture));
+
+		if (ids.back() == CGD_INVALID_STREAMED_TEXTURE)
+			return 1;
+	}
+
+	cout << fixed << setprecision(3);
+	cout << "Texture streamer benchmark: " << textures << " textures, " << frames << " frames, " << budgetKB << " KB budget, " << loadMicroseconds << " us loads, " << workers << " workers\n";
+
+	double updateMs = 0.0, shortfall = 0.0;
+	uint64_t requests = 0;
+	size_t residentSum = 0;
+	bool overBudget = false;
+	float end = spacing * (float)textures;
+
+	for (int f = 0; f < frames; f++) {
+
+		gu_time_index frameStart = CGDClock::ActualTime();
+		float camera = end * (float)f / (float)frames;
+
+		for (int i = 0; i < textures; i++) {
+
+			float distance = fabsf(spacing * (float)i - camera) + 1.0f;
+
+			if (distance > viewDistance)
+				continue;
+
+			const CGDStreamedTextureDesc& desc = streamer->getDesc(ids[i]);
+			uint32_t mip = CGDTextureStreamer::MipForDistance(desc.width, desc.height, spacing, distance, fovY, viewportHeight);
+
+			streamer->requestMip(ids[i], mip);
+
+			shortfall += (double)(streamer->residentMip(ids[i]) > mip ? streamer->residentMip(ids[i]) - mip : 0);
+			requests++;
+		}
+
+		gu_time_index t = CGDClock::ActualTime();
+
+		streamer->update();
+
+		updateMs += (double)(CGDClock::ActualTime() - t) * 1000.0 / (double)CGDClock::ActualTimeFrequency();
+
+		CGDTextureStreamerStats stats = streamer->getStats();
+
+		residentSum += stats.residentBytes;
+		overBudget = overBudget || stats.residentBytes > stats.budgetBytes;
+
+		// Run at 60 frames per second so loads complete over several frames as they would in the application
+		gu_seconds elapsed = (gu_seconds)(CGDClock::ActualTime() - frameStart) / (gu_seconds)CGDClock::ActualTimeFrequency();
+
+		if (elapsed < frameTime)
+			this_thread::sleep_for(chrono::microseconds((long long)((frameTime - elapsed) * 1.0e6)));
+	}
+
+	CGDTextureStreamerStats stats = streamer->getStats();
+	double meanResident = (double)residentSum / (double)frames;
+
+	cout << "\n  update                " << setw(10) << updateMs * 1000.0 / frames << " us per frame\n";
+	cout << "  load latency          " << setw(10) << stats.meanLoadLatency << " ms mean, " << stats.maxLoadLatency << " ms max\n";
+	cout << "  loads                 " << setw(10) << stats.loadsCompleted << " completed, " << stats.loadsFailed << " failed, " << stats.evictions << " evictions, " << backend->maxConcurrentLoads() << " concurrent\n";
+	cout << "  resident (mean)       " << setw(10) << meanResident / 1024.0 << " KB of " << stats.fullResidencyBytes / 1024 << " KB (" << (1.0 - meanResident / (double)stats.fullResidencyBytes) * 100.0 << "% saved)\n";
+	cout << "  resident (peak)       " << setw(10) << (double)stats.peakResidentBytes / 1024.0 << " KB of " << stats.budgetBytes / 1024 << " KB budget\n";
+	cout << "  detail shortfall      " << setw(10) << ((requests > 0) ? shortfall / (double)requests : 0.0) << " mips per request\n\n";
+
+	streamer->reportStats();
+
+	bool ok = !overBudget && stats.peakResidentBytes <= stats.budgetBytes && stats.loadsFailed == 0 && stats.loadsCompleted > 0 && backend->protocolErrorCount() == 0 && backend->residentBytes() == stats.residentBytes;
+
+	streamer->release();
+	backend->release();
+	jobSystem->release();
+
+	cout << (ok ? "\ntexture streamer benchmark passed\n" : "\ntexture streamer benchmark FAILED - budget exceeded, loads failed or commits out of order\n");
+
+	return ok ? 0 : 1;
+}
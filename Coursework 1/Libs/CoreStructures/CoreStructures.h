@@ -15,6 +15,7 @@
 #include "GUQuaternion.h"
 #include "GUDualNumber.h"
 #include "GUDualQuaternion.h"
+#include "GUQuaternionBatch.h"
 #include "GUAxisAngle.h"
 #include "GUPlane.h"
 #include "CGColorRGB.h"
@@ -0,0 +1,832 @@
+//
+// GUQuaternionBatch.h
+//
+
+// Batch (structure-of-arrays) kernels for quaternions and dual quaternions.  GUQuaternion and GUDualQuaternion operate on a single value at a time which is appropriate for cameras and individual transforms but not for animation and skinning where thousands of rotations are processed per frame.  The functions here operate on arrays of components (s[], i[], j[], k[]) and process 4 elements per iteration using SSE with a scalar tail for the remaining (n mod 4) elements.  The scalar code path is also used when SSE is not available.  There is deliberately no AVX (8 wide) path - neither the Visual Studio project nor the CMake build enables AVX code generation (/arch:AVX, -mavx), a header-only library cannot dispatch on the CPU at run time, and the batches processed per frame (bones, skinned vertices) are small enough that SSE is not the bottleneck.  All functions follow the conventions of GUQuaternion / GUDualQuaternion: quaternion multiplication q = a * b performs rotation b followed by rotation a, rotation is v' = q v q* and a unit dual quaternion q = r + εd represents the rigid transform with translation t = 2 d r*
+
+#pragma once
+
+#include "GUMemory.h"
+#include "gu_math.h"
+#include "GUQuaternion.h"
+#include "GUDualQuaternion.h"
+#include <vector>
+#include <cmath>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#define __GU_QUATERNION_BATCH_SSE__
+#include <xmmintrin.h>
+#include <emmintrin.h>
+#endif
+
+
+namespace CoreStructures {
+
+	// SoA view of n quaternions.  The view does not own the component arrays.  Arrays do not need to be 16 byte aligned
+	struct GUQuaternionSoA {
+
+		float			*s, *i, *j, *k;
+
+		GUQuaternionSoA() : s(nullptr), i(nullptr), j(nullptr), k(nullptr) {}
+		GUQuaternionSoA(float *s_, float *i_, float *j_, float *k_) : s(s_), i(i_), j(j_), k(k_) {}
+	};
+
+
+	// SoA view of n dual quaternions <r, d>
+	struct GUDualQuaternionSoA {
+
+		GUQuaternionSoA		r; // real (rotation) part
+		GUQuaternionSoA		d; // dual (translation) part
+
+		GUDualQuaternionSoA() {}
+		GUDualQuaternionSoA(const GUQuaternionSoA& r_, const GUQuaternionSoA& d_) : r(r_), d(d_) {}
+	};
+
+
+	// SoA view of n vectors in R3
+	struct GUVector3SoA {
+
+		float			*x, *y, *z;
+
+		GUVector3SoA() : x(nullptr), y(nullptr), z(nullptr) {}
+		GUVector3SoA(float *x_, float *y_, float *z_) : x(x_), y(y_), z(z_) {}
+	};
+
+
+	// GUQuaternionArray owns the component storage for n quaternions and provides conversion to and from arrays of GUQuaternion (AoS).  Value semantics apply
+	class GUQuaternionArray {
+
+		std::vector<float>		S, I, J, K;
+
+	public:
+
+		GUQuaternionArray() {}
+		explicit GUQuaternionArray(size_t n) : S(n, 1.0f), I(n, 0.0f), J(n, 0.0f), K(n, 0.0f) {} // initialise n multiplicative identity quaternions
+
+		size_t size() const { return S.size(); }
+		void resize(size_t n) { S.resize(n, 1.0f); I.resize(n, 0.0f); J.resize(n, 0.0f); K.resize(n, 0.0f); }
+
+		GUQuaternionSoA soa() { return GUQuaternionSoA(S.data(), I.data(), J.data(), K.data()); }
+
+		void gather(const GUQuaternion *q, size_t n); // resize to n and copy from AoS array q
+		void scatter(GUQuaternion *q) const; // copy to AoS array q.  q is assumed to have size() elements
+
+		GUQuaternion operator[](size_t index) const { return GUQuaternion(S[index], I[index], J[index], K[index]); }
+		void set(size_t index, const GUQuaternion& q) { S[index] = q.s; I[index] = q.i; J[index] = q.j; K[index] = q.k; }
+	};
+
+
+	// GUDualQuaternionArray owns the component storage for n dual quaternions.  Value semantics apply
+	class GUDualQuaternionArray {
+
+		GUQuaternionArray		R, D;
+
+	public:
+
+		GUDualQuaternionArray() {}
+		explicit GUDualQuaternionArray(size_t n) : R(n), D(n) { for (size_t index = 0; index < n; index++) D.set(index, GUQuaternion(0.0f, 0.0f, 0.0f, 0.0f)); } // initialise n multiplicative identity dual quaternions
+
+		size_t size() const { return R.size(); }
+		void resize(size_t n);
+
+		GUDualQuaternionSoA soa() { return GUDualQuaternionSoA(R.soa(), D.soa()); }
+
+		void gather(const GUDualQuaternion *q, size_t n);
+		void scatter(GUDualQuaternion *q) const;
+	};
+
+
+
+	//
+	// quaternion batch functions
+	//
+
+	void gu_quat_multiply(const GUQuaternionSoA& a, const GUQuaternionSoA& b, const GUQuaternionSoA& out, size_t n); // out[x] = a[x] * b[x].  out may alias a or b
+
+	void gu_quat_multiply(const GUQuaternion& a, const GUQuaternionSoA& b, const GUQuaternionSoA& out, size_t n); // out[x] = a * b[x] - apply a common parent rotation a
+
+	void gu_quat_normalise(const GUQuaternionSoA& q, size_t n); // normalise q[x] to unit length.  Zero length quaternions are set to the multiplicative identity
+
+	void gu_quat_nlerp(const GUQuaternionSoA& q0, const GUQuaternionSoA& q1, float t, const GUQuaternionSoA& out, size_t n); // normalised linear interpolation between q0[x] and q1[x] along the shortest arc (q1[x] is negated where q0[x].q1[x] < 0).  out may alias q0 or q1
+
+	void gu_quat_slerp(const GUQuaternionSoA& q0, const GUQuaternionSoA& q1, float t, const GUQuaternionSoA& out, size_t n); // spherical linear interpolation between unit quaternions q0[x] and q1[x] along the shortest arc.  acos and sin are evaluated with polynomial approximations (max. angular error ~1e-6 radians) and nlerp is used where q0[x] and q1[x] are nearly coincident.  out may alias q0 or q1
+
+	void gu_quat_slerp(const GUQuaternionSoA& q0, const GUQuaternionSoA& q1, const float *t, const GUQuaternionSoA& out, size_t n); // slerp with per-element interpolation parameter t[x]
+
+	void gu_quat_rotate(const GUQuaternion& q, const GUVector3SoA& v, const GUVector3SoA& out, size_t n); // out[x] = q v[x] q* - rotate n vectors by unit quaternion q.  out may alias v
+
+	void gu_quat_rotate(const GUQuaternionSoA& q, const GUVector3SoA& v, const GUVector3SoA& out, size_t n); // out[x] = q[x] v[x] q[x]* - rotate each vector by its own unit quaternion.  out may alias v
+
+
+
+	//
+	// dual quaternion batch functions
+	//
+
+	void gu_dualquat_multiply(const GUDualQuaternionSoA& a, const GUDualQuaternionSoA& b, const GUDualQuaternionSoA& out, size_t n); // out[x] = a[x] * b[x] = ra rb + ε(ra db + da rb).  This performs transformation b[x] followed by a[x].  out must not alias a or b
+
+	void gu_dualquat_blend(const GUDualQuaternion *bones, const unsigned int *boneIndices, const float *weights, unsigned int influences, const GUDualQuaternionSoA& out, size_t n); // dual quaternion linear blending (DLB - see Kavan et al. 2008).  For each element x the unit dual quaternions bones[boneIndices[x * influences + b]] are blended with weights[x * influences + b] for b = [0, influences) and the result is normalised.  Bones are aligned to the hemisphere of the first influence so antipodal rotations blend correctly
+
+	void gu_dualquat_blend(const GUDualQuaternionSoA& bones, const unsigned int *boneIndices, const float *weights, unsigned int influences, const GUDualQuaternionSoA& out, size_t n); // dual quaternion linear blending with the bones held in SoA form
+
+	void gu_dualquat_transform(const GUDualQuaternionSoA& q, const GUVector3SoA& p, const GUVector3SoA& out, size_t n); // out[x] = transform point p[x] by unit dual quaternion q[x] ie. r p r* + t where t = 2 d r*.  out may alias p
+
+	void gu_dualquat_transform_normal(const GUDualQuaternionSoA& q, const GUVector3SoA& v, const GUVector3SoA& out, size_t n); // out[x] = rotate direction v[x] by the real part of q[x] (translation is ignored).  out may alias v
+}
+
+
+
+//
+// implementation
+//
+
+namespace CoreStructures {
+
+	namespace gu_batch_internal {
+
+		// scalar reference kernels - used for the (n mod 4) tail and when SSE is not available
+
+		inline void mul(float as, float ai, float aj, float ak, float bs, float bi, float bj, float bk, float *s, float *i, float *j, float *k) {
+
+			*s = as*bs - ai*bi - aj*bj - ak*bk;
+			*i = as*bi + ai*bs + aj*bk - ak*bj;
+			*j = as*bj - ai*bk + aj*bs + ak*bi;
+			*k = as*bk + ai*bj - aj*bi + ak*bs;
+		}
+
+		// v' = v + s * t + u x t where t = 2 (u x v) and u = <i, j, k>
+		inline void rotate(float qs, float qi, float qj, float qk, float vx, float vy, float vz, float *x, float *y, float *z) {
+
+			float tx = 2.0f * (qj*vz - qk*vy);
+			float ty = 2.0f * (qk*vx - qi*vz);
+			float tz = 2.0f * (qi*vy - qj*vx);
+
+			*x = vx + qs*tx + (qj*tz - qk*ty);
+			*y = vy + qs*ty + (qk*tx - qi*tz);
+			*z = vz + qs*tz + (qi*ty - qj*tx);
+		}
+
+		// polynomial acos for x in [0, 1] (Abramowitz and Stegun 4.4.46, |error| <= 2e-8)
+		inline float acos01(float x) {
+
+			float p = -0.0012624911f;
+			p = p * x + 0.0066700901f;
+			p = p * x - 0.0170881256f;
+			p = p * x + 0.0308918810f;
+			p = p * x - 0.0501743046f;
+			p = p * x + 0.0889789874f;
+			p = p * x - 0.2145988016f;
+			p = p * x + 1.5707963050f;
+
+			return p * sqrtf(1.0f - x);
+		}
+
+		// polynomial sin for x in [0, pi/2] (Taylor series to x^11)
+		inline float sin0pi2(float x) {
+
+			float x2 = x * x;
+			float p = -2.5052108e-8f;
+			p = p * x2 + 2.7557319e-6f;
+			p = p * x2 - 1.9841270e-4f;
+			p = p * x2 + 8.3333333e-3f;
+			p = p * x2 - 1.6666667e-1f;
+
+			return x + x * x2 * p;
+		}
+
+		// slerp / nlerp threshold - above this cos(theta) slerp weights degenerate and nlerp is used
+		static const float slerp_nlerp_threshold = 0.9995f;
+
+		inline void slerp(float as, float ai, float aj, float ak, float bs, float bi, float bj, float bk, float t, float *s, float *i, float *j, float *k) {
+
+			float c = as*bs + ai*bi + aj*bj + ak*bk;
+			float sign = 1.0f;
+
+			if (c < 0.0f) {
+
+				c = -c;
+				sign = -1.0f;
+			}
+
+			float c0, c1;
+
+			if (c > slerp_nlerp_threshold) {
+
+				c0 = 1.0f - t;
+				c1 = t * sign;
+			}
+			else {
+
+				float theta = acos01(c);
+				float invSinTheta = 1.0f / sqrtf(1.0f - c*c);
+
+				c0 = sin0pi2((1.0f - t) * theta) * invSinTheta;
+				c1 = sin0pi2(t * theta) * invSinTheta * sign;
+			}
+
+			float rs = c0*as + c1*bs, ri = c0*ai + c1*bi, rj = c0*aj + c1*bj, rk = c0*ak + c1*bk;
+			float l2 = rs*rs + ri*ri + rj*rj + rk*rk;
+			float inv = (l2 > 0.0f) ? 1.0f / sqrtf(l2) : 0.0f;
+
+			*s = rs * inv; *i = ri * inv; *j = rj * inv; *k = rk * inv;
+		}
+
+
+#ifdef __GU_QUATERNION_BATCH_SSE__
+
+		inline __m128 madd(__m128 a, __m128 b, __m128 c) {
+
+			return _mm_add_ps(_mm_mul_ps(a, b), c);
+		}
+
+		// 1/sqrt(x) with one Newton-Raphson step on the _mm_rsqrt_ps estimate (~23 bits)
+		inline __m128 rsqrt(__m128 x) {
+
+			__m128 y = _mm_rsqrt_ps(x);
+			__m128 yyx = _mm_mul_ps(_mm_mul_ps(y, y), x);
+
+			return _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(0.5f), y), _mm_sub_ps(_mm_set1_ps(3.0f), yyx));
+		}
+
+		inline void mul(__m128 as, __m128 ai, __m128 aj, __m128 ak, __m128 bs, __m128 bi, __m128 bj, __m128 bk, __m128 *s, __m128 *i, __m128 *j, __m128 *k) {
+
+			*s = _mm_sub_ps(_mm_sub_ps(_mm_mul_ps(as, bs), _mm_mul_ps(ai, bi)), _mm_add_ps(_mm_mul_ps(aj, bj), _mm_mul_ps(ak, bk)));
+			*i = _mm_add_ps(_mm_add_ps(_mm_mul_ps(as, bi), _mm_mul_ps(ai, bs)), _mm_sub_ps(_mm_mul_ps(aj, bk), _mm_mul_ps(ak, bj)));
+			*j = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(as, bj), _mm_mul_ps(ai, bk)), _mm_add_ps(_mm_mul_ps(aj, bs), _mm_mul_ps(ak, bi)));
+			*k = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(as, bk), _mm_mul_ps(aj, bi)), _mm_add_ps(_mm_mul_ps(ai, bj), _mm_mul_ps(ak, bs)));
+		}
+
+		inline void rotate(__m128 qs, __m128 qi, __m128 qj, __m128 qk, __m128 vx, __m128 vy, __m128 vz, __m128 *x, __m128 *y, __m128 *z) {
+
+			__m128 two = _mm_set1_ps(2.0f);
+			__m128 tx = _mm_mul_ps(two, _mm_sub_ps(_mm_mul_ps(qj, vz), _mm_mul_ps(qk, vy)));
+			__m128 ty = _mm_mul_ps(two, _mm_sub_ps(_mm_mul_ps(qk, vx), _mm_mul_ps(qi, vz)));
+			__m128 tz = _mm_mul_ps(two, _mm_sub_ps(_mm_mul_ps(qi, vy), _mm_mul_ps(qj, vx)));
+
+			*x = _mm_add_ps(madd(qs, tx, vx), _mm_sub_ps(_mm_mul_ps(qj, tz), _mm_mul_ps(qk, ty)));
+			*y = _mm_add_ps(madd(qs, ty, vy), _mm_sub_ps(_mm_mul_ps(qk, tx), _mm_mul_ps(qi, tz)));
+			*z = _mm_add_ps(madd(qs, tz, vz), _mm_sub_ps(_mm_mul_ps(qi, ty), _mm_mul_ps(qj, tx)));
+		}
+
+		inline __m128 acos01(__m128 x) {
+
+			__m128 p = _mm_set1_ps(-0.0012624911f);
+			p = madd(p, x, _mm_set1_ps(0.0066700901f));
+			p = madd(p, x, _mm_set1_ps(-0.0170881256f));
+			p = madd(p, x, _mm_set1_ps(0.0308918810f));
+			p = madd(p, x, _mm_set1_ps(-0.0501743046f));
+			p = madd(p, x, _mm_set1_ps(0.0889789874f));
+			p = madd(p, x, _mm_set1_ps(-0.2145988016f));
+			p = madd(p, x, _mm_set1_ps(1.5707963050f));
+
+			return _mm_mul_ps(p, _mm_sqrt_ps(_mm_max_ps(_mm_sub_ps(_mm_set1_ps(1.0f), x), _mm_setzero_ps())));
+		}
+
+		inline __m128 sin0pi2(__m128 x) {
+
+			__m128 x2 = _mm_mul_ps(x, x);
+			__m128 p = _mm_set1_ps(-2.5052108e-8f);
+			p = madd(p, x2, _mm_set1_ps(2.7557319e-6f));
+			p = madd(p, x2, _mm_set1_ps(-1.9841270e-4f));
+			p = madd(p, x2, _mm_set1_ps(8.3333333e-3f));
+			p = madd(p, x2, _mm_set1_ps(-1.6666667e-1f));
+
+			return madd(_mm_mul_ps(x, x2), p, x);
+		}
+
+		inline void slerp(__m128 as, __m128 ai, __m128 aj, __m128 ak, __m128 bs, __m128 bi, __m128 bj, __m128 bk, __m128 t, __m128 *s, __m128 *i, __m128 *j, __m128 *k) {
+
+			__m128 one = _mm_set1_ps(1.0f);
+			__m128 signMask = _mm_set1_ps(-0.0f);
+
+			__m128 c = _mm_add_ps(_mm_add_ps(_mm_mul_ps(as, bs), _mm_mul_ps(ai, bi)), _mm_add_ps(_mm_mul_ps(aj, bj), _mm_mul_ps(ak, bk)));
+			__m128 sign = _mm_and_ps(c, signMask); // sign bit of c - used to flip b onto the hemisphere of a
+			c = _mm_andnot_ps(signMask, c);
+
+			__m128 useNlerp = _mm_cmpgt_ps(c, _mm_set1_ps(slerp_nlerp_threshold));
+
+			__m128 theta = acos01(c);
+			__m128 invSinTheta = rsqrt(_mm_max_ps(_mm_sub_ps(one, _mm_mul_ps(c, c)), _mm_set1_ps(1e-12f)));
+			__m128 omt = _mm_sub_ps(one, t);
+
+			__m128 c0 = _mm_mul_ps(sin0pi2(_mm_mul_ps(omt, theta)), invSinTheta);
+			__m128 c1 = _mm_mul_ps(sin0pi2(_mm_mul_ps(t, theta)), invSinTheta);
+
+			c0 = _mm_or_ps(_mm_and_ps(useNlerp, omt), _mm_andnot_ps(useNlerp, c0));
+			c1 = _mm_or_ps(_mm_and_ps(useNlerp, t), _mm_andnot_ps(useNlerp, c1));
+			c1 = _mm_xor_ps(c1, sign);
+
+			__m128 rs = madd(c0, as, _mm_mul_ps(c1, bs));
+			__m128 ri = madd(c0, ai, _mm_mul_ps(c1, bi));
+			__m128 rj = madd(c0, aj, _mm_mul_ps(c1, bj));
+			__m128 rk = madd(c0, ak, _mm_mul_ps(c1, bk));
+
+			__m128 l2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(rs, rs), _mm_mul_ps(ri, ri)), _mm_add_ps(_mm_mul_ps(rj, rj), _mm_mul_ps(rk, rk)));
+			__m128 inv = rsqrt(_mm_max_ps(l2, _mm_set1_ps(1e-30f)));
+
+			*s = _mm_mul_ps(rs, inv); *i = _mm_mul_ps(ri, inv); *j = _mm_mul_ps(rj, inv); *k = _mm_mul_ps(rk, inv);
+		}
+
+#endif
+
+		// bone access for blend - bones are held as an array of GUDualQuaternion or in SoA form.  q = <r.s, r.i, r.j, r.k, d.s, d.i, d.j, d.k>
+
+		inline void bone(const GUDualQuaternion *bones, unsigned int b, float q[8]) {
+
+			const GUDualQuaternion& B = bones[b];
+
+			q[0] = B.r.s; q[1] = B.r.i; q[2] = B.r.j; q[3] = B.r.k;
+			q[4] = B.d.s; q[5] = B.d.i; q[6] = B.d.j; q[7] = B.d.k;
+		}
+
+		inline void bone(const GUDualQuaternionSoA& bones, unsigned int b, float q[8]) {
+
+			q[0] = bones.r.s[b]; q[1] = bones.r.i[b]; q[2] = bones.r.j[b]; q[3] = bones.r.k[b];
+			q[4] = bones.d.s[b]; q[5] = bones.d.i[b]; q[6] = bones.d.j[b]; q[7] = bones.d.k[b];
+		}
+
+
+		template <typename Bones>
+		inline void blend(const Bones& bones, const unsigned int *boneIndices, const float *weights, unsigned int influences, const GUDualQuaternionSoA& out, size_t n) {
+
+			// bone dual quaternions are gathered per element so this is a scalar accumulation followed by a batch normalisation.  Bone counts are small so the gathers hit cache
+			for (size_t x = 0; x < n; x++) {
+
+				const unsigned int *bi = boneIndices + x * influences;
+				const float *bw = weights + x * influences;
+
+				float r0[8];
+				bone(bones, bi[0], r0);
+
+				float rs = 0.0f, ri = 0.0f, rj = 0.0f, rk = 0.0f;
+				float ds = 0.0f, di = 0.0f, dj = 0.0f, dk = 0.0f;
+
+				for (unsigned int b = 0; b < influences; b++) {
+
+					float q[8];
+					float w = bw[b];
+
+					bone(bones, bi[b], q);
+
+					// align q to the hemisphere of the first influence
+					if (q[0]*r0[0] + q[1]*r0[1] + q[2]*r0[2] + q[3]*r0[3] < 0.0f)
+						w = -w;
+
+					rs += w * q[0]; ri += w * q[1]; rj += w * q[2]; rk += w * q[3];
+					ds += w * q[4]; di += w * q[5]; dj += w * q[6]; dk += w * q[7];
+				}
+
+				out.r.s[x] = rs; out.r.i[x] = ri; out.r.j[x] = rj; out.r.k[x] = rk;
+				out.d.s[x] = ds; out.d.i[x] = di; out.d.j[x] = dj; out.d.k[x] = dk;
+			}
+
+			// normalise q = q / ||r||.  The dual part is also projected so <r, d> = 0 (unit dual quaternion constraint)
+			size_t x = 0;
+
+#ifdef __GU_QUATERNION_BATCH_SSE__
+
+			for (; x + 4 <= n; x += 4) {
+
+				__m128 rs = _mm_loadu_ps(out.r.s + x), ri = _mm_loadu_ps(out.r.i + x), rj = _mm_loadu_ps(out.r.j + x), rk = _mm_loadu_ps(out.r.k + x);
+				__m128 ds = _mm_loadu_ps(out.d.s + x), di = _mm_loadu_ps(out.d.i + x), dj = _mm_loadu_ps(out.d.j + x), dk = _mm_loadu_ps(out.d.k + x);
+
+				__m128 l2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(rs, rs), _mm_mul_ps(ri, ri)), _mm_add_ps(_mm_mul_ps(rj, rj), _mm_mul_ps(rk, rk)));
+				__m128 inv = rsqrt(_mm_max_ps(l2, _mm_set1_ps(1e-30f)));
+
+				rs = _mm_mul_ps(rs, inv); ri = _mm_mul_ps(ri, inv); rj = _mm_mul_ps(rj, inv); rk = _mm_mul_ps(rk, inv);
+				ds = _mm_mul_ps(ds, inv); di = _mm_mul_ps(di, inv); dj = _mm_mul_ps(dj, inv); dk = _mm_mul_ps(dk, inv);
+
+				__m128 rd = _mm_add_ps(_mm_add_ps(_mm_mul_ps(rs, ds), _mm_mul_ps(ri, di)), _mm_add_ps(_mm_mul_ps(rj, dj), _mm_mul_ps(rk, dk)));
+
+				_mm_storeu_ps(out.r.s + x, rs); _mm_storeu_ps(out.r.i + x, ri); _mm_storeu_ps(out.r.j + x, rj); _mm_storeu_ps(out.r.k + x, rk);
+				_mm_storeu_ps(out.d.s + x, _mm_sub_ps(ds, _mm_mul_ps(rd, rs)));
+				_mm_storeu_ps(out.d.i + x, _mm_sub_ps(di, _mm_mul_ps(rd, ri)));
+				_mm_storeu_ps(out.d.j + x, _mm_sub_ps(dj, _mm_mul_ps(rd, rj)));
+				_mm_storeu_ps(out.d.k + x, _mm_sub_ps(dk, _mm_mul_ps(rd, rk)));
+			}
+#endif
+
+			for (; x < n; x++) {
+
+				float l2 = out.r.s[x]*out.r.s[x] + out.r.i[x]*out.r.i[x] + out.r.j[x]*out.r.j[x] + out.r.k[x]*out.r.k[x];
+				float inv = (l2 > 0.0f) ? 1.0f / sqrtf(l2) : 0.0f;
+
+				float rs = out.r.s[x] * inv, ri = out.r.i[x] * inv, rj = out.r.j[x] * inv, rk = out.r.k[x] * inv;
+				float ds = out.d.s[x] * inv, di = out.d.i[x] * inv, dj = out.d.j[x] * inv, dk = out.d.k[x] * inv;
+				float rd = rs*ds + ri*di + rj*dj + rk*dk;
+
+				out.r.s[x] = rs; out.r.i[x] = ri; out.r.j[x] = rj; out.r.k[x] = rk;
+				out.d.s[x] = ds - rd*rs; out.d.i[x] = di - rd*ri; out.d.j[x] = dj - rd*rj; out.d.k[x] = dk - rd*rk;
+			}
+		}
+	}
+
+
+
+	//
+	// GUQuaternionArray / GUDualQuaternionArray
+	//
+
+	inline void GUQuaternionArray::gather(const GUQuaternion *q, size_t n) {
+
+		resize(n);
+
+		for (size_t x = 0; x < n; x++)
+			set(x, q[x]);
+	}
+
+
+	inline void GUQuaternionArray::scatter(GUQuaternion *q) const {
+
+		for (size_t x = 0; x < S.size(); x++)
+			q[x].define(S[x], I[x], J[x], K[x]);
+	}
+
+
+	inline void GUDualQuaternionArray::resize(size_t n) {
+
+		size_t n0 = size();
+
+		R.resize(n);
+		D.resize(n);
+
+		for (size_t x = n0; x < n; x++)
+			D.set(x, GUQuaternion(0.0f, 0.0f, 0.0f, 0.0f));
+	}
+
+
+	inline void GUDualQuaternionArray::gather(const GUDualQuaternion *q, size_t n) {
+
+		R.resize(n);
+		D.resize(n);
+
+		for (size_t x = 0; x < n; x++) {
+
+			R.set(x, q[x].r);
+			D.set(x, q[x].d);
+		}
+	}
+
+
+	inline void GUDualQuaternionArray::scatter(GUDualQuaternion *q) const {
+
+		for (size_t x = 0; x < size(); x++)
+			q[x].define(R[x], D[x]);
+	}
+
+
+
+	//
+	// quaternion batch functions
+	//
+
+	inline void gu_quat_multiply(const GUQuaternionSoA& a, const GUQuaternionSoA& b, const GUQuaternionSoA& out, size_t n) {
+
+		size_t x = 0;
+
+#ifdef __GU_QUATERNION_BATCH_SSE__
+
+		for (; x + 4 <= n; x += 4) {
+
+			__m128 s, i, j, k;
+
+			gu_batch_internal::mul(_mm_loadu_ps(a.s + x), _mm_loadu_ps(a.i + x), _mm_loadu_ps(a.j + x), _mm_loadu_ps(a.k + x),
+				_mm_loadu_ps(b.s + x), _mm_loadu_ps(b.i + x), _mm_loadu_ps(b.j + x), _mm_loadu_ps(b.k + x), &s, &i, &j, &k);
+
+			_mm_storeu_ps(out.s + x, s); _mm_storeu_ps(out.i + x, i); _mm_storeu_ps(out.j + x, j); _mm_storeu_ps(out.k + x, k);
+		}
+#endif
+
+		for (; x < n; x++) {
+
+			float s, i, j, k;
+
+			gu_batch_internal::mul(a.s[x], a.i[x], a.j[x], a.k[x], b.s[x], b.i[x], b.j[x], b.k[x], &s, &i, &j, &k);
+			out.s[x] = s; out.i[x] = i; out.j[x] = j; out.k[x] = k;
+		}
+	}
+
+
+	inline void gu_quat_multiply(const GUQuaternion& a, const GUQuaternionSoA& b, const GUQuaternionSoA& out, size_t n) {
+
+		size_t x = 0;
+
+#ifdef __GU_QUATERNION_BATCH_SSE__
+
+		__m128 as = _mm_set1_ps(a.s), ai = _mm_set1_ps(a.i), aj = _mm_set1_ps(a.j), ak = _mm_set1_ps(a.k);
+
+		for (; x + 4 <= n; x += 4) {
+
+			__m128 s, i, j, k;
+
+			gu_batch_internal::mul(as, ai, aj, ak, _mm_loadu_ps(b.s + x), _mm_loadu_ps(b.i + x), _mm_loadu_ps(b.j + x), _mm_loadu_ps(b.k + x), &s, &i, &j, &k);
+
+			_mm_storeu_ps(out.s + x, s); _mm_storeu_ps(out.i + x, i); _mm_storeu_ps(out.j + x, j); _mm_storeu_ps(out.k + x, k);
+		}
+#endif
+
+		for (; x < n; x++) {
+
+			float s, i, j, k;
+
+			gu_batch_internal::mul(a.s, a.i, a.j, a.k, b.s[x], b.i[x], b.j[x], b.k[x], &s, &i, &j, &k);
+			out.s[x] = s; out.i[x] = i; out.j[x] = j; out.k[x] = k;
+		}
+	}
+
+
+	inline void gu_quat_normalise(const GUQuaternionSoA& q, size_t n) {
+
+		size_t x = 0;
+
+#ifdef __GU_QUATERNION_BATCH_SSE__
+
+		__m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f);
+
+		for (; x + 4 <= n; x += 4) {
+
+			__m128 s = _mm_loadu_ps(q.s + x), i = _mm_loadu_ps(q.i + x), j = _mm_loadu_ps(q.j + x), k = _mm_loadu_ps(q.k + x);
+			__m128 l2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(s, s), _mm_mul_ps(i, i)), _mm_add_ps(_mm_mul_ps(j, j), _mm_mul_ps(k, k)));
+
+			__m128 valid = _mm_cmpgt_ps(l2, zero);
+			__m128 inv = _mm_and_ps(valid, gu_batch_internal::rsqrt(_mm_max_ps(l2, _mm_set1_ps(1e-30f))));
+
+			// zero length quaternions become (1, 0, 0, 0)
+			_mm_storeu_ps(q.s + x, _mm_or_ps(_mm_mul_ps(s, inv), _mm_andnot_ps(valid, one)));
+			_mm_storeu_ps(q.i + x, _mm_mul_ps(i, inv));
+			_mm_storeu_ps(q.j + x, _mm_mul_ps(j, inv));
+			_mm_storeu_ps(q.k + x, _mm_mul_ps(k, inv));
+		}
+#endif
+
+		for (; x < n; x++) {
+
+			float l2 = q.s[x]*q.s[x] + q.i[x]*q.i[x] + q.j[x]*q.j[x] + q.k[x]*q.k[x];
+
+			if (l2 > 0.0f) {
+
+				float inv = 1.0f / sqrtf(l2);
+				q.s[x] *= inv; q.i[x] *= inv; q.j[x] *= inv; q.k[x] *= inv;
+			}
+			else {
+
+				q.s[x] = 1.0f; q.i[x] = q.j[x] = q.k[x] = 0.0f;
+			}
+		}
+	}
+
+
+	inline void gu_quat_nlerp(const GUQuaternionSoA& q0, const GUQuaternionSoA& q1, float t, const GUQuaternionSoA& out, size_t n) {
+
+		size_t x = 0;
+
+#ifdef __GU_QUATERNION_BATCH_SSE__
+
+		__m128 t0 = _mm_set1_ps(1.0f - t), t1 = _mm_set1_ps(t), signMask = _mm_set1_ps(-0.0f);
+
+		for (; x + 4 <= n; x += 4) {
+
+			__m128 as = _mm_loadu_ps(q0.s + x), ai = _mm_loadu_ps(q0.i + x), aj = _mm_loadu_ps(q0.j + x), ak = _mm_loadu_ps(q0.k + x);
+			__m128 bs = _mm_loadu_ps(q1.s + x), bi = _mm_loadu_ps(q1.i + x), bj = _mm_loadu_ps(q1.j + x), bk = _mm_loadu_ps(q1.k + x);
+
+			__m128 c = _mm_add_ps(_mm_add_ps(_mm_mul_ps(as, bs), _mm_mul_ps(ai, bi)), _mm_add_ps(_mm_mul_ps(aj, bj), _mm_mul_ps(ak, bk)));
+			__m128 c1 = _mm_xor_ps(t1, _mm_and_ps(c, signMask));
+
+			__m128 s = gu_batch_internal::madd(t0, as, _mm_mul_ps(c1, bs));
+			__m128 i = gu_batch_internal::madd(t0, ai, _mm_mul_ps(c1, bi));
+			__m128 j = gu_batch_internal::madd(t0, aj, _mm_mul_ps(c1, bj));
+			__m128 k = gu_batch_internal::madd(t0, ak, _mm_mul_ps(c1, bk));
+
+			__m128 l2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(s, s), _mm_mul_ps(i, i)), _mm_add_ps(_mm_mul_ps(j, j), _mm_mul_ps(k, k)));
+			__m128 inv = gu_batch_internal::rsqrt(_mm_max_ps(l2, _mm_set1_ps(1e-30f)));
+
+			_mm_storeu_ps(out.s + x, _mm_mul_ps(s, inv)); _mm_storeu_ps(out.i + x, _mm_mul_ps(i, inv)); _mm_storeu_ps(out.j + x, _mm_mul_ps(j, inv)); _mm_storeu_ps(out.k + x, _mm_mul_ps(k, inv));
+		}
+#endif
+
+		for (; x < n; x++) {
+
+			float c = q0.s[x]*q1.s[x] + q0.i[x]*q1.i[x] + q0.j[x]*q1.j[x] + q0.k[x]*q1.k[x];
+			float c0 = 1.0f - t, c1 = (c < 0.0f) ? -t : t;
+
+			float s = c0*q0.s[x] + c1*q1.s[x], i = c0*q0.i[x] + c1*q1.i[x], j = c0*q0.j[x] + c1*q1.j[x], k = c0*q0.k[x] + c1*q1.k[x];
+			float l2 = s*s + i*i + j*j + k*k;
+			float inv = (l2 > 0.0f) ? 1.0f / sqrtf(l2) : 0.0f;
+
+			out.s[x] = s * inv; out.i[x] = i * inv; out.j[x] = j * inv; out.k[x] = k * inv;
+		}
+	}
+
+
+	inline void gu_quat_slerp(const GUQuaternionSoA& q0, const GUQuaternionSoA& q1, const float *t, const GUQuaternionSoA& out, size_t n) {
+
+		size_t x = 0;
+
+#ifdef __GU_QUATERNION_BATCH_SSE__
+
+		for (; x + 4 <= n; x += 4) {
+
+			__m128 s, i, j, k;
+
+			gu_batch_internal::slerp(_mm_loadu_ps(q0.s + x), _mm_loadu_ps(q0.i + x), _mm_loadu_ps(q0.j + x), _mm_loadu_ps(q0.k + x),
+				_mm_loadu_ps(q1.s + x), _mm_loadu_ps(q1.i + x), _mm_loadu_ps(q1.j + x), _mm_loadu_ps(q1.k + x), _mm_loadu_ps(t + x), &s, &i, &j, &k);
+
+			_mm_storeu_ps(out.s + x, s); _mm_storeu_ps(out.i + x, i); _mm_storeu_ps(out.j + x, j); _mm_storeu_ps(out.k + x, k);
+		}
+#endif
+
+		for (; x < n; x++) {
+
+			float s, i, j, k;
+
+			gu_batch_internal::slerp(q0.s[x], q0.i[x], q0.j[x], q0.k[x], q1.s[x], q1.i[x], q1.j[x], q1.k[x], t[x], &s, &i, &j, &k);
+			out.s[x] = s; out.i[x] = i; out.j[x] = j; out.k[x] = k;
+		}
+	}
+
+
+	inline void gu_quat_slerp(const GUQuaternionSoA& q0, const GUQuaternionSoA& q1, float t, const GUQuaternionSoA& out, size_t n) {
+
+		size_t x = 0;
+
+#ifdef __GU_QUATERNION_BATCH_SSE__
+
+		__m128 tv = _mm_set1_ps(t);
+
+		for (; x + 4 <= n; x += 4) {
+
+			__m128 s, i, j, k;
+
+			gu_batch_internal::slerp(_mm_loadu_ps(q0.s + x), _mm_loadu_ps(q0.i + x), _mm_loadu_ps(q0.j + x), _mm_loadu_ps(q0.k + x),
+				_mm_loadu_ps(q1.s + x), _mm_loadu_ps(q1.i + x), _mm_loadu_ps(q1.j + x), _mm_loadu_ps(q1.k + x), tv, &s, &i, &j, &k);
+
+			_mm_storeu_ps(out.s + x, s); _mm_storeu_ps(out.i + x, i); _mm_storeu_ps(out.j + x, j); _mm_storeu_ps(out.k + x, k);
+		}
+#endif
+
+		for (; x < n; x++) {
+
+			float s, i, j, k;
+
+			gu_batch_internal::slerp(q0.s[x], q0.i[x], q0.j[x], q0.k[x], q1.s[x], q1.i[x], q1.j[x], q1.k[x], t, &s, &i, &j, &k);
+			out.s[x] = s; out.i[x] = i; out.j[x] = j; out.k[x] = k;
+		}
+	}
+
+
+	inline void gu_quat_rotate(const GUQuaternion& q, const GUVector3SoA& v, const GUVector3SoA& out, size_t n) {
+
+		size_t x = 0;
+
+#ifdef __GU_QUATERNION_BATCH_SSE__
+
+		__m128 qs = _mm_set1_ps(q.s), qi = _mm_set1_ps(q.i), qj = _mm_set1_ps(q.j), qk = _mm_set1_ps(q.k);
+
+		for (; x + 4 <= n; x += 4) {
+
+			__m128 rx, ry, rz;
+
+			gu_batch_internal::rotate(qs, qi, qj, qk, _mm_loadu_ps(v.x + x), _mm_loadu_ps(v.y + x), _mm_loadu_ps(v.z + x), &rx, &ry, &rz);
+
+			_mm_storeu_ps(out.x + x, rx); _mm_storeu_ps(out.y + x, ry); _mm_storeu_ps(out.z + x, rz);
+		}
+#endif
+
+		for (; x < n; x++) {
+
+			float rx, ry, rz;
+
+			gu_batch_internal::rotate(q.s, q.i, q.j, q.k, v.x[x], v.y[x], v.z[x], &rx, &ry, &rz);
+			out.x[x] = rx; out.y[x] = ry; out.z[x] = rz;
+		}
+	}
+
+
+	inline void gu_quat_rotate(const GUQuaternionSoA& q, const GUVector3SoA& v, const GUVector3SoA& out, size_t n) {
+
+		size_t x = 0;
+
+#ifdef __GU_QUATERNION_BATCH_SSE__
+
+		for (; x + 4 <= n; x += 4) {
+
+			__m128 rx, ry, rz;
+
+			gu_batch_internal::rotate(_mm_loadu_ps(q.s + x), _mm_loadu_ps(q.i + x), _mm_loadu_ps(q.j + x), _mm_loadu_ps(q.k + x),
+				_mm_loadu_ps(v.x + x), _mm_loadu_ps(v.y + x), _mm_loadu_ps(v.z + x), &rx, &ry, &rz);
+
+			_mm_storeu_ps(out.x + x, rx); _mm_storeu_ps(out.y + x, ry); _mm_storeu_ps(out.z + x, rz);
+		}
+#endif
+
+		for (; x < n; x++) {
+
+			float rx, ry, rz;
+
+			gu_batch_internal::rotate(q.s[x], q.i[x], q.j[x], q.k[x], v.x[x], v.y[x], v.z[x], &rx, &ry, &rz);
+			out.x[x] = rx; out.y[x] = ry; out.z[x] = rz;
+		}
+	}
+
+
+
+	//
+	// dual quaternion batch functions
+	//
+
+	inline void gu_dualquat_multiply(const GUDualQuaternionSoA& a, const GUDualQuaternionSoA& b, const GUDualQuaternionSoA& out, size_t n) {
+
+		// out.r = ra rb, out.d = ra db + da rb.  out.d is written last so out.r may be used as scratch
+		gu_quat_multiply(a.r, b.d, out.d, n);
+
+		size_t x = 0;
+
+#ifdef __GU_QUATERNION_BATCH_SSE__
+
+		for (; x + 4 <= n; x += 4) {
+
+			__m128 s, i, j, k;
+
+			gu_batch_internal::mul(_mm_loadu_ps(a.d.s + x), _mm_loadu_ps(a.d.i + x), _mm_loadu_ps(a.d.j + x), _mm_loadu_ps(a.d.k + x),
+				_mm_loadu_ps(b.r.s + x), _mm_loadu_ps(b.r.i + x), _mm_loadu_ps(b.r.j + x), _mm_loadu_ps(b.r.k + x), &s, &i, &j, &k);
+
+			_mm_storeu_ps(out.d.s + x, _mm_add_ps(_mm_loadu_ps(out.d.s + x), s));
+			_mm_storeu_ps(out.d.i + x, _mm_add_ps(_mm_loadu_ps(out.d.i + x), i));
+			_mm_storeu_ps(out.d.j + x, _mm_add_ps(_mm_loadu_ps(out.d.j + x), j));
+			_mm_storeu_ps(out.d.k + x, _mm_add_ps(_mm_loadu_ps(out.d.k + x), k));
+		}
+#endif
+
+		for (; x < n; x++) {
+
+			float s, i, j, k;
+
+			gu_batch_internal::mul(a.d.s[x], a.d.i[x], a.d.j[x], a.d.k[x], b.r.s[x], b.r.i[x], b.r.j[x], b.r.k[x], &s, &i, &j, &k);
+			out.d.s[x] += s; out.d.i[x] += i; out.d.j[x] += j; out.d.k[x] += k;
+		}
+
+		gu_quat_multiply(a.r, b.r, out.r, n);
+	}
+
+
+	inline void gu_dualquat_blend(const GUDualQuaternion *bones, const unsigned int *boneIndices, const float *weights, unsigned int influences, const GUDualQuaternionSoA& out, size_t n) {
+
+		gu_batch_internal::blend(bones, boneIndices, weights, influences, out, n);
+	}
+
+
+	inline void gu_dualquat_blend(const GUDualQuaternionSoA& bones, const unsigned int *boneIndices, const float *weights, unsigned int influences, const GUDualQuaternionSoA& out, size_t n) {
+
+		gu_batch_internal::blend(bones, boneIndices, weights, influences, out, n);
+	}
+
+
+	inline void gu_dualquat_transform(const GUDualQuaternionSoA& q, const GUVector3SoA& p, const GUVector3SoA& out, size_t n) {
+
+		size_t x = 0;
+
+		// t = 2 d r* = 2 (rs du - ds ru + ru x du) where ru = <ri, rj, rk>, du = <di, dj, dk> (vector part of the product - the scalar part is 0 for unit dual quaternions)
+
+#ifdef __GU_QUATERNION_BATCH_SSE__
+
+		__m128 two = _mm_set1_ps(2.0f);
+
+		for (; x + 4 <= n; x += 4) {
+
+			__m128 rs = _mm_loadu_ps(q.r.s + x), ri = _mm_loadu_ps(q.r.i + x), rj = _mm_loadu_ps(q.r.j + x), rk = _mm_loadu_ps(q.r.k + x);
+			__m128 ds = _mm_loadu_ps(q.d.s + x), di = _mm_loadu_ps(q.d.i + x), dj = _mm_loadu_ps(q.d.j + x), dk = _mm_loadu_ps(q.d.k + x);
+
+			__m128 tx = _mm_mul_ps(two, _mm_add_ps(_mm_sub_ps(_mm_mul_ps(rs, di), _mm_mul_ps(ds, ri)), _mm_sub_ps(_mm_mul_ps(rj, dk), _mm_mul_ps(rk, dj))));
+			__m128 ty = _mm_mul_ps(two, _mm_add_ps(_mm_sub_ps(_mm_mul_ps(rs, dj), _mm_mul_ps(ds, rj)), _mm_sub_ps(_mm_mul_ps(rk, di), _mm_mul_ps(ri, dk))));
+			__m128 tz = _mm_mul_ps(two, _mm_add_ps(_mm_sub_ps(_mm_mul_ps(rs, dk), _mm_mul_ps(ds, rk)), _mm_sub_ps(_mm_mul_ps(ri, dj), _mm_mul_ps(rj, di))));
+
+			__m128 vx, vy, vz;
+
+			gu_batch_internal::rotate(rs, ri, rj, rk, _mm_loadu_ps(p.x + x), _mm_loadu_ps(p.y + x), _mm_loadu_ps(p.z + x), &vx, &vy, &vz);
+
+			_mm_storeu_ps(out.x + x, _mm_add_ps(vx, tx)); _mm_storeu_ps(out.y + x, _mm_add_ps(vy, ty)); _mm_storeu_ps(out.z + x, _mm_add_ps(vz, tz));
+		}
+#endif
+
+		for (; x < n; x++) {
+
+			float rs = q.r.s[x], ri = q.r.i[x], rj = q.r.j[x], rk = q.r.k[x];
+			float ds = q.d.s[x], di = q.d.i[x], dj = q.d.j[x], dk = q.d.k[x];
+
+			float tx = 2.0f * (rs*di - ds*ri + rj*dk - rk*dj);
+			float ty = 2.0f * (rs*dj - ds*rj + rk*di - ri*dk);
+			float tz = 2.0f * (rs*dk - ds*rk + ri*dj - rj*di);
+
+			float vx, vy, vz;
+
+			gu_batch_internal::rotate(rs, ri, rj, rk, p.x[x], p.y[x], p.z[x], &vx, &vy, &vz);
+			out.x[x] = vx + tx; out.y[x] = vy + ty; out.z[x] = vz + tz;
+		}
+	}
+
+
+	inline void gu_dualquat_transform_normal(const GUDualQuaternionSoA& q, const GUVector3SoA& v, const GUVector3SoA& out, size_t n) {
+
+		gu_quat_rotate(q.r, v, out, n);
+	}
+}
@@ -5,4 +5,5 @@
 #include "matrix_core.h"
 #include "matrix_complex.h"
 #include "matrix_lsystem.h"
+#include "matrix_sparse.h"
 
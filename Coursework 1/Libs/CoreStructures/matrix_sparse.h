@@ -0,0 +1,1603 @@
+#pragma once
+
+#include "matrix_interface.h"
+#include "GUVector4.h"
+#include <vector>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <cmath>
+
+
+/*
+
+sparse_matrix models an (n x m) real matrix with only the non-zero elements stored in compressed sparse row (CSR) or compressed sparse column (CSC) format.  Indices are zero-based (as with matrix<T>::a_()).  For CSR, ptr[i]..ptr[i+1] index the column indices (idx) and values (val) of row i.  For CSC, ptr[j]..ptr[j+1] index the row indices and values of column j.  Within each row (column) the indices are sorted in ascending order and are unique.  Value semantics apply.
+
+sparse_matrix is intended for the large, sparse linear systems that arise from mesh processing (Laplacian smoothing, least-squares conformal parameterisation etc.) where the dense matrix<T> model is not viable.  It provides...
+
+- construction from (i, j, value) triplets and from triangle connectivity (uniform and cotangent Laplacians)
+- parallel sparse matrix-vector multiplication (SpMV)
+- preconditioned conjugate gradient (PCG) solver for symmetric positive-definite (SPD) systems
+- sparse (up-looking) Cholesky factorisation for SPD systems with approximate minimum degree (AMD) fill-reducing ordering
+
+*/
+
+
+namespace CoreStructures {
+
+
+	//
+	// sparse matrix / solver states
+	//
+
+	typedef enum {gu_sparse_csr = 0, gu_sparse_csc} gu_sparse_format; // sparse storage formats
+	typedef enum {gu_pcg_converged, gu_pcg_max_iterations, gu_pcg_breakdown, gu_pcg_error} gu_pcg_state; // PCG solver states
+	typedef enum {gu_precond_none, gu_precond_jacobi} gu_precond_type; // PCG preconditioner types
+
+
+	// model a single (i, j, value) element used to build a sparse matrix.  Duplicate (i, j) entries are summed when the matrix is built
+	template <typename T>
+	struct sparse_triplet {
+
+		unsigned int		i, j;
+		T					value;
+
+		sparse_triplet() : i(0), j(0), value(T(0)) {}
+		sparse_triplet(unsigned int i_, unsigned int j_, T value_) : i(i_), j(j_), value(value_) {}
+	};
+
+
+	//
+	// gu_parallel_pool - persistent worker threads for the parallel operations below.  The workers are created on first use and sleep between calls, so a parallel operation costs a wake-up rather than creating and joining threads (PCG runs an SpMV and several vector operations every iteration).  One operation runs at a time - an operation started while another is running (from another thread or from inside one of its blocks) is refused and runs on its calling thread instead
+	//
+
+	class gu_parallel_pool {
+
+		std::vector<std::thread>				workers;
+		std::atomic<bool>						busy;
+
+		std::mutex								mutex;
+		std::condition_variable					wake;
+		std::condition_variable					done;
+		const std::function<void(size_t)>		*task; // current operation - task(b) processes block b
+		size_t									numBlocks;
+		std::atomic<size_t>						nextBlock;
+		size_t									running; // workers that have not finished the current operation
+		unsigned long long						generation; // incremented for each operation
+		bool									quit;
+
+		// Take blocks of the current operation until there are none left
+		void processBlocks(const std::function<void(size_t)>& fn, size_t count) {
+
+			for (size_t b = nextBlock.fetch_add(1); b < count; b = nextBlock.fetch_add(1))
+				fn(b);
+		}
+
+		void workerLoop() {
+
+			unsigned long long seen = 0;
+
+			for (;;) {
+
+				const std::function<void(size_t)> *fn;
+				size_t count;
+
+				{
+					std::unique_lock<std::mutex> lock(mutex);
+
+					wake.wait(lock, [&]() { return quit || generation != seen; });
+
+					if (quit)
+						return;
+
+					seen = generation;
+					fn = task;
+					count = numBlocks;
+				}
+
+				processBlocks(*fn, count);
+
+				std::lock_guard<std::mutex> lock(mutex);
+
+				if (--running == 0)
+					done.notify_one();
+			}
+		}
+
+	public:
+
+		// Create a pool of numThreads threads - numThreads - 1 workers and the calling thread
+		explicit gu_parallel_pool(unsigned int numThreads) : busy(false), task(nullptr), numBlocks(0), nextBlock(0), running(0), generation(0), quit(false) {
+
+			for (unsigned int i = 1; i < numThreads; i++)
+				workers.push_back(std::thread([this]() { workerLoop(); }));
+		}
+
+		~gu_parallel_pool() {
+
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				quit = true;
+			}
+
+			wake.notify_all();
+
+			for (auto& w : workers)
+				w.join();
+		}
+
+		gu_parallel_pool(const gu_parallel_pool&) = delete;
+		gu_parallel_pool& operator=(const gu_parallel_pool&) = delete;
+
+		// The pool used by gu_parallel_range - one thread per hardware thread
+		static gu_parallel_pool& instance() {
+
+			static gu_parallel_pool pool(std::max<unsigned int>(1, std::thread::hardware_concurrency()));
+
+			return pool;
+		}
+
+		unsigned int thread_count() const { return (unsigned int)workers.size() + 1; } // workers and the calling thread
+
+		// Run fn(b) for each block b in [0, count) on the workers and the calling thread and return when every block is done.  Return false without running any block if the pool has no workers or is running another operation
+		bool run(size_t count, const std::function<void(size_t)>& fn) {
+
+			if (workers.empty() || busy.exchange(true))
+				return false;
+
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+
+				task = &fn;
+				numBlocks = count;
+				nextBlock.store(0);
+				running = workers.size();
+				generation++;
+			}
+
+			wake.notify_all();
+
+			processBlocks(fn, count);
+
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+
+				done.wait(lock, [&]() { return running == 0; });
+			}
+
+			busy.store(false);
+
+			return true;
+		}
+	};
+
+
+	//
+	// parallel range helper - split [begin, end) into contiguous blocks over the pool's threads (see gu_parallel_pool).  Small ranges, and ranges started while the pool is busy, are processed on the calling thread
+	//
+
+	template <typename Fn>
+	void gu_parallel_range(size_t begin, size_t end, size_t minBlockSize, Fn fn) {
+
+		gu_parallel_pool& pool = gu_parallel_pool::instance();
+		size_t count = (end > begin) ? end - begin : 0;
+		unsigned int numThreads = pool.thread_count();
+
+		if (count < minBlockSize * 2 || numThreads == 1) {
+
+			fn(begin, end);
+			return;
+		}
+
+		numThreads = (unsigned int)std::min<size_t>(numThreads, count / minBlockSize);
+
+		size_t blockSize = (count + numThreads - 1) / numThreads;
+		size_t numBlocks = (count + blockSize - 1) / blockSize;
+
+		std::function<void(size_t)> block = [&](size_t b) {
+
+			size_t b0 = begin + b * blockSize;
+
+			fn(b0, std::min(end, b0 + blockSize));
+		};
+
+		if (!pool.run(numBlocks, block))
+			fn(begin, end);
+	}
+
+
+	//
+	// sparse_matrix<> interface declaration
+	//
+	template <typename T>
+	struct sparse_matrix {
+
+	public:
+
+		static const size_t			parallel_block_size; // minimum number of rows processed per thread in parallel operations
+		static const size_t			parallel_nnz_threshold; // spmv runs on the calling thread below this many stored elements - waking the pool costs more than the product
+
+	private:
+
+		unsigned int				n, m;
+		gu_sparse_format			format;
+
+		std::vector<size_t>			ptr; // row (CSR) or column (CSC) start offsets - order (major + 1)
+		std::vector<unsigned int>	idx; // column (CSR) or row (CSC) indices - order (nnz)
+		std::vector<T>				val; // element values - order (nnz)
+
+	public:
+
+		//
+		// static interface
+		//
+
+		static sparse_matrix<T> identity(unsigned int n); // create and return the (n x n) identity matrix in CSR format
+
+		static sparse_matrix<T> diag(const std::vector<T>& d); // create and return the (n x n) diagonal matrix with d on the leading diagonal where n = d.size()
+
+		static sparse_matrix<T> from_triplets(unsigned int n, unsigned int m, const std::vector<sparse_triplet<T> >& t, gu_sparse_format format = gu_sparse_csr); // build an (n x m) sparse matrix from the given triplets.  Duplicate (i, j) entries are summed and explicit zeros are kept.  Triplets with indices outside (n x m) are ignored
+
+		static sparse_matrix<T> from_dense(const matrix<T>& A, gu_sparse_format format = gu_sparse_csr); // build a sparse matrix from the non-zero elements of A (as determined by tequal<T>(aij, T(0), matrix<T>::precision)).  A NULL sparse matrix is returned if A is a NULL matrix
+
+
+		// constructors
+
+		sparse_matrix(); // null (0 x 0) sparse matrix
+
+		sparse_matrix(unsigned int n_, unsigned int m_, gu_sparse_format format_ = gu_sparse_csr); // empty (all-zero) sparse matrix of order (n_ x m_)
+
+
+		// accessor methods
+
+		bool is_null() const; // return true if n==0 or m==0
+
+		bool is_square() const;
+
+		bool is_symmetric() const; // return true if A^T = A as determined by tequal<T>
+
+		unsigned int rows() const;
+
+		unsigned int columns() const;
+
+		size_t nnz() const; // return the number of stored (structurally non-zero) elements
+
+		gu_sparse_format storage_format() const;
+
+		const std::vector<size_t>& pointers() const { return ptr; }
+		const std::vector<unsigned int>& indices() const { return idx; }
+		const std::vector<T>& values() const { return val; }
+		std::vector<T>& values() { return val; } // allow in-place update of values where the sparsity pattern is unchanged
+
+		T operator()(unsigned int i, unsigned int j) const; // return element a(ij) (zero-indexed).  T(0) is returned for elements that are not stored.  This performs a binary search within row i (CSR) or column j (CSC)
+
+		std::vector<T> diagonal() const; // return the leading diagonal as a vector of order min(n, m)
+
+
+		// conversion methods
+
+		sparse_matrix<T> convert(gu_sparse_format f) const; // return the given matrix stored in format f
+
+		sparse_matrix<T> transpose() const; // return A^T (in the same storage format as A)
+
+		matrix<T> dense() const; // return the dense matrix<T> equivalent.  Intended for testing small systems only
+
+
+		// binary operators
+
+		sparse_matrix<T> operator+(const sparse_matrix<T>& B) const; // return A + B in the storage format of A.  Elements stored in both A and B that cancel exactly are not stored in the result (so A - A has no stored elements).  A NULL matrix is returned if the orders of A and B differ
+
+		sparse_matrix<T> operator-(const sparse_matrix<T>& B) const; // return A - B in the storage format of A (see operator+)
+
+		sparse_matrix<T> operator*(T k) const; // scalar multiplication
+
+		std::vector<T> operator*(const std::vector<T>& x) const; // sparse matrix-vector multiplication y = Ax (see spmv)
+
+		void spmv(const T *x, T *y, T alpha = T(1), T beta = T(0)) const; // y = alpha * Ax + beta * y.  x is assumed to be of order m and y of order n.  CSR matrices are processed in parallel over row blocks.  CSC matrices are processed in parallel over column blocks with per-thread accumulation followed by a parallel reduction.  Matrices with fewer than parallel_nnz_threshold stored elements are processed on the calling thread
+
+
+		// stream IO functions
+		template <typename U>
+		friend std::ostream& operator<<(std::ostream& os, const sparse_matrix<U>& A);
+	};
+
+
+	template <typename T>
+	const size_t sparse_matrix<T>::parallel_block_size = 4096;
+
+	template <typename T>
+	const size_t sparse_matrix<T>::parallel_nnz_threshold = 65536;
+
+
+
+	//
+	// sparse_cholesky<> - sparse Cholesky factorisation PAP^T = LL^T of a real, square, symmetric positive-definite sparse matrix A.  The factorisation is split into a symbolic phase (fill-reducing ordering, elimination tree and column counts) and a numeric phase so the same symbolic analysis can be reused for matrices with the same sparsity pattern (eg. Laplacian systems with a changing time step)
+	//
+	template <typename T>
+	struct sparse_cholesky {
+
+	private:
+
+		unsigned int				n;
+		std::vector<unsigned int>	P; // fill-reducing permutation P[k] = original index of the k'th pivot
+		std::vector<unsigned int>	Pinv; // inverse permutation
+		std::vector<int>			parent; // elimination tree of PAP^T
+		std::vector<size_t>			Lp; // column pointers of L (CSC)
+		std::vector<unsigned int>	Li; // row indices of L
+		std::vector<T>				Lx; // values of L
+		bool						symbolic_ok;
+		bool						numeric_ok;
+
+		sparse_matrix<T> permuted_upper(const sparse_matrix<T>& A) const; // return the upper triangle of PAP^T in CSC format
+
+		int ereach(const sparse_matrix<T>& C, unsigned int k, std::vector<int>& s, std::vector<int>& w) const; // compute the non-zero pattern of row k of L from the elimination tree.  The pattern is returned in s[top..n-1] and top is returned
+
+	public:
+
+		sparse_cholesky();
+
+		gu_cholesky_state analyse(const sparse_matrix<T>& A, bool useAMD = true); // symbolic factorisation of A.  A is assumed square and symmetric.  Only the upper triangle of A is referenced.  If useAMD is false the natural ordering is used
+
+		gu_cholesky_state factorise(const sparse_matrix<T>& A); // numeric factorisation of A.  analyse() must have been called for a matrix with the same sparsity pattern.  gu_cholesky_not_pd is returned if A is not positive-definite
+
+		gu_cholesky_state compute(const sparse_matrix<T>& A, bool useAMD = true); // analyse() followed by factorise()
+
+		std::vector<T> solve(const std::vector<T>& b) const; // solve Ax = b using the factorisation.  An empty vector is returned if the factorisation is not valid or b is not of order n
+
+		size_t nnz_L() const { return Li.size(); } // number of non-zeros in the factor L (including the diagonal)
+
+		const std::vector<unsigned int>& permutation() const { return P; }
+	};
+
+
+
+	//
+	// solver and builder functions
+	//
+
+	template <typename T>
+	std::vector<unsigned int> amd_ordering(const sparse_matrix<T>& A); // return an approximate minimum degree ordering P (P[k] = k'th pivot) for the symmetric sparsity pattern of A + A^T.  A is assumed square.  The diagonal is ignored
+
+	template <typename T>
+	gu_pcg_state pcg_solve(const sparse_matrix<T>& A, const std::vector<T>& b, std::vector<T> *x, gu_precond_type precond = gu_precond_jacobi, T tolerance = T(1e-6), unsigned int maxIterations = 1000, unsigned int *iterations = nullptr, T *residual = nullptr); // solve the SPD system Ax = b using the preconditioned conjugate gradient method.  *x is used as the initial guess if it is of order n, otherwise x is initialised to zero.  Iteration stops when ||r|| / ||b|| <= tolerance.  The number of iterations and the final relative residual are returned in *iterations and *residual if given
+
+	template <typename T>
+	sparse_matrix<T> uniform_laplacian(unsigned int numVertices, const int *faces, unsigned int numFaces); // build the (numVertices x numVertices) uniform (graph) Laplacian L = D - W from triangle connectivity, where faces holds 3 vertex indices per face (compatible with CGFaceVertex arrays) and W(ij) = 1 for each mesh edge (i, j).  L is symmetric positive semi-definite
+
+	template <typename T>
+	sparse_matrix<T> cotangent_laplacian(unsigned int numVertices, const GUVector4 *V, const int *faces, unsigned int numFaces); // build the cotangent Laplacian L = D - W where W(ij) = (cot(alpha_ij) + cot(beta_ij)) / 2 over the angles opposite edge (i, j).  L is symmetric positive semi-definite for Delaunay meshes
+
+	template <typename T>
+	sparse_matrix<T> smoothing_system(const sparse_matrix<T>& L, T lambda); // return the implicit (backward Euler) smoothing system (I + lambda L).  This is SPD for lambda > 0 where L is a positive semi-definite Laplacian
+
+	inline std::ostream& operator<<(std::ostream& os, const gu_pcg_state &s);
+}
+
+
+
+//
+// sparse_matrix<> implementation
+//
+
+namespace CoreStructures {
+
+
+	//
+	// static interface
+	//
+
+	template <typename T>
+	sparse_matrix<T> sparse_matrix<T>::identity(unsigned int n) {
+
+		return diag(std::vector<T>(n, T(1)));
+	}
+
+
+	template <typename T>
+	sparse_matrix<T> sparse_matrix<T>::diag(const std::vector<T>& d) {
+
+		unsigned int n = (unsigned int)d.size();
+		sparse_matrix<T> A(n, n);
+
+		A.idx.resize(n);
+		A.val = d;
+
+		for (unsigned int i = 0; i < n; i++) {
+
+			A.ptr[i + 1] = i + 1;
+			A.idx[i] = i;
+		}
+
+		return A;
+	}
+
+
+	template <typename T>
+	sparse_matrix<T> sparse_matrix<T>::from_triplets(unsigned int n, unsigned int m, const std::vector<sparse_triplet<T> >& t, gu_sparse_format format) {
+
+		sparse_matrix<T> A(n, m, format);
+
+		if (A.is_null())
+			return A;
+
+		bool csr = (format == gu_sparse_csr);
+		unsigned int major = csr ? n : m;
+
+		// count entries per major index (counting sort - triplets are distributed in O(nnz))
+		std::vector<size_t> count(major + 1, 0);
+
+		for (auto& e : t) {
+
+			if (e.i < n && e.j < m)
+				count[(csr ? e.i : e.j) + 1]++;
+		}
+
+		for (unsigned int k = 0; k < major; k++)
+			count[k + 1] += count[k];
+
+		std::vector<unsigned int> tidx(count[major]);
+		std::vector<T> tval(count[major]);
+		std::vector<size_t> next(count.begin(), count.end() - 1);
+
+		for (auto& e : t) {
+
+			if (e.i < n && e.j < m) {
+
+				size_t p = next[csr ? e.i : e.j]++;
+				tidx[p] = csr ? e.j : e.i;
+				tval[p] = e.value;
+			}
+		}
+
+		// sort each major slice by minor index and sum duplicates
+		A.idx.reserve(tidx.size());
+		A.val.reserve(tval.size());
+
+		std::vector<std::pair<unsigned int, T> > slice;
+
+		for (unsigned int k = 0; k < major; k++) {
+
+			slice.clear();
+
+			for (size_t p = count[k]; p < count[k + 1]; p++)
+				slice.push_back(std::make_pair(tidx[p], tval[p]));
+
+			std::sort(slice.begin(), slice.end(), [](const std::pair<unsigned int, T>& a, const std::pair<unsigned int, T>& b) { return a.first < b.first; });
+
+			for (size_t p = 0; p < slice.size(); p++) {
+
+				if (p > 0 && slice[p].first == slice[p - 1].first)
+					A.val.back() += slice[p].second;
+				else {
+
+					A.idx.push_back(slice[p].first);
+					A.val.push_back(slice[p].second);
+				}
+			}
+
+			A.ptr[k + 1] = A.idx.size();
+		}
+
+		return A;
+	}
+
+
+	template <typename T>
+	sparse_matrix<T> sparse_matrix<T>::from_dense(const matrix<T>& A, gu_sparse_format format) {
+
+		if (A.is_null())
+			return sparse_matrix<T>();
+
+		std::vector<sparse_triplet<T> > t;
+
+		for (unsigned int j = 1; j <= A.columns(); j++) {
+
+			for (unsigned int i = 1; i <= A.rows(); i++) {
+
+				T aij = A(i, j);
+
+				if (!tequal<T>(aij, T(0), matrix<T>::precision))
+					t.push_back(sparse_triplet<T>(i - 1, j - 1, aij));
+			}
+		}
+
+		return from_triplets(A.rows(), A.columns(), t, format);
+	}
+
+
+
+	//
+	// constructors
+	//
+
+	template <typename T>
+	sparse_matrix<T>::sparse_matrix() : n(0), m(0), format(gu_sparse_csr), ptr(1, 0) {
+	}
+
+
+	template <typename T>
+	sparse_matrix<T>::sparse_matrix(unsigned int n_, unsigned int m_, gu_sparse_format format_) : n(n_), m(m_), format(format_) {
+
+		if (n == 0 || m == 0)
+			n = m = 0;
+
+		ptr.assign(((format == gu_sparse_csr) ? n : m) + 1, 0);
+	}
+
+
+
+	//
+	// accessor methods
+	//
+
+	template <typename T>
+	bool sparse_matrix<T>::is_null() const {
+
+		return n == 0 || m == 0;
+	}
+
+
+	template <typename T>
+	bool sparse_matrix<T>::is_square() const {
+
+		return !is_null() && n == m;
+	}
+
+
+	template <typename T>
+	bool sparse_matrix<T>::is_symmetric() const {
+
+		if (!is_square())
+			return false;
+
+		sparse_matrix<T> At = transpose();
+
+		if (At.idx != idx)
+			return false;
+
+		for (size_t p = 0; p < val.size(); p++) {
+
+			if (!tequal<T>(val[p], At.val[p], matrix<T>::precision))
+				return false;
+		}
+
+		return true;
+	}
+
+
+	template <typename T>
+	unsigned int sparse_matrix<T>::rows() const {
+
+		return n;
+	}
+
+
+	template <typename T>
+	unsigned int sparse_matrix<T>::columns() const {
+
+		return m;
+	}
+
+
+	template <typename T>
+	size_t sparse_matrix<T>::nnz() const {
+
+		return idx.size();
+	}
+
+
+	template <typename T>
+	gu_sparse_format sparse_matrix<T>::storage_format() const {
+
+		return format;
+	}
+
+
+	template <typename T>
+	T sparse_matrix<T>::operator()(unsigned int i, unsigned int j) const {
+
+		if (i >= n || j >= m)
+			return T(0);
+
+		unsigned int major = (format == gu_sparse_csr) ? i : j;
+		unsigned int minor = (format == gu_sparse_csr) ? j : i;
+
+		auto first = idx.begin() + ptr[major];
+		auto last = idx.begin() + ptr[major + 1];
+		auto it = std::lower_bound(first, last, minor);
+
+		return (it != last && *it == minor) ? val[it - idx.begin()] : T(0);
+	}
+
+
+	template <typename T>
+	std::vector<T> sparse_matrix<T>::diagonal() const {
+
+		unsigned int k = std::min(n, m);
+		std::vector<T> d(k, T(0));
+
+		for (unsigned int i = 0; i < k; i++)
+			d[i] = (*this)(i, i);
+
+		return d;
+	}
+
+
+
+	//
+	// conversion methods
+	//
+
+	template <typename T>
+	sparse_matrix<T> sparse_matrix<T>::convert(gu_sparse_format f) const {
+
+		if (f == format)
+			return *this;
+
+		// Re-compress along the other axis.  This is a transpose of the storage arrays so the element (i, j) is unchanged
+		unsigned int major = (format == gu_sparse_csr) ? n : m;
+		unsigned int minor = (format == gu_sparse_csr) ? m : n;
+
+		sparse_matrix<T> B(n, m, f);
+
+		if (is_null())
+			return B;
+
+		B.idx.resize(idx.size());
+		B.val.resize(val.size());
+
+		for (size_t p = 0; p < idx.size(); p++)
+			B.ptr[idx[p] + 1]++;
+
+		for (unsigned int k = 0; k < minor; k++)
+			B.ptr[k + 1] += B.ptr[k];
+
+		std::vector<size_t> next(B.ptr.begin(), B.ptr.end() - 1);
+
+		// processing major slices in order keeps the minor indices of B sorted
+		for (unsigned int k = 0; k < major; k++) {
+
+			for (size_t p = ptr[k]; p < ptr[k + 1]; p++) {
+
+				size_t q = next[idx[p]]++;
+				B.idx[q] = k;
+				B.val[q] = val[p];
+			}
+		}
+
+		return B;
+	}
+
+
+	template <typename T>
+	sparse_matrix<T> sparse_matrix<T>::transpose() const {
+
+		// A^T in the opposite format shares the storage arrays of A
+		sparse_matrix<T> At = *this;
+
+		std::swap(At.n, At.m);
+		At.format = (format == gu_sparse_csr) ? gu_sparse_csc : gu_sparse_csr;
+
+		return At.convert(format);
+	}
+
+
+	template <typename T>
+	matrix<T> sparse_matrix<T>::dense() const {
+
+		if (is_null())
+			return matrix<T>::nullmatrix();
+
+		matrix<T> A = matrix<T>::zeromatrix(n, m);
+		unsigned int major = (format == gu_sparse_csr) ? n : m;
+
+		for (unsigned int k = 0; k < major; k++) {
+
+			for (size_t p = ptr[k]; p < ptr[k + 1]; p++) {
+
+				if (format == gu_sparse_csr)
+					A(k + 1, idx[p] + 1) = val[p];
+				else
+					A(idx[p] + 1, k + 1) = val[p];
+			}
+		}
+
+		return A;
+	}
+
+
+
+	//
+	// binary operators
+	//
+
+	template <typename T>
+	sparse_matrix<T> sparse_matrix<T>::operator+(const sparse_matrix<T>& B_) const {
+
+		if (n != B_.n || m != B_.m)
+			return sparse_matrix<T>();
+
+		const sparse_matrix<T>& B = (B_.format == format) ? B_ : B_.convert(format);
+		sparse_matrix<T> C(n, m, format);
+		unsigned int major = (format == gu_sparse_csr) ? n : m;
+
+		C.idx.reserve(idx.size() + B.idx.size());
+		C.val.reserve(val.size() + B.val.size());
+
+		// merge sorted major slices
+		for (unsigned int k = 0; k < major; k++) {
+
+			size_t p = ptr[k], pEnd = ptr[k + 1];
+			size_t q = B.ptr[k], qEnd = B.ptr[k + 1];
+
+			while (p < pEnd || q < qEnd) {
+
+				if (q == qEnd || (p < pEnd && idx[p] < B.idx[q])) {
+
+					C.idx.push_back(idx[p]);
+					C.val.push_back(val[p++]);
+				}
+				else if (p == pEnd || B.idx[q] < idx[p]) {
+
+					C.idx.push_back(B.idx[q]);
+					C.val.push_back(B.val[q++]);
+				}
+				else {
+
+					T sum = val[p] + B.val[q];
+
+					// drop elements that cancel exactly
+					if (sum != T(0)) {
+
+						C.idx.push_back(idx[p]);
+						C.val.push_back(sum);
+					}
+
+					p++;
+					q++;
+				}
+			}
+
+			C.ptr[k + 1] = C.idx.size();
+		}
+
+		return C;
+	}
+
+
+	template <typename T>
+	sparse_matrix<T> sparse_matrix<T>::operator-(const sparse_matrix<T>& B) const {
+
+		return *this + (B * T(-1));
+	}
+
+
+	template <typename T>
+	sparse_matrix<T> sparse_matrix<T>::operator*(T k) const {
+
+		sparse_matrix<T> B = *this;
+
+		for (auto& v : B.val)
+			v *= k;
+
+		return B;
+	}
+
+
+	template <typename T>
+	std::vector<T> sparse_matrix<T>::operator*(const std::vector<T>& x) const {
+
+		if (is_null() || x.size() != m)
+			return std::vector<T>();
+
+		std::vector<T> y(n, T(0));
+		spmv(x.data(), y.data());
+
+		return y;
+	}
+
+
+	template <typename T>
+	void sparse_matrix<T>::spmv(const T *x, T *y, T alpha, T beta) const {
+
+		if (is_null())
+			return;
+
+		// a single block of every row / column runs on the calling thread
+		bool serial = nnz() < parallel_nnz_threshold;
+		size_t rowBlockSize = (serial) ? std::max<size_t>(n, 1) : parallel_block_size;
+
+		if (format == gu_sparse_csr) {
+
+			// rows are independent so each thread writes a disjoint block of y
+			gu_parallel_range(0, n, rowBlockSize, [&](size_t r0, size_t r1) {
+
+				for (size_t i = r0; i < r1; i++) {
+
+					T sum = T(0);
+
+					for (size_t p = ptr[i]; p < ptr[i + 1]; p++)
+						sum += val[p] * x[idx[p]];
+
+					y[i] = alpha * sum + ((beta == T(0)) ? T(0) : beta * y[i]);
+				}
+			});
+		}
+		else {
+
+			// columns scatter into y so each thread accumulates into a private vector that is reduced afterwards
+			unsigned int numThreads = (serial) ? 1 : gu_parallel_pool::instance().thread_count();
+			size_t numBlocks = std::max<size_t>(1, std::min<size_t>(numThreads, m / parallel_block_size));
+			size_t blockSize = (m + numBlocks - 1) / numBlocks;
+
+			std::vector<std::vector<T> > partial(numBlocks);
+
+			gu_parallel_range(0, numBlocks, 1, [&](size_t b0, size_t b1) {
+
+				for (size_t b = b0; b < b1; b++) {
+
+					partial[b].assign(n, T(0));
+
+					size_t c0 = b * blockSize, c1 = std::min<size_t>(m, c0 + blockSize);
+
+					for (size_t j = c0; j < c1; j++) {
+
+						T xj = x[j];
+
+						for (size_t p = ptr[j]; p < ptr[j + 1]; p++)
+							partial[b][idx[p]] += val[p] * xj;
+					}
+				}
+			});
+
+			gu_parallel_range(0, n, rowBlockSize, [&](size_t r0, size_t r1) {
+
+				for (size_t i = r0; i < r1; i++) {
+
+					T sum = T(0);
+
+					for (size_t b = 0; b < numBlocks; b++)
+						sum += partial[b][i];
+
+					y[i] = alpha * sum + ((beta == T(0)) ? T(0) : beta * y[i]);
+				}
+			});
+		}
+	}
+
+
+	template <typename T>
+	std::ostream& operator<<(std::ostream& os, const sparse_matrix<T>& A) {
+
+		os << "sparse_matrix (" << A.n << " x " << A.m << ") nnz = " << A.nnz() << ((A.format == gu_sparse_csr) ? " [CSR]" : " [CSC]") << std::endl;
+
+		return os;
+	}
+
+
+
+	//
+	// approximate minimum degree ordering
+	//
+
+	// Quotient graph minimum degree ordering using the approximate external degree of Amestoy, Davis and Duff (1996).  Each uneliminated variable i holds a list of adjacent variables (Av[i]) and adjacent elements (Ae[i]).  Eliminating pivot p creates a new element Le[p] = (Av[p] U Le[e] for e in Ae[p]) \ {p} which absorbs the elements in Ae[p].  Aggressive absorption and supervariable detection are not performed, so orderings are somewhat poorer than the reference AMD implementation but fill is still substantially reduced relative to the natural ordering on mesh Laplacians.
+	template <typename T>
+	std::vector<unsigned int> amd_ordering(const sparse_matrix<T>& A) {
+
+		std::vector<unsigned int> P;
+
+		if (!A.is_square())
+			return P;
+
+		const int n = (int)A.rows();
+
+		// symmetric adjacency structure of A + A^T without the diagonal
+		std::vector<std::vector<int> > Av(n), Ae(n), Le(n);
+
+		{
+			const auto& ptr = A.pointers();
+			const auto& idx = A.indices();
+
+			for (int k = 0; k < n; k++) {
+
+				for (size_t p = ptr[k]; p < ptr[k + 1]; p++) {
+
+					int j = (int)idx[p];
+
+					if (j != k) {
+
+						Av[k].push_back(j);
+						Av[j].push_back(k);
+					}
+				}
+			}
+
+			for (int i = 0; i < n; i++) {
+
+				std::sort(Av[i].begin(), Av[i].end());
+				Av[i].erase(std::unique(Av[i].begin(), Av[i].end()), Av[i].end());
+			}
+		}
+
+		// degree buckets (doubly linked lists per degree)
+		std::vector<int> degree(n), head(n + 1, -1), next(n, -1), prev(n, -1);
+		std::vector<char> eliminated(n, 0);
+		std::vector<int> w(n, -1); // per-element |Le \ Lp| workspace
+		std::vector<int> mark(n, -1);
+
+		auto bucketInsert = [&](int i) {
+
+			int d = degree[i];
+			next[i] = head[d];
+			prev[i] = -1;
+
+			if (head[d] != -1)
+				prev[head[d]] = i;
+
+			head[d] = i;
+		};
+
+		auto bucketRemove = [&](int i) {
+
+			if (prev[i] != -1)
+				next[prev[i]] = next[i];
+			else
+				head[degree[i]] = next[i];
+
+			if (next[i] != -1)
+				prev[next[i]] = prev[i];
+		};
+
+		for (int i = 0; i < n; i++) {
+
+			degree[i] = (int)Av[i].size();
+			bucketInsert(i);
+		}
+
+		P.reserve(n);
+
+		int minDegree = 0;
+		std::vector<int> Lp;
+
+		for (int k = 0; k < n; k++) {
+
+			// select pivot of minimum approximate degree
+			while (minDegree < n && head[minDegree] == -1)
+				minDegree++;
+
+			int p = head[minDegree];
+			bucketRemove(p);
+
+			eliminated[p] = 1;
+			P.push_back((unsigned int)p);
+
+			// construct new element Lp = (Av[p] U Le[e in Ae[p]]) \ {p}
+			Lp.clear();
+			mark[p] = k;
+
+			for (int j : Av[p]) {
+
+				if (!eliminated[j] && mark[j] != k) {
+
+					mark[j] = k;
+					Lp.push_back(j);
+				}
+			}
+
+			for (int e : Ae[p]) {
+
+				for (int j : Le[e]) {
+
+					if (!eliminated[j] && mark[j] != k) {
+
+						mark[j] = k;
+						Lp.push_back(j);
+					}
+				}
+
+				// element e is absorbed into p
+				Le[e].clear();
+				Le[e].shrink_to_fit();
+			}
+
+			std::vector<int> absorbed;
+			absorbed.swap(Ae[p]);
+			Av[p].clear();
+			Av[p].shrink_to_fit();
+
+			Le[p] = Lp;
+
+			// compute |Le \ Lp| for each element adjacent to a variable in Lp
+			for (int i : Lp) {
+
+				for (int e : Ae[i]) {
+
+					if (Le[e].empty())
+						continue;
+
+					if (w[e] < 0)
+						w[e] = (int)Le[e].size();
+
+					w[e]--;
+				}
+			}
+
+			// update adjacency and approximate degree of each variable in Lp
+			for (int i : Lp) {
+
+				bucketRemove(i);
+
+				// prune eliminated / absorbed elements and add the new element p
+				auto& E = Ae[i];
+				size_t out = 0;
+
+				for (size_t q = 0; q < E.size(); q++) {
+
+					if (!Le[E[q]].empty())
+						E[out++] = E[q];
+				}
+
+				E.resize(out);
+				E.push_back(p);
+
+				// variables in Lp are now reached through element p so remove them (and p) from Av[i]
+				auto& V = Av[i];
+				out = 0;
+
+				for (size_t q = 0; q < V.size(); q++) {
+
+					int j = V[q];
+
+					if (!eliminated[j] && mark[j] != k)
+						V[out++] = j;
+				}
+
+				V.resize(out);
+
+				// approximate external degree
+				long long d = (long long)V.size() + (long long)Lp.size() - 1;
+
+				for (int e : E) {
+
+					if (e != p)
+						d += (w[e] >= 0) ? w[e] : (int)Le[e].size();
+				}
+
+				degree[i] = (int)std::min<long long>(d, n - k - 1);
+				bucketInsert(i);
+
+				if (degree[i] < minDegree)
+					minDegree = degree[i];
+			}
+
+			// reset element workspace
+			for (int i : Lp) {
+
+				for (int e : Ae[i])
+					w[e] = -1;
+			}
+		}
+
+		return P;
+	}
+
+
+
+	//
+	// sparse_cholesky<> implementation
+	//
+
+	template <typename T>
+	sparse_cholesky<T>::sparse_cholesky() : n(0), symbolic_ok(false), numeric_ok(false) {
+	}
+
+
+	template <typename T>
+	sparse_matrix<T> sparse_cholesky<T>::permuted_upper(const sparse_matrix<T>& A) const {
+
+		// C = upper triangle of PAP^T.  Element a(ij) maps to c(Pinv[i], Pinv[j]).  Only the upper triangle of A is referenced so both triangles are read and the lower triangle is ignored
+		std::vector<sparse_triplet<T> > t;
+		const auto& ptr = A.pointers();
+		const auto& idx = A.indices();
+		const auto& val = A.values();
+		bool csr = (A.storage_format() == gu_sparse_csr);
+
+		t.reserve(idx.size() / 2 + n);
+
+		for (unsigned int k = 0; k < n; k++) {
+
+			for (size_t p = ptr[k]; p < ptr[k + 1]; p++) {
+
+				unsigned int i = csr ? k : idx[p];
+				unsigned int j = csr ? idx[p] : k;
+
+				if (i > j)
+					continue;
+
+				unsigned int i2 = Pinv[i], j2 = Pinv[j];
+
+				t.push_back(sparse_triplet<T>(std::min(i2, j2), std::max(i2, j2), val[p]));
+			}
+		}
+
+		return sparse_matrix<T>::from_triplets(n, n, t, gu_sparse_csc);
+	}
+
+
+	template <typename T>
+	int sparse_cholesky<T>::ereach(const sparse_matrix<T>& C, unsigned int k, std::vector<int>& s, std::vector<int>& w) const {
+
+		const auto& Cp = C.pointers();
+		const auto& Ci = C.indices();
+
+		int top = (int)n;
+
+		w[k] = (int)k; // mark node k as visited
+
+		for (size_t p = Cp[k]; p < Cp[k + 1]; p++) {
+
+			int i = (int)Ci[p];
+
+			if (i > (int)k)
+				continue;
+
+			// traverse up the elimination tree from i until a marked node is reached
+			int len = 0;
+
+			for (; w[i] != (int)k; i = parent[i]) {
+
+				s[len++] = i;
+				w[i] = (int)k;
+			}
+
+			// push path onto the output stack
+			while (len > 0)
+				s[--top] = s[--len];
+		}
+
+		return top;
+	}
+
+
+	template <typename T>
+	gu_cholesky_state sparse_cholesky<T>::analyse(const sparse_matrix<T>& A, bool useAMD) {
+
+		symbolic_ok = numeric_ok = false;
+
+		if (!A.is_square())
+			return gu_cholesky_error;
+
+		n = A.rows();
+
+		if (useAMD)
+			P = amd_ordering(A);
+		else {
+
+			P.resize(n);
+
+			for (unsigned int i = 0; i < n; i++)
+				P[i] = i;
+		}
+
+		Pinv.resize(n);
+
+		for (unsigned int k = 0; k < n; k++)
+			Pinv[P[k]] = k;
+
+		sparse_matrix<T> C = permuted_upper(A);
+		const auto& Cp = C.pointers();
+		const auto& Ci = C.indices();
+
+		// elimination tree (Liu) with path compression via ancestor array
+		parent.assign(n, -1);
+		std::vector<int> ancestor(n, -1);
+
+		for (unsigned int k = 0; k < n; k++) {
+
+			for (size_t p = Cp[k]; p < Cp[k + 1]; p++) {
+
+				int inext;
+
+				for (int i = (int)Ci[p]; i != -1 && i < (int)k; i = inext) {
+
+					inext = ancestor[i];
+					ancestor[i] = (int)k;
+
+					if (inext == -1)
+						parent[i] = (int)k;
+				}
+			}
+		}
+
+		// column counts of L from the row patterns (each entry L(k, i) from ereach(k) belongs to column i)
+		std::vector<size_t> colCount(n, 1);
+		std::vector<int> s(n), w(n, -1);
+
+		for (unsigned int k = 0; k < n; k++) {
+
+			for (int top = ereach(C, k, s, w); top < (int)n; top++)
+				colCount[s[top]]++;
+		}
+
+		Lp.assign(n + 1, 0);
+
+		for (unsigned int k = 0; k < n; k++)
+			Lp[k + 1] = Lp[k] + colCount[k];
+
+		Li.resize(Lp[n]);
+		Lx.resize(Lp[n]);
+
+		symbolic_ok = true;
+
+		return gu_cholesky_okay;
+	}
+
+
+	template <typename T>
+	gu_cholesky_state sparse_cholesky<T>::factorise(const sparse_matrix<T>& A) {
+
+		numeric_ok = false;
+
+		if (!symbolic_ok || A.rows() != n || A.columns() != n)
+			return gu_cholesky_error;
+
+		sparse_matrix<T> C = permuted_upper(A);
+		const auto& Cp = C.pointers();
+		const auto& Ci = C.indices();
+		const auto& Cx = C.values();
+
+		std::vector<size_t> c(Lp.begin(), Lp.end() - 1); // next free slot in each column of L
+		std::vector<int> s(n), w(n, -1);
+		std::vector<T> x(n, T(0));
+
+		// up-looking Cholesky - compute row k of L from rows 0..k-1
+		for (unsigned int k = 0; k < n; k++) {
+
+			int top = ereach(C, k, s, w);
+
+			x[k] = T(0);
+
+			for (size_t p = Cp[k]; p < Cp[k + 1]; p++) {
+
+				if (Ci[p] <= k)
+					x[Ci[p]] = Cx[p];
+			}
+
+			T d = x[k];
+			x[k] = T(0);
+
+			for (; top < (int)n; top++) {
+
+				int i = s[top];
+				T lki = x[i] / Lx[Lp[i]]; // L(k, i) = x(i) / L(i, i)
+
+				x[i] = T(0);
+
+				for (size_t p = Lp[i] + 1; p < c[i]; p++)
+					x[Li[p]] -= Lx[p] * lki;
+
+				d -= lki * lki;
+
+				size_t p = c[i]++;
+				Li[p] = k;
+				Lx[p] = lki;
+			}
+
+			if (d <= T(0))
+				return gu_cholesky_not_pd;
+
+			size_t p = c[k]++;
+			Li[p] = k;
+			Lx[p] = std::sqrt(d);
+		}
+
+		numeric_ok = true;
+
+		return gu_cholesky_okay;
+	}
+
+
+	template <typename T>
+	gu_cholesky_state sparse_cholesky<T>::compute(const sparse_matrix<T>& A, bool useAMD) {
+
+		gu_cholesky_state state = analyse(A, useAMD);
+
+		return (state == gu_cholesky_okay) ? factorise(A) : state;
+	}
+
+
+	template <typename T>
+	std::vector<T> sparse_cholesky<T>::solve(const std::vector<T>& b) const {
+
+		if (!numeric_ok || b.size() != n)
+			return std::vector<T>();
+
+		std::vector<T> x(n);
+
+		// x = Pb
+		for (unsigned int k = 0; k < n; k++)
+			x[k] = b[P[k]];
+
+		// Ly = x (forward substitution - L stored by column with the diagonal first)
+		for (unsigned int j = 0; j < n; j++) {
+
+			x[j] /= Lx[Lp[j]];
+
+			for (size_t p = Lp[j] + 1; p < Lp[j + 1]; p++)
+				x[Li[p]] -= Lx[p] * x[j];
+		}
+
+		// L^T z = y (backward substitution)
+		for (int j = (int)n - 1; j >= 0; j--) {
+
+			for (size_t p = Lp[j] + 1; p < Lp[j + 1]; p++)
+				x[j] -= Lx[p] * x[Li[p]];
+
+			x[j] /= Lx[Lp[j]];
+		}
+
+		// result = P^T z
+		std::vector<T> result(n);
+
+		for (unsigned int k = 0; k < n; k++)
+			result[P[k]] = x[k];
+
+		return result;
+	}
+
+
+
+	//
+	// solver functions
+	//
+
+	template <typename T>
+	gu_pcg_state pcg_solve(const sparse_matrix<T>& A, const std::vector<T>& b, std::vector<T> *x, gu_precond_type precond, T tolerance, unsigned int maxIterations, unsigned int *iterations, T *residual) {
+
+		if (!x || !A.is_square() || b.size() != A.rows())
+			return gu_pcg_error;
+
+		const size_t n = A.rows();
+		const size_t blockSize = sparse_matrix<T>::parallel_block_size;
+
+		if (x->size() != n)
+			x->assign(n, T(0));
+
+		// parallel dot product - per-block partial sums are reduced on the calling thread
+		auto dot = [&](const std::vector<T>& u, const std::vector<T>& v) -> T {
+
+			size_t numBlocks = std::max<size_t>(1, n / blockSize);
+			std::vector<T> partial(numBlocks, T(0));
+
+			gu_parallel_range(0, numBlocks, 1, [&](size_t b0, size_t b1) {
+
+				for (size_t blk = b0; blk < b1; blk++) {
+
+					size_t i1 = (blk == numBlocks - 1) ? n : (blk + 1) * blockSize;
+					T sum = T(0);
+
+					for (size_t i = blk * blockSize; i < i1; i++)
+						sum += u[i] * v[i];
+
+					partial[blk] = sum;
+				}
+			});
+
+			T sum = T(0);
+
+			for (auto s : partial)
+				sum += s;
+
+			return sum;
+		};
+
+		// Jacobi preconditioner M^-1 = diag(A)^-1
+		std::vector<T> Minv(n, T(1));
+
+		if (precond == gu_precond_jacobi) {
+
+			std::vector<T> d = A.diagonal();
+
+			for (size_t i = 0; i < n; i++)
+				Minv[i] = (d[i] != T(0)) ? T(1) / d[i] : T(1);
+		}
+
+		std::vector<T> r(n), z(n), p(n), Ap(n);
+
+		// r = b - Ax
+		A.spmv(x->data(), r.data());
+
+		for (size_t i = 0; i < n; i++)
+			r[i] = b[i] - r[i];
+
+		T bNorm = std::sqrt(dot(b, b));
+
+		if (bNorm == T(0))
+			bNorm = T(1);
+
+		for (size_t i = 0; i < n; i++)
+			p[i] = z[i] = Minv[i] * r[i];
+
+		T rz = dot(r, z);
+		T relResidual = std::sqrt(dot(r, r)) / bNorm;
+		gu_pcg_state state = gu_pcg_max_iterations;
+		unsigned int k = 0;
+
+		if (relResidual <= tolerance)
+			state = gu_pcg_converged;
+
+		for (; k < maxIterations && state != gu_pcg_converged; k++) {
+
+			A.spmv(p.data(), Ap.data());
+
+			T pAp = dot(p, Ap);
+
+			if (pAp <= T(0)) {
+
+				// A is not positive definite along p
+				state = gu_pcg_breakdown;
+				break;
+			}
+
+			T alpha = rz / pAp;
+
+			gu_parallel_range(0, n, blockSize, [&](size_t i0, size_t i1) {
+
+				for (size_t i = i0; i < i1; i++) {
+
+					(*x)[i] += alpha * p[i];
+					r[i] -= alpha * Ap[i];
+					z[i] = Minv[i] * r[i];
+				}
+			});
+
+			relResidual = std::sqrt(dot(r, r)) / bNorm;
+
+			if (relResidual <= tolerance) {
+
+				state = gu_pcg_converged;
+				k++;
+				break;
+			}
+
+			T rzNew = dot(r, z);
+			T beta = rzNew / rz;
+
+			rz = rzNew;
+
+			gu_parallel_range(0, n, blockSize, [&](size_t i0, size_t i1) {
+
+				for (size_t i = i0; i < i1; i++)
+					p[i] = z[i] + beta * p[i];
+			});
+		}
+
+		if (iterations)
+			*iterations = k;
+
+		if (residual)
+			*residual = relResidual;
+
+		return state;
+	}
+
+
+
+	//
+	// builder functions
+	//
+
+	template <typename T>
+	sparse_matrix<T> uniform_laplacian(unsigned int numVertices, const int *faces, unsigned int numFaces) {
+
+		if (numVertices == 0 || !faces)
+			return sparse_matrix<T>();
+
+		std::vector<sparse_triplet<T> > t;
+
+		t.reserve(numFaces * 6);
+
+		// each interior edge is shared by 2 faces so edge weights are accumulated as 1/2 per face-edge.  Boundary edges are clamped to 1 below
+		for (unsigned int f = 0; f < numFaces; f++) {
+
+			const int *v = faces + f * 3;
+
+			for (int e = 0; e < 3; e++) {
+
+				unsigned int i = (unsigned int)v[e], j = (unsigned int)v[(e + 1) % 3];
+
+				if (i < numVertices && j < numVertices && i != j) {
+
+					t.push_back(sparse_triplet<T>(i, j, T(1)));
+					t.push_back(sparse_triplet<T>(j, i, T(1)));
+				}
+			}
+		}
+
+		sparse_matrix<T> W = sparse_matrix<T>::from_triplets(numVertices, numVertices, t);
+
+		// binary adjacency - an edge (i, j) has weight 1 regardless of the number of faces sharing it
+		for (auto& v : W.values())
+			v = T(-1);
+
+		std::vector<T> d(numVertices, T(0));
+		const auto& ptr = W.pointers();
+
+		for (unsigned int i = 0; i < numVertices; i++)
+			d[i] = T(ptr[i + 1] - ptr[i]);
+
+		return sparse_matrix<T>::diag(d) + W;
+	}
+
+
+	template <typename T>
+	sparse_matrix<T> cotangent_laplacian(unsigned int numVertices, const GUVector4 *V, const int *faces, unsigned int numFaces) {
+
+		if (numVertices == 0 || !V || !faces)
+			return sparse_matrix<T>();
+
+		std::vector<sparse_triplet<T> > t;
+
+		t.reserve(numFaces * 12);
+
+		for (unsigned int f = 0; f < numFaces; f++) {
+
+			const int *v = faces + f * 3;
+
+			if ((unsigned int)v[0] >= numVertices || (unsigned int)v[1] >= numVertices || (unsigned int)v[2] >= numVertices)
+				continue;
+
+			// for each corner c, the cotangent of the angle at c weights the opposite edge (a, b)
+			for (int c = 0; c < 3; c++) {
+
+				unsigned int vc = v[c], va = v[(c + 1) % 3], vb = v[(c + 2) % 3];
+
+				T ux = T(V[va].x - V[vc].x), uy = T(V[va].y - V[vc].y), uz = T(V[va].z - V[vc].z);
+				T wx = T(V[vb].x - V[vc].x), wy = T(V[vb].y - V[vc].y), wz = T(V[vb].z - V[vc].z);
+
+				T d = ux * wx + uy * wy + uz * wz;
+				T cx = uy * wz - uz * wy, cy = uz * wx - ux * wz, cz = ux * wy - uy * wx;
+				T crossLength = std::sqrt(cx * cx + cy * cy + cz * cz);
+
+				if (crossLength <= T(1e-12))
+					continue; // degenerate face
+
+				T halfCot = T(0.5) * d / crossLength;
+
+				t.push_back(sparse_triplet<T>(va, vb, -halfCot));
+				t.push_back(sparse_triplet<T>(vb, va, -halfCot));
+				t.push_back(sparse_triplet<T>(va, va, halfCot));
+				t.push_back(sparse_triplet<T>(vb, vb, halfCot));
+			}
+		}
+
+		return sparse_matrix<T>::from_triplets(numVertices, numVertices, t);
+	}
+
+
+	template <typename T>
+	sparse_matrix<T> smoothing_system(const sparse_matrix<T>& L, T lambda) {
+
+		if (!L.is_square())
+			return sparse_matrix<T>();
+
+		return sparse_matrix<T>::identity(L.rows()) + L * lambda;
+	}
+
+
+	inline std::ostream& operator<<(std::ostream& os, const gu_pcg_state &s) {
+
+		switch (s) {
+
+			case gu_pcg_converged: os << "gu_pcg_converged"; break;
+			case gu_pcg_max_iterations: os << "gu_pcg_max_iterations"; break;
+			case gu_pcg_breakdown: os << "gu_pcg_breakdown"; break;
+			default: os << "gu_pcg_error"; break;
+		}
+
+		return os;
+	}
+}
@@ -2,42 +2,59 @@
 //
 // Convolve U shader
 //
+// Horizontal pass of a separable Gaussian blur (see CGDPostProcess and DXPostProcess).  The kernel is generated from sigma on the CPU (CGDCreateBlurKernel) - neighbouring texels are merged into taps placed between them so each bilinear sample returns their weighted sum.  The target is the size of the source so the fragment's texture coordinate is the centre of its source texel
+//
 
 // Ensure matrices are row-major
 #pragma pack_matrix(row_major)
 
+// Must match CGD_MAX_BLUR_TAPS
+#define MAX_BLUR_TAPS 16
+
 
 //-----------------------------------------------------------------
 // Structures and resources
 //-----------------------------------------------------------------
 
+cbuffer postCBuffer : register(b0) {
+
+	float4				sourceSize;					// width, height, 1 / width, 1 / height of the texture in t0
+	float4				blurTaps[MAX_BLUR_TAPS];	// x = offset in texels, y = weight (tap 0 is the centre)
+	uint				blurTapCount;
+	float				bloomThreshold;
+	float				bloomIntensity;				// 0 = no bloom
+	float				focusDistance;				// 0 = no depth of field
+	float				focusRange;
+	float				nearPlane;
+	float				farPlane;
+	float				padding;
+};
+
 //
 // Textures
 //
 
-// Assumes texture bound to t0 and sampler bound to sampler s0
-// inputTex  Texture being convolved
-Texture2D  inputTex:register(t0);
+// Assumes texture bound to t0 and sampler bound to sampler s0 (linear clamp)
+// inputTex - Texture being convolved
+Texture2D  inputTex : register(t0);
 
 SamplerState linearSampler : register(s0);
 
 
-
-
 //-----------------------------------------------------------------
 // Input / Output structures
 //-----------------------------------------------------------------
 
 // Input fragment - this is the per-fragment packet interpolated by the rasteriser stage
 struct FragmentInputPacket {
+
 	float2				texCoord		: TEXCOORD;
 	float4				posH			: SV_POSITION;
 };
 
-
 struct FragmentOutputPacket {
 
-	float4				fragmentColour : SV_TARGET;
+	float4				fragmentColour	: SV_TARGET;
 };
 
 
@@ -45,27 +62,21 @@ struct FragmentOutputPacket {
 // Pixel Shader - Convolve with Gaussian
 //-----------------------------------------------------------------
 
-FragmentOutputPacket main(FragmentInputPacket IN) { 
+FragmentOutputPacket main(FragmentInputPacket IN) {
 
 	FragmentOutputPacket outputFragment;
-	float ImageWidth = 512;
-	float GaussWidth =2.0;
-	float scaleConv = 1.0 / ImageWidth;
-	
-	float netFilterWidth = scaleConv * GaussWidth;
-	// Gaussian curve  standard deviation of 1.0
-	float curve[13] = { 0.006, 0.0335, 0.061, 0.1515, 0.242, 0.3125, 0.383, 0.3125, 0.242, 0.1515, 0.061, 0.0335, 0.006 };
-	float2 coords = IN.texCoord - float2(netFilterWidth * 6.0, 0.0);
-	float4 sum = 0;
-	
-	for (int i = 0; i< 13; i++)
-	{
-		float4 tap = inputTex.Sample(linearSampler, coords);
-		sum += curve[i] * tap;
-		coords += float2(netFilterWidth, 0.0);
+
+	float4 sum = blurTaps[0].y * inputTex.Sample(linearSampler, IN.texCoord);
+
+	// Taps either side of the centre along the horizontal axis
+	for (uint i = 1; i < blurTapCount; i++) {
+
+		float2 offset = float2(blurTaps[i].x * sourceSize.z, 0.0f);
+
+		sum += blurTaps[i].y * (inputTex.Sample(linearSampler, IN.texCoord + offset) + inputTex.Sample(linearSampler, IN.texCoord - offset));
 	}
 
-	outputFragment.fragmentColour = sum;// float4(1, 0, 0, 1);// sum;
-	//outputFragment.fragmentColour = float4(1,1, 1, 1);
+	outputFragment.fragmentColour = sum;
+
 	return outputFragment;
 }
@@ -2,35 +2,44 @@
 //
 // Grass effect - Modified a fur technique
 //
+// Each shell keeps only the texels that fall inside a grass blade.  The ground is divided into cells of one blade each, with a random height per cell, and a shell pixel is kept if the blade of its cell reaches the shell and the pixel is within the blade's radius (which narrows towards the tip).  The sun is shadowed by the cascaded shadow maps (see per_pixel_lighting_ps.hlsl)
+//
 
 // Ensure matrices are row-major
 #pragma pack_matrix(row_major)
 
 
-//-----------------------------------------------------------------
-// Structures and resources
-//-----------------------------------------------------------------
-
 //-----------------------------------------------------------------
 // Globals
 //-----------------------------------------------------------------
 
-cbuffer basicCBuffer : register(b0) {
+// Per-frame constants
+cbuffer frameCBuffer : register(b3) {
 
-	float4x4			worldViewProjMatrix;
-	float4x4			worldITMatrix;				// Correctly transform normals to world space
-	float4x4			worldMatrix;
-	float4				eyePos;
-	float4				windDir;
 	float4				lightVec;					// w=1: Vec represents position, w=0: Vec  represents direction.
 	float4				lightAmbient;
 	float4				lightDiffuse;
 	float4				lightSpecular;
+	float4				windDir;					// xyz = direction, w = sway of the top grass shell
 	float				Timer;
-	float				grassHeight;
+	float				grassHeight;				// height of the top grass shell
+	float				oceanPatchSize;				// side of an ocean tile (one FFT patch)
+	uint				oceanTilesPerSide;
+	uint				oceanTileQuads;				// quads along a side of the ocean tile mesh
+};
+
+// Cascaded shadow maps of the sun (shadowCascadeCount = 0 when shadows are off - see DXShadowMaps)
+cbuffer shadowCBuffer : register(b2) {
 
+	float4x4			shadowCascadeMatrix[4];		// world to cascade clip space
+	float4				shadowTexelSize[4];			// x = world units per texel of each cascade
+	uint				shadowCascadeCount;
+	float				shadowMapTexel;				// 1 / shadow map resolution
 };
 
+static const float	bladeDensity = 3000.0f;	// blades across the ground (texture coordinates 0 to 1)
+static const float	bladeRadius = 0.45f;	// at the base of a blade as a fraction of its cell
+
 
 
 //
@@ -39,9 +48,12 @@ cbuffer basicCBuffer : register(b0) {
 
 // Assumes texture bound to texture t0 and sampler bound to sampler s0
 Texture2D myTexture : register(t0);
-Texture2D grassAlpha: register(t2);
 SamplerState anisotropicSampler : register(s0);
 
+// Shadow map cascades (one array slice each) and their comparison sampler
+Texture2DArray shadowMap : register(t11);
+SamplerComparisonState shadowSampler : register(s1);
+
 
 
 
@@ -59,6 +71,7 @@ struct FragmentInputPacket {
 	float4				matDiffuse		: DIFFUSE; // a represents alpha.
 	float4				matSpecular		: SPECULAR; // a represents specular power. 
 	float2				texCoord		: TEXCOORD;
+	float				shell			: SHELL;
 	float4				posH			: SV_POSITION;
 };
 
@@ -69,6 +82,43 @@ struct FragmentOutputPacket {
 };
 
 
+// Pseudo random value [0, 1) for a blade cell
+float hash(float2 cell) {
+
+	return frac(sin(dot(cell, float2(12.9898f, 78.233f))) * 43758.5453f);
+}
+
+
+// Fraction of the sun's light that reaches posW (as in per_pixel_lighting_ps.hlsl)
+float sunShadow(float3 posW, float3 N) {
+
+	for (uint i = 0; i < shadowCascadeCount; i++) {
+
+		float3 p = mul(float4(posW, 1.0f), shadowCascadeMatrix[i]).xyz;
+
+		if (max(abs(p.x), abs(p.y)) < 1.0f - 4.0f * shadowMapTexel) {
+
+			p = mul(float4(posW + N * shadowTexelSize[i].x * 1.5f, 1.0f), shadowCascadeMatrix[i]).xyz;
+
+			float2 uv = float2(p.x * 0.5f + 0.5f, 0.5f - p.y * 0.5f);
+			float lit = 0.0f;
+
+			[unroll]
+			for (int y = -1; y <= 1; y++) {
+
+				[unroll]
+				for (int x = -1; x <= 1; x++)
+					lit += shadowMap.SampleCmpLevelZero(shadowSampler, float3(uv, i), p.z, int2(x, y));
+			}
+
+			return lit / 9.0f;
+		}
+	}
+
+	return 1.0f;
+}
+
+
 //-----------------------------------------------------------------
 // Pixel Shader - Lighting 
 //-----------------------------------------------------------------
@@ -76,32 +126,31 @@ struct FragmentOutputPacket {
 FragmentOutputPacket main(FragmentInputPacket v) {
 
 	FragmentOutputPacket outputFragment;
-	float tileRepeat = 100;
-	float3 colour = float3(0.0, 0.0, 0.0);
-	float alpha = 1.0;
+
+	// Blade of the pixel's cell - discard the pixel if the blade does not reach the shell or the pixel is outside the blade
+	float2 cellCoord = v.texCoord * bladeDensity;
+	float2 cell = floor(cellCoord);
+	float bladeHeight = 0.4f + 0.6f * hash(cell);
+	float radius = bladeRadius * (1.0f - v.shell / bladeHeight);
+	float2 offset = frac(cellCoord) - 0.5f;
+
+	clip(bladeHeight - v.shell);
+	clip(radius * radius - dot(offset, offset));
+
+	// Same texture tiling as the ground (see per_pixel_lighting_grass_vs.hlsl)
 	float3 N = normalize(v.normalW);
-	colour = v.matDiffuse.xyz;
-	colour *= myTexture.Sample(anisotropicSampler, v.texCoord);
-
-	if (grassHeight > 0.0)
-	{
-		// Calculate the lambertian term (essentially the brightness of the surface point based on the dot product of the normal vector with the vector pointing from v to the light source's location)
-		float3 lightDir = -lightVec.xyz; // Directional light
-		if (lightVec.w == 1.0) lightDir = lightVec.xyz - v.posW; // Positional light
-		lightDir = normalize(lightDir);
-		colour += max(dot(lightDir, N), 0.0f) *colour * lightDiffuse;
-
-		alpha = grassAlpha.Sample(anisotropicSampler, v.texCoord*tileRepeat).a;
-		// Reduce alpha and increase illumination for tips of grass
-		colour *= 3 * alpha + (grassHeight * 10);// *(1 - alpha) * 3;
-		alpha = (alpha - grassHeight * 40);
-	}
-	else
-		colour *= float3(0.8, 0.8, 0.8);
+	float3 colour = myTexture.Sample(anisotropicSampler, v.texCoord * 10).xyz * v.matDiffuse.xyz;
 
+	// Calculate the lambertian term (essentially the brightness of the surface point based on the dot product of the normal vector with the vector pointing from v to the light source's location)
+	float3 lightDir = -lightVec.xyz; // Directional light
+	if (lightVec.w == 1.0) lightDir = lightVec.xyz - v.posW; // Positional light
+	lightDir = normalize(lightDir);
 
+	colour = colour * lightAmbient.xyz + sunShadow(v.posW, N) * max(dot(lightDir, N), 0.0f) * colour * lightDiffuse.xyz;
 
-	outputFragment.fragmentColour = float4(colour, alpha);
-	return outputFragment;
+	// Self shadowing - the base of the blades is darker than the tips
+	colour *= 0.5f + 0.7f * v.shell;
 
+	outputFragment.fragmentColour = float4(colour, 1.0f);
+	return outputFragment;
 }
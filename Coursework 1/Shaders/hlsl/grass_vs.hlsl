@@ -2,6 +2,8 @@
 //
 // Grass effect - Modified a fur technique
 //
+// Shells are drawn as instances of the ground mesh in a single draw (see CGDShellGrass).  Instance i is shell grassFirstShell + i of grassShellCount, raised by its fraction of grassHeight and swayed by the wind (more towards the tips)
+//
 
 // Ensure matrices are row-major
 #pragma pack_matrix(row_major)
@@ -10,19 +12,35 @@
 // Globals
 //-----------------------------------------------------------------
 
-cbuffer basicCBuffer : register(b0) {
+// Per-object constants - the object's slot of the object ring (see CGDConstantBuffers)
+cbuffer objectCBuffer : register(b0) {
 
-	float4x4			worldViewProjMatrix;
-	float4x4			worldITMatrix;				// Correctly transform normals to world space
 	float4x4			worldMatrix;
-	float4				eyePos;
-	float4				windDir;
+	float4x4			worldITMatrix;				// Correctly transform normals to world space
+};
+
+// Per-frame constants
+cbuffer frameCBuffer : register(b3) {
+
 	float4				lightVec;					// w=1: Vec represents position, w=0: Vec  represents direction.
 	float4				lightAmbient;
 	float4				lightDiffuse;
 	float4				lightSpecular;
+	float4				windDir;					// xyz = direction, w = sway of the top grass shell
 	float				Timer;
-	float				grassHeight;
+	float				grassHeight;				// height of the top grass shell
+	float				oceanPatchSize;				// side of an ocean tile (one FFT patch)
+	uint				oceanTilesPerSide;
+	uint				oceanTileQuads;				// quads along a side of the ocean tile mesh
+};
+
+// Per-view constants - the camera of the pass (a shadow cascade's view projection for shadow casters)
+cbuffer viewCBuffer : register(b4) {
+
+	float4x4			viewProjMatrix;
+	float4				eyePos;
+	uint				grassFirstShell;
+	uint				grassShellCount;
 };
 
 
@@ -51,40 +69,42 @@ struct vertexOutputPacket {
 	float4				matDiffuse		: DIFFUSE;
 	float4				matSpecular		: SPECULAR;
 	float2				texCoord		: TEXCOORD;
+	// Height of the shell as a fraction of the grass height (0, 1]
+	float				shell			: SHELL;
 	float4				posH			: SV_POSITION;
 };
 
-Texture2D heightTexture : register(t0);
-Texture2D normalTexture : register(t1);
 
 //-----------------------------------------------------------------
 // Vertex Shader
 //-----------------------------------------------------------------
-vertexOutputPacket main(vertexInputPacket inputVertex) {
+vertexOutputPacket main(vertexInputPacket inputVertex, uint instance : SV_InstanceID) {
 
 	vertexOutputPacket outputVertex;
+
+	float shell = (float)(grassFirstShell + instance) / (float)max(grassShellCount, 1);
+
+	// Raise the ground to the shell
 	float3 pos = inputVertex.pos;
-	pos.y = heightTexture.Load(int4(inputVertex.texCoord.x * 1024, inputVertex.texCoord.y * 1024, 0, 0)).r * 5;
+	pos.y += grassHeight * shell;
+
+	// Sway the shell with the wind - blades bend more towards the tips and the phase varies across the ground so the grass ripples (the ground's world transform is a translation so the wind is applied in object space)
+	float3 ground = mul(float4(inputVertex.pos, 1.0f), worldMatrix).xyz;
+	float sway = windDir.w * sin(Timer * 2.0f + ground.x * 0.3f + ground.z * 0.2f) * shell * shell * shell;
+	pos += windDir.xyz * sway;
 
 	// Lighting is calculated in world space.
 	outputVertex.posW = mul(float4(pos, 1.0f), worldMatrix).xyz;
 	// Transform normals to world space with gWorldIT.
-	//outputVertex.normalW = mul(float4(inputVertex.normal, 1.0f), worldITMatrix).xyz;
-
-	outputVertex.normalW = normalTexture.Load(int4(inputVertex.texCoord.x * 1024, inputVertex.texCoord.y * 1024, 0, 0)).xzy;
+	outputVertex.normalW = mul(float4(inputVertex.normal, 1.0f), worldITMatrix).xyz;
 	// Pass through material properties
 	outputVertex.matDiffuse = inputVertex.matDiffuse;
 	outputVertex.matSpecular = inputVertex.matSpecular;
 	// .. and texture coordinates.
 	outputVertex.texCoord = inputVertex.texCoord;
+	outputVertex.shell = shell;
 	// Finally transform/project pos to screen/clip space posH
-	//float3 pos = inputVertex.pos;
-	pos.y += grassHeight;
-
-	float k = pow(grassHeight * 100, 3);
-	float3 gWindDir = float3(sin(Timer)*0.05, 0, 0);
-	pos = pos + gWindDir*k;
-	outputVertex.posH = mul(float4(pos, 1.0), worldViewProjMatrix);
+	outputVertex.posH = mul(float4(outputVertex.posW, 1.0f), viewProjMatrix);
 
 	return outputVertex;
 }
@@ -0,0 +1,103 @@
+
+//
+// Ocean FFT - column transforms and maps (see CGDOcean and DXOceanSurface)
+//
+// One group per column.  The rows transformed by ocean_fft_rows_cs.hlsl are loaded into groupshared memory in bit-reversed order and transformed with a radix-2 inverse FFT, which completes the 2D transforms.  The displacement map gets the choppy displacement and height and the normal map the normal from the height slopes, as CGDOcean
+//
+
+#define MAX_SIZE			512		// FFT size limit - each thread does at most one butterfly per stage
+#define GROUP_SIZE			256
+#define NUM_TRANSFORMS		3
+#define PI					3.14159265358979
+
+//-----------------------------------------------------------------
+// Globals
+//-----------------------------------------------------------------
+
+cbuffer oceanCBuffer : register(b0) {
+
+	uint				size;
+	uint				log2Size;
+	float				fraction;					// phases are 2 pi frac(frequency steps * fraction)
+	float				choppiness;
+	float				frequencySpacing;			// 2 pi / patchSize
+	float				gravity;
+	float				repeatPeriod;
+	float				padding;
+};
+
+// Row transforms, one slice per transform
+Texture2DArray<float2> gRows : register(t0);
+// Maps - (choppy x, height, choppy z, 0) and (normal, 0)
+RWTexture2D<float4> gDisplacementMap : register(u0);
+RWTexture2D<float4> gNormalMap : register(u1);
+
+groupshared float2 transforms[NUM_TRANSFORMS][MAX_SIZE];
+
+//-----------------------------------------------------------------
+// FFT
+//-----------------------------------------------------------------
+
+float2 complexMul(float2 a, float2 b) {
+
+	return float2(a.x * b.x - a.y * b.y, a.x * b.y + a.y * b.x);
+}
+
+// In-place inverse radix-2 FFT of the transforms (input in bit-reversed order)
+void inverseFFT(uint thread) {
+
+	for (uint span = 1; span < size; span <<= 1) {
+
+		for (uint b = thread; b < size / 2; b += GROUP_SIZE) {
+
+			uint j = b & (span - 1);
+			uint a = ((b - j) << 1) + j;
+			float2 w;
+
+			sincos(PI * (float)j / (float)span, w.y, w.x);
+
+			[unroll]
+			for (uint t = 0; t < NUM_TRANSFORMS; t++) {
+
+				float2 odd = complexMul(w, transforms[t][a + span]);
+
+				transforms[t][a + span] = transforms[t][a] - odd;
+				transforms[t][a] += odd;
+			}
+		}
+
+		GroupMemoryBarrierWithGroupSync();
+	}
+}
+
+//-----------------------------------------------------------------
+// Compute Shader
+//-----------------------------------------------------------------
+[numthreads(GROUP_SIZE, 1, 1)]
+void main(uint3 group : SV_GroupID, uint thread : SV_GroupIndex) {
+
+	uint x = group.x;
+
+	for (uint z = thread; z < size; z += GROUP_SIZE) {
+
+		uint r = reversebits(z) >> (32 - log2Size);
+
+		[unroll]
+		for (uint t = 0; t < NUM_TRANSFORMS; t++)
+			transforms[t][r] = gRows[uint3(x, z, t)];
+	}
+
+	GroupMemoryBarrierWithGroupSync();
+
+	inverseFFT(thread);
+
+	for (uint i = thread; i < size; i += GROUP_SIZE) {
+
+		float2 heightSlopeX = transforms[0][i];
+		float2 displacement = transforms[1][i];
+		float slopeZ = transforms[2][i].x;
+
+		gDisplacementMap[uint2(x, i)] = float4(displacement.x * choppiness, heightSlopeX.x, displacement.y * choppiness, 0.0f);
+		gNormalMap[uint2(x, i)] = float4(normalize(float3(-heightSlopeX.y, 1.0f, -slopeZ)), 0.0f);
+	}
+}
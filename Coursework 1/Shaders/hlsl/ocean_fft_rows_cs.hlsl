@@ -0,0 +1,119 @@
+
+//
+// Ocean FFT - spectrum and row transforms (see CGDOcean and DXOceanSurface)
+//
+// One group per row of the spectrum.  Each element is evolved from the initial spectrum to the current time and the three transforms of CGDOcean (height + i slope x, displacement x + i displacement z and slope z) are written to groupshared memory in bit-reversed order, transformed with a radix-2 inverse FFT and stored to one slice each of the rows texture.  ocean_fft_columns_cs.hlsl completes the 2D transforms
+//
+
+#define MAX_SIZE			512		// FFT size limit - each thread does at most one butterfly per stage
+#define GROUP_SIZE			256
+#define NUM_TRANSFORMS		3
+#define PI					3.14159265358979
+
+//-----------------------------------------------------------------
+// Globals
+//-----------------------------------------------------------------
+
+cbuffer oceanCBuffer : register(b0) {
+
+	uint				size;
+	uint				log2Size;
+	float				fraction;					// phases are 2 pi frac(frequency steps * fraction)
+	float				choppiness;
+	float				frequencySpacing;			// 2 pi / patchSize
+	float				gravity;
+	float				repeatPeriod;
+	float				padding;
+};
+
+// Initial spectrum in natural order - h0(k) in xy and conj(h0(-k)) in zw
+Texture2D<float4> gInitialSpectrum : register(t0);
+// Row transforms, one slice per transform
+RWTexture2DArray<float2> gRows : register(u0);
+
+groupshared float2 transforms[NUM_TRANSFORMS][MAX_SIZE];
+
+//-----------------------------------------------------------------
+// FFT
+//-----------------------------------------------------------------
+
+float2 complexMul(float2 a, float2 b) {
+
+	return float2(a.x * b.x - a.y * b.y, a.x * b.y + a.y * b.x);
+}
+
+// Signed frequency of FFT index i (indices size / 2 and above are negative frequencies)
+int frequencyIndex(uint i) {
+
+	return (i < size / 2) ? (int)i : (int)i - (int)size;
+}
+
+// In-place inverse radix-2 FFT of the transforms (input in bit-reversed order)
+void inverseFFT(uint thread) {
+
+	for (uint span = 1; span < size; span <<= 1) {
+
+		for (uint b = thread; b < size / 2; b += GROUP_SIZE) {
+
+			uint j = b & (span - 1);
+			uint a = ((b - j) << 1) + j;
+			float2 w;
+
+			sincos(PI * (float)j / (float)span, w.y, w.x);
+
+			[unroll]
+			for (uint t = 0; t < NUM_TRANSFORMS; t++) {
+
+				float2 odd = complexMul(w, transforms[t][a + span]);
+
+				transforms[t][a + span] = transforms[t][a] - odd;
+				transforms[t][a] += odd;
+			}
+		}
+
+		GroupMemoryBarrierWithGroupSync();
+	}
+}
+
+//-----------------------------------------------------------------
+// Compute Shader
+//-----------------------------------------------------------------
+[numthreads(GROUP_SIZE, 1, 1)]
+void main(uint3 group : SV_GroupID, uint thread : SV_GroupIndex) {
+
+	uint z = group.y;
+	float kz = (float)frequencyIndex(z) * frequencySpacing;
+
+	for (uint x = thread; x < size; x += GROUP_SIZE) {
+
+		float4 h0 = gInitialSpectrum[uint2(x, z)];
+		float kx = (float)frequencyIndex(x) * frequencySpacing;
+		float k = sqrt(kx * kx + kz * kz);
+
+		// Deep water dispersion quantised to whole multiples of 2 pi / repeatPeriod, h(k, t) = h0(k) e + conj(h0(-k)) conj(e)
+		float steps = floor(sqrt(gravity * k) * repeatPeriod / (2.0f * PI));
+		float2 e;
+
+		sincos(2.0f * PI * frac(steps * fraction), e.y, e.x);
+
+		float2 h = complexMul(h0.xy, e) + complexMul(h0.zw, float2(e.x, -e.y));
+		float2 ih = float2(-h.y, h.x);
+		float2 kn = (k > 0.0f) ? float2(kx, kz) / k : float2(0.0f, 0.0f);
+		uint r = reversebits(x) >> (32 - log2Size);
+
+		transforms[0][r] = h * (1.0f - kx);				// h + i (i kx h)
+		transforms[1][r] = ih * kn.x - h * kn.y;		// (i kx / |k|) h + i (i kz / |k|) h
+		transforms[2][r] = ih * kz;						// i kz h
+	}
+
+	GroupMemoryBarrierWithGroupSync();
+
+	inverseFFT(thread);
+
+	for (uint i = thread; i < size; i += GROUP_SIZE) {
+
+		[unroll]
+		for (uint t = 0; t < NUM_TRANSFORMS; t++)
+			gRows[uint3(i, z, t)] = transforms[t][i];
+	}
+}
@@ -2,6 +2,8 @@
 //
 // Model a simple light
 //
+// The sun (lightVec) lights every pixel.  Point and spot lights are clustered (see CGDClusteredLighting and DXClusteredLighting) - the pixel's view space position selects its cluster of the main camera's grid and only the lights in that cluster's list are evaluated.  The sun is shadowed by the cascaded shadow maps (see sunShadow)
+//
 
 // Ensure matrices are row-major
 #pragma pack_matrix(row_major)
@@ -15,27 +17,45 @@
 // Globals
 //-----------------------------------------------------------------
 
-cbuffer basicCBuffer : register(b0) {
+// Per-frame constants
+cbuffer frameCBuffer : register(b3) {
 
-	float4x4			worldViewProjMatrix;
-	float4x4			worldITMatrix; // Correctly transform normals to world space
-	float4x4			worldMatrix;
-	float4				eyePos;
-	float4				lightVec; // w=1: Vec represents position, w=0: Vec  represents direction.
+	float4				lightVec;					// w=1: Vec represents position, w=0: Vec  represents direction.
 	float4				lightAmbient;
 	float4				lightDiffuse;
 	float4				lightSpecular;
-	float4				lightVec2; // w=1: Vec represents position, w=0: Vec  represents direction.
-	float4				lightAmbient2;
-	float4				lightDiffuse2;
-	float4				lightSpecular2;
-	float4				lightVec3; // w=1: Vec represents position, w=0: Vec  represents direction.
-	float4				lightAmbient3;
-	float4				lightDiffuse3;
-	float4				lightSpecular3;
-	float4				windDir;
+	float4				windDir;					// xyz = direction, w = sway of the top grass shell
 	float				Timer;
-	float				grassHeight;
+	float				grassHeight;				// height of the top grass shell
+	float				oceanPatchSize;				// side of an ocean tile (one FFT patch)
+	uint				oceanTilesPerSide;
+	uint				oceanTileQuads;				// quads along a side of the ocean tile mesh
+};
+
+// Per-view constants - the camera of the pass (a shadow cascade's view projection for shadow casters)
+cbuffer viewCBuffer : register(b4) {
+
+	float4x4			viewProjMatrix;
+	float4				eyePos;
+	uint				grassFirstShell;
+	uint				grassShellCount;
+};
+
+// Cluster grid of the main camera (clusterCount.w = 0 for passes drawn from other cameras - no local lights)
+cbuffer clusterCBuffer : register(b1) {
+
+	float4x4			clusterViewMatrix;
+	float4				clusterScale;				// x, y = projection scale (_11, _22), z, w = slice scale and bias of log(view depth)
+	uint4				clusterCount;				// tiles x, tiles y, slices, lights
+};
+
+// Cascaded shadow maps of the sun (shadowCascadeCount = 0 when shadows are off - see DXShadowMaps)
+cbuffer shadowCBuffer : register(b2) {
+
+	float4x4			shadowCascadeMatrix[4];		// world to cascade clip space
+	float4				shadowTexelSize[4];			// x = world units per texel of each cascade
+	uint				shadowCascadeCount;
+	float				shadowMapTexel;				// 1 / shadow map resolution
 };
 
 
@@ -47,6 +67,28 @@ cbuffer basicCBuffer : register(b0) {
 Texture2D myTexture : register(t0);
 SamplerState linearSampler : register(s0);
 
+// Point or spot light (matches CGDLight)
+struct Light {
+
+	float3				position;
+	float				range;						// influence falls to 0 at range
+	float3				colour;
+	uint				type;						// 0 = point, 1 = spot
+	float3				direction;
+	float				spotCosOuter;
+	float				spotCosInner;
+	float3				padding;
+};
+
+// Local lights, (offset, count) of each cluster's list in clusterLightIndices and the lists
+StructuredBuffer<Light> clusterLightBuffer : register(t8);
+StructuredBuffer<uint2> clusterGrid : register(t9);
+StructuredBuffer<uint> clusterLightIndices : register(t10);
+
+// Shadow map cascades (one array slice each) and their comparison sampler
+Texture2DArray shadowMap : register(t11);
+SamplerComparisonState shadowSampler : register(s1);
+
 
 
 
@@ -74,6 +116,36 @@ struct FragmentOutputPacket {
 };
 
 
+// Fraction of the sun's light that reaches posW.  The first cascade that holds the pixel (with room for the filter) is sampled - the position is moved along the normal by a texel of that cascade so surfaces facing the sun do not shadow themselves, then 3x3 comparisons are averaged (with the linear comparison filter each tap is a bilinear PCF)
+float sunShadow(float3 posW, float3 N) {
+
+	for (uint i = 0; i < shadowCascadeCount; i++) {
+
+		float3 p = mul(float4(posW, 1.0f), shadowCascadeMatrix[i]).xyz;
+
+		if (max(abs(p.x), abs(p.y)) < 1.0f - 4.0f * shadowMapTexel) {
+
+			p = mul(float4(posW + N * shadowTexelSize[i].x * 1.5f, 1.0f), shadowCascadeMatrix[i]).xyz;
+
+			float2 uv = float2(p.x * 0.5f + 0.5f, 0.5f - p.y * 0.5f);
+			float lit = 0.0f;
+
+			[unroll]
+			for (int y = -1; y <= 1; y++) {
+
+				[unroll]
+				for (int x = -1; x <= 1; x++)
+					lit += shadowMap.SampleCmpLevelZero(shadowSampler, float3(uv, i), p.z, int2(x, y));
+			}
+
+			return lit / 9.0f;
+		}
+	}
+
+	return 1.0f;
+}
+
+
 //-----------------------------------------------------------------
 // Pixel Shader - Lighting 
 //-----------------------------------------------------------------
@@ -90,39 +162,57 @@ FragmentOutputPacket main(FragmentInputPacket v) {
 	baseColour = baseColour * myTexture.Sample(linearSampler, v.texCoord);
 
 	//Initialise returned colour to ambient component
-	float3 colour = baseColour.xyz* (lightAmbient + lightAmbient2 + lightAmbient3);
+	float3 colour = baseColour.xyz * lightAmbient.xyz;
 
 	// Calculate the lambertian term (essentially the brightness of the surface point based on the dot product of the normal vector with the vector pointing from v to the light source's location)
 	float3 lightDir = -lightVec.xyz; // Directional light
-	if (lightVec.w == 1.0) lightDir =lightVec.xyz - v.posW; // Positional light
-	lightDir=normalize(lightDir);
-
-	float3 lightDir2 = -lightVec2.xyz; // Directional light
-	if (lightVec2.w == 1.0) lightDir2 = lightVec2.xyz - v.posW; // Positional light
-	lightDir2 = normalize(lightDir2);
-
-	float3 lightDir3 = -lightVec3.xyz; // Directional light
-	if (lightVec3.w == 1.0) lightDir3 = lightVec3.xyz - v.posW; // Positional light
-	lightDir3 = normalize(lightDir3);
+	if (lightVec.w == 1.0) lightDir = lightVec.xyz - v.posW; // Positional light
+	lightDir = normalize(lightDir);
 
 	// Add diffuse light if relevant (otherwise we end up just returning the ambient light colour)
-	colour += max(dot(lightDir, N), 0.0f) * baseColour.xyz * lightDiffuse;
-	colour += max(dot(lightDir2, N), 0.0f) * baseColour.xyz * lightDiffuse2;
-	colour += max(dot(lightDir3, N), 0.0f) * baseColour.xyz * lightDiffuse3;
+	float shadow = sunShadow(v.posW, N);
+	colour += shadow * max(dot(lightDir, N), 0.0f) * baseColour.xyz * lightDiffuse.xyz;
 
 	// Calc specular light
 	float specPower = max(v.matSpecular.a*1000.0, 1.0f);
 
-	float3 eyeDir = normalize(eyePos - v.posW);
-	float3 R = reflect(-lightDir,N );
-	float3 R2 = reflect(-lightDir2, N);
-	float3 R3 = reflect(-lightDir3, N);
+	float3 eyeDir = normalize(eyePos.xyz - v.posW);
+	float3 R = reflect(-lightDir, N);
 	float specFactor = pow(max(dot(R, eyeDir), 0.0f), specPower);
-	float specFactor2 = pow(max(dot(R2, eyeDir), 0.0f), specPower);
-	float specFactor3 = pow(max(dot(R3, eyeDir), 0.0f), specPower);
-	colour += specFactor * v.matSpecular.xyz * lightSpecular;
-	colour += specFactor2 * v.matSpecular.xyz * lightSpecular2;
-	colour += specFactor3 * v.matSpecular.xyz * lightSpecular3;
+	colour += shadow * specFactor * v.matSpecular.xyz * lightSpecular.xyz;
+
+	// Local lights of the pixel's cluster (the lookup of CGDClusteredLighting::clusterIndex)
+	if (clusterCount.w > 0) {
+
+		float3 posV = mul(float4(v.posW, 1.0f), clusterViewMatrix).xyz;
+		float z = max(posV.z, 1e-4f); // visible points are beyond the near plane
+		float2 ndc = posV.xy * clusterScale.xy / z;
+		int3 cell = int3(floor((ndc.x * 0.5f + 0.5f) * clusterCount.x), floor((0.5f - ndc.y * 0.5f) * clusterCount.y), floor(log(z) * clusterScale.z + clusterScale.w));
+
+		cell = clamp(cell, int3(0, 0, 0), int3(clusterCount.xyz) - 1);
+
+		uint2 list = clusterGrid[(cell.z * clusterCount.y + cell.y) * clusterCount.x + cell.x];
+
+		for (uint i = 0; i < list.y; i++) {
+
+			Light light = clusterLightBuffer[clusterLightIndices[list.x + i]];
+
+			float3 toLight = light.position - v.posW;
+			float distance = length(toLight);
+			float3 L = toLight / max(distance, 1e-4f);
+
+			// Smooth falloff to 0 at the light's range, shaped by the cone for a spot light
+			float falloff = saturate(1.0f - (distance * distance) / (light.range * light.range));
+			float attenuation = falloff * falloff;
+
+			if (light.type == 1)
+				attenuation *= saturate((dot(-L, light.direction) - light.spotCosOuter) / max(light.spotCosInner - light.spotCosOuter, 1e-4f));
+
+			float3 Rl = reflect(-L, N);
+
+			colour += attenuation * light.colour * (max(dot(L, N), 0.0f) * baseColour.xyz + pow(max(dot(Rl, eyeDir), 0.0f), specPower) * v.matSpecular.xyz);
+		}
+	}
 
 
 	outputFragment.fragmentColour = float4(colour,  baseColour.a);
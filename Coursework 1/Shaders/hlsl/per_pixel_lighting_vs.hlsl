@@ -7,30 +7,20 @@
 // Globals
 //-----------------------------------------------------------------
 
-cbuffer basicCBuffer : register(b0) {
+// Per-object constants - the object's slot of the object ring (see CGDConstantBuffers)
+cbuffer objectCBuffer : register(b0) {
 
-	float4x4			worldViewProjMatrix;
-	float4x4			worldITMatrix; // Correctly transform normals to world space
 	float4x4			worldMatrix;
-	float4				eyePos;
-	float4				lightVec; // w=1: Vec represents position, w=0: Vec  represents direction.
-	float4				lightAmbient;
-	float4				lightDiffuse;
-	float4				lightSpecular;
-	float4				lightVec2; // w=1: Vec represents position, w=0: Vec  represents direction.
-	float4				lightAmbient2;
-	float4				lightDiffuse2;
-	float4				lightSpecular2;
-	float4				lightVec3; // w=1: Vec represents position, w=0: Vec  represents direction.
-	float4				lightAmbient3;
-	float4				lightDiffuse3;
-	float4				lightSpecular3;
-	float4				windDir;
-	float				Timer;
-	float				grassHeight;
-
+	float4x4			worldITMatrix;				// Correctly transform normals to world space
+};
 
+// Per-view constants - the camera of the pass (a shadow cascade's view projection for shadow casters)
+cbuffer viewCBuffer : register(b4) {
 
+	float4x4			viewProjMatrix;
+	float4				eyePos;
+	uint				grassFirstShell;
+	uint				grassShellCount;
 };
 
 
@@ -79,7 +69,7 @@ vertexOutputPacket main(vertexInputPacket inputVertex) {
 	// .. and texture coordinates.
 	outputVertex.texCoord = inputVertex.texCoord;
 	// Finally transform/project pos to screen/clip space posH
-	outputVertex.posH = mul(float4(inputVertex.pos, 1.0), worldViewProjMatrix);
+	outputVertex.posH = mul(float4(outputVertex.posW, 1.0f), viewProjMatrix);
 
 	return outputVertex;
 }
@@ -0,0 +1,69 @@
+
+//
+// Post-processing bright pass (see DXPostProcess)
+//
+// Keeps the part of the half resolution scene brighter than bloomThreshold - each texel is scaled by how far its largest channel is above the threshold so the bloom fades in smoothly
+//
+
+// Ensure matrices are row-major
+#pragma pack_matrix(row_major)
+
+// Must match CGD_MAX_BLUR_TAPS
+#define MAX_BLUR_TAPS 16
+
+
+//-----------------------------------------------------------------
+// Structures and resources
+//-----------------------------------------------------------------
+
+cbuffer postCBuffer : register(b0) {
+
+	float4				sourceSize;					// width, height, 1 / width, 1 / height of the texture in t0
+	float4				blurTaps[MAX_BLUR_TAPS];	// x = offset in texels, y = weight (tap 0 is the centre)
+	uint				blurTapCount;
+	float				bloomThreshold;
+	float				bloomIntensity;				// 0 = no bloom
+	float				focusDistance;				// 0 = no depth of field
+	float				focusRange;
+	float				nearPlane;
+	float				farPlane;
+	float				padding;
+};
+
+// Half resolution scene bound to t0 and the linear clamp sampler to s0 (the target is the same size)
+Texture2D inputTex : register(t0);
+SamplerState linearSampler : register(s0);
+
+
+//-----------------------------------------------------------------
+// Input / Output structures
+//-----------------------------------------------------------------
+
+// Input fragment - this is the per-fragment packet interpolated by the rasteriser stage
+struct FragmentInputPacket {
+
+	float2				texCoord		: TEXCOORD;
+	float4				posH			: SV_POSITION;
+};
+
+struct FragmentOutputPacket {
+
+	float4				fragmentColour	: SV_TARGET;
+};
+
+
+//-----------------------------------------------------------------
+// Pixel Shader - Bright pass
+//-----------------------------------------------------------------
+
+FragmentOutputPacket main(FragmentInputPacket IN) {
+
+	FragmentOutputPacket outputFragment;
+
+	float4 colour = inputTex.Sample(linearSampler, IN.texCoord);
+	float brightness = max(colour.r, max(colour.g, colour.b));
+
+	outputFragment.fragmentColour = colour * (max(brightness - bloomThreshold, 0.0f) / max(brightness, 1.0e-4f));
+
+	return outputFragment;
+}
@@ -0,0 +1,89 @@
+
+//
+// Post-processing composite (see DXPostProcess)
+//
+// Blends the blurred half resolution scene over the scene by the circle of confusion - the distance of the pixel's linear depth from focusDistance relative to focusRange - and adds the bloom.  The scene and depth are read at the pixel, the half resolution images are sampled at its centre
+//
+
+// Ensure matrices are row-major
+#pragma pack_matrix(row_major)
+
+// Must match CGD_MAX_BLUR_TAPS
+#define MAX_BLUR_TAPS 16
+
+
+//-----------------------------------------------------------------
+// Structures and resources
+//-----------------------------------------------------------------
+
+cbuffer postCBuffer : register(b0) {
+
+	float4				sourceSize;					// width, height, 1 / width, 1 / height of the texture in t0
+	float4				blurTaps[MAX_BLUR_TAPS];	// x = offset in texels, y = weight (tap 0 is the centre)
+	uint				blurTapCount;
+	float				bloomThreshold;
+	float				bloomIntensity;				// 0 = no bloom
+	float				focusDistance;				// 0 = no depth of field
+	float				focusRange;
+	float				nearPlane;
+	float				farPlane;
+	float				padding;
+};
+
+//
+// Textures
+//
+
+// Scene bound to t0, depth of field image to t1, top bloom level to t2, scene depth buffer to t3 and the linear clamp sampler to s0
+Texture2D sceneTex : register(t0);
+Texture2D dofTex : register(t1);
+Texture2D bloomTex : register(t2);
+Texture2D<float> depthTex : register(t3);
+SamplerState linearSampler : register(s0);
+
+
+//-----------------------------------------------------------------
+// Input / Output structures
+//-----------------------------------------------------------------
+
+// Input fragment - this is the per-fragment packet interpolated by the rasteriser stage
+struct FragmentInputPacket {
+
+	float2				texCoord		: TEXCOORD;
+	float4				posH			: SV_POSITION;
+};
+
+struct FragmentOutputPacket {
+
+	float4				fragmentColour	: SV_TARGET;
+};
+
+
+//-----------------------------------------------------------------
+// Pixel Shader - Composite
+//-----------------------------------------------------------------
+
+FragmentOutputPacket main(FragmentInputPacket IN) {
+
+	FragmentOutputPacket outputFragment;
+
+	int3 pixel = int3(IN.posH.xy, 0);
+	float3 colour = sceneTex.Load(pixel).rgb;
+
+	if (focusDistance > 0.0f) {
+
+		// Linear depth from the post-projection depth
+		float z = depthTex.Load(pixel);
+		float linearDepth = nearPlane * farPlane / (farPlane - z * (farPlane - nearPlane));
+		float coc = min(abs(linearDepth - focusDistance) / max(focusRange, 1.0e-6f), 1.0f);
+
+		colour = lerp(colour, dofTex.Sample(linearSampler, IN.texCoord).rgb, coc);
+	}
+
+	if (bloomIntensity > 0.0f)
+		colour += bloomTex.Sample(linearSampler, IN.texCoord).rgb * bloomIntensity;
+
+	outputFragment.fragmentColour = float4(colour, 1.0f);
+
+	return outputFragment;
+}
@@ -0,0 +1,48 @@
+
+//
+// Post-processing resample (see DXPostProcess)
+//
+// One bilinear sample of the source at the centre of the target texel.  Halving the size averages 2 x 2 source texels (the downsample passes) and doubling it interpolates (the bloom upsample passes, drawn with additive blending into the larger level)
+//
+
+// Ensure matrices are row-major
+#pragma pack_matrix(row_major)
+
+//-----------------------------------------------------------------
+// Structures and resources
+//-----------------------------------------------------------------
+
+// Source bound to t0 and the linear clamp sampler to s0
+Texture2D inputTex : register(t0);
+SamplerState linearSampler : register(s0);
+
+
+//-----------------------------------------------------------------
+// Input / Output structures
+//-----------------------------------------------------------------
+
+// Input fragment - this is the per-fragment packet interpolated by the rasteriser stage
+struct FragmentInputPacket {
+
+	float2				texCoord		: TEXCOORD;
+	float4				posH			: SV_POSITION;
+};
+
+struct FragmentOutputPacket {
+
+	float4				fragmentColour	: SV_TARGET;
+};
+
+
+//-----------------------------------------------------------------
+// Pixel Shader - Resample
+//-----------------------------------------------------------------
+
+FragmentOutputPacket main(FragmentInputPacket IN) {
+
+	FragmentOutputPacket outputFragment;
+
+	outputFragment.fragmentColour = inputTex.Sample(linearSampler, IN.texCoord);
+
+	return outputFragment;
+}
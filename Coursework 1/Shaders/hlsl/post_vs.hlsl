@@ -0,0 +1,35 @@
+
+//
+// Post-processing full screen triangle (see DXPostProcess)
+//
+// Drawn with Draw(3, 0) and no vertex buffer or input layout - the vertex ID places one triangle over the whole target and its texture coordinates run from (0, 0) at the top left to (1, 1) at the bottom right of the target, so each fragment samples at the centre of its texel
+//
+
+// Ensure matrices are row-major
+#pragma pack_matrix(row_major)
+
+//-----------------------------------------------------------------
+// Input / Output structures
+//-----------------------------------------------------------------
+
+struct vertexOutputPacket {
+
+	float2				texCoord	: TEXCOORD;
+	float4				posH		: SV_POSITION;
+};
+
+//-----------------------------------------------------------------
+// Vertex Shader
+//-----------------------------------------------------------------
+vertexOutputPacket main(uint vertexID : SV_VertexID) {
+
+	vertexOutputPacket OUT;
+
+	// (0, 0), (2, 0), (0, 2) - the triangle covers the target and is clipped to it
+	float2 uv = float2((vertexID << 1) & 2, vertexID & 2);
+
+	OUT.texCoord = uv;
+	OUT.posH = float4(uv.x * 2.0f - 1.0f, 1.0f - uv.y * 2.0f, 0.0f, 1.0f);
+
+	return OUT;
+}
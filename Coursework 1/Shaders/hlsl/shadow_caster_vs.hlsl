@@ -0,0 +1,61 @@
+
+//
+// Shadow caster - depth only
+//
+// Draws a caster into a shadow map cascade (see DXShadowMaps).  viewProjMatrix is the cascade's view projection and there is no pixel shader
+//
+
+// Ensure matrices are row-major
+#pragma pack_matrix(row_major)
+
+
+//-----------------------------------------------------------------
+// Globals
+//-----------------------------------------------------------------
+
+// Per-object constants - the object's slot of the object ring (see CGDConstantBuffers)
+cbuffer objectCBuffer : register(b0) {
+
+	float4x4			worldMatrix;
+	float4x4			worldITMatrix;				// Correctly transform normals to world space
+};
+
+// Per-view constants - the camera of the pass (a shadow cascade's view projection for shadow casters)
+cbuffer viewCBuffer : register(b4) {
+
+	float4x4			viewProjMatrix;
+	float4				eyePos;
+	uint				grassFirstShell;
+	uint				grassShellCount;
+};
+
+
+
+//-----------------------------------------------------------------
+// Input / Output structures
+//-----------------------------------------------------------------
+
+// Only the position of the vertex (the rest of the DXVertexExt elements are ignored)
+struct vertexInputPacket {
+
+	float3				pos			: POSITION;
+};
+
+
+struct vertexOutputPacket {
+
+	float4				posH		: SV_POSITION;
+};
+
+
+//-----------------------------------------------------------------
+// Vertex Shader
+//-----------------------------------------------------------------
+vertexOutputPacket main(vertexInputPacket inputVertex) {
+
+	vertexOutputPacket outputVertex;
+
+	outputVertex.posH = mul(mul(float4(inputVertex.pos, 1.0), worldMatrix), viewProjMatrix);
+
+	return outputVertex;
+}
@@ -7,10 +7,20 @@
 // Globals
 //-----------------------------------------------------------------
 
-cbuffer basicCBuffer : register(b0) {
+// Per-object constants - the object's slot of the object ring (see CGDConstantBuffers)
+cbuffer objectCBuffer : register(b0) {
 
-	float4x4			worldViewProjMatrix;
+	float4x4			worldMatrix;
+	float4x4			worldITMatrix;				// Correctly transform normals to world space
+};
+
+// Per-view constants - the camera of the pass (a shadow cascade's view projection for shadow casters)
+cbuffer viewCBuffer : register(b4) {
 
+	float4x4			viewProjMatrix;
+	float4				eyePos;
+	uint				grassFirstShell;
+	uint				grassShellCount;
 };
 
 
@@ -47,7 +57,7 @@ vertexOutputPacket main(vertexInputPacket inputVertex) {
 	outputVertex.texCoord = inputVertex.pos;
 	
 	// Transform/project pos to screen/clip space posH ensuring that pos.z=1(far clipping plane)
-	outputVertex.posH = mul(float4(inputVertex.pos, 1.0), worldViewProjMatrix).xyww;
+	outputVertex.posH = mul(mul(float4(inputVertex.pos, 1.0), worldMatrix), viewProjMatrix).xyww;
 	//outputVertex.posH.z=200.0;
 
 	return outputVertex;
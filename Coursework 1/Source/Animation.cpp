@@ -7,7 +7,8 @@ using namespace std;
 
 Animation::Animation(int N, double time)
 {
-	keyFrames = (KeyFrame*)_aligned_malloc(sizeof(KeyFrame)*N, 16);
+	numKeyFrames = N;
+	keyFrames = gu_aligned_new<KeyFrame>(N);
 	
 	keyFrames[0].t = 0.0;
 	keyFrames[0].rY = 0;
@@ -77,5 +78,5 @@ DirectX::XMMATRIX Animation::update(double time )
 
 Animation::~Animation()
 {
-	free(keyFrames);
+	gu_aligned_delete(keyFrames, numKeyFrames);
 }
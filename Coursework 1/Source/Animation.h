@@ -22,6 +22,7 @@ class Animation
 	UINT endFrame;// last frame
 	UINT currFrame; // current frame
 	UINT nextFrame; // next frame
+	UINT numKeyFrames;
 
 public:
 	KeyFrame *	keyFrames;
@@ -5,6 +5,7 @@
 #include <iostream>
 #include <exception>
 #include <Effect.h>
+#include <CGDRenderQueue.h>
 
 using namespace std;
 using namespace DirectX;
@@ -158,7 +159,7 @@ Box::Box(ID3D11Device *device, Effect *_effect, ID3D11ShaderResourceView *tex_vi
 		linearDesc.AddressV = D3D11_TEXTURE_ADDRESS_MIRROR;
 		linearDesc.AddressW = D3D11_TEXTURE_ADDRESS_MIRROR;
 		linearDesc.MinLOD = 0.0f;
-		linearDesc.MaxLOD = 0.0f;
+		linearDesc.MaxLOD = D3D11_FLOAT32_MAX;
 		linearDesc.MipLODBias = 0.0f;
 		//linearDesc.MaxAnisotropy = 0; // Unused for isotropic filtering
 		linearDesc.ComparisonFunc = D3D11_COMPARISON_ALWAYS;
@@ -233,3 +234,36 @@ void Box::render(ID3D11DeviceContext *context) {
 	// 36 indices for the box.
 	context->DrawIndexed(36, 0, 0);
 }
+
+
+void Box::submit(CGDRenderQueue *queue, const CGDConstantBinding& constants, float depth, uint32_t layer) {
+
+	// Validate object before rendering (see notes in constructor)
+	if (!queue || !vertexBuffer || !effect)
+		return;
+
+	CGDDrawPacket packet;
+
+	ZeroMemory(&packet, sizeof(CGDDrawPacket));
+
+	effect->preparePacket(&packet);
+	packet.constants = constants;
+
+	if (textureResourceView && sampler) {
+
+		packet.shaderResources[0] = textureResourceView;
+		packet.numShaderResources = 1;
+		packet.sampler = sampler;
+	}
+
+	packet.vertexBuffer = vertexBuffer;
+	packet.vertexStride = sizeof(DXVertexExt);
+	packet.indexBuffer = indexBuffer;
+	packet.indexFormat = DXGI_FORMAT_R32_UINT;
+	packet.topology = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+
+	// 36 indices for the box
+	packet.indexCount = 36;
+
+	queue->submit(queue->makeKey(layer, effect, textureResourceView, vertexBuffer, depth), packet);
+}
@@ -2,6 +2,8 @@
 
 #include <GUObject.h>
 class Effect;
+class CGDRenderQueue;
+struct CGDConstantBinding;
 
 
 class Box : public GUObject {
@@ -19,4 +21,6 @@ public:
 	~Box();
 	void setTexture(ID3D11ShaderResourceView *tex_view);
 	void render(ID3D11DeviceContext *context);
+	// Queue the box draw on the render queue with the given per-object constants.  depth is the normalised view depth used to order draws that share a mesh
+	void submit(CGDRenderQueue *queue, const CGDConstantBinding& constants, float depth = 0.0f, uint32_t layer = 0);
 };
\ No newline at end of file
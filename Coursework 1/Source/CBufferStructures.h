@@ -1,60 +1,44 @@
 #pragma once
 using namespace DirectX;
 using namespace DirectX::PackedVector;
-// CBuffer struct
+// CBuffer structs
 // Use 16byte aligned so can use optimised XMMathFunctions instead of setting _XM_NO_INNTRINSICS_ define when compiling for x86
-__declspec(align(16)) struct CBufferExt  {
-	DirectX::XMMATRIX						WVPMatrix;
-	DirectX::XMMATRIX						worldITMatrix; // Correctly transform normals to world space
+// Constants are split by how often they change (see CGDConstantBuffers) - each object's own constants are bound to b0 from a slot of the object ring, the frame constants to b3 and the view constants to b4.  The layouts must match objectCBuffer, frameCBuffer and viewCBuffer in the scene's shaders
+
+// Per-object constants (objectCBuffer)
+__declspec(align(16)) struct CBufferObject {
 	DirectX::XMMATRIX						worldMatrix;
+	DirectX::XMMATRIX						worldITMatrix; // Correctly transform normals to world space
+};
+
+// Per-view constants (viewCBuffer) - written at the start of each pass
+__declspec(align(16)) struct CBufferView {
+	DirectX::XMMATRIX						viewProjMatrix;
 	DirectX::XMFLOAT4						eyePos;
+	// Shell grass (see CGDShellGrass) - shell instance i is shell grassFirstShell + i of grassShellCount, the top shell is grassHeight above the ground
+	UINT									grassFirstShell;
+	UINT									grassShellCount;
+	FLOAT									padding[2];
+};
+
+// Per-frame constants (frameCBuffer)
+__declspec(align(16)) struct CBufferFrame {
 	DirectX::XMFLOAT4						lightVec; // w=1: Vec represents position, w=0: Vec  represents direction.
 	DirectX::XMFLOAT4						lightAmbient;
 	DirectX::XMFLOAT4						lightDiffuse;
 	DirectX::XMFLOAT4						lightSpecular;
-
-	//Light 2
-	DirectX::XMFLOAT4						lightVec2; // w=1: Vec represents position, w=0: Vec  represents direction.
-	DirectX::XMFLOAT4						lightAmbient2;
-	DirectX::XMFLOAT4						lightDiffuse2;
-	DirectX::XMFLOAT4						lightSpecular2;
-
-	//Light 3
-	DirectX::XMFLOAT4						lightVec3; // w=1: Vec represents position, w=0: Vec  represents direction.
-	DirectX::XMFLOAT4						lightAmbient3;
-	DirectX::XMFLOAT4						lightDiffuse3;
-	DirectX::XMFLOAT4						lightSpecular3;
+	// Point and spot lights are not in the frame constants - they are uploaded once per frame for clustered lighting (see DXClusteredLighting)
 
 	// from terrain tutorial
 	DirectX::XMFLOAT4						windDir;
-	// Simple single light source properties
 	FLOAT									Timer;
 	// from terrain tutorial
 	FLOAT									grassHeight;
-	//// from terrain tutorial
-	FLOAT									reflectionPass;
-	// from particle system tutorial
-	//FLOAT									fireHeight;
-};
-
-__declspec(align(16)) struct camStruct {
-	DirectX::XMMATRIX						WVPMatrix;
-	DirectX::XMMATRIX						worldITMatrix; // Correctly transform normals to world space
-	DirectX::XMMATRIX						worldMatrix;
-	DirectX::XMFLOAT4						eyePos;
-};
-__declspec(align(16)) struct lightStruct {
-	DirectX::XMFLOAT4						lightVec; // w=1: Vec represents position, w=0: Vec  represents direction.
-	DirectX::XMFLOAT4						lightAmbient;
-	DirectX::XMFLOAT4						lightDiffuse;
-	DirectX::XMFLOAT4						lightSpecular;
-};
-__declspec(align(16)) struct projMatrixStruct  {
-	DirectX::XMMATRIX						projMatrix;
-};
-// from terrain tutorial
-__declspec(align(16)) struct worldMatrixStruct  {
-	DirectX::XMMATRIX						worldMatrix;
+	// Ocean surface (see DXOceanSurface) - instance i is tile (i % oceanTilesPerSide, i / oceanTilesPerSide) of the water, one FFT patch of oceanPatchSize drawn as oceanTileQuads * oceanTileQuads quads
+	FLOAT									oceanPatchSize;
+	UINT									oceanTilesPerSide;
+	UINT									oceanTileQuads;
+	FLOAT									padding[3];
 };
 
 struct MaterialStruct
@@ -64,15 +48,6 @@ struct MaterialStruct
 	XMCOLOR diffuse;
 	XMCOLOR specular;
 };
-struct LightStruct
-{
-	XMFLOAT4 attenuation; // Constant, Linear, Quadratic Attenuation
-	XMFLOAT4 vector; //w = 1: Vec represents position, w = 0 : Vec  represents direction.
-	XMCOLOR ambient;
-	XMCOLOR diffuse;
-	XMCOLOR specular;
-};
-
 
 
 
@@ -0,0 +1,265 @@
+
+//
+// CGDBenchmark.cpp
+//
+
+#include <stdafx.h>
+#include <CGDBenchmark.h>
+#include <CGDFrameTimeLog.h>
+#include <GUMemory.h>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+using namespace std;
+
+
+
+//
+// Private interface
+//
+
+// Constructor - called internally by the CreateBenchmark factory method
+CGDBenchmark::CGDBenchmark(const string& _name, const string& _source, const string& _description, const CGDBenchmarkTolerances& _tolerances) {
+
+	name = _name;
+	source = _source;
+	description = _description;
+	tolerances = _tolerances;
+}
+
+
+void CGDBenchmark::addMetric(const string& metricName, double value, double tolerance) {
+
+	CGDBenchmarkMetric m;
+
+	m.name = source + "." + metricName;
+	m.value = value;
+	m.tolerance = tolerance;
+
+	metrics.push_back(m);
+}
+
+
+
+//
+// Public interface
+//
+
+// Factory method
+CGDBenchmark* CGDBenchmark::CreateBenchmark(const string& name, const string& source, const string& description, const CGDBenchmarkTolerances& tolerances) {
+
+	return new CGDBenchmark(name, source, description, tolerances);
+}
+
+
+bool CGDBenchmark::LoadMetrics(const string& filename, vector<pair<string, double> >& values) {
+
+	ifstream file(filename);
+
+	if (!file.is_open()) {
+
+		cout << "Cannot open benchmark results " << filename << endl;
+		return false;
+	}
+
+	stringstream buffer;
+
+	buffer << file.rdbuf();
+
+	string text = buffer.str();
+	size_t p = text.find("\"metrics\"");
+
+	if (p == string::npos || (p = text.find('{', p)) == string::npos) {
+
+		cout << filename << " has no benchmark metrics\n";
+		return false;
+	}
+
+	values.clear();
+
+	// The metrics object is flat - "name": number pairs separated by commas
+	size_t end = text.find('}', p);
+
+	while (end != string::npos) {
+
+		size_t nameBegin = text.find('"', p);
+
+		if (nameBegin == string::npos || nameBegin > end)
+			break;
+
+		size_t nameEnd = text.find('"', nameBegin + 1);
+		size_t colon = text.find(':', nameEnd);
+
+		if (nameEnd == string::npos || colon == string::npos || colon > end)
+			break;
+
+		istringstream number(text.substr(colon + 1, end - colon - 1));
+		double value;
+
+		if (!(number >> value))
+			break;
+
+		values.push_back(make_pair(text.substr(nameBegin + 1, nameEnd - nameBegin - 1), value));
+
+		p = colon + 1;
+	}
+
+	return !values.empty();
+}
+
+
+void CGDBenchmark::recordFrame(const CGDBenchmarkFrame& frame) {
+
+	frames.push_back(frame);
+}
+
+
+void CGDBenchmark::finish() {
+
+	metrics.clear();
+
+	vector<float> frameTimes(frames.size());
+	double drawCalls = 0.0, stateChanges = 0.0, triangles = 0.0;
+
+	for (size_t i = 0; i < frames.size(); i++) {
+
+		frameTimes[i] = (float)frames[i].frameTimeMs;
+		drawCalls += (double)frames[i].drawCalls;
+		stateChanges += (double)frames[i].stateChanges;
+		triangles += (double)frames[i].trianglesSubmitted;
+	}
+
+	double n = (frames.empty()) ? 1.0 : (double)frames.size();
+	CGDFrameTimeStats stats = CGDFrameTimeLog::CalculateStatistics(frameTimes);
+
+	addMetric("frameTime.mean", stats.mean, tolerances.frameTime);
+	addMetric("frameTime.p50", stats.p50, tolerances.frameTime);
+	addMetric("frameTime.p95", stats.p95, tolerances.frameTime);
+	addMetric("frameTime.p99", stats.p99, tolerances.frameTime);
+	addMetric("frameTime.max", stats.maximum, tolerances.frameTime);
+
+	addMetric("drawCalls", drawCalls / n, tolerances.counters);
+	addMetric("stateChanges", stateChanges / n, tolerances.counters);
+	addMetric("trianglesSubmitted", triangles / n, tolerances.counters);
+
+	// Memory high-water marks since startup (zero if memory tracking is disabled)
+	addMetric("memory.peakBytes", (double)gu_memory_get_total_stats().peak_bytes, tolerances.memory);
+
+	for (int i = 0; i < gu_mem_num_tags; i++)
+		addMetric(string("memory.") + gu_memory_tag_name((gu_memory_tag)i) + ".peakBytes", (double)gu_memory_get_stats((gu_memory_tag)i).peak_bytes, tolerances.memory);
+}
+
+
+const vector<CGDBenchmarkMetric>& CGDBenchmark::getMetrics() const {
+
+	return metrics;
+}
+
+
+size_t CGDBenchmark::frameCount() const {
+
+	return frames.size();
+}
+
+
+void CGDBenchmark::writeJSON(ostream& os) const {
+
+	os << setprecision(10);
+	os << "{\n";
+	os << "  \"benchmark\": \"" << name << "\",\n";
+	os << "  \"source\": \"" << source << "\",\n";
+	os << "  \"description\": \"" << description << "\",\n";
+	os << "  \"frames\": " << frames.size() << ",\n";
+	os << "  \"metrics\": {\n";
+
+	for (size_t i = 0; i < metrics.size(); i++)
+		os << "    \"" << metrics[i].name << "\": " << metrics[i].value << ((i + 1 < metrics.size()) ? ",\n" : "\n");
+
+	os << "  },\n";
+	os << "  \"frameTimes\": [";
+
+	for (size_t i = 0; i < frames.size(); i++)
+		os << ((i > 0) ? ", " : "") << frames[i].frameTimeMs;
+
+	os << "]\n}\n";
+}
+
+
+bool CGDBenchmark::exportJSON(const string& filename) const {
+
+	ofstream file(filename);
+
+	if (!file.is_open()) {
+
+		cout << "Cannot open benchmark results file " << filename << endl;
+		return false;
+	}
+
+	writeJSON(file);
+
+	return file.good();
+}
+
+
+bool CGDBenchmark::compareWithBaseline(const string& filename) const {
+
+	vector<pair<string, double> > baseline;
+
+	if (!LoadMetrics(filename, baseline))
+		return false;
+
+	bool passed = true;
+	size_t compared = 0;
+
+	cout << "\nBenchmark " << name << " (" << description << ") against baseline " << filename << "...\n";
+
+	for (size_t i = 0; i < metrics.size(); i++) {
+
+		const CGDBenchmarkMetric& m = metrics[i];
+		size_t j = 0;
+
+		while (j < baseline.size() && baseline[j].first != m.name)
+			j++;
+
+		if (j == baseline.size()) {
+
+			cout << m.name << " = " << m.value << " (not in baseline)\n";
+			continue;
+		}
+
+		double base = baseline[j].second;
+
+		compared++;
+		bool regressed = m.value > base * (1.0 + m.tolerance);
+
+		cout << m.name << " = " << m.value << ", baseline = " << base;
+
+		if (base > 0.0)
+			cout << " (" << showpos << (m.value - base) / base * 100.0 << noshowpos << "%)";
+
+		cout << ((regressed) ? " REGRESSION\n" : "\n");
+
+		if (regressed)
+			passed = false;
+	}
+
+	if (compared == 0) {
+
+		cout << filename << " has no " << source << " metrics - it was recorded from another renderer\n";
+		passed = false;
+	}
+
+	cout << ((passed) ? "Benchmark passed\n" : "Benchmark FAILED\n");
+
+	return passed;
+}
+
+
+void CGDBenchmark::report() const {
+
+	cout << "\nBenchmark " << name << " - " << description << " (" << frames.size() << " frames)...\n";
+
+	for (size_t i = 0; i < metrics.size(); i++)
+		cout << metrics[i].name << " = " << metrics[i].value << endl;
+}
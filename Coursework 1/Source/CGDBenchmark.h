@@ -0,0 +1,95 @@
+//
+// CGDBenchmark.h
+//
+
+// Collect the results of a benchmark run and compare them against a stored baseline.  The renderer under test reports each frame's CPU time and counters (draw calls, state changes, triangles) and finish() derives the metrics - frame time percentiles, mean counters per frame and the memory high-water marks of GUMemory (total and per tag).  Results are written as JSON and a later run is compared metric by metric against a baseline JSON file; every metric is "lower is better" and a metric regresses when it exceeds the baseline by more than its relative tolerance.  Counters come from a deterministic replay so they are compared exactly, while timings and memory are given some slack for run-to-run noise.
+//
+// Every benchmark names the renderer its frames come from (its source) so results are not mistaken for another renderer's.  Metrics are named <source>.<metric>, the source and its description are written to the JSON file and printed with every report, and a baseline is only compared if it holds metrics of the same source.
+
+#pragma once
+
+#include <GUObject.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <iostream>
+
+
+// Measurements for a single frame
+struct CGDBenchmarkFrame {
+
+	double					frameTimeMs = 0.0;
+	uint64_t				drawCalls = 0;
+	uint64_t				stateChanges = 0;
+	uint64_t				trianglesSubmitted = 0;
+};
+
+
+// A named result.  The metric regresses if value > baseline * (1 + tolerance)
+struct CGDBenchmarkMetric {
+
+	std::string				name;
+	double					value;
+	double					tolerance;
+};
+
+
+// Tolerances used by finish()
+struct CGDBenchmarkTolerances {
+
+	double					frameTime = 0.10;
+	double					counters = 0.0;
+	double					memory = 0.05;
+};
+
+
+class CGDBenchmark : public GUObject {
+
+	std::string							name;
+	std::string							source;
+	std::string							description;
+	CGDBenchmarkTolerances				tolerances;
+
+	std::vector<CGDBenchmarkFrame>		frames;
+	std::vector<CGDBenchmarkMetric>		metrics;
+
+
+	//
+	// Private interface
+	//
+
+	// Constructor - called internally by the CreateBenchmark factory method
+	CGDBenchmark(const std::string& name, const std::string& source, const std::string& description, const CGDBenchmarkTolerances& tolerances);
+
+	void addMetric(const std::string& metricName, double value, double tolerance);
+
+
+public:
+
+	//
+	// Public interface
+	//
+
+	// Factory method.  source is a short name for the renderer under test (eg. "headlessScene") used as the prefix of every metric and description says what it renders
+	static CGDBenchmark* CreateBenchmark(const std::string& name, const std::string& source, const std::string& description, const CGDBenchmarkTolerances& tolerances = CGDBenchmarkTolerances());
+
+	// Read the "metrics" object of a results file written by exportJSON into name / value pairs.  Return false if the file cannot be read or has no metrics
+	static bool LoadMetrics(const std::string& filename, std::vector<std::pair<std::string, double> >& values);
+
+	void recordFrame(const CGDBenchmarkFrame& frame);
+
+	// Derive the metrics from the recorded frames and the current GUMemory peaks.  Call once all frames are recorded
+	void finish();
+
+	const std::vector<CGDBenchmarkMetric>& getMetrics() const;
+	size_t frameCount() const;
+
+	// JSON export - the benchmark name, source and description, frame count, metrics and per-frame times.  exportJSON returns true if successful
+	void writeJSON(std::ostream& os) const;
+	bool exportJSON(const std::string& filename) const;
+
+	// Compare the metrics against a baseline written by exportJSON and report each metric.  Metrics missing from the baseline are reported but do not fail.  Return false if any metric regressed, the baseline cannot be read or it has no metrics of this benchmark's source (it was recorded from another renderer)
+	bool compareWithBaseline(const std::string& filename) const;
+
+	void report() const;
+};
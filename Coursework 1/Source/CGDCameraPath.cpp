@@ -0,0 +1,196 @@
+
+//
+// CGDCameraPath.cpp
+//
+
+#include <stdafx.h>
+#include <CGDCameraPath.h>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+
+using namespace std;
+
+
+// File format version written by save()
+static const int				pathVersion = 1;
+
+
+
+//
+// Private interface
+//
+
+// Constructor - called internally by the CreateCameraPath and LoadCameraPath factory methods
+CGDCameraPath::CGDCameraPath(gu_seconds _stepSize) {
+
+	stepSize = _stepSize;
+}
+
+
+
+//
+// Public interface
+//
+
+// Factory methods
+CGDCameraPath* CGDCameraPath::CreateCameraPath(gu_seconds stepSize) {
+
+	if (stepSize <= 0.0)
+		return nullptr;
+
+	return new CGDCameraPath(stepSize);
+}
+
+
+CGDCameraPath* CGDCameraPath::LoadCameraPath(const string& filename) {
+
+	ifstream file(filename);
+
+	if (!file.is_open()) {
+
+		cout << "Cannot open camera path " << filename << endl;
+		return nullptr;
+	}
+
+	string tag;
+	int version = 0;
+	gu_seconds stepSize = 0.0;
+
+	if (!(file >> tag >> version >> stepSize) || tag != "CGDCameraPath" || version != pathVersion || stepSize <= 0.0) {
+
+		cout << filename << " is not a camera path\n";
+		return nullptr;
+	}
+
+	CGDCameraPath *path = new CGDCameraPath(stepSize);
+	CGDCameraKeyframe k;
+
+	while (file >> k.position[0] >> k.position[1] >> k.position[2] >> k.direction[0] >> k.direction[1] >> k.direction[2])
+		path->keyframes.push_back(k);
+
+	if (!file.eof()) {
+
+		cout << "Invalid keyframe " << path->keyframes.size() << " in camera path " << filename << endl;
+
+		path->release();
+		return nullptr;
+	}
+
+	return path;
+}
+
+
+void CGDCameraPath::record(const float position[3], const float direction[3]) {
+
+	CGDCameraKeyframe k;
+
+	for (int i = 0; i < 3; i++) {
+
+		k.position[i] = position[i];
+		k.direction[i] = direction[i];
+	}
+
+	keyframes.push_back(k);
+}
+
+
+void CGDCameraPath::clear() {
+
+	keyframes.clear();
+}
+
+
+bool CGDCameraPath::save(const string& filename) const {
+
+	ofstream file(filename);
+
+	if (!file.is_open()) {
+
+		cout << "Cannot open camera path " << filename << " for writing\n";
+		return false;
+	}
+
+	// Write enough digits that a saved path reloads exactly
+	file << "CGDCameraPath " << pathVersion << " " << setprecision(numeric_limits<double>::digits10 + 2) << stepSize << "\n";
+	file << setprecision(numeric_limits<float>::digits10 + 3);
+
+	for (size_t i = 0; i < keyframes.size(); i++) {
+
+		const CGDCameraKeyframe& k = keyframes[i];
+
+		file << k.position[0] << " " << k.position[1] << " " << k.position[2] << " " << k.direction[0] << " " << k.direction[1] << " " << k.direction[2] << "\n";
+	}
+
+	return file.good();
+}
+
+
+void CGDCameraPath::sample(gu_seconds t, float position[3], float direction[3]) const {
+
+	if (keyframes.empty()) {
+
+		position[0] = position[1] = position[2] = 0.0f;
+		direction[0] = direction[1] = 0.0f;
+		direction[2] = 1.0f;
+
+		return;
+	}
+
+	gu_seconds s = max(0.0, min(t, duration())) / stepSize;
+	size_t i = min((size_t)s, keyframes.size() - 1);
+	size_t j = min(i + 1, keyframes.size() - 1);
+	float alpha = (float)(s - (gu_seconds)i);
+
+	const CGDCameraKeyframe& a = keyframes[i];
+	const CGDCameraKeyframe& b = keyframes[j];
+
+	float length = 0.0f;
+
+	for (int k = 0; k < 3; k++) {
+
+		position[k] = a.position[k] + (b.position[k] - a.position[k]) * alpha;
+		direction[k] = a.direction[k] + (b.direction[k] - a.direction[k]) * alpha;
+		length += direction[k] * direction[k];
+	}
+
+	// Keyframes are a small step apart so normalised lerp is indistinguishable from slerp.  Fall back to the first keyframe if the directions are opposed
+	if (length > 1.0e-12f) {
+
+		length = sqrt(length);
+
+		for (int k = 0; k < 3; k++)
+			direction[k] /= length;
+
+	} else {
+
+		for (int k = 0; k < 3; k++)
+			direction[k] = a.direction[k];
+	}
+}
+
+
+gu_seconds CGDCameraPath::getStepSize() const {
+
+	return stepSize;
+}
+
+
+size_t CGDCameraPath::keyframeCount() const {
+
+	return keyframes.size();
+}
+
+
+const CGDCameraKeyframe& CGDCameraPath::keyframe(size_t index) const {
+
+	return keyframes[index];
+}
+
+
+gu_seconds CGDCameraPath::duration() const {
+
+	return (keyframes.empty()) ? 0.0 : (gu_seconds)(keyframes.size() - 1) * stepSize;
+}
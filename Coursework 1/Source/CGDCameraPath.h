@@ -0,0 +1,67 @@
+//
+// CGDCameraPath.h
+//
+
+// Model a recorded camera fly-through.  The path stores one keyframe (position and view direction, as FirstPersonCamera) per fixed timestep so a recording made at any frame rate replays identically, and sample() interpolates between keyframes (position linearly, direction by normalised linear interpolation) for playback at other rates.  Paths are stored as text - a header line "CGDCameraPath <version> <stepSize>" followed by one "px py pz dx dy dz" line per keyframe - so they can be reviewed and edited by hand and diff cleanly under version control.
+
+#pragma once
+
+#include <GUObject.h>
+#include <CGDClock.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+struct CGDCameraKeyframe {
+
+	float					position[3];
+	float					direction[3];
+};
+
+
+class CGDCameraPath : public GUObject {
+
+	gu_seconds							stepSize;
+	std::vector<CGDCameraKeyframe>		keyframes;
+
+
+	//
+	// Private interface
+	//
+
+	// Constructor - called internally by the CreateCameraPath and LoadCameraPath factory methods
+	CGDCameraPath(gu_seconds stepSize);
+
+
+public:
+
+	//
+	// Public interface
+	//
+
+	// Factory method - create an empty path for recording with one keyframe every stepSize seconds.  Return nullptr if stepSize <= 0
+	static CGDCameraPath* CreateCameraPath(gu_seconds stepSize);
+
+	// Factory method - load a path saved with save().  Return nullptr if the file cannot be read or is not a valid path
+	static CGDCameraPath* LoadCameraPath(const std::string& filename);
+
+	// Append the keyframe for the next timestep
+	void record(const float position[3], const float direction[3]);
+
+	// Discard all keyframes
+	void clear();
+
+	// Write the path to filename.  Return false on failure
+	bool save(const std::string& filename) const;
+
+	// Interpolate the camera at time t (seconds from the first keyframe).  t is clamped to [0, duration()].  An empty path returns the origin looking along +z
+	void sample(gu_seconds t, float position[3], float direction[3]) const;
+
+	gu_seconds getStepSize() const;
+	size_t keyframeCount() const;
+	const CGDCameraKeyframe& keyframe(size_t index) const;
+
+	// Time of the last keyframe
+	gu_seconds duration() const;
+};
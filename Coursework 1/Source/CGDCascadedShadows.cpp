@@ -0,0 +1,350 @@
+
+//
+// CGDCascadedShadows.cpp
+//
+
+#include <stdafx.h>
+#include <CGDCascadedShadows.h>
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+
+using namespace std;
+
+
+static inline float Dot3(const float a[3], const float b[3]) {
+
+	return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+
+//
+// Private interface
+//
+
+// Constructor - called internally by the CreateCascadedShadows factory method
+CGDCascadedShadows::CGDCascadedShadows(const CGDShadowDesc& _desc) {
+
+	desc = _desc;
+
+	memset(lightBasis, 0, sizeof(lightBasis));
+	memset(fitProj, 0, sizeof(fitProj));
+	memset(fitLight, 0, sizeof(fitLight));
+	memset(cascades, 0, sizeof(cascades));
+	memset(lastRefit, 0, sizeof(lastRefit));
+}
+
+
+void CGDCascadedShadows::setLightDirection(const float lightDirection[3]) {
+
+	float length = sqrtf(Dot3(lightDirection, lightDirection));
+	float *right = lightBasis[0], *up = lightBasis[1], *forward = lightBasis[2];
+
+	for (int i = 0; i < 3; i++)
+		forward[i] = lightDirection[i] / length;
+
+	// Right = worldUp x forward with world up (0, 1, 0), or (0, 0, 1) for a light that is close to vertical
+	if (fabsf(forward[1]) < 0.99f) {
+
+		right[0] = forward[2]; right[1] = 0.0f; right[2] = -forward[0];
+
+	} else {
+
+		right[0] = -forward[1]; right[1] = forward[0]; right[2] = 0.0f;
+	}
+
+	length = sqrtf(Dot3(right, right));
+
+	for (int i = 0; i < 3; i++)
+		right[i] /= length;
+
+	// Up = forward x right (left-handed basis)
+	up[0] = forward[1] * right[2] - forward[2] * right[1];
+	up[1] = forward[2] * right[0] - forward[0] * right[2];
+	up[2] = forward[0] * right[1] - forward[1] * right[0];
+}
+
+
+void CGDCascadedShadows::fitCascade(uint32_t i, const float lightCentre[3], float radius) {
+
+	CGDShadowCascade& c = cascades[i];
+
+	// One texel of border so the sphere is still covered after the centre is snapped by up to a texel
+	float texelSize = 2.0f * radius / (float)(desc.resolution - 2);
+	float halfWidth = texelSize * (float)(desc.resolution / 2);
+
+	c.centre[0] = floorf(lightCentre[0] / texelSize) * texelSize;
+	c.centre[1] = floorf(lightCentre[1] / texelSize) * texelSize;
+	c.centre[2] = lightCentre[2];
+	c.radius = halfWidth;
+	c.texelSize = texelSize;
+
+	// Orthographic projection of the light space box [centre - halfWidth, centre + halfWidth], extended casterDistance towards the light in z
+	float zNear = c.centre[2] - halfWidth - desc.casterDistance;
+	float zFar = c.centre[2] + halfWidth;
+	float *m = c.viewProj;
+
+	for (int r = 0; r < 3; r++) {
+
+		m[r * 4 + 0] = lightBasis[0][r] / halfWidth;
+		m[r * 4 + 1] = lightBasis[1][r] / halfWidth;
+		m[r * 4 + 2] = lightBasis[2][r] / (zFar - zNear);
+		m[r * 4 + 3] = 0.0f;
+	}
+
+	m[12] = -c.centre[0] / halfWidth;
+	m[13] = -c.centre[1] / halfWidth;
+	m[14] = -zNear / (zFar - zNear);
+	m[15] = 1.0f;
+}
+
+
+bool CGDCascadedShadows::coversSlice(uint32_t i, const float lightCentre[3], float radius) const {
+
+	const CGDShadowCascade& c = cascades[i];
+
+	return fabsf(lightCentre[0] - c.centre[0]) + radius <= c.radius &&
+		fabsf(lightCentre[1] - c.centre[1]) + radius <= c.radius &&
+		fabsf(lightCentre[2] - c.centre[2]) + radius <= c.radius;
+}
+
+
+
+//
+// Public interface
+//
+
+// Factory method
+CGDCascadedShadows* CGDCascadedShadows::CreateCascadedShadows(const CGDShadowDesc& desc) {
+
+	if (desc.cascadeCount == 0 || desc.cascadeCount > CGD_MAX_SHADOW_CASCADES || desc.resolution < 4 || (desc.resolution & 1) || desc.splitLambda < 0.0f || desc.splitLambda > 1.0f || desc.staticUpdateRate == 0)
+		return nullptr;
+
+	return new CGDCascadedShadows(desc);
+}
+
+
+// Destructor
+CGDCascadedShadows::~CGDCascadedShadows() {
+
+}
+
+
+void CGDCascadedShadows::ComputeSplits(float nearPlane, float farPlane, uint32_t count, float lambda, float *splits) {
+
+	splits[0] = nearPlane;
+
+	for (uint32_t i = 1; i < count; i++) {
+
+		float t = (float)i / (float)count;
+		float logSplit = nearPlane * powf(farPlane / nearPlane, t);
+		float uniformSplit = nearPlane + (farPlane - nearPlane) * t;
+
+		splits[i] = lambda * logSplit + (1.0f - lambda) * uniformSplit;
+	}
+
+	splits[count] = farPlane;
+}
+
+
+void CGDCascadedShadows::SliceSphere(float splitNear, float splitFar, float projX, float projY, float *centreDepth, float *radius) {
+
+	// Corners of a slice at depth z are at distance z * k from the view axis.  The sphere through the near and far corners is centred at (n + f)(1 + k^2) / 2, or at the far plane if that is beyond it (wide slices)
+	float k2 = 1.0f / (projX * projX) + 1.0f / (projY * projY);
+	float c = min(0.5f * (splitNear + splitFar) * (1.0f + k2), splitFar);
+	float nearDistance = sqrtf(splitNear * splitNear * k2 + (c - splitNear) * (c - splitNear));
+	float farDistance = sqrtf(splitFar * splitFar * k2 + (splitFar - c) * (splitFar - c));
+
+	*centreDepth = c;
+	*radius = max(nearDistance, farDistance);
+}
+
+
+void CGDCascadedShadows::update(const float view[16], const float proj[16], const float lightDirection[3], const CGDShadowCaster *casters, uint32_t count) {
+
+	PROFILE_SCOPE("CGDCascadedShadows::update");
+
+	frame++;
+
+	// Every cascade is refitted if the light or the projection has changed since the last fit
+	bool lightChanged = memcmp(fitLight, lightDirection, sizeof(fitLight)) != 0;
+	bool projChanged = fitProj[0] != proj[0] || fitProj[1] != proj[5] || fitProj[2] != proj[10] || fitProj[3] != proj[14];
+	bool force = !fitted || lightChanged || projChanged;
+
+	if (force) {
+
+		setLightDirection(lightDirection);
+		memcpy(fitLight, lightDirection, sizeof(fitLight));
+		fitProj[0] = proj[0];
+		fitProj[1] = proj[5];
+		fitProj[2] = proj[10];
+		fitProj[3] = proj[14];
+		fitted = true;
+	}
+
+	// Near and far planes of a left-handed perspective projection (_33 = f / (f - n), _43 = -n * f / (f - n)) and the camera's world space position and view axis
+	float nearPlane = -proj[14] / proj[10];
+	float farPlane = min(desc.shadowDistance, proj[14] / (1.0f - proj[10]));
+	float axisZ[3] = { view[2], view[6], view[10] };
+	float eye[3];
+
+	for (int i = 0; i < 3; i++)
+		eye[i] = -(view[12] * view[i * 4 + 0] + view[13] * view[i * 4 + 1] + view[14] * view[i * 4 + 2]);
+
+	float splits[CGD_MAX_SHADOW_CASCADES + 1];
+
+	ComputeSplits(nearPlane, farPlane, desc.cascadeCount, desc.splitLambda, splits);
+
+	uint64_t interval = 1;
+
+	for (uint32_t i = 0; i < desc.cascadeCount; i++, interval *= desc.staticUpdateRate) {
+
+		CGDShadowCascade& c = cascades[i];
+		float centreDepth, radius, centre[3], lightCentre[3];
+
+		SliceSphere(splits[i], splits[i + 1], proj[0], proj[5], &centreDepth, &radius);
+
+		for (int k = 0; k < 3; k++)
+			centre[k] = eye[k] + axisZ[k] * centreDepth;
+
+		for (int k = 0; k < 3; k++)
+			lightCentre[k] = Dot3(lightBasis[k], centre);
+
+		c.splitNear = splits[i];
+		c.splitFar = splits[i + 1];
+
+		if (!desc.cacheStatic) {
+
+			fitCascade(i, lightCentre, radius);
+			c.staticDirty = true;
+			stats[i].refits++;
+
+		} else if (force || frame - lastRefit[i] >= interval || !coversSlice(i, lightCentre, radius)) {
+
+			// The static layer is only redrawn if the refit moved the cascade
+			float previousCentre[3] = { c.centre[0], c.centre[1], c.centre[2] }, previousRadius = c.radius;
+
+			fitCascade(i, lightCentre, radius * (1.0f + desc.cachePadding));
+			c.staticDirty = force || memcmp(previousCentre, c.centre, sizeof(previousCentre)) != 0 || previousRadius != c.radius;
+			lastRefit[i] = frame;
+			stats[i].refits++;
+
+		} else {
+
+			c.staticDirty = false;
+		}
+	}
+
+	// Move the casters to light space once and cull them against each cascade's box
+	lightSpaceCasters.resize(count * 4);
+
+	for (uint32_t j = 0; j < count; j++) {
+
+		float *l = &lightSpaceCasters[j * 4];
+
+		for (int k = 0; k < 3; k++)
+			l[k] = Dot3(lightBasis[k], casters[j].sphere);
+
+		l[3] = casters[j].sphere[3];
+	}
+
+	for (uint32_t i = 0; i < desc.cascadeCount; i++) {
+
+		const CGDShadowCascade& c = cascades[i];
+		float zNear = c.centre[2] - c.radius - desc.casterDistance;
+		float zFar = c.centre[2] + c.radius;
+
+		staticCasters[i].clear();
+		dynamicCasters[i].clear();
+
+		for (uint32_t j = 0; j < count; j++) {
+
+			const float *l = &lightSpaceCasters[j * 4];
+
+			if (fabsf(l[0] - c.centre[0]) <= c.radius + l[3] && fabsf(l[1] - c.centre[1]) <= c.radius + l[3] && l[2] + l[3] >= zNear && l[2] - l[3] <= zFar) {
+
+				if (casters[j].isStatic)
+					staticCasters[i].push_back(j);
+				else
+					dynamicCasters[i].push_back(j);
+			}
+		}
+
+		uint32_t drawn = (uint32_t)dynamicCasters[i].size() + ((c.staticDirty) ? (uint32_t)staticCasters[i].size() : 0);
+		CGDShadowStats& s = stats[i];
+
+		s.frames++;
+		s.staticRedraws += (c.staticDirty) ? 1 : 0;
+		s.castersTested += count;
+		s.castersDrawn += drawn;
+		s.maxCastersDrawn = max(s.maxCastersDrawn, drawn);
+	}
+}
+
+
+void CGDCascadedShadows::invalidate() {
+
+	fitted = false;
+}
+
+
+const CGDShadowDesc& CGDCascadedShadows::getDesc() const {
+
+	return desc;
+}
+
+
+uint32_t CGDCascadedShadows::getCascadeCount() const {
+
+	return desc.cascadeCount;
+}
+
+
+const CGDShadowCascade& CGDCascadedShadows::getCascade(uint32_t i) const {
+
+	return cascades[i];
+}
+
+
+const vector<uint32_t>& CGDCascadedShadows::getStaticCasters(uint32_t i) const {
+
+	return staticCasters[i];
+}
+
+
+const vector<uint32_t>& CGDCascadedShadows::getDynamicCasters(uint32_t i) const {
+
+	return dynamicCasters[i];
+}
+
+
+const CGDShadowStats& CGDCascadedShadows::getStats(uint32_t i) const {
+
+	return stats[i];
+}
+
+
+void CGDCascadedShadows::resetStats() {
+
+	for (uint32_t i = 0; i < CGD_MAX_SHADOW_CASCADES; i++)
+		stats[i] = CGDShadowStats();
+}
+
+
+void CGDCascadedShadows::reportStats() const {
+
+	ostringstream report;
+
+	report << fixed << setprecision(1);
+
+	for (uint32_t i = 0; i < desc.cascadeCount; i++) {
+
+		const CGDShadowStats& s = stats[i];
+		double frames = (double)max(s.frames, (uint64_t)1);
+
+		report << "Shadow cascade " << i << " (" << cascades[i].splitNear << " - " << cascades[i].splitFar << "): " << (double)s.castersDrawn / frames << " casters drawn per frame (max " << s.maxCastersDrawn << ") of " << (double)s.castersTested / frames << " tested, " << s.refits << " refits and " << s.staticRedraws << " static redraws in " << s.frames << " frames\n";
+	}
+
+	cout << report.str();
+}
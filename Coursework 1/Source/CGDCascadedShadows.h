@@ -0,0 +1,143 @@
+//
+// CGDCascadedShadows.h
+//
+
+// Cascaded shadow maps for a directional light - the CPU side of DXShadowMaps.  The camera's view depth range up to shadowDistance is split into cascadeCount slices with the practical split scheme (Zhang et al., "Parallel-Split Shadow Maps", 2006) - a blend of logarithmic splits, which keep the texel density even over depth, and uniform splits, which stop the near cascades from becoming too small - and each slice is given its own orthographic shadow map along the light.
+//
+// Cascades are fitted for stability rather than tightness (Valient, "Stable Rendering of Cascaded Shadow Maps", ShaderX6).  Each slice is bounded by a sphere whose radius only depends on the split depths and the projection, so the size of a cascade does not change as the camera turns, and the cascade's centre is snapped to whole shadow map texels in a light space basis that is fixed for the light direction, so the texels of a cascade only move in whole texel steps as the camera moves and shadow edges do not shimmer.
+//
+// Every frame the casters (bounding spheres) are moved into light space once and culled against each cascade's box, which is extended casterDistance towards the light so casters outside the slice still shadow it.  Casters are static or dynamic.  With cacheStatic the static casters of a cascade are drawn into a cached layer that is only redrawn when the cascade's fit changes and the dynamic casters are drawn over a copy of it each frame.  Cached cascade i is refitted every staticUpdateRate^i frames (or sooner if the camera leaves it) and is fitted with cachePadding extra radius so it keeps covering its slice between refits - distant cascades, whose texels are large, are refitted and redrawn least often.
+
+#pragma once
+
+#include <GUObject.h>
+#include <cstdint>
+#include <vector>
+
+
+// Cascades supported by the shaders (see per_pixel_lighting_ps.hlsl)
+#define CGD_MAX_SHADOW_CASCADES			4
+
+
+struct CGDShadowDesc {
+
+	uint32_t				cascadeCount = 4; // 1 .. CGD_MAX_SHADOW_CASCADES
+	uint32_t				resolution = 2048; // texels per side of each cascade's shadow map (even)
+	float					splitLambda = 0.75f; // 0 = uniform splits, 1 = logarithmic splits
+	float					shadowDistance = 150.0f; // view depth the last cascade ends at (clamped to the far plane)
+	float					casterDistance = 100.0f; // casters this far beyond a cascade towards the light are kept
+	bool					cacheStatic = false;
+	uint32_t				staticUpdateRate = 2; // cached cascade i is refitted every staticUpdateRate^i frames
+	float					cachePadding = 0.1f; // extra radius of cached cascades (fraction of the slice radius)
+};
+
+
+// Shadow caster - a world space bounding sphere (centre and radius).  Static casters do not move and can be cached
+struct CGDShadowCaster {
+
+	float					sphere[4];
+	bool					isStatic;
+};
+
+
+struct CGDShadowCascade {
+
+	float					viewProj[16]; // world to shadow clip space (row-major, row vectors - XMFLOAT4X4)
+	float					splitNear; // view depth range of the cascade's slice
+	float					splitFar;
+	float					centre[3]; // light space centre of the cascade (x and y snapped to whole texels)
+	float					radius; // half the width of the cascade in world units (the fitted radius plus one texel)
+	float					texelSize; // world units per shadow map texel
+	bool					staticDirty; // the static casters must be redrawn this frame (always true without cacheStatic)
+};
+
+
+// Counters of a cascade since the last resetStats
+struct CGDShadowStats {
+
+	uint64_t				frames = 0;
+	uint64_t				refits = 0; // frames the cascade was fitted to the camera
+	uint64_t				staticRedraws = 0; // frames the static casters were drawn
+	uint64_t				castersTested = 0;
+	uint64_t				castersDrawn = 0; // static casters drawn on staticDirty frames plus dynamic casters
+	uint32_t				maxCastersDrawn = 0; // in a single frame
+};
+
+
+class CGDCascadedShadows : public GUObject {
+
+	CGDShadowDesc					desc;
+
+	// Light space basis - rows are the right, up and forward (light direction) axes.  Fixed for a light direction so snapped cascades are stable
+	float							lightBasis[3][3];
+	bool							fitted = false; // false until the first update and after invalidate
+
+	// Projection and light direction of the last fit.  Cached cascades are refitted when either changes
+	float							fitProj[4]; // _11, _22, _33 and _43
+	float							fitLight[3];
+
+	uint64_t						frame = 0;
+	CGDShadowCascade				cascades[CGD_MAX_SHADOW_CASCADES];
+	uint64_t						lastRefit[CGD_MAX_SHADOW_CASCADES];
+
+	// Casters of the last update in light space (x, y, z, radius) and the casters of each cascade
+	std::vector<float>				lightSpaceCasters;
+	std::vector<uint32_t>			staticCasters[CGD_MAX_SHADOW_CASCADES];
+	std::vector<uint32_t>			dynamicCasters[CGD_MAX_SHADOW_CASCADES];
+
+	CGDShadowStats					stats[CGD_MAX_SHADOW_CASCADES];
+
+
+	//
+	// Private interface
+	//
+
+	// Constructor - called internally by the CreateCascadedShadows factory method
+	CGDCascadedShadows(const CGDShadowDesc& desc);
+
+	// Set the light space basis for a light direction
+	void setLightDirection(const float lightDirection[3]);
+
+	// Fit cascade i to a slice sphere (light space centre and radius)
+	void fitCascade(uint32_t i, const float lightCentre[3], float radius);
+
+	// Return true if the slice sphere (light space centre and radius) is inside cascade i
+	bool coversSlice(uint32_t i, const float lightCentre[3], float radius) const;
+
+
+public:
+
+	//
+	// Public interface
+	//
+
+	// Factory method.  Return nullptr if desc is invalid (no cascades or more than CGD_MAX_SHADOW_CASCADES, an odd resolution or splitLambda outside [0, 1])
+	static CGDCascadedShadows* CreateCascadedShadows(const CGDShadowDesc& desc = CGDShadowDesc());
+
+	// Destructor
+	~CGDCascadedShadows();
+
+	// Split depths of count cascades from nearPlane to farPlane.  splits receives count + 1 depths from nearPlane to farPlane
+	static void ComputeSplits(float nearPlane, float farPlane, uint32_t count, float lambda, float *splits);
+
+	// Centre depth and radius of the smallest sphere centred on the view axis that holds the slice [splitNear, splitFar] of a projection with x and y scales projX and projY (_11 and _22)
+	static void SliceSphere(float splitNear, float splitFar, float projX, float projY, float *centreDepth, float *radius);
+
+	// Fit the cascades to a camera - row-major view and projection matrices with row vectors (XMFLOAT4X4) - and a light travelling in lightDirection, then cull casters against each cascade
+	void update(const float view[16], const float proj[16], const float lightDirection[3], const CGDShadowCaster *casters, uint32_t count);
+
+	// Refit every cascade and redraw its static casters on the next update (eg. if static casters have moved)
+	void invalidate();
+
+	// Query methods
+	const CGDShadowDesc& getDesc() const;
+	uint32_t getCascadeCount() const;
+	const CGDShadowCascade& getCascade(uint32_t i) const;
+	const std::vector<uint32_t>& getStaticCasters(uint32_t i) const; // indices into the casters of the last update
+	const std::vector<uint32_t>& getDynamicCasters(uint32_t i) const;
+	const CGDShadowStats& getStats(uint32_t i) const;
+
+	// Statistics
+	void resetStats();
+	void reportStats() const;
+};
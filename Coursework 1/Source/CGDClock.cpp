@@ -5,9 +5,15 @@
 
 #include <stdafx.h>
 #include <CGDClock.h>
-#include <Windows.h>
+#include <CGDFrameTimeLog.h>
 #include <iostream>
 
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <time.h>
+#endif
+
 using namespace std;
 
 
@@ -113,7 +119,8 @@ public:
 
 	gu_seconds averageFPS() const {
 		
-		return ((gu_seconds)_averageFPS) / (gu_seconds)_fpsCounts;
+		// No complete 1 second window has been tracked yet so report the current (zero) value rather than dividing by zero
+		return (_fpsCounts > 0) ? ((gu_seconds)_averageFPS) / (gu_seconds)_fpsCounts : _framesPerSecond;
 	}
 
 	gu_seconds secondsPerFrame() const {
@@ -133,7 +140,7 @@ public:
 
 	gu_seconds averageSPF() const {
 		
-		return _averageSPF / (gu_seconds)_fpsCounts;
+		return (_fpsCounts > 0) ? _averageSPF / (gu_seconds)_fpsCounts : _secondsPerFrame;
 	}
 
 };
@@ -154,6 +161,7 @@ public:
 CGDClock::CGDClock(const string& clockName, const gu_seconds startDelay) {
 
 	frameCounter = new GUFrameCounter();
+	frameTimeLog = CGDFrameTimeLog::CreateFrameTimeLog();
 
 	if (frameCounter) {
 
@@ -186,17 +194,50 @@ CGDClock::CGDClock(const string& clockName, const gu_seconds startDelay) {
 //
 
 
-// Get the actual system clock time index
+// Get the actual system clock time index.  On Windows this is the performance counter, otherwise the monotonic clock is used with a resolution of 1ns
 gu_time_index CGDClock::ActualTime() {
 
 	gu_time_index t;
 
+#ifdef _WIN32
+
 	QueryPerformanceCounter((LARGE_INTEGER*)&t);
 
+#else
+
+	timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	t = (gu_time_index)ts.tv_sec * 1000000000LL + (gu_time_index)ts.tv_nsec;
+
+#endif
+
 	return t;
 }
 
 
+// Get the number of clock ticks per second of the time index returned by ActualTime.  0 is returned if no high resolution clock is available
+gu_time_index CGDClock::ActualTimeFrequency() {
+
+	gu_time_index f = 0;
+
+#ifdef _WIN32
+
+	QueryPerformanceFrequency((LARGE_INTEGER*)&f);
+
+#else
+
+	timespec ts;
+
+	if (clock_getres(CLOCK_MONOTONIC, &ts) == 0)
+		f = 1000000000LL;
+
+#endif
+
+	return f;
+}
+
+
 // Convert time interval measured in clock ticks into seconds (gu_seconds)
 gu_seconds CGDClock::ConvertTimeIntervalToSeconds(gu_time_interval t) {
 
@@ -207,16 +248,16 @@ gu_seconds CGDClock::ConvertTimeIntervalToSeconds(gu_time_interval t) {
 // Clock factory method
 CGDClock* CGDClock::CreateClock(const string& clockName, const gu_seconds startDelay) {
 
-	static BOOL performanceFrequencyAcquired = FALSE;
+	static bool performanceFrequencyAcquired = false;
 
 	if (!performanceFrequencyAcquired) {
 
-		QueryPerformanceFrequency((LARGE_INTEGER*)&performanceFrequency);
+		performanceFrequency = CGDClock::ActualTimeFrequency();
 
 		if (performanceFrequency != 0) {
 
 			// Valid high-performance counter present
-			performanceFrequencyAcquired = TRUE;
+			performanceFrequencyAcquired = true;
 			timeRecip = 1.0 / (gu_seconds)performanceFrequency;
 
 		}
@@ -242,6 +283,9 @@ CGDClock::~CGDClock(void) {
 
 	if (frameCounter)
 		frameCounter->release();
+
+	if (frameTimeLog)
+		frameTimeLog->release();
 }
 
 
@@ -304,6 +348,9 @@ void CGDClock::tick() {
 
 	if (frameCounter)
 		frameCounter->updateFrameCounterForElaspsedTime(CGDClock::ConvertTimeIntervalToSeconds((currentTimeIndex - baseTime) - totalStopTime));
+
+	if (frameTimeLog)
+		frameTimeLog->record(CGDClock::ConvertTimeIntervalToSeconds(deltaTime) * 1000.0);
 }
 
 
@@ -324,6 +371,9 @@ void CGDClock::reset() {
 
 	if (frameCounter)
 		frameCounter->resetCounter();
+
+	if (frameTimeLog)
+		frameTimeLog->clear();
 }
 
 
@@ -368,6 +418,9 @@ void CGDClock::reportTimingData() const {
 		cout << "Min SPF = " << (frameCounter->minimumSPF()) << endl;
 		cout << "Average SPF = " << (frameCounter->averageSPF()) << endl;
 	}
+
+	if (frameTimeLog)
+		frameTimeLog->reportTimingData();
 }
 
 
@@ -417,3 +470,10 @@ gu_seconds CGDClock::averageSPF() const {
 
 	return (frameCounter) ? frameCounter->averageSPF() : 0.0;
 }
+
+
+// Return the per-frame duration log.  The log is owned by the clock
+CGDFrameTimeLog* CGDClock::frameTimes() const {
+
+	return frameTimeLog;
+}
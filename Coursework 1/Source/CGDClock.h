@@ -16,6 +16,7 @@ typedef long long gu_time_interval;
 typedef double gu_seconds;
 
 class GUFrameCounter;
+class CGDFrameTimeLog;
 
 
 class CGDClock : public GUObject {
@@ -36,6 +37,7 @@ class CGDClock : public GUObject {
 	gu_seconds				deferredStartCounter = 0.0;
 
 	GUFrameCounter			*frameCounter = nullptr;
+	CGDFrameTimeLog			*frameTimeLog = nullptr; // Per-frame durations for percentile / histogram reporting
 
 	std::string				_clockName;
 
@@ -57,6 +59,9 @@ public:
 	// Get the actual system clock time index
 	static gu_time_index ActualTime();
 
+	// Get the number of clock ticks per second of the time index returned by ActualTime
+	static gu_time_index ActualTimeFrequency();
+
 	// Convert time interval measured in clock ticks into seconds (gu_seconds)
 	static gu_seconds ConvertTimeIntervalToSeconds(gu_time_interval t);
 
@@ -95,4 +100,7 @@ public:
 	gu_seconds minimumSPF() const;
 	gu_seconds maximumSPF() const;
 	gu_seconds averageSPF() const;
+
+	// Per-frame duration log (p50 / p95 / p99 / max, histograms and CSV / JSON export)
+	CGDFrameTimeLog* frameTimes() const;
 };
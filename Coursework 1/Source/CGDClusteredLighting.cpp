@@ -0,0 +1,654 @@
+
+//
+// CGDClusteredLighting.cpp
+//
+
+#include <stdafx.h>
+#include <CGDClusteredLighting.h>
+#include <CGDClock.h>
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+#include <emmintrin.h>
+
+using namespace std;
+
+
+static const uint32_t		numSamplePoints = 65536; // points checked by benchmark
+
+
+// Uniform random number in [0, 1) (xorshift)
+static float RandomFloat(uint32_t& state) {
+
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+
+	return (float)(state >> 8) / 16777216.0f;
+}
+
+
+// Index of the lowest set bit
+static inline uint32_t LowestBit(uint32_t mask) {
+
+	uint32_t i = 0;
+
+	while (!(mask & (1u << i)))
+		i++;
+
+	return i;
+}
+
+
+
+//
+// Light helpers
+//
+
+CGDLight CGDPointLight(const float position[3], float range, const float colour[3]) {
+
+	CGDLight light;
+
+	memset(&light, 0, sizeof(CGDLight));
+
+	for (int i = 0; i < 3; i++) {
+
+		light.position[i] = position[i];
+		light.colour[i] = colour[i];
+	}
+
+	light.range = range;
+	light.type = CGDLightType::POINT;
+	light.direction[1] = -1.0f;
+	light.spotCosOuter = -1.0f;
+	light.spotCosInner = -1.0f;
+
+	return light;
+}
+
+
+CGDLight CGDSpotLight(const float position[3], const float direction[3], float range, float innerAngle, float outerAngle, const float colour[3]) {
+
+	CGDLight light = CGDPointLight(position, range, colour);
+	float length = sqrtf(direction[0] * direction[0] + direction[1] * direction[1] + direction[2] * direction[2]);
+
+	if (length > 0.0f) {
+
+		for (int i = 0; i < 3; i++)
+			light.direction[i] = direction[i] / length;
+	}
+
+	outerAngle = min(max(outerAngle, 0.0f), 3.14159265f);
+	innerAngle = min(max(innerAngle, 0.0f), outerAngle);
+
+	light.type = CGDLightType::SPOT;
+	light.spotCosOuter = cosf(outerAngle);
+	light.spotCosInner = cosf(innerAngle);
+
+	return light;
+}
+
+
+void CGDLightBounds(const CGDLight& light, float sphere[4]) {
+
+	float c = light.spotCosOuter;
+	float offset = 0.0f;
+
+	sphere[3] = light.range;
+
+	if (light.type == CGDLightType::SPOT && c > 0.0f) {
+
+		if (c < 0.70710678f) {
+
+			// Cone wider than 90 degrees - the sphere through the rim centred on the axis
+			offset = light.range * c;
+			sphere[3] = light.range * sqrtf(1.0f - c * c);
+
+		} else {
+
+			// Narrow cone - the sphere through the apex and the rim
+			offset = light.range / (2.0f * c);
+			sphere[3] = offset;
+		}
+	}
+
+	for (int i = 0; i < 3; i++)
+		sphere[i] = light.position[i] + light.direction[i] * offset;
+}
+
+
+bool CGDLightReaches(const CGDLight& light, const float point[3]) {
+
+	float d[3] = { point[0] - light.position[0], point[1] - light.position[1], point[2] - light.position[2] };
+	float distanceSq = d[0] * d[0] + d[1] * d[1] + d[2] * d[2];
+
+	if (distanceSq > light.range * light.range)
+		return false;
+
+	if (light.type != CGDLightType::SPOT)
+		return true;
+
+	return d[0] * light.direction[0] + d[1] * light.direction[1] + d[2] * light.direction[2] >= light.spotCosOuter * sqrtf(distanceSq);
+}
+
+
+
+//
+// Private interface
+//
+
+// Constructor - called internally by the CreateClusteredLighting factory method
+CGDClusteredLighting::CGDClusteredLighting(const CGDClusterGridDesc& _desc) {
+
+	desc = _desc;
+	numClusters = desc.tilesX * desc.tilesY * desc.slices;
+	rowPitch = (desc.tilesX + 3) & ~3u;
+
+	for (int i = 0; i < 16; i++)
+		viewMatrix[i] = (i % 5 == 0) ? 1.0f : 0.0f;
+
+	// Slice k covers view depths near * (far / near) ^ (k / slices) to near * (far / near) ^ ((k + 1) / slices)
+	sliceScale = (float)desc.slices / logf(desc.farPlane / desc.nearPlane);
+	sliceBias = -logf(desc.nearPlane) * sliceScale;
+
+	sliceDepths.resize(desc.slices + 1);
+
+	for (uint32_t k = 0; k <= desc.slices; k++)
+		sliceDepths[k] = desc.nearPlane * powf(desc.farPlane / desc.nearPlane, (float)k / (float)desc.slices);
+
+	sliceDepths[desc.slices] = desc.farPlane;
+
+	tileMinX.resize(desc.slices * rowPitch);
+	tileMaxX.resize(desc.slices * rowPitch);
+	tileMinY.resize(desc.slices * desc.tilesY);
+	tileMaxY.resize(desc.slices * desc.tilesY);
+
+	clusterLights.assign(numClusters * 2, 0);
+
+	buildClusterBounds();
+}
+
+
+void CGDClusteredLighting::buildClusterBounds() {
+
+	for (uint32_t k = 0; k < desc.slices; k++) {
+
+		float z0 = sliceDepths[k];
+		float z1 = sliceDepths[k + 1];
+
+		// A tile's edges in normalised device coordinates spread out linearly with depth so the box of a cluster is bounded by its edges at the slice's near and far depths
+		for (uint32_t i = 0; i < rowPitch; i++) {
+
+			float *minX = &tileMinX[k * rowPitch + i];
+			float *maxX = &tileMaxX[k * rowPitch + i];
+
+			if (i < desc.tilesX) {
+
+				float left = -1.0f + 2.0f * (float)i / (float)desc.tilesX;
+				float right = -1.0f + 2.0f * (float)(i + 1) / (float)desc.tilesX;
+
+				*minX = min(left * z0, left * z1) / projScaleX;
+				*maxX = max(right * z0, right * z1) / projScaleX;
+
+			} else {
+
+				*minX = FLT_MAX;
+				*maxX = -FLT_MAX;
+			}
+		}
+
+		for (uint32_t j = 0; j < desc.tilesY; j++) {
+
+			float top = 1.0f - 2.0f * (float)j / (float)desc.tilesY;
+			float bottom = 1.0f - 2.0f * (float)(j + 1) / (float)desc.tilesY;
+
+			tileMinY[k * desc.tilesY + j] = min(bottom * z0, bottom * z1) / projScaleY;
+			tileMaxY[k * desc.tilesY + j] = max(top * z0, top * z1) / projScaleY;
+		}
+	}
+}
+
+
+void CGDClusteredLighting::boundLights(const CGDLight *lights, uint32_t count, bool reference) {
+
+	numLights = count;
+	spherePitch = (count + 3) & ~3u;
+
+	worldSpheres.resize(spherePitch * 4);
+	viewSpheres.resize(spherePitch * 4);
+
+	float *wx = worldSpheres.data();
+	float *wy = wx + spherePitch;
+	float *wz = wy + spherePitch;
+	float *wr = wz + spherePitch;
+	float *vx = viewSpheres.data();
+	float *vy = vx + spherePitch;
+	float *vz = vy + spherePitch;
+	float *vr = vz + spherePitch;
+
+	for (uint32_t l = 0; l < spherePitch; l++) {
+
+		float sphere[4] = { 0.0f, 0.0f, 0.0f, -1.0f }; // padding lights have a negative radius
+
+		if (l < count)
+			CGDLightBounds(lights[l], sphere);
+
+		wx[l] = sphere[0];
+		wy[l] = sphere[1];
+		wz[l] = sphere[2];
+		wr[l] = sphere[3];
+	}
+
+	const float *m = viewMatrix;
+
+	if (reference) {
+
+		for (uint32_t l = 0; l < count; l++) {
+
+			vx[l] = wx[l] * m[0] + wy[l] * m[4] + wz[l] * m[8] + m[12];
+			vy[l] = wx[l] * m[1] + wy[l] * m[5] + wz[l] * m[9] + m[13];
+			vz[l] = wx[l] * m[2] + wy[l] * m[6] + wz[l] * m[10] + m[14];
+			vr[l] = wr[l];
+		}
+
+		return;
+	}
+
+	// 4 spheres at a time with the terms summed in the same order as the reference
+	__m128 m0 = _mm_set1_ps(m[0]), m1 = _mm_set1_ps(m[1]), m2 = _mm_set1_ps(m[2]);
+	__m128 m4 = _mm_set1_ps(m[4]), m5 = _mm_set1_ps(m[5]), m6 = _mm_set1_ps(m[6]);
+	__m128 m8 = _mm_set1_ps(m[8]), m9 = _mm_set1_ps(m[9]), m10 = _mm_set1_ps(m[10]);
+	__m128 m12 = _mm_set1_ps(m[12]), m13 = _mm_set1_ps(m[13]), m14 = _mm_set1_ps(m[14]);
+
+	for (uint32_t l = 0; l < spherePitch; l += 4) {
+
+		__m128 x = _mm_loadu_ps(wx + l);
+		__m128 y = _mm_loadu_ps(wy + l);
+		__m128 z = _mm_loadu_ps(wz + l);
+
+		_mm_storeu_ps(vx + l, _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, m0), _mm_mul_ps(y, m4)), _mm_mul_ps(z, m8)), m12));
+		_mm_storeu_ps(vy + l, _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, m1), _mm_mul_ps(y, m5)), _mm_mul_ps(z, m9)), m13));
+		_mm_storeu_ps(vz + l, _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, m2), _mm_mul_ps(y, m6)), _mm_mul_ps(z, m10)), m14));
+		_mm_storeu_ps(vr + l, _mm_loadu_ps(wr + l));
+	}
+}
+
+
+float CGDClusteredLighting::boxDistanceSq(uint32_t slice, uint32_t tileY, uint32_t tileX, const float centre[3]) const {
+
+	float dx = max(max(tileMinX[slice * rowPitch + tileX] - centre[0], centre[0] - tileMaxX[slice * rowPitch + tileX]), 0.0f);
+	float dy = max(max(tileMinY[slice * desc.tilesY + tileY] - centre[1], centre[1] - tileMaxY[slice * desc.tilesY + tileY]), 0.0f);
+	float dz = max(max(sliceDepths[slice] - centre[2], centre[2] - sliceDepths[slice + 1]), 0.0f);
+
+	return (dx * dx + dy * dy) + dz * dz;
+}
+
+
+
+//
+// Public interface
+//
+
+// Factory method
+CGDClusteredLighting* CGDClusteredLighting::CreateClusteredLighting(const CGDClusterGridDesc& desc) {
+
+	if (desc.tilesX == 0 || desc.tilesY == 0 || desc.slices == 0 || desc.nearPlane <= 0.0f || desc.farPlane <= desc.nearPlane)
+		return nullptr;
+
+	return new CGDClusteredLighting(desc);
+}
+
+
+// Destructor
+CGDClusteredLighting::~CGDClusteredLighting() {
+}
+
+
+void CGDClusteredLighting::setView(const float view[16], const float proj[16]) {
+
+	memcpy(viewMatrix, view, sizeof(viewMatrix));
+
+	if (proj[0] != projScaleX || proj[5] != projScaleY) {
+
+		projScaleX = proj[0];
+		projScaleY = proj[5];
+
+		buildClusterBounds();
+	}
+}
+
+
+void CGDClusteredLighting::assign(const CGDLight *lights, uint32_t count) {
+
+	PROFILE_SCOPE("CGDClusteredLighting::assign");
+
+	boundLights(lights, count, false);
+
+	const float *vx = viewSpheres.data();
+	const float *vy = vx + spherePitch;
+	const float *vz = vy + spherePitch;
+	const float *vr = vz + spherePitch;
+	uint32_t groups = rowPitch / 4;
+
+	pairClusters.clear();
+	pairLights.clear();
+
+	for (uint32_t l = 0; l < count; l++) {
+
+		float cx = vx[l], cy = vy[l], cz = vz[l], r = vr[l];
+		float r2 = r * r;
+
+		if (r < 0.0f || cz + r < desc.nearPlane || cz - r > desc.farPlane)
+			continue;
+
+		// Slices the sphere's depth range falls in, widened by a slice either side so rounding in the slice function never drops one (slices the sphere misses fail the depth test below)
+		float zNear = min(max(cz - r, desc.nearPlane), desc.farPlane);
+		float zFar = min(max(cz + r, desc.nearPlane), desc.farPlane);
+		int32_t k0 = max((int32_t)floorf(logf(zNear) * sliceScale + sliceBias) - 1, 0);
+		int32_t k1 = min((int32_t)floorf(logf(zFar) * sliceScale + sliceBias) + 1, (int32_t)desc.slices - 1);
+
+		__m128 centreX = _mm_set1_ps(cx);
+		__m128 radiusSq = _mm_set1_ps(r2);
+		__m128 zero = _mm_setzero_ps();
+
+		for (int32_t k = k0; k <= k1; k++) {
+
+			// The box distance is summed as (dx^2 + dy^2) + dz^2 - each partial sum below can only be smaller so a slice or row that fails on it fails the full test
+			float dz = max(max(sliceDepths[k] - cz, cz - sliceDepths[k + 1]), 0.0f);
+			float dz2 = dz * dz;
+
+			if (dz2 > r2)
+				continue;
+
+			const float *minY = &tileMinY[k * desc.tilesY];
+			const float *maxY = &tileMaxY[k * desc.tilesY];
+			const float *minX = &tileMinX[k * rowPitch];
+			const float *maxX = &tileMaxX[k * rowPitch];
+
+			// Tile boxes widen from left to right so no tile is nearer in x than the slice's outer edges (skips lights beside the view)
+			float dxSlice = max(max(minX[0] - cx, cx - maxX[desc.tilesX - 1]), 0.0f);
+
+			if (dxSlice * dxSlice + dz2 > r2)
+				continue;
+
+			__m128 dzSq = _mm_set1_ps(dz2);
+
+			for (uint32_t j = 0; j < desc.tilesY; j++) {
+
+				float dy = max(max(minY[j] - cy, cy - maxY[j]), 0.0f);
+				float dy2 = dy * dy;
+
+				if (dy2 + dz2 > r2)
+					continue;
+
+				__m128 dySq = _mm_set1_ps(dy2);
+				uint32_t rowCluster = (k * desc.tilesY + j) * desc.tilesX;
+
+				for (uint32_t g = 0; g < groups; g++) {
+
+					__m128 dx = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(minX + g * 4), centreX), _mm_sub_ps(centreX, _mm_loadu_ps(maxX + g * 4))), zero);
+					__m128 d2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), dySq), dzSq);
+					uint32_t mask = (uint32_t)_mm_movemask_ps(_mm_cmple_ps(d2, radiusSq));
+
+					while (mask) {
+
+						uint32_t i = LowestBit(mask);
+
+						pairClusters.push_back(rowCluster + g * 4 + i);
+						pairLights.push_back(l);
+						mask &= mask - 1;
+					}
+				}
+			}
+		}
+	}
+
+	// Counting sort of the pairs into the cluster lists.  Pairs are in light order so each list is in increasing light order
+	uint32_t *grid = clusterLights.data();
+
+	for (uint32_t c = 0; c < numClusters; c++)
+		grid[c * 2 + 1] = 0;
+
+	for (size_t p = 0; p < pairClusters.size(); p++)
+		grid[pairClusters[p] * 2 + 1]++;
+
+	uint32_t offset = 0;
+
+	for (uint32_t c = 0; c < numClusters; c++) {
+
+		grid[c * 2] = offset;
+		offset += grid[c * 2 + 1];
+		grid[c * 2 + 1] = 0;
+	}
+
+	lightIndices.resize(offset);
+
+	for (size_t p = 0; p < pairClusters.size(); p++) {
+
+		uint32_t *cluster = &grid[pairClusters[p] * 2];
+
+		lightIndices[cluster[0] + cluster[1]++] = pairLights[p];
+	}
+}
+
+
+void CGDClusteredLighting::assignReference(const CGDLight *lights, uint32_t count) {
+
+	PROFILE_SCOPE("CGDClusteredLighting::assignReference");
+
+	boundLights(lights, count, true);
+
+	const float *vx = viewSpheres.data();
+	const float *vy = vx + spherePitch;
+	const float *vz = vy + spherePitch;
+	const float *vr = vz + spherePitch;
+
+	lightIndices.clear();
+
+	for (uint32_t k = 0; k < desc.slices; k++) {
+
+		for (uint32_t j = 0; j < desc.tilesY; j++) {
+
+			for (uint32_t i = 0; i < desc.tilesX; i++) {
+
+				uint32_t c = (k * desc.tilesY + j) * desc.tilesX + i;
+
+				clusterLights[c * 2] = (uint32_t)lightIndices.size();
+
+				for (uint32_t l = 0; l < count; l++) {
+
+					float centre[3] = { vx[l], vy[l], vz[l] };
+
+					if (vr[l] >= 0.0f && boxDistanceSq(k, j, i, centre) <= vr[l] * vr[l])
+						lightIndices.push_back(l);
+				}
+
+				clusterLights[c * 2 + 1] = (uint32_t)lightIndices.size() - clusterLights[c * 2];
+			}
+		}
+	}
+}
+
+
+uint32_t CGDClusteredLighting::clusterIndex(const float viewPosition[3]) const {
+
+	float z = max(viewPosition[2], desc.nearPlane);
+	float ndcX = viewPosition[0] * projScaleX / z;
+	float ndcY = viewPosition[1] * projScaleY / z;
+
+	int32_t i = (int32_t)floorf((ndcX * 0.5f + 0.5f) * (float)desc.tilesX);
+	int32_t j = (int32_t)floorf((0.5f - ndcY * 0.5f) * (float)desc.tilesY);
+	int32_t k = (int32_t)floorf(logf(z) * sliceScale + sliceBias);
+
+	i = min(max(i, 0), (int32_t)desc.tilesX - 1);
+	j = min(max(j, 0), (int32_t)desc.tilesY - 1);
+	k = min(max(k, 0), (int32_t)desc.slices - 1);
+
+	return ((uint32_t)k * desc.tilesY + (uint32_t)j) * desc.tilesX + (uint32_t)i;
+}
+
+
+const CGDClusterGridDesc& CGDClusteredLighting::getDesc() const {
+
+	return desc;
+}
+
+
+uint32_t CGDClusteredLighting::getClusterCount() const {
+
+	return numClusters;
+}
+
+
+uint32_t CGDClusteredLighting::getLightCount() const {
+
+	return numLights;
+}
+
+
+const float* CGDClusteredLighting::getViewMatrix() const {
+
+	return viewMatrix;
+}
+
+
+float CGDClusteredLighting::getProjScaleX() const {
+
+	return projScaleX;
+}
+
+
+float CGDClusteredLighting::getProjScaleY() const {
+
+	return projScaleY;
+}
+
+
+float CGDClusteredLighting::getSliceScale() const {
+
+	return sliceScale;
+}
+
+
+float CGDClusteredLighting::getSliceBias() const {
+
+	return sliceBias;
+}
+
+
+const vector<uint32_t>& CGDClusteredLighting::getClusterLights() const {
+
+	return clusterLights;
+}
+
+
+const vector<uint32_t>& CGDClusteredLighting::getLightIndices() const {
+
+	return lightIndices;
+}
+
+
+uint32_t CGDClusteredLighting::getMaxClusterLights() const {
+
+	uint32_t maxLights = 0;
+
+	for (uint32_t c = 0; c < numClusters; c++)
+		maxLights = max(maxLights, clusterLights[c * 2 + 1]);
+
+	return maxLights;
+}
+
+
+bool CGDClusteredLighting::benchmark(const CGDLight *lights, uint32_t count, uint32_t frames) {
+
+	double frequency = (double)CGDClock::ActualTimeFrequency();
+	ostringstream report;
+
+	frames = max(frames, 1u);
+
+	report << fixed << setprecision(3);
+	report << "\nClustered lighting benchmark (" << count << " lights, " << desc.tilesX << " x " << desc.tilesY << " x " << desc.slices << " clusters)...\n";
+
+	// The fast path must give exactly the reference lists
+	assignReference(lights, count);
+
+	vector<uint32_t> referenceGrid = clusterLights;
+	vector<uint32_t> referenceIndices = lightIndices;
+
+	assign(lights, count);
+
+	bool matched = (clusterLights == referenceGrid && lightIndices == referenceIndices);
+
+	// Every light that reaches a point must be in the list of the point's cluster.  Points are spread over the view with depths uniform in log space (as the slices are)
+	const float *m = viewMatrix;
+	uint32_t state = 0x2545f491u, samplesLit = 0, missed = 0;
+
+	for (uint32_t s = 0; s < numSamplePoints; s++) {
+
+		float z = desc.nearPlane * powf(desc.farPlane / desc.nearPlane, RandomFloat(state));
+		float v[3] = { (RandomFloat(state) * 2.0f - 1.0f) * z / projScaleX, (RandomFloat(state) * 2.0f - 1.0f) * z / projScaleY, z };
+
+		// World position - the view matrix is a rotation followed by a translation
+		float t[3] = { v[0] - m[12], v[1] - m[13], v[2] - m[14] };
+		float w[3];
+
+		for (int i = 0; i < 3; i++)
+			w[i] = t[0] * m[i * 4] + t[1] * m[i * 4 + 1] + t[2] * m[i * 4 + 2];
+
+		uint32_t c = clusterIndex(v);
+		const uint32_t *list = lightIndices.data() + clusterLights[c * 2];
+		const uint32_t *listEnd = list + clusterLights[c * 2 + 1];
+		bool lit = false;
+
+		for (uint32_t l = 0; l < count; l++) {
+
+			if (CGDLightReaches(lights[l], w)) {
+
+				lit = true;
+
+				if (!binary_search(list, listEnd, l))
+					missed++;
+			}
+		}
+
+		if (lit)
+			samplesLit++;
+	}
+
+	// Assignment time per frame of each path
+	const char *names[2] = { "reference", "SSE" };
+	double seconds[2];
+
+	for (int path = 0; path < 2; path++) {
+
+		gu_time_index start = CGDClock::ActualTime();
+
+		for (uint32_t i = 0; i < frames; i++) {
+
+			if (path == 0)
+				assignReference(lights, count);
+			else
+				assign(lights, count);
+		}
+
+		seconds[path] = (double)(CGDClock::ActualTime() - start) / frequency / (double)frames;
+	}
+
+	uint32_t occupied = 0;
+
+	for (uint32_t c = 0; c < numClusters; c++) {
+
+		if (clusterLights[c * 2 + 1] > 0)
+			occupied++;
+	}
+
+	report << names[0] << ": " << seconds[0] * 1000.0 << " ms per frame, " << names[1] << ": " << seconds[1] * 1000.0 << " ms per frame (" << setprecision(1) << seconds[0] / max(seconds[1], 1e-9) << "x)\n" << setprecision(3);
+	report << "Light indices: " << lightIndices.size() << " in " << occupied << " of " << numClusters << " clusters (" << setprecision(1) << (double)lightIndices.size() / (double)max(occupied, 1u) << " per occupied cluster, longest list " << getMaxClusterLights() << ")\n" << setprecision(3);
+	report << "Fast path " << ((matched) ? "matches" : "does not match") << " the reference, " << missed << " lights missed at " << numSamplePoints << " sample points (" << samplesLit << " lit)\n";
+
+	cout << report.str();
+
+	return matched && missed == 0;
+}
@@ -0,0 +1,150 @@
+//
+// CGDClusteredLighting.h
+//
+
+// Clustered light assignment (Olsson, Billeter and Assarsson, "Clustered Deferred and Forward Shading", 2012).  The view frustum is divided into a grid of clusters - tilesX * tilesY screen tiles, each split into slices at exponentially increasing view depths between the near and far planes so clusters stay roughly cubic - and every frame each light is assigned to the clusters its volume touches.  A pixel shader finds the cluster of the point it shades from the point's view space position and only evaluates the lights in that cluster's list, so the cost of a pixel depends on the lights near it rather than on the number of lights in the scene (see DXClusteredLighting and per_pixel_lighting_ps.hlsl).
+//
+// Every light is bounded by a sphere (the range of a point light, the smallest sphere around the cone of a spot light) which is tested against the view space box of each cluster.  The output is a grid of (offset, count) pairs, one per cluster, into a single list of light indices in which each cluster's lights are in increasing index order.
+//
+// assign is the fast path - the spheres are moved to view space 4 at a time in SSE registers and each light only visits the slices and tile rows its sphere can reach, where the tiles of a row are tested 4 at a time.  assignReference tests every light against every cluster with scalar code and is what assign is validated against - both make the same sphere / box test so their outputs are identical.
+
+#pragma once
+
+#include <GUObject.h>
+#include <cstdint>
+#include <vector>
+
+
+// Light types (CGDLight::type)
+enum class CGDLightType : uint32_t { POINT = 0, SPOT };
+
+
+// Point or spot light in world space.  The layout matches the light buffer read by per_pixel_lighting_ps.hlsl (64 bytes)
+struct CGDLight {
+
+	float					position[3];
+	float					range; // the light's influence falls to 0 at this distance
+	float					colour[3];
+	CGDLightType			type;
+	float					direction[3]; // spot light axis (unit length)
+	float					spotCosOuter; // cos of the cone half angle
+	float					spotCosInner; // cos of the half angle inside which the spot light has full intensity
+	float					padding[3];
+};
+
+
+struct CGDClusterGridDesc {
+
+	uint32_t				tilesX = 16;
+	uint32_t				tilesY = 9;
+	uint32_t				slices = 24;
+	float					nearPlane = 1.0f; // view depth range the slices cover (the main camera's clip planes)
+	float					farPlane = 1000.0f;
+};
+
+
+// Light constructors.  Angles are cone half angles in radians and direction does not need to be normalised
+CGDLight CGDPointLight(const float position[3], float range, const float colour[3]);
+CGDLight CGDSpotLight(const float position[3], const float direction[3], float range, float innerAngle, float outerAngle, const float colour[3]);
+
+// Bounding sphere (centre and radius) of a light's volume
+void CGDLightBounds(const CGDLight& light, float sphere[4]);
+
+// Return true if point is inside the light's volume (within range and, for a spot light, inside the cone)
+bool CGDLightReaches(const CGDLight& light, const float point[3]);
+
+
+class CGDClusteredLighting : public GUObject {
+
+	CGDClusterGridDesc				desc;
+	uint32_t						numClusters = 0;
+
+	// View of the grid - row-major view matrix with row vectors (v * M) and the x and y scales of the projection (_11 and _22)
+	float							viewMatrix[16];
+	float							projScaleX = 1.0f;
+	float							projScaleY = 1.0f;
+
+	// Slice of a view depth z is floor(log(z) * sliceScale + sliceBias)
+	float							sliceScale = 0.0f;
+	float							sliceBias = 0.0f;
+
+	// View space boxes of the clusters.  Tile x bounds are stored per slice with the row padded to a multiple of 4 tiles (padding tiles are empty boxes so they never pass the test)
+	std::vector<float>				sliceDepths; // slices + 1 boundaries
+	uint32_t						rowPitch = 0; // tilesX padded to a multiple of 4
+	std::vector<float>				tileMinX; // slices * rowPitch
+	std::vector<float>				tileMaxX;
+	std::vector<float>				tileMinY; // slices * tilesY (tile row 0 is the top of the screen)
+	std::vector<float>				tileMaxY;
+
+	// World and view space bounding spheres of the lights being assigned (x, y, z and radius planes padded to a multiple of 4 lights)
+	std::vector<float>				worldSpheres;
+	std::vector<float>				viewSpheres;
+	uint32_t						spherePitch = 0;
+
+	// Fast path (cluster, light) pairs in light order before they are sorted into the cluster lists
+	std::vector<uint32_t>			pairClusters;
+	std::vector<uint32_t>			pairLights;
+
+	// Output
+	uint32_t						numLights = 0;
+	std::vector<uint32_t>			clusterLights; // offset into lightIndices and count of each cluster
+	std::vector<uint32_t>			lightIndices;
+
+
+	//
+	// Private interface
+	//
+
+	// Constructor - called internally by the CreateClusteredLighting factory method
+	CGDClusteredLighting(const CGDClusterGridDesc& desc);
+
+	// Compute the cluster boxes for the current projection
+	void buildClusterBounds();
+
+	// Bound the lights in world space and move the spheres to view space.  The reference transforms one sphere at a time
+	void boundLights(const CGDLight *lights, uint32_t count, bool reference);
+
+	// Squared distance from the sphere centre to a cluster box (the test both paths make)
+	float boxDistanceSq(uint32_t slice, uint32_t tileY, uint32_t tileX, const float centre[3]) const;
+
+
+public:
+
+	//
+	// Public interface
+	//
+
+	// Factory method.  Return nullptr if the grid is empty or the planes are not 0 < nearPlane < farPlane
+	static CGDClusteredLighting* CreateClusteredLighting(const CGDClusterGridDesc& desc = CGDClusterGridDesc());
+
+	// Destructor
+	~CGDClusteredLighting();
+
+	// Set the camera the clusters are built for - row-major view and projection matrices with row vectors (XMFLOAT4X4).  The cluster boxes are rebuilt if the projection changes
+	void setView(const float view[16], const float proj[16]);
+
+	// Assign count lights to the clusters with the fast path
+	void assign(const CGDLight *lights, uint32_t count);
+
+	// Assign count lights with the scalar reference implementation
+	void assignReference(const CGDLight *lights, uint32_t count);
+
+	// Cluster containing a view space position - the lookup per_pixel_lighting_ps.hlsl makes.  Positions outside the grid are clamped to the nearest cluster
+	uint32_t clusterIndex(const float viewPosition[3]) const;
+
+	// Query methods
+	const CGDClusterGridDesc& getDesc() const;
+	uint32_t getClusterCount() const;
+	uint32_t getLightCount() const; // lights in the last assignment
+	const float* getViewMatrix() const;
+	float getProjScaleX() const;
+	float getProjScaleY() const;
+	float getSliceScale() const;
+	float getSliceBias() const;
+	const std::vector<uint32_t>& getClusterLights() const; // 2 per cluster
+	const std::vector<uint32_t>& getLightIndices() const;
+	uint32_t getMaxClusterLights() const; // longest cluster list
+
+	// Report the assignment time per frame of the reference and the fast path over frames assignments of count lights, check the fast path against the reference and check that every light reaching a set of sample points in the view is in the list of the point's cluster.  Return false if either check fails
+	bool benchmark(const CGDLight *lights, uint32_t count, uint32_t frames);
+};
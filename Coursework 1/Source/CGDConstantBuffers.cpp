@@ -0,0 +1,233 @@
+
+//
+// CGDConstantBuffers.cpp
+//
+
+#include <stdafx.h>
+#include <CGDConstantBuffers.h>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+
+using namespace std;
+
+
+
+//
+// Private interface
+//
+
+// Constructor - called internally by the CreateConstantBuffers factory method
+CGDConstantBuffers::CGDConstantBuffers(CGDConstantBufferBackend *_backend, const CGDConstantBufferDesc& _desc) {
+
+	backend = _backend;
+	backend->retain();
+
+	desc = _desc;
+
+	frameData.resize(desc.frameSize, 0);
+	staging.resize(desc.maxObjects * CGD_CONSTANT_SLOT_SIZE, 0);
+
+	objectData.reserve(desc.maxObjects * desc.objectSize);
+	objectSlots.reserve(desc.maxObjects);
+	objectDirty.reserve(desc.maxObjects);
+	dirtyObjects.reserve(desc.maxObjects);
+
+	viewBytes = 0;
+	viewUploads = 0;
+}
+
+
+void CGDConstantBuffers::markDirty(uint32_t id) {
+
+	if (!objectDirty[id]) {
+
+		objectDirty[id] = 1;
+		dirtyObjects.push_back(id);
+	}
+}
+
+
+
+//
+// Public interface
+//
+
+// Factory method
+CGDConstantBuffers* CGDConstantBuffers::CreateConstantBuffers(CGDConstantBufferBackend *backend, const CGDConstantBufferDesc& desc) {
+
+	if (!backend || desc.frameSize == 0 || desc.viewSize == 0 || desc.objectSize == 0 || desc.maxObjects == 0 || (desc.frameSize & 15) || (desc.viewSize & 15) || (desc.objectSize & 15) || desc.objectSize > CGD_CONSTANT_SLOT_SIZE)
+		return nullptr;
+
+	if ((uint64_t)desc.maxObjects * CGD_CONSTANT_SLOT_SIZE > backend->objectBufferSize())
+		return nullptr;
+
+	return new CGDConstantBuffers(backend, desc);
+}
+
+
+// Destructor
+CGDConstantBuffers::~CGDConstantBuffers() {
+
+	backend->release();
+}
+
+
+uint32_t CGDConstantBuffers::addObject() {
+
+	uint32_t id = (uint32_t)objectSlots.size();
+
+	if (id >= desc.maxObjects)
+		return CGD_INVALID_CONSTANT_OBJECT;
+
+	objectData.resize(objectData.size() + desc.objectSize, 0);
+	objectSlots.push_back(0);
+	objectDirty.push_back(0);
+
+	// Not in the ring yet
+	markDirty(id);
+
+	return id;
+}
+
+
+void CGDConstantBuffers::setFrame(const void *data) {
+
+	if (memcmp(frameData.data(), data, desc.frameSize) == 0)
+		return;
+
+	memcpy(frameData.data(), data, desc.frameSize);
+	frameDirty = true;
+}
+
+
+void CGDConstantBuffers::setObject(uint32_t id, const void *data) {
+
+	uint8_t *constants = &objectData[id * desc.objectSize];
+
+	if (memcmp(constants, data, desc.objectSize) == 0)
+		return;
+
+	memcpy(constants, data, desc.objectSize);
+	markDirty(id);
+}
+
+
+void CGDConstantBuffers::flush() {
+
+	PROFILE_SCOPE("CGDConstantBuffers::flush");
+
+	stats.frames++;
+
+	if (frameDirty && backend->writeFrame(frameData.data(), desc.frameSize)) {
+
+		frameDirty = false;
+		stats.frameBytes += desc.frameSize;
+		stats.frameUploads++;
+	}
+
+	if (dirtyObjects.empty())
+		return;
+
+	// Append the dirty objects to the ring, or discard it and write every object from the start if they do not fit
+	uint32_t size = (uint32_t)dirtyObjects.size() * CGD_CONSTANT_SLOT_SIZE;
+	bool discard = !ringValid || !backend->canAppend() || head + size > backend->objectBufferSize();
+
+	if (discard) {
+
+		for (uint32_t id = 0; id < (uint32_t)objectSlots.size(); id++)
+			markDirty(id);
+
+		head = 0;
+		size = (uint32_t)dirtyObjects.size() * CGD_CONSTANT_SLOT_SIZE;
+	}
+
+	for (uint32_t i = 0; i < (uint32_t)dirtyObjects.size(); i++)
+		memcpy(&staging[i * CGD_CONSTANT_SLOT_SIZE], &objectData[dirtyObjects[i] * desc.objectSize], desc.objectSize);
+
+	if (!backend->writeObjects(head, staging.data(), size, discard)) {
+
+		// Nothing is known about the ring's contents - the objects stay dirty and the next flush discards it
+		ringValid = false;
+		return;
+	}
+
+	for (uint32_t i = 0; i < (uint32_t)dirtyObjects.size(); i++) {
+
+		uint32_t id = dirtyObjects[i];
+
+		objectSlots[id] = head + i * CGD_CONSTANT_SLOT_SIZE;
+		objectDirty[id] = 0;
+	}
+
+	stats.objectBytes += size;
+	stats.objectUploads++;
+	stats.objectsWritten += dirtyObjects.size();
+	stats.discards += (discard) ? 1 : 0;
+
+	head += size;
+	ringValid = true;
+	dirtyObjects.clear();
+}
+
+
+void CGDConstantBuffers::setView(void *context, const void *data) {
+
+	if (backend->writeView(context, data, desc.viewSize)) {
+
+		viewBytes += desc.viewSize;
+		viewUploads++;
+	}
+}
+
+
+CGDConstantBinding CGDConstantBuffers::getObjectBinding(uint32_t id) const {
+
+	CGDConstantBinding binding = { backend->objectBuffer(), objectSlots[id] / 16, CGD_CONSTANT_SLOT_CONSTANTS };
+
+	return binding;
+}
+
+
+const CGDConstantBufferDesc& CGDConstantBuffers::getDesc() const {
+
+	return desc;
+}
+
+
+uint32_t CGDConstantBuffers::objectCount() const {
+
+	return (uint32_t)objectSlots.size();
+}
+
+
+CGDConstantStats CGDConstantBuffers::getStats() const {
+
+	CGDConstantStats s = stats;
+
+	s.viewBytes = viewBytes;
+	s.viewUploads = viewUploads;
+
+	return s;
+}
+
+
+void CGDConstantBuffers::resetStats() {
+
+	stats = CGDConstantStats();
+	viewBytes = 0;
+	viewUploads = 0;
+}
+
+
+void CGDConstantBuffers::reportStats() const {
+
+	CGDConstantStats s = getStats();
+	double perFrame = 1.0 / (double)max(s.frames, (uint64_t)1);
+	ostringstream report;
+
+	report << fixed << setprecision(1);
+	report << "Constants per frame over " << s.frames << " frames: " << (double)(s.frameBytes + s.viewBytes + s.objectBytes) * perFrame << " bytes - frame " << (double)s.frameBytes * perFrame << " bytes (" << (double)s.frameUploads * perFrame << " uploads), view " << (double)s.viewBytes * perFrame << " bytes (" << (double)s.viewUploads * perFrame << " uploads), objects " << (double)s.objectBytes * perFrame << " bytes (" << (double)s.objectsWritten * perFrame << " objects in " << (double)s.objectUploads * perFrame << " uploads), " << s.discards << " ring discards" << endl;
+
+	cout << report.str();
+}
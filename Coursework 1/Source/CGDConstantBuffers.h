@@ -0,0 +1,152 @@
+//
+// CGDConstantBuffers.h
+//
+
+// Shader constants split by update frequency.  Rather than every draw uploading one structure holding everything its shaders read, constants are grouped by how often they change - a frame block (lights, time, wind) written once per frame, a view block (view projection, eye position) written once per pass and a small block per object (world matrices) - and each group is bound to its own register so a draw only changes the object binding.
+//
+// Object constants live in 256 byte slots of one large ring buffer.  setObject compares the new constants with the last ones and only marks the object dirty if they differ, so static objects are uploaded once.  flush copies the dirty objects into consecutive free slots at the head of the ring and uploads them with a single write that appends to the buffer (D3D11_MAP_WRITE_NO_OVERWRITE) - slots the GPU may still be reading are never touched.  When the ring is full (or the backend cannot append) the buffer is discarded (D3D11_MAP_WRITE_DISCARD), the head returns to the start and every object is written again since a discarded buffer's contents are undefined.  A draw binds its object's slot with a constant offset (see CGDConstantBinding and *SSetConstantBuffers1) so objects do not need a buffer each.
+//
+// The frame block is only uploaded when setFrame changes it.  Views are written on the context of the pass that draws them (passes may be recorded concurrently on deferred contexts, which each get their own copy of the view buffer) and the frame and view buffers are bound to that context at the same time.  Byte and upload counts of each group are kept per frame (see CGDConstantStats) so the traffic can be measured without a device (see CGDMemoryConstantBackend).
+//
+// Buffers are written through CGDConstantBufferBackend so the management does not depend on D3D11 (see DXConstantBufferBackend).
+
+#pragma once
+
+#include <GUObject.h>
+#include <CGDRenderQueue.h>
+#include <cstdint>
+#include <vector>
+#include <atomic>
+
+
+// Bytes of an object's slot in the ring and the 16 byte shader constants it spans.  D3D11.1 constant offsets must be multiples of 16 constants
+#define CGD_CONSTANT_SLOT_SIZE				256
+#define CGD_CONSTANT_SLOT_CONSTANTS			16
+
+// Returned by addObject when maxObjects objects have been added
+#define CGD_INVALID_CONSTANT_OBJECT			UINT32_MAX
+
+
+// Writes and binds the constant buffers of a CGDConstantBuffers
+class CGDConstantBufferBackend : public GUObject {
+
+public:
+
+	// Object ring buffer handle and size in bytes
+	virtual void* objectBuffer() const = 0;
+	virtual uint32_t objectBufferSize() const = 0;
+
+	// Return true if the object ring can be appended to without discarding it (no overwrite maps of dynamic constant buffers)
+	virtual bool canAppend() const = 0;
+
+	// Write size bytes at offset of the object ring.  discard = true discards the buffer first (its previous contents are lost), otherwise the bytes written must not be in use.  Return false if the buffer cannot be written
+	virtual bool writeObjects(uint32_t offset, const void *data, uint32_t size, bool discard) = 0;
+
+	// Write the frame block (once per frame, before the passes are recorded)
+	virtual bool writeFrame(const void *data, uint32_t size) = 0;
+
+	// Write the view block on context and bind the frame and view buffers to it
+	virtual bool writeView(void *context, const void *data, uint32_t size) = 0;
+};
+
+
+// Sizes of the constant blocks in bytes (multiples of 16).  Objects are at most CGD_CONSTANT_SLOT_SIZE bytes
+struct CGDConstantBufferDesc {
+
+	uint32_t				frameSize = 0;
+	uint32_t				viewSize = 0;
+	uint32_t				objectSize = 0;
+	uint32_t				maxObjects = 64; // the ring must hold a slot for each of them
+};
+
+
+// Constant traffic since the last resetStats
+struct CGDConstantStats {
+
+	uint64_t				frames = 0; // flushes
+	uint64_t				frameBytes = 0;
+	uint64_t				frameUploads = 0;
+	uint64_t				viewBytes = 0;
+	uint64_t				viewUploads = 0;
+	uint64_t				objectBytes = 0; // whole slots
+	uint64_t				objectUploads = 0; // writes to the ring (at most one per flush)
+	uint64_t				objectsWritten = 0;
+	uint64_t				discards = 0; // the ring was discarded and every object rewritten
+};
+
+
+class CGDConstantBuffers : public GUObject {
+
+	CGDConstantBufferBackend		*backend = nullptr;
+	CGDConstantBufferDesc			desc;
+
+	// Latest frame constants
+	std::vector<uint8_t>			frameData;
+	bool							frameDirty = true;
+
+	// Latest constants of each object (objectSize bytes each), the byte offset of the slot holding them and the objects that have changed since the last flush
+	std::vector<uint8_t>			objectData;
+	std::vector<uint32_t>			objectSlots;
+	std::vector<uint8_t>			objectDirty;
+	std::vector<uint32_t>			dirtyObjects;
+
+	// Dirty objects in consecutive slots for a single write
+	std::vector<uint8_t>			staging;
+
+	uint32_t						head = 0; // next free byte of the ring
+	bool							ringValid = false; // false until the ring is first written (and after a failed write)
+
+	CGDConstantStats				stats;
+
+	// Views are written by concurrent passes
+	std::atomic<uint64_t>			viewBytes;
+	std::atomic<uint64_t>			viewUploads;
+
+
+	//
+	// Private interface
+	//
+
+	// Constructor - called internally by the CreateConstantBuffers factory method
+	CGDConstantBuffers(CGDConstantBufferBackend *backend, const CGDConstantBufferDesc& desc);
+
+	void markDirty(uint32_t id);
+
+
+public:
+
+	//
+	// Public interface
+	//
+
+	// Factory method.  backend is retained.  Return nullptr if desc is invalid or the backend's ring cannot hold maxObjects slots
+	static CGDConstantBuffers* CreateConstantBuffers(CGDConstantBufferBackend *backend, const CGDConstantBufferDesc& desc);
+
+	// Destructor
+	~CGDConstantBuffers();
+
+	// Add an object and return its id (CGD_INVALID_CONSTANT_OBJECT if there are maxObjects already).  Its constants are zero until set
+	uint32_t addObject();
+
+	// Set the frame constants (frameSize bytes) or the constants of object id (objectSize bytes).  Only constants that differ from the last ones set are uploaded by the next flush
+	void setFrame(const void *data);
+	void setObject(uint32_t id, const void *data);
+
+	// Upload the frame block and the changed objects.  Called once per frame on the thread that owns the immediate context, before the passes that draw the objects are recorded
+	void flush();
+
+	// Write the view constants (viewSize bytes) on context and bind the frame and view buffers to it.  Called at the start of each pass and safe to call from concurrent passes on different contexts
+	void setView(void *context, const void *data);
+
+	// Binding of object id's slot for CGDDrawPacket::constants (valid until the next flush)
+	CGDConstantBinding getObjectBinding(uint32_t id) const;
+
+	// Query methods
+	const CGDConstantBufferDesc& getDesc() const;
+	uint32_t objectCount() const;
+
+	// Statistics
+	CGDConstantStats getStats() const;
+	void resetStats();
+	void reportStats() const;
+};
@@ -0,0 +1,132 @@
+
+//
+// CGDFixedStepLoop.cpp
+//
+
+#include <stdafx.h>
+#include <CGDFixedStepLoop.h>
+#include <cmath>
+
+using namespace std;
+
+
+
+//
+// Private interface
+//
+
+// Constructor - called internally by the CreateFixedStepLoop factory method
+CGDFixedStepLoop::CGDFixedStepLoop(gu_seconds _stepSize, uint32_t _maxStepsPerAdvance) {
+
+	stepSize = _stepSize;
+	maxStepsPerAdvance = _maxStepsPerAdvance;
+}
+
+
+
+//
+// Public interface
+//
+
+// Factory method
+CGDFixedStepLoop* CGDFixedStepLoop::CreateFixedStepLoop(gu_seconds stepSize, uint32_t maxStepsPerAdvance) {
+
+	if (stepSize <= 0.0 || maxStepsPerAdvance == 0)
+		return nullptr;
+
+	return new CGDFixedStepLoop(stepSize, maxStepsPerAdvance);
+}
+
+
+float CGDFixedStepLoop::InterpolationAlpha(gu_seconds renderTime, gu_seconds stateTime, gu_seconds stepSize) {
+
+	if (stepSize <= 0.0)
+		return 1.0f;
+
+	// Render one step behind real time - renderTime == stateTime shows the previous state, renderTime == stateTime + stepSize the latest one
+	gu_seconds a = (renderTime - stateTime) / stepSize;
+
+	return (a <= 0.0) ? 0.0f : ((a >= 1.0) ? 1.0f : (float)a);
+}
+
+
+uint32_t CGDFixedStepLoop::advance(gu_seconds frameTime, const CGDStepFunction& step) {
+
+	if (frameTime > 0.0)
+		accumulator += frameTime;
+
+	uint32_t steps = 0;
+
+	while (accumulator >= stepSize) {
+
+		if (steps == maxStepsPerAdvance) {
+
+			// Keep the fractional part so interpolation stays continuous and discard the whole steps we cannot afford
+			gu_seconds excess = accumulator - fmod(accumulator, stepSize);
+
+			droppedTime += excess;
+			accumulator -= excess;
+			clampedAdvances++;
+			break;
+		}
+
+		accumulator -= stepSize;
+		stepIndex++;
+		steps++;
+
+		step((gu_seconds)stepIndex * stepSize, stepSize);
+	}
+
+	return steps;
+}
+
+
+void CGDFixedStepLoop::reset() {
+
+	accumulator = 0.0;
+	stepIndex = 0;
+	droppedTime = 0.0;
+	clampedAdvances = 0;
+}
+
+
+float CGDFixedStepLoop::alpha() const {
+
+	return (float)(accumulator / stepSize);
+}
+
+
+gu_seconds CGDFixedStepLoop::getStepSize() const {
+
+	return stepSize;
+}
+
+
+gu_seconds CGDFixedStepLoop::simulationTime() const {
+
+	return (gu_seconds)stepIndex * stepSize;
+}
+
+
+gu_seconds CGDFixedStepLoop::accumulatedTime() const {
+
+	return accumulator;
+}
+
+
+uint64_t CGDFixedStepLoop::stepCount() const {
+
+	return stepIndex;
+}
+
+
+gu_seconds CGDFixedStepLoop::timeDropped() const {
+
+	return droppedTime;
+}
+
+
+uint64_t CGDFixedStepLoop::clampedAdvanceCount() const {
+
+	return clampedAdvances;
+}
@@ -0,0 +1,70 @@
+//
+// CGDFixedStepLoop.h
+//
+
+// Fixed timestep accumulator.  Frame time is added to an accumulator and the simulation is stepped in whole steps of stepSize seconds while the accumulator holds at least one step, so simulation results do not depend on the frame rate.  The time left in the accumulator (less than one step) is the amount by which real time is ahead of the last simulated state - renderers interpolate between the last two simulated states with alpha() = accumulator / stepSize, which shows the world one step behind real time but moving smoothly at any frame rate.
+//
+// The number of steps run by one call to advance is limited to maxStepsPerAdvance.  After a long stall (breakpoint, window drag, slow frame) the excess time is dropped rather than simulated, so a simulation that is slower than real time cannot fall further behind each frame (the "spiral of death").
+//
+// Simulation time is stepIndex * stepSize rather than a running sum so it does not drift, and a given sequence of frame times always produces the same steps.  CGDFixedStepLoop is not thread-safe - it is owned by the thread running the simulation (see CGDSimulation).
+
+#pragma once
+
+#include <GUObject.h>
+#include <CGDClock.h>
+#include <cstdint>
+#include <functional>
+
+
+// Step function.  time is the simulation time at the end of the step and dt the step size
+typedef std::function<void(gu_seconds time, gu_seconds dt)>		CGDStepFunction;
+
+
+class CGDFixedStepLoop : public GUObject {
+
+	gu_seconds				stepSize;
+	uint32_t				maxStepsPerAdvance;
+
+	gu_seconds				accumulator = 0.0;
+	uint64_t				stepIndex = 0; // steps run since creation / reset
+
+	// Statistics
+	gu_seconds				droppedTime = 0.0;
+	uint64_t				clampedAdvances = 0;
+
+
+	//
+	// Private interface
+	//
+
+	// Constructor - called internally by the CreateFixedStepLoop factory method
+	CGDFixedStepLoop(gu_seconds stepSize, uint32_t maxStepsPerAdvance);
+
+
+public:
+
+	//
+	// Public interface
+	//
+
+	// Factory method.  Return nullptr if stepSize <= 0 or maxStepsPerAdvance is 0
+	static CGDFixedStepLoop* CreateFixedStepLoop(gu_seconds stepSize, uint32_t maxStepsPerAdvance = 8);
+
+	// Interpolation factor for rendering at renderTime given a simulated state at stateTime and the state one step before it, clamped to [0, 1].  When the simulation runs on the rendering thread this equals alpha()
+	static float InterpolationAlpha(gu_seconds renderTime, gu_seconds stateTime, gu_seconds stepSize);
+
+	// Add frameTime seconds to the accumulator and call step for each whole step.  Return the number of steps run
+	uint32_t advance(gu_seconds frameTime, const CGDStepFunction& step);
+
+	// Clear the accumulator and restart simulation time at 0
+	void reset();
+
+	// Query methods
+	float alpha() const; // accumulator / stepSize in [0, 1]
+	gu_seconds getStepSize() const;
+	gu_seconds simulationTime() const; // time of the last simulated state
+	gu_seconds accumulatedTime() const;
+	uint64_t stepCount() const;
+	gu_seconds timeDropped() const; // total time discarded by the maxStepsPerAdvance limit
+	uint64_t clampedAdvanceCount() const;
+};
@@ -0,0 +1,676 @@
+
+//
+// CGDFoliageScatter.cpp
+//
+
+#include <stdafx.h>
+#include <CGDFoliageScatter.h>
+#include <CGDScatterMap.h>
+#include <CGDShellGrass.h>
+#include <CGDJobSystem.h>
+#include <CGDClock.h>
+#include <GUMemoryArena.h>
+#include <CGDSoftwareShaders.h>
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+
+using namespace std;
+
+
+// Candidate points tried around an active point before it is retired (Bridson's k).  Candidates are spaced evenly around a circle just outside the spacing (Roberts' variant) rather than at random in the annulus [r, 2r), which packs points more tightly and needs fewer candidates
+static const int			poissonCandidates = 12;
+static const float			poissonCandidateRadius = 1.0001f; // multiple of the spacing
+
+static const float			twoPi = 6.28318530717958647692f;
+
+// Position of an empty Poisson grid cell (far enough from any point that the squared distance cannot overflow to a small value)
+static const float			emptyCell = -1e18f;
+
+
+// Cluster grid position packed into a map key
+static inline uint64_t clusterKey(int32_t x, int32_t z) {
+
+	return ((uint64_t)(uint32_t)x << 32) | (uint64_t)(uint32_t)z;
+}
+
+
+// xorshift random number in [0, 1)
+static inline float randomFloat(uint32_t& state) {
+
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+
+	return (float)(state >> 8) * (1.0f / 16777216.0f);
+}
+
+
+// Distance from p to the box [boxMin, boxMax] (0 inside)
+static float boxDistance(const float boxMin[3], const float boxMax[3], const float p[3]) {
+
+	float d2 = 0.0f;
+
+	for (int i = 0; i < 3; i++) {
+
+		float d = max(max(boxMin[i] - p[i], p[i] - boxMax[i]), 0.0f);
+
+		d2 += d * d;
+	}
+
+	return sqrtf(d2);
+}
+
+
+
+//
+// Private interface
+//
+
+// Constructor - called internally by the CreateFoliageScatter factory method
+CGDFoliageScatter::CGDFoliageScatter(const CGDFoliageScatterDesc& _desc, CGDJobSystem *_jobSystem) {
+
+	desc = _desc;
+	desc.spacing = max(desc.spacing, 1e-3f);
+	desc.clusterSize = max(desc.clusterSize, desc.spacing * 2.0f);
+	desc.lodFar = max(desc.lodFar, desc.lodNear);
+
+	clustersX = max((int32_t)ceilf((desc.bounds[1][0] - desc.bounds[0][0]) / desc.clusterSize), 0);
+	clustersZ = max((int32_t)ceilf((desc.bounds[1][1] - desc.bounds[0][1]) / desc.clusterSize), 0);
+
+	if (desc.densityMap)
+		desc.densityMap->retain();
+
+	if (desc.heightMap)
+		desc.heightMap->retain();
+
+	jobSystem = _jobSystem;
+
+	if (jobSystem)
+		jobSystem->retain();
+}
+
+
+float CGDFoliageScatter::clusterDistance(int32_t cx, int32_t cz, float x, float z) const {
+
+	float x0 = desc.bounds[0][0] + (float)cx * desc.clusterSize;
+	float z0 = desc.bounds[0][1] + (float)cz * desc.clusterSize;
+	float dx = max(max(x0 - x, x - (x0 + desc.clusterSize)), 0.0f);
+	float dz = max(max(z0 - z, z - (z0 + desc.clusterSize)), 0.0f);
+
+	return sqrtf(dx * dx + dz * dz);
+}
+
+
+void CGDFoliageScatter::generate(CGDFoliageCluster *cluster) const {
+
+	vector<CGDFoliageInstance>& instances = cluster->instances;
+
+	instances.clear();
+
+	for (int i = 0; i < 3; i++) {
+
+		cluster->bounds[0][i] = 0.0f;
+		cluster->bounds[1][i] = 0.0f;
+	}
+
+	// Sample rectangle - the cluster (clipped to the ground) inset by half the spacing so points in neighbouring clusters are at least spacing apart
+	float r = desc.spacing;
+	float x0 = desc.bounds[0][0] + (float)cluster->x * desc.clusterSize + r * 0.5f;
+	float z0 = desc.bounds[0][1] + (float)cluster->z * desc.clusterSize + r * 0.5f;
+	float x1 = min(desc.bounds[0][0] + (float)(cluster->x + 1) * desc.clusterSize, desc.bounds[1][0]) - r * 0.5f;
+	float z1 = min(desc.bounds[0][1] + (float)(cluster->z + 1) * desc.clusterSize, desc.bounds[1][1]) - r * 0.5f;
+
+	if (x1 <= x0 || z1 <= z0)
+		return;
+
+	// Seed from the cluster position so the cluster is the same whenever it is generated
+	uint32_t random = desc.seed * 2654435761u ^ (uint32_t)cluster->x * 2246822519u ^ (uint32_t)cluster->z * 3266489917u;
+
+	random ^= random >> 15;
+	random *= 2654435761u;
+	random ^= random >> 13;
+
+	if (random == 0)
+		random = 1;
+
+	// Background grid with cells of side r / sqrt(2) so a cell holds at most one point (Bridson).  Cells hold the point's position (empty cells are far away so they never fail the distance test) and the grid has a border of 2 empty cells so neighbour searches need no clamping
+	float cellSize = r * 0.70710678f;
+	float invCellSize = 1.0f / cellSize;
+	int32_t gridWidth = max((int32_t)ceilf((x1 - x0) * invCellSize), 1);
+	int32_t gridHeight = max((int32_t)ceilf((z1 - z0) * invCellSize), 1);
+	int32_t stride = gridWidth + 4;
+	size_t gridSize = (size_t)stride * (gridHeight + 4);
+
+	GUScratchScope scratch;
+
+	float *grid = scratch.allocateArray<float>(gridSize * 2);
+	uint32_t *active = scratch.allocateArray<uint32_t>((size_t)gridWidth * gridHeight);
+
+	if (!grid || !active)
+		return;
+
+	for (size_t i = 0; i < gridSize * 2; i++)
+		grid[i] = emptyCell;
+
+	// Cells within 2 of a point's cell that can hold a point closer than r (the corners of the 5 x 5 block cannot)
+	int32_t neighbours[21];
+	int32_t numNeighbours = 0;
+
+	for (int32_t j = -2; j <= 2; j++) {
+
+		for (int32_t i = -2; i <= 2; i++) {
+
+			if (abs(i) + abs(j) < 4)
+				neighbours[numNeighbours++] = (j * stride + i) * 2;
+		}
+	}
+
+	uint32_t activeCount = 0;
+	float r2 = r * r;
+	float candidateCos = cosf(twoPi / (float)poissonCandidates);
+	float candidateSin = sinf(twoPi / (float)poissonCandidates);
+
+	CGDFoliageInstance instance;
+
+	instance.position[0] = x0 + randomFloat(random) * (x1 - x0);
+	instance.position[1] = 0.0f;
+	instance.position[2] = z0 + randomFloat(random) * (z1 - z0);
+	instance.rotation = 0.0f;
+	instance.scale = 1.0f;
+
+	float *first = &grid[((min((int32_t)((instance.position[2] - z0) * invCellSize), gridHeight - 1) + 2) * stride + min((int32_t)((instance.position[0] - x0) * invCellSize), gridWidth - 1) + 2) * 2];
+
+	first[0] = instance.position[0];
+	first[1] = instance.position[2];
+	instances.push_back(instance);
+	active[activeCount++] = 0;
+
+	while (activeCount > 0) {
+
+		uint32_t a = min((uint32_t)(randomFloat(random) * (float)activeCount), activeCount - 1);
+		const CGDFoliageInstance p = instances[active[a]];
+		bool found = false;
+
+		// Candidates around p starting at a random angle (each candidate is the previous one rotated by 2 pi / k)
+		float angle = randomFloat(random) * twoPi;
+		float cx = cosf(angle) * r * poissonCandidateRadius;
+		float cz = sinf(angle) * r * poissonCandidateRadius;
+
+		for (int k = 0; k < poissonCandidates && !found; k++) {
+
+			float x = p.position[0] + cx;
+			float z = p.position[2] + cz;
+			float rx = cx * candidateCos - cz * candidateSin;
+
+			cz = cx * candidateSin + cz * candidateCos;
+			cx = rx;
+
+			if (x < x0 || x >= x1 || z < z0 || z >= z1)
+				continue;
+
+			int32_t gx = min((int32_t)((x - x0) * invCellSize), gridWidth - 1) + 2;
+			int32_t gz = min((int32_t)((z - z0) * invCellSize), gridHeight - 1) + 2;
+			float *cell = &grid[(gz * stride + gx) * 2];
+
+			// A point in the candidate's own cell is always too close
+			if (cell[0] != emptyCell)
+				continue;
+
+			bool clear = true;
+
+			for (int32_t n = 0; n < numNeighbours; n++) {
+
+				float dx = cell[neighbours[n]] - x;
+				float dz = cell[neighbours[n] + 1] - z;
+
+				if (dx * dx + dz * dz < r2) {
+
+					clear = false;
+					break;
+				}
+			}
+
+			if (clear) {
+
+				instance.position[0] = x;
+				instance.position[2] = z;
+
+				cell[0] = x;
+				cell[1] = z;
+				active[activeCount++] = (uint32_t)instances.size();
+				instances.push_back(instance);
+
+				found = true;
+			}
+		}
+
+		// Retire p once no candidate around it fits
+		if (!found)
+			active[a] = active[--activeCount];
+	}
+
+	// Thin by the density map, place on the height map and randomise the orientation and scale
+	float invWidth = 1.0f / (desc.bounds[1][0] - desc.bounds[0][0]);
+	float invDepth = 1.0f / (desc.bounds[1][1] - desc.bounds[0][1]);
+	size_t count = 0;
+
+	for (size_t i = 0; i < instances.size(); i++) {
+
+		CGDFoliageInstance& s = instances[i];
+		float u = (s.position[0] - desc.bounds[0][0]) * invWidth;
+		float v = (s.position[2] - desc.bounds[0][1]) * invDepth;
+
+		if (desc.densityMap && randomFloat(random) >= desc.densityMap->sample(u, v))
+			continue;
+
+		CGDFoliageInstance& d = instances[count++];
+
+		d.position[0] = s.position[0];
+		d.position[1] = desc.baseHeight + ((desc.heightMap) ? desc.heightMap->sample(u, v) : 0.0f);
+		d.position[2] = s.position[2];
+		d.rotation = randomFloat(random) * twoPi;
+		d.scale = desc.minScale + randomFloat(random) * (desc.maxScale - desc.minScale);
+	}
+
+	instances.resize(count);
+
+	if (count == 0)
+		return;
+
+	// Random order so drawing the first n instances thins the cluster evenly (Fisher-Yates)
+	for (size_t i = count - 1; i > 0; i--)
+		swap(instances[i], instances[min((size_t)(randomFloat(random) * (float)(i + 1)), i)]);
+
+	float extent = desc.instanceRadius * max(desc.maxScale, desc.minScale);
+	float height = desc.instanceHeight * max(desc.maxScale, desc.minScale);
+
+	for (int i = 0; i < 3; i++) {
+
+		cluster->bounds[0][i] = instances[0].position[i];
+		cluster->bounds[1][i] = instances[0].position[i];
+	}
+
+	for (size_t i = 1; i < count; i++) {
+
+		for (int j = 0; j < 3; j++) {
+
+			cluster->bounds[0][j] = min(cluster->bounds[0][j], instances[i].position[j]);
+			cluster->bounds[1][j] = max(cluster->bounds[1][j], instances[i].position[j]);
+		}
+	}
+
+	cluster->bounds[0][0] -= extent;
+	cluster->bounds[0][2] -= extent;
+	cluster->bounds[1][0] += extent;
+	cluster->bounds[1][1] += height;
+	cluster->bounds[1][2] += extent;
+}
+
+
+void CGDFoliageScatter::generatePending(bool parallel) {
+
+	if (parallel && jobSystem && jobSystem->workerCount() > 0 && pending.size() > 1) {
+
+		CGDJobCounter counter;
+
+		for (size_t i = 0; i < pending.size(); i++) {
+
+			CGDFoliageCluster *cluster = pending[i];
+
+			jobSystem->run([=]() { generate(cluster); }, &counter);
+		}
+
+		jobSystem->wait(&counter);
+
+	} else {
+
+		for (size_t i = 0; i < pending.size(); i++)
+			generate(pending[i]);
+	}
+
+	for (size_t i = 0; i < pending.size(); i++) {
+
+		CGDFoliageCluster *cluster = pending[i];
+
+		resident[clusterKey(cluster->x, cluster->z)] = cluster;
+		residentList.push_back(cluster);
+		stats.instancesResident += cluster->instances.size();
+	}
+
+	stats.clustersGenerated += (uint32_t)pending.size();
+	stats.clustersResident = (uint32_t)residentList.size();
+
+	pending.clear();
+}
+
+
+CGDFoliageCluster* CGDFoliageScatter::allocateCluster(int32_t x, int32_t z) {
+
+	CGDFoliageCluster *cluster;
+
+	if (freeClusters.empty()) {
+
+		cluster = new CGDFoliageCluster();
+
+	} else {
+
+		cluster = freeClusters.back();
+		freeClusters.pop_back();
+	}
+
+	cluster->x = x;
+	cluster->z = z;
+
+	return cluster;
+}
+
+
+
+//
+// Public interface
+//
+
+// Factory method
+CGDFoliageScatter* CGDFoliageScatter::CreateFoliageScatter(const CGDFoliageScatterDesc& desc, CGDJobSystem *jobSystem) {
+
+	return new CGDFoliageScatter(desc, jobSystem);
+}
+
+
+CGDFoliageScatter::~CGDFoliageScatter() {
+
+	for (size_t i = 0; i < residentList.size(); i++)
+		delete residentList[i];
+
+	for (size_t i = 0; i < freeClusters.size(); i++)
+		delete freeClusters[i];
+
+	if (desc.densityMap)
+		desc.densityMap->release();
+
+	if (desc.heightMap)
+		desc.heightMap->release();
+
+	if (jobSystem)
+		jobSystem->release();
+}
+
+
+bool CGDFoliageScatter::generateCluster(int32_t cx, int32_t cz, CGDFoliageCluster& cluster) const {
+
+	if (cx < 0 || cz < 0 || cx >= clustersX || cz >= clustersZ)
+		return false;
+
+	cluster.x = cx;
+	cluster.z = cz;
+	generate(&cluster);
+
+	return true;
+}
+
+
+const CGDFoliageStreamStats& CGDFoliageScatter::update(const float eye[3], uint32_t maxGenerate) {
+
+	stats.clustersGenerated = 0;
+	stats.clustersEvicted = 0;
+
+	// Evict clusters more than a cluster beyond the stream radius (the margin stops clusters on the edge of the radius loading and unloading as the camera moves back and forth)
+	for (size_t i = 0; i < residentList.size();) {
+
+		CGDFoliageCluster *cluster = residentList[i];
+
+		if (clusterDistance(cluster->x, cluster->z, eye[0], eye[2]) > desc.streamRadius + desc.clusterSize) {
+
+			resident.erase(clusterKey(cluster->x, cluster->z));
+			stats.instancesResident -= cluster->instances.size();
+			stats.clustersEvicted++;
+
+			freeClusters.push_back(cluster);
+			residentList[i] = residentList.back();
+			residentList.pop_back();
+
+		} else {
+
+			i++;
+		}
+	}
+
+	// Missing clusters within the stream radius
+	int32_t cx0 = max((int32_t)floorf((eye[0] - desc.streamRadius - desc.bounds[0][0]) / desc.clusterSize), 0);
+	int32_t cz0 = max((int32_t)floorf((eye[2] - desc.streamRadius - desc.bounds[0][1]) / desc.clusterSize), 0);
+	int32_t cx1 = min((int32_t)floorf((eye[0] + desc.streamRadius - desc.bounds[0][0]) / desc.clusterSize), clustersX - 1);
+	int32_t cz1 = min((int32_t)floorf((eye[2] + desc.streamRadius - desc.bounds[0][1]) / desc.clusterSize), clustersZ - 1);
+
+	missing.clear();
+
+	for (int32_t cz = cz0; cz <= cz1; cz++) {
+
+		for (int32_t cx = cx0; cx <= cx1; cx++) {
+
+			float d = clusterDistance(cx, cz, eye[0], eye[2]);
+
+			if (d <= desc.streamRadius && resident.find(clusterKey(cx, cz)) == resident.end()) {
+
+				ClusterRequest request = { d, cx, cz };
+
+				missing.push_back(request);
+			}
+		}
+	}
+
+	// Nearest first if the update cannot generate them all
+	if (maxGenerate > 0 && missing.size() > maxGenerate) {
+
+		nth_element(missing.begin(), missing.begin() + maxGenerate, missing.end(), [](const ClusterRequest& a, const ClusterRequest& b) { return a.distance < b.distance; });
+		missing.resize(maxGenerate);
+	}
+
+	for (size_t i = 0; i < missing.size(); i++)
+		pending.push_back(allocateCluster(missing[i].x, missing[i].z));
+
+	generatePending(true);
+
+	return stats;
+}
+
+
+void CGDFoliageScatter::generateAll(bool parallel) {
+
+	stats.clustersGenerated = 0;
+	stats.clustersEvicted = 0;
+
+	for (int32_t cz = 0; cz < clustersZ; cz++) {
+
+		for (int32_t cx = 0; cx < clustersX; cx++) {
+
+			if (resident.find(clusterKey(cx, cz)) == resident.end())
+				pending.push_back(allocateCluster(cx, cz));
+		}
+	}
+
+	generatePending(parallel);
+}
+
+
+void CGDFoliageScatter::evictAll() {
+
+	freeClusters.insert(freeClusters.end(), residentList.begin(), residentList.end());
+
+	stats.clustersEvicted = (uint32_t)residentList.size();
+	stats.clustersGenerated = 0;
+	stats.clustersResident = 0;
+	stats.instancesResident = 0;
+
+	resident.clear();
+	residentList.clear();
+}
+
+
+uint64_t CGDFoliageScatter::select(const float eye[3], const float viewProj[16], vector<CGDFoliageDraw>& draws) const {
+
+	float planes[6][4];
+	uint64_t instances = 0;
+
+	CGDShellGrass::FrustumPlanes(viewProj, planes);
+
+	draws.clear();
+
+	for (size_t i = 0; i < residentList.size(); i++) {
+
+		const CGDFoliageCluster *cluster = residentList[i];
+		uint32_t count = lodInstanceCount(*cluster, boxDistance(cluster->bounds[0], cluster->bounds[1], eye));
+
+		if (count == 0 || !CGDShellGrass::BoxInFrustum(planes, cluster->bounds[0], cluster->bounds[1]))
+			continue;
+
+		CGDFoliageDraw draw = { cluster, count };
+
+		draws.push_back(draw);
+		instances += count;
+	}
+
+	return instances;
+}
+
+
+uint32_t CGDFoliageScatter::lodInstanceCount(const CGDFoliageCluster& cluster, float d) const {
+
+	uint32_t count = (uint32_t)cluster.instances.size();
+
+	if (d >= desc.drawDistance)
+		return 0;
+
+	if (d <= desc.lodNear)
+		return count;
+
+	float t = min((d - desc.lodNear) / max(desc.lodFar - desc.lodNear, 1e-6f), 1.0f);
+	float fraction = 1.0f + (desc.lodMinFraction - 1.0f) * t;
+
+	return min((uint32_t)ceilf((float)count * fraction), count);
+}
+
+
+const vector<CGDFoliageCluster*>& CGDFoliageScatter::getClusters() const {
+
+	return residentList;
+}
+
+
+const CGDFoliageScatterDesc& CGDFoliageScatter::getDesc() const {
+
+	return desc;
+}
+
+
+const CGDFoliageStreamStats& CGDFoliageScatter::getStats() const {
+
+	return stats;
+}
+
+
+bool CGDFoliageScatter::benchmark(uint32_t frames) {
+
+	float width = desc.bounds[1][0] - desc.bounds[0][0];
+	float depth = desc.bounds[1][1] - desc.bounds[0][1];
+	float centre[2] = { desc.bounds[0][0] + width * 0.5f, desc.bounds[0][1] + depth * 0.5f };
+	float groundHeight = desc.baseHeight + ((desc.heightMap) ? desc.heightMap->mean() : 0.0f);
+	double frequency = (double)CGDClock::ActualTimeFrequency();
+	ostringstream report;
+
+	report << fixed << setprecision(2);
+	report << "\nFoliage scatter benchmark (" << width << " x " << depth << " ground, spacing " << desc.spacing << ", " << clustersX * clustersZ << " clusters of " << desc.clusterSize << ", " << ((jobSystem) ? jobSystem->workerCount() : 0) << " worker threads)...\n";
+
+	// Generation rate of the whole ground on the calling thread and on the job system
+	double generateSeconds[2];
+	uint64_t instances = 0;
+
+	for (int pass = 0; pass < 2; pass++) {
+
+		evictAll();
+
+		gu_time_index start = CGDClock::ActualTime();
+
+		generateAll(pass == 1);
+
+		generateSeconds[pass] = (double)(CGDClock::ActualTime() - start) / frequency;
+		instances = stats.instancesResident;
+	}
+
+	if (instances == 0)
+		return false;
+
+	report << "Generation: " << instances << " instances (" << (double)instances / (double)(width * depth) << " per square unit): single-threaded " << generateSeconds[0] * 1000.0 << " ms (" << (double)instances / generateSeconds[0] / 1e6 << " M instances/s), parallel " << generateSeconds[1] * 1000.0 << " ms (" << (double)instances / generateSeconds[1] / 1e6 << " M instances/s, " << generateSeconds[0] / max(generateSeconds[1], 1e-9) << "x)\n";
+
+	// Selection from cameras orbiting the centre of the ground, looking along the orbit and slightly down, with every cluster resident
+	CGDSoftwareMatrix projMatrix = CGDSoftwareMatrix::PerspectiveFovLH(0.25f * 3.14f, 1.0f, 1.0f, 1000.0f);
+	vector<CGDFoliageDraw> draws;
+	float orbit = min(width, depth) * 0.25f;
+	double selectSeconds = 0.0, maxSelectSeconds = 0.0;
+	uint64_t drawn = 0, visibleClusters = 0;
+
+	frames = max(frames, 1u);
+
+	for (uint32_t i = 0; i < frames; i++) {
+
+		float angle = twoPi * (float)i / (float)frames;
+		float eye[3] = { centre[0] + cosf(angle) * orbit, groundHeight + 10.0f, centre[1] + sinf(angle) * orbit };
+		float at[3] = { eye[0] - sinf(angle), eye[1] - 0.2f, eye[2] + cosf(angle) };
+		float up[3] = { 0.0f, 1.0f, 0.0f };
+		CGDSoftwareMatrix viewProjMatrix = CGDSoftwareMatrix::LookAtLH(eye, at, up) * projMatrix;
+
+		gu_time_index start = CGDClock::ActualTime();
+
+		drawn += select(eye, &viewProjMatrix.m[0][0], draws);
+
+		double seconds = (double)(CGDClock::ActualTime() - start) / frequency;
+
+		selectSeconds += seconds;
+		maxSelectSeconds = max(maxSelectSeconds, seconds);
+		visibleClusters += draws.size();
+	}
+
+	report << "Selection: " << setprecision(1) << (double)visibleClusters / (double)frames << " of " << residentList.size() << " clusters and " << (double)drawn / (double)frames << " of " << instances << " instances drawn per frame, " << setprecision(2) << selectSeconds / (double)frames * 1e6 << " us per frame (max " << maxSelectSeconds * 1e6 << " us)\n";
+
+	// Streaming around a camera crossing the ground through its centre
+	double updateSeconds = 0.0, maxUpdateSeconds = 0.0;
+	uint64_t generated = 0, evicted = 0, residentInstances = 0;
+
+	evictAll();
+
+	for (uint32_t i = 0; i < frames; i++) {
+
+		float t = (frames > 1) ? (float)i / (float)(frames - 1) : 0.5f;
+		float eye[3] = { desc.bounds[0][0] + width * t, groundHeight + 10.0f, centre[1] };
+
+		gu_time_index start = CGDClock::ActualTime();
+
+		update(eye);
+
+		double seconds = (double)(CGDClock::ActualTime() - start) / frequency;
+
+		// The first update fills the whole stream radius - report it separately from the steady state
+		if (i == 0) {
+
+			report << "Streaming: first update " << seconds * 1000.0 << " ms (" << stats.clustersGenerated << " clusters), ";
+			continue;
+		}
+
+		updateSeconds += seconds;
+		maxUpdateSeconds = max(maxUpdateSeconds, seconds);
+		generated += stats.clustersGenerated;
+		evicted += stats.clustersEvicted;
+		residentInstances += stats.instancesResident;
+	}
+
+	uint32_t updates = max(frames - 1, 1u);
+
+	report << "then " << updateSeconds / (double)updates * 1000.0 << " ms per frame (max " << maxUpdateSeconds * 1000.0 << " ms) with " << setprecision(0) << (double)residentInstances / (double)updates << " instances resident, " << generated << " clusters generated and " << evicted << " evicted over " << updates << " frames\n";
+
+	cout << report.str();
+
+	evictAll();
+
+	return true;
+}
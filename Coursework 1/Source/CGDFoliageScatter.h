@@ -0,0 +1,164 @@
+//
+// CGDFoliageScatter.h
+//
+
+// Procedural foliage placement.  Instances are scattered over a rectangle of the ground with Poisson-disk sampling (Bridson, "Fast Poisson Disk Sampling in Arbitrary Dimensions", 2007) so no two are closer than the spacing, then thinned by a density map (the probability of keeping an instance) and placed on a height map (see CGDScatterMap).  Each instance gets a random rotation about the vertical axis and a random scale.
+//
+// The ground is divided into square clusters and each cluster is generated independently from a seed derived from its grid position, so a cluster always produces the same instances whenever (and on whichever thread) it is generated.  Points are kept spacing / 2 inside their cluster so the spacing also holds between neighbouring clusters.  A cluster stores its instances contiguously in random order with a bounding box - the instances of a cluster can be uploaded to one instance buffer range and drawn with one instanced draw, and drawing only the first part of a cluster thins it evenly, which is how the level of detail is applied.
+//
+// update streams clusters around the camera - clusters within streamRadius are generated (in parallel on the job system if one is given) and clusters beyond the radius (plus a margin so clusters at the edge do not repeatedly load and unload) are evicted.  Evicted clusters are pooled and reused so their instance storage keeps its capacity.  select culls the resident clusters against the view frustum and returns the instance count to draw from each visible cluster.
+
+#pragma once
+
+#include <GUObject.h>
+#include <cstdint>
+#include <vector>
+#include <unordered_map>
+
+class CGDScatterMap;
+class CGDJobSystem;
+
+
+// Instance layout (20 bytes - usable directly as per-instance vertex data)
+struct CGDFoliageInstance {
+
+	float					position[3];
+	float					rotation; // radians about the y axis
+	float					scale;
+};
+
+
+struct CGDFoliageScatterDesc {
+
+	float					bounds[2][2]; // (x, z) of the corners of the ground rectangle (min, max)
+	float					spacing = 1.0f; // minimum distance between instances
+	float					clusterSize = 32.0f; // side of a cluster
+	uint32_t				seed = 1;
+
+	CGDScatterMap			*densityMap = nullptr; // probability [0, 1] of keeping an instance over the ground rectangle.  nullptr = keep every instance
+	CGDScatterMap			*heightMap = nullptr; // ground height over the ground rectangle.  nullptr = flat
+	float					baseHeight = 0.0f; // added to the height map
+
+	float					minScale = 0.8f;
+	float					maxScale = 1.2f;
+	float					instanceRadius = 0.5f; // horizontal extent of an instance at scale 1 (cluster bounds)
+	float					instanceHeight = 1.0f; // vertical extent of an instance at scale 1 (cluster bounds)
+
+	// Streaming and level of detail (distances from the camera to the cluster bounds)
+	float					streamRadius = 256.0f; // clusters within this distance are resident
+	float					lodNear = 32.0f; // every instance drawn up to this distance
+	float					lodFar = 192.0f; // lodMinFraction of the instances drawn from this distance
+	float					lodMinFraction = 0.1f;
+	float					drawDistance = 256.0f; // nothing drawn beyond this distance
+};
+
+
+// Generated cluster.  x and z are the cluster's grid position
+struct CGDFoliageCluster {
+
+	int32_t									x = 0;
+	int32_t									z = 0;
+	float									bounds[2][3]; // box around the instances (min, max)
+	std::vector<CGDFoliageInstance>			instances; // random order - any prefix is an even thinning of the cluster
+};
+
+
+// Instances of a visible cluster to draw (the first instanceCount instances of the cluster)
+struct CGDFoliageDraw {
+
+	const CGDFoliageCluster		*cluster;
+	uint32_t					instanceCount;
+};
+
+
+struct CGDFoliageStreamStats {
+
+	uint32_t				clustersResident = 0;
+	uint64_t				instancesResident = 0;
+	uint32_t				clustersGenerated = 0; // by the last update
+	uint32_t				clustersEvicted = 0; // by the last update
+};
+
+
+class CGDFoliageScatter : public GUObject {
+
+	CGDFoliageScatterDesc									desc;
+	CGDJobSystem											*jobSystem = nullptr; // nullptr = generate on the calling thread
+	int32_t													clustersX = 0; // cluster grid size
+	int32_t													clustersZ = 0;
+
+	std::unordered_map<uint64_t, CGDFoliageCluster*>		resident; // keyed on grid position
+	std::vector<CGDFoliageCluster*>							residentList; // resident clusters in no particular order (selection)
+	std::vector<CGDFoliageCluster*>							freeClusters;
+	CGDFoliageStreamStats									stats;
+
+	// Clusters to generate (kept between updates so the steady state does not allocate)
+	struct ClusterRequest {
+
+		float			distance;
+		int32_t			x;
+		int32_t			z;
+	};
+
+	std::vector<ClusterRequest>							missing;
+	std::vector<CGDFoliageCluster*>							pending;
+
+
+	//
+	// Private interface
+	//
+
+	// Constructor - called internally by the CreateFoliageScatter factory method
+	CGDFoliageScatter(const CGDFoliageScatterDesc& desc, CGDJobSystem *jobSystem);
+
+	// Distance in the ground plane from (x, z) to the rectangle of cluster (cx, cz)
+	float clusterDistance(int32_t cx, int32_t cz, float x, float z) const;
+
+	// Generate the instances and bounds of cluster->x, cluster->z.  Thread safe - only the cluster is written
+	void generate(CGDFoliageCluster *cluster) const;
+
+	// Generate the pending clusters (in parallel if requested and there is a job system) and make them resident
+	void generatePending(bool parallel);
+
+	// Take a cluster from the pool (or allocate one) for grid position (x, z)
+	CGDFoliageCluster* allocateCluster(int32_t x, int32_t z);
+
+
+public:
+
+	//
+	// Public interface
+	//
+
+	// Factory method.  The maps and the job system (if given) are retained
+	static CGDFoliageScatter* CreateFoliageScatter(const CGDFoliageScatterDesc& desc, CGDJobSystem *jobSystem = nullptr);
+
+	// Destructor
+	~CGDFoliageScatter();
+
+	// Generate the cluster at grid position (cx, cz) into cluster (which need not be resident).  Return false if the position is outside the cluster grid
+	bool generateCluster(int32_t cx, int32_t cz, CGDFoliageCluster& cluster) const;
+
+	// Make every cluster within streamRadius of eye resident and evict those beyond it.  maxGenerate limits the clusters generated by one update (0 = no limit) - the nearest missing clusters are generated first
+	const CGDFoliageStreamStats& update(const float eye[3], uint32_t maxGenerate = 0);
+
+	// Make every cluster resident.  parallel = false generates the clusters on the calling thread
+	void generateAll(bool parallel = true);
+
+	// Evict every cluster
+	void evictAll();
+
+	// Visible resident clusters and their level of detail from eye with the given world to clip space matrix (row-major, row vectors - see CGDShellGrass::FrustumPlanes).  draws is cleared first.  Return the total instance count
+	uint64_t select(const float eye[3], const float viewProj[16], std::vector<CGDFoliageDraw>& draws) const;
+
+	// Instances to draw from a cluster at distance d (0 beyond drawDistance)
+	uint32_t lodInstanceCount(const CGDFoliageCluster& cluster, float d) const;
+
+	// Query methods
+	const std::vector<CGDFoliageCluster*>& getClusters() const; // resident clusters
+	const CGDFoliageScatterDesc& getDesc() const;
+	const CGDFoliageStreamStats& getStats() const;
+
+	// Report the generation rate of the whole ground (on the calling thread and on the job system), the cost of selecting the visible clusters from frames cameras orbiting the centre of the ground and the cost of streaming clusters around a camera crossing the ground.  Return false if nothing was generated
+	bool benchmark(uint32_t frames);
+};
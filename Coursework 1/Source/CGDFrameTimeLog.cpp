@@ -0,0 +1,283 @@
+//
+// CGDFrameTimeLog.cpp
+//
+
+#include <stdafx.h>
+#include <CGDFrameTimeLog.h>
+#include <algorithm>
+#include <fstream>
+#include <cmath>
+
+using namespace std;
+
+
+
+//
+// Private interface
+//
+
+// Constructor - called internally by the CreateFrameTimeLog factory method
+CGDFrameTimeLog::CGDFrameTimeLog(size_t capacity) : frameTimes(capacity), mask(capacity - 1), writeIndex(0), claimIndex(0) {
+
+	for (auto& t : frameTimes)
+		t.store(0.0f, memory_order_relaxed);
+}
+
+
+
+//
+// Public interface - Class methods
+//
+
+// Frame time log factory method.  capacity is rounded up to the next power of 2
+CGDFrameTimeLog* CGDFrameTimeLog::CreateFrameTimeLog(size_t capacity) {
+
+	size_t c = 1;
+
+	while (c < capacity)
+		c <<= 1;
+
+	GU_MEMORY_TAG_SCOPE(gu_mem_profiler);
+
+	return new CGDFrameTimeLog(c);
+}
+
+
+// Return the p'th percentile (p in [0, 100]) of the given frame times using the nearest-rank method
+double CGDFrameTimeLog::Percentile(vector<float>& frameTimes, double p) {
+
+	if (frameTimes.empty())
+		return 0.0;
+
+	p = min(max(p, 0.0), 100.0);
+
+	// Nearest rank = ceil(p/100 * N) (1-based)
+	size_t rank = (size_t)ceil(p / 100.0 * (double)frameTimes.size());
+	size_t k = (rank > 0) ? rank - 1 : 0;
+
+	nth_element(frameTimes.begin(), frameTimes.begin() + k, frameTimes.end());
+
+	return frameTimes[k];
+}
+
+
+// Calculate summary statistics for the given frame times
+CGDFrameTimeStats CGDFrameTimeLog::CalculateStatistics(vector<float> frameTimes) {
+
+	CGDFrameTimeStats stats;
+
+	if (frameTimes.empty())
+		return stats;
+
+	stats.frameCount = frameTimes.size();
+
+	double sum = 0.0;
+
+	for (float t : frameTimes)
+		sum += t;
+
+	stats.mean = sum / (double)frameTimes.size();
+
+	auto mm = minmax_element(frameTimes.begin(), frameTimes.end());
+
+	stats.minimum = *mm.first;
+	stats.maximum = *mm.second;
+
+	stats.p50 = Percentile(frameTimes, 50.0);
+	stats.p95 = Percentile(frameTimes, 95.0);
+	stats.p99 = Percentile(frameTimes, 99.0);
+
+	return stats;
+}
+
+
+// Build a histogram of the given frame times
+CGDFrameTimeHistogram CGDFrameTimeLog::CalculateHistogram(const vector<float>& frameTimes, double binWidthMs, size_t numBins) {
+
+	CGDFrameTimeHistogram h;
+
+	h.binWidth = (binWidthMs > 0.0) ? binWidthMs : 1.0;
+	h.bins.assign(numBins, 0);
+
+	for (float t : frameTimes) {
+
+		size_t bin = (t > 0.0f) ? (size_t)((double)t / h.binWidth) : 0;
+
+		if (bin < numBins)
+			h.bins[bin]++;
+		else
+			h.overflow++;
+	}
+
+	return h;
+}
+
+
+
+//
+// Public interface - Instance methods
+//
+
+void CGDFrameTimeLog::record(double frameTimeMs) {
+
+	uint64_t w = writeIndex.load(memory_order_relaxed);
+
+	// Claim the slot before overwriting it - a reader that copies the new value also sees the claim (the release fence here pairs with the acquire fence in snapshot) and discards the frame
+	claimIndex.store(w + 1, memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+
+	frameTimes[w & mask].store((float)frameTimeMs, memory_order_relaxed);
+
+	// Publish the frame - readers that acquire writeIndex see the value stored above
+	writeIndex.store(w + 1, memory_order_release);
+}
+
+
+void CGDFrameTimeLog::clear() {
+
+	claimIndex.store(0, memory_order_relaxed);
+	writeIndex.store(0, memory_order_release);
+}
+
+
+size_t CGDFrameTimeLog::capacity() const {
+
+	return frameTimes.size();
+}
+
+
+uint64_t CGDFrameTimeLog::framesRecorded() const {
+
+	return writeIndex.load(memory_order_acquire);
+}
+
+
+vector<float> CGDFrameTimeLog::snapshot(size_t maxFrames, uint64_t *firstFrame) const {
+
+	uint64_t end = writeIndex.load(memory_order_acquire);
+	uint64_t available = min<uint64_t>(end, frameTimes.size());
+
+	if (maxFrames > 0)
+		available = min<uint64_t>(available, maxFrames);
+
+	uint64_t begin = end - available;
+
+	vector<float> result((size_t)available);
+
+	for (uint64_t i = begin; i < end; i++)
+		result[(size_t)(i - begin)] = frameTimes[i & mask].load(memory_order_relaxed);
+
+	// Any frame at index < (claimed - capacity) may have been overwritten while copying so drop it from the front of the snapshot
+	atomic_thread_fence(memory_order_acquire);
+
+	uint64_t claimed = claimIndex.load(memory_order_relaxed);
+
+	if (claimed > begin + frameTimes.size()) {
+
+		uint64_t overwritten = min<uint64_t>(claimed - frameTimes.size() - begin, available);
+
+		result.erase(result.begin(), result.begin() + (size_t)overwritten);
+		begin += overwritten;
+	}
+
+	if (firstFrame)
+		*firstFrame = begin;
+
+	return result;
+}
+
+
+CGDFrameTimeStats CGDFrameTimeLog::statistics(size_t maxFrames) const {
+
+	return CalculateStatistics(snapshot(maxFrames));
+}
+
+
+CGDFrameTimeHistogram CGDFrameTimeLog::histogram(double binWidthMs, size_t numBins, size_t maxFrames) const {
+
+	return CalculateHistogram(snapshot(maxFrames), binWidthMs, numBins);
+}
+
+
+void CGDFrameTimeLog::writeCSV(ostream& os) const {
+
+	uint64_t firstFrame;
+	vector<float> frames = snapshot(0, &firstFrame);
+
+	os << "frame,ms\n";
+
+	for (size_t i = 0; i < frames.size(); i++)
+		os << (firstFrame + i) << "," << frames[i] << "\n";
+}
+
+
+void CGDFrameTimeLog::writeJSON(ostream& os, double binWidthMs, size_t numBins) const {
+
+	vector<float> frames = snapshot();
+
+	// Derive statistics and histogram from the same snapshot so the exported data is consistent
+	CGDFrameTimeStats stats = CalculateStatistics(frames);
+	CGDFrameTimeHistogram h = CalculateHistogram(frames, binWidthMs, numBins);
+
+	os << "{\n";
+	os << "  \"framesRecorded\": " << framesRecorded() << ",\n";
+	os << "  \"stats\": { \"count\": " << stats.frameCount << ", \"mean\": " << stats.mean << ", \"min\": " << stats.minimum << ", \"p50\": " << stats.p50 << ", \"p95\": " << stats.p95 << ", \"p99\": " << stats.p99 << ", \"max\": " << stats.maximum << " },\n";
+	os << "  \"histogram\": { \"binWidth\": " << h.binWidth << ", \"overflow\": " << h.overflow << ", \"bins\": [";
+
+	for (size_t i = 0; i < h.bins.size(); i++)
+		os << ((i > 0) ? ", " : "") << h.bins[i];
+
+	os << "] },\n";
+	os << "  \"frames\": [";
+
+	for (size_t i = 0; i < frames.size(); i++)
+		os << ((i > 0) ? ", " : "") << frames[i];
+
+	os << "]\n}\n";
+}
+
+
+bool CGDFrameTimeLog::exportCSV(const string& filename) const {
+
+	ofstream file(filename);
+
+	if (!file.is_open()) {
+
+		cout << "Cannot open frame time log file " << filename << endl;
+		return false;
+	}
+
+	writeCSV(file);
+
+	return file.good();
+}
+
+
+bool CGDFrameTimeLog::exportJSON(const string& filename, double binWidthMs, size_t numBins) const {
+
+	ofstream file(filename);
+
+	if (!file.is_open()) {
+
+		cout << "Cannot open frame time log file " << filename << endl;
+		return false;
+	}
+
+	writeJSON(file, binWidthMs, numBins);
+
+	return file.good();
+}
+
+
+void CGDFrameTimeLog::reportTimingData() const {
+
+	CGDFrameTimeStats stats = statistics();
+
+	cout << "\nFrame times (last " << stats.frameCount << " frames, ms)...\n";
+	cout << "Mean = " << stats.mean << endl;
+	cout << "Min = " << stats.minimum << endl;
+	cout << "p50 = " << stats.p50 << endl;
+	cout << "p95 = " << stats.p95 << endl;
+	cout << "p99 = " << stats.p99 << endl;
+	cout << "Max = " << stats.maximum << endl;
+}
@@ -0,0 +1,105 @@
+//
+// CGDFrameTimeLog.h
+//
+
+// Model a fixed capacity log of per-frame durations.  The log is a ring buffer written by a single producer (the thread that ticks the owning clock) and read by any number of consumers without locking.  Consumers take a snapshot of the most recent frames and derive percentile statistics and histograms from it.  Frame times are stored in milliseconds since tail latency (p95 / p99 / max) is the measure we tune against rather than average FPS
+
+#pragma once
+
+#include <GUObject.h>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <iostream>
+
+
+// Summary statistics for a frame time snapshot (all times in milliseconds)
+struct CGDFrameTimeStats {
+
+	uint64_t				frameCount = 0; // number of frames the statistics are derived from
+	double					mean = 0.0;
+	double					minimum = 0.0;
+	double					p50 = 0.0;
+	double					p95 = 0.0;
+	double					p99 = 0.0;
+	double					maximum = 0.0;
+};
+
+
+// Frame time histogram with fixed width bins [0, binWidth), [binWidth, 2*binWidth)... Frames longer than binWidth * bins.size() are counted in overflow
+struct CGDFrameTimeHistogram {
+
+	double					binWidth = 1.0; // bin width in milliseconds
+	std::vector<uint32_t>	bins;
+	uint32_t				overflow = 0;
+};
+
+
+class CGDFrameTimeLog : public GUObject {
+
+	std::vector<std::atomic<float>>		frameTimes; // ring buffer of frame durations (ms).  Capacity is a power of 2
+	size_t								mask = 0;
+
+	std::atomic<uint64_t>				writeIndex; // total number of frames recorded.  The next frame is written to frameTimes[writeIndex & mask]
+	std::atomic<uint64_t>				claimIndex; // writeIndex + 1 while a frame is being written.  Claimed before the slot is overwritten so snapshot can tell which frames it may have read after they were replaced
+
+
+	//
+	// Private interface
+	//
+
+	// Constructor - called internally by the CreateFrameTimeLog factory method
+	CGDFrameTimeLog(size_t capacity);
+
+
+public:
+
+	//
+	// Public interface - Class methods
+	//
+
+	// Frame time log factory method.  capacity is rounded up to the next power of 2
+	static CGDFrameTimeLog* CreateFrameTimeLog(size_t capacity = 4096);
+
+	// Return the p'th percentile (p in [0, 100]) of the given frame times using the nearest-rank method.  frameTimes is partially reordered
+	static double Percentile(std::vector<float>& frameTimes, double p);
+
+	// Calculate summary statistics / histogram for the given frame times (ms)
+	static CGDFrameTimeStats CalculateStatistics(std::vector<float> frameTimes);
+	static CGDFrameTimeHistogram CalculateHistogram(const std::vector<float>& frameTimes, double binWidthMs, size_t numBins);
+
+
+	//
+	// Public interface - Instance methods
+	//
+
+	// Record the duration of a single frame.  This must only be called from one thread at a time
+	void record(double frameTimeMs);
+
+	// Discard all recorded frames.  This must not be called concurrently with record()
+	void clear();
+
+	size_t capacity() const;
+
+	// Total number of frames recorded (including those that have since been overwritten)
+	uint64_t framesRecorded() const;
+
+	// Copy the most recent (up to capacity()) frame times in recording order.  If maxFrames > 0 only the last maxFrames frames are returned.  Frames overwritten by the producer during the copy are discarded.  If firstFrame is not nullptr it is set to the index (see framesRecorded) of the first frame returned
+	std::vector<float> snapshot(size_t maxFrames = 0, uint64_t *firstFrame = nullptr) const;
+
+	// Calculate summary statistics over the most recent maxFrames frames (or all frames in the log if maxFrames = 0)
+	CGDFrameTimeStats statistics(size_t maxFrames = 0) const;
+
+	// Build a histogram of the most recent maxFrames frames with numBins bins of width binWidthMs
+	CGDFrameTimeHistogram histogram(double binWidthMs = 1.0, size_t numBins = 50, size_t maxFrames = 0) const;
+
+	// Export methods - exportCSV and exportJSON return true if successful.  CSV export writes one row per frame (frame, ms).  JSON export writes the statistics, histogram and frame times as a single object
+	void writeCSV(std::ostream& os) const;
+	void writeJSON(std::ostream& os, double binWidthMs = 1.0, size_t numBins = 50) const;
+
+	bool exportCSV(const std::string& filename) const;
+	bool exportJSON(const std::string& filename, double binWidthMs = 1.0, size_t numBins = 50) const;
+
+	void reportTimingData() const;
+};
@@ -0,0 +1,302 @@
+//
+// CGDGPUProfiler.cpp
+//
+
+#include <stdafx.h>
+#include <CGDGPUProfiler.h>
+#include <algorithm>
+
+using namespace std;
+
+
+
+//
+// Private interface
+//
+
+// Constructor - called internally by the CreateGPUProfiler factory method
+CGDGPUProfiler::CGDGPUProfiler(CGDGPUTimerBackend *_backend) {
+
+	backend = _backend;
+	backend->retain();
+
+	slots.resize(backend->framesInFlight());
+	timestamps.resize(backend->maxTimestampsPerFrame());
+
+	frameStats.name = "frame";
+}
+
+
+void CGDGPUProfiler::resolvePendingFrames() {
+
+	while (true) {
+
+		// Find the oldest pending slot
+		uint32_t s = UINT32_MAX;
+
+		for (uint32_t i = 0; i < (uint32_t)slots.size(); i++) {
+
+			if (slots[i].pending && (s == UINT32_MAX || slots[i].frameIndex < slots[s].frameIndex))
+				s = i;
+		}
+
+		if (s == UINT32_MAX)
+			break;
+
+		FrameSlot& slot = slots[s];
+		uint64_t frequency = 0;
+		CGDGPUQueryStatus status = backend->resolveFrame(s, slot.numTimestamps, timestamps.data(), &frequency);
+
+		if (status == CGDGPUQueryStatus::NOT_READY)
+			break;
+
+		slot.pending = false;
+		lastLatency = frameIndex - slot.frameIndex;
+
+		if (status == CGDGPUQueryStatus::DISJOINT || frequency == 0) {
+
+			// Timestamps are unreliable (eg. clock frequency changed) - discard the frame
+			framesDisjoint++;
+			continue;
+		}
+
+		double msPerTick = 1000.0 / (double)frequency;
+
+		for (auto& p : slot.passes) {
+
+			if (p.end == UINT32_MAX)
+				continue; // pass was never closed
+
+			auto it = statsIndex.find(p.name);
+
+			if (it == statsIndex.end()) {
+
+				it = statsIndex.insert(make_pair(string(p.name), stats.size())).first;
+
+				CGDGPUPassStats newStats;
+
+				newStats.name = p.name;
+				newStats.depth = p.depth;
+				stats.push_back(newStats);
+			}
+
+			uint64_t t0 = timestamps[p.begin], t1 = timestamps[p.end];
+
+			updateStats(stats[it->second], (t1 > t0) ? (double)(t1 - t0) * msPerTick : 0.0, smoothing);
+		}
+
+		if (slot.numTimestamps >= 2) {
+
+			uint64_t t0 = timestamps[0], t1 = timestamps[slot.numTimestamps - 1];
+
+			updateStats(frameStats, (t1 > t0) ? (double)(t1 - t0) * msPerTick : 0.0, smoothing);
+		}
+
+		framesResolved++;
+	}
+}
+
+
+void CGDGPUProfiler::updateStats(CGDGPUPassStats& s, double ms, double smoothing) {
+
+	if (s.samples == 0) {
+
+		s.average = s.minimum = s.maximum = ms;
+	}
+	else {
+
+		s.average += (ms - s.average) * smoothing;
+		s.minimum = min(s.minimum, ms);
+		s.maximum = max(s.maximum, ms);
+	}
+
+	s.last = ms;
+	s.samples++;
+}
+
+
+
+//
+// Public interface
+//
+
+// GPU profiler factory method
+CGDGPUProfiler* CGDGPUProfiler::CreateGPUProfiler(CGDGPUTimerBackend *backend) {
+
+	if (!backend || backend->framesInFlight() == 0 || backend->maxTimestampsPerFrame() < 4)
+		return nullptr;
+
+	return new CGDGPUProfiler(backend);
+}
+
+
+// Destructor
+CGDGPUProfiler::~CGDGPUProfiler() {
+
+	if (backend)
+		backend->release();
+}
+
+
+void CGDGPUProfiler::beginFrame() {
+
+	if (frameActive)
+		endFrame();
+
+	currentSlot = (uint32_t)(frameIndex % slots.size());
+	frameIndex++;
+
+	// Give the slot a final chance to resolve - if it is still in flight skip profiling this frame rather than stall
+	if (slots[currentSlot].pending)
+		resolvePendingFrames();
+
+	FrameSlot& slot = slots[currentSlot];
+
+	if (slot.pending) {
+
+		framesSkipped++;
+		return;
+	}
+
+	slot.passes.clear();
+	slot.numTimestamps = 0;
+	slot.frameIndex = frameIndex;
+
+	passStack.clear();
+
+	// Timestamp 0 marks the start of the frame
+	backend->beginFrame(currentSlot);
+	backend->timestamp(currentSlot, slot.numTimestamps++);
+
+	frameActive = true;
+}
+
+
+void CGDGPUProfiler::endFrame() {
+
+	if (!frameActive)
+		return;
+
+	// Close any passes left open
+	while (!passStack.empty())
+		endPass();
+
+	FrameSlot& slot = slots[currentSlot];
+
+	// The last timestamp marks the end of the frame
+	backend->timestamp(currentSlot, slot.numTimestamps++);
+	backend->endFrame(currentSlot);
+
+	slot.pending = true;
+	frameActive = false;
+
+	resolvePendingFrames();
+}
+
+
+void CGDGPUProfiler::beginPass(const char *name) {
+
+	if (!frameActive)
+		return;
+
+	FrameSlot& slot = slots[currentSlot];
+
+	// Each pass needs 2 timestamps.  Reserve room for the end timestamps of the passes already open and the end of frame timestamp
+	if (slot.numTimestamps + 2 + passStack.size() + 1 > timestamps.size()) {
+
+		passStack.push_back(UINT32_MAX);
+		return;
+	}
+
+	Pass p;
+
+	p.name = name;
+	p.begin = slot.numTimestamps;
+	p.end = UINT32_MAX;
+	p.depth = (uint32_t)passStack.size();
+
+	backend->timestamp(currentSlot, slot.numTimestamps++);
+
+	passStack.push_back((uint32_t)slot.passes.size());
+	slot.passes.push_back(p);
+}
+
+
+void CGDGPUProfiler::endPass() {
+
+	if (!frameActive || passStack.empty())
+		return;
+
+	uint32_t passIndex = passStack.back();
+
+	passStack.pop_back();
+
+	if (passIndex == UINT32_MAX)
+		return; // pass was ignored (timestamp capacity exceeded)
+
+	FrameSlot& slot = slots[currentSlot];
+
+	slot.passes[passIndex].end = slot.numTimestamps;
+	backend->timestamp(currentSlot, slot.numTimestamps++);
+}
+
+
+uint64_t CGDGPUProfiler::frameCount() const {
+
+	return frameIndex;
+}
+
+
+uint64_t CGDGPUProfiler::resolvedFrameCount() const {
+
+	return framesResolved;
+}
+
+
+uint64_t CGDGPUProfiler::skippedFrameCount() const {
+
+	return framesSkipped;
+}
+
+
+uint64_t CGDGPUProfiler::disjointFrameCount() const {
+
+	return framesDisjoint;
+}
+
+
+uint64_t CGDGPUProfiler::readbackLatency() const {
+
+	return lastLatency;
+}
+
+
+const vector<CGDGPUPassStats>& CGDGPUProfiler::passStats() const {
+
+	return stats;
+}
+
+
+const CGDGPUPassStats* CGDGPUProfiler::passStats(const string& name) const {
+
+	auto it = statsIndex.find(name);
+
+	return (it != statsIndex.end()) ? &stats[it->second] : nullptr;
+}
+
+
+const CGDGPUPassStats& CGDGPUProfiler::frameTime() const {
+
+	return frameStats;
+}
+
+
+void CGDGPUProfiler::reportTimingData() const {
+
+	cout << "\nGPU passes (ms)...\n";
+	cout << "Frames resolved = " << framesResolved << ", skipped = " << framesSkipped << ", disjoint = " << framesDisjoint << ", read back latency = " << lastLatency << " frames\n";
+	cout << "frame: average = " << frameStats.average << ", min = " << frameStats.minimum << ", max = " << frameStats.maximum << endl;
+
+	for (auto& s : stats)
+		cout << string((s.depth + 1) * 2, ' ') << s.name << ": average = " << s.average << ", min = " << s.minimum << ", max = " << s.maximum << ", last = " << s.last << endl;
+}
@@ -0,0 +1,182 @@
+//
+// CGDGPUProfiler.h
+//
+
+// GPU pass timing.  CGDGPUProfiler brackets named (and nested) passes with GPU timestamps and aggregates the per-pass times once the results become available.  Queries are issued into a pool of N frame slots (N = backend->framesInFlight()) so results are read back N-1 frames later without stalling the CPU on the GPU.  If a slot has still not resolved when it is needed again, that frame is not profiled rather than waiting.
+//
+// The query source is abstracted by CGDGPUTimerBackend so the aggregation, latency buffering and reporting logic does not depend on D3D11 (see DXGPUTimerBackend for the D3D11 timestamp / disjoint query implementation).
+
+#pragma once
+
+#include <GUObject.h>
+#include <CGDProfiler.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <map>
+
+
+// Result of reading back the queries for a frame slot
+enum class CGDGPUQueryStatus : uint8_t { NOT_READY = 0, VALID, DISJOINT };
+
+
+// Abstract GPU timestamp query source
+class CGDGPUTimerBackend : public GUObject {
+
+public:
+
+	// Number of frame slots in the query pool
+	virtual uint32_t framesInFlight() const = 0;
+
+	// Maximum number of timestamps that can be issued per frame slot
+	virtual uint32_t maxTimestampsPerFrame() const = 0;
+
+	// Begin / end the frame in the given slot (D3D11 - begin / end the disjoint query)
+	virtual void beginFrame(uint32_t slot) = 0;
+	virtual void endFrame(uint32_t slot) = 0;
+
+	// Issue timestamp index in the given slot
+	virtual void timestamp(uint32_t slot, uint32_t index) = 0;
+
+	// Read back the first numTimestamps timestamps of the given slot without blocking.  timestamps and frequency (ticks per second) are only valid if VALID is returned
+	virtual CGDGPUQueryStatus resolveFrame(uint32_t slot, uint32_t numTimestamps, uint64_t *timestamps, uint64_t *frequency) = 0;
+};
+
+
+// Aggregated timing of a single named pass (ms)
+struct CGDGPUPassStats {
+
+	std::string				name;
+	uint32_t				depth = 0;
+	uint64_t				samples = 0;
+	double					last = 0.0;
+	double					average = 0.0; // exponential moving average
+	double					minimum = 0.0;
+	double					maximum = 0.0;
+};
+
+
+class CGDGPUProfiler : public GUObject {
+
+	// Pass recorded in a frame slot - begin and end index the slot's timestamps
+	struct Pass {
+
+		const char			*name;
+		uint32_t			begin;
+		uint32_t			end;
+		uint32_t			depth;
+	};
+
+	// Query pool frame slot
+	struct FrameSlot {
+
+		std::vector<Pass>	passes;
+		uint32_t			numTimestamps = 0;
+		uint64_t			frameIndex = 0;
+		bool				pending = false;
+	};
+
+	CGDGPUTimerBackend			*backend = nullptr;
+
+	std::vector<FrameSlot>		slots;
+	std::vector<uint32_t>		passStack; // indices into the current slot's passes of the open passes
+	std::vector<uint64_t>		timestamps; // read back buffer
+
+	uint64_t					frameIndex = 0; // number of frames begun
+	uint32_t					currentSlot = 0;
+	bool						frameActive = false;
+
+	uint64_t					framesResolved = 0;
+	uint64_t					framesSkipped = 0; // frames not profiled because the slot had not resolved
+	uint64_t					framesDisjoint = 0;
+	uint64_t					lastLatency = 0; // frames between issue and read back of the most recently resolved frame
+
+	double						smoothing = 0.1; // EMA weight of the newest sample
+
+	std::vector<CGDGPUPassStats>		stats; // in first-seen order
+	std::map<std::string, size_t>		statsIndex;
+	CGDGPUPassStats						frameStats; // whole frame (first to last timestamp)
+
+
+	//
+	// Private interface
+	//
+
+	// Constructor - called internally by the CreateGPUProfiler factory method
+	CGDGPUProfiler(CGDGPUTimerBackend *backend);
+
+	// Read back any pending slots in issue order.  Stop at the first slot that is not ready so results are always consumed in order
+	void resolvePendingFrames();
+
+	static void updateStats(CGDGPUPassStats& s, double ms, double smoothing);
+
+
+public:
+
+	//
+	// Public interface
+	//
+
+	// GPU profiler factory method.  The profiler retains the given backend.  Return nullptr if backend is nullptr, has no frame slots or supports fewer than 4 timestamps per frame
+	static CGDGPUProfiler* CreateGPUProfiler(CGDGPUTimerBackend *backend);
+
+	// Destructor
+	~CGDGPUProfiler();
+
+	// Frame and pass bracketing.  Passes must be nested correctly and begin / end within a single frame.  Passes beyond the backend timestamp capacity are ignored
+	void beginFrame();
+	void endFrame();
+
+	void beginPass(const char *name);
+	void endPass();
+
+	// Query methods
+	uint64_t frameCount() const;
+	uint64_t resolvedFrameCount() const;
+	uint64_t skippedFrameCount() const;
+	uint64_t disjointFrameCount() const;
+	uint64_t readbackLatency() const;
+
+	const std::vector<CGDGPUPassStats>& passStats() const;
+	const CGDGPUPassStats* passStats(const std::string& name) const; // nullptr if no pass with the given name has been resolved
+	const CGDGPUPassStats& frameTime() const;
+
+	void reportTimingData() const;
+};
+
+
+// RAII GPU pass
+class CGDGPUZone {
+
+	CGDGPUProfiler			*profiler;
+
+public:
+
+	CGDGPUZone(CGDGPUProfiler *_profiler, const char *name) : profiler(_profiler) {
+
+		if (profiler)
+			profiler->beginPass(name);
+	}
+
+	~CGDGPUZone() {
+
+		if (profiler)
+			profiler->endPass();
+	}
+
+private:
+
+	CGDGPUZone(const CGDGPUZone&);
+	CGDGPUZone& operator=(const CGDGPUZone&);
+};
+
+
+#ifdef __CGD_PROFILE__
+
+#define GPU_PROFILE_SCOPE(profiler, name)		CGDGPUZone CGD_PROFILE_CONCAT(_gpuProfileZone, __LINE__)(profiler, name)
+
+#else
+
+#define GPU_PROFILE_SCOPE(profiler, name)
+
+#endif
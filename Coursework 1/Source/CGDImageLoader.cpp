@@ -0,0 +1,242 @@
+
+//
+// CGDImageLoader.cpp
+//
+
+#include <stdafx.h>
+#include <CGDImageLoader.h>
+#include <CGDJobSystem.h>
+#include <CGDClock.h>
+#include <GUMipChain.h>
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+#ifndef _WIN32
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
+using namespace std;
+
+
+
+//
+// Private interface
+//
+
+// Constructor - called internally by the CreateImageLoader factory method
+CGDImageLoader::CGDImageLoader(CGDJobSystem *_jobSystem) {
+
+	jobSystem = _jobSystem;
+
+	if (jobSystem)
+		jobSystem->retain();
+}
+
+
+
+//
+// Public interface
+//
+
+// Factory method
+CGDImageLoader* CGDImageLoader::CreateImageLoader(CGDJobSystem *jobSystem) {
+
+	return new CGDImageLoader(jobSystem);
+}
+
+
+bool CGDImageLoader::ReadImage(const string& filename, CGDLoadedImage& image) {
+
+	gu_time_index start = CGDClock::ActualTime();
+
+	image.filename = filename;
+	image.image.format = gu_image_unknown;
+	image.loaded = gu_image_read_file(filename.c_str(), image.file) && gu_image_decode(image.file.data(), image.file.size(), image.image);
+
+	if (image.loaded && image.image.format != gu_image_dds)
+		gu_mip_generate(image.image.width, image.image.height, image.image.pixels.data(), gu_mip_default_options(filename.c_str(), image.image.width, image.image.height, image.image.pixels.data()), image.mips);
+	else
+		image.mips.clear();
+
+	image.seconds = (double)(CGDClock::ActualTime() - start) / (double)CGDClock::ActualTimeFrequency();
+
+	return image.loaded;
+}
+
+
+bool CGDImageLoader::ListFiles(const string& directory, vector<string>& files) {
+
+	files.clear();
+
+#ifdef _WIN32
+
+	WIN32_FIND_DATAA findData;
+	HANDLE find = FindFirstFileA((directory + "/*").c_str(), &findData);
+
+	if (find == INVALID_HANDLE_VALUE)
+		return false;
+
+	do {
+
+		if (!(findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+			files.push_back(directory + "/" + findData.cFileName);
+
+	} while (FindNextFileA(find, &findData));
+
+	FindClose(find);
+
+#else
+
+	DIR *dir = opendir(directory.c_str());
+
+	if (!dir)
+		return false;
+
+	while (dirent *entry = readdir(dir)) {
+
+		string path = directory + "/" + entry->d_name;
+		struct stat info;
+
+		if (stat(path.c_str(), &info) == 0 && S_ISREG(info.st_mode))
+			files.push_back(path);
+	}
+
+	closedir(dir);
+
+#endif
+
+	sort(files.begin(), files.end());
+
+	return true;
+}
+
+
+CGDImageLoader::~CGDImageLoader() {
+
+	for (size_t i = 0; i < images.size(); i++)
+		delete images[i];
+
+	if (jobSystem)
+		jobSystem->release();
+}
+
+
+void CGDImageLoader::load(const vector<string>& files, vector<CGDLoadedImage*>& batch, bool parallel) {
+
+	batch.resize(files.size());
+
+	for (size_t i = 0; i < files.size(); i++) {
+
+		if (freeImages.empty()) {
+
+			batch[i] = new CGDLoadedImage();
+			images.push_back(batch[i]);
+
+		} else {
+
+			batch[i] = freeImages.back();
+			freeImages.pop_back();
+		}
+	}
+
+	if (parallel && jobSystem && jobSystem->workerCount() > 0) {
+
+		CGDJobCounter counter;
+
+		for (size_t i = 0; i < files.size(); i++) {
+
+			const string *filename = &files[i];
+			CGDLoadedImage *image = batch[i];
+
+			jobSystem->run([=]() { ReadImage(*filename, *image); }, &counter);
+		}
+
+		jobSystem->wait(&counter);
+
+	} else {
+
+		for (size_t i = 0; i < files.size(); i++)
+			ReadImage(files[i], *batch[i]);
+	}
+
+	// Report failures here rather than inside the jobs so lines from different threads do not interleave
+	for (size_t i = 0; i < files.size(); i++) {
+
+		if (!batch[i]->loaded)
+			cout << "Cannot load " << files[i] << " (" << gu_image_format_name(batch[i]->image.format) << ")" << endl;
+	}
+}
+
+
+void CGDImageLoader::recycle(vector<CGDLoadedImage*>& batch) {
+
+	freeImages.insert(freeImages.end(), batch.begin(), batch.end());
+	batch.clear();
+}
+
+
+bool CGDImageLoader::benchmark(const vector<string>& allFiles) {
+
+	vector<string> files;
+	vector<CGDLoadedImage*> batch;
+	double totalSeconds[2] = {};
+	size_t totalBytes = 0;
+	uint32_t loaded = 0;
+
+	// Skip files that are not images (eg. Thumbs.db) so they are not reported on every pass
+	for (size_t i = 0; i < allFiles.size(); i++) {
+
+		if (gu_image_detect_file(allFiles[i].c_str()) != gu_image_unknown)
+			files.push_back(allFiles[i]);
+		else
+			cout << "Skipping " << allFiles[i] << " (not an image)" << endl;
+	}
+
+	cout << "\nImage loading benchmark (" << files.size() << " files, " << ((jobSystem) ? jobSystem->workerCount() : 0) << " worker threads)...\n";
+
+	load(files, batch);
+	recycle(batch);
+
+	for (int pass = 0; pass < 2; pass++) {
+
+		gu_time_index start = CGDClock::ActualTime();
+
+		load(files, batch, pass == 1);
+
+		totalSeconds[pass] = (double)(CGDClock::ActualTime() - start) / (double)CGDClock::ActualTimeFrequency();
+
+		// Per file times from the single-threaded pass
+		for (size_t i = 0; i < batch.size() && pass == 0; i++) {
+
+			if (!batch[i]->loaded)
+				continue;
+
+			ostringstream line;
+
+			line << batch[i]->filename << ": " << gu_image_format_name(batch[i]->image.format) << " " << batch[i]->image.width << "x" << batch[i]->image.height << ", " << batch[i]->file.size() / 1024 << " KB, " << fixed << setprecision(2) << batch[i]->seconds * 1000.0 << " ms";
+
+			cout << line.str() << endl;
+
+			loaded++;
+			totalBytes += batch[i]->file.size();
+		}
+
+		recycle(batch);
+	}
+
+	if (loaded == 0)
+		return false;
+
+	if (loaded < files.size())
+		cout << files.size() - loaded << " images failed to load" << endl;
+
+	ostringstream line;
+
+	line << loaded << " images (" << totalBytes / (1024 * 1024) << " MB): single-threaded " << fixed << setprecision(2) << totalSeconds[0] * 1000.0 << " ms, parallel " << totalSeconds[1] * 1000.0 << " ms (" << totalSeconds[0] / max(totalSeconds[1], 1e-9) << "x)";
+
+	cout << line.str() << endl;
+
+	return loaded == files.size();
+}
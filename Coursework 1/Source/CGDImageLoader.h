@@ -0,0 +1,72 @@
+//
+// CGDImageLoader.h
+//
+
+// Parallel image loading.  load reads and decodes a batch of image files (see GUImageDecoder) on the job system - one job per file so the files of a batch decode concurrently - and builds the mip chain of each decoded RGBA8 image (see GUMipChain) in the same job.  DDS files are only parsed.  Results are returned in staging images taken from a pool.  recycle returns them once their contents have been handed to the device (see Texture::LoadBatch) and later batches reuse them, so the file, pixel and mip buffers keep their capacity and loading allocates little once the pool has grown to the size of a batch.
+//
+// benchmark loads a set of files on the calling thread and then on the job system and reports the total time of each.
+
+#pragma once
+
+#include <GUObject.h>
+#include <GUImageDecoder.h>
+#include <string>
+#include <vector>
+
+class CGDJobSystem;
+
+
+// Staging image filled by CGDImageLoader
+struct CGDLoadedImage {
+
+	std::string								filename;
+	std::vector<uint8_t>					file; // file contents
+	gu_image								image;
+	std::vector<std::vector<uint8_t> >		mips; // RGBA8 mip chain (empty for DDS files, whose mips are in image.pixels)
+	bool									loaded = false;
+	double									seconds = 0.0; // read, decode and mip generation time
+};
+
+
+class CGDImageLoader : public GUObject {
+
+	CGDJobSystem					*jobSystem = nullptr; // nullptr = load on the calling thread
+	std::vector<CGDLoadedImage*>	images; // every staging image allocated
+	std::vector<CGDLoadedImage*>	freeImages;
+
+
+	//
+	// Private interface
+	//
+
+	// Constructor - called internally by the CreateImageLoader factory method
+	CGDImageLoader(CGDJobSystem *jobSystem);
+
+
+public:
+
+	//
+	// Public interface
+	//
+
+	// Factory method.  The job system (if given) is retained
+	static CGDImageLoader* CreateImageLoader(CGDJobSystem *jobSystem = nullptr);
+
+	// Read, decode and build the mips of filename into image (on the calling thread).  Return false if the file cannot be read or decoded
+	static bool ReadImage(const std::string& filename, CGDLoadedImage& image);
+
+	// Paths (directory/name) of the files in directory, excluding subdirectories, in name order.  Return false if the directory cannot be read
+	static bool ListFiles(const std::string& directory, std::vector<std::string>& files);
+
+	// Destructor.  Staging images still held by the caller are deleted too
+	~CGDImageLoader();
+
+	// Load files into staging images (batch[i] holds files[i] - check its loaded flag) and return when all have finished.  parallel = false loads them one after another on the calling thread.  load and recycle must be called from a single thread
+	void load(const std::vector<std::string>& files, std::vector<CGDLoadedImage*>& batch, bool parallel = true);
+
+	// Return staging images to the pool.  batch is cleared
+	void recycle(std::vector<CGDLoadedImage*>& batch);
+
+	// Load files on the calling thread and then in parallel (after an untimed pass that warms the file cache and the pool) and report the time of each file and the total time of each pass.  Files that are not images are skipped.  Return false if no file could be loaded or an image fails to load
+	bool benchmark(const std::vector<std::string>& files);
+};
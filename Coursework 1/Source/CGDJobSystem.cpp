@@ -0,0 +1,775 @@
+
+//
+// CGDJobSystem.cpp
+//
+
+#include <stdafx.h>
+#include <CGDJobSystem.h>
+#include <GUMemoryArena.h>
+#include <algorithm>
+
+#if !defined(_WIN32) && defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+using namespace std;
+
+
+// Queued job
+struct CGDJob {
+
+	CGDJobFunction				function;
+	CGDJobCounter				*counter;
+	CGDJobSystem				*system;
+	CGDJobCounter				*dependency; // counter a runAfter job is waiting on (nullptr once queued)
+};
+
+
+// Job system and participant index of the calling thread (nullptr for threads outside any job system)
+static CGD_THREAD_LOCAL CGDJobSystem		*threadJobSystem = nullptr;
+static CGD_THREAD_LOCAL uint32_t			threadParticipant = CGD_JOB_EXTERNAL_THREAD;
+
+// Live job systems - woken when a counter is completed on a thread outside any job system
+static mutex								systemsLock;
+static vector<CGDJobSystem*>				systems;
+
+// Number of times an idle thread re-checks for work before it sleeps
+static const uint32_t						idleSpins = 64;
+
+
+static CGDJob* NewJob(const CGDJobFunction& function, CGDJobCounter *counter, CGDJobSystem *system) {
+
+	GU_MEMORY_TAG_SCOPE(gu_mem_jobs);
+
+	CGDJob *job = new CGDJob();
+
+	job->function = function;
+	job->counter = counter;
+	job->system = system;
+	job->dependency = nullptr;
+
+	return job;
+}
+
+
+
+//
+// CGDJobCounter
+//
+
+CGDJobCounter::~CGDJobCounter() {
+
+	// Continuations of a counter that never reached zero can never run
+	if (continuations.empty())
+		return;
+
+	vector<CGDJob*> discarded;
+
+	lock();
+	discarded.swap(continuations);
+	unlock();
+
+	for (size_t i = 0; i < discarded.size(); i++) {
+
+		discarded[i]->system->releaseContinuation(discarded[i]);
+		delete discarded[i];
+	}
+}
+
+
+void CGDJobCounter::lock() {
+
+	uint32_t c = count.load(memory_order_relaxed);
+
+	for (;;) {
+
+		if (c & lockBit) {
+
+			this_thread::yield();
+			c = count.load(memory_order_relaxed);
+		}
+		else if (count.compare_exchange_weak(c, c | lockBit, memory_order_acquire, memory_order_relaxed))
+			return;
+	}
+}
+
+
+void CGDJobCounter::unlock() {
+
+	count.fetch_and(~lockBit, memory_order_release);
+}
+
+
+void CGDJobCounter::complete(uint32_t n) {
+
+	uint32_t c = count.load(memory_order_relaxed);
+
+	for (;;) {
+
+		if ((c & ~lockBit) == n) {
+
+			// Last completion.  Wait for runAfter to finish with the continuation list, then hold the count at zero but locked while the continuations are taken
+			if (c & lockBit) {
+
+				this_thread::yield();
+				c = count.load(memory_order_relaxed);
+			}
+			else if (count.compare_exchange_weak(c, lockBit, memory_order_acq_rel, memory_order_relaxed))
+				break;
+		}
+		else if (count.compare_exchange_weak(c, c - n, memory_order_acq_rel, memory_order_relaxed))
+			return;
+	}
+
+	vector<CGDJob*> ready;
+
+	ready.swap(continuations);
+
+	// The counter may be destroyed by a waiting thread as soon as this store is visible so it must be the last access
+	count.store(0, memory_order_seq_cst);
+
+	CGDJobSystem::CounterCompleted(ready.data(), ready.size());
+}
+
+
+
+//
+// CGDJobDeque
+//
+
+CGDJobDeque::CGDJobDeque(int64_t capacity) : top(0), bottom(0), buffer(nullptr) {
+
+	buffer.store(allocateBuffer(capacity), memory_order_relaxed);
+}
+
+
+CGDJobDeque::~CGDJobDeque() {
+
+	for (size_t i = 0; i < buffers.size(); i++) {
+
+		delete[] buffers[i]->jobs;
+		delete buffers[i];
+	}
+}
+
+
+CGDJobDeque::Buffer* CGDJobDeque::allocateBuffer(int64_t capacity) {
+
+	GU_MEMORY_TAG_SCOPE(gu_mem_jobs);
+
+	Buffer *b = new Buffer();
+
+	b->capacity = capacity;
+	b->jobs = new atomic<CGDJob*>[(size_t)capacity];
+
+	for (int64_t i = 0; i < capacity; i++)
+		b->jobs[i].store(nullptr, memory_order_relaxed);
+
+	buffers.push_back(b);
+
+	return b;
+}
+
+
+void CGDJobDeque::push(CGDJob *job) {
+
+	int64_t b = bottom.load(memory_order_relaxed);
+	int64_t t = top.load(memory_order_acquire);
+	Buffer *a = buffer.load(memory_order_relaxed);
+
+	if (b - t > a->capacity - 1) {
+
+		// Full - copy the live range to a buffer of twice the size
+		Buffer *grown = allocateBuffer(a->capacity * 2);
+
+		for (int64_t i = t; i < b; i++)
+			grown->put(i, a->get(i));
+
+		buffer.store(grown, memory_order_release);
+		a = grown;
+	}
+
+	a->put(b, job);
+	bottom.store(b + 1, memory_order_release);
+}
+
+
+CGDJob* CGDJobDeque::pop() {
+
+	int64_t b = bottom.load(memory_order_relaxed) - 1;
+	Buffer *a = buffer.load(memory_order_relaxed);
+
+	// Reserve the bottom job before reading top so a concurrent steal of the same (last) job is detected
+	bottom.store(b, memory_order_seq_cst);
+
+	int64_t t = top.load(memory_order_seq_cst);
+
+	if (t > b) {
+
+		// Empty
+		bottom.store(b + 1, memory_order_relaxed);
+		return nullptr;
+	}
+
+	CGDJob *job = a->get(b);
+
+	if (t == b) {
+
+		// Last job - race thieves for it
+		if (!top.compare_exchange_strong(t, t + 1, memory_order_seq_cst, memory_order_relaxed))
+			job = nullptr;
+
+		bottom.store(b + 1, memory_order_relaxed);
+	}
+
+	return job;
+}
+
+
+CGDJob* CGDJobDeque::steal() {
+
+	int64_t t = top.load(memory_order_seq_cst);
+	int64_t b = bottom.load(memory_order_seq_cst);
+
+	if (t >= b)
+		return nullptr;
+
+	Buffer *a = buffer.load(memory_order_acquire);
+	CGDJob *job = a->get(t);
+
+	if (!top.compare_exchange_strong(t, t + 1, memory_order_seq_cst, memory_order_relaxed))
+		return nullptr;
+
+	return job;
+}
+
+
+int64_t CGDJobDeque::size() const {
+
+	int64_t n = bottom.load(memory_order_relaxed) - top.load(memory_order_relaxed);
+
+	return (n > 0) ? n : 0;
+}
+
+
+
+//
+// Private interface
+//
+
+// Constructor - called internally by the CreateJobSystem factory method
+CGDJobSystem::CGDJobSystem(uint32_t numWorkers, CGDThreadAffinity _affinity) : injectionCount(0), wakeEpoch(0), numSleeping(0), shutdown(false) {
+
+	GU_MEMORY_TAG_SCOPE(gu_mem_jobs);
+
+	affinity = _affinity;
+
+	for (uint32_t i = 0; i <= numWorkers; i++) {
+
+		Participant *p = new Participant();
+
+		p->random = 2654435761u * (i + 1);
+		participants.push_back(p);
+	}
+
+	// The creating thread is participant 0
+	threadJobSystem = this;
+	threadParticipant = 0;
+
+	lock_guard<mutex> lock(systemsLock);
+
+	systems.push_back(this);
+}
+
+
+void CGDJobSystem::workerMain(uint32_t index) {
+
+	threadJobSystem = this;
+	threadParticipant = index;
+
+	PROFILE_THREAD_NAME((string("Worker ") + to_string(index)).c_str());
+
+	runUntil(nullptr, index);
+
+	threadJobSystem = nullptr;
+	threadParticipant = CGD_JOB_EXTERNAL_THREAD;
+
+	GUMemoryArena::ReleaseThreadScratch();
+}
+
+
+uint32_t CGDJobSystem::currentParticipant() const {
+
+	return (threadJobSystem == this) ? threadParticipant : CGD_JOB_EXTERNAL_THREAD;
+}
+
+
+void CGDJobSystem::submit(CGDJob *job) {
+
+	uint32_t p = currentParticipant();
+
+	if (p != CGD_JOB_EXTERNAL_THREAD) {
+
+		participants[p]->deque.push(job);
+	}
+	else {
+
+		lock_guard<mutex> lock(injectionLock);
+
+		injectionQueue.push_back(job);
+		injectionCount.fetch_add(1, memory_order_release);
+	}
+
+	wake(false);
+}
+
+
+CGDJob* CGDJobSystem::findJob(uint32_t participant) {
+
+	CGDJob *job = nullptr;
+	uint32_t random = 0;
+
+	if (participant != CGD_JOB_EXTERNAL_THREAD) {
+
+		job = participants[participant]->deque.pop();
+
+		if (job)
+			return job;
+
+		// xorshift
+		uint32_t& r = participants[participant]->random;
+
+		r ^= r << 13;
+		r ^= r >> 17;
+		r ^= r << 5;
+		random = r;
+	}
+
+	if (injectionCount.load(memory_order_acquire) > 0) {
+
+		lock_guard<mutex> lock(injectionLock);
+
+		if (!injectionQueue.empty()) {
+
+			job = injectionQueue.front();
+			injectionQueue.pop_front();
+			injectionCount.fetch_sub(1, memory_order_relaxed);
+
+			return job;
+		}
+	}
+
+	// Steal, starting from a random victim so thieves spread over the deques
+	uint32_t n = (uint32_t)participants.size();
+
+	for (uint32_t i = 0; i < n; i++) {
+
+		uint32_t victim = (random + i) % n;
+
+		if (victim == participant)
+			continue;
+
+		job = participants[victim]->deque.steal();
+
+		if (job) {
+
+			if (participant != CGD_JOB_EXTERNAL_THREAD)
+				participants[participant]->jobsStolen.fetch_add(1, memory_order_relaxed);
+
+			return job;
+		}
+	}
+
+	return nullptr;
+}
+
+
+void CGDJobSystem::execute(CGDJob *job, uint32_t participant) {
+
+	job->function();
+
+	CGDJobCounter *counter = job->counter;
+
+	delete job;
+
+	if (participant != CGD_JOB_EXTERNAL_THREAD)
+		participants[participant]->jobsExecuted.fetch_add(1, memory_order_relaxed);
+
+	if (counter)
+		counter->complete();
+}
+
+
+void CGDJobSystem::runUntil(CGDJobCounter *counter, uint32_t participant) {
+
+	uint32_t spins = 0;
+
+	for (;;) {
+
+		if (counter && counter->done())
+			break;
+
+		CGDJob *job = findJob(participant);
+
+		if (job) {
+
+			execute(job, participant);
+			spins = 0;
+			continue;
+		}
+
+		if (!counter && shutdown.load(memory_order_acquire))
+			break;
+
+		if (++spins < idleSpins) {
+
+			this_thread::yield();
+			continue;
+		}
+
+		// Sleep until a job is queued or a counter completes.  The epoch is read before the final check for work so a wake between the check and the wait is not missed
+		uint64_t epoch = wakeEpoch.load(memory_order_seq_cst);
+
+		job = findJob(participant);
+
+		if (job) {
+
+			execute(job, participant);
+			spins = 0;
+			continue;
+		}
+
+		if ((counter && counter->done()) || (!counter && shutdown.load(memory_order_acquire)))
+			break;
+
+		{
+			unique_lock<mutex> lock(sleepLock);
+
+			numSleeping.fetch_add(1, memory_order_seq_cst);
+
+			if (wakeEpoch.load(memory_order_seq_cst) == epoch) {
+
+				if (participant != CGD_JOB_EXTERNAL_THREAD)
+					participants[participant]->sleeps.fetch_add(1, memory_order_relaxed);
+
+				sleepSignal.wait(lock);
+			}
+
+			numSleeping.fetch_sub(1, memory_order_seq_cst);
+		}
+
+		spins = 0;
+	}
+
+	// A waiter may have been woken for a job it did not take - pass the wake on if work is still queued
+	if (counter && numSleeping.load(memory_order_seq_cst) > 0) {
+
+		bool queued = injectionCount.load(memory_order_relaxed) > 0;
+
+		for (size_t i = 0; i < participants.size() && !queued; i++)
+			queued = participants[i]->deque.size() > 0;
+
+		if (queued)
+			wake(false);
+	}
+}
+
+
+void CGDJobSystem::wake(bool all) {
+
+	wakeEpoch.fetch_add(1, memory_order_seq_cst);
+
+	if (numSleeping.load(memory_order_seq_cst) > 0) {
+
+		lock_guard<mutex> lock(sleepLock);
+
+		if (all)
+			sleepSignal.notify_all();
+		else
+			sleepSignal.notify_one();
+	}
+}
+
+
+void CGDJobSystem::releaseContinuation(CGDJob *job) {
+
+	lock_guard<mutex> lock(continuationLock);
+
+	pendingContinuations.erase(job);
+	job->dependency = nullptr;
+}
+
+
+void CGDJobSystem::CounterCompleted(CGDJob **continuations, size_t numContinuations) {
+
+	for (size_t i = 0; i < numContinuations; i++) {
+
+		continuations[i]->system->releaseContinuation(continuations[i]);
+		continuations[i]->system->submit(continuations[i]);
+	}
+
+	// Wake threads waiting on the counter.  A counter is normally completed by a job so only the job system of the calling thread needs waking
+	if (threadJobSystem) {
+
+		threadJobSystem->wake(true);
+	}
+	else {
+
+		lock_guard<mutex> lock(systemsLock);
+
+		for (size_t i = 0; i < systems.size(); i++)
+			systems[i]->wake(true);
+	}
+}
+
+
+void CGDJobSystem::parallelForRange(uint32_t begin, uint32_t end, uint32_t grainSize, const CGDParallelForFunction *body, CGDJobCounter *counter) {
+
+	// Queue the upper half until the range fits the grain size.  Thieves take the oldest (largest) halves while the calling thread works down to a single grain
+	while (end - begin > grainSize) {
+
+		uint32_t mid = begin + (end - begin) / 2;
+
+		run([this, mid, end, grainSize, body, counter]() { parallelForRange(mid, end, grainSize, body, counter); }, counter);
+
+		end = mid;
+	}
+
+	(*body)(begin, end);
+}
+
+
+void CGDJobSystem::SetThreadAffinity(thread& t, uint32_t processor) {
+
+#if defined(_WIN32)
+
+	SetThreadAffinityMask(t.native_handle(), (DWORD_PTR)1 << (processor % (sizeof(DWORD_PTR) * 8)));
+
+#elif defined(__linux__)
+
+	cpu_set_t set;
+
+	CPU_ZERO(&set);
+	CPU_SET(processor, &set);
+
+	pthread_setaffinity_np(t.native_handle(), sizeof(cpu_set_t), &set);
+
+#endif
+}
+
+
+
+//
+// Public interface
+//
+
+// Factory method
+CGDJobSystem* CGDJobSystem::CreateJobSystem(uint32_t numWorkers, CGDThreadAffinity affinity) {
+
+	uint32_t hardwareThreads = thread::hardware_concurrency();
+
+	if (numWorkers == 0)
+		numWorkers = (hardwareThreads > 1) ? hardwareThreads - 1 : 1;
+
+	CGDJobSystem *jobSystem = new CGDJobSystem(numWorkers, affinity);
+
+	try
+	{
+		for (uint32_t i = 1; i <= numWorkers; i++) {
+
+			jobSystem->workers.push_back(thread(&CGDJobSystem::workerMain, jobSystem, i));
+
+			if (affinity == CGDThreadAffinity::PIN_WORKERS && hardwareThreads > 1)
+				SetThreadAffinity(jobSystem->workers.back(), i % hardwareThreads);
+		}
+	}
+	catch (exception& e)
+	{
+		cout << "CGDJobSystem: cannot create worker threads: " << e.what() << endl;
+
+		jobSystem->release();
+		return nullptr;
+	}
+
+	return jobSystem;
+}
+
+
+// Destructor
+CGDJobSystem::~CGDJobSystem() {
+
+	shutdown.store(true, memory_order_release);
+	wake(true);
+
+	for (size_t i = 0; i < workers.size(); i++)
+		workers[i].join();
+
+	// Jobs waiting on counters that have not reached zero can never run.  Detach them from their counters so a later completion does not queue them on a destroyed job system
+	vector<CGDJob*> discarded;
+
+	{
+		lock_guard<mutex> lock(continuationLock);
+
+		discarded.assign(pendingContinuations.begin(), pendingContinuations.end());
+		pendingContinuations.clear();
+	}
+
+	if (!discarded.empty())
+		cout << "CGDJobSystem: " << discarded.size() << " jobs waiting on incomplete counters were discarded" << endl;
+
+	for (size_t i = 0; i < discarded.size(); i++) {
+
+		CGDJobCounter *dependency = discarded[i]->dependency;
+
+		dependency->lock();
+		dependency->continuations.erase(find(dependency->continuations.begin(), dependency->continuations.end(), discarded[i]));
+		dependency->unlock();
+
+		delete discarded[i];
+	}
+
+	{
+		lock_guard<mutex> lock(systemsLock);
+
+		systems.erase(find(systems.begin(), systems.end(), this));
+
+		// Release the list's storage with the last job system so it is not reported as a leak
+		if (systems.empty())
+			vector<CGDJobSystem*>().swap(systems);
+	}
+
+	if (threadJobSystem == this) {
+
+		threadJobSystem = nullptr;
+		threadParticipant = CGD_JOB_EXTERNAL_THREAD;
+	}
+
+	for (size_t i = 0; i < participants.size(); i++)
+		delete participants[i];
+}
+
+
+void CGDJobSystem::run(const CGDJobFunction& job, CGDJobCounter *counter) {
+
+	if (counter)
+		counter->add();
+
+	submit(NewJob(job, counter, this));
+}
+
+
+void CGDJobSystem::runAfter(CGDJobCounter *dependency, const CGDJobFunction& job, CGDJobCounter *counter) {
+
+	if (counter)
+		counter->add();
+
+	CGDJob *j = NewJob(job, counter, this);
+
+	if (!dependency) {
+
+		submit(j);
+		return;
+	}
+
+	dependency->lock();
+
+	if ((dependency->count.load(memory_order_relaxed) & ~CGDJobCounter::lockBit) == 0) {
+
+		dependency->unlock();
+		submit(j);
+	}
+	else {
+
+		GU_MEMORY_TAG_SCOPE(gu_mem_jobs);
+
+		{
+			lock_guard<mutex> lock(continuationLock);
+
+			j->dependency = dependency;
+			pendingContinuations.insert(j);
+		}
+
+		dependency->continuations.push_back(j);
+		dependency->unlock();
+	}
+}
+
+
+void CGDJobSystem::wait(CGDJobCounter *counter) {
+
+	if (!counter)
+		return;
+
+	runUntil(counter, currentParticipant());
+}
+
+
+void CGDJobSystem::parallelFor(uint32_t begin, uint32_t end, uint32_t grainSize, const CGDParallelForFunction& body) {
+
+	if (end <= begin)
+		return;
+
+	uint32_t n = end - begin;
+
+	if (grainSize == 0)
+		grainSize = max(n / (threadCount() * 4), 1u);
+
+	if (n <= grainSize) {
+
+		body(begin, end);
+		return;
+	}
+
+	CGDJobCounter counter;
+
+	parallelForRange(begin, end, grainSize, &body, &counter);
+
+	wait(&counter);
+}
+
+
+uint32_t CGDJobSystem::workerCount() const {
+
+	return (uint32_t)workers.size();
+}
+
+
+uint32_t CGDJobSystem::threadCount() const {
+
+	return (uint32_t)participants.size();
+}
+
+
+uint32_t CGDJobSystem::threadIndex() const {
+
+	return currentParticipant();
+}
+
+
+CGDJobThreadStats CGDJobSystem::threadStats(uint32_t index) const {
+
+	CGDJobThreadStats stats;
+
+	if (index < participants.size()) {
+
+		stats.jobsExecuted = participants[index]->jobsExecuted.load(memory_order_relaxed);
+		stats.jobsStolen = participants[index]->jobsStolen.load(memory_order_relaxed);
+		stats.sleeps = participants[index]->sleeps.load(memory_order_relaxed);
+	}
+
+	return stats;
+}
+
+
+void CGDJobSystem::reportStats() const {
+
+	cout << "Job system: " << workers.size() << " workers" << ((affinity == CGDThreadAffinity::PIN_WORKERS) ? " (pinned)" : "") << endl;
+
+	for (uint32_t i = 0; i < participants.size(); i++) {
+
+		CGDJobThreadStats stats = threadStats(i);
+
+		cout << ((i == 0) ? "  Main thread" : "  Worker ") << ((i == 0) ? string() : to_string(i)) << ": executed = " << stats.jobsExecuted << ", stolen = " << stats.jobsStolen << ", sleeps = " << stats.sleeps << endl;
+	}
+}
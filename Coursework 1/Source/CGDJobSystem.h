@@ -0,0 +1,233 @@
+//
+// CGDJobSystem.h
+//
+
+// Work-stealing job scheduler.  The thread that creates the job system and each worker thread own a Chase-Lev work-stealing deque (CGDJobDeque).  A thread pushes the jobs it creates onto the bottom of its own deque and pops from the bottom (most recent first, so nested work stays cache warm), while idle threads steal from the top of other threads' deques (oldest first, so thieves take the largest pieces of recursively split work).  Jobs created on threads outside the job system go into a shared injection queue.
+//
+// Completion is tracked with CGDJobCounter.  run increments a counter when the job is queued and decrements it when the job finishes, runAfter defers a job until a counter reaches zero (dependencies without blocking a thread) and wait blocks until a counter reaches zero.  Waiting is fiber-free - the waiting thread executes other jobs until the counter is done and only sleeps when there is no work to do, so waiting from the main thread or from inside a job never leaves a core idle or deadlocks the pool.  Idle threads spin briefly and then sleep until new work is queued or a counter completes.
+//
+// Workers register themselves with CGDProfiler (so their zones appear as named threads in exported traces) and release their scratch arena (see GUMemoryArena) on exit.
+
+#pragma once
+
+#include <GUObject.h>
+#include <cstdint>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+
+class CGDJobSystem;
+struct CGDJob;
+
+typedef std::function<void()>									CGDJobFunction;
+typedef std::function<void(uint32_t begin, uint32_t end)>		CGDParallelForFunction;
+
+
+// Thread index returned by CGDJobSystem::threadIndex for threads that do not belong to the job system
+#define CGD_JOB_EXTERNAL_THREAD			0xFFFFFFFF
+
+
+// Worker thread placement
+enum class CGDThreadAffinity : uint8_t {
+
+	NONE = 0, // let the OS schedule workers
+	PIN_WORKERS // pin worker i to logical processor i + 1 (the creating thread keeps processor 0 to itself)
+};
+
+
+// Job completion counter.  A counter must not be destroyed until wait has returned for it (or it is otherwise known that no job still references it).  Jobs queued with runAfter on a counter that is destroyed before it reaches zero can never run and are discarded
+class CGDJobCounter {
+
+	friend class CGDJobSystem;
+
+	// The top bit locks the continuation list (see runAfter) - the counter is only done when the whole word is zero
+	static const uint32_t			lockBit = 0x80000000;
+
+	std::atomic<uint32_t>			count;
+	std::vector<CGDJob*>			continuations; // jobs queued by runAfter, released when the count reaches zero
+
+	void lock();
+	void unlock();
+
+public:
+
+	CGDJobCounter() : count(0) {}
+	~CGDJobCounter();
+
+	bool done() const { return count.load(std::memory_order_acquire) == 0; }
+
+	// Add / complete units of work tracked by the counter (run does this for each job).  When the count reaches zero any jobs waiting on the counter (runAfter) are queued and threads blocked in wait are woken
+	void add(uint32_t n = 1) { count.fetch_add(n, std::memory_order_relaxed); }
+	void complete(uint32_t n = 1);
+
+private:
+
+	CGDJobCounter(const CGDJobCounter&);
+	CGDJobCounter& operator=(const CGDJobCounter&);
+};
+
+
+// Chase-Lev work-stealing deque of job pointers (Le, Pop, Cohen and Zappa Nardelli, "Correct and Efficient Work-Stealing for Weak Memory Models", 2013).  push and pop may only be called by the owning thread, steal by any thread.  The ring buffer grows when full - replaced buffers are kept until the deque is destroyed since a concurrent thief may still be reading them
+class CGDJobDeque {
+
+	struct Buffer {
+
+		int64_t						capacity; // power of 2
+		std::atomic<CGDJob*>		*jobs;
+
+		CGDJob* get(int64_t i) const { return jobs[i & (capacity - 1)].load(std::memory_order_relaxed); }
+		void put(int64_t i, CGDJob *job) { jobs[i & (capacity - 1)].store(job, std::memory_order_relaxed); }
+	};
+
+	std::atomic<int64_t>			top;
+	std::atomic<int64_t>			bottom;
+	std::atomic<Buffer*>			buffer;
+	std::vector<Buffer*>			buffers; // all buffers allocated (owner only)
+
+	Buffer* allocateBuffer(int64_t capacity);
+
+public:
+
+	CGDJobDeque(int64_t capacity = 1024);
+	~CGDJobDeque();
+
+	// Owner interface
+	void push(CGDJob *job);
+	CGDJob* pop(); // nullptr if empty
+
+	// Thief interface.  Return nullptr if the deque is empty or another thread took the job first
+	CGDJob* steal();
+
+	// Approximate number of queued jobs
+	int64_t size() const;
+
+private:
+
+	CGDJobDeque(const CGDJobDeque&);
+	CGDJobDeque& operator=(const CGDJobDeque&);
+};
+
+
+// Per-thread scheduling statistics
+struct CGDJobThreadStats {
+
+	uint64_t				jobsExecuted = 0;
+	uint64_t				jobsStolen = 0; // jobs this thread took from other threads' deques
+	uint64_t				sleeps = 0; // times the thread went to sleep for lack of work
+};
+
+
+class CGDJobSystem : public GUObject {
+
+	friend class CGDJobCounter;
+
+	// Thread participating in the job system (index 0 is the creating thread, 1..n the workers)
+	struct Participant {
+
+		CGDJobDeque						deque;
+		uint32_t						random; // steal victim selection (xorshift)
+
+		std::atomic<uint64_t>			jobsExecuted;
+		std::atomic<uint64_t>			jobsStolen;
+		std::atomic<uint64_t>			sleeps;
+
+		Participant() : random(0), jobsExecuted(0), jobsStolen(0), sleeps(0) {}
+	};
+
+	std::vector<Participant*>		participants;
+	std::vector<std::thread>		workers;
+	CGDThreadAffinity				affinity = CGDThreadAffinity::NONE;
+
+	// Jobs queued by threads outside the job system
+	std::deque<CGDJob*>				injectionQueue;
+	std::mutex						injectionLock;
+	std::atomic<uint32_t>			injectionCount;
+
+	// Idle threads sleep on sleepSignal until wakeEpoch changes
+	std::mutex						sleepLock;
+	std::condition_variable			sleepSignal;
+	std::atomic<uint64_t>			wakeEpoch;
+	std::atomic<uint32_t>			numSleeping;
+	std::atomic<bool>				shutdown;
+
+	// Jobs queued by runAfter that are waiting on a counter.  Discarded (and reported) if the job system is destroyed first
+	std::unordered_set<CGDJob*>		pendingContinuations;
+	std::mutex						continuationLock;
+
+
+	//
+	// Private interface
+	//
+
+	// Constructor - called internally by the CreateJobSystem factory method
+	CGDJobSystem(uint32_t numWorkers, CGDThreadAffinity affinity);
+
+	void workerMain(uint32_t index);
+
+	// Return the calling thread's participant index or CGD_JOB_EXTERNAL_THREAD
+	uint32_t currentParticipant() const;
+
+	// Queue job on the calling thread's deque (or the injection queue) and wake a sleeping thread
+	void submit(CGDJob *job);
+
+	// Find a job for the given participant (own deque, injection queue, then steal).  Return nullptr if no work is available
+	CGDJob* findJob(uint32_t participant);
+
+	void execute(CGDJob *job, uint32_t participant);
+
+	// Run jobs until counter is done (counter may be nullptr - run until shutdown).  Sleep when no work is available
+	void runUntil(CGDJobCounter *counter, uint32_t participant);
+
+	// Wake sleeping threads.  all = false wakes one thread (new job), all = true wakes every thread (counter completed)
+	void wake(bool all);
+
+	// Remove job from pendingContinuations
+	void releaseContinuation(CGDJob *job);
+
+	// Called on the thread that completes counter.  Queue its continuations and wake waiting threads
+	static void CounterCompleted(CGDJob **continuations, size_t numContinuations);
+
+	// Recursively split [begin, end) into grainSize ranges
+	void parallelForRange(uint32_t begin, uint32_t end, uint32_t grainSize, const CGDParallelForFunction *body, CGDJobCounter *counter);
+
+	static void SetThreadAffinity(std::thread& thread, uint32_t processor);
+
+
+public:
+
+	//
+	// Public interface
+	//
+
+	// Factory method.  Create numWorkers worker threads (0 = one per hardware thread less one for the calling thread, minimum 1).  The calling thread becomes thread 0 of the job system - it should be the thread that waits on the jobs it creates (eg. the main thread)
+	static CGDJobSystem* CreateJobSystem(uint32_t numWorkers = 0, CGDThreadAffinity affinity = CGDThreadAffinity::NONE);
+
+	// Destructor.  Queued jobs are completed before the workers exit.  Jobs still waiting on a counter (runAfter) are discarded
+	~CGDJobSystem();
+
+	// Queue job.  If counter is not nullptr it is incremented now and decremented when the job completes
+	void run(const CGDJobFunction& job, CGDJobCounter *counter = nullptr);
+
+	// Queue job once dependency reaches zero (immediately if it is already zero).  counter is incremented now so waiting on it also waits for the dependency
+	void runAfter(CGDJobCounter *dependency, const CGDJobFunction& job, CGDJobCounter *counter = nullptr);
+
+	// Block until counter reaches zero, executing queued jobs on the calling thread while waiting
+	void wait(CGDJobCounter *counter);
+
+	// Call body on sub-ranges of [begin, end) of at most grainSize indices (0 = automatic - about 4 ranges per thread) in parallel and return when all have completed.  The calling thread takes part
+	void parallelFor(uint32_t begin, uint32_t end, uint32_t grainSize, const CGDParallelForFunction& body);
+
+	// Query methods
+	uint32_t workerCount() const;
+	uint32_t threadCount() const; // workers + the creating thread
+	uint32_t threadIndex() const; // calling thread's index (0 = creating thread) or CGD_JOB_EXTERNAL_THREAD - for indexing per-thread data inside jobs
+	CGDJobThreadStats threadStats(uint32_t index) const;
+
+	void reportStats() const;
+};
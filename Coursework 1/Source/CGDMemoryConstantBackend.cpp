@@ -0,0 +1,131 @@
+
+//
+// CGDMemoryConstantBackend.cpp
+//
+
+#include <stdafx.h>
+#include <CGDMemoryConstantBackend.h>
+#include <cstring>
+
+using namespace std;
+
+
+// Value of the bytes of a discarded ring
+static const uint8_t discardedByte = 0xCD;
+
+
+
+//
+// Private interface
+//
+
+// Constructor - called internally by the CreateMemoryConstantBackend factory method
+CGDMemoryConstantBackend::CGDMemoryConstantBackend(uint32_t ringSize, bool canAppend) {
+
+	ring.resize(ringSize, discardedByte);
+	append = canAppend;
+}
+
+
+
+//
+// Public interface
+//
+
+// Factory method
+CGDMemoryConstantBackend* CGDMemoryConstantBackend::CreateMemoryConstantBackend(uint32_t ringSize, bool canAppend) {
+
+	if (ringSize == 0)
+		return nullptr;
+
+	return new CGDMemoryConstantBackend(ringSize, canAppend);
+}
+
+
+void* CGDMemoryConstantBackend::objectBuffer() const {
+
+	return (void*)ring.data();
+}
+
+
+uint32_t CGDMemoryConstantBackend::objectBufferSize() const {
+
+	return (uint32_t)ring.size();
+}
+
+
+bool CGDMemoryConstantBackend::canAppend() const {
+
+	return append;
+}
+
+
+bool CGDMemoryConstantBackend::writeObjects(uint32_t offset, const void *data, uint32_t size, bool discard) {
+
+	if ((uint64_t)offset + size > ring.size() || (!discard && !append))
+		return false;
+
+	if (discard)
+		memset(ring.data(), discardedByte, ring.size());
+
+	memcpy(&ring[offset], data, size);
+
+	bytesWritten += size;
+	writes++;
+
+	return true;
+}
+
+
+bool CGDMemoryConstantBackend::writeFrame(const void *data, uint32_t size) {
+
+	frame.assign((const uint8_t*)data, (const uint8_t*)data + size);
+
+	bytesWritten += size;
+	writes++;
+
+	return true;
+}
+
+
+bool CGDMemoryConstantBackend::writeView(void *context, const void *data, uint32_t size) {
+
+	views[context].assign((const uint8_t*)data, (const uint8_t*)data + size);
+
+	bytesWritten += size;
+	writes++;
+
+	return true;
+}
+
+
+const uint8_t* CGDMemoryConstantBackend::getObjects(uint32_t offset) const {
+
+	return &ring[offset];
+}
+
+
+const uint8_t* CGDMemoryConstantBackend::getFrame() const {
+
+	return frame.data();
+}
+
+
+const uint8_t* CGDMemoryConstantBackend::getView(void *context) const {
+
+	auto view = views.find(context);
+
+	return (view != views.end()) ? view->second.data() : nullptr;
+}
+
+
+uint64_t CGDMemoryConstantBackend::getBytesWritten() const {
+
+	return bytesWritten;
+}
+
+
+uint64_t CGDMemoryConstantBackend::getWrites() const {
+
+	return writes;
+}
@@ -0,0 +1,60 @@
+//
+// CGDMemoryConstantBackend.h
+//
+
+// CGDConstantBufferBackend that keeps the constant buffers in CPU memory instead of on a device.  Used to measure and check a CGDConstantBuffers without a device - the contents of each buffer can be read back, discarding the object ring fills it with garbage so an object that is bound to a slot it was not rewritten to after a discard is detected, and the bytes written are counted independently of the manager's statistics.  Views are kept per context (any handle identifies a context) and the backend is not thread safe.
+
+#pragma once
+
+#include <CGDConstantBuffers.h>
+#include <cstdint>
+#include <vector>
+#include <unordered_map>
+
+
+class CGDMemoryConstantBackend : public CGDConstantBufferBackend {
+
+	std::vector<uint8_t>								ring;
+	std::vector<uint8_t>								frame;
+	std::unordered_map<void*, std::vector<uint8_t>>		views;
+	bool												append;
+
+	uint64_t											bytesWritten = 0;
+	uint64_t											writes = 0;
+
+
+	//
+	// Private interface
+	//
+
+	// Constructor - called internally by the CreateMemoryConstantBackend factory method
+	CGDMemoryConstantBackend(uint32_t ringSize, bool canAppend);
+
+
+public:
+
+	//
+	// Public interface
+	//
+
+	// Factory method.  ringSize is the size of the object ring in bytes.  canAppend = false behaves like a device that cannot map dynamic constant buffers without discarding them
+	static CGDMemoryConstantBackend* CreateMemoryConstantBackend(uint32_t ringSize, bool canAppend = true);
+
+	// CGDConstantBufferBackend interface
+	void* objectBuffer() const;
+	uint32_t objectBufferSize() const;
+	bool canAppend() const;
+
+	bool writeObjects(uint32_t offset, const void *data, uint32_t size, bool discard);
+	bool writeFrame(const void *data, uint32_t size);
+	bool writeView(void *context, const void *data, uint32_t size);
+
+	// Contents of the buffers.  getView returns nullptr if nothing has been written on context
+	const uint8_t* getObjects(uint32_t offset) const;
+	const uint8_t* getFrame() const;
+	const uint8_t* getView(void *context) const;
+
+	// Bytes and writes of all the buffers since the backend was created
+	uint64_t getBytesWritten() const;
+	uint64_t getWrites() const;
+};
@@ -0,0 +1,754 @@
+
+//
+// CGDOcean.cpp
+//
+
+#include <stdafx.h>
+#include <CGDOcean.h>
+#include <CGDJobSystem.h>
+#include <CGDClock.h>
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <iomanip>
+#include <sstream>
+#include <emmintrin.h>
+
+using namespace std;
+
+
+static const double			pi = 3.14159265358979323846;
+static const uint32_t		columnBlock = 16; // columns transformed together by the fast path (4 SSE registers)
+static const uint32_t		numTransforms = 3; // height + i slope x, displacement x + i displacement z, slope z
+static const float			referenceTolerance = 1.0e-3f; // largest fast path difference from the reference accepted by benchmark (relative to the largest reference value)
+
+
+// Reverse the low bits bits of i
+static uint32_t ReverseBits(uint32_t i, uint32_t bits) {
+
+	uint32_t r = 0;
+
+	for (uint32_t b = 0; b < bits; b++, i >>= 1)
+		r = (r << 1) | (i & 1);
+
+	return r;
+}
+
+
+// Signed frequency of FFT index i (indices size / 2 and above are negative frequencies)
+static int32_t FrequencyIndex(uint32_t i, uint32_t size) {
+
+	return (i < size / 2) ? (int32_t)i : (int32_t)i - (int32_t)size;
+}
+
+
+// Dispersion relation for deep water quantised to whole multiples of 2 pi / repeatPeriod
+static double FrequencySteps(double k, double gravity, double repeatPeriod) {
+
+	return floor(sqrt(gravity * k) * repeatPeriod / (2.0 * pi));
+}
+
+
+// Uniform random number in [0, 1) (xorshift)
+static float RandomFloat(uint32_t& state) {
+
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+
+	return (float)(state >> 8) / 16777216.0f;
+}
+
+
+// Pair of standard normal random numbers (Box-Muller)
+static void GaussianPair(uint32_t& state, float& a, float& b) {
+
+	float u1 = max(RandomFloat(state), 1.0e-7f);
+	float u2 = RandomFloat(state);
+	float r = sqrtf(-2.0f * logf(u1));
+
+	a = r * cosf((float)(2.0 * pi) * u2);
+	b = r * sinf((float)(2.0 * pi) * u2);
+}
+
+
+static inline __m128 Select4(__m128 mask, __m128 a, __m128 b) {
+
+	return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+
+// sin(x) of 4 values in [-pi, pi].  x is folded into [-pi / 2, pi / 2] (sin(x) = sin(pi - x)) where the Taylor series to x^11 is accurate to 6e-8
+static inline __m128 Sin4(__m128 x) {
+
+	const __m128 halfPi = _mm_set1_ps((float)(pi * 0.5));
+	const __m128 pi4 = _mm_set1_ps((float)pi);
+	const __m128 negPi = _mm_set1_ps((float)-pi);
+
+	x = Select4(_mm_cmpgt_ps(x, halfPi), _mm_sub_ps(pi4, x), x);
+	x = Select4(_mm_cmplt_ps(x, _mm_sub_ps(_mm_setzero_ps(), halfPi)), _mm_sub_ps(negPi, x), x);
+
+	__m128 x2 = _mm_mul_ps(x, x);
+	__m128 p = _mm_set1_ps(-1.0f / 39916800.0f);
+
+	p = _mm_add_ps(_mm_mul_ps(p, x2), _mm_set1_ps(1.0f / 362880.0f));
+	p = _mm_add_ps(_mm_mul_ps(p, x2), _mm_set1_ps(-1.0f / 5040.0f));
+	p = _mm_add_ps(_mm_mul_ps(p, x2), _mm_set1_ps(1.0f / 120.0f));
+	p = _mm_add_ps(_mm_mul_ps(p, x2), _mm_set1_ps(-1.0f / 6.0f));
+	p = _mm_add_ps(_mm_mul_ps(p, x2), _mm_set1_ps(1.0f));
+
+	return _mm_mul_ps(p, x);
+}
+
+
+// In-place inverse radix-2 FFT of n complex values stride elements apart (reference implementation)
+static void ReferenceInverseFFT(complex<double> *data, uint32_t n, uint32_t bits, uint32_t stride) {
+
+	for (uint32_t i = 0; i < n; i++) {
+
+		uint32_t j = ReverseBits(i, bits);
+
+		if (j > i)
+			swap(data[i * stride], data[j * stride]);
+	}
+
+	for (uint32_t half = 1; half < n; half <<= 1) {
+
+		for (uint32_t j = 0; j < half; j++) {
+
+			complex<double> w = polar(1.0, pi * (double)j / (double)half);
+
+			for (uint32_t a = j; a < n; a += half * 2) {
+
+				complex<double> t = w * data[(a + half) * stride];
+
+				data[(a + half) * stride] = data[a * stride] - t;
+				data[a * stride] += t;
+			}
+		}
+	}
+}
+
+
+
+//
+// Private interface
+//
+
+// Constructor - called internally by the CreateOcean factory method
+CGDOcean::CGDOcean(const CGDOceanDesc& _desc, CGDJobSystem *_jobSystem) {
+
+	desc = _desc;
+
+	float windLength = sqrtf(desc.windDirX * desc.windDirX + desc.windDirZ * desc.windDirZ);
+
+	if (windLength > 0.0f) {
+
+		desc.windDirX /= windLength;
+		desc.windDirZ /= windLength;
+
+	} else {
+
+		desc.windDirX = 1.0f;
+		desc.windDirZ = 0.0f;
+	}
+
+	jobSystem = _jobSystem;
+
+	if (jobSystem)
+		jobSystem->retain();
+
+	size = desc.resolution;
+
+	while ((1u << log2Size) < size)
+		log2Size++;
+
+	initialise();
+}
+
+
+void CGDOcean::initialise() {
+
+	uint32_t n2 = size * size;
+	float dk = (float)(2.0 * pi) / desc.patchSize;
+
+	// Draw h0(k) = (xr + i xi) sqrt(P(k) / 2) dk for every element in natural order.  The Nyquist row and column have no matching -k and are left empty so the maps are real
+	vector<float> h0(n2 * 2);
+	uint32_t state = desc.seed * 0x9E3779B9u + 0x6A09E667u;
+
+	if (state == 0)
+		state = 1;
+
+	for (uint32_t i = 0; i < size; i++) {
+
+		for (uint32_t j = 0; j < size; j++) {
+
+			float kx = (float)FrequencyIndex(j, size) * dk;
+			float kz = (float)FrequencyIndex(i, size) * dk;
+			float xr, xi;
+
+			GaussianPair(state, xr, xi);
+
+			float scale = (i == size / 2 || j == size / 2) ? 0.0f : sqrtf(phillips(kx, kz) * 0.5f) * dk;
+
+			h0[(i * size + j) * 2] = xr * scale;
+			h0[(i * size + j) * 2 + 1] = xi * scale;
+		}
+	}
+
+	initialSpectrum.resize(n2 * 4);
+
+	for (uint32_t i = 0; i < size; i++) {
+
+		for (uint32_t j = 0; j < size; j++) {
+
+			uint32_t e = i * size + j;
+			uint32_t opposite = ((size - i) & (size - 1)) * size + ((size - j) & (size - 1));
+
+			initialSpectrum[e * 4] = h0[e * 2];
+			initialSpectrum[e * 4 + 1] = h0[e * 2 + 1];
+			initialSpectrum[e * 4 + 2] = h0[opposite * 2];
+			initialSpectrum[e * 4 + 3] = -h0[opposite * 2 + 1];
+		}
+	}
+
+	// Fast path constants.  Element (r, c) holds frequency (ReverseBits(r), ReverseBits(c)) so both FFT passes read their input in the bit-reversed order a decimation in time FFT needs
+	h0Planes.resize(n2 * 4);
+	inverseK.resize(n2);
+	frequencySteps.resize(n2);
+	columnK.resize(size);
+	rowK.resize(size);
+
+	for (uint32_t r = 0; r < size; r++) {
+
+		rowK[r] = (float)FrequencyIndex(ReverseBits(r, log2Size), size) * dk;
+		columnK[r] = rowK[r];
+	}
+
+	for (uint32_t r = 0; r < size; r++) {
+
+		uint32_t i = ReverseBits(r, log2Size);
+
+		for (uint32_t c = 0; c < size; c++) {
+
+			uint32_t j = ReverseBits(c, log2Size);
+			uint32_t e = i * size + j;
+			uint32_t s = r * size + c;
+			double k = sqrt((double)columnK[c] * columnK[c] + (double)rowK[r] * rowK[r]);
+
+			for (int p = 0; p < 4; p++)
+				h0Planes[p * n2 + s] = initialSpectrum[e * 4 + p];
+
+			inverseK[s] = (k > 0.0) ? (float)(1.0 / k) : 0.0f;
+			frequencySteps[s] = (float)FrequencySteps(k, desc.gravity, desc.repeatPeriod);
+		}
+	}
+
+	twiddles.resize(size);
+
+	for (uint32_t j = 0; j < size / 2; j++) {
+
+		twiddles[j] = (float)cos(2.0 * pi * (double)j / (double)size);
+		twiddles[size / 2 + j] = (float)sin(2.0 * pi * (double)j / (double)size);
+	}
+
+	workPitch = size + columnBlock;
+	workPlaneSize = size * workPitch + columnBlock * 2;
+	work.resize(workPlaneSize * numTransforms * 2);
+	displacementMap.assign(n2 * 4, 0.0f);
+	normalMap.assign(n2 * 4, 0.0f);
+
+	for (uint32_t i = 0; i < n2; i++)
+		normalMap[i * 4 + 1] = 1.0f;
+}
+
+
+float CGDOcean::phillips(float kx, float kz) const {
+
+	float k2 = kx * kx + kz * kz;
+
+	if (k2 == 0.0f)
+		return 0.0f;
+
+	// Largest wave from the wind speed
+	float L = desc.windSpeed * desc.windSpeed / desc.gravity;
+	float kDotW = (kx * desc.windDirX + kz * desc.windDirZ) / sqrtf(k2);
+	float p = desc.amplitude * expf(-1.0f / (k2 * L * L)) / (k2 * k2) * kDotW * kDotW * expf(-k2 * desc.smallWaveLength * desc.smallWaveLength);
+
+	return (kDotW < 0.0f) ? p * desc.oppositeWaveScale : p;
+}
+
+
+// Spectrum of rows [begin, end) at the given fraction of the repeat period.  With e = exp(i w t), h(k, t) = h0(k) e + conj(h0(-k)) conj(e) and the transforms are
+//
+//	A = h + i (i kx h)							height + i slope x
+//	B = (i kx / |k|) h + i (i kz / |k|) h		displacement x + i displacement z (points move towards the crests)
+//	C = i kz h									slope z
+void CGDOcean::generateRows(uint32_t begin, uint32_t end, float fraction) {
+
+	const uint32_t n2 = size * size;
+	const uint32_t plane = workPlaneSize;
+	const __m128 f = _mm_set1_ps(fraction);
+	const __m128 half = _mm_set1_ps(0.5f);
+	const __m128 twoPi = _mm_set1_ps((float)(2.0 * pi));
+	const __m128 pi4 = _mm_set1_ps((float)pi);
+	const __m128 halfPi = _mm_set1_ps((float)(pi * 0.5));
+	const __m128 zero = _mm_setzero_ps();
+
+	for (uint32_t r = begin; r < end; r++) {
+
+		uint32_t row = r * size;
+		float *aRe = &work[r * workPitch], *aIm = aRe + plane;
+		float *bRe = aRe + 2 * plane, *bIm = aRe + 3 * plane;
+		float *cRe = aRe + 4 * plane, *cIm = aRe + 5 * plane;
+		const float *h0Re = &h0Planes[row], *h0Im = &h0Planes[n2 + row];
+		const float *gRe = &h0Planes[2 * n2 + row], *gIm = &h0Planes[3 * n2 + row];
+		const float *invK = &inverseK[row], *steps = &frequencySteps[row];
+		__m128 kz = _mm_set1_ps(rowK[r]);
+
+		for (uint32_t c = 0; c < size; c += 4) {
+
+			// Phase 2 pi frac(steps * fraction) moved to [-pi, pi) - sin and cos of the phase are the negated sin and cos of x
+			__m128 p = _mm_mul_ps(_mm_loadu_ps(steps + c), f);
+			__m128 x = _mm_mul_ps(_mm_sub_ps(_mm_sub_ps(p, _mm_cvtepi32_ps(_mm_cvttps_epi32(p))), half), twoPi);
+			__m128 xc = _mm_add_ps(x, halfPi);
+
+			xc = Select4(_mm_cmpgt_ps(xc, pi4), _mm_sub_ps(xc, twoPi), xc);
+
+			__m128 s = _mm_sub_ps(zero, Sin4(x));
+			__m128 co = _mm_sub_ps(zero, Sin4(xc));
+
+			__m128 a = _mm_loadu_ps(h0Re + c), b = _mm_loadu_ps(h0Im + c);
+			__m128 g = _mm_loadu_ps(gRe + c), q = _mm_loadu_ps(gIm + c);
+			__m128 hr = _mm_add_ps(_mm_mul_ps(_mm_add_ps(a, g), co), _mm_mul_ps(_mm_sub_ps(q, b), s));
+			__m128 hi = _mm_add_ps(_mm_mul_ps(_mm_sub_ps(a, g), s), _mm_mul_ps(_mm_add_ps(b, q), co));
+
+			__m128 kx = _mm_loadu_ps(&columnK[c]);
+			__m128 ik = _mm_loadu_ps(invK + c);
+			__m128 kxn = _mm_mul_ps(kx, ik), kzn = _mm_mul_ps(kz, ik);
+
+			_mm_storeu_ps(aRe + c, _mm_sub_ps(hr, _mm_mul_ps(kx, hr)));
+			_mm_storeu_ps(aIm + c, _mm_sub_ps(hi, _mm_mul_ps(kx, hi)));
+			_mm_storeu_ps(bRe + c, _mm_sub_ps(zero, _mm_add_ps(_mm_mul_ps(kxn, hi), _mm_mul_ps(kzn, hr))));
+			_mm_storeu_ps(bIm + c, _mm_sub_ps(_mm_mul_ps(kxn, hr), _mm_mul_ps(kzn, hi)));
+			_mm_storeu_ps(cRe + c, _mm_sub_ps(zero, _mm_mul_ps(kz, hi)));
+			_mm_storeu_ps(cIm + c, _mm_mul_ps(kz, hr));
+		}
+	}
+}
+
+
+// Inverse FFT down the columns of column blocks [begin, end) of every transform.  Rows are in bit-reversed order so the butterflies work in place from the smallest span up
+void CGDOcean::transformColumns(uint32_t begin, uint32_t end) {
+
+	const uint32_t plane = workPlaneSize;
+	const float *twiddleCos = &twiddles[0], *twiddleSin = &twiddles[size / 2];
+
+	for (uint32_t block = begin; block < end; block++) {
+
+		float *base = &work[block * columnBlock];
+
+		for (uint32_t half = 1, step = size / 2; half < size; half <<= 1, step >>= 1) {
+
+			// Groups of 2 * half rows in memory order
+			for (uint32_t group = 0; group < size; group += half * 2) {
+
+				for (uint32_t j = 0; j < half; j++) {
+
+					__m128 wr = _mm_set1_ps(twiddleCos[j * step]);
+					__m128 wi = _mm_set1_ps(twiddleSin[j * step]);
+
+					for (uint32_t t = 0; t < numTransforms; t++) {
+
+						float *reA = base + 2 * t * plane + (group + j) * workPitch, *imA = reA + plane;
+						float *reB = reA + half * workPitch, *imB = reB + plane;
+
+						for (uint32_t v = 0; v < columnBlock; v += 4) {
+
+							__m128 br = _mm_loadu_ps(reB + v), bi = _mm_loadu_ps(imB + v);
+							__m128 tr = _mm_sub_ps(_mm_mul_ps(wr, br), _mm_mul_ps(wi, bi));
+							__m128 ti = _mm_add_ps(_mm_mul_ps(wr, bi), _mm_mul_ps(wi, br));
+							__m128 ar = _mm_loadu_ps(reA + v), ai = _mm_loadu_ps(imA + v);
+
+							_mm_storeu_ps(reB + v, _mm_sub_ps(ar, tr));
+							_mm_storeu_ps(imB + v, _mm_sub_ps(ai, ti));
+							_mm_storeu_ps(reA + v, _mm_add_ps(ar, tr));
+							_mm_storeu_ps(imA + v, _mm_add_ps(ai, ti));
+						}
+					}
+				}
+			}
+		}
+	}
+}
+
+
+// Transpose every work plane in place.  Block row i swaps its 4x4 blocks right of the diagonal with the matching blocks below it, so block rows can be transposed concurrently
+void CGDOcean::transposeRows(uint32_t begin, uint32_t end) {
+
+	const uint32_t pitch = workPitch;
+
+	for (uint32_t plane = 0; plane < numTransforms * 2; plane++) {
+
+		float *m = &work[plane * workPlaneSize];
+
+		for (uint32_t bi = begin; bi < end; bi++) {
+
+			float *diagonal = m + bi * 4 * pitch + bi * 4;
+			__m128 r0 = _mm_loadu_ps(diagonal), r1 = _mm_loadu_ps(diagonal + pitch), r2 = _mm_loadu_ps(diagonal + 2 * pitch), r3 = _mm_loadu_ps(diagonal + 3 * pitch);
+
+			_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+
+			_mm_storeu_ps(diagonal, r0);
+			_mm_storeu_ps(diagonal + pitch, r1);
+			_mm_storeu_ps(diagonal + 2 * pitch, r2);
+			_mm_storeu_ps(diagonal + 3 * pitch, r3);
+
+			for (uint32_t bj = bi + 1; bj < size / 4; bj++) {
+
+				float *upper = m + bi * 4 * pitch + bj * 4;
+				float *lower = m + bj * 4 * pitch + bi * 4;
+				__m128 u0 = _mm_loadu_ps(upper), u1 = _mm_loadu_ps(upper + pitch), u2 = _mm_loadu_ps(upper + 2 * pitch), u3 = _mm_loadu_ps(upper + 3 * pitch);
+				__m128 l0 = _mm_loadu_ps(lower), l1 = _mm_loadu_ps(lower + pitch), l2 = _mm_loadu_ps(lower + 2 * pitch), l3 = _mm_loadu_ps(lower + 3 * pitch);
+
+				_MM_TRANSPOSE4_PS(u0, u1, u2, u3);
+				_MM_TRANSPOSE4_PS(l0, l1, l2, l3);
+
+				_mm_storeu_ps(upper, l0);
+				_mm_storeu_ps(upper + pitch, l1);
+				_mm_storeu_ps(upper + 2 * pitch, l2);
+				_mm_storeu_ps(upper + 3 * pitch, l3);
+
+				_mm_storeu_ps(lower, u0);
+				_mm_storeu_ps(lower + pitch, u1);
+				_mm_storeu_ps(lower + 2 * pitch, u2);
+				_mm_storeu_ps(lower + 3 * pitch, u3);
+			}
+		}
+	}
+}
+
+
+// Write map rows [4 * begin, 4 * end).  After the second column pass the work planes hold row x, column z so each 4x4 tile is transposed in registers on the way out, and transposed again to interleave the texels
+void CGDOcean::packRows(uint32_t begin, uint32_t end) {
+
+	const uint32_t pitch = workPitch;
+	const __m128 choppiness = _mm_set1_ps(desc.choppiness);
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 zero = _mm_setzero_ps();
+
+	for (uint32_t tile = begin; tile < end; tile++) {
+
+		uint32_t z0 = tile * 4;
+
+		for (uint32_t x0 = 0; x0 < size; x0 += 4) {
+
+			// Planes 0 - 4 are height, slope x, displacement x, displacement z and slope z
+			__m128 v[5][4];
+
+			for (uint32_t p = 0; p < 5; p++) {
+
+				const float *src = &work[p * workPlaneSize + x0 * pitch + z0];
+
+				v[p][0] = _mm_loadu_ps(src);
+				v[p][1] = _mm_loadu_ps(src + pitch);
+				v[p][2] = _mm_loadu_ps(src + 2 * pitch);
+				v[p][3] = _mm_loadu_ps(src + 3 * pitch);
+
+				_MM_TRANSPOSE4_PS(v[p][0], v[p][1], v[p][2], v[p][3]);
+			}
+
+			for (uint32_t j = 0; j < 4; j++) {
+
+				float *displacement = &displacementMap[((z0 + j) * size + x0) * 4];
+				float *normal = &normalMap[((z0 + j) * size + x0) * 4];
+
+				__m128 d0 = _mm_mul_ps(v[2][j], choppiness), d1 = v[0][j], d2 = _mm_mul_ps(v[3][j], choppiness), d3 = zero;
+
+				_MM_TRANSPOSE4_PS(d0, d1, d2, d3);
+
+				_mm_storeu_ps(displacement, d0);
+				_mm_storeu_ps(displacement + 4, d1);
+				_mm_storeu_ps(displacement + 8, d2);
+				_mm_storeu_ps(displacement + 12, d3);
+
+				// Normal (-slope x, 1, -slope z) normalised
+				__m128 sx = v[1][j], sz = v[4][j];
+				__m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, sx), _mm_mul_ps(sz, sz)), one));
+				__m128 inverse = _mm_div_ps(one, length);
+				__m128 n0 = _mm_sub_ps(zero, _mm_mul_ps(sx, inverse)), n1 = inverse, n2v = _mm_sub_ps(zero, _mm_mul_ps(sz, inverse)), n3 = zero;
+
+				_MM_TRANSPOSE4_PS(n0, n1, n2v, n3);
+
+				_mm_storeu_ps(normal, n0);
+				_mm_storeu_ps(normal + 4, n1);
+				_mm_storeu_ps(normal + 8, n2v);
+				_mm_storeu_ps(normal + 12, n3);
+			}
+		}
+	}
+}
+
+
+void CGDOcean::parallelFor(bool parallel, uint32_t count, uint32_t grainSize, const function<void(uint32_t begin, uint32_t end)>& body) {
+
+	if (parallel && jobSystem && jobSystem->workerCount() > 0)
+		jobSystem->parallelFor(0, count, grainSize, body);
+	else
+		body(0, count);
+}
+
+
+
+//
+// Public interface
+//
+
+// Factory method
+CGDOcean* CGDOcean::CreateOcean(const CGDOceanDesc& desc, CGDJobSystem *jobSystem) {
+
+	if (desc.resolution < 16 || desc.resolution > 512 || (desc.resolution & (desc.resolution - 1)) != 0 || desc.patchSize <= 0.0f || desc.repeatPeriod <= 0.0f)
+		return nullptr;
+
+	return new CGDOcean(desc, jobSystem);
+}
+
+
+// Destructor
+CGDOcean::~CGDOcean() {
+
+	if (jobSystem)
+		jobSystem->release();
+}
+
+
+void CGDOcean::update(double time, bool parallel) {
+
+	PROFILE_SCOPE("CGDOcean::update");
+
+	float fraction = (float)getPeriodFraction(time);
+	uint32_t blocks = size / columnBlock;
+
+	parallelFor(parallel, size, 0, [&](uint32_t begin, uint32_t end) { generateRows(begin, end, fraction); });
+	parallelFor(parallel, blocks, 1, [&](uint32_t begin, uint32_t end) { transformColumns(begin, end); });
+	parallelFor(parallel, size / 4, 4, [&](uint32_t begin, uint32_t end) { transposeRows(begin, end); });
+	parallelFor(parallel, blocks, 1, [&](uint32_t begin, uint32_t end) { transformColumns(begin, end); });
+	parallelFor(parallel, size / 4, 0, [&](uint32_t begin, uint32_t end) { packRows(begin, end); });
+
+	mapTime = time;
+}
+
+
+void CGDOcean::updateReference(double time) {
+
+	uint32_t n2 = size * size;
+	double fraction = getPeriodFraction(time);
+	float dk = (float)(2.0 * pi) / desc.patchSize; // as initialise so the frequencies match the fast path exactly
+	const complex<double> i1(0.0, 1.0);
+	vector<complex<double>> a(n2), b(n2), c(n2);
+
+	for (uint32_t i = 0; i < size; i++) {
+
+		for (uint32_t j = 0; j < size; j++) {
+
+			uint32_t e = i * size + j;
+			double kx = (double)((float)FrequencyIndex(j, size) * dk);
+			double kz = (double)((float)FrequencyIndex(i, size) * dk);
+			double k = sqrt(kx * kx + kz * kz);
+			double steps = FrequencySteps(k, desc.gravity, desc.repeatPeriod);
+			double phase = steps * fraction;
+			complex<double> w = polar(1.0, 2.0 * pi * (phase - floor(phase)));
+
+			complex<double> h0(initialSpectrum[e * 4], initialSpectrum[e * 4 + 1]);
+			complex<double> g(initialSpectrum[e * 4 + 2], initialSpectrum[e * 4 + 3]);
+			complex<double> h = h0 * w + g * conj(w);
+			double kxn = (k > 0.0) ? kx / k : 0.0, kzn = (k > 0.0) ? kz / k : 0.0;
+
+			a[e] = h + i1 * (i1 * kx * h);
+			b[e] = i1 * kxn * h + i1 * (i1 * kzn * h);
+			c[e] = i1 * kz * h;
+		}
+	}
+
+	complex<double> *transforms[numTransforms] = { a.data(), b.data(), c.data() };
+
+	for (uint32_t t = 0; t < numTransforms; t++) {
+
+		for (uint32_t i = 0; i < size; i++)
+			ReferenceInverseFFT(transforms[t] + i * size, size, log2Size, 1);
+
+		for (uint32_t j = 0; j < size; j++)
+			ReferenceInverseFFT(transforms[t] + j, size, log2Size, size);
+	}
+
+	for (uint32_t e = 0; e < n2; e++) {
+
+		double sx = a[e].imag(), sz = c[e].real();
+		double length = sqrt(sx * sx + sz * sz + 1.0);
+
+		displacementMap[e * 4] = (float)(b[e].real() * desc.choppiness);
+		displacementMap[e * 4 + 1] = (float)a[e].real();
+		displacementMap[e * 4 + 2] = (float)(b[e].imag() * desc.choppiness);
+		displacementMap[e * 4 + 3] = 0.0f;
+
+		normalMap[e * 4] = (float)(-sx / length);
+		normalMap[e * 4 + 1] = (float)(1.0 / length);
+		normalMap[e * 4 + 2] = (float)(-sz / length);
+		normalMap[e * 4 + 3] = 0.0f;
+	}
+
+	mapTime = time;
+}
+
+
+void CGDOcean::sample(float x, float z, float displacement[3], float normal[3]) const {
+
+	// Texel n is at n * patchSize / size
+	float u = x / desc.patchSize * (float)size;
+	float v = z / desc.patchSize * (float)size;
+	float fu = floorf(u), fv = floorf(v);
+	float wu = u - fu, wv = v - fv;
+	uint32_t x0 = (uint32_t)(int32_t)fu & (size - 1), z0 = (uint32_t)(int32_t)fv & (size - 1);
+	uint32_t x1 = (x0 + 1) & (size - 1), z1 = (z0 + 1) & (size - 1);
+	uint32_t texels[4] = { z0 * size + x0, z0 * size + x1, z1 * size + x0, z1 * size + x1 };
+	float weights[4] = { (1.0f - wu) * (1.0f - wv), wu * (1.0f - wv), (1.0f - wu) * wv, wu * wv };
+
+	for (int c = 0; c < 3; c++) {
+
+		displacement[c] = 0.0f;
+		normal[c] = 0.0f;
+
+		for (int i = 0; i < 4; i++) {
+
+			displacement[c] += displacementMap[texels[i] * 4 + c] * weights[i];
+			normal[c] += normalMap[texels[i] * 4 + c] * weights[i];
+		}
+	}
+
+	float length = sqrtf(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+
+	for (int c = 0; c < 3; c++)
+		normal[c] /= length;
+}
+
+
+const CGDOceanDesc& CGDOcean::getDesc() const {
+
+	return desc;
+}
+
+
+uint32_t CGDOcean::getResolution() const {
+
+	return size;
+}
+
+
+double CGDOcean::getTime() const {
+
+	return mapTime;
+}
+
+
+const float* CGDOcean::getDisplacementMap() const {
+
+	return displacementMap.data();
+}
+
+
+const float* CGDOcean::getNormalMap() const {
+
+	return normalMap.data();
+}
+
+
+const float* CGDOcean::getInitialSpectrum() const {
+
+	return initialSpectrum.data();
+}
+
+
+double CGDOcean::getPeriodFraction(double time) const {
+
+	double f = time / (double)desc.repeatPeriod;
+
+	return f - floor(f);
+}
+
+
+float CGDOcean::getFrequencyQuantum() const {
+
+	return (float)(2.0 * pi / (double)desc.repeatPeriod);
+}
+
+
+bool CGDOcean::benchmark(uint32_t frames) {
+
+	double frequency = (double)CGDClock::ActualTimeFrequency();
+	ostringstream report;
+
+	frames = max(frames, 1u);
+
+	report << fixed << setprecision(3);
+	report << "\nOcean FFT benchmark (" << size << " x " << size << ", " << desc.patchSize << " unit patch, " << ((jobSystem) ? jobSystem->workerCount() : 0) << " worker threads)...\n";
+
+	// Validate the fast path against the reference at a few times through the repeat period
+	float maxDisplacement = 0.0f, displacementError = 0.0f, normalError = 0.0f;
+	vector<float> fastDisplacement, fastNormal;
+
+	for (int i = 0; i < 4; i++) {
+
+		double time = (double)desc.repeatPeriod * (double)i * 0.37;
+
+		update(time);
+		fastDisplacement = displacementMap;
+		fastNormal = normalMap;
+		updateReference(time);
+
+		for (size_t j = 0; j < displacementMap.size(); j++) {
+
+			maxDisplacement = max(maxDisplacement, fabsf(displacementMap[j]));
+			displacementError = max(displacementError, fabsf(fastDisplacement[j] - displacementMap[j]));
+			normalError = max(normalError, fabsf(fastNormal[j] - normalMap[j]));
+		}
+	}
+
+	float relativeError = displacementError / max(maxDisplacement, 1.0e-6f);
+
+	// Update time per frame of each path at 60 frames per second
+	const char *names[3] = { "reference", "SSE", "SSE + jobs" };
+	double seconds[3];
+
+	for (int path = 0; path < 3; path++) {
+
+		gu_time_index start = CGDClock::ActualTime();
+
+		for (uint32_t i = 0; i < frames; i++) {
+
+			double time = (double)i / 60.0;
+
+			if (path == 0)
+				updateReference(time);
+			else
+				update(time, path == 2);
+		}
+
+		seconds[path] = (double)(CGDClock::ActualTime() - start) / frequency / (double)frames;
+	}
+
+	for (int path = 0; path < 3; path++) {
+
+		report << names[path] << ": " << seconds[path] * 1000.0 << " ms per frame";
+
+		if (path > 0)
+			report << " (" << setprecision(1) << seconds[0] / max(seconds[path], 1e-9) << "x)" << setprecision(3);
+
+		report << ((path < 2) ? ", " : "\n");
+	}
+
+	report << "Difference from the reference: displacement " << scientific << setprecision(2) << relativeError << " of the largest displacement (" << fixed << setprecision(3) << maxDisplacement << "), normal " << scientific << setprecision(2) << normalError << fixed << "\n";
+
+	cout << report.str();
+
+	return relativeError <= referenceTolerance && normalError <= referenceTolerance;
+}
@@ -0,0 +1,124 @@
+//
+// CGDOcean.h
+//
+
+// Statistical ocean surface (Tessendorf, "Simulating Ocean Water", 2001).  A random initial spectrum h0(k) is drawn from the Phillips spectrum for the wind at creation and each update evolves it to time t with the deep water dispersion relation and transforms it with an inverse FFT into three maps over a square patch - height, horizontal (choppy) displacement and the surface normal from the height slopes.  The patch is periodic so the maps tile seamlessly across a water grid of any size.  Frequencies are quantised to multiples of 2 pi / repeatPeriod so the surface loops with that period, which also keeps the phase accurate however large t grows.
+//
+// update is the fast path.  The spectrum is generated 4 elements at a time in SSE registers directly in bit-reversed order and the 2D FFT is done as SSE column transforms of 16 columns at a time (every lane shares the same twiddle factor so no shuffles are needed), an in-place transpose and a second column pass.  The phases - spectrum rows, column blocks, transpose and output rows - are split across the job system if one is given.  Because the maps are real only three complex transforms are needed - height + i slope x, displacement x + i displacement z and slope z.
+//
+// updateReference produces the same maps single-threaded in double precision with a textbook radix-2 FFT and is the reference the fast path (and the compute shader path of DXOceanSurface, which evaluates the same spectrum) is validated against.  Both paths give the same result on every machine and with any number of threads so they can be used for headless rendering.
+
+#pragma once
+
+#include <GUObject.h>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+class CGDJobSystem;
+
+
+struct CGDOceanDesc {
+
+	uint32_t				resolution = 256; // FFT size (power of 2, 16 - 512)
+	float					patchSize = 64.0f; // side of the square the maps cover
+	float					windSpeed = 6.0f;
+	float					windDirX = 0.8f; // wind direction (normalised on creation)
+	float					windDirZ = 0.6f;
+	float					amplitude = 2.0e-3f; // Phillips spectrum constant
+	float					choppiness = 1.0f; // horizontal displacement scale (0 = height only)
+	float					smallWaveLength = 0.1f; // waves much shorter than this are suppressed
+	float					oppositeWaveScale = 0.1f; // spectrum scale of waves travelling against the wind
+	float					repeatPeriod = 200.0f; // seconds before the surface repeats
+	float					gravity = 9.81f;
+	uint32_t				seed = 1;
+};
+
+
+class CGDOcean : public GUObject {
+
+	CGDOceanDesc					desc;
+	CGDJobSystem					*jobSystem = nullptr; // nullptr = update on the calling thread
+	uint32_t						size = 0; // desc.resolution
+	uint32_t						log2Size = 0;
+
+	// Initial spectrum in natural order - h0(k) and conj(h0(-k)) for each element (4 floats)
+	std::vector<float>				initialSpectrum;
+
+	// Fast path constants in bit-reversed order (see generateRows) - the initial spectrum planes, 1 / |k| and the quantised frequency of each element, kx of each column and kz of each row
+	std::vector<float>				h0Planes; // 4 planes of size * size
+	std::vector<float>				inverseK;
+	std::vector<float>				frequencySteps;
+	std::vector<float>				columnK;
+	std::vector<float>				rowK;
+	std::vector<float>				twiddles; // cos and sin of 2 pi j / size for j < size / 2 (2 planes)
+
+	// Fast path work planes - real and imaginary planes of the three transforms.  Rows and planes are padded so the power of 2 strides of the column transforms do not map to the same cache sets
+	std::vector<float>				work;
+	uint32_t						workPitch = 0; // floats between rows
+	uint32_t						workPlaneSize = 0; // floats between planes
+
+	// Output maps (size * size, 4 floats per texel, row z, column x)
+	std::vector<float>				displacementMap; // choppy x displacement, height, choppy z displacement, 0
+	std::vector<float>				normalMap; // unit normal, 0
+
+	double							mapTime = 0.0;
+
+
+	//
+	// Private interface
+	//
+
+	// Constructor - called internally by the CreateOcean factory method
+	CGDOcean(const CGDOceanDesc& desc, CGDJobSystem *jobSystem);
+
+	// Draw the initial spectrum and build the fast path constants
+	void initialise();
+
+	// Phillips spectrum at wave vector (kx, kz)
+	float phillips(float kx, float kz) const;
+
+	// Fast path phases over [begin, end) rows, column blocks or 4 row tiles
+	void generateRows(uint32_t begin, uint32_t end, float fraction);
+	void transformColumns(uint32_t begin, uint32_t end);
+	void transposeRows(uint32_t begin, uint32_t end);
+	void packRows(uint32_t begin, uint32_t end);
+
+	// Call body over [0, count) on the job system if parallel, otherwise on the calling thread
+	void parallelFor(bool parallel, uint32_t count, uint32_t grainSize, const std::function<void(uint32_t begin, uint32_t end)>& body);
+
+
+public:
+
+	//
+	// Public interface
+	//
+
+	// Factory method.  The job system (if given) is retained.  Return nullptr if the resolution is not a power of 2 from 16 to 512
+	static CGDOcean* CreateOcean(const CGDOceanDesc& desc, CGDJobSystem *jobSystem = nullptr);
+
+	// Destructor
+	~CGDOcean();
+
+	// Evaluate the maps at time (seconds).  parallel = false runs every phase on the calling thread
+	void update(double time, bool parallel = true);
+
+	// Evaluate the maps at time with the double precision reference implementation
+	void updateReference(double time);
+
+	// Displacement (x, y, z) and normal of the surface at (x, z) - bilinear, the maps wrap every patchSize
+	void sample(float x, float z, float displacement[3], float normal[3]) const;
+
+	// Query methods
+	const CGDOceanDesc& getDesc() const;
+	uint32_t getResolution() const;
+	double getTime() const; // time of the current maps
+	const float* getDisplacementMap() const;
+	const float* getNormalMap() const;
+	const float* getInitialSpectrum() const; // natural order, 4 floats per element - see the compute shader path of DXOceanSurface
+	double getPeriodFraction(double time) const; // phases are 2 pi frac(frequency steps * fraction)
+	float getFrequencyQuantum() const; // 2 pi / repeatPeriod
+
+	// Report the update time per frame of the reference, the fast path on the calling thread and the fast path on the job system over frames updates, and the largest difference between the fast path and reference maps.  Return false if the fast path does not match the reference
+	bool benchmark(uint32_t frames);
+};
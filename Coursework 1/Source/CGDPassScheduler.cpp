@@ -0,0 +1,309 @@
+
+//
+// CGDPassScheduler.cpp
+//
+
+#include <stdafx.h>
+#include <CGDPassScheduler.h>
+#include <CGDGPUProfiler.h>
+
+using namespace std;
+
+
+
+//
+// Private interface
+//
+
+// Constructor - called internally by the CreatePassScheduler factory method
+CGDPassScheduler::CGDPassScheduler(CGDCommandBackend *_backend, CGDJobSystem *_jobSystem) {
+
+	backend = _backend;
+	backend->retain();
+
+	jobSystem = _jobSystem;
+
+	if (jobSystem)
+		jobSystem->retain();
+}
+
+
+void CGDPassScheduler::sortPasses() {
+
+	// Kahn's algorithm.  The ready pass with the lowest index is always taken next so the order is stable
+	uint32_t n = (uint32_t)passes.size();
+
+	vector<uint32_t> inDegree(n, 0);
+	vector<vector<uint32_t> > dependents(n);
+
+	for (uint32_t i = 0; i < n; i++) {
+
+		for (size_t j = 0; j < passes[i].dependencies.size(); j++) {
+
+			dependents[passes[i].dependencies[j]].push_back(i);
+			inDegree[i]++;
+		}
+	}
+
+	vector<bool> ready(n, false);
+	uint32_t numReady = 0;
+
+	for (uint32_t i = 0; i < n; i++) {
+
+		if (inDegree[i] == 0) {
+
+			ready[i] = true;
+			numReady++;
+		}
+	}
+
+	executionOrder.clear();
+
+	while (numReady > 0) {
+
+		uint32_t next = 0;
+
+		while (!ready[next])
+			next++;
+
+		ready[next] = false;
+		numReady--;
+
+		executionOrder.push_back(next);
+
+		for (size_t j = 0; j < dependents[next].size(); j++) {
+
+			uint32_t d = dependents[next][j];
+
+			if (--inDegree[d] == 0) {
+
+				ready[d] = true;
+				numReady++;
+			}
+		}
+	}
+
+	// Passes on a dependency cycle are never ready - report the cycle and append them in index order so they still run
+	if (executionOrder.size() != n) {
+
+		cout << "CGDPassScheduler: pass dependencies contain a cycle" << endl;
+
+		for (uint32_t i = 0; i < n; i++) {
+
+			if (inDegree[i] > 0)
+				executionOrder.push_back(i);
+		}
+	}
+
+	orderValid = true;
+}
+
+
+void CGDPassScheduler::recordContext(uint32_t contextIndex) {
+
+	const vector<uint32_t>& contextPassList = contextPasses[contextIndex];
+	void *context = backend->recordingContext(contextIndex);
+
+	for (size_t i = 0; i < contextPassList.size(); i++) {
+
+		Pass& pass = passes[contextPassList[i]];
+
+		runPass(pass, context, contextIndex);
+
+		pass.commandList = backend->finishRecording(contextIndex);
+
+		passCounters[contextPassList[i]].complete();
+	}
+}
+
+
+void CGDPassScheduler::runPass(const Pass& pass, void *context, uint32_t contextIndex) {
+
+	PROFILE_SCOPE(pass.name);
+
+	pass.function(context, contextIndex);
+}
+
+
+
+//
+// Public interface
+//
+
+// Factory method
+CGDPassScheduler* CGDPassScheduler::CreatePassScheduler(CGDCommandBackend *backend, CGDJobSystem *jobSystem) {
+
+	if (!backend)
+		return nullptr;
+
+	return new CGDPassScheduler(backend, jobSystem);
+}
+
+
+// Destructor
+CGDPassScheduler::~CGDPassScheduler() {
+
+	if (gpuProfiler)
+		gpuProfiler->release();
+
+	if (jobSystem)
+		jobSystem->release();
+
+	backend->release();
+}
+
+
+uint32_t CGDPassScheduler::addPass(const char *name, const CGDPassFunction& function, bool deferred) {
+
+	Pass pass;
+
+	pass.name = name;
+	pass.function = function;
+	pass.deferred = deferred;
+	pass.commandList = nullptr;
+	pass.contextIndex = CGD_IMMEDIATE_CONTEXT;
+
+	passes.push_back(pass);
+	passCounters.emplace_back();
+
+	orderValid = false;
+
+	return (uint32_t)passes.size() - 1;
+}
+
+
+bool CGDPassScheduler::addDependency(uint32_t pass, uint32_t dependsOn) {
+
+	if (pass >= passes.size() || dependsOn >= passes.size() || pass == dependsOn)
+		return false;
+
+	passes[pass].dependencies.push_back(dependsOn);
+
+	orderValid = false;
+
+	return true;
+}
+
+
+void CGDPassScheduler::execute() {
+
+	PROFILE_SCOPE("CGDPassScheduler::execute");
+
+	if (!orderValid)
+		sortPasses();
+
+	void *immediateContext = backend->immediateContext();
+
+	// Serial fallback - run every pass on the immediate context in execution order
+	if (!isParallel()) {
+
+		for (size_t i = 0; i < executionOrder.size(); i++) {
+
+			const Pass& pass = passes[executionOrder[i]];
+			CGDGPUZone gpuZone(gpuProfiler, pass.name);
+
+			runPass(pass, immediateContext, CGD_IMMEDIATE_CONTEXT);
+		}
+
+		return;
+	}
+
+	// Distribute deferred passes over the recording contexts
+	uint32_t numContexts = backend->recordingContextCount();
+	uint32_t numDeferred = 0;
+
+	contextPasses.resize(numContexts);
+
+	for (uint32_t c = 0; c < numContexts; c++)
+		contextPasses[c].clear();
+
+	for (size_t i = 0; i < executionOrder.size(); i++) {
+
+		Pass& pass = passes[executionOrder[i]];
+
+		pass.commandList = nullptr;
+
+		if (pass.deferred) {
+
+			pass.contextIndex = numDeferred++ % numContexts;
+			contextPasses[pass.contextIndex].push_back(executionOrder[i]);
+
+			passCounters[executionOrder[i]].add();
+		}
+	}
+
+	// Record.  Each context is recorded by a single job so the commands of a context are never recorded on two threads at once
+	CGDJobCounter recordCounter;
+
+	for (uint32_t c = 0; c < numContexts; c++) {
+
+		if (!contextPasses[c].empty())
+			jobSystem->run([this, c]() { recordContext(c); }, &recordCounter);
+	}
+
+	// Execute in order as each pass's command list becomes available.  The main thread records queued contexts itself while it waits
+	for (size_t i = 0; i < executionOrder.size(); i++) {
+
+		uint32_t p = executionOrder[i];
+		Pass& pass = passes[p];
+		CGDGPUZone gpuZone(gpuProfiler, pass.name);
+
+		if (pass.deferred) {
+
+			jobSystem->wait(&passCounters[p]);
+
+			if (pass.commandList) {
+
+				backend->executeCommandList(pass.commandList);
+				backend->releaseCommandList(pass.commandList);
+				pass.commandList = nullptr;
+			}
+		}
+		else {
+
+			runPass(pass, immediateContext, CGD_IMMEDIATE_CONTEXT);
+		}
+	}
+
+	// Recording jobs may still be returning after signalling their last pass
+	jobSystem->wait(&recordCounter);
+}
+
+
+void CGDPassScheduler::setParallel(bool enable) {
+
+	parallel = enable;
+}
+
+
+void CGDPassScheduler::setGPUProfiler(CGDGPUProfiler *profiler) {
+
+	if (profiler)
+		profiler->retain();
+
+	if (gpuProfiler)
+		gpuProfiler->release();
+
+	gpuProfiler = profiler;
+}
+
+
+bool CGDPassScheduler::isParallel() const {
+
+	return parallel && jobSystem && backend->recordingContextCount() > 0;
+}
+
+
+uint32_t CGDPassScheduler::passCount() const {
+
+	return (uint32_t)passes.size();
+}
+
+
+const vector<uint32_t>& CGDPassScheduler::getExecutionOrder() {
+
+	if (!orderValid)
+		sortPasses();
+
+	return executionOrder;
+}
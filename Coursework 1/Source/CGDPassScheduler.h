@@ -0,0 +1,126 @@
+//
+// CGDPassScheduler.h
+//
+
+// Multithreaded pass submission.  A frame is described as a set of named passes, each a function that records rendering commands into the context it is given, with explicit dependencies between passes.  Deferred passes are recorded concurrently on CGDJobSystem workers, each into its own command list.  The main thread then executes the command lists in dependency order - a stable topological sort of the passes (ties broken by the order passes were added) so the submission order, and therefore the rendered result, does not depend on which worker finished first.  Immediate passes (eg. GenerateMips, which is not a recorded command) run on the main thread at their position in the order.
+//
+// Passes are distributed over the backend's recording contexts round-robin in execution order and each context records its passes in that order, so the main thread can start executing the first lists while later ones are still being recorded.  Dependencies only constrain execution order - recording never waits on another pass, so passes must not read CPU state written by other passes during recording.
+//
+// The command list API is abstracted by CGDCommandBackend so the scheduling, ordering and fallback logic does not depend on D3D11 (see DXCommandBackend for the deferred context implementation).  If the backend has no recording contexts, no job system is given or parallel recording is disabled, every pass runs on the immediate context on the calling thread in the same order.
+
+#pragma once
+
+#include <GUObject.h>
+#include <CGDJobSystem.h>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <vector>
+
+class CGDGPUProfiler;
+
+
+// Context index passed to passes run on the immediate context
+#define CGD_IMMEDIATE_CONTEXT			0xFFFFFFFF
+
+
+// Abstract command list recording backend.  Contexts and command lists are opaque handles
+class CGDCommandBackend : public GUObject {
+
+public:
+
+	// Number of contexts that can record concurrently (0 = command lists are not supported)
+	virtual uint32_t recordingContextCount() const = 0;
+
+	virtual void* recordingContext(uint32_t index) = 0;
+	virtual void* immediateContext() = 0;
+
+	// Close the commands recorded on the given context into a command list and reset the context for the next pass.  Called on the recording thread.  Return nullptr on failure (the pass is skipped)
+	virtual void* finishRecording(uint32_t index) = 0;
+
+	// Execute command list on the immediate context.  Called on the main thread
+	virtual void executeCommandList(void *commandList) = 0;
+
+	virtual void releaseCommandList(void *commandList) = 0;
+};
+
+
+// Pass function.  context is the context to record into and contextIndex identifies it (0 .. recordingContextCount()-1 or CGD_IMMEDIATE_CONTEXT) so passes can use per-context state
+typedef std::function<void(void *context, uint32_t contextIndex)>		CGDPassFunction;
+
+
+class CGDPassScheduler : public GUObject {
+
+	struct Pass {
+
+		const char						*name;
+		CGDPassFunction					function;
+		bool							deferred;
+		std::vector<uint32_t>			dependencies;
+
+		// Per-frame recording state
+		void							*commandList;
+		uint32_t						contextIndex;
+	};
+
+	CGDCommandBackend					*backend = nullptr;
+	CGDJobSystem						*jobSystem = nullptr;
+	CGDGPUProfiler						*gpuProfiler = nullptr;
+	bool								parallel = true;
+
+	std::vector<Pass>					passes;
+	std::deque<CGDJobCounter>			passCounters; // one per pass, signalled when the pass has been recorded
+
+	std::vector<uint32_t>				executionOrder;
+	std::vector<std::vector<uint32_t> >	contextPasses; // passes recorded by each context in execution order
+	bool								orderValid = false;
+
+
+	//
+	// Private interface
+	//
+
+	// Constructor - called internally by the CreatePassScheduler factory method
+	CGDPassScheduler(CGDCommandBackend *backend, CGDJobSystem *jobSystem);
+
+	// Rebuild executionOrder
+	void sortPasses();
+
+	// Record (on the calling thread) the passes assigned to the given context
+	void recordContext(uint32_t contextIndex);
+
+	void runPass(const Pass& pass, void *context, uint32_t contextIndex);
+
+
+public:
+
+	//
+	// Public interface
+	//
+
+	// Factory method.  The scheduler retains backend and jobSystem.  jobSystem may be nullptr (passes are run serially).  Return nullptr if backend is nullptr
+	static CGDPassScheduler* CreatePassScheduler(CGDCommandBackend *backend, CGDJobSystem *jobSystem);
+
+	// Destructor
+	~CGDPassScheduler();
+
+	// Add pass and return its index.  Deferred passes are recorded into a command list on a worker, immediate passes run on the main thread.  name must outlive the scheduler
+	uint32_t addPass(const char *name, const CGDPassFunction& function, bool deferred = true);
+
+	// pass is executed after dependsOn.  Return false if either index is invalid.  If the dependencies form a cycle it is reported when the passes are next sorted and the passes on the cycle run last in the order they were added
+	bool addDependency(uint32_t pass, uint32_t dependsOn);
+
+	// Record and execute all passes.  Must be called on the thread that owns the immediate context.  If a GPU profiler is set each pass is timed as a GPU pass of the same name
+	void execute();
+
+	// Enable / disable parallel recording (if disabled all passes run serially on the immediate context)
+	void setParallel(bool enable);
+
+	// The scheduler retains the profiler.  nullptr disables GPU pass timing
+	void setGPUProfiler(CGDGPUProfiler *profiler);
+
+	// Query methods
+	bool isParallel() const; // true if passes will be recorded in parallel
+	uint32_t passCount() const;
+	const std::vector<uint32_t>& getExecutionOrder();
+};
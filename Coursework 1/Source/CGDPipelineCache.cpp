@@ -0,0 +1,295 @@
+
+//
+// CGDPipelineCache.cpp
+//
+
+#include <stdafx.h>
+#include <CGDPipelineCache.h>
+#include <GUMappedFile.h>
+#include <cstring>
+#include <cctype>
+
+using namespace std;
+
+
+static const char *objectTypeNames[(int)CGDPipelineObjectType::NUM_TYPES] = {
+
+	"rasterizer state",
+	"depth-stencil state",
+	"blend state",
+	"sampler state",
+	"input layout",
+	"vertex shader",
+	"pixel shader",
+	"geometry shader",
+	"compute shader"
+};
+
+
+// Normalise path so equivalent Windows paths map to the same cache entry
+static string normalisePath(const char *path) {
+
+	string s(path);
+
+	for (size_t i = 0; i < s.size(); i++)
+		s[i] = (s[i] == '/') ? '\\' : (char)tolower((unsigned char)s[i]);
+
+	return s;
+}
+
+
+static uint32_t readUInt32(const uint8_t *p) {
+
+	uint32_t v;
+
+	memcpy(&v, p, sizeof(uint32_t));
+
+	return v;
+}
+
+
+
+//
+// Protected interface
+//
+
+// Constructor - called internally by the CreatePipelineCache factory method
+CGDPipelineCache::CGDPipelineCache(CGDPipelineDevice *_device) {
+
+	device = _device;
+	device->retain();
+}
+
+
+
+//
+// Public interface
+//
+
+// Factory method
+CGDPipelineCache* CGDPipelineCache::CreatePipelineCache(CGDPipelineDevice *device) {
+
+	if (!device)
+		return nullptr;
+
+	return new CGDPipelineCache(device);
+}
+
+
+// Destructor
+CGDPipelineCache::~CGDPipelineCache() {
+
+	purgeObjects();
+
+	for (size_t i = 0; i < bytecodeEntries.size(); i++) {
+
+		bytecodeEntries[i]->file->release();
+		delete bytecodeEntries[i];
+	}
+
+	device->release();
+}
+
+
+const CGDShaderBytecode* CGDPipelineCache::loadBytecode(const char *path) {
+
+	if (!path)
+		return nullptr;
+
+	string key = normalisePath(path);
+	unordered_map<string, BytecodeEntry*>::iterator p = bytecodePaths.find(key);
+
+	if (p != bytecodePaths.end()) {
+
+		pathStats.hits++;
+		return &p->second->bytecode;
+	}
+
+	pathStats.misses++;
+
+	GUMappedFile *file = GUMappedFile::CreateMappedFile(path);
+
+	if (!file) {
+
+		pathStats.failures++;
+		cout << "CGDPipelineCache: cannot load shader bytecode " << path << endl;
+		return nullptr;
+	}
+
+	uint64_t hash = Hash(file->getData(), file->getSize());
+
+	// Share the bytecode of a different path if the contents are identical
+	pair<unordered_multimap<uint64_t, BytecodeEntry*>::iterator, unordered_multimap<uint64_t, BytecodeEntry*>::iterator> range = bytecodeContent.equal_range(hash);
+
+	for (unordered_multimap<uint64_t, BytecodeEntry*>::iterator i = range.first; i != range.second; ++i) {
+
+		BytecodeEntry *entry = i->second;
+
+		if (entry->bytecode.size == file->getSize() && memcmp(entry->bytecode.data, file->getData(), file->getSize()) == 0) {
+
+			file->release();
+
+			contentHits++;
+			bytecodePaths[key] = entry;
+
+			return &entry->bytecode;
+		}
+	}
+
+	BytecodeEntry *entry = new BytecodeEntry();
+
+	entry->file = file;
+	entry->bytecode.data = file->getData();
+	entry->bytecode.size = file->getSize();
+	entry->bytecode.hash = hash;
+	entry->bytecode.inputSignatureHash = InputSignatureHash(file->getData(), file->getSize());
+
+	if (entry->bytecode.inputSignatureHash == 0)
+		entry->bytecode.inputSignatureHash = hash;
+
+	bytecodeEntries.push_back(entry);
+	bytecodePaths[key] = entry;
+	bytecodeContent.insert(make_pair(hash, entry));
+
+	bytesMapped += entry->bytecode.size;
+	pathStats.objects = (uint32_t)bytecodeEntries.size();
+
+	return &entry->bytecode;
+}
+
+
+void* CGDPipelineCache::acquireObject(CGDPipelineObjectType type, const void *key, size_t keySize, const void *desc, const CGDShaderBytecode *bytecode) {
+
+	if (type >= CGDPipelineObjectType::NUM_TYPES || !key)
+		return nullptr;
+
+	unordered_map<string, void*>& table = objects[(int)type];
+	CGDPipelineCacheStats& stats = objectStats[(int)type];
+
+	string k((const char*)key, keySize);
+	unordered_map<string, void*>::iterator p = table.find(k);
+
+	if (p != table.end()) {
+
+		stats.hits++;
+		device->retainObject(p->second);
+
+		return p->second;
+	}
+
+	stats.misses++;
+
+	void *object = device->createObject(type, desc, bytecode);
+
+	if (!object) {
+
+		stats.failures++;
+		return nullptr;
+	}
+
+	// The cache keeps the creation reference and the caller receives a new one
+	table[k] = object;
+	stats.objects = (uint32_t)table.size();
+
+	device->retainObject(object);
+
+	return object;
+}
+
+
+void CGDPipelineCache::purgeObjects() {
+
+	for (int t = 0; t < (int)CGDPipelineObjectType::NUM_TYPES; t++) {
+
+		for (unordered_map<string, void*>::iterator i = objects[t].begin(); i != objects[t].end(); ++i)
+			device->releaseObject(i->second);
+
+		objects[t].clear();
+		objectStats[t].objects = 0;
+	}
+}
+
+
+CGDPipelineCacheStats CGDPipelineCache::getObjectStats(CGDPipelineObjectType type) const {
+
+	return (type < CGDPipelineObjectType::NUM_TYPES) ? objectStats[(int)type] : CGDPipelineCacheStats();
+}
+
+
+CGDPipelineCacheStats CGDPipelineCache::getBytecodeStats() const {
+
+	return pathStats;
+}
+
+
+uint64_t CGDPipelineCache::getBytecodeContentHits() const {
+
+	return contentHits;
+}
+
+
+uint64_t CGDPipelineCache::getBytesMapped() const {
+
+	return bytesMapped;
+}
+
+
+void CGDPipelineCache::reportStats() const {
+
+	cout << "Shader bytecode: files = " << pathStats.objects << " (" << bytesMapped << " bytes mapped), path hits = " << pathStats.hits << ", path misses = " << pathStats.misses << ", shared by content = " << contentHits << ", failures = " << pathStats.failures << endl;
+
+	for (int t = 0; t < (int)CGDPipelineObjectType::NUM_TYPES; t++) {
+
+		const CGDPipelineCacheStats& stats = objectStats[t];
+
+		if (stats.hits + stats.misses == 0)
+			continue;
+
+		cout << objectTypeNames[t] << ": objects = " << stats.objects << ", hits = " << stats.hits << ", misses = " << stats.misses << ", failures = " << stats.failures << endl;
+	}
+}
+
+
+uint64_t CGDPipelineCache::Hash(const void *data, size_t size) {
+
+	const uint8_t *p = (const uint8_t*)data;
+	uint64_t hash = 14695981039346656037ull;
+
+	for (size_t i = 0; i < size; i++) {
+
+		hash ^= p[i];
+		hash *= 1099511628211ull;
+	}
+
+	return hash;
+}
+
+
+uint64_t CGDPipelineCache::InputSignatureHash(const void *data, size_t size) {
+
+	// DXBC container - "DXBC", 16 byte checksum, version, total size, chunk count, chunk offsets.  Each chunk is a FourCC and a size followed by the chunk data
+	const uint8_t *p = (const uint8_t*)data;
+
+	if (!p || size < 32 || memcmp(p, "DXBC", 4) != 0)
+		return 0;
+
+	uint32_t numChunks = readUInt32(p + 28);
+
+	if (numChunks > (size - 32) / 4)
+		return 0;
+
+	for (uint32_t i = 0; i < numChunks; i++) {
+
+		uint32_t offset = readUInt32(p + 32 + i * 4);
+
+		if (offset > size - 8)
+			continue;
+
+		uint32_t chunkSize = readUInt32(p + offset + 4);
+
+		if ((memcmp(p + offset, "ISGN", 4) == 0 || memcmp(p + offset, "ISG1", 4) == 0) && chunkSize <= size - offset - 8)
+			return Hash(p + offset, 8 + (size_t)chunkSize);
+	}
+
+	return 0;
+}
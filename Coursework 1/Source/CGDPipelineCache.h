@@ -0,0 +1,130 @@
+//
+// CGDPipelineCache.h
+//
+
+// Shader bytecode and pipeline object registry.  Effects tend to be built from the same small set of shader files and fixed-function state descriptors, so rather than each effect loading its own copy of the bytecode and creating its own state objects, CGDPipelineCache creates each distinct object once and hands out references to the shared instance.
+//
+// (i) Shader bytecode is memory mapped (see GUMappedFile) and cached by path.  A content hash is also kept so two paths with identical bytecode share a single mapping.  Bytecode remains valid for the lifetime of the cache.
+//
+// (ii) Pipeline objects (states, shaders and input layouts) are cached by a key made of the bytes that determine the object - a canonical copy of the creation descriptor for states, the bytecode for shaders and the vertex elements plus the vertex shader input signature for input layouts.  Keys are compared in full so hash collisions cannot alias two different objects.
+//
+// Object creation is abstracted by CGDPipelineDevice so the registry does not depend on D3D11 (see DXPipelineCache for the D3D11 device and typed front end).  CGDPipelineCache is not thread-safe.
+
+#pragma once
+
+#include <GUObject.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+class GUMappedFile;
+
+
+// Shader bytecode.  data references memory owned by the cache
+struct CGDShaderBytecode {
+
+	const void				*data;
+	size_t					size;
+	uint64_t				hash; // content hash
+	uint64_t				inputSignatureHash; // hash of the DXBC input signature chunk (the content hash if the bytecode has no input signature)
+};
+
+
+// Pipeline object types
+enum class CGDPipelineObjectType : uint8_t { RASTERIZER_STATE = 0, DEPTH_STENCIL_STATE, BLEND_STATE, SAMPLER_STATE, INPUT_LAYOUT, VERTEX_SHADER, PIXEL_SHADER, GEOMETRY_SHADER, COMPUTE_SHADER, NUM_TYPES };
+
+
+// Abstract pipeline object source
+class CGDPipelineDevice : public GUObject {
+
+public:
+
+	// Create an object of the given type.  desc is the type-specific creation descriptor (nullptr for shaders) and bytecode the associated shader bytecode (shaders and input layouts only).  Return nullptr if the object cannot be created
+	virtual void* createObject(CGDPipelineObjectType type, const void *desc, const CGDShaderBytecode *bytecode) = 0;
+
+	// Add / remove a reference to an object returned by createObject
+	virtual void retainObject(void *object) = 0;
+	virtual void releaseObject(void *object) = 0;
+};
+
+
+// Cache statistics
+struct CGDPipelineCacheStats {
+
+	uint64_t				hits = 0;
+	uint64_t				misses = 0;
+	uint64_t				failures = 0; // misses where the object could not be created
+	uint32_t				objects = 0; // objects currently cached
+};
+
+
+class CGDPipelineCache : public GUObject {
+
+	struct BytecodeEntry {
+
+		GUMappedFile		*file;
+		CGDShaderBytecode	bytecode;
+	};
+
+	CGDPipelineDevice											*device = nullptr;
+
+	// Bytecode indexed by normalised path and by content hash.  Entries are owned by bytecodeEntries
+	std::vector<BytecodeEntry*>									bytecodeEntries;
+	std::unordered_map<std::string, BytecodeEntry*>				bytecodePaths;
+	std::unordered_multimap<uint64_t, BytecodeEntry*>			bytecodeContent;
+
+	// Cached objects for each object type indexed by key
+	std::unordered_map<std::string, void*>						objects[(int)CGDPipelineObjectType::NUM_TYPES];
+	CGDPipelineCacheStats										objectStats[(int)CGDPipelineObjectType::NUM_TYPES];
+
+	CGDPipelineCacheStats										pathStats; // bytecode lookups by path
+	uint64_t													contentHits = 0; // path misses that matched existing bytecode
+	uint64_t													bytesMapped = 0;
+
+
+protected:
+
+	//
+	// Protected interface
+	//
+
+	// Constructor - called internally by the CreatePipelineCache factory method (and sub-class factory methods)
+	CGDPipelineCache(CGDPipelineDevice *device);
+
+
+public:
+
+	//
+	// Public interface
+	//
+
+	// Factory method.  Return nullptr if device is nullptr
+	static CGDPipelineCache* CreatePipelineCache(CGDPipelineDevice *device);
+
+	// Destructor.  Releases the cache's reference on each cached object and unmaps all bytecode
+	~CGDPipelineCache();
+
+	// Return the bytecode of the shader file at path, mapping the file on first use.  Return nullptr if the file cannot be loaded
+	const CGDShaderBytecode* loadBytecode(const char *path);
+
+	// Return the object of the given type identified by key, creating it from desc / bytecode if it is not cached.  A reference is added for the caller which must be released (D3D11 - the caller calls Release).  Return nullptr if the object cannot be created
+	void* acquireObject(CGDPipelineObjectType type, const void *key, size_t keySize, const void *desc, const CGDShaderBytecode *bytecode);
+
+	// Release the cache's reference on all cached objects.  Objects still referenced elsewhere remain valid.  Bytecode is not released
+	void purgeObjects();
+
+	// Query methods
+	CGDPipelineCacheStats getObjectStats(CGDPipelineObjectType type) const;
+	CGDPipelineCacheStats getBytecodeStats() const;
+	uint64_t getBytecodeContentHits() const;
+	uint64_t getBytesMapped() const;
+
+	void reportStats() const;
+
+	// FNV-1a hash of size bytes
+	static uint64_t Hash(const void *data, size_t size);
+
+	// Return the hash of the input signature chunk (ISGN / ISG1) of the DXBC container data.  Return 0 if data is not a DXBC container or has no input signature
+	static uint64_t InputSignatureHash(const void *data, size_t size);
+};
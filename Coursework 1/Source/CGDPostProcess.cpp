@@ -0,0 +1,930 @@
+
+//
+// CGDPostProcess.cpp
+//
+
+#include <stdafx.h>
+#include <CGDPostProcess.h>
+#include <CGDJobSystem.h>
+#include <CGDClock.h>
+#include <GUImageDecoder.h>
+#include <GUPNGWriter.h>
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <emmintrin.h>
+
+using namespace std;
+
+
+static const float			referenceTolerance = 1.0e-4f; // largest fast path difference from the reference accepted by benchmark
+static const int			goldenTolerance = 2; // largest difference (8 bit levels) from a golden image accepted by benchmark
+static const uint32_t		rowGrain = 8; // rows per job
+
+
+// Linear depth of a post-projection depth value (D3D perspective projection)
+static inline float LinearDepth(float z, float nearPlane, float farPlane) {
+
+	return nearPlane * farPlane / (farPlane - z * (farPlane - nearPlane));
+}
+
+
+// Circle of confusion in [0, 1] - 0 in focus, 1 fully blurred
+static inline float CircleOfConfusion(float z, const CGDPostProcessDesc& desc) {
+
+	if (desc.focusDistance <= 0.0f)
+		return 0.0f;
+
+	float d = fabsf(LinearDepth(z, desc.nearPlane, desc.farPlane) - desc.focusDistance) / max(desc.focusRange, 1.0e-6f);
+
+	return min(d, 1.0f);
+}
+
+
+// Texel coordinate in a source of srcSize texels sampled at the centre of texel i of a target of dstSize texels.  i0, i1 are the clamped texels either side and the return value the weight of i1
+static inline float SampleCoordinate(uint32_t i, uint32_t dstSize, uint32_t srcSize, uint32_t& i0, uint32_t& i1) {
+
+	float s = ((float)i + 0.5f) * (float)srcSize / (float)dstSize - 0.5f;
+	float f = floorf(s);
+	int32_t t = (int32_t)f;
+
+	i0 = (uint32_t)min(max(t, 0), (int32_t)srcSize - 1);
+	i1 = (uint32_t)min(max(t + 1, 0), (int32_t)srcSize - 1);
+
+	return s - f;
+}
+
+
+// Clamped bilinear sample lookup for every texel of a target row or column
+struct SampleTable {
+
+	vector<uint32_t>		i0;
+	vector<uint32_t>		i1;
+	vector<float>			f;
+
+	void build(uint32_t dstSize, uint32_t srcSize) {
+
+		i0.resize(dstSize);
+		i1.resize(dstSize);
+		f.resize(dstSize);
+
+		for (uint32_t i = 0; i < dstSize; i++)
+			f[i] = SampleCoordinate(i, dstSize, srcSize, i0[i], i1[i]);
+	}
+};
+
+
+// Bilinear sample of 4 texels
+static inline __m128 Bilinear4(const float *row0, const float *row1, uint32_t x0, uint32_t x1, __m128 fx, __m128 fy) {
+
+	__m128 a = _mm_loadu_ps(row0 + x0 * 4);
+	__m128 b = _mm_loadu_ps(row0 + x1 * 4);
+	__m128 c = _mm_loadu_ps(row1 + x0 * 4);
+	__m128 d = _mm_loadu_ps(row1 + x1 * 4);
+
+	__m128 top = _mm_add_ps(a, _mm_mul_ps(fx, _mm_sub_ps(b, a)));
+	__m128 bottom = _mm_add_ps(c, _mm_mul_ps(fx, _mm_sub_ps(d, c)));
+
+	return _mm_add_ps(top, _mm_mul_ps(fy, _mm_sub_ps(bottom, top)));
+}
+
+
+
+//
+// Reference implementation - scalar, discrete kernels
+//
+
+static void ReferenceSample(const CGDPostImage& image, uint32_t x, uint32_t y, uint32_t dstWidth, uint32_t dstHeight, float colour[4]) {
+
+	uint32_t x0, x1, y0, y1;
+	float fx = SampleCoordinate(x, dstWidth, image.width, x0, x1);
+	float fy = SampleCoordinate(y, dstHeight, image.height, y0, y1);
+
+	for (int c = 0; c < 4; c++) {
+
+		float a = image.texels[(y0 * image.width + x0) * 4 + c];
+		float b = image.texels[(y0 * image.width + x1) * 4 + c];
+		float d = image.texels[(y1 * image.width + x0) * 4 + c];
+		float e = image.texels[(y1 * image.width + x1) * 4 + c];
+
+		float top = a + fx * (b - a);
+		float bottom = d + fx * (e - d);
+
+		colour[c] = top + fy * (bottom - top);
+	}
+}
+
+
+static void ReferenceResample(const CGDPostImage& src, CGDPostImage& dst, bool add) {
+
+	for (uint32_t y = 0; y < dst.height; y++) {
+
+		for (uint32_t x = 0; x < dst.width; x++) {
+
+			float colour[4];
+			float *d = &dst.texels[(y * dst.width + x) * 4];
+
+			ReferenceSample(src, x, y, dst.width, dst.height, colour);
+
+			for (int c = 0; c < 4; c++)
+				d[c] = (add) ? d[c] + colour[c] : colour[c];
+		}
+	}
+}
+
+
+static void ReferenceBrightPass(const CGDPostImage& src, CGDPostImage& dst, float threshold) {
+
+	for (size_t i = 0; i < src.texels.size(); i += 4) {
+
+		const float *s = &src.texels[i];
+		float brightness = max(s[0], max(s[1], s[2]));
+		float scale = max(brightness - threshold, 0.0f) / max(brightness, 1.0e-4f);
+
+		for (int c = 0; c < 4; c++)
+			dst.texels[i + c] = s[c] * scale;
+	}
+}
+
+
+// Horizontal pass src -> scratch, vertical pass scratch -> dst with the discrete weights
+static void ReferenceBlur(const CGDPostImage& src, CGDPostImage& scratch, CGDPostImage& dst, const vector<float>& weights) {
+
+	int32_t radius = (int32_t)weights.size() - 1;
+	int32_t w = (int32_t)src.width;
+	int32_t h = (int32_t)src.height;
+
+	for (int32_t y = 0; y < h; y++) {
+
+		for (int32_t x = 0; x < w; x++) {
+
+			float sum[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+
+			for (int32_t k = -radius; k <= radius; k++) {
+
+				int32_t sx = min(max(x + k, 0), w - 1);
+
+				for (int c = 0; c < 4; c++)
+					sum[c] += weights[abs(k)] * src.texels[(y * w + sx) * 4 + c];
+			}
+
+			for (int c = 0; c < 4; c++)
+				scratch.texels[(y * w + x) * 4 + c] = sum[c];
+		}
+	}
+
+	for (int32_t y = 0; y < h; y++) {
+
+		for (int32_t x = 0; x < w; x++) {
+
+			float sum[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+
+			for (int32_t k = -radius; k <= radius; k++) {
+
+				int32_t sy = min(max(y + k, 0), h - 1);
+
+				for (int c = 0; c < 4; c++)
+					sum[c] += weights[abs(k)] * scratch.texels[(sy * w + x) * 4 + c];
+			}
+
+			for (int c = 0; c < 4; c++)
+				dst.texels[(y * w + x) * 4 + c] = sum[c];
+		}
+	}
+}
+
+
+static void ReferenceComposite(const CGDPostImage& scene, const float *depth, uint32_t depthStride, const CGDPostImage *dof, const CGDPostImage *bloom, const CGDPostProcessDesc& desc, CGDPostImage& output) {
+
+	for (uint32_t y = 0; y < scene.height; y++) {
+
+		for (uint32_t x = 0; x < scene.width; x++) {
+
+			const float *s = &scene.texels[(y * scene.width + x) * 4];
+			float *o = &output.texels[(y * scene.width + x) * 4];
+			float blurred[4], glow[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+			float coc = 0.0f;
+
+			if (dof) {
+
+				coc = CircleOfConfusion(depth[y * depthStride + x], desc);
+				ReferenceSample(*dof, x, y, scene.width, scene.height, blurred);
+			}
+
+			if (bloom)
+				ReferenceSample(*bloom, x, y, scene.width, scene.height, glow);
+
+			for (int c = 0; c < 3; c++)
+				o[c] = s[c] + ((dof) ? (blurred[c] - s[c]) * coc : 0.0f) + glow[c] * desc.bloomIntensity;
+
+			o[3] = 1.0f;
+		}
+	}
+}
+
+
+
+//
+// Kernels and images
+//
+
+const char* CGDPostPassName(CGDPostPass pass) {
+
+	static const char *names[] = { "downsample", "depth of field blur", "bright pass", "bloom downsample", "bloom blur", "bloom upsample", "composite" };
+
+	return (pass < CGDPostPass::COUNT) ? names[(int)pass] : "unknown";
+}
+
+
+void CGDGaussianWeights(float sigma, uint32_t radius, vector<float>& weights) {
+
+	weights.assign(radius + 1, 0.0f);
+
+	if (sigma <= 0.0f) {
+
+		weights[0] = 1.0f;
+		return;
+	}
+
+	uint32_t kernelRadius = min(radius, (uint32_t)ceilf(3.0f * sigma));
+	vector<double> g(kernelRadius + 1);
+	double sum = 0.0;
+
+	for (uint32_t i = 0; i <= kernelRadius; i++) {
+
+		g[i] = exp(-(double)(i * i) / (2.0 * (double)sigma * (double)sigma));
+		sum += (i == 0) ? g[i] : 2.0 * g[i];
+	}
+
+	for (uint32_t i = 0; i <= kernelRadius; i++)
+		weights[i] = (float)(g[i] / sum);
+}
+
+
+CGDBlurKernel CGDCreateBlurKernel(float sigma) {
+
+	CGDBlurKernel kernel = {};
+
+	kernel.sigma = max(sigma, 0.0f);
+	kernel.radius = (sigma > 0.0f) ? min((uint32_t)ceilf(3.0f * sigma), 2u * (CGD_MAX_BLUR_TAPS - 1)) : 0;
+
+	vector<float> g;
+
+	CGDGaussianWeights(sigma, kernel.radius, g);
+
+	kernel.offsets[0] = 0.0f;
+	kernel.weights[0] = g[0];
+	kernel.numTaps = 1;
+
+	// Texels 2i - 1 and 2i share tap i, placed so the bilinear sample between them weights them w1 : w2
+	for (uint32_t i = 1; i <= kernel.radius; i += 2) {
+
+		float w1 = g[i];
+		float w2 = (i + 1 <= kernel.radius) ? g[i + 1] : 0.0f;
+		float w = w1 + w2;
+
+		kernel.offsets[kernel.numTaps] = (w > 0.0f) ? ((float)i * w1 + (float)(i + 1) * w2) / w : (float)i;
+		kernel.weights[kernel.numTaps] = w;
+		kernel.numTaps++;
+	}
+
+	return kernel;
+}
+
+
+void CGDPostImage::resize(uint32_t _width, uint32_t _height) {
+
+	width = _width;
+	height = _height;
+	texels.assign((size_t)width * height * 4, 0.0f);
+}
+
+
+void CGDPostImage::fromRGBA8(uint32_t _width, uint32_t _height, const uint32_t *rgba) {
+
+	resize(_width, _height);
+
+	for (size_t i = 0; i < (size_t)width * height; i++) {
+
+		for (int c = 0; c < 4; c++)
+			texels[i * 4 + c] = (float)((rgba[i] >> (c * 8)) & 0xFF) / 255.0f;
+	}
+}
+
+
+void CGDPostImage::toRGBA8(vector<uint8_t>& rgba) const {
+
+	rgba.resize(texels.size());
+
+	for (size_t i = 0; i < texels.size(); i++)
+		rgba[i] = (uint8_t)(min(max(texels[i], 0.0f), 1.0f) * 255.0f + 0.5f);
+}
+
+
+
+//
+// Private interface
+//
+
+// Constructor - called internally by the CreatePostProcess factory method
+CGDPostProcess::CGDPostProcess(uint32_t _width, uint32_t _height, const CGDPostProcessDesc& _desc, CGDJobSystem *_jobSystem) {
+
+	width = _width;
+	height = _height;
+	desc = _desc;
+	jobSystem = _jobSystem;
+
+	if (jobSystem)
+		jobSystem->retain();
+
+	for (int i = 0; i < (int)CGDPostPass::COUNT; i++)
+		passSeconds[i] = 0.0;
+
+	initialise();
+}
+
+
+void CGDPostProcess::initialise() {
+
+	desc.bloomLevels = max(desc.bloomLevels, 1u);
+
+	bloomKernel = CGDCreateBlurKernel(desc.bloomSigma);
+	dofKernel = CGDCreateBlurKernel(desc.dofSigma);
+
+	uint32_t w = max(width / 2, 1u);
+	uint32_t h = max(height / 2, 1u);
+
+	half.resize(w, h);
+	halfScratch.resize(w, h);
+	dofImage.resize(w, h);
+	output.resize(width, height);
+
+	bloomImages.resize(desc.bloomLevels);
+	bloomScratch.resize(desc.bloomLevels);
+
+	for (uint32_t i = 0; i < desc.bloomLevels; i++) {
+
+		bloomImages[i].resize(w, h);
+		bloomScratch[i].resize(w, h);
+
+		w = max(w / 2, 1u);
+		h = max(h / 2, 1u);
+	}
+}
+
+
+void CGDPostProcess::parallelFor(bool parallel, uint32_t count, const function<void(uint32_t begin, uint32_t end)>& body) {
+
+	if (parallel && jobSystem && jobSystem->workerCount() > 0)
+		jobSystem->parallelFor(0, count, rowGrain, body);
+	else
+		body(0, count);
+}
+
+
+void CGDPostProcess::resample(const CGDPostImage& src, CGDPostImage& dst, bool add, bool parallel) {
+
+	SampleTable columns, rows;
+
+	columns.build(dst.width, src.width);
+	rows.build(dst.height, src.height);
+
+	parallelFor(parallel, dst.height, [&](uint32_t begin, uint32_t end) {
+
+		for (uint32_t y = begin; y < end; y++) {
+
+			const float *row0 = &src.texels[(size_t)rows.i0[y] * src.width * 4];
+			const float *row1 = &src.texels[(size_t)rows.i1[y] * src.width * 4];
+			float *d = &dst.texels[(size_t)y * dst.width * 4];
+			__m128 fy = _mm_set1_ps(rows.f[y]);
+
+			for (uint32_t x = 0; x < dst.width; x++, d += 4) {
+
+				__m128 colour = Bilinear4(row0, row1, columns.i0[x], columns.i1[x], _mm_set1_ps(columns.f[x]), fy);
+
+				if (add)
+					colour = _mm_add_ps(colour, _mm_loadu_ps(d));
+
+				_mm_storeu_ps(d, colour);
+			}
+		}
+	});
+}
+
+
+void CGDPostProcess::brightPass(const CGDPostImage& src, CGDPostImage& dst, bool parallel) {
+
+	__m128 threshold = _mm_set1_ps(desc.bloomThreshold);
+	__m128 epsilon = _mm_set1_ps(1.0e-4f);
+
+	parallelFor(parallel, src.height, [&](uint32_t begin, uint32_t end) {
+
+		for (size_t i = (size_t)begin * src.width * 4; i < (size_t)end * src.width * 4; i += 4) {
+
+			__m128 c = _mm_loadu_ps(&src.texels[i]);
+
+			// Largest of r, g and b in every lane
+			__m128 gbr = _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 0, 2, 1));
+			__m128 brg = _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 1, 0, 2));
+			__m128 brightness = _mm_max_ps(c, _mm_max_ps(gbr, brg));
+
+			brightness = _mm_shuffle_ps(brightness, brightness, _MM_SHUFFLE(0, 0, 0, 0));
+
+			__m128 scale = _mm_div_ps(_mm_max_ps(_mm_sub_ps(brightness, threshold), _mm_setzero_ps()), _mm_max_ps(brightness, epsilon));
+
+			_mm_storeu_ps(&dst.texels[i], _mm_mul_ps(c, scale));
+		}
+	});
+}
+
+
+// Horizontal pass src -> scratch, vertical pass scratch -> dst (dst may be src).  Tap i is a bilinear sample at +-offset.  Its left texel on the right side is x + b (b = floor(offset)) and on the left side x - b, and the lerp weight f = frac(offset) is the same for every texel so each tap is 4 texel reads with weights w (1 - f) and w f
+void CGDPostProcess::blur(const CGDPostImage& src, CGDPostImage& scratch, CGDPostImage& dst, const CGDBlurKernel& kernel, bool parallel) {
+
+	uint32_t w = src.width;
+	uint32_t h = src.height;
+	uint32_t pad = kernel.radius + 2;
+
+	int32_t base[CGD_MAX_BLUR_TAPS];
+	__m128 nearWeights[CGD_MAX_BLUR_TAPS], farWeights[CGD_MAX_BLUR_TAPS];
+
+	for (uint32_t i = 0; i < kernel.numTaps; i++) {
+
+		float b = floorf(kernel.offsets[i]);
+		float f = kernel.offsets[i] - b;
+
+		base[i] = (int32_t)b;
+		nearWeights[i] = _mm_set1_ps(kernel.weights[i] * (1.0f - f));
+		farWeights[i] = _mm_set1_ps(kernel.weights[i] * f);
+	}
+
+	// Rows are copied into a buffer extended by clamping so the taps need no bounds checks
+	parallelFor(parallel, h, [&](uint32_t begin, uint32_t end) {
+
+		vector<float> buffer((w + 2 * pad) * 4);
+
+		for (uint32_t y = begin; y < end; y++) {
+
+			const float *s = &src.texels[(size_t)y * w * 4];
+
+			for (uint32_t x = 0; x < w + 2 * pad; x++) {
+
+				uint32_t sx = (uint32_t)min(max((int32_t)x - (int32_t)pad, 0), (int32_t)w - 1);
+
+				_mm_storeu_ps(&buffer[x * 4], _mm_loadu_ps(s + sx * 4));
+			}
+
+			const float *row = &buffer[pad * 4];
+			float *d = &scratch.texels[(size_t)y * w * 4];
+
+			for (int32_t x = 0; x < (int32_t)w; x++) {
+
+				__m128 sum = _mm_mul_ps(_mm_set1_ps(kernel.weights[0]), _mm_loadu_ps(row + x * 4));
+
+				for (uint32_t i = 1; i < kernel.numTaps; i++) {
+
+					__m128 n = _mm_add_ps(_mm_loadu_ps(row + (x + base[i]) * 4), _mm_loadu_ps(row + (x - base[i]) * 4));
+					__m128 f = _mm_add_ps(_mm_loadu_ps(row + (x + base[i] + 1) * 4), _mm_loadu_ps(row + (x - base[i] - 1) * 4));
+
+					sum = _mm_add_ps(sum, _mm_add_ps(_mm_mul_ps(nearWeights[i], n), _mm_mul_ps(farWeights[i], f)));
+				}
+
+				_mm_storeu_ps(d + x * 4, sum);
+			}
+		}
+	});
+
+	// Columns are accumulated a row at a time so every read is sequential
+	parallelFor(parallel, h, [&](uint32_t begin, uint32_t end) {
+
+		for (uint32_t y = begin; y < end; y++) {
+
+			float *d = &dst.texels[(size_t)y * w * 4];
+			const float *centre = &scratch.texels[(size_t)y * w * 4];
+			__m128 w0 = _mm_set1_ps(kernel.weights[0]);
+
+			for (uint32_t x = 0; x < w * 4; x += 4)
+				_mm_storeu_ps(d + x, _mm_mul_ps(w0, _mm_loadu_ps(centre + x)));
+
+			for (uint32_t i = 1; i < kernel.numTaps; i++) {
+
+				int32_t rows[4] = { (int32_t)y + base[i], (int32_t)y - base[i], (int32_t)y + base[i] + 1, (int32_t)y - base[i] - 1 };
+				const float *r[4];
+
+				for (int j = 0; j < 4; j++)
+					r[j] = &scratch.texels[(size_t)min(max(rows[j], 0), (int32_t)h - 1) * w * 4];
+
+				for (uint32_t x = 0; x < w * 4; x += 4) {
+
+					__m128 n = _mm_add_ps(_mm_loadu_ps(r[0] + x), _mm_loadu_ps(r[1] + x));
+					__m128 f = _mm_add_ps(_mm_loadu_ps(r[2] + x), _mm_loadu_ps(r[3] + x));
+
+					_mm_storeu_ps(d + x, _mm_add_ps(_mm_loadu_ps(d + x), _mm_add_ps(_mm_mul_ps(nearWeights[i], n), _mm_mul_ps(farWeights[i], f))));
+				}
+			}
+		}
+	});
+}
+
+
+void CGDPostProcess::composite(const CGDPostImage& scene, const float *depth, uint32_t depthStride, bool parallel) {
+
+	// The depth of field and bloom images are the same size so they share the sample tables
+	SampleTable columns, rows;
+
+	columns.build(width, half.width);
+	rows.build(height, half.height);
+
+	bool dof = desc.focusDistance > 0.0f;
+	__m128 intensity = _mm_set1_ps((desc.bloomIntensity > 0.0f) ? desc.bloomIntensity : 0.0f);
+	const CGDPostImage& bloom = bloomImages[0];
+
+	__m128 nearFar = _mm_set1_ps(desc.nearPlane * desc.farPlane);
+	__m128 farPlane = _mm_set1_ps(desc.farPlane);
+	__m128 depthRange = _mm_set1_ps(desc.farPlane - desc.nearPlane);
+	__m128 focusDistance = _mm_set1_ps(desc.focusDistance);
+	__m128 focusRange = _mm_set1_ps(max(desc.focusRange, 1.0e-6f));
+	__m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+	__m128 alphaMask = _mm_castsi128_ps(_mm_set_epi32(-1, 0, 0, 0));
+
+	parallelFor(parallel, height, [&](uint32_t begin, uint32_t end) {
+
+		vector<float> coc(width);
+
+		for (uint32_t y = begin; y < end; y++) {
+
+			const float *s = &scene.texels[(size_t)y * width * 4];
+			const float *z = depth + (size_t)y * depthStride;
+			float *o = &output.texels[(size_t)y * width * 4];
+			size_t r0 = (size_t)rows.i0[y] * half.width * 4;
+			size_t r1 = (size_t)rows.i1[y] * half.width * 4;
+			__m128 fy = _mm_set1_ps(rows.f[y]);
+
+			// Circle of confusion of the row, 4 pixels at a time
+			uint32_t x = 0;
+
+			for (; dof && x + 4 <= width; x += 4) {
+
+				__m128 linear = _mm_div_ps(nearFar, _mm_sub_ps(farPlane, _mm_mul_ps(_mm_loadu_ps(z + x), depthRange)));
+				__m128 d = _mm_div_ps(_mm_and_ps(_mm_sub_ps(linear, focusDistance), absMask), focusRange);
+
+				_mm_storeu_ps(&coc[x], _mm_min_ps(d, _mm_set1_ps(1.0f)));
+			}
+
+			for (; dof && x < width; x++)
+				coc[x] = CircleOfConfusion(z[x], desc);
+
+			for (x = 0; x < width; x++) {
+
+				__m128 colour = _mm_loadu_ps(s + x * 4);
+				__m128 fx = _mm_set1_ps(columns.f[x]);
+
+				if (dof) {
+
+					__m128 blurred = Bilinear4(&dofImage.texels[r0], &dofImage.texels[r1], columns.i0[x], columns.i1[x], fx, fy);
+
+					colour = _mm_add_ps(colour, _mm_mul_ps(_mm_sub_ps(blurred, colour), _mm_set1_ps(coc[x])));
+				}
+
+				if (desc.bloomIntensity > 0.0f) {
+
+					__m128 glow = Bilinear4(&bloom.texels[r0], &bloom.texels[r1], columns.i0[x], columns.i1[x], fx, fy);
+
+					colour = _mm_add_ps(colour, _mm_mul_ps(glow, intensity));
+				}
+
+				// Alpha = 1
+				_mm_storeu_ps(o + x * 4, _mm_or_ps(_mm_andnot_ps(alphaMask, colour), _mm_and_ps(alphaMask, _mm_set1_ps(1.0f))));
+			}
+		}
+	});
+}
+
+
+void CGDPostProcess::run(const CGDPostImage& scene, const float *depth, uint32_t depthStride, bool reference, bool parallel) {
+
+	if (scene.width != width || scene.height != height || !depth)
+		return;
+
+	bool dof = desc.focusDistance > 0.0f;
+	bool bloom = desc.bloomIntensity > 0.0f;
+	uint32_t levels = (uint32_t)bloomImages.size();
+	double frequency = (double)CGDClock::ActualTimeFrequency();
+	gu_time_index start = CGDClock::ActualTime();
+
+	vector<float> dofWeights, bloomWeights;
+
+	if (reference) {
+
+		CGDGaussianWeights(dofKernel.sigma, dofKernel.radius, dofWeights);
+		CGDGaussianWeights(bloomKernel.sigma, bloomKernel.radius, bloomWeights);
+	}
+
+	// Time from the previous pass to now
+	auto endPass = [&](CGDPostPass pass) {
+
+		gu_time_index now = CGDClock::ActualTime();
+
+		passSeconds[(int)pass] = (double)(now - start) / frequency;
+		start = now;
+	};
+
+	if (reference) {
+
+		ReferenceResample(scene, half, false);
+		endPass(CGDPostPass::DOWNSAMPLE);
+
+		if (dof)
+			ReferenceBlur(half, halfScratch, dofImage, dofWeights);
+
+		endPass(CGDPostPass::DOF_BLUR);
+
+		if (bloom)
+			ReferenceBrightPass(half, bloomImages[0], desc.bloomThreshold);
+
+		endPass(CGDPostPass::BRIGHT_PASS);
+
+		for (uint32_t i = 1; i < levels && bloom; i++)
+			ReferenceResample(bloomImages[i - 1], bloomImages[i], false);
+
+		endPass(CGDPostPass::BLOOM_DOWNSAMPLE);
+
+		for (uint32_t i = 0; i < levels && bloom; i++)
+			ReferenceBlur(bloomImages[i], bloomScratch[i], bloomImages[i], bloomWeights);
+
+		endPass(CGDPostPass::BLOOM_BLUR);
+
+		for (uint32_t i = levels - 1; i > 0 && bloom; i--)
+			ReferenceResample(bloomImages[i], bloomImages[i - 1], true);
+
+		endPass(CGDPostPass::BLOOM_UPSAMPLE);
+
+		ReferenceComposite(scene, depth, depthStride, (dof) ? &dofImage : nullptr, (bloom) ? &bloomImages[0] : nullptr, desc, output);
+		endPass(CGDPostPass::COMPOSITE);
+	}
+	else {
+
+		resample(scene, half, false, parallel);
+		endPass(CGDPostPass::DOWNSAMPLE);
+
+		if (dof)
+			blur(half, halfScratch, dofImage, dofKernel, parallel);
+
+		endPass(CGDPostPass::DOF_BLUR);
+
+		if (bloom)
+			brightPass(half, bloomImages[0], parallel);
+
+		endPass(CGDPostPass::BRIGHT_PASS);
+
+		for (uint32_t i = 1; i < levels && bloom; i++)
+			resample(bloomImages[i - 1], bloomImages[i], false, parallel);
+
+		endPass(CGDPostPass::BLOOM_DOWNSAMPLE);
+
+		for (uint32_t i = 0; i < levels && bloom; i++)
+			blur(bloomImages[i], bloomScratch[i], bloomImages[i], bloomKernel, parallel);
+
+		endPass(CGDPostPass::BLOOM_BLUR);
+
+		for (uint32_t i = levels - 1; i > 0 && bloom; i--)
+			resample(bloomImages[i], bloomImages[i - 1], true, parallel);
+
+		endPass(CGDPostPass::BLOOM_UPSAMPLE);
+
+		composite(scene, depth, depthStride, parallel);
+		endPass(CGDPostPass::COMPOSITE);
+	}
+}
+
+
+
+//
+// Public interface
+//
+
+// Factory method
+CGDPostProcess* CGDPostProcess::CreatePostProcess(uint32_t width, uint32_t height, const CGDPostProcessDesc& desc, CGDJobSystem *jobSystem) {
+
+	if (width == 0 || height == 0)
+		return nullptr;
+
+	return new CGDPostProcess(width, height, desc, jobSystem);
+}
+
+
+// Destructor
+CGDPostProcess::~CGDPostProcess() {
+
+	if (jobSystem)
+		jobSystem->release();
+}
+
+
+void CGDPostProcess::setDesc(const CGDPostProcessDesc& _desc) {
+
+	desc = _desc;
+	initialise();
+}
+
+
+void CGDPostProcess::process(const CGDPostImage& scene, const float *depth, uint32_t depthStride, bool parallel) {
+
+	PROFILE_SCOPE("CGDPostProcess::process");
+
+	run(scene, depth, depthStride, false, parallel);
+}
+
+
+void CGDPostProcess::processReference(const CGDPostImage& scene, const float *depth, uint32_t depthStride) {
+
+	run(scene, depth, depthStride, true, false);
+}
+
+
+const CGDPostProcessDesc& CGDPostProcess::getDesc() const {
+
+	return desc;
+}
+
+
+uint32_t CGDPostProcess::getWidth() const {
+
+	return width;
+}
+
+
+uint32_t CGDPostProcess::getHeight() const {
+
+	return height;
+}
+
+
+const CGDBlurKernel& CGDPostProcess::getBloomKernel() const {
+
+	return bloomKernel;
+}
+
+
+const CGDBlurKernel& CGDPostProcess::getDepthOfFieldKernel() const {
+
+	return dofKernel;
+}
+
+
+const CGDPostImage& CGDPostProcess::getOutput() const {
+
+	return output;
+}
+
+
+const CGDPostImage& CGDPostProcess::getHalf() const {
+
+	return half;
+}
+
+
+const CGDPostImage& CGDPostProcess::getDepthOfField() const {
+
+	return dofImage;
+}
+
+
+const CGDPostImage& CGDPostProcess::getBloom() const {
+
+	return bloomImages[0];
+}
+
+
+double CGDPostProcess::getPassTime(CGDPostPass pass) const {
+
+	return (pass < CGDPostPass::COUNT) ? passSeconds[(int)pass] : 0.0;
+}
+
+
+bool CGDPostProcess::benchmark(const CGDPostImage& scene, const float *depth, uint32_t depthStride, uint32_t frames, const string& goldenPrefix) {
+
+	double frequency = (double)CGDClock::ActualTimeFrequency();
+	ostringstream report;
+
+	frames = max(frames, 1u);
+
+	report << fixed << setprecision(3);
+	report << "\nPost-processing benchmark (" << width << " x " << height << ", " << bloomImages.size() << " bloom levels, " << ((jobSystem) ? jobSystem->workerCount() : 0) << " worker threads)...\n";
+	report << "Bloom kernel sigma " << bloomKernel.sigma << ": " << bloomKernel.numTaps << " taps a side for a radius of " << bloomKernel.radius << " texels, depth of field kernel sigma " << dofKernel.sigma << ": " << dofKernel.numTaps << " taps a side for a radius of " << dofKernel.radius << " texels\n";
+
+	// Validate the fast path against the reference at every stage
+	const char *stages[] = { "half", "depth_of_field", "bloom", "output" };
+	const CGDPostImage *images[] = { &half, &dofImage, &bloomImages[0], &output };
+	vector<CGDPostImage> referenceImages(4);
+
+	processReference(scene, depth, depthStride);
+
+	for (int i = 0; i < 4; i++)
+		referenceImages[i] = *images[i];
+
+	process(scene, depth, depthStride);
+
+	float maxError = 0.0f;
+
+	for (int i = 0; i < 4; i++) {
+
+		for (size_t j = 0; j < images[i]->texels.size(); j++)
+			maxError = max(maxError, fabsf(images[i]->texels[j] - referenceImages[i].texels[j]));
+	}
+
+	// Compare the reference with the golden images (or save them)
+	bool goldenMatched = true;
+
+	for (int i = 0; i < 4 && !goldenPrefix.empty(); i++) {
+
+		string filename = goldenPrefix + stages[i] + ".png";
+		vector<uint8_t> rgba, golden;
+		uint32_t goldenWidth = 0, goldenHeight = 0;
+
+		referenceImages[i].toRGBA8(rgba);
+
+		if (!ifstream(filename).is_open() || !gu_image_read_rgba(filename.c_str(), goldenWidth, goldenHeight, golden)) {
+
+			if (gu_png_write(filename.c_str(), referenceImages[i].width, referenceImages[i].height, rgba.data(), referenceImages[i].width * 4))
+				report << "Golden image " << filename << " written\n";
+			else
+				report << "Cannot write golden image " << filename << "\n";
+
+			continue;
+		}
+
+		if (goldenWidth != referenceImages[i].width || goldenHeight != referenceImages[i].height) {
+
+			report << "Golden image " << filename << " is " << goldenWidth << " x " << goldenHeight << " - expected " << referenceImages[i].width << " x " << referenceImages[i].height << "\n";
+			goldenMatched = false;
+			continue;
+		}
+
+		int maxDifference = 0;
+
+		for (size_t j = 0; j < rgba.size(); j++)
+			maxDifference = max(maxDifference, abs((int)rgba[j] - (int)golden[j]));
+
+		report << "Golden image " << filename << ": largest difference " << maxDifference << ((maxDifference <= goldenTolerance) ? "\n" : " - MISMATCH\n");
+
+		if (maxDifference > goldenTolerance)
+			goldenMatched = false;
+	}
+
+	// Time per frame of each pass with each path
+	const char *names[3] = { "reference", "SSE", "SSE + jobs" };
+	double seconds[3][(int)CGDPostPass::COUNT];
+	double totals[3];
+
+	for (int path = 0; path < 3; path++) {
+
+		totals[path] = 0.0;
+
+		for (int p = 0; p < (int)CGDPostPass::COUNT; p++)
+			seconds[path][p] = 0.0;
+
+		// The reference is slow so it is timed over fewer frames
+		uint32_t n = (path == 0) ? max(frames / 10, 1u) : frames;
+		gu_time_index start = CGDClock::ActualTime();
+
+		for (uint32_t i = 0; i < n; i++) {
+
+			if (path == 0)
+				processReference(scene, depth, depthStride);
+			else
+				process(scene, depth, depthStride, path == 2);
+
+			for (int p = 0; p < (int)CGDPostPass::COUNT; p++)
+				seconds[path][p] += passSeconds[p] / (double)n;
+		}
+
+		totals[path] = (double)(CGDClock::ActualTime() - start) / frequency / (double)n;
+	}
+
+	for (int p = 0; p < (int)CGDPostPass::COUNT; p++) {
+
+		report << CGDPostPassName((CGDPostPass)p) << ": ";
+
+		for (int path = 0; path < 3; path++)
+			report << names[path] << " " << seconds[path][p] * 1000.0 << " ms" << ((path < 2) ? ", " : "\n");
+	}
+
+	for (int path = 0; path < 3; path++) {
+
+		report << names[path] << ": " << totals[path] * 1000.0 << " ms per frame";
+
+		if (path > 0)
+			report << " (" << setprecision(1) << totals[0] / max(totals[path], 1e-9) << "x)" << setprecision(3);
+
+		report << ((path < 2) ? ", " : "\n");
+	}
+
+	report << "Difference from the reference: " << scientific << setprecision(2) << maxError << fixed << "\n";
+
+	cout << report.str();
+
+	return maxError <= referenceTolerance && goldenMatched;
+}
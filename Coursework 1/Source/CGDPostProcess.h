@@ -0,0 +1,169 @@
+//
+// CGDPostProcess.h
+//
+
+// Post-processing chain - bloom and depth of field built from resampling and separable Gaussian blur passes over RGBA float images.  The scene is downsampled to half resolution once and both effects work from that copy.  Depth of field blurs it and the composite blends it over the scene by the circle of confusion (the distance of each pixel's linear depth from the focus distance, relative to the focus range).  Bloom keeps the part of the half resolution scene above a brightness threshold, builds a pyramid by halving it bloomLevels - 1 times, blurs every level and adds each level, upsampled, to the level above before the composite adds the top level to the scene.  Blurring the small levels gives a wide glow for the cost of a small kernel.
+//
+// Blur kernels are generated from sigma (see CGDCreateBlurKernel).  The discrete Gaussian covers 3 sigma either side of the centre and pairs of neighbouring texels are merged into one tap placed between them so a bilinear sample returns their weighted sum - a kernel of radius r needs 1 + ceil(r / 2) taps each side instead of 2r + 1.  Every pass samples like a D3D11 pixel shader drawing a full screen quad into its target with a linear clamp sampler - texel centres are at half-integers and a target texel samples the source at its centre - so the chain is also what DXPostProcess runs on the GPU (convolve_u_ps.hlsl, convolve_v_ps.hlsl and the post_*.hlsl shaders).
+//
+// process is the fast path - SSE on a pixel at a time with each pass split across the job system by rows.  processReference runs the same chain as straightforward scalar loops with the discrete kernels and is what process is validated against.  benchmark reports the cost of each pass and compares the reference images with golden images saved by an earlier run.
+
+#pragma once
+
+#include <GUObject.h>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+class CGDJobSystem;
+
+
+// Taps each side of a blur kernel including the centre tap.  Kernels are limited to a radius of 2 * (CGD_MAX_BLUR_TAPS - 1) texels (sigma 10).  Must match MAX_BLUR_TAPS in the convolve shaders
+#define CGD_MAX_BLUR_TAPS				16
+
+
+// Passes in the order they run
+enum class CGDPostPass : uint8_t {
+
+	DOWNSAMPLE = 0, // scene to half resolution
+	DOF_BLUR, // half resolution scene blurred for depth of field
+	BRIGHT_PASS, // half resolution scene above the bloom threshold
+	BLOOM_DOWNSAMPLE, // bright pass down the bloom pyramid
+	BLOOM_BLUR, // every pyramid level
+	BLOOM_UPSAMPLE, // each level added to the level above, smallest first
+	COMPOSITE, // scene, depth of field and bloom to the output
+	COUNT
+};
+
+
+// Separable Gaussian blur kernel with linear-sampling taps.  A pass samples offsets[0] (the centre) once and every other offset on both sides of the centre
+struct CGDBlurKernel {
+
+	float					sigma;
+	uint32_t				radius; // texels covered either side of the centre
+	uint32_t				numTaps; // taps each side including the centre
+	float					offsets[CGD_MAX_BLUR_TAPS]; // texels from the centre (offsets[0] = 0)
+	float					weights[CGD_MAX_BLUR_TAPS]; // weights[0] + 2 * (weights[1] + ... ) = 1
+};
+
+
+// RGBA float image (4 floats per texel, row-major, no padding)
+struct CGDPostImage {
+
+	uint32_t				width = 0;
+	uint32_t				height = 0;
+	std::vector<float>		texels;
+
+	void resize(uint32_t width, uint32_t height);
+
+	// Convert from / to R8G8B8A8 values (R in the low byte).  toRGBA8 clamps to [0, 1]
+	void fromRGBA8(uint32_t width, uint32_t height, const uint32_t *rgba);
+	void toRGBA8(std::vector<uint8_t>& rgba) const;
+};
+
+
+struct CGDPostProcessDesc {
+
+	float					bloomThreshold = 0.8f; // brightness (largest channel) where bloom starts
+	float					bloomIntensity = 0.6f; // scale of the bloom added to the scene (0 = no bloom)
+	float					bloomSigma = 2.0f; // blur of each pyramid level in texels of that level
+	uint32_t				bloomLevels = 4; // pyramid levels below the scene (half, quarter ... resolution)
+	float					focusDistance = 25.0f; // linear depth in focus (0 = no depth of field)
+	float					focusRange = 60.0f; // distance from the focus to full blur
+	float					dofSigma = 3.0f; // depth of field blur in half resolution texels
+	float					nearPlane = 1.0f; // projection of the depth buffer (Scene and HeadlessScene use 1 - 1000)
+	float					farPlane = 1000.0f;
+};
+
+
+// Name of a pass (eg. for reports)
+const char* CGDPostPassName(CGDPostPass pass);
+
+// Discrete Gaussian weights for offsets 0 .. radius, normalised over -radius .. radius.  Entries past the kernel's 3 sigma radius are 0
+void CGDGaussianWeights(float sigma, uint32_t radius, std::vector<float>& weights);
+
+// Linear-sampling kernel for sigma.  The radius is ceil(3 sigma) limited by CGD_MAX_BLUR_TAPS and sigma <= 0 gives the identity kernel
+CGDBlurKernel CGDCreateBlurKernel(float sigma);
+
+
+class CGDPostProcess : public GUObject {
+
+	CGDPostProcessDesc				desc;
+	CGDJobSystem					*jobSystem = nullptr; // nullptr = process on the calling thread
+	uint32_t						width = 0;
+	uint32_t						height = 0;
+
+	CGDBlurKernel					bloomKernel;
+	CGDBlurKernel					dofKernel;
+
+	// Chain images.  Each blur writes its horizontal pass to the scratch image of the same size and its vertical pass to the destination (the bloom levels are blurred in place)
+	CGDPostImage					half;
+	CGDPostImage					halfScratch;
+	CGDPostImage					dofImage;
+	std::vector<CGDPostImage>		bloomImages; // bloomLevels images from half resolution down
+	std::vector<CGDPostImage>		bloomScratch;
+	CGDPostImage					output;
+
+	double							passSeconds[(int)CGDPostPass::COUNT]; // time of each pass in the last process or processReference
+
+
+	//
+	// Private interface
+	//
+
+	// Constructor - called internally by the CreatePostProcess factory method
+	CGDPostProcess(uint32_t width, uint32_t height, const CGDPostProcessDesc& desc, CGDJobSystem *jobSystem);
+
+	// Size the chain images and build the kernels for desc
+	void initialise();
+
+	// Call body over [0, count) rows on the job system if parallel, otherwise on the calling thread
+	void parallelFor(bool parallel, uint32_t count, const std::function<void(uint32_t begin, uint32_t end)>& body);
+
+	// Fast path passes.  resample writes (or adds to) every texel of dst the bilinear sample of src at its centre
+	void resample(const CGDPostImage& src, CGDPostImage& dst, bool add, bool parallel);
+	void brightPass(const CGDPostImage& src, CGDPostImage& dst, bool parallel);
+	void blur(const CGDPostImage& src, CGDPostImage& scratch, CGDPostImage& dst, const CGDBlurKernel& kernel, bool parallel);
+	void composite(const CGDPostImage& scene, const float *depth, uint32_t depthStride, bool parallel);
+
+	// Run the chain with the fast path or the reference
+	void run(const CGDPostImage& scene, const float *depth, uint32_t depthStride, bool reference, bool parallel);
+
+
+public:
+
+	//
+	// Public interface
+	//
+
+	// Factory method.  The job system (if given) is retained.  Return nullptr if width or height is 0
+	static CGDPostProcess* CreatePostProcess(uint32_t width, uint32_t height, const CGDPostProcessDesc& desc, CGDJobSystem *jobSystem = nullptr);
+
+	// Destructor
+	~CGDPostProcess();
+
+	// Replace the settings (the kernels and bloom pyramid are rebuilt)
+	void setDesc(const CGDPostProcessDesc& desc);
+
+	// Run the chain on scene (width * height) with its depth buffer (post-projection depth in [0, 1], depthStride floats between rows).  parallel = false runs every pass on the calling thread
+	void process(const CGDPostImage& scene, const float *depth, uint32_t depthStride, bool parallel = true);
+
+	// Run the chain with the scalar reference implementation
+	void processReference(const CGDPostImage& scene, const float *depth, uint32_t depthStride);
+
+	// Query methods
+	const CGDPostProcessDesc& getDesc() const;
+	uint32_t getWidth() const;
+	uint32_t getHeight() const;
+	const CGDBlurKernel& getBloomKernel() const;
+	const CGDBlurKernel& getDepthOfFieldKernel() const;
+	const CGDPostImage& getOutput() const;
+	const CGDPostImage& getHalf() const; // half resolution scene
+	const CGDPostImage& getDepthOfField() const; // blurred half resolution scene
+	const CGDPostImage& getBloom() const; // top bloom level after the upsample pass
+	double getPassTime(CGDPostPass pass) const; // seconds in the last process or processReference
+
+	// Report the time per frame of each pass with the reference, the fast path on the calling thread and the fast path on the job system over frames runs and the largest difference between the fast path and the reference.  If goldenPrefix is not empty the reference images of each stage are compared with <goldenPrefix><stage>.png, or written there if the file does not exist.  Return false if the fast path does not match the reference or a golden image does not match
+	bool benchmark(const CGDPostImage& scene, const float *depth, uint32_t depthStride, uint32_t frames, const std::string& goldenPrefix);
+};
@@ -0,0 +1,284 @@
+//
+// CGDProfiler.cpp
+//
+
+#include <stdafx.h>
+#include <CGDProfiler.h>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <fstream>
+#include <iomanip>
+#include <algorithm>
+
+using namespace std;
+
+
+CGD_THREAD_LOCAL CGDProfileThreadBuffer		*cgdProfileThreadBuffer = nullptr;
+
+
+// Registered thread buffers.  Buffers are never freed while the process runs so pointers held in thread local storage remain valid
+static mutex								profilerLock;
+static vector<CGDProfileThreadBuffer*>		threadBuffers;
+
+// Calibration point used to convert profiler timestamps (see CGDProfiler::Now) into CGDClock time
+static uint64_t								calibrationTicks = 0;
+static gu_time_index						calibrationTime = 0;
+
+
+
+//
+// Private helper functions
+//
+
+// Return the number of profiler timestamp ticks per second by comparing the elapsed profiler and CGDClock time since the first thread was registered
+static double profilerTicksPerSecond() {
+
+	uint64_t ticks = CGDProfiler::Now();
+	gu_time_index t = CGDClock::ActualTime();
+
+	gu_time_index frequency = CGDClock::ActualTimeFrequency();
+	gu_seconds elapsed = (frequency > 0) ? (gu_seconds)(t - calibrationTime) / (gu_seconds)frequency : 0.0;
+
+	if (elapsed <= 0.0 || ticks <= calibrationTicks)
+		return 1.0;
+
+	return (double)(ticks - calibrationTicks) / elapsed;
+}
+
+
+// Write a JSON string literal (names are expected to be identifiers but quotes and backslashes are escaped)
+static void writeJSONString(ostream& os, const char *s) {
+
+	os << '"';
+
+	for (; s && *s; s++) {
+
+		if (*s == '"' || *s == '\\')
+			os << '\\';
+
+		os << *s;
+	}
+
+	os << '"';
+}
+
+
+
+//
+// CGDProfileThreadBuffer implementation
+//
+
+vector<CGDProfileEvent> CGDProfileThreadBuffer::snapshot() const {
+
+	uint64_t end = eventCount.load(memory_order_acquire);
+	uint64_t count = min<uint64_t>(end, capacity);
+
+	vector<CGDProfileEvent> events;
+	events.reserve((size_t)count);
+
+	for (uint64_t i = end - count; i < end; i++) {
+
+		const Slot& slot = slots[i & (capacity - 1)];
+
+		// seqlock read - the event is only valid if the slot held event i before and after the copy (the acquire fence orders the word loads before the second sequence load)
+		uint64_t sequence = slot.sequence.load(memory_order_acquire);
+
+		if (sequence != i + 1)
+			continue;
+
+		uint64_t words[5];
+
+		for (int w = 0; w < 5; w++)
+			words[w] = slot.words[w].load(memory_order_relaxed);
+
+		atomic_thread_fence(memory_order_acquire);
+
+		if (slot.sequence.load(memory_order_relaxed) != sequence)
+			continue;
+
+		CGDProfileEvent e;
+
+		e.name = (const char*)(uintptr_t)words[0];
+		e.begin = words[1];
+		e.end = words[2];
+		e.value = (int64_t)words[3];
+		e.depth = (uint16_t)(words[4] & 0xffff);
+		e.type = (CGDProfileEventType)(words[4] >> 16);
+
+		events.push_back(e);
+	}
+
+	return events;
+}
+
+
+
+//
+// CGDProfiler implementation
+//
+
+CGDProfileThreadBuffer* CGDProfiler::RegisterThread() {
+
+	GU_MEMORY_TAG_SCOPE(gu_mem_profiler);
+
+	// Thread buffers (and the list of them) are kept for the life of the process since events are reported after their threads exit, so they are not leaks
+	CGDProfileThreadBuffer *buffer = new CGDProfileThreadBuffer();
+
+	gu_memory_ignore(buffer);
+
+	lock_guard<mutex> lock(profilerLock);
+
+	if (threadBuffers.empty()) {
+
+		calibrationTicks = CGDProfiler::Now();
+		calibrationTime = CGDClock::ActualTime();
+
+		threadBuffers.reserve(64);
+		gu_memory_ignore(threadBuffers.data());
+	}
+
+	buffer->threadID = (uint32_t)threadBuffers.size();
+
+	CGDProfileThreadBuffer **storage = threadBuffers.data();
+
+	threadBuffers.push_back(buffer);
+
+	if (threadBuffers.data() != storage)
+		gu_memory_ignore(threadBuffers.data());
+
+	cgdProfileThreadBuffer = buffer;
+
+	return buffer;
+}
+
+
+void CGDProfiler::SetThreadName(const char *name) {
+
+	CGDProfileThreadBuffer *buffer = ThreadBuffer();
+
+	lock_guard<mutex> lock(profilerLock);
+
+	buffer->threadName = name;
+}
+
+
+void CGDProfiler::Counter(const char *name, int64_t value) {
+
+	CGDProfileThreadBuffer *buffer = ThreadBuffer();
+	CGDProfileEvent e;
+
+	e.name = name;
+	e.begin = e.end = CGDProfiler::Now();
+	e.value = value;
+	e.depth = buffer->depth;
+	e.type = CGDProfileEventType::COUNTER;
+
+	buffer->push(e);
+}
+
+
+void CGDProfiler::Reset() {
+
+	lock_guard<mutex> lock(profilerLock);
+
+	for (auto buffer : threadBuffers)
+		buffer->eventCount.store(0, memory_order_release);
+}
+
+
+void CGDProfiler::ReportTimingData() {
+
+	struct ZoneStats {
+
+		uint64_t		calls = 0;
+		double			total = 0.0;
+		double			maximum = 0.0;
+		uint16_t		depth = 0;
+	};
+
+	lock_guard<mutex> lock(profilerLock);
+
+	if (threadBuffers.empty())
+		return;
+
+	double msPerTick = 1000.0 / profilerTicksPerSecond();
+	map<string, ZoneStats> zones;
+
+	for (auto buffer : threadBuffers) {
+
+		for (auto& e : buffer->snapshot()) {
+
+			if (e.type != CGDProfileEventType::ZONE)
+				continue;
+
+			ZoneStats& z = zones[e.name];
+			double ms = (double)(e.end - e.begin) * msPerTick;
+
+			z.calls++;
+			z.total += ms;
+			z.maximum = max(z.maximum, ms);
+			z.depth = e.depth;
+		}
+	}
+
+	cout << "\nProfile zones (ms)...\n";
+
+	for (auto& z : zones) {
+
+		cout << string(z.second.depth * 2, ' ') << z.first << ": calls = " << z.second.calls << ", total = " << z.second.total << ", average = " << (z.second.total / (double)z.second.calls) << ", max = " << z.second.maximum << endl;
+	}
+}
+
+
+bool CGDProfiler::ExportChromeTrace(const string& filename) {
+
+	ofstream file(filename);
+
+	if (!file.is_open()) {
+
+		cout << "Cannot open profile trace file " << filename << endl;
+		return false;
+	}
+
+	lock_guard<mutex> lock(profilerLock);
+
+	double usPerTick = 1000000.0 / profilerTicksPerSecond();
+	bool first = true;
+
+	file << fixed << setprecision(3);
+	file << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+
+	for (auto buffer : threadBuffers) {
+
+		// Thread name metadata
+		if (!buffer->threadName.empty()) {
+
+			file << (first ? "" : ",\n") << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 0, \"tid\": " << buffer->threadID << ", \"args\": {\"name\": ";
+			writeJSONString(file, buffer->threadName.c_str());
+			file << "}}";
+
+			first = false;
+		}
+
+		for (auto& e : buffer->snapshot()) {
+
+			// Events recorded before the calibration point (ie. before a Reset) are clamped to 0
+			double ts = (e.begin > calibrationTicks) ? (double)(e.begin - calibrationTicks) * usPerTick : 0.0;
+
+			file << (first ? "" : ",\n") << "{\"name\": ";
+			writeJSONString(file, e.name);
+
+			if (e.type == CGDProfileEventType::ZONE)
+				file << ", \"ph\": \"X\", \"ts\": " << ts << ", \"dur\": " << (double)(e.end - e.begin) * usPerTick << ", \"pid\": 0, \"tid\": " << buffer->threadID << "}";
+			else
+				file << ", \"ph\": \"C\", \"ts\": " << ts << ", \"pid\": 0, \"tid\": " << buffer->threadID << ", \"args\": {\"value\": " << e.value << "}}";
+
+			first = false;
+		}
+	}
+
+	file << "\n]}\n";
+
+	return file.good();
+}
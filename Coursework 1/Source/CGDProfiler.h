@@ -0,0 +1,196 @@
+//
+// CGDProfiler.h
+//
+
+// Hierarchical CPU profiler.  Code is instrumented with RAII zones (PROFILE_SCOPE("name")) and counters (PROFILE_COUNTER("name", value)).  Each thread records events into its own fixed size ring buffer without locking - the only shared state is the list of thread buffers which is locked when a thread records its first event.  Recorded events can be aggregated (reportTimingData) or exported as a Chrome trace / Perfetto JSON file (chrome://tracing or ui.perfetto.dev).
+//
+// The profiling macros compile out entirely unless __CGD_PROFILE__ is defined (Debug configuration).  Zone and counter names must be string literals (or otherwise outlive the profiler) since only the pointer is recorded.
+
+#pragma once
+
+#include <CGDClock.h>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define CGD_THREAD_LOCAL			__declspec(thread)
+#else
+#if defined(__i386__) || defined(__x86_64__)
+#include <x86intrin.h>
+#endif
+#define CGD_THREAD_LOCAL			__thread
+#endif
+
+
+// Profile event types
+enum class CGDProfileEventType : uint8_t { ZONE = 0, COUNTER };
+
+
+// Single profile event.  Zones store begin / end timestamps, counters store a single timestamp (begin) and value
+struct CGDProfileEvent {
+
+	const char				*name;
+	uint64_t				begin;
+	uint64_t				end;
+	int64_t					value;
+	uint16_t				depth;
+	CGDProfileEventType		type;
+};
+
+
+// Per-thread event ring buffer.  Only the owning thread writes events.  Each slot carries a sequence number (the 1-based index of the event it holds, 0 while it is being overwritten) so readers can take a snapshot while the owning thread is recording - slots overwritten during the copy are detected and dropped rather than returned torn.  The event itself is stored as relaxed atomic words so the reader's copy of a slot being overwritten is not a data race (relaxed loads and stores are plain moves on x86)
+struct CGDProfileThreadBuffer {
+
+	static const uint32_t			capacity = 1 << 16; // must be a power of 2
+
+	struct Slot {
+
+		std::atomic<uint64_t>		sequence;
+		std::atomic<uint64_t>		words[5]; // name, begin, end, value and depth | type << 16
+	};
+
+	std::atomic<uint64_t>			eventCount;
+	uint32_t						threadID = 0;
+	uint16_t						depth = 0;
+	std::string						threadName;
+	Slot							slots[capacity];
+
+	CGDProfileThreadBuffer() : eventCount(0) {
+
+		for (uint32_t i = 0; i < capacity; i++)
+			slots[i].sequence.store(0, std::memory_order_relaxed);
+	}
+
+	void push(const CGDProfileEvent& e) {
+
+		uint64_t n = eventCount.load(std::memory_order_relaxed);
+		Slot& slot = slots[n & (capacity - 1)];
+
+		// invalidate the slot before overwriting it (the release fence orders the invalidation before the event stores)
+		slot.sequence.store(0, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+
+		slot.words[0].store((uint64_t)(uintptr_t)e.name, std::memory_order_relaxed);
+		slot.words[1].store(e.begin, std::memory_order_relaxed);
+		slot.words[2].store(e.end, std::memory_order_relaxed);
+		slot.words[3].store((uint64_t)e.value, std::memory_order_relaxed);
+		slot.words[4].store((uint64_t)e.depth | ((uint64_t)e.type << 16), std::memory_order_relaxed);
+
+		slot.sequence.store(n + 1, std::memory_order_release);
+		eventCount.store(n + 1, std::memory_order_release);
+	}
+
+	// Copy the most recent (at most capacity) events in recording order.  Safe to call while the owning thread is recording - events overwritten during the copy are omitted
+	std::vector<CGDProfileEvent> snapshot() const;
+};
+
+
+// Calling thread's event buffer (created on first use by CGDProfiler::ThreadBuffer)
+extern CGD_THREAD_LOCAL CGDProfileThreadBuffer		*cgdProfileThreadBuffer;
+
+
+class CGDProfiler {
+
+public:
+
+	// Return the current profiler timestamp.  On x86 this is the time stamp counter (assumed invariant) which is cheaper to read than QueryPerformanceCounter.  Timestamps are converted to seconds against CGDClock::ActualTime when events are exported
+	static inline uint64_t Now() {
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+		return __rdtsc();
+#else
+		return (uint64_t)CGDClock::ActualTime();
+#endif
+	}
+
+	// Return the calling thread's event buffer, registering a new buffer on first use
+	static inline CGDProfileThreadBuffer* ThreadBuffer() {
+
+		return (cgdProfileThreadBuffer) ? cgdProfileThreadBuffer : RegisterThread();
+	}
+
+	// Name the calling thread in exported traces
+	static void SetThreadName(const char *name);
+
+	// Record a counter sample on the calling thread
+	static void Counter(const char *name, int64_t value);
+
+	// Discard all recorded events.  Must not be called while other threads are recording events
+	static void Reset();
+
+	// Print per-zone call counts and total / average / maximum times (ms) to the console
+	static void ReportTimingData();
+
+	// Write all recorded events as Chrome trace JSON.  Return true if successful
+	static bool ExportChromeTrace(const std::string& filename);
+
+private:
+
+	static CGDProfileThreadBuffer* RegisterThread();
+};
+
+
+// RAII profile zone - records a ZONE event covering the lifetime of the object
+class CGDProfileZone {
+
+	const char					*_name;
+	CGDProfileThreadBuffer		*_buffer;
+	uint64_t					_begin;
+
+public:
+
+	CGDProfileZone(const char *name) : _name(name), _buffer(CGDProfiler::ThreadBuffer()) {
+
+		_buffer->depth++;
+		_begin = CGDProfiler::Now();
+	}
+
+	~CGDProfileZone() {
+
+		CGDProfileEvent e;
+
+		e.end = CGDProfiler::Now();
+		e.name = _name;
+		e.begin = _begin;
+		e.value = 0;
+		e.depth = --_buffer->depth;
+		e.type = CGDProfileEventType::ZONE;
+
+		_buffer->push(e);
+	}
+
+private:
+
+	CGDProfileZone(const CGDProfileZone&);
+	CGDProfileZone& operator=(const CGDProfileZone&);
+};
+
+
+
+//
+// Profiling macros
+//
+
+#ifdef __CGD_PROFILE__
+
+#define CGD_PROFILE_CONCAT_(a, b)			a##b
+#define CGD_PROFILE_CONCAT(a, b)			CGD_PROFILE_CONCAT_(a, b)
+
+#define PROFILE_SCOPE(name)					CGDProfileZone CGD_PROFILE_CONCAT(_profileZone, __LINE__)(name)
+#define PROFILE_COUNTER(name, value)		CGDProfiler::Counter(name, (int64_t)(value))
+#define PROFILE_THREAD_NAME(name)			CGDProfiler::SetThreadName(name)
+#define PROFILE_REPORT()					CGDProfiler::ReportTimingData()
+#define PROFILE_EXPORT_TRACE(filename)		CGDProfiler::ExportChromeTrace(filename)
+
+#else
+
+#define PROFILE_SCOPE(name)
+#define PROFILE_COUNTER(name, value)
+#define PROFILE_THREAD_NAME(name)
+#define PROFILE_REPORT()
+#define PROFILE_EXPORT_TRACE(filename)
+
+#endif
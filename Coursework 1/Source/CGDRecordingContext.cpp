@@ -0,0 +1,181 @@
+
+//
+// CGDRecordingContext.cpp
+//
+
+#include <stdafx.h>
+#include <CGDRecordingContext.h>
+#include <cstring>
+
+using namespace std;
+
+
+
+//
+// Private interface
+//
+
+// Constructor - called internally by the CreateRecordingContext factory method
+CGDRecordingContext::CGDRecordingContext() {
+
+	memset(callCounts, 0, sizeof(callCounts));
+}
+
+
+void CGDRecordingContext::record(CGDRenderCall call, uint32_t count, uint32_t instances) {
+
+	CGDRecordedCall c = { call, count, instances };
+
+	calls.push_back(c);
+	callCounts[(int)call]++;
+}
+
+
+
+//
+// Public interface
+//
+
+// Factory method
+CGDRecordingContext* CGDRecordingContext::CreateRecordingContext() {
+
+	return new CGDRecordingContext();
+}
+
+
+void CGDRecordingContext::clear() {
+
+	calls.clear();
+	memset(callCounts, 0, sizeof(callCounts));
+}
+
+
+const vector<CGDRecordedCall>& CGDRecordingContext::getCalls() const {
+
+	return calls;
+}
+
+
+uint64_t CGDRecordingContext::callCount(CGDRenderCall call) const {
+
+	return callCounts[(int)call];
+}
+
+
+uint64_t CGDRecordingContext::drawCount() const {
+
+	return callCounts[(int)CGDRenderCall::DRAW_INDEXED] + callCounts[(int)CGDRenderCall::DRAW_INDEXED_INSTANCED] + callCounts[(int)CGDRenderCall::DRAW];
+}
+
+
+uint64_t CGDRecordingContext::instanceCount() const {
+
+	uint64_t instances = 0;
+
+	for (size_t i = 0; i < calls.size(); i++)
+		instances += calls[i].instances;
+
+	return instances;
+}
+
+
+uint64_t CGDRecordingContext::stateCallCount() const {
+
+	return (uint64_t)calls.size() - drawCount();
+}
+
+
+void CGDRecordingContext::reportStats(const char *name) const {
+
+	cout << name << ": draws = " << drawCount() << ", instances = " << instanceCount() << ", state calls = " << stateCallCount() << " (constant buffers = " << callCount(CGDRenderCall::CONSTANT_BUFFERS) << ")" << endl;
+}
+
+
+void CGDRecordingContext::setInputLayout(void * /*layout*/) {
+
+	record(CGDRenderCall::INPUT_LAYOUT);
+}
+
+
+void CGDRecordingContext::setVertexBuffer(uint32_t /*slot*/, void * /*buffer*/, uint32_t /*stride*/, uint32_t /*offset*/) {
+
+	record(CGDRenderCall::VERTEX_BUFFER);
+}
+
+
+void CGDRecordingContext::setIndexBuffer(void * /*buffer*/, uint32_t /*format*/, uint32_t /*offset*/) {
+
+	record(CGDRenderCall::INDEX_BUFFER);
+}
+
+
+void CGDRecordingContext::setPrimitiveTopology(uint32_t /*topology*/) {
+
+	record(CGDRenderCall::PRIMITIVE_TOPOLOGY);
+}
+
+
+void CGDRecordingContext::setShader(CGDShaderStage /*stage*/, void * /*shader*/) {
+
+	record(CGDRenderCall::SHADER);
+}
+
+
+void CGDRecordingContext::setConstantBuffers(CGDShaderStage /*stage*/, uint32_t /*slot*/, uint32_t count, void *const * /*buffers*/) {
+
+	record(CGDRenderCall::CONSTANT_BUFFERS, count);
+}
+
+
+void CGDRecordingContext::setConstantBufferRange(CGDShaderStage /*stage*/, uint32_t /*slot*/, void * /*buffer*/, uint32_t /*firstConstant*/, uint32_t /*numConstants*/) {
+
+	record(CGDRenderCall::CONSTANT_BUFFERS, 1);
+}
+
+
+void CGDRecordingContext::setShaderResources(CGDShaderStage /*stage*/, uint32_t /*slot*/, uint32_t count, void *const * /*views*/) {
+
+	record(CGDRenderCall::SHADER_RESOURCES, count);
+}
+
+
+void CGDRecordingContext::setSamplers(CGDShaderStage /*stage*/, uint32_t /*slot*/, uint32_t count, void *const * /*samplers*/) {
+
+	record(CGDRenderCall::SAMPLERS, count);
+}
+
+
+void CGDRecordingContext::setRasterizerState(void * /*state*/) {
+
+	record(CGDRenderCall::RASTERIZER_STATE);
+}
+
+
+void CGDRecordingContext::setDepthStencilState(void * /*state*/, uint32_t /*stencilRef*/) {
+
+	record(CGDRenderCall::DEPTH_STENCIL_STATE);
+}
+
+
+void CGDRecordingContext::setBlendState(void * /*state*/, const float /*blendFactor*/[4], uint32_t /*sampleMask*/) {
+
+	record(CGDRenderCall::BLEND_STATE);
+}
+
+
+void CGDRecordingContext::drawIndexed(uint32_t indexCount, uint32_t /*startIndex*/, int32_t /*baseVertex*/) {
+
+	record(CGDRenderCall::DRAW_INDEXED, indexCount, 1);
+}
+
+
+void CGDRecordingContext::drawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t /*startIndex*/, int32_t /*baseVertex*/, uint32_t /*startInstance*/) {
+
+	record(CGDRenderCall::DRAW_INDEXED_INSTANCED, indexCount, instanceCount);
+}
+
+
+void CGDRecordingContext::draw(uint32_t vertexCount, uint32_t /*startVertex*/) {
+
+	record(CGDRenderCall::DRAW, vertexCount, 1);
+}
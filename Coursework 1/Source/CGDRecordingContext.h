@@ -0,0 +1,100 @@
+//
+// CGDRecordingContext.h
+//
+
+// CGDRenderContext that records the calls made on it instead of drawing.  Used to measure what a renderer submits without a device - eg. a render queue replayed through a CGDStateCache into a recording context shows how many draws and state calls reach the GPU driver, which is how the single instanced shell grass draw is compared with one draw per shell (see CGDShellGrass).
+
+#pragma once
+
+#include <CGDStateCache.h>
+#include <cstdint>
+#include <vector>
+
+
+// Render context calls
+enum class CGDRenderCall : uint8_t {
+
+	INPUT_LAYOUT = 0,
+	VERTEX_BUFFER,
+	INDEX_BUFFER,
+	PRIMITIVE_TOPOLOGY,
+	SHADER,
+	CONSTANT_BUFFERS,
+	SHADER_RESOURCES,
+	SAMPLERS,
+	RASTERIZER_STATE,
+	DEPTH_STENCIL_STATE,
+	BLEND_STATE,
+	DRAW_INDEXED,
+	DRAW_INDEXED_INSTANCED,
+	DRAW,
+	NUM_CALLS
+};
+
+
+// A recorded call.  count is the number of slots (ranged calls), indices or vertices (draws) and instances is the instance count of draws (1 if not instanced)
+struct CGDRecordedCall {
+
+	CGDRenderCall			call;
+	uint32_t				count;
+	uint32_t				instances;
+};
+
+
+class CGDRecordingContext : public CGDRenderContext {
+
+	std::vector<CGDRecordedCall>	calls;
+	uint64_t						callCounts[(int)CGDRenderCall::NUM_CALLS];
+
+
+	//
+	// Private interface
+	//
+
+	// Constructor - called internally by the CreateRecordingContext factory method
+	CGDRecordingContext();
+
+	void record(CGDRenderCall call, uint32_t count = 1, uint32_t instances = 0);
+
+
+public:
+
+	//
+	// Public interface
+	//
+
+	// Factory method
+	static CGDRecordingContext* CreateRecordingContext();
+
+	// Discard the recorded calls and counts
+	void clear();
+
+	// Query methods
+	const std::vector<CGDRecordedCall>& getCalls() const;
+	uint64_t callCount(CGDRenderCall call) const;
+	uint64_t drawCount() const; // draws of every kind
+	uint64_t instanceCount() const; // instances drawn (1 per draw that is not instanced)
+	uint64_t stateCallCount() const; // calls other than draws
+
+	void reportStats(const char *name) const;
+
+	// CGDRenderContext interface
+	void setInputLayout(void *layout);
+	void setVertexBuffer(uint32_t slot, void *buffer, uint32_t stride, uint32_t offset);
+	void setIndexBuffer(void *buffer, uint32_t format, uint32_t offset);
+	void setPrimitiveTopology(uint32_t topology);
+
+	void setShader(CGDShaderStage stage, void *shader);
+	void setConstantBuffers(CGDShaderStage stage, uint32_t slot, uint32_t count, void *const *buffers);
+	void setConstantBufferRange(CGDShaderStage stage, uint32_t slot, void *buffer, uint32_t firstConstant, uint32_t numConstants);
+	void setShaderResources(CGDShaderStage stage, uint32_t slot, uint32_t count, void *const *views);
+	void setSamplers(CGDShaderStage stage, uint32_t slot, uint32_t count, void *const *samplers);
+
+	void setRasterizerState(void *state);
+	void setDepthStencilState(void *state, uint32_t stencilRef);
+	void setBlendState(void *state, const float blendFactor[4], uint32_t sampleMask);
+
+	void drawIndexed(uint32_t indexCount, uint32_t startIndex, int32_t baseVertex);
+	void drawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t startIndex, int32_t baseVertex, uint32_t startInstance);
+	void draw(uint32_t vertexCount, uint32_t startVertex);
+};
@@ -0,0 +1,251 @@
+
+//
+// CGDRenderQueue.cpp
+//
+
+#include <stdafx.h>
+#include <CGDRenderQueue.h>
+#include <cstring>
+
+using namespace std;
+
+
+// Sort key field widths and positions
+static const uint32_t		layerBits = 4;
+static const uint32_t		effectBits = 12;
+static const uint32_t		materialBits = 16;
+static const uint32_t		meshBits = 16;
+static const uint32_t		depthBits = 16;
+
+static const uint32_t		depthShift = 0;
+static const uint32_t		meshShift = depthShift + depthBits;
+static const uint32_t		materialShift = meshShift + meshBits;
+static const uint32_t		effectShift = materialShift + materialBits;
+static const uint32_t		layerShift = effectShift + effectBits;
+
+
+
+//
+// Private interface
+//
+
+// Constructor - called internally by the CreateRenderQueue factory method
+CGDRenderQueue::CGDRenderQueue(size_t capacity) {
+
+	packets.reserve(capacity);
+	keys.reserve(capacity);
+	sortedKeys.reserve(capacity);
+	sortKeys.reserve(capacity);
+	order.reserve(capacity);
+	sortOrder.reserve(capacity);
+}
+
+
+// Map ptr to a small integer id.  nullptr maps to 0.  Ids above maxId wrap around (this only affects how well draws are grouped, not correctness)
+uint32_t CGDRenderQueue::MapId(unordered_map<const void*, uint32_t>& ids, const void *ptr, uint32_t maxId) {
+
+	if (!ptr)
+		return 0;
+
+	unordered_map<const void*, uint32_t>::iterator i = ids.find(ptr);
+
+	if (i != ids.end())
+		return i->second;
+
+	uint32_t id = ((uint32_t)ids.size() % maxId) + 1;
+
+	ids[ptr] = id;
+
+	return id;
+}
+
+
+
+//
+// Public interface
+//
+
+// Factory method
+CGDRenderQueue* CGDRenderQueue::CreateRenderQueue(size_t capacity) {
+
+	return new CGDRenderQueue(capacity);
+}
+
+
+uint64_t CGDRenderQueue::makeKey(uint32_t layer, const void *effect, const void *material, const void *mesh, float depth) {
+
+	uint64_t effectId = MapId(effectIds, effect, (1u << effectBits) - 1);
+	uint64_t materialId = MapId(materialIds, material, (1u << materialBits) - 1);
+	uint64_t meshId = MapId(meshIds, mesh, (1u << meshBits) - 1);
+
+	depth = (depth < 0.0f) ? 0.0f : ((depth > 1.0f) ? 1.0f : depth);
+
+	uint64_t depthId = (uint64_t)(depth * (float)((1u << depthBits) - 1));
+
+	return ((uint64_t)(layer & ((1u << layerBits) - 1)) << layerShift) | (effectId << effectShift) | (materialId << materialShift) | (meshId << meshShift) | (depthId << depthShift);
+}
+
+
+void CGDRenderQueue::submit(uint64_t key, const CGDDrawPacket& packet) {
+
+	packets.push_back(packet);
+	keys.push_back(key);
+}
+
+
+void CGDRenderQueue::sort() {
+
+	size_t n = keys.size();
+
+	sortedKeys.assign(keys.begin(), keys.end());
+	order.resize(n);
+	sortKeys.resize(n);
+	sortOrder.resize(n);
+
+	if (n == 0)
+		return;
+
+	RadixSort(sortedKeys.data(), order.data(), sortKeys.data(), sortOrder.data(), n);
+}
+
+
+void CGDRenderQueue::execute(CGDStateCache *stateCache) {
+
+	PROFILE_SCOPE("CGDRenderQueue::execute");
+
+	sort();
+
+	stateCache->invalidate();
+
+	for (size_t i = 0; i < order.size(); i++) {
+
+		const CGDDrawPacket& p = packets[order[i]];
+
+		stateCache->setShader(CGDShaderStage::VERTEX, p.vertexShader);
+		stateCache->setShader(CGDShaderStage::PIXEL, p.pixelShader);
+		stateCache->setShader(CGDShaderStage::GEOMETRY, p.geometryShader);
+		stateCache->setInputLayout(p.inputLayout);
+
+		stateCache->setRasterizerState(p.rasterizerState);
+		stateCache->setDepthStencilState(p.depthStencilState, 0);
+		stateCache->setBlendState(p.blendState, p.blendFactor, p.sampleMask);
+
+		if (p.constants.numConstants > 0) {
+
+			stateCache->setConstantBufferRange(CGDShaderStage::VERTEX, 0, p.constants.buffer, p.constants.firstConstant, p.constants.numConstants);
+			stateCache->setConstantBufferRange(CGDShaderStage::PIXEL, 0, p.constants.buffer, p.constants.firstConstant, p.constants.numConstants);
+
+		} else {
+
+			stateCache->setConstantBuffers(CGDShaderStage::VERTEX, 0, 1, &p.constants.buffer);
+			stateCache->setConstantBuffers(CGDShaderStage::PIXEL, 0, 1, &p.constants.buffer);
+		}
+
+		if (p.numShaderResources > 0)
+			stateCache->setShaderResources(CGDShaderStage::PIXEL, 0, p.numShaderResources, p.shaderResources);
+
+		if (p.sampler)
+			stateCache->setSamplers(CGDShaderStage::PIXEL, 0, 1, &p.sampler);
+
+		if (p.numVertexShaderResources > 0) {
+
+			stateCache->setShaderResources(CGDShaderStage::VERTEX, 0, p.numVertexShaderResources, p.vertexShaderResources);
+
+			if (p.sampler)
+				stateCache->setSamplers(CGDShaderStage::VERTEX, 0, 1, &p.sampler);
+		}
+
+		stateCache->setVertexBuffer(0, p.vertexBuffer, p.vertexStride, 0);
+		stateCache->setIndexBuffer(p.indexBuffer, p.indexFormat, 0);
+		stateCache->setPrimitiveTopology(p.topology);
+
+		if (p.instanceCount > 0)
+			stateCache->drawIndexedInstanced(p.indexCount, p.instanceCount, p.startIndex, p.baseVertex, 0);
+		else
+			stateCache->drawIndexed(p.indexCount, p.startIndex, p.baseVertex);
+	}
+
+	clear();
+}
+
+
+void CGDRenderQueue::clear() {
+
+	packets.clear();
+	keys.clear();
+	order.clear();
+}
+
+
+size_t CGDRenderQueue::size() const {
+
+	return packets.size();
+}
+
+
+const CGDDrawPacket& CGDRenderQueue::getPacket(size_t i) const {
+
+	return packets[order[i]];
+}
+
+
+void CGDRenderQueue::RadixSort(uint64_t *keys, uint32_t *order, uint64_t *tmpKeys, uint32_t *tmpOrder, size_t n) {
+
+	if (n == 0)
+		return;
+
+	// Digit histograms for all 8 byte passes are built in a single pass over the keys
+	uint32_t counts[8][256];
+
+	memset(counts, 0, sizeof(counts));
+
+	for (size_t i = 0; i < n; i++) {
+
+		uint64_t k = keys[i];
+
+		for (int d = 0; d < 8; d++)
+			counts[d][(k >> (d * 8)) & 0xFF]++;
+
+		order[i] = (uint32_t)i;
+	}
+
+	uint64_t *srcKeys = keys, *dstKeys = tmpKeys;
+	uint32_t *srcOrder = order, *dstOrder = tmpOrder;
+
+	for (int d = 0; d < 8; d++) {
+
+		uint32_t *count = counts[d];
+
+		// Skip the pass if every key has the same digit
+		if (count[(srcKeys[0] >> (d * 8)) & 0xFF] == (uint32_t)n)
+			continue;
+
+		uint32_t offset = 0;
+
+		for (int b = 0; b < 256; b++) {
+
+			uint32_t c = count[b];
+
+			count[b] = offset;
+			offset += c;
+		}
+
+		for (size_t i = 0; i < n; i++) {
+
+			uint32_t j = count[(srcKeys[i] >> (d * 8)) & 0xFF]++;
+
+			dstKeys[j] = srcKeys[i];
+			dstOrder[j] = srcOrder[i];
+		}
+
+		swap(srcKeys, dstKeys);
+		swap(srcOrder, dstOrder);
+	}
+
+	// Results are in the scratch buffers after an odd number of passes
+	if (srcKeys != keys) {
+
+		memcpy(keys, srcKeys, n * sizeof(uint64_t));
+		memcpy(order, srcOrder, n * sizeof(uint32_t));
+	}
+}
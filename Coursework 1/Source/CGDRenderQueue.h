@@ -0,0 +1,136 @@
+//
+// CGDRenderQueue.h
+//
+
+// Sorted draw submission.  Rather than binding state and drawing immediately, objects submit a CGDDrawPacket describing everything needed for the draw together with a 64 bit sort key.  execute sorts the packets on their keys with an LSD radix sort and replays them through a CGDStateCache so consecutive draws that share an effect, textures or mesh only issue the state that actually changes.
+//
+// Sort key layout (most significant first)...
+//
+//	layer		4 bits		explicit ordering between groups of draws (eg. opaque before transparent)
+//	effect		12 bits		effect (shaders, input layout and pipeline state)
+//	material	16 bits		texture set
+//	mesh		16 bits		vertex / index buffers
+//	depth		16 bits		normalised view depth, nearest first
+//
+// Effects, materials and meshes are mapped to small integer ids by makeKey in first-use order.  Ids persist for the lifetime of the queue so the order is stable from frame to frame.  The radix sort is stable so packets with equal keys are replayed in submission order.  Packet storage is retained between frames so the steady state makes no heap allocations.
+
+#pragma once
+
+#include <GUObject.h>
+#include <CGDStateCache.h>
+#include <cstdint>
+#include <vector>
+#include <unordered_map>
+
+
+// Maximum number of pixel and vertex shader resource views bound by a packet
+#define CGD_MAX_PACKET_SHADER_RESOURCES			8
+#define CGD_MAX_PACKET_VERTEX_SHADER_RESOURCES	2
+
+
+// Constant buffer binding - a whole buffer (numConstants = 0) or numConstants 16 byte constants from firstConstant (see CGDConstantBuffers)
+struct CGDConstantBinding {
+
+	void					*buffer;
+	uint32_t				firstConstant;
+	uint32_t				numConstants;
+};
+
+
+// Complete description of a single draw.  Handles are opaque pipeline objects (see CGDRenderContext)
+struct CGDDrawPacket {
+
+	// Pipeline
+	void					*vertexShader;
+	void					*pixelShader;
+	void					*geometryShader;
+	void					*inputLayout;
+	void					*rasterizerState;
+	void					*depthStencilState;
+	void					*blendState;
+	float					blendFactor[4];
+	uint32_t				sampleMask;
+
+	// Constants bound to slot 0 of the vertex and pixel shader stages
+	CGDConstantBinding		constants;
+
+	// Pixel shader resources bound from slot 0 and the sampler bound to slot 0
+	void					*shaderResources[CGD_MAX_PACKET_SHADER_RESOURCES];
+	uint32_t				numShaderResources;
+	void					*sampler;
+
+	// Vertex shader resources bound from slot 0 (eg. displacement maps).  If there are any the sampler is also bound to vertex shader slot 0
+	void					*vertexShaderResources[CGD_MAX_PACKET_VERTEX_SHADER_RESOURCES];
+	uint32_t				numVertexShaderResources;
+
+	// Geometry
+	void					*vertexBuffer;
+	uint32_t				vertexStride;
+	void					*indexBuffer;
+	uint32_t				indexFormat;
+	uint32_t				topology;
+	uint32_t				indexCount;
+	uint32_t				startIndex;
+	int32_t					baseVertex;
+	uint32_t				instanceCount; // 0 = not instanced (DrawIndexed), otherwise DrawIndexedInstanced from instance 0
+};
+
+
+class CGDRenderQueue : public GUObject {
+
+	std::vector<CGDDrawPacket>							packets;
+	std::vector<uint64_t>								keys;
+
+	// Radix sort buffers.  keys are copied to sortedKeys so sort can be called more than once (and submit called between sorts)
+	std::vector<uint64_t>								sortedKeys;
+	std::vector<uint64_t>								sortKeys;
+	std::vector<uint32_t>								order;
+	std::vector<uint32_t>								sortOrder;
+
+	// Sort key ids
+	std::unordered_map<const void*, uint32_t>			effectIds;
+	std::unordered_map<const void*, uint32_t>			materialIds;
+	std::unordered_map<const void*, uint32_t>			meshIds;
+
+
+	//
+	// Private interface
+	//
+
+	// Constructor - called internally by the CreateRenderQueue factory method
+	CGDRenderQueue(size_t capacity);
+
+	static uint32_t MapId(std::unordered_map<const void*, uint32_t>& ids, const void *ptr, uint32_t maxId);
+
+
+public:
+
+	//
+	// Public interface
+	//
+
+	// Factory method.  Storage for capacity packets is reserved up front
+	static CGDRenderQueue* CreateRenderQueue(size_t capacity = 256);
+
+	// Return the sort key for a draw.  effect, material and mesh identify the draw's state groups (any pointer that is the same for draws that share the group - nullptr is allowed).  depth is the normalised view depth [0, 1]
+	uint64_t makeKey(uint32_t layer, const void *effect, const void *material, const void *mesh, float depth);
+
+	// Queue a draw
+	void submit(uint64_t key, const CGDDrawPacket& packet);
+
+	// Sort the queued draws
+	void sort();
+
+	// Sort the queued draws, replay them through stateCache and clear the queue.  stateCache is invalidated first since the context may have been used directly since the last execute
+	void execute(CGDStateCache *stateCache);
+
+	// Discard the queued draws
+	void clear();
+
+	// Query methods
+	size_t size() const;
+	const CGDDrawPacket& getPacket(size_t i) const; // i-th packet in sorted order (valid after sort)
+
+	// Stable LSD radix sort of n 64 bit keys.  On return keys are in ascending order and order[i] holds the original index of the i-th key.  tmpKeys and tmpOrder are scratch buffers of n elements.  Byte passes where every key has the same digit are skipped
+	static void RadixSort(uint64_t *keys, uint32_t *order, uint64_t *tmpKeys, uint32_t *tmpOrder, size_t n);
+};
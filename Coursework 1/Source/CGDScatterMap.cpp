@@ -0,0 +1,100 @@
+
+//
+// CGDScatterMap.cpp
+//
+
+#include <stdafx.h>
+#include <CGDScatterMap.h>
+#include <GUImageDecoder.h>
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+
+
+//
+// Private interface
+//
+
+// Constructor - called internally by the CreateScatterMap and LoadScatterMap factory methods
+CGDScatterMap::CGDScatterMap(uint32_t _width, uint32_t _height, const float *_values) {
+
+	width = _width;
+	height = _height;
+	values.assign(_values, _values + (size_t)width * height);
+}
+
+
+
+//
+// Public interface
+//
+
+// Factory methods
+CGDScatterMap* CGDScatterMap::CreateScatterMap(uint32_t width, uint32_t height, const float *values) {
+
+	if (width == 0 || height == 0 || !values)
+		return nullptr;
+
+	return new CGDScatterMap(width, height, values);
+}
+
+
+CGDScatterMap* CGDScatterMap::LoadScatterMap(const string& filename, float scale) {
+
+	uint32_t width, height;
+	vector<uint8_t> rgba;
+
+	if (!gu_image_read_rgba(filename.c_str(), width, height, rgba) || width == 0 || height == 0)
+		return nullptr;
+
+	vector<float> values((size_t)width * height);
+
+	for (size_t i = 0; i < values.size(); i++)
+		values[i] = (float)rgba[i * 4] / 255.0f * scale;
+
+	return new CGDScatterMap(width, height, values.data());
+}
+
+
+float CGDScatterMap::sample(float u, float v) const {
+
+	float x = min(max(u, 0.0f), 1.0f) * (float)(width - 1);
+	float y = min(max(v, 0.0f), 1.0f) * (float)(height - 1);
+
+	uint32_t x0 = min((uint32_t)x, width - 1), y0 = min((uint32_t)y, height - 1);
+	uint32_t x1 = min(x0 + 1, width - 1), y1 = min(y0 + 1, height - 1);
+	float fx = x - (float)x0, fy = y - (float)y0;
+
+	const float *row0 = &values[(size_t)y0 * width];
+	const float *row1 = &values[(size_t)y1 * width];
+
+	float top = row0[x0] + (row0[x1] - row0[x0]) * fx;
+	float bottom = row1[x0] + (row1[x1] - row1[x0]) * fx;
+
+	return top + (bottom - top) * fy;
+}
+
+
+float CGDScatterMap::mean() const {
+
+	double sum = 0.0;
+
+	for (size_t i = 0; i < values.size(); i++)
+		sum += values[i];
+
+	return (float)(sum / (double)values.size());
+}
+
+
+uint32_t CGDScatterMap::getWidth() const {
+
+	return width;
+}
+
+
+uint32_t CGDScatterMap::getHeight() const {
+
+	return height;
+}
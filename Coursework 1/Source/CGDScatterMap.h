@@ -0,0 +1,48 @@
+//
+// CGDScatterMap.h
+//
+
+// Single channel map of floats sampled over normalised coordinates (u, v) in [0, 1] - the density and height maps of foliage scattering (see CGDFoliageScatter).  Maps are built from values computed by the caller or loaded from the red channel of an image (decoded with GUImageDecoder so maps can be read without a device).  A height map loaded with scale 5 gives the same heights as Terrain, and createHeightMap copies the heights of an existing Terrain.
+
+#pragma once
+
+#include <GUObject.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+class CGDScatterMap : public GUObject {
+
+	uint32_t					width = 0;
+	uint32_t					height = 0;
+	std::vector<float>			values; // width * height, row major (v = 0 is the first row)
+
+
+	//
+	// Private interface
+	//
+
+	// Constructor - called internally by the CreateScatterMap and LoadScatterMap factory methods
+	CGDScatterMap(uint32_t width, uint32_t height, const float *values);
+
+
+public:
+
+	//
+	// Public interface
+	//
+
+	// Factory methods.  CreateScatterMap copies width * height values.  LoadScatterMap scales the red channel of an image to [0, scale] and returns nullptr if the image cannot be read
+	static CGDScatterMap* CreateScatterMap(uint32_t width, uint32_t height, const float *values);
+	static CGDScatterMap* LoadScatterMap(const std::string& filename, float scale = 1.0f);
+
+	// Bilinear sample at (u, v).  Coordinates outside [0, 1] are clamped to the edge
+	float sample(float u, float v) const;
+
+	// Mean of the values
+	float mean() const;
+
+	uint32_t getWidth() const;
+	uint32_t getHeight() const;
+};
@@ -0,0 +1,154 @@
+
+//
+// CGDShellGrass.cpp
+//
+
+#include <stdafx.h>
+#include <CGDShellGrass.h>
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+
+
+//
+// Private interface
+//
+
+// Constructor - called internally by the CreateShellGrass factory method
+CGDShellGrass::CGDShellGrass(const CGDShellGrassDesc& _desc) {
+
+	desc = _desc;
+	desc.minShells = min(desc.minShells, desc.maxShells);
+	desc.lodFar = max(desc.lodFar, desc.lodNear);
+}
+
+
+
+//
+// Public interface
+//
+
+// Factory method
+CGDShellGrass* CGDShellGrass::CreateShellGrass(const CGDShellGrassDesc& desc) {
+
+	return new CGDShellGrass(desc);
+}
+
+
+void CGDShellGrass::FrustumPlanes(const float viewProj[16], float planes[6][4]) {
+
+	// Clip space coordinate c of a point is the dot product of the point with column c of the matrix
+	for (int i = 0; i < 4; i++) {
+
+		float x = viewProj[i * 4], y = viewProj[i * 4 + 1], z = viewProj[i * 4 + 2], w = viewProj[i * 4 + 3];
+
+		planes[0][i] = w + x; // left
+		planes[1][i] = w - x; // right
+		planes[2][i] = w + y; // bottom
+		planes[3][i] = w - y; // top
+		planes[4][i] = z; // near
+		planes[5][i] = w - z; // far
+	}
+}
+
+
+bool CGDShellGrass::BoxInFrustum(const float planes[6][4], const float boxMin[3], const float boxMax[3]) {
+
+	for (int i = 0; i < 6; i++) {
+
+		// Corner of the box furthest along the plane normal - if it is outside the whole box is
+		float x = (planes[i][0] >= 0.0f) ? boxMax[0] : boxMin[0];
+		float y = (planes[i][1] >= 0.0f) ? boxMax[1] : boxMin[1];
+		float z = (planes[i][2] >= 0.0f) ? boxMax[2] : boxMin[2];
+
+		if (planes[i][0] * x + planes[i][1] * y + planes[i][2] * z + planes[i][3] < 0.0f)
+			return false;
+	}
+
+	return true;
+}
+
+
+uint32_t CGDShellGrass::shellsForDistance(float d) const {
+
+	if (d >= desc.cullDistance)
+		return 0;
+
+	if (d <= desc.lodNear)
+		return desc.maxShells;
+
+	if (d >= desc.lodFar)
+		return desc.minShells;
+
+	float t = (d - desc.lodNear) / (desc.lodFar - desc.lodNear);
+
+	return (uint32_t)floorf((float)desc.maxShells + ((float)desc.minShells - (float)desc.maxShells) * t + 0.5f);
+}
+
+
+float CGDShellGrass::distance(const float eye[3]) const {
+
+	float d2 = 0.0f;
+
+	for (int i = 0; i < 3; i++) {
+
+		float d = max(max(desc.bounds[0][i] - eye[i], eye[i] - desc.bounds[1][i]), 0.0f);
+
+		d2 += d * d;
+	}
+
+	return sqrtf(d2);
+}
+
+
+CGDShellRange CGDShellGrass::visibleShells(const float eye[3], const float viewProj[16]) const {
+
+	CGDShellRange range;
+
+	range.shellCount = shellsForDistance(distance(eye));
+
+	if (range.shellCount == 0)
+		return range;
+
+	// Shells are front facing only while the camera is above them (shell s is s * spacing above the lowest ground)
+	float spacing = desc.height / (float)range.shellCount;
+	float above = (eye[1] - desc.bounds[0][1]) / spacing;
+	uint32_t facing = (above <= 0.0f) ? 0 : (uint32_t)min((float)range.shellCount, ceilf(above) - 1.0f);
+
+	float planes[6][4];
+
+	FrustumPlanes(viewProj, planes);
+
+	uint32_t first = 0, last = 0;
+
+	for (uint32_t s = 1; s <= facing; s++) {
+
+		float offset = spacing * (float)s;
+		float boxMin[3] = { desc.bounds[0][0] - desc.sway, desc.bounds[0][1] + offset, desc.bounds[0][2] - desc.sway };
+		float boxMax[3] = { desc.bounds[1][0] + desc.sway, desc.bounds[1][1] + offset, desc.bounds[1][2] + desc.sway };
+
+		if (BoxInFrustum(planes, boxMin, boxMax)) {
+
+			if (first == 0)
+				first = s;
+
+			last = s;
+		}
+	}
+
+	if (first > 0) {
+
+		range.firstShell = first;
+		range.instanceCount = last - first + 1;
+	}
+
+	return range;
+}
+
+
+const CGDShellGrassDesc& CGDShellGrass::getDesc() const {
+
+	return desc;
+}
@@ -0,0 +1,75 @@
+//
+// CGDShellGrass.h
+//
+
+// Shell (fur) grass visibility.  Grass is drawn as a stack of shells - copies of the ground mesh raised in even steps up to the grass height, where the pixel shader keeps only the texels of each shell that fall inside a blade - in a single instanced draw: instance i is shell firstShell + i and the shader computes the shell's height and wind sway from the shell index (see grass_vs.hlsl), so no per-shell constant buffer update or draw is needed.
+//
+// visibleShells decides which shells a view draws.  The number of shells the grass height is divided into falls with the distance from the camera to the grass (distant grass is a few pixels high, so fewer shells look the same), shells at or above the camera only show their back faces and are skipped, and the remaining shells are culled against the view frustum.  Shells are stacked vertically so the visible shells are always a contiguous range, which is drawn as instances [0, instanceCount) with firstShell passed in the constant buffer (SV_InstanceID does not include the start instance).
+
+#pragma once
+
+#include <GUObject.h>
+#include <cstdint>
+
+
+struct CGDShellGrassDesc {
+
+	float					bounds[2][3]; // world space box (min, max) of the ground the shells cover
+	float					height = 0.2f; // of the top shell above the ground
+	float					sway = 0.05f; // maximum horizontal wind displacement of the top shell
+	uint32_t				maxShells = 40;
+	uint32_t				minShells = 8;
+	float					lodNear = 10.0f; // maxShells up to this distance from the grass
+	float					lodFar = 80.0f; // minShells from this distance
+	float					cullDistance = 200.0f; // no shells are drawn beyond this distance
+};
+
+
+// Shells drawn for a view.  Shell 0 is the ground itself (drawn separately) so shells are numbered 1 .. shellCount
+struct CGDShellRange {
+
+	uint32_t				shellCount = 0; // shells the grass height is divided into (distance LOD)
+	uint32_t				firstShell = 0; // first visible shell
+	uint32_t				instanceCount = 0; // visible shells from firstShell (0 = nothing to draw)
+};
+
+
+class CGDShellGrass : public GUObject {
+
+	CGDShellGrassDesc				desc;
+
+
+	//
+	// Private interface
+	//
+
+	// Constructor - called internally by the CreateShellGrass factory method
+	CGDShellGrass(const CGDShellGrassDesc& desc);
+
+
+public:
+
+	//
+	// Public interface
+	//
+
+	// Factory method
+	static CGDShellGrass* CreateShellGrass(const CGDShellGrassDesc& desc);
+
+	// Extract the frustum planes (ax + by + cz + d >= 0 inside) from a row-major world to clip space matrix (row vectors, D3D clip space 0 <= z <= w)
+	static void FrustumPlanes(const float viewProj[16], float planes[6][4]);
+
+	// Return true if the box [boxMin, boxMax] is at least partly inside the frustum planes
+	static bool BoxInFrustum(const float planes[6][4], const float boxMin[3], const float boxMax[3]);
+
+	// Shell count for a camera distance from the grass (0 beyond cullDistance)
+	uint32_t shellsForDistance(float distance) const;
+
+	// Distance from eye to the nearest point of the grass bounds
+	float distance(const float eye[3]) const;
+
+	// Shells to draw from eye with the given world to clip space matrix (see FrustumPlanes)
+	CGDShellRange visibleShells(const float eye[3], const float viewProj[16]) const;
+
+	const CGDShellGrassDesc& getDesc() const;
+};
@@ -0,0 +1,139 @@
+
+//
+// CGDSimulation.cpp
+//
+
+#include <stdafx.h>
+#include <CGDSimulation.h>
+#include <GUMemoryArena.h>
+
+using namespace std;
+
+
+
+//
+// Private interface
+//
+
+// Constructor - called internally by the CreateSimulation factory method
+CGDSimulation::CGDSimulation(CGDTimeSource *_timeSource, CGDFixedStepLoop *_loop, const CGDStepFunction& _stepFunction) : running(false), steps(0), clampedUpdates(0) {
+
+	timeSource = _timeSource;
+	timeSource->retain();
+
+	loop = _loop;
+	stepFunction = _stepFunction;
+
+	lastTime = timeSource->now();
+}
+
+
+void CGDSimulation::step() {
+
+	PROFILE_SCOPE("simulationStep");
+
+	gu_seconds currentTime = timeSource->now();
+
+	loop->advance(currentTime - lastTime, stepFunction);
+	lastTime = currentTime;
+
+	steps.store(loop->stepCount(), memory_order_relaxed);
+	clampedUpdates.store(loop->clampedAdvanceCount(), memory_order_relaxed);
+}
+
+
+void CGDSimulation::threadMain() {
+
+	PROFILE_THREAD_NAME("Simulation");
+
+	while (running.load(memory_order_acquire)) {
+
+		step();
+
+		// Sleep until the accumulator will hold a whole step
+		timeSource->waitUntil(lastTime + (loop->getStepSize() - loop->accumulatedTime()));
+	}
+
+	GUMemoryArena::ReleaseThreadScratch();
+}
+
+
+
+//
+// Public interface
+//
+
+// Factory method
+CGDSimulation* CGDSimulation::CreateSimulation(CGDTimeSource *timeSource, gu_seconds stepSize, const CGDStepFunction& stepFunction, bool threaded, uint32_t maxStepsPerUpdate) {
+
+	if (!timeSource)
+		return nullptr;
+
+	CGDFixedStepLoop *loop = CGDFixedStepLoop::CreateFixedStepLoop(stepSize, maxStepsPerUpdate);
+
+	if (!loop)
+		return nullptr;
+
+	CGDSimulation *simulation = new CGDSimulation(timeSource, loop, stepFunction);
+
+	if (threaded) {
+
+		simulation->threaded = true;
+		simulation->running = true;
+		simulation->thread = std::thread(&CGDSimulation::threadMain, simulation);
+	}
+
+	return simulation;
+}
+
+
+// Destructor
+CGDSimulation::~CGDSimulation() {
+
+	if (threaded) {
+
+		running.store(false, memory_order_release);
+		timeSource->interrupt();
+		thread.join();
+	}
+
+	loop->release();
+	timeSource->release();
+}
+
+
+void CGDSimulation::update() {
+
+	if (!threaded)
+		step();
+}
+
+
+bool CGDSimulation::isThreaded() const {
+
+	return threaded;
+}
+
+
+gu_seconds CGDSimulation::getStepSize() const {
+
+	return loop->getStepSize();
+}
+
+
+uint64_t CGDSimulation::stepCount() const {
+
+	return steps.load(memory_order_relaxed);
+}
+
+
+uint64_t CGDSimulation::clampedUpdateCount() const {
+
+	return clampedUpdates.load(memory_order_relaxed);
+}
+
+
+void CGDSimulation::reportStats() const {
+
+	cout << "Simulation (" << ((threaded) ? "own thread" : "inline") << ", " << (1.0 / loop->getStepSize()) << " Hz): " << stepCount() << " steps, " << clampedUpdateCount() << " updates clamped to the step limit" << endl;
+}
@@ -0,0 +1,69 @@
+//
+// CGDSimulation.h
+//
+
+// Runs a CGDFixedStepLoop against a CGDTimeSource.  The simulation either runs inline - update, called once per frame by the rendering thread, runs the steps due since the last update - or on its own thread, which runs steps as the time source reaches them and sleeps in between so rendering and simulation proceed independently.  Either way the step function is only ever called on one thread, and it hands its results to rendering through a CGDTripleBuffer (publish a snapshot holding the previous and new state each step, acquire the latest snapshot once per frame and interpolate between its two states with CGDFixedStepLoop::InterpolationAlpha).
+//
+// With a CGDVirtualClock as the time source the steps taken depend only on how the clock is advanced, so a simulation can be run headless and deterministically (eg. advance by fixed frame times in a test).
+
+#pragma once
+
+#include <GUObject.h>
+#include <CGDFixedStepLoop.h>
+#include <CGDTimeSource.h>
+#include <atomic>
+#include <thread>
+
+
+class CGDSimulation : public GUObject {
+
+	CGDTimeSource					*timeSource = nullptr;
+	CGDFixedStepLoop				*loop = nullptr;
+	CGDStepFunction					stepFunction;
+	gu_seconds						lastTime = 0.0; // time source time the loop was last advanced to
+
+	bool							threaded = false;
+	std::thread						thread;
+	std::atomic<bool>				running;
+
+	// Statistics mirrored from the loop so they can be read while the simulation thread runs
+	std::atomic<uint64_t>			steps;
+	std::atomic<uint64_t>			clampedUpdates;
+
+
+	//
+	// Private interface
+	//
+
+	// Constructor - called internally by the CreateSimulation factory method
+	CGDSimulation(CGDTimeSource *timeSource, CGDFixedStepLoop *loop, const CGDStepFunction& stepFunction);
+
+	// Advance the loop to the time source's current time
+	void step();
+
+	void threadMain();
+
+
+public:
+
+	//
+	// Public interface
+	//
+
+	// Factory method.  Step stepFunction every stepSize seconds of timeSource time, running at most maxStepsPerUpdate steps at once (see CGDFixedStepLoop).  If threaded is true the steps run on a new thread, otherwise in update.  The simulation retains timeSource.  Return nullptr if timeSource is nullptr or stepSize <= 0
+	static CGDSimulation* CreateSimulation(CGDTimeSource *timeSource, gu_seconds stepSize, const CGDStepFunction& stepFunction, bool threaded, uint32_t maxStepsPerUpdate = 8);
+
+	// Destructor.  Stops the simulation thread (interrupting the time source)
+	~CGDSimulation();
+
+	// Run the steps due since the last update on the calling thread.  Does nothing if the simulation is threaded
+	void update();
+
+	// Query methods
+	bool isThreaded() const;
+	gu_seconds getStepSize() const;
+	uint64_t stepCount() const;
+	uint64_t clampedUpdateCount() const; // updates that dropped time to stay within maxStepsPerUpdate
+
+	void reportStats() const;
+};
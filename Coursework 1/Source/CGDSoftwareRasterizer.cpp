@@ -0,0 +1,584 @@
+
+//
+// CGDSoftwareRasterizer.cpp
+//
+
+#include <stdafx.h>
+#include <CGDSoftwareRasterizer.h>
+#include <CGDSoftwareTexture.h>
+#include <CGDJobSystem.h>
+#include <GUPNGWriter.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using namespace std;
+
+
+// Edge function of the directed edge (a, b) - twice the signed area of (a, b, p)
+static inline void edgeFunction(const float a[2], const float b[2], float edge[3]) {
+
+	edge[0] = a[1] - b[1];
+	edge[1] = b[0] - a[0];
+	edge[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+
+// Pack 4 pixels of r, g, b, a in [0, 1] into R8G8B8A8
+static inline __m128i packColour(const __m128 colour[4]) {
+
+	__m128 zero = _mm_setzero_ps();
+	__m128 one = _mm_set1_ps(1.0f);
+	__m128 scale = _mm_set1_ps(255.0f);
+	__m128 half = _mm_set1_ps(0.5f);
+
+	__m128i c[4];
+
+	for (int i = 0; i < 4; i++)
+		c[i] = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(_mm_min_ps(_mm_max_ps(colour[i], zero), one), scale), half));
+
+	return _mm_or_si128(_mm_or_si128(c[0], _mm_slli_epi32(c[1], 8)), _mm_or_si128(_mm_slli_epi32(c[2], 16), _mm_slli_epi32(c[3], 24)));
+}
+
+
+
+//
+// Private interface
+//
+
+// Constructor - called internally by the CreateSoftwareRasterizer factory method
+CGDSoftwareRasterizer::CGDSoftwareRasterizer(uint32_t _width, uint32_t _height, CGDJobSystem *_jobSystem) : pixelsShaded(0) {
+
+	width = _width;
+	height = _height;
+	stride = (width + 3) & ~3;
+	tilesX = (width + tileSize - 1) / tileSize;
+	tilesY = (height + tileSize - 1) / tileSize;
+
+	colourBuffer.assign((size_t)stride * height, 0);
+	depthBuffer.assign((size_t)stride * height, 1.0f);
+	bins.resize(tilesX * tilesY);
+
+	jobSystem = _jobSystem;
+
+	if (jobSystem)
+		jobSystem->retain();
+}
+
+
+uint32_t CGDSoftwareRasterizer::setupTriangle(const CGDSoftwareVSOutput& a, const CGDSoftwareVSOutput& b, const CGDSoftwareVSOutput& c, uint32_t draw, Triangle *output) {
+
+	const CGDSoftwareVSOutput *v[3] = { &a, &b, &c };
+
+	// Trivially reject triangles entirely outside one of the x, y or far planes
+	bool outside[5] = { true, true, true, true, true };
+
+	for (int i = 0; i < 3; i++) {
+
+		const float *p = v[i]->posH;
+
+		outside[0] = outside[0] && (p[0] < -p[3]);
+		outside[1] = outside[1] && (p[0] > p[3]);
+		outside[2] = outside[2] && (p[1] < -p[3]);
+		outside[3] = outside[3] && (p[1] > p[3]);
+		outside[4] = outside[4] && (p[2] > p[3]);
+	}
+
+	for (int i = 0; i < 5; i++)
+		if (outside[i])
+			return 0;
+
+	// Near plane (z >= 0 in D3D clip space)
+	int numInside = 0;
+
+	for (int i = 0; i < 3; i++)
+		numInside += (v[i]->posH[2] >= 0.0f) ? 1 : 0;
+
+	if (numInside == 3)
+		return (setupClippedTriangle(a, b, c, draw, output[0])) ? 1 : 0;
+
+	if (numInside == 0)
+		return 0;
+
+	// Sutherland-Hodgman against z = 0 - a triangle becomes a triangle or a quad (preserving the winding order)
+	CGDSoftwareVSOutput polygon[4];
+	int n = 0;
+
+	for (int i = 0; i < 3; i++) {
+
+		const CGDSoftwareVSOutput& p = *v[i];
+		const CGDSoftwareVSOutput& q = *v[(i + 1) % 3];
+
+		bool pIn = (p.posH[2] >= 0.0f);
+		bool qIn = (q.posH[2] >= 0.0f);
+
+		if (pIn)
+			polygon[n++] = p;
+
+		if (pIn != qIn) {
+
+			float t = p.posH[2] / (p.posH[2] - q.posH[2]);
+			CGDSoftwareVSOutput& r = polygon[n++];
+
+			for (int k = 0; k < 4; k++)
+				r.posH[k] = p.posH[k] + (q.posH[k] - p.posH[k]) * t;
+
+			for (int k = 0; k < CGD_SOFTWARE_VARYINGS; k++)
+				r.varyings[k] = p.varyings[k] + (q.varyings[k] - p.varyings[k]) * t;
+		}
+	}
+
+	uint32_t count = 0;
+
+	for (int i = 1; i + 1 < n; i++)
+		if (setupClippedTriangle(polygon[0], polygon[i], polygon[i + 1], draw, output[count]))
+			count++;
+
+	return count | clippedFlag;
+}
+
+
+bool CGDSoftwareRasterizer::setupClippedTriangle(const CGDSoftwareVSOutput& a, const CGDSoftwareVSOutput& b, const CGDSoftwareVSOutput& c, uint32_t draw, Triangle& output) {
+
+	const CGDSoftwareVSOutput *v[3] = { &a, &b, &c };
+
+	float screen[3][2], z[3], oneOverW[3];
+
+	for (int i = 0; i < 3; i++) {
+
+		const float *p = v[i]->posH;
+
+		if (p[3] <= 0.0f)
+			return false;
+
+		oneOverW[i] = 1.0f / p[3];
+		screen[i][0] = (p[0] * oneOverW[i] * 0.5f + 0.5f) * (float)width;
+		screen[i][1] = (0.5f - p[1] * oneOverW[i] * 0.5f) * (float)height;
+		z[i] = p[2] * oneOverW[i];
+	}
+
+	// Edge i is opposite vertex i.  Shared edges get exactly negated coefficients so adjacent triangles are watertight
+	edgeFunction(screen[1], screen[2], output.edge[0]);
+	edgeFunction(screen[2], screen[0], output.edge[1]);
+	edgeFunction(screen[0], screen[1], output.edge[2]);
+
+	// Twice the signed area from vertex-relative deltas (edge 0 at vertex 0 gives the same value but loses precision to the large constant term)
+	float dx1 = screen[1][0] - screen[0][0], dy1 = screen[1][1] - screen[0][1];
+	float dx2 = screen[2][0] - screen[0][0], dy2 = screen[2][1] - screen[0][1];
+	float signedArea = dx1 * dy2 - dx2 * dy1;
+
+	if (signedArea == 0.0f || signedArea != signedArea)
+		return false;
+
+	// No culling - flip clockwise triangles so the inside is positive for both windings
+	if (signedArea < 0.0f) {
+
+		for (int i = 0; i < 3; i++)
+			for (int k = 0; k < 3; k++)
+				output.edge[i][k] = -output.edge[i][k];
+	}
+
+	// Top-left rule - the inward normal (A, B) of a left edge points right, of a top edge down
+	for (int i = 0; i < 3; i++)
+		output.includeZero[i] = (output.edge[i][0] > 0.0f) || (output.edge[i][0] == 0.0f && output.edge[i][1] > 0.0f);
+
+	float minX = min(screen[0][0], min(screen[1][0], screen[2][0]));
+	float maxX = max(screen[0][0], max(screen[1][0], screen[2][0]));
+	float minY = min(screen[0][1], min(screen[1][1], screen[2][1]));
+	float maxY = max(screen[0][1], max(screen[1][1], screen[2][1]));
+
+	output.minX = max(0, (int32_t)floor(minX));
+	output.minY = max(0, (int32_t)floor(minY));
+	output.maxX = min((int32_t)width - 1, (int32_t)ceil(maxX));
+	output.maxY = min((int32_t)height - 1, (int32_t)ceil(maxY));
+
+	if (output.minX > output.maxX || output.minY > output.maxY)
+		return false;
+
+	// Attribute planes f(p) = A * x + B * y + C from the gradients across the triangle, relative to vertex 0 so C is not the difference of large terms
+	float invArea = 1.0f / signedArea;
+	float x0 = screen[0][0], y0 = screen[0][1];
+
+	auto setupPlane = [&](float f0, float f1, float f2, float plane[3]) {
+
+		plane[0] = ((f1 - f0) * dy2 - (f2 - f0) * dy1) * invArea;
+		plane[1] = ((f2 - f0) * dx1 - (f1 - f0) * dx2) * invArea;
+		plane[2] = f0 - plane[0] * x0 - plane[1] * y0;
+	};
+
+	setupPlane(z[0], z[1], z[2], output.z);
+	setupPlane(oneOverW[0], oneOverW[1], oneOverW[2], output.oneOverW);
+
+	for (int j = 0; j < CGD_SOFTWARE_VARYINGS; j++)
+		setupPlane(a.varyings[j] * oneOverW[0], b.varyings[j] * oneOverW[1], c.varyings[j] * oneOverW[2], output.varyings[j]);
+
+	output.draw = draw;
+
+	return true;
+}
+
+
+void CGDSoftwareRasterizer::rasterizeTile(uint32_t tileIndex) {
+
+	const vector<uint32_t>& bin = bins[tileIndex];
+
+	if (bin.empty())
+		return;
+
+	int32_t tileX0 = (int32_t)((tileIndex % tilesX) * tileSize);
+	int32_t tileY0 = (int32_t)((tileIndex / tilesX) * tileSize);
+	int32_t tileX1 = min(tileX0 + (int32_t)tileSize, (int32_t)width) - 1;
+	int32_t tileY1 = min(tileY0 + (int32_t)tileSize, (int32_t)height) - 1;
+
+	const __m128 laneOffset = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 allOnes = _mm_castsi128_ps(_mm_set1_epi32(-1));
+
+	uint64_t shaded = 0;
+
+	for (size_t t = 0; t < bin.size(); t++) {
+
+		const Triangle& tri = triangles[bin[t]];
+		const Draw& draw = draws[tri.draw];
+
+		int32_t minX = max(tri.minX, tileX0) & ~3;
+		int32_t maxX = min(tri.maxX, tileX1);
+		int32_t minY = max(tri.minY, tileY0);
+		int32_t maxY = min(tri.maxY, tileY1);
+
+		__m128 edgeA[3], zeroMask[3];
+
+		for (int i = 0; i < 3; i++) {
+
+			edgeA[i] = _mm_set1_ps(tri.edge[i][0]);
+			zeroMask[i] = (tri.includeZero[i]) ? allOnes : zero;
+		}
+
+		__m128 zA = _mm_set1_ps(tri.z[0]);
+		__m128 wA = _mm_set1_ps(tri.oneOverW[0]);
+
+		for (int32_t y = minY; y <= maxY; y++) {
+
+			float py = (float)y + 0.5f;
+
+			// Row constant part of each plane (B * y + C) - evaluated the same way for every triangle so shared edges give exactly negated values
+			__m128 edgeRow[3];
+
+			for (int i = 0; i < 3; i++)
+				edgeRow[i] = _mm_set1_ps(tri.edge[i][1] * py + tri.edge[i][2]);
+
+			__m128 zRow = _mm_set1_ps(tri.z[1] * py + tri.z[2]);
+			__m128 wRow = _mm_set1_ps(tri.oneOverW[1] * py + tri.oneOverW[2]);
+
+			float varyingRow[CGD_SOFTWARE_VARYINGS];
+
+			for (int j = 0; j < CGD_SOFTWARE_VARYINGS; j++)
+				varyingRow[j] = tri.varyings[j][1] * py + tri.varyings[j][2];
+
+			uint32_t *colourRow = colourBuffer.data() + (size_t)y * stride;
+			float *depthRow = depthBuffer.data() + (size_t)y * stride;
+
+			for (int32_t x = minX; x <= maxX; x += 4) {
+
+				__m128 px = _mm_add_ps(_mm_set1_ps((float)x), laneOffset);
+
+				// Coverage
+				__m128 mask = allOnes;
+
+				for (int i = 0; i < 3; i++) {
+
+					__m128 e = _mm_add_ps(_mm_mul_ps(edgeA[i], px), edgeRow[i]);
+
+					mask = _mm_and_ps(mask, _mm_or_ps(_mm_cmpgt_ps(e, zero), _mm_and_ps(_mm_cmpeq_ps(e, zero), zeroMask[i])));
+				}
+
+				// Lanes past the right edge of the image (stride padding)
+				if (x + 4 > (int32_t)width)
+					mask = _mm_and_ps(mask, _mm_cmplt_ps(px, _mm_set1_ps((float)width)));
+
+				if (_mm_movemask_ps(mask) == 0)
+					continue;
+
+				// Depth test (LESS) and write
+				__m128 z = _mm_add_ps(_mm_mul_ps(zA, px), zRow);
+				__m128 depth = _mm_loadu_ps(depthRow + x);
+
+				mask = _mm_and_ps(mask, _mm_cmplt_ps(z, depth));
+
+				int laneMask = _mm_movemask_ps(mask);
+
+				if (laneMask == 0)
+					continue;
+
+				_mm_storeu_ps(depthRow + x, _mm_or_ps(_mm_and_ps(mask, z), _mm_andnot_ps(mask, depth)));
+
+				// Perspective-correct varyings
+				__m128 w = _mm_div_ps(_mm_set1_ps(1.0f), _mm_add_ps(_mm_mul_ps(wA, px), wRow));
+				__m128 varyings[CGD_SOFTWARE_VARYINGS];
+
+				for (int j = 0; j < CGD_SOFTWARE_VARYINGS; j++) {
+
+					__m128 f = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(tri.varyings[j][0]), px), _mm_set1_ps(varyingRow[j]));
+
+					varyings[j] = _mm_mul_ps(f, w);
+				}
+
+				__m128 colour[4];
+
+				CGDPerPixelLightingPS(varyings, draw.constants, draw.texture, colour);
+
+				__m128i packed = packColour(colour);
+				__m128i m = _mm_castps_si128(mask);
+				__m128i old = _mm_loadu_si128((const __m128i*)(colourRow + x));
+
+				_mm_storeu_si128((__m128i*)(colourRow + x), _mm_or_si128(_mm_and_si128(m, packed), _mm_andnot_si128(m, old)));
+
+				shaded += ((laneMask & 1) + ((laneMask >> 1) & 1) + ((laneMask >> 2) & 1) + ((laneMask >> 3) & 1));
+			}
+		}
+	}
+
+	pixelsShaded.fetch_add(shaded, memory_order_relaxed);
+}
+
+
+void CGDSoftwareRasterizer::parallelFor(uint32_t count, uint32_t grainSize, const function<void(uint32_t begin, uint32_t end)>& body) {
+
+	if (count == 0)
+		return;
+
+	if (jobSystem)
+		jobSystem->parallelFor(0, count, grainSize, body);
+	else
+		body(0, count);
+}
+
+
+
+//
+// Public interface
+//
+
+// Factory method
+CGDSoftwareRasterizer* CGDSoftwareRasterizer::CreateSoftwareRasterizer(uint32_t width, uint32_t height, CGDJobSystem *jobSystem) {
+
+	if (width == 0 || height == 0)
+		return nullptr;
+
+	return new CGDSoftwareRasterizer(width, height, jobSystem);
+}
+
+
+// Destructor
+CGDSoftwareRasterizer::~CGDSoftwareRasterizer() {
+
+	flush();
+
+	if (jobSystem)
+		jobSystem->release();
+}
+
+
+void CGDSoftwareRasterizer::clear(const float colour[4], float depth) {
+
+	flush();
+
+	__m128 c = _mm_setr_ps(colour[0], colour[1], colour[2], colour[3]);
+	__m128 channels[4] = { _mm_shuffle_ps(c, c, 0x00), _mm_shuffle_ps(c, c, 0x55), _mm_shuffle_ps(c, c, 0xAA), _mm_shuffle_ps(c, c, 0xFF) };
+	uint32_t packed = (uint32_t)_mm_cvtsi128_si32(packColour(channels));
+
+	fill(colourBuffer.begin(), colourBuffer.end(), packed);
+	fill(depthBuffer.begin(), depthBuffer.end(), depth);
+
+	textureBound = false;
+}
+
+
+void CGDSoftwareRasterizer::drawIndexed(const CGDSoftwareVertex *vertices, uint32_t numVertices, const uint32_t *indices, uint32_t indexCount, const CGDLightingConstants& constants, CGDSoftwareTexture *texture) {
+
+	PROFILE_SCOPE("CGDSoftwareRasterizer::drawIndexed");
+
+	if (!vertices || !indices || numVertices == 0 || indexCount < 3)
+		return;
+
+	uint32_t drawIndex = (uint32_t)draws.size();
+
+	draws.push_back(Draw());
+	draws.back().constants = constants;
+	draws.back().texture = texture;
+
+	if (texture)
+		texture->retain();
+
+	stats.drawCalls++;
+
+	if (!textureBound || texture != boundTexture) {
+
+		stats.stateChanges++;
+		boundTexture = texture;
+		textureBound = true;
+	}
+
+	const CGDLightingConstants& drawConstants = draws.back().constants;
+
+	// Vertex shading
+	vertexOutput.resize(numVertices);
+
+	parallelFor(numVertices, 1024, [&](uint32_t begin, uint32_t end) {
+
+		for (uint32_t i = begin; i < end; i++)
+			CGDPerPixelLightingVS(vertices[i], drawConstants, vertexOutput[i]);
+	});
+
+	// Triangle setup
+	uint32_t numTriangles = indexCount / 3;
+
+	setupTriangles.resize((size_t)numTriangles * 2);
+	setupCounts.resize(numTriangles);
+
+	parallelFor(numTriangles, 512, [&](uint32_t begin, uint32_t end) {
+
+		for (uint32_t t = begin; t < end; t++) {
+
+			uint32_t i0 = indices[t * 3], i1 = indices[t * 3 + 1], i2 = indices[t * 3 + 2];
+
+			if (i0 >= numVertices || i1 >= numVertices || i2 >= numVertices) {
+
+				setupCounts[t] = 0;
+				continue;
+			}
+
+			setupCounts[t] = (uint8_t)setupTriangle(vertexOutput[i0], vertexOutput[i1], vertexOutput[i2], drawIndex, &setupTriangles[(size_t)t * 2]);
+		}
+	});
+
+	// Append and bin in submission order
+	for (uint32_t t = 0; t < numTriangles; t++) {
+
+		uint32_t count = setupCounts[t] & ~clippedFlag;
+
+		if (setupCounts[t] & clippedFlag)
+			stats.trianglesClipped++;
+
+		if (count == 0)
+			stats.trianglesCulled++;
+
+		for (uint32_t k = 0; k < count; k++) {
+
+			const Triangle& tri = setupTriangles[(size_t)t * 2 + k];
+			uint32_t triangleIndex = (uint32_t)triangles.size();
+
+			triangles.push_back(tri);
+
+			uint32_t tx0 = tri.minX / tileSize, tx1 = tri.maxX / tileSize;
+			uint32_t ty0 = tri.minY / tileSize, ty1 = tri.maxY / tileSize;
+
+			for (uint32_t ty = ty0; ty <= ty1; ty++) {
+
+				for (uint32_t tx = tx0; tx <= tx1; tx++) {
+
+					// Skip tiles outside one of the edges (test the tile corner furthest inside the edge)
+					if (tx0 != tx1 || ty0 != ty1) {
+
+						float cx0 = (float)(tx * tileSize), cy0 = (float)(ty * tileSize);
+						float cx1 = cx0 + (float)tileSize, cy1 = cy0 + (float)tileSize;
+						bool outside = false;
+
+						for (int i = 0; i < 3 && !outside; i++) {
+
+							float x = (tri.edge[i][0] > 0.0f) ? cx1 : cx0;
+							float y = (tri.edge[i][1] > 0.0f) ? cy1 : cy0;
+
+							outside = (tri.edge[i][0] * x + tri.edge[i][1] * y + tri.edge[i][2] < 0.0f);
+						}
+
+						if (outside)
+							continue;
+					}
+
+					bins[ty * tilesX + tx].push_back(triangleIndex);
+					stats.binnedTriangles++;
+				}
+			}
+		}
+	}
+
+	stats.trianglesSubmitted += numTriangles;
+}
+
+
+void CGDSoftwareRasterizer::flush() {
+
+	if (draws.empty())
+		return;
+
+	PROFILE_SCOPE("CGDSoftwareRasterizer::flush");
+
+	parallelFor(tilesX * tilesY, 1, [=](uint32_t begin, uint32_t end) {
+
+		for (uint32_t i = begin; i < end; i++)
+			rasterizeTile(i);
+	});
+
+	for (size_t i = 0; i < bins.size(); i++)
+		bins[i].clear();
+
+	for (size_t i = 0; i < draws.size(); i++)
+		if (draws[i].texture)
+			draws[i].texture->release();
+
+	draws.clear();
+	triangles.clear();
+}
+
+
+void CGDSoftwareRasterizer::readColour(uint32_t *rgba) {
+
+	flush();
+
+	for (uint32_t y = 0; y < height; y++)
+		memcpy(rgba + (size_t)y * width, colourBuffer.data() + (size_t)y * stride, width * sizeof(uint32_t));
+}
+
+
+bool CGDSoftwareRasterizer::writePNG(const char *filename) {
+
+	flush();
+
+	return gu_png_write(filename, width, height, (const uint8_t*)colourBuffer.data(), stride * sizeof(uint32_t));
+}
+
+
+CGDSoftwareRasterizerStats CGDSoftwareRasterizer::frameStats() const {
+
+	CGDSoftwareRasterizerStats s = stats;
+
+	s.pixelsShaded = pixelsShaded.load(memory_order_relaxed);
+
+	return s;
+}
+
+
+void CGDSoftwareRasterizer::resetStats() {
+
+	stats = CGDSoftwareRasterizerStats();
+	pixelsShaded = 0;
+}
+
+
+uint32_t CGDSoftwareRasterizer::getWidth() const {
+
+	return width;
+}
+
+
+uint32_t CGDSoftwareRasterizer::getHeight() const {
+
+	return height;
+}
+
+
+const float* CGDSoftwareRasterizer::getDepthBuffer() const {
+
+	return depthBuffer.data();
+}
@@ -0,0 +1,137 @@
+//
+// CGDSoftwareRasterizer.h
+//
+
+// Tiled, multithreaded software rasterizer implementing the subset of the D3D11 pipeline the scene uses - indexed triangle lists of CGDSoftwareVertex (the extVertexDesc layout), the per-pixel lighting shaders (see CGDSoftwareShaders), bilinear texture sampling, no culling (the scene's rasterizer state is CULL_NONE), near plane clipping and a LESS depth test with depth writes.  Output is an R8G8B8A8 colour buffer and a float depth buffer that can be written to PNG (see GUPNGWriter), so frames can be rendered without a window or GPU for regression tests and benchmarks.
+//
+// drawIndexed shades the draw's vertices (in parallel), sets up its triangles - clip, project, compute edge functions and perspective-correct attribute planes - and bins them into 64x64 pixel tiles.  flush rasterizes the tiles in parallel on the CGDJobSystem.  Each tile is owned by one thread and processes its triangles in submission order, so the image is identical whatever the number of threads.  Inside a tile, 4 pixels of a row are tested, depth tested and shaded at once with SSE.  Pixel centres and the fill rule follow D3D (pixel centres at half-integers, top-left rule) so edges shared by two triangles are rasterized exactly once.
+
+#pragma once
+
+#include <GUObject.h>
+#include <CGDSoftwareShaders.h>
+#include <cstdint>
+#include <atomic>
+#include <functional>
+#include <vector>
+
+class CGDJobSystem;
+class CGDSoftwareTexture;
+
+
+// Frame statistics
+struct CGDSoftwareRasterizerStats {
+
+	uint64_t				drawCalls = 0;
+	uint64_t				stateChanges = 0; // draws that bind a different texture to the previous draw (the first draw after a clear always counts)
+	uint64_t				trianglesSubmitted = 0;
+	uint64_t				trianglesCulled = 0; // outside the view volume, behind the near plane or zero area
+	uint64_t				trianglesClipped = 0; // crossed the near plane
+	uint64_t				binnedTriangles = 0; // triangle / tile pairs
+	uint64_t				pixelsShaded = 0;
+};
+
+
+class CGDSoftwareRasterizer : public GUObject {
+
+	static const uint32_t	tileSize = 64;
+	static const uint8_t	clippedFlag = 0x80;
+
+	struct Draw {
+
+		CGDLightingConstants	constants;
+		CGDSoftwareTexture		*texture;
+	};
+
+	// Triangle set up for rasterization.  Edge functions and attribute planes are (A, B, C) with value A * x + B * y + C at pixel centre (x, y)
+	struct Triangle {
+
+		float					edge[3][3];
+		bool					includeZero[3]; // top-left rule - pixels exactly on the edge are covered
+		float					z[3];
+		float					oneOverW[3];
+		float					varyings[CGD_SOFTWARE_VARYINGS][3]; // varying / w
+		int32_t					minX, minY, maxX, maxY;
+		uint32_t				draw;
+	};
+
+	uint32_t					width;
+	uint32_t					height;
+	uint32_t					stride; // pixels per row (width rounded up to a multiple of 4)
+	uint32_t					tilesX;
+	uint32_t					tilesY;
+
+	std::vector<uint32_t>		colourBuffer;
+	std::vector<float>			depthBuffer;
+
+	CGDJobSystem				*jobSystem = nullptr;
+
+	// Queued work (cleared by flush)
+	std::vector<Draw>						draws;
+	std::vector<CGDSoftwareVSOutput>		vertexOutput;
+	std::vector<Triangle>					setupTriangles; // up to 2 per input triangle (near plane clipping)
+	std::vector<uint8_t>					setupCounts; // triangles written per input triangle, | clippedFlag if it crossed the near plane
+	std::vector<Triangle>					triangles;
+	std::vector<std::vector<uint32_t> >		bins;
+
+	CGDSoftwareRasterizerStats				stats;
+	const CGDSoftwareTexture				*boundTexture = nullptr; // texture of the last draw - compared only, never dereferenced
+	bool									textureBound = false;
+	std::atomic<uint64_t>					pixelsShaded;
+
+
+	//
+	// Private interface
+	//
+
+	// Constructor - called internally by the CreateSoftwareRasterizer factory method
+	CGDSoftwareRasterizer(uint32_t width, uint32_t height, CGDJobSystem *jobSystem);
+
+	// Clip triangle (a, b, c) against the near plane and set up the resulting triangles in output.  Return the number of triangles written (0-2)
+	uint32_t setupTriangle(const CGDSoftwareVSOutput& a, const CGDSoftwareVSOutput& b, const CGDSoftwareVSOutput& c, uint32_t draw, Triangle *output);
+
+	// Set up a triangle that lies in front of the near plane.  Return false if it is culled
+	bool setupClippedTriangle(const CGDSoftwareVSOutput& a, const CGDSoftwareVSOutput& b, const CGDSoftwareVSOutput& c, uint32_t draw, Triangle& output);
+
+	void rasterizeTile(uint32_t tileIndex);
+
+	// Run body over [0, count) on the job system (or serially if there is none)
+	void parallelFor(uint32_t count, uint32_t grainSize, const std::function<void(uint32_t begin, uint32_t end)>& body);
+
+
+public:
+
+	//
+	// Public interface
+	//
+
+	// Factory method.  jobSystem may be nullptr (render on the calling thread) and is retained.  Return nullptr if width or height is 0
+	static CGDSoftwareRasterizer* CreateSoftwareRasterizer(uint32_t width, uint32_t height, CGDJobSystem *jobSystem);
+
+	// Destructor
+	~CGDSoftwareRasterizer();
+
+	// Clear the colour buffer to colour (r, g, b, a in [0, 1]) and the depth buffer to depth.  Queued draws are flushed first
+	void clear(const float colour[4], float depth = 1.0f);
+
+	// Queue an indexed triangle list drawn with the per-pixel lighting shaders.  Vertices are shaded and triangles set up immediately so vertices and indices need not outlive the call.  texture (may be nullptr) is retained until the draw is flushed
+	void drawIndexed(const CGDSoftwareVertex *vertices, uint32_t numVertices, const uint32_t *indices, uint32_t indexCount, const CGDLightingConstants& constants, CGDSoftwareTexture *texture);
+
+	// Rasterize all queued draws
+	void flush();
+
+	// Copy the colour buffer (flushing first) into rgba as width * height R8G8B8A8 values
+	void readColour(uint32_t *rgba);
+
+	// Flush and write the colour buffer to a PNG file.  Return false on failure
+	bool writePNG(const char *filename);
+
+	// Statistics since the last call to resetStats
+	CGDSoftwareRasterizerStats frameStats() const;
+	void resetStats();
+
+	// Query methods
+	uint32_t getWidth() const;
+	uint32_t getHeight() const;
+	const float* getDepthBuffer() const; // stride = width rounded up to a multiple of 4
+};
@@ -0,0 +1,348 @@
+
+//
+// CGDSoftwareShaders.cpp
+//
+
+#include <stdafx.h>
+#include <CGDSoftwareShaders.h>
+#include <CGDSoftwareTexture.h>
+#include <cmath>
+
+using namespace std;
+
+
+
+//
+// CGDSoftwareMatrix
+//
+
+CGDSoftwareMatrix CGDSoftwareMatrix::Identity() {
+
+	CGDSoftwareMatrix r = { { { 1, 0, 0, 0 }, { 0, 1, 0, 0 }, { 0, 0, 1, 0 }, { 0, 0, 0, 1 } } };
+
+	return r;
+}
+
+
+CGDSoftwareMatrix CGDSoftwareMatrix::Translation(float x, float y, float z) {
+
+	CGDSoftwareMatrix r = Identity();
+
+	r.m[3][0] = x;
+	r.m[3][1] = y;
+	r.m[3][2] = z;
+
+	return r;
+}
+
+
+CGDSoftwareMatrix CGDSoftwareMatrix::Scaling(float x, float y, float z) {
+
+	CGDSoftwareMatrix r = Identity();
+
+	r.m[0][0] = x;
+	r.m[1][1] = y;
+	r.m[2][2] = z;
+
+	return r;
+}
+
+
+CGDSoftwareMatrix CGDSoftwareMatrix::RotationY(float angle) {
+
+	CGDSoftwareMatrix r = Identity();
+
+	float s = sin(angle), c = cos(angle);
+
+	r.m[0][0] = c;
+	r.m[0][2] = -s;
+	r.m[2][0] = s;
+	r.m[2][2] = c;
+
+	return r;
+}
+
+
+static void normalise3(float v[3]) {
+
+	float l = sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+
+	if (l > 0.0f) {
+
+		v[0] /= l;
+		v[1] /= l;
+		v[2] /= l;
+	}
+}
+
+
+CGDSoftwareMatrix CGDSoftwareMatrix::LookAtLH(const float eye[3], const float at[3], const float up[3]) {
+
+	float z[3] = { at[0] - eye[0], at[1] - eye[1], at[2] - eye[2] };
+
+	normalise3(z);
+
+	float x[3] = { up[1] * z[2] - up[2] * z[1], up[2] * z[0] - up[0] * z[2], up[0] * z[1] - up[1] * z[0] };
+
+	normalise3(x);
+
+	float y[3] = { z[1] * x[2] - z[2] * x[1], z[2] * x[0] - z[0] * x[2], z[0] * x[1] - z[1] * x[0] };
+
+	CGDSoftwareMatrix r = Identity();
+
+	for (int i = 0; i < 3; i++) {
+
+		r.m[i][0] = x[i];
+		r.m[i][1] = y[i];
+		r.m[i][2] = z[i];
+	}
+
+	r.m[3][0] = -(x[0] * eye[0] + x[1] * eye[1] + x[2] * eye[2]);
+	r.m[3][1] = -(y[0] * eye[0] + y[1] * eye[1] + y[2] * eye[2]);
+	r.m[3][2] = -(z[0] * eye[0] + z[1] * eye[1] + z[2] * eye[2]);
+
+	return r;
+}
+
+
+CGDSoftwareMatrix CGDSoftwareMatrix::PerspectiveFovLH(float fovY, float aspect, float nearZ, float farZ) {
+
+	CGDSoftwareMatrix r = { { { 0 } } };
+
+	float h = 1.0f / tan(fovY * 0.5f);
+	float range = farZ / (farZ - nearZ);
+
+	r.m[0][0] = h / aspect;
+	r.m[1][1] = h;
+	r.m[2][2] = range;
+	r.m[2][3] = 1.0f;
+	r.m[3][2] = -range * nearZ;
+
+	return r;
+}
+
+
+CGDSoftwareMatrix CGDSoftwareMatrix::operator*(const CGDSoftwareMatrix& b) const {
+
+	CGDSoftwareMatrix r;
+
+	for (int i = 0; i < 4; i++)
+		for (int j = 0; j < 4; j++)
+			r.m[i][j] = m[i][0] * b.m[0][j] + m[i][1] * b.m[1][j] + m[i][2] * b.m[2][j] + m[i][3] * b.m[3][j];
+
+	return r;
+}
+
+
+CGDSoftwareMatrix CGDSoftwareMatrix::inverseTranspose() const {
+
+	const float *a = &m[0][0];
+	float inv[16];
+
+	// Cofactors (adjugate) of the 4x4 matrix
+	inv[0] = a[5] * a[10] * a[15] - a[5] * a[11] * a[14] - a[9] * a[6] * a[15] + a[9] * a[7] * a[14] + a[13] * a[6] * a[11] - a[13] * a[7] * a[10];
+	inv[4] = -a[4] * a[10] * a[15] + a[4] * a[11] * a[14] + a[8] * a[6] * a[15] - a[8] * a[7] * a[14] - a[12] * a[6] * a[11] + a[12] * a[7] * a[10];
+	inv[8] = a[4] * a[9] * a[15] - a[4] * a[11] * a[13] - a[8] * a[5] * a[15] + a[8] * a[7] * a[13] + a[12] * a[5] * a[11] - a[12] * a[7] * a[9];
+	inv[12] = -a[4] * a[9] * a[14] + a[4] * a[10] * a[13] + a[8] * a[5] * a[14] - a[8] * a[6] * a[13] - a[12] * a[5] * a[10] + a[12] * a[6] * a[9];
+	inv[1] = -a[1] * a[10] * a[15] + a[1] * a[11] * a[14] + a[9] * a[2] * a[15] - a[9] * a[3] * a[14] - a[13] * a[2] * a[11] + a[13] * a[3] * a[10];
+	inv[5] = a[0] * a[10] * a[15] - a[0] * a[11] * a[14] - a[8] * a[2] * a[15] + a[8] * a[3] * a[14] + a[12] * a[2] * a[11] - a[12] * a[3] * a[10];
+	inv[9] = -a[0] * a[9] * a[15] + a[0] * a[11] * a[13] + a[8] * a[1] * a[15] - a[8] * a[3] * a[13] - a[12] * a[1] * a[11] + a[12] * a[3] * a[9];
+	inv[13] = a[0] * a[9] * a[14] - a[0] * a[10] * a[13] - a[8] * a[1] * a[14] + a[8] * a[2] * a[13] + a[12] * a[1] * a[10] - a[12] * a[2] * a[9];
+	inv[2] = a[1] * a[6] * a[15] - a[1] * a[7] * a[14] - a[5] * a[2] * a[15] + a[5] * a[3] * a[14] + a[13] * a[2] * a[7] - a[13] * a[3] * a[6];
+	inv[6] = -a[0] * a[6] * a[15] + a[0] * a[7] * a[14] + a[4] * a[2] * a[15] - a[4] * a[3] * a[14] - a[12] * a[2] * a[7] + a[12] * a[3] * a[6];
+	inv[10] = a[0] * a[5] * a[15] - a[0] * a[7] * a[13] - a[4] * a[1] * a[15] + a[4] * a[3] * a[13] + a[12] * a[1] * a[7] - a[12] * a[3] * a[5];
+	inv[14] = -a[0] * a[5] * a[14] + a[0] * a[6] * a[13] + a[4] * a[1] * a[14] - a[4] * a[2] * a[13] - a[12] * a[1] * a[6] + a[12] * a[2] * a[5];
+	inv[3] = -a[1] * a[6] * a[11] + a[1] * a[7] * a[10] + a[5] * a[2] * a[11] - a[5] * a[3] * a[10] - a[9] * a[2] * a[7] + a[9] * a[3] * a[6];
+	inv[7] = a[0] * a[6] * a[11] - a[0] * a[7] * a[10] - a[4] * a[2] * a[11] + a[4] * a[3] * a[10] + a[8] * a[2] * a[7] - a[8] * a[3] * a[6];
+	inv[11] = -a[0] * a[5] * a[11] + a[0] * a[7] * a[9] + a[4] * a[1] * a[11] - a[4] * a[3] * a[9] - a[8] * a[1] * a[7] + a[8] * a[3] * a[5];
+	inv[15] = a[0] * a[5] * a[10] - a[0] * a[6] * a[9] - a[4] * a[1] * a[10] + a[4] * a[2] * a[9] + a[8] * a[1] * a[6] - a[8] * a[2] * a[5];
+
+	float det = a[0] * inv[0] + a[1] * inv[4] + a[2] * inv[8] + a[3] * inv[12];
+
+	if (det == 0.0f)
+		return Identity();
+
+	float invDet = 1.0f / det;
+	CGDSoftwareMatrix r;
+
+	// inv is the inverse in row-major order - store its transpose
+	for (int i = 0; i < 4; i++)
+		for (int j = 0; j < 4; j++)
+			r.m[i][j] = inv[j * 4 + i] * invDet;
+
+	return r;
+}
+
+
+
+//
+// Per-pixel lighting
+//
+
+// Transform row vector (x, y, z, w) by M
+static void transform(const float v[4], const CGDSoftwareMatrix& M, float out[4]) {
+
+	for (int j = 0; j < 4; j++)
+		out[j] = v[0] * M.m[0][j] + v[1] * M.m[1][j] + v[2] * M.m[2][j] + v[3] * M.m[3][j];
+}
+
+
+// XMCOLOR (0xAARRGGBB) to r, g, b, a in [0, 1]
+static void unpackColour(uint32_t c, float *out) {
+
+	out[0] = (float)((c >> 16) & 0xFF) * (1.0f / 255.0f);
+	out[1] = (float)((c >> 8) & 0xFF) * (1.0f / 255.0f);
+	out[2] = (float)(c & 0xFF) * (1.0f / 255.0f);
+	out[3] = (float)((c >> 24) & 0xFF) * (1.0f / 255.0f);
+}
+
+
+void CGDPerPixelLightingVS(const CGDSoftwareVertex& input, const CGDLightingConstants& constants, CGDSoftwareVSOutput& output) {
+
+	float pos[4] = { input.pos[0], input.pos[1], input.pos[2], 1.0f };
+	float normal[4] = { input.normal[0], input.normal[1], input.normal[2], 1.0f };
+	float t[4];
+
+	// Lighting is calculated in world space
+	transform(pos, constants.worldMatrix, t);
+	output.varyings[0] = t[0];
+	output.varyings[1] = t[1];
+	output.varyings[2] = t[2];
+
+	// Transform normals to world space with worldIT (w = 1 as in the HLSL)
+	transform(normal, constants.worldITMatrix, t);
+	output.varyings[3] = t[0];
+	output.varyings[4] = t[1];
+	output.varyings[5] = t[2];
+
+	// Pass through material properties and texture coordinates
+	unpackColour(input.matDiffuse, output.varyings + 6);
+	unpackColour(input.matSpecular, output.varyings + 10);
+	output.varyings[14] = input.texCoord[0];
+	output.varyings[15] = input.texCoord[1];
+
+	// Transform / project pos to clip space
+	transform(pos, constants.worldViewProjMatrix, output.posH);
+}
+
+
+// SIMD 3-vectors (structure of arrays)
+struct Vec4x3 {
+
+	__m128	x, y, z;
+};
+
+static inline __m128 dot3(const Vec4x3& a, const Vec4x3& b) {
+
+	return _mm_add_ps(_mm_add_ps(_mm_mul_ps(a.x, b.x), _mm_mul_ps(a.y, b.y)), _mm_mul_ps(a.z, b.z));
+}
+
+static inline Vec4x3 normalise(const Vec4x3& v) {
+
+	__m128 l = _mm_sqrt_ps(dot3(v, v));
+	__m128 s = _mm_div_ps(_mm_set1_ps(1.0f), l);
+	Vec4x3 r = { _mm_mul_ps(v.x, s), _mm_mul_ps(v.y, s), _mm_mul_ps(v.z, s) };
+
+	return r;
+}
+
+// reflect(i, n) = i - 2 * dot(i, n) * n
+static inline Vec4x3 reflect(const Vec4x3& i, const Vec4x3& n) {
+
+	__m128 d = _mm_mul_ps(_mm_set1_ps(2.0f), dot3(i, n));
+	Vec4x3 r = { _mm_sub_ps(i.x, _mm_mul_ps(d, n.x)), _mm_sub_ps(i.y, _mm_mul_ps(d, n.y)), _mm_sub_ps(i.z, _mm_mul_ps(d, n.z)) };
+
+	return r;
+}
+
+// pow(max(x, 0), e) per lane
+static inline __m128 powClamped(__m128 x, __m128 e) {
+
+	float xs[4], es[4], r[4];
+
+	_mm_storeu_ps(xs, _mm_max_ps(x, _mm_setzero_ps()));
+	_mm_storeu_ps(es, e);
+
+	for (int i = 0; i < 4; i++)
+		r[i] = (xs[i] > 0.0f) ? pow(xs[i], es[i]) : 0.0f;
+
+	return _mm_loadu_ps(r);
+}
+
+
+void CGDPerPixelLightingPS(const __m128 varyings[CGD_SOFTWARE_VARYINGS], const CGDLightingConstants& constants, const CGDSoftwareTexture *texture, __m128 colour[4]) {
+
+	Vec4x3 posW = { varyings[0], varyings[1], varyings[2] };
+	Vec4x3 normalW = { varyings[3], varyings[4], varyings[5] };
+	Vec4x3 N = normalise(normalW);
+
+	__m128 baseColour[4] = { varyings[6], varyings[7], varyings[8], varyings[9] };
+
+	if (texture) {
+
+		__m128 texel[4];
+
+		texture->sample4(varyings[14], varyings[15], texel);
+
+		for (int c = 0; c < 4; c++)
+			baseColour[c] = _mm_mul_ps(baseColour[c], texel[c]);
+	}
+
+	// Ambient
+	__m128 result[3];
+
+	for (int c = 0; c < 3; c++) {
+
+		float ambient = constants.lights[0].ambient[c] + constants.lights[1].ambient[c] + constants.lights[2].ambient[c];
+
+		result[c] = _mm_mul_ps(baseColour[c], _mm_set1_ps(ambient));
+	}
+
+	__m128 specPower = _mm_max_ps(_mm_mul_ps(varyings[13], _mm_set1_ps(1000.0f)), _mm_set1_ps(1.0f));
+
+	Vec4x3 eyeDir = { _mm_sub_ps(_mm_set1_ps(constants.eyePos[0]), posW.x), _mm_sub_ps(_mm_set1_ps(constants.eyePos[1]), posW.y), _mm_sub_ps(_mm_set1_ps(constants.eyePos[2]), posW.z) };
+
+	eyeDir = normalise(eyeDir);
+
+	for (int l = 0; l < 3; l++) {
+
+		const CGDSoftwareLight& light = constants.lights[l];
+
+		// Directional light unless w == 1 (positional)
+		Vec4x3 lightDir;
+
+		if (light.vec[3] == 1.0f) {
+
+			lightDir.x = _mm_sub_ps(_mm_set1_ps(light.vec[0]), posW.x);
+			lightDir.y = _mm_sub_ps(_mm_set1_ps(light.vec[1]), posW.y);
+			lightDir.z = _mm_sub_ps(_mm_set1_ps(light.vec[2]), posW.z);
+
+		} else {
+
+			lightDir.x = _mm_set1_ps(-light.vec[0]);
+			lightDir.y = _mm_set1_ps(-light.vec[1]);
+			lightDir.z = _mm_set1_ps(-light.vec[2]);
+		}
+
+		lightDir = normalise(lightDir);
+
+		// Diffuse
+		__m128 lambert = _mm_max_ps(dot3(lightDir, N), _mm_setzero_ps());
+
+		for (int c = 0; c < 3; c++)
+			result[c] = _mm_add_ps(result[c], _mm_mul_ps(_mm_mul_ps(lambert, baseColour[c]), _mm_set1_ps(light.diffuse[c])));
+
+		// Specular
+		Vec4x3 negLightDir = { _mm_sub_ps(_mm_setzero_ps(), lightDir.x), _mm_sub_ps(_mm_setzero_ps(), lightDir.y), _mm_sub_ps(_mm_setzero_ps(), lightDir.z) };
+		Vec4x3 R = reflect(negLightDir, N);
+		__m128 specFactor = powClamped(dot3(R, eyeDir), specPower);
+
+		for (int c = 0; c < 3; c++)
+			result[c] = _mm_add_ps(result[c], _mm_mul_ps(_mm_mul_ps(specFactor, varyings[10 + c]), _mm_set1_ps(light.specular[c])));
+	}
+
+	colour[0] = result[0];
+	colour[1] = result[1];
+	colour[2] = result[2];
+	colour[3] = baseColour[3];
+}
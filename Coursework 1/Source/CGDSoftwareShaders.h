@@ -0,0 +1,82 @@
+//
+// CGDSoftwareShaders.h
+//
+
+// Shader programs for the software rasterizer (see CGDSoftwareRasterizer) - C++ ports of per_pixel_lighting_vs.hlsl and per_pixel_lighting_ps.hlsl, with three fixed lights in place of the shader's clustered lights (see CGDClusteredLighting).  The vertex shader runs per vertex and the pixel shader on 4 pixels at a time in SSE registers (structure of arrays).  CGDSoftwareVertex has the same memory layout as ExtendedVertexStruct / extVertexDesc so vertex data built for the D3D path can be drawn unchanged, and matrices are row-major with row vectors (v * M) as in DirectXMath and the row_major HLSL shaders.
+
+#pragma once
+
+#include <cstdint>
+#include <emmintrin.h>
+
+class CGDSoftwareTexture;
+
+
+// Row-major 4x4 matrix
+struct CGDSoftwareMatrix {
+
+	float						m[4][4];
+
+	static CGDSoftwareMatrix Identity();
+	static CGDSoftwareMatrix Translation(float x, float y, float z);
+	static CGDSoftwareMatrix Scaling(float x, float y, float z);
+	static CGDSoftwareMatrix RotationY(float angle);
+
+	// Left-handed view and projection matrices (as XMMatrixLookAtLH / XMMatrixPerspectiveFovLH)
+	static CGDSoftwareMatrix LookAtLH(const float eye[3], const float at[3], const float up[3]);
+	static CGDSoftwareMatrix PerspectiveFovLH(float fovY, float aspect, float nearZ, float farZ);
+
+	CGDSoftwareMatrix operator*(const CGDSoftwareMatrix& b) const;
+
+	// Transpose of the inverse (worldITMatrix).  Returns the identity if the matrix is singular
+	CGDSoftwareMatrix inverseTranspose() const;
+};
+
+
+// Vertex in the extVertexDesc layout.  Colours are XMCOLOR values (B8G8R8A8_UNORM in memory, 0xAARRGGBB as an integer)
+struct CGDSoftwareVertex {
+
+	float						pos[3];
+	float						normal[3];
+	uint32_t					matDiffuse;
+	uint32_t					matSpecular; // a represents specular power / 1000
+	float						texCoord[2];
+};
+
+
+// Light as laid out in basicCBuffer (the sun).  vec.w = 1: vec is a position, vec.w = 0: vec is a direction
+struct CGDSoftwareLight {
+
+	float						vec[4];
+	float						ambient[4];
+	float						diffuse[4];
+	float						specular[4];
+};
+
+
+// Constants of the per-pixel lighting shaders (the parts of basicCBuffer they read)
+struct CGDLightingConstants {
+
+	CGDSoftwareMatrix			worldViewProjMatrix;
+	CGDSoftwareMatrix			worldITMatrix;
+	CGDSoftwareMatrix			worldMatrix;
+	float						eyePos[4];
+	CGDSoftwareLight			lights[3]; // the sun and the scene's first two local lights, unattenuated
+};
+
+
+// Vertex shader output.  varyings are interpolated across the triangle: posW (0-2), normalW (3-5), matDiffuse (6-9), matSpecular (10-13), texCoord (14-15)
+#define CGD_SOFTWARE_VARYINGS			16
+
+struct CGDSoftwareVSOutput {
+
+	float						posH[4];
+	float						varyings[CGD_SOFTWARE_VARYINGS];
+};
+
+
+// per_pixel_lighting_vs
+void CGDPerPixelLightingVS(const CGDSoftwareVertex& input, const CGDLightingConstants& constants, CGDSoftwareVSOutput& output);
+
+// per_pixel_lighting_ps for 4 pixels.  varyings holds the interpolated vertex shader outputs of the 4 pixels, colour receives r, g, b and a.  texture may be nullptr (samples white)
+void CGDPerPixelLightingPS(const __m128 varyings[CGD_SOFTWARE_VARYINGS], const CGDLightingConstants& constants, const CGDSoftwareTexture *texture, __m128 colour[4]);
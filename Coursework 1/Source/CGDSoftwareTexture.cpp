@@ -0,0 +1,184 @@
+
+//
+// CGDSoftwareTexture.cpp
+//
+
+#include <stdafx.h>
+#include <CGDSoftwareTexture.h>
+#include <cmath>
+
+using namespace std;
+
+
+
+//
+// Private interface
+//
+
+// Constructor - called internally by the CreateTexture factory method
+CGDSoftwareTexture::CGDSoftwareTexture(uint32_t _width, uint32_t _height, CGDTextureAddress _address) {
+
+	width = _width;
+	height = _height;
+	address = _address;
+}
+
+
+int32_t CGDSoftwareTexture::addressTexel(int32_t i, int32_t size) const {
+
+	switch (address) {
+
+		case CGDTextureAddress::WRAP:
+
+			i %= size;
+			return (i < 0) ? i + size : i;
+
+		case CGDTextureAddress::MIRROR: {
+
+			int32_t period = size * 2;
+
+			i %= period;
+
+			if (i < 0)
+				i += period;
+
+			return (i < size) ? i : period - 1 - i;
+		}
+
+		default:
+
+			return (i < 0) ? 0 : ((i >= size) ? size - 1 : i);
+	}
+}
+
+
+
+//
+// Public interface
+//
+
+// Factory method
+CGDSoftwareTexture* CGDSoftwareTexture::CreateTexture(uint32_t width, uint32_t height, const uint32_t *texels, CGDTextureAddress address) {
+
+	if (width == 0 || height == 0)
+		return nullptr;
+
+	CGDSoftwareTexture *texture = new CGDSoftwareTexture(width, height, address);
+
+	if (texels)
+		texture->texels.assign(texels, texels + (size_t)width * height);
+	else
+		texture->texels.assign((size_t)width * height, 0xFFFFFFFF);
+
+	return texture;
+}
+
+
+void CGDSoftwareTexture::sample(float u, float v, float colour[4]) const {
+
+	float x = u * (float)width - 0.5f;
+	float y = v * (float)height - 0.5f;
+
+	float fx = floor(x);
+	float fy = floor(y);
+
+	int32_t x0 = (int32_t)fx;
+	int32_t y0 = (int32_t)fy;
+
+	float wx = x - fx;
+	float wy = y - fy;
+
+	int32_t xa = addressTexel(x0, (int32_t)width), xb = addressTexel(x0 + 1, (int32_t)width);
+	int32_t ya = addressTexel(y0, (int32_t)height), yb = addressTexel(y0 + 1, (int32_t)height);
+
+	uint32_t t00 = texels[ya * width + xa], t10 = texels[ya * width + xb];
+	uint32_t t01 = texels[yb * width + xa], t11 = texels[yb * width + xb];
+
+	for (int c = 0; c < 4; c++) {
+
+		uint32_t shift = c * 8;
+
+		float top = (float)((t00 >> shift) & 0xFF) * (1.0f - wx) + (float)((t10 >> shift) & 0xFF) * wx;
+		float bottom = (float)((t01 >> shift) & 0xFF) * (1.0f - wx) + (float)((t11 >> shift) & 0xFF) * wx;
+
+		colour[c] = (top * (1.0f - wy) + bottom * wy) * (1.0f / 255.0f);
+	}
+}
+
+
+void CGDSoftwareTexture::sample4(__m128 u, __m128 v, __m128 colour[4]) const {
+
+	__m128 x = _mm_sub_ps(_mm_mul_ps(u, _mm_set1_ps((float)width)), _mm_set1_ps(0.5f));
+	__m128 y = _mm_sub_ps(_mm_mul_ps(v, _mm_set1_ps((float)height)), _mm_set1_ps(0.5f));
+
+	// floor - truncate then step down where truncation rounded up (negative coordinates)
+	__m128i xi = _mm_cvttps_epi32(x);
+	__m128i yi = _mm_cvttps_epi32(y);
+
+	xi = _mm_add_epi32(xi, _mm_castps_si128(_mm_cmplt_ps(x, _mm_cvtepi32_ps(xi))));
+	yi = _mm_add_epi32(yi, _mm_castps_si128(_mm_cmplt_ps(y, _mm_cvtepi32_ps(yi))));
+
+	__m128 wx = _mm_sub_ps(x, _mm_cvtepi32_ps(xi));
+	__m128 wy = _mm_sub_ps(y, _mm_cvtepi32_ps(yi));
+
+	int32_t x0[4], y0[4];
+
+	_mm_storeu_si128((__m128i*)x0, xi);
+	_mm_storeu_si128((__m128i*)y0, yi);
+
+	// Gather the 2x2 footprint of each sample as 4 floats per texel
+	__m128 t[4][4]; // [corner][sample] = rgba
+
+	for (int i = 0; i < 4; i++) {
+
+		int32_t xa = addressTexel(x0[i], (int32_t)width), xb = addressTexel(x0[i] + 1, (int32_t)width);
+		int32_t ya = addressTexel(y0[i], (int32_t)height), yb = addressTexel(y0[i] + 1, (int32_t)height);
+
+		uint32_t corner[4] = { texels[ya * width + xa], texels[ya * width + xb], texels[yb * width + xa], texels[yb * width + xb] };
+
+		for (int c = 0; c < 4; c++) {
+
+			__m128i texel = _mm_cvtsi32_si128((int)corner[c]);
+
+			texel = _mm_unpacklo_epi8(texel, _mm_setzero_si128());
+			texel = _mm_unpacklo_epi16(texel, _mm_setzero_si128());
+
+			t[c][i] = _mm_cvtepi32_ps(texel);
+		}
+	}
+
+	// Transpose each corner to structure of arrays and blend
+	for (int c = 0; c < 4; c++)
+		_MM_TRANSPOSE4_PS(t[c][0], t[c][1], t[c][2], t[c][3]);
+
+	__m128 scale = _mm_set1_ps(1.0f / 255.0f);
+	__m128 one = _mm_set1_ps(1.0f);
+	__m128 iwx = _mm_sub_ps(one, wx);
+	__m128 iwy = _mm_sub_ps(one, wy);
+
+	for (int k = 0; k < 4; k++) {
+
+		__m128 top = _mm_add_ps(_mm_mul_ps(t[0][k], iwx), _mm_mul_ps(t[1][k], wx));
+		__m128 bottom = _mm_add_ps(_mm_mul_ps(t[2][k], iwx), _mm_mul_ps(t[3][k], wx));
+
+		colour[k] = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(top, iwy), _mm_mul_ps(bottom, wy)), scale);
+	}
+}
+
+
+uint32_t CGDSoftwareTexture::getWidth() const {
+
+	return width;
+}
+
+
+uint32_t CGDSoftwareTexture::getHeight() const {
+
+	return height;
+}
+
+
+const uint32_t* CGDSoftwareTexture::getTexels() const {
+
+	return texels.data();
+}
@@ -0,0 +1,61 @@
+//
+// CGDSoftwareTexture.h
+//
+
+// RGBA8 texture sampled by the software rasterizer (see CGDSoftwareRasterizer).  Sampling is bilinear from the top level (the Scene samplers are MIN_MAG_MIP_LINEAR / anisotropic, but mips are not modelled so distant textures alias) with wrap, mirror or clamp addressing.  Texel centres are at half-integer coordinates as in D3D.
+
+#pragma once
+
+#include <GUObject.h>
+#include <cstdint>
+#include <vector>
+#include <emmintrin.h>
+
+
+enum class CGDTextureAddress : uint8_t {
+
+	WRAP = 0,
+	MIRROR,
+	CLAMP
+};
+
+
+class CGDSoftwareTexture : public GUObject {
+
+	uint32_t					width;
+	uint32_t					height;
+	CGDTextureAddress			address;
+	std::vector<uint32_t>		texels; // R8G8B8A8 (R in the low byte)
+
+
+	//
+	// Private interface
+	//
+
+	// Constructor - called internally by the CreateTexture factory method
+	CGDSoftwareTexture(uint32_t width, uint32_t height, CGDTextureAddress address);
+
+	// Map integer texel coordinate i into [0, size) according to the address mode
+	int32_t addressTexel(int32_t i, int32_t size) const;
+
+
+public:
+
+	//
+	// Public interface
+	//
+
+	// Factory method.  texels holds width * height R8G8B8A8 values (nullptr = white).  Return nullptr if width or height is 0
+	static CGDSoftwareTexture* CreateTexture(uint32_t width, uint32_t height, const uint32_t *texels, CGDTextureAddress address = CGDTextureAddress::WRAP);
+
+	// Bilinear sample at (u, v).  colour receives r, g, b, a in [0, 1]
+	void sample(float u, float v, float colour[4]) const;
+
+	// Sample 4 coordinates at once.  colour receives r, g, b and a of the 4 samples (structure of arrays)
+	void sample4(__m128 u, __m128 v, __m128 colour[4]) const;
+
+	// Query methods
+	uint32_t getWidth() const;
+	uint32_t getHeight() const;
+	const uint32_t* getTexels() const;
+};
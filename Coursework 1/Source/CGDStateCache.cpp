@@ -0,0 +1,380 @@
+
+//
+// CGDStateCache.cpp
+//
+
+#include <stdafx.h>
+#include <CGDStateCache.h>
+#include <cstring>
+
+using namespace std;
+
+
+// Shadow value of a handle that has not been set (or has been invalidated).  No valid handle has this value so the next set is always issued
+static void *const		unknownHandle = (void*)~(uintptr_t)0;
+
+// Default blend factor (D3D11 uses {1, 1, 1, 1} when no blend factor is given)
+static const float		defaultBlendFactor[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+
+
+
+//
+// Private interface
+//
+
+// Constructor - called internally by the CreateStateCache factory method
+CGDStateCache::CGDStateCache(CGDRenderContext *_context) {
+
+	context = _context;
+	context->retain();
+
+	invalidate();
+}
+
+
+bool CGDStateCache::filterRange(void **shadow, uint32_t numSlots, uint32_t slot, uint32_t count, void *const *handles, uint32_t *first, uint32_t *last) {
+
+	bool changed = false;
+
+	for (uint32_t i = 0; i < count; i++) {
+
+		uint32_t s = slot + i;
+
+		if (s < numSlots && shadow[s] == handles[i])
+			continue;
+
+		if (!changed) {
+
+			*first = i;
+			changed = true;
+		}
+
+		*last = i;
+
+		if (s < numSlots)
+			shadow[s] = handles[i];
+	}
+
+	return changed;
+}
+
+
+
+//
+// Public interface
+//
+
+// Factory method
+CGDStateCache* CGDStateCache::CreateStateCache(CGDRenderContext *context) {
+
+	if (!context)
+		return nullptr;
+
+	return new CGDStateCache(context);
+}
+
+
+// Destructor
+CGDStateCache::~CGDStateCache() {
+
+	context->release();
+}
+
+
+void CGDStateCache::invalidate() {
+
+	inputLayout = unknownHandle;
+	vertexBuffer = unknownHandle;
+	vertexStride = vertexOffset = 0;
+	indexBuffer = unknownHandle;
+	indexFormat = indexOffset = 0;
+	topology = UINT32_MAX;
+
+	for (int s = 0; s < (int)CGDShaderStage::NUM_STAGES; s++) {
+
+		StageState& stage = stages[s];
+
+		stage.shader = unknownHandle;
+
+		for (int i = 0; i < CGD_MAX_CACHED_CONSTANT_BUFFERS; i++) {
+
+			stage.constantBuffers[i] = unknownHandle;
+			stage.firstConstants[i] = 0;
+			stage.numConstants[i] = 0;
+		}
+
+		for (int i = 0; i < CGD_MAX_CACHED_SHADER_RESOURCES; i++)
+			stage.shaderResources[i] = unknownHandle;
+
+		for (int i = 0; i < CGD_MAX_CACHED_SAMPLERS; i++)
+			stage.samplers[i] = unknownHandle;
+	}
+
+	rasterizerState = unknownHandle;
+	depthStencilState = unknownHandle;
+	stencilRef = 0;
+	blendState = unknownHandle;
+	memcpy(blendFactor, defaultBlendFactor, sizeof(blendFactor));
+	sampleMask = 0xFFFFFFFF;
+}
+
+
+void CGDStateCache::setInputLayout(void *layout) {
+
+	if (layout == inputLayout) {
+
+		stats.callsSkipped++;
+		return;
+	}
+
+	inputLayout = layout;
+	context->setInputLayout(layout);
+	stats.callsIssued++;
+}
+
+
+void CGDStateCache::setVertexBuffer(uint32_t slot, void *buffer, uint32_t stride, uint32_t offset) {
+
+	if (slot == 0) {
+
+		if (buffer == vertexBuffer && stride == vertexStride && offset == vertexOffset) {
+
+			stats.callsSkipped++;
+			return;
+		}
+
+		vertexBuffer = buffer;
+		vertexStride = stride;
+		vertexOffset = offset;
+	}
+
+	context->setVertexBuffer(slot, buffer, stride, offset);
+	stats.callsIssued++;
+}
+
+
+void CGDStateCache::setIndexBuffer(void *buffer, uint32_t format, uint32_t offset) {
+
+	if (buffer == indexBuffer && format == indexFormat && offset == indexOffset) {
+
+		stats.callsSkipped++;
+		return;
+	}
+
+	indexBuffer = buffer;
+	indexFormat = format;
+	indexOffset = offset;
+
+	context->setIndexBuffer(buffer, format, offset);
+	stats.callsIssued++;
+}
+
+
+void CGDStateCache::setPrimitiveTopology(uint32_t _topology) {
+
+	if (_topology == topology) {
+
+		stats.callsSkipped++;
+		return;
+	}
+
+	topology = _topology;
+	context->setPrimitiveTopology(topology);
+	stats.callsIssued++;
+}
+
+
+void CGDStateCache::setShader(CGDShaderStage stage, void *shader) {
+
+	StageState& s = stages[(int)stage];
+
+	if (shader == s.shader) {
+
+		stats.callsSkipped++;
+		return;
+	}
+
+	s.shader = shader;
+	context->setShader(stage, shader);
+	stats.callsIssued++;
+}
+
+
+void CGDStateCache::setConstantBuffers(CGDShaderStage stage, uint32_t slot, uint32_t count, void *const *buffers) {
+
+	StageState& s = stages[(int)stage];
+	uint32_t first, last;
+
+	// A slot bound to a range of its buffer changes when the whole buffer is bound
+	for (uint32_t i = slot; i < slot + count && i < CGD_MAX_CACHED_CONSTANT_BUFFERS; i++) {
+
+		if (s.numConstants[i] > 0) {
+
+			s.constantBuffers[i] = unknownHandle;
+			s.firstConstants[i] = 0;
+			s.numConstants[i] = 0;
+		}
+	}
+
+	if (!filterRange(s.constantBuffers, CGD_MAX_CACHED_CONSTANT_BUFFERS, slot, count, buffers, &first, &last)) {
+
+		stats.callsSkipped++;
+		return;
+	}
+
+	context->setConstantBuffers(stage, slot + first, last - first + 1, buffers + first);
+	stats.callsIssued++;
+}
+
+
+void CGDStateCache::setConstantBufferRange(CGDShaderStage stage, uint32_t slot, void *buffer, uint32_t firstConstant, uint32_t numConstants) {
+
+	StageState& s = stages[(int)stage];
+
+	if (slot < CGD_MAX_CACHED_CONSTANT_BUFFERS) {
+
+		if (buffer == s.constantBuffers[slot] && firstConstant == s.firstConstants[slot] && numConstants == s.numConstants[slot]) {
+
+			stats.callsSkipped++;
+			return;
+		}
+
+		s.constantBuffers[slot] = buffer;
+		s.firstConstants[slot] = firstConstant;
+		s.numConstants[slot] = numConstants;
+	}
+
+	context->setConstantBufferRange(stage, slot, buffer, firstConstant, numConstants);
+	stats.callsIssued++;
+}
+
+
+void CGDStateCache::setShaderResources(CGDShaderStage stage, uint32_t slot, uint32_t count, void *const *views) {
+
+	uint32_t first, last;
+
+	if (!filterRange(stages[(int)stage].shaderResources, CGD_MAX_CACHED_SHADER_RESOURCES, slot, count, views, &first, &last)) {
+
+		stats.callsSkipped++;
+		return;
+	}
+
+	context->setShaderResources(stage, slot + first, last - first + 1, views + first);
+	stats.callsIssued++;
+}
+
+
+void CGDStateCache::setSamplers(CGDShaderStage stage, uint32_t slot, uint32_t count, void *const *samplers) {
+
+	uint32_t first, last;
+
+	if (!filterRange(stages[(int)stage].samplers, CGD_MAX_CACHED_SAMPLERS, slot, count, samplers, &first, &last)) {
+
+		stats.callsSkipped++;
+		return;
+	}
+
+	context->setSamplers(stage, slot + first, last - first + 1, samplers + first);
+	stats.callsIssued++;
+}
+
+
+void CGDStateCache::setRasterizerState(void *state) {
+
+	if (state == rasterizerState) {
+
+		stats.callsSkipped++;
+		return;
+	}
+
+	rasterizerState = state;
+	context->setRasterizerState(state);
+	stats.callsIssued++;
+}
+
+
+void CGDStateCache::setDepthStencilState(void *state, uint32_t _stencilRef) {
+
+	if (state == depthStencilState && _stencilRef == stencilRef) {
+
+		stats.callsSkipped++;
+		return;
+	}
+
+	depthStencilState = state;
+	stencilRef = _stencilRef;
+	context->setDepthStencilState(state, stencilRef);
+	stats.callsIssued++;
+}
+
+
+void CGDStateCache::setBlendState(void *state, const float _blendFactor[4], uint32_t _sampleMask) {
+
+	if (!_blendFactor)
+		_blendFactor = defaultBlendFactor;
+
+	if (state == blendState && memcmp(_blendFactor, blendFactor, sizeof(blendFactor)) == 0 && _sampleMask == sampleMask) {
+
+		stats.callsSkipped++;
+		return;
+	}
+
+	blendState = state;
+	memcpy(blendFactor, _blendFactor, sizeof(blendFactor));
+	sampleMask = _sampleMask;
+	context->setBlendState(state, blendFactor, sampleMask);
+	stats.callsIssued++;
+}
+
+
+void CGDStateCache::drawIndexed(uint32_t indexCount, uint32_t startIndex, int32_t baseVertex) {
+
+	context->drawIndexed(indexCount, startIndex, baseVertex);
+	stats.draws++;
+	stats.instances++;
+}
+
+
+void CGDStateCache::drawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t startIndex, int32_t baseVertex, uint32_t startInstance) {
+
+	context->drawIndexedInstanced(indexCount, instanceCount, startIndex, baseVertex, startInstance);
+	stats.draws++;
+	stats.instances += instanceCount;
+}
+
+
+void CGDStateCache::draw(uint32_t vertexCount, uint32_t startVertex) {
+
+	context->draw(vertexCount, startVertex);
+	stats.draws++;
+	stats.instances++;
+}
+
+
+CGDRenderStats CGDStateCache::getStats() const {
+
+	return stats;
+}
+
+
+void CGDStateCache::resetStats() {
+
+	stats = CGDRenderStats();
+}
+
+
+void CGDStateCache::reportStats() const {
+
+	uint64_t calls = stats.callsIssued + stats.callsSkipped;
+	double skipped = (calls > 0) ? 100.0 * (double)stats.callsSkipped / (double)calls : 0.0;
+
+	cout << "State calls issued = " << stats.callsIssued << ", skipped = " << stats.callsSkipped << " (" << skipped << "%), draws = " << stats.draws;
+
+	if (stats.draws > 0)
+		cout << ", issued per draw = " << (double)stats.callsIssued / (double)stats.draws;
+
+	if (stats.instances > stats.draws)
+		cout << ", instances = " << stats.instances;
+
+	cout << endl;
+}
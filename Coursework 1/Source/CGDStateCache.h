@@ -0,0 +1,155 @@
+//
+// CGDStateCache.h
+//
+
+// Redundant state change filtering.  CGDStateCache keeps a shadow copy of the pipeline state it has set on a render context and only forwards a set call if it changes that state.  Ranged calls (constant buffers, shader resources and samplers) are trimmed to the slots that actually change.  Counters record the calls issued to the context against the calls skipped.
+//
+// The shadow state only reflects calls made through the cache.  If the context is used directly (or by another cache) invalidate must be called before the cache is used again so the next set of each state is issued unconditionally.
+//
+// The context is abstracted by CGDRenderContext so the filtering logic does not depend on D3D11 (see DXRenderContext for the D3D11 device context implementation).  Pipeline objects are passed as opaque handles.
+
+#pragma once
+
+#include <GUObject.h>
+#include <cstdint>
+
+
+// Programmable pipeline stages with bindable resources
+enum class CGDShaderStage : uint8_t { VERTEX = 0, PIXEL, GEOMETRY, NUM_STAGES };
+
+
+// Number of slots per stage tracked by CGDStateCache.  Calls that reach beyond these slots are always issued
+#define CGD_MAX_CACHED_CONSTANT_BUFFERS		4
+#define CGD_MAX_CACHED_SHADER_RESOURCES		8
+#define CGD_MAX_CACHED_SAMPLERS				4
+
+
+// Abstract render context
+class CGDRenderContext : public GUObject {
+
+public:
+
+	// Input assembler
+	virtual void setInputLayout(void *layout) = 0;
+	virtual void setVertexBuffer(uint32_t slot, void *buffer, uint32_t stride, uint32_t offset) = 0;
+	virtual void setIndexBuffer(void *buffer, uint32_t format, uint32_t offset) = 0;
+	virtual void setPrimitiveTopology(uint32_t topology) = 0;
+
+	// Shader stages
+	virtual void setShader(CGDShaderStage stage, void *shader) = 0;
+	virtual void setConstantBuffers(CGDShaderStage stage, uint32_t slot, uint32_t count, void *const *buffers) = 0;
+	virtual void setConstantBufferRange(CGDShaderStage stage, uint32_t slot, void *buffer, uint32_t firstConstant, uint32_t numConstants) = 0; // numConstants 16 byte constants from firstConstant (multiples of 16)
+	virtual void setShaderResources(CGDShaderStage stage, uint32_t slot, uint32_t count, void *const *views) = 0;
+	virtual void setSamplers(CGDShaderStage stage, uint32_t slot, uint32_t count, void *const *samplers) = 0;
+
+	// Fixed function state
+	virtual void setRasterizerState(void *state) = 0;
+	virtual void setDepthStencilState(void *state, uint32_t stencilRef) = 0;
+	virtual void setBlendState(void *state, const float blendFactor[4], uint32_t sampleMask) = 0;
+
+	// Draw calls
+	virtual void drawIndexed(uint32_t indexCount, uint32_t startIndex, int32_t baseVertex) = 0;
+	virtual void drawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t startIndex, int32_t baseVertex, uint32_t startInstance) = 0;
+	virtual void draw(uint32_t vertexCount, uint32_t startVertex) = 0;
+};
+
+
+// State cache counters
+struct CGDRenderStats {
+
+	uint64_t				callsIssued = 0; // state calls forwarded to the context
+	uint64_t				callsSkipped = 0; // redundant state calls filtered out
+	uint64_t				draws = 0;
+	uint64_t				instances = 0; // instances drawn (1 per draw that is not instanced)
+};
+
+
+class CGDStateCache : public GUObject {
+
+	// Shadow state of a shader stage
+	struct StageState {
+
+		void				*shader;
+		void				*constantBuffers[CGD_MAX_CACHED_CONSTANT_BUFFERS];
+		uint32_t			firstConstants[CGD_MAX_CACHED_CONSTANT_BUFFERS]; // bound range of each constant buffer (numConstants = 0 for the whole buffer)
+		uint32_t			numConstants[CGD_MAX_CACHED_CONSTANT_BUFFERS];
+		void				*shaderResources[CGD_MAX_CACHED_SHADER_RESOURCES];
+		void				*samplers[CGD_MAX_CACHED_SAMPLERS];
+	};
+
+	CGDRenderContext		*context = nullptr;
+
+	// Shadow state.  Handles are set to an invalid (unknown) handle by invalidate
+	void					*inputLayout;
+	void					*vertexBuffer; // slot 0 only - other slots are always issued
+	uint32_t				vertexStride;
+	uint32_t				vertexOffset;
+	void					*indexBuffer;
+	uint32_t				indexFormat;
+	uint32_t				indexOffset;
+	uint32_t				topology;
+
+	StageState				stages[(int)CGDShaderStage::NUM_STAGES];
+
+	void					*rasterizerState;
+	void					*depthStencilState;
+	uint32_t				stencilRef;
+	void					*blendState;
+	float					blendFactor[4];
+	uint32_t				sampleMask;
+
+	CGDRenderStats			stats;
+
+
+	//
+	// Private interface
+	//
+
+	// Constructor - called internally by the CreateStateCache factory method
+	CGDStateCache(CGDRenderContext *context);
+
+	// Compare count handles starting at slot against the shadow slots.  If any differ update the shadow and return true with the changed sub-range in [*first, *last].  Ranges beyond numSlots are always reported as changed
+	bool filterRange(void **shadow, uint32_t numSlots, uint32_t slot, uint32_t count, void *const *handles, uint32_t *first, uint32_t *last);
+
+
+public:
+
+	//
+	// Public interface
+	//
+
+	// Factory method.  Return nullptr if context is nullptr
+	static CGDStateCache* CreateStateCache(CGDRenderContext *context);
+
+	// Destructor
+	~CGDStateCache();
+
+	// Forget the shadow state so the next set of each state is issued
+	void invalidate();
+
+	// Filtered state calls (see CGDRenderContext)
+	void setInputLayout(void *layout);
+	void setVertexBuffer(uint32_t slot, void *buffer, uint32_t stride, uint32_t offset);
+	void setIndexBuffer(void *buffer, uint32_t format, uint32_t offset);
+	void setPrimitiveTopology(uint32_t topology);
+
+	void setShader(CGDShaderStage stage, void *shader);
+	void setConstantBuffers(CGDShaderStage stage, uint32_t slot, uint32_t count, void *const *buffers);
+	void setConstantBufferRange(CGDShaderStage stage, uint32_t slot, void *buffer, uint32_t firstConstant, uint32_t numConstants);
+	void setShaderResources(CGDShaderStage stage, uint32_t slot, uint32_t count, void *const *views);
+	void setSamplers(CGDShaderStage stage, uint32_t slot, uint32_t count, void *const *samplers);
+
+	void setRasterizerState(void *state);
+	void setDepthStencilState(void *state, uint32_t stencilRef);
+	void setBlendState(void *state, const float blendFactor[4], uint32_t sampleMask);
+
+	// Draw calls are always issued
+	void drawIndexed(uint32_t indexCount, uint32_t startIndex, int32_t baseVertex);
+	void drawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t startIndex, int32_t baseVertex, uint32_t startInstance);
+	void draw(uint32_t vertexCount, uint32_t startVertex);
+
+	// Statistics
+	CGDRenderStats getStats() const;
+	void resetStats();
+	void reportStats() const;
+};
@@ -0,0 +1,384 @@
+
+//
+// CGDTextureCompressor.cpp
+//
+
+#include <stdafx.h>
+#include <CGDTextureCompressor.h>
+#include <CGDJobSystem.h>
+#include <GUBlockCompression.h>
+#include <GUImageDecoder.h>
+#include <GUMipChain.h>
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+
+using namespace std;
+
+
+
+//
+// Private interface
+//
+
+// Constructor - called internally by the CreateTextureCompressor factory method
+CGDTextureCompressor::CGDTextureCompressor(CGDJobSystem *_jobSystem, uint32_t _rowsPerJob) {
+
+	jobSystem = _jobSystem;
+
+	if (jobSystem)
+		jobSystem->retain();
+
+	rowsPerJob = max(_rowsPerJob, 1u);
+}
+
+
+
+//
+// Public interface
+//
+
+// Factory method
+CGDTextureCompressor* CGDTextureCompressor::CreateTextureCompressor(CGDJobSystem *jobSystem, uint32_t rowsPerJob) {
+
+	return new CGDTextureCompressor(jobSystem, rowsPerJob);
+}
+
+
+uint32_t CGDTextureCompressor::ParseFormat(const string& name) {
+
+	string n = name;
+
+	transform(n.begin(), n.end(), n.begin(), ::tolower);
+
+	if (n == "bc1")
+		return GU_DXGI_FORMAT_BC1_UNORM;
+	if (n == "bc3")
+		return GU_DXGI_FORMAT_BC3_UNORM;
+	if (n == "bc4")
+		return GU_DXGI_FORMAT_BC4_UNORM;
+	if (n == "bc5")
+		return GU_DXGI_FORMAT_BC5_UNORM;
+	if (n == "bc7")
+		return GU_DXGI_FORMAT_BC7_UNORM;
+
+	return GU_DXGI_FORMAT_UNKNOWN;
+}
+
+
+const char* CGDTextureCompressor::FormatName(uint32_t format) {
+
+	switch (format) {
+
+		case GU_DXGI_FORMAT_BC1_UNORM:
+		case GU_DXGI_FORMAT_BC1_UNORM_SRGB:
+			return "BC1";
+
+		case GU_DXGI_FORMAT_BC3_UNORM:
+		case GU_DXGI_FORMAT_BC3_UNORM_SRGB:
+			return "BC3";
+
+		case GU_DXGI_FORMAT_BC4_UNORM:
+			return "BC4";
+
+		case GU_DXGI_FORMAT_BC5_UNORM:
+			return "BC5";
+
+		case GU_DXGI_FORMAT_BC7_UNORM:
+		case GU_DXGI_FORMAT_BC7_UNORM_SRGB:
+			return "BC7";
+	}
+
+	return "unknown";
+}
+
+
+uint32_t CGDTextureCompressor::ChooseFormat(const string& filename, uint32_t width, uint32_t height, const uint8_t *rgba) {
+
+	string name = filename;
+
+	transform(name.begin(), name.end(), name.begin(), ::tolower);
+
+	if (name.find("normal") != string::npos)
+		return GU_DXGI_FORMAT_BC5_UNORM;
+
+	bool grey = true, opaque = true;
+
+	for (size_t i = 0; i < (size_t)width * height; i++) {
+
+		const uint8_t *t = rgba + i * 4;
+
+		grey = grey && t[0] == t[1] && t[1] == t[2];
+		opaque = opaque && t[3] == 255;
+	}
+
+	if (!opaque)
+		return GU_DXGI_FORMAT_BC3_UNORM;
+
+	return (grey) ? GU_DXGI_FORMAT_BC4_UNORM : GU_DXGI_FORMAT_BC1_UNORM;
+}
+
+
+double CGDTextureCompressor::PSNR(uint32_t format, uint32_t width, uint32_t height, const uint8_t *original, const uint8_t *decoded) {
+
+	uint32_t channels;
+
+	switch (format) {
+
+		case GU_DXGI_FORMAT_BC4_UNORM:
+			channels = 1;
+			break;
+
+		case GU_DXGI_FORMAT_BC5_UNORM:
+			channels = 2;
+			break;
+
+		case GU_DXGI_FORMAT_BC1_UNORM:
+		case GU_DXGI_FORMAT_BC1_UNORM_SRGB:
+			channels = 3;
+			break;
+
+		default:
+			channels = 4;
+			break;
+	}
+
+	double error = 0.0;
+
+	for (size_t i = 0; i < (size_t)width * height; i++) {
+
+		for (uint32_t c = 0; c < channels; c++) {
+
+			double d = (double)original[i * 4 + c] - (double)decoded[i * 4 + c];
+
+			error += d * d;
+		}
+	}
+
+	double mse = error / ((double)width * height * channels);
+
+	return (mse > 0.0) ? 10.0 * log10(255.0 * 255.0 / mse) : numeric_limits<double>::infinity();
+}
+
+
+void CGDTextureCompressor::ReportStats(const string& name, const CGDTextureCompressionStats& stats) {
+
+	ostringstream line;
+
+	line << name << ": " << FormatName(stats.format) << " " << stats.width << "x" << stats.height << " (" << stats.mipCount << " mips) " << stats.uncompressedBytes / 1024 << " KB -> " << stats.compressedBytes / 1024 << " KB, PSNR " << fixed << setprecision(2) << stats.psnr << " dB, " << (double)stats.texels / max(stats.encodeSeconds, 1e-9) / 1.0e6 << " Mtexels/s";
+
+	cout << line.str() << endl;
+}
+
+
+// Destructor
+CGDTextureCompressor::~CGDTextureCompressor() {
+
+	if (jobSystem)
+		jobSystem->release();
+}
+
+
+bool CGDTextureCompressor::compress(uint32_t format, uint32_t width, uint32_t height, const uint8_t *rgba, const gu_mip_options *mipOptions, gu_dds_info& info, vector<uint8_t>& data, CGDTextureCompressionStats *stats) {
+
+	PROFILE_SCOPE("CGDTextureCompressor::compress");
+	GU_MEMORY_TAG_SCOPE(gu_mem_texture);
+
+	if (gu_bc_block_bytes(format) == 0 || width == 0 || height == 0)
+		return false;
+
+	vector<vector<uint8_t> > mips;
+
+	if (mipOptions)
+		gu_mip_generate(width, height, rgba, *mipOptions, mips);
+	else
+		mips.push_back(vector<uint8_t>(rgba, rgba + (size_t)width * height * 4));
+
+	info.width = width;
+	info.height = height;
+	info.depth = 1;
+	info.mipCount = (uint32_t)mips.size();
+	info.arraySize = 1;
+	info.format = format;
+	info.cubeMap = false;
+	info.volume = false;
+	info.dataOffset = 0;
+
+	data.assign(gu_dds_mip_offset(info, info.mipCount), 0);
+
+	bool parallel = jobSystem && jobSystem->workerCount() > 0;
+	CGDJobCounter counter;
+	gu_time_index start = CGDClock::ActualTime();
+
+	for (uint32_t m = 0; m < info.mipCount; m++) {
+
+		uint32_t w = max(width >> m, 1u), h = max(height >> m, 1u);
+		uint32_t blockRows = (h + 3) / 4;
+		const uint8_t *src = mips[m].data();
+		uint8_t *dst = data.data() + gu_dds_mip_offset(info, m);
+
+		for (uint32_t row = 0; row < blockRows; row += rowsPerJob) {
+
+			uint32_t lastRow = min(row + rowsPerJob, blockRows);
+
+			auto job = [=]() { gu_bc_compress_rows(format, w, h, src, (size_t)w * 4, row, lastRow, dst); };
+
+			if (parallel)
+				jobSystem->run(job, &counter);
+			else
+				job();
+		}
+	}
+
+	if (parallel)
+		jobSystem->wait(&counter);
+
+	gu_time_index end = CGDClock::ActualTime();
+
+	if (stats) {
+
+		stats->format = format;
+		stats->width = width;
+		stats->height = height;
+		stats->mipCount = info.mipCount;
+		stats->texels = 0;
+		stats->uncompressedBytes = 0;
+
+		for (size_t m = 0; m < mips.size(); m++) {
+
+			stats->texels += mips[m].size() / 4;
+			stats->uncompressedBytes += mips[m].size();
+		}
+
+		stats->compressedBytes = data.size();
+		stats->encodeSeconds = (double)(end - start) / (double)CGDClock::ActualTimeFrequency();
+
+		vector<uint8_t> decoded((size_t)width * height * 4);
+
+		gu_bc_decompress(format, width, height, data.data(), decoded.data());
+		stats->psnr = PSNR(format, width, height, rgba, decoded.data());
+	}
+
+	return true;
+}
+
+
+bool CGDTextureCompressor::compressFile(const string& input, const string& output, uint32_t format, CGDTextureCompressionStats *stats) {
+
+	uint32_t width, height;
+	vector<uint8_t> rgba;
+
+	if (!gu_image_read_rgba(input.c_str(), width, height, rgba))
+		return false;
+
+	if (format == GU_DXGI_FORMAT_UNKNOWN)
+		format = ChooseFormat(input, width, height, rgba.data());
+
+	gu_mip_options mipOptions = gu_mip_default_options(input.c_str(), width, height, rgba.data());
+	gu_dds_info info;
+	vector<uint8_t> data;
+	CGDTextureCompressionStats s;
+
+	if (!compress(format, width, height, rgba.data(), &mipOptions, info, data, &s)) {
+
+		cout << "Cannot compress " << input << " to " << FormatName(format) << endl;
+		return false;
+	}
+
+	if (!gu_dds_write(output.c_str(), info, data))
+		return false;
+
+	ReportStats(output, s);
+
+	if (stats)
+		*stats = s;
+
+	return true;
+}
+
+
+bool CGDTextureCompressor::benchmark(const vector<string>& files, double minPSNR) {
+
+	static const uint32_t formats[] = { GU_DXGI_FORMAT_BC1_UNORM, GU_DXGI_FORMAT_BC3_UNORM, GU_DXGI_FORMAT_BC5_UNORM, GU_DXGI_FORMAT_BC7_UNORM };
+	static const uint32_t numFormats = sizeof(formats) / sizeof(formats[0]);
+
+	double totalPSNR[numFormats] = {}, totalSeconds[numFormats] = {};
+	uint64_t totalTexels[numFormats] = {};
+	uint32_t images = 0;
+	bool passed = true;
+
+	cout << "\nTexture compression benchmark (" << ((jobSystem) ? jobSystem->workerCount() : 0) << " worker threads)...\n";
+
+	for (size_t i = 0; i < files.size(); i++) {
+
+		uint32_t width, height;
+		vector<uint8_t> rgba;
+
+		if (!gu_image_read_rgba(files[i].c_str(), width, height, rgba)) {
+
+			cout << "Cannot read " << files[i] << endl;
+			passed = false;
+			continue;
+		}
+
+		images++;
+
+		gu_mip_options mipOptions = gu_mip_default_options(files[i].c_str(), width, height, rgba.data());
+
+		// Mip chain generation throughput with each filter (mip 0 pixels per second)
+		for (int filter = gu_mip_box; filter <= gu_mip_kaiser; filter++) {
+
+			gu_mip_options options = mipOptions;
+			vector<vector<uint8_t> > mips;
+
+			options.filter = (gu_mip_filter)filter;
+
+			gu_time_index start = CGDClock::ActualTime();
+
+			gu_mip_generate(width, height, rgba.data(), options, mips);
+
+			double seconds = (double)(CGDClock::ActualTime() - start) / (double)CGDClock::ActualTimeFrequency();
+			ostringstream line;
+
+			line << files[i] << ": " << ((filter == gu_mip_box) ? "box" : "Kaiser") << " mip chain (" << mips.size() << " mips) " << fixed << setprecision(2) << (double)width * height / max(seconds, 1e-9) / 1.0e6 << " Mpixels/s";
+
+			cout << line.str() << endl;
+		}
+
+		for (uint32_t f = 0; f < numFormats; f++) {
+
+			gu_dds_info info;
+			vector<uint8_t> data;
+			CGDTextureCompressionStats stats;
+
+			compress(formats[f], width, height, rgba.data(), &mipOptions, info, data, &stats);
+			ReportStats(files[i], stats);
+
+			if (stats.psnr < minPSNR) {
+
+				cout << files[i] << ": " << FormatName(formats[f]) << " PSNR is below " << minPSNR << " dB" << endl;
+				passed = false;
+			}
+
+			totalPSNR[f] += stats.psnr;
+			totalSeconds[f] += stats.encodeSeconds;
+			totalTexels[f] += stats.texels;
+		}
+	}
+
+	if (images == 0)
+		return false;
+
+	for (uint32_t f = 0; f < numFormats; f++) {
+
+		ostringstream line;
+
+		line << FormatName(formats[f]) << ": mean PSNR " << fixed << setprecision(2) << totalPSNR[f] / images << " dB, " << (double)totalTexels[f] / max(totalSeconds[f], 1e-9) / 1.0e6 << " Mtexels/s";
+
+		cout << line.str() << endl;
+	}
+
+	return passed;
+}
@@ -0,0 +1,81 @@
+//
+// CGDTextureCompressor.h
+//
+
+// Offline texture compressor.  An image is given a full mip chain (see GUMipChain) and each mip is compressed to BC1, BC3, BC4, BC5 or BC7 (see GUBlockCompression) on the job system - every job encodes a band of block rows and the bands of all the mips are queued together so small mips do not serialise the work.  compressFile writes the result as a DDS file, which Texture loads (and CGDTextureStreamer streams) in place of the source image.  The compressor has no D3D or WIC dependency so it also runs on Linux; input images are read with GUImageDecoder (PNG, JPEG, BMP or TIFF).
+//
+// benchmark compresses a set of images to each format and reports the error (PSNR of mip 0 over the channels the format stores) and the encode throughput, and the throughput of mip chain generation with each filter.
+
+#pragma once
+
+#include <GUObject.h>
+#include <GUDDSFile.h>
+#include <GUMipChain.h>
+#include <string>
+#include <vector>
+
+class CGDJobSystem;
+
+
+// Result of compressing one image
+struct CGDTextureCompressionStats {
+
+	uint32_t				format = 0;
+	uint32_t				width = 0;
+	uint32_t				height = 0;
+	uint32_t				mipCount = 0;
+	uint64_t				texels = 0; // in all mips
+	size_t					uncompressedBytes = 0; // RGBA8 with the same mips
+	size_t					compressedBytes = 0;
+	double					encodeSeconds = 0.0; // block compression of all mips (excludes mip generation and file IO)
+	double					psnr = 0.0; // dB
+};
+
+
+class CGDTextureCompressor : public GUObject {
+
+	CGDJobSystem					*jobSystem = nullptr; // nullptr = compress on the calling thread
+	uint32_t						rowsPerJob;
+
+
+	//
+	// Private interface
+	//
+
+	// Constructor - called internally by the CreateTextureCompressor factory method
+	CGDTextureCompressor(CGDJobSystem *jobSystem, uint32_t rowsPerJob);
+
+
+public:
+
+	//
+	// Public interface
+	//
+
+	// Factory method.  The job system (if given) is retained.  rowsPerJob is the number of block rows each job compresses
+	static CGDTextureCompressor* CreateTextureCompressor(CGDJobSystem *jobSystem = nullptr, uint32_t rowsPerJob = 4);
+
+	// Format from its name ("bc1", "bc3", "bc4", "bc5" or "bc7").  Return GU_DXGI_FORMAT_UNKNOWN for other names
+	static uint32_t ParseFormat(const std::string& name);
+	static const char* FormatName(uint32_t format);
+
+	// Default format for an image - BC5 for normal maps (file names containing "normal"), BC4 for greyscale images, BC3 if any texel is not opaque and BC1 otherwise
+	static uint32_t ChooseFormat(const std::string& filename, uint32_t width, uint32_t height, const uint8_t *rgba);
+
+	// Peak signal to noise ratio of decoded against original (width x height RGBA8) over the channels format stores
+	static double PSNR(uint32_t format, uint32_t width, uint32_t height, const uint8_t *original, const uint8_t *decoded);
+
+	static void ReportStats(const std::string& name, const CGDTextureCompressionStats& stats);
+
+	// Destructor
+	~CGDTextureCompressor();
+
+	// Compress a width x height RGBA8 image (with a full mip chain built with mipOptions, or mip 0 only if mipOptions is nullptr) into data, laid out as DDS mips (see gu_dds_write), and describe it in info.  Return false if the format is not supported
+	bool compress(uint32_t format, uint32_t width, uint32_t height, const uint8_t *rgba, const gu_mip_options *mipOptions, gu_dds_info& info, std::vector<uint8_t>& data, CGDTextureCompressionStats *stats = nullptr);
+
+	// Compress input to a DDS file with a full mip chain (see gu_mip_default_options).  format = GU_DXGI_FORMAT_UNKNOWN chooses one (see ChooseFormat).  Return false on failure
+	bool compressFile(const std::string& input, const std::string& output, uint32_t format = GU_DXGI_FORMAT_UNKNOWN, CGDTextureCompressionStats *stats = nullptr);
+
+	// Compress each file to BC1, BC3, BC5 and BC7 and report PSNR and throughput per file and format, and mip generation throughput per file and filter.  Return false if no files are given, a file cannot be read or any file compresses to a format with a PSNR below minPSNR
+	bool benchmark(const std::vector<std::string>& files, double minPSNR = 0.0);
+};
@@ -0,0 +1,472 @@
+
+//
+// CGDTextureStreamer.cpp
+//
+
+#include <stdafx.h>
+#include <CGDTextureStreamer.h>
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+
+// requestedMip value when a texture has not been requested since the last update
+static const uint32_t			noRequest = 0xFFFFFFFF;
+
+
+
+//
+// Private interface
+//
+
+// Constructor - called internally by the CreateTextureStreamer factory method
+CGDTextureStreamer::CGDTextureStreamer(CGDTextureStreamingBackend *_backend, size_t budgetBytes, CGDJobSystem *_jobSystem, uint32_t _tailSize, uint32_t _maxLoadsInFlight) {
+
+	backend = _backend;
+	backend->retain();
+
+	jobSystem = _jobSystem;
+
+	if (jobSystem)
+		jobSystem->retain();
+
+	budget = budgetBytes;
+	tailSize = max(_tailSize, 1u);
+	maxLoadsInFlight = max(_maxLoadsInFlight, 1u);
+
+	gu_time_index frequency = CGDClock::ActualTimeFrequency();
+
+	secondsPerTick = (frequency > 0) ? 1.0 / (gu_seconds)frequency : 0.0;
+}
+
+
+size_t CGDTextureStreamer::MipRangeBytes(const StreamedTexture *t, uint32_t firstMip, uint32_t lastMip) {
+
+	size_t bytes = 0;
+
+	for (uint32_t i = firstMip; i < lastMip; i++)
+		bytes += t->desc.mipBytes[i];
+
+	return bytes;
+}
+
+
+void CGDTextureStreamer::startLoad(StreamedTexture *t, uint32_t mip) {
+
+	uint32_t lastMip = t->residentMip - 1;
+
+	t->loading = true;
+	t->loadMip = mip;
+	t->loadSucceeded = false;
+	t->loadStart = CGDClock::ActualTime();
+
+	reservedBytes += MipRangeBytes(t, mip, t->residentMip);
+	loadsInFlight++;
+	stats.loadsStarted++;
+
+	CGDTextureStreamingBackend *b = backend;
+
+	auto load = [b, t, mip, lastMip]() {
+
+		GU_MEMORY_TAG_SCOPE(gu_mem_texture);
+
+		t->loadSucceeded = b->loadMips(t->backendTexture, mip, lastMip, t->loadData);
+	};
+
+	// Without workers a queued job would not run until the next wait so load on this thread instead
+	if (jobSystem && jobSystem->workerCount() > 0)
+		jobSystem->run(load, &t->loadCounter);
+	else
+		load();
+}
+
+
+bool CGDTextureStreamer::completeLoad(StreamedTexture *t) {
+
+	size_t bytes = MipRangeBytes(t, t->loadMip, t->residentMip);
+	double latency = (double)(CGDClock::ActualTime() - t->loadStart) * secondsPerTick * 1000.0;
+	bool committed = false;
+
+	t->loading = false;
+	loadsInFlight--;
+	reservedBytes -= bytes;
+
+	if (t->loadSucceeded && backend->commitMips(t->backendTexture, t->loadMip, t->residentMip, t->loadData)) {
+
+		residentBytes += bytes;
+		t->residentMip = t->loadMip;
+
+		stats.loadsCompleted++;
+		stats.bytesLoaded += bytes;
+
+		totalLoadLatency += latency;
+		stats.maxLoadLatency = max(stats.maxLoadLatency, latency);
+
+		committed = true;
+
+	} else {
+
+		stats.loadsFailed++;
+	}
+
+	vector<uint8_t>().swap(t->loadData);
+
+	return committed;
+}
+
+
+bool CGDTextureStreamer::evict(StreamedTexture *t, uint32_t mip) {
+
+	static const vector<uint8_t> noData;
+
+	if (mip <= t->residentMip || !backend->commitMips(t->backendTexture, mip, t->residentMip, noData))
+		return false;
+
+	residentBytes -= MipRangeBytes(t, t->residentMip, mip);
+	t->residentMip = mip;
+	stats.evictions++;
+
+	return true;
+}
+
+
+bool CGDTextureStreamer::makeRoom(size_t bytes, const StreamedTexture *t, uint32_t& changes) {
+
+	if (residentBytes + reservedBytes + bytes <= budget)
+		return true;
+
+	// Trim textures holding more detail than they were last asked for, least recently used first
+	vector<StreamedTexture*> overResident;
+
+	for (size_t i = 0; i < textures.size(); i++) {
+
+		StreamedTexture *u = textures[i];
+
+		if (u && u != t && !u->loading && u->residentMip < u->wantedMip)
+			overResident.push_back(u);
+	}
+
+	stable_sort(overResident.begin(), overResident.end(), [](const StreamedTexture *a, const StreamedTexture *b) { return a->lastRequestFrame < b->lastRequestFrame; });
+
+	for (size_t i = 0; i < overResident.size(); i++) {
+
+		if (evict(overResident[i], overResident[i]->wantedMip))
+			changes++;
+
+		if (residentBytes + reservedBytes + bytes <= budget)
+			return true;
+	}
+
+	// Reduce lower priority textures a mip at a time.  Textures requested in the same frame as t are never evicted for it so equal priority textures cannot thrash
+	while (residentBytes + reservedBytes + bytes > budget) {
+
+		StreamedTexture *victim = nullptr;
+
+		for (size_t i = 0; i < textures.size(); i++) {
+
+			StreamedTexture *u = textures[i];
+
+			if (!u || u == t || u->loading || u->residentMip >= u->tailMip)
+				continue;
+
+			if (t && u->lastRequestFrame >= t->lastRequestFrame)
+				continue;
+
+			if (!victim || u->lastRequestFrame < victim->lastRequestFrame || (u->lastRequestFrame == victim->lastRequestFrame && u->residentMip < victim->residentMip))
+				victim = u;
+		}
+
+		if (!victim || !evict(victim, victim->residentMip + 1))
+			return false;
+
+		changes++;
+	}
+
+	return true;
+}
+
+
+
+//
+// Public interface
+//
+
+// Factory method
+CGDTextureStreamer* CGDTextureStreamer::CreateTextureStreamer(CGDTextureStreamingBackend *backend, size_t budgetBytes, CGDJobSystem *jobSystem, uint32_t tailSize, uint32_t maxLoadsInFlight) {
+
+	if (!backend)
+		return nullptr;
+
+	return new CGDTextureStreamer(backend, budgetBytes, jobSystem, tailSize, maxLoadsInFlight);
+}
+
+
+uint32_t CGDTextureStreamer::MipForScreenSize(uint32_t width, uint32_t height, float screenWidth, float screenHeight) {
+
+	if (screenWidth <= 0.0f || screenHeight <= 0.0f)
+		return CGD_MAX_TEXTURE_MIPS - 1;
+
+	float texelsPerPixel = max((float)width / screenWidth, (float)height / screenHeight);
+
+	if (texelsPerPixel <= 1.0f)
+		return 0;
+
+	return min((uint32_t)floor(log2(texelsPerPixel)), (uint32_t)(CGD_MAX_TEXTURE_MIPS - 1));
+}
+
+
+uint32_t CGDTextureStreamer::MipForDistance(uint32_t width, uint32_t height, float worldSize, float distance, float fovY, float viewportHeight) {
+
+	if (distance <= 0.0f)
+		return 0;
+
+	float screenSize = worldSize * viewportHeight / (2.0f * distance * tan(fovY * 0.5f));
+
+	return MipForScreenSize(width, height, screenSize, screenSize);
+}
+
+
+// Destructor
+CGDTextureStreamer::~CGDTextureStreamer() {
+
+	for (size_t i = 0; i < textures.size(); i++) {
+
+		if (!textures[i])
+			continue;
+
+		if (textures[i]->loading && jobSystem)
+			jobSystem->wait(&textures[i]->loadCounter);
+
+		delete textures[i];
+	}
+
+	if (jobSystem)
+		jobSystem->release();
+
+	backend->release();
+}
+
+
+uint32_t CGDTextureStreamer::registerTexture(const CGDStreamedTextureDesc& desc, void *backendTexture) {
+
+	if (!backendTexture || desc.width == 0 || desc.height == 0 || desc.mipCount == 0 || desc.mipCount > CGD_MAX_TEXTURE_MIPS)
+		return CGD_INVALID_STREAMED_TEXTURE;
+
+	StreamedTexture *t = new StreamedTexture();
+
+	t->backendTexture = backendTexture;
+	t->desc = desc;
+	t->tailMip = desc.mipCount - 1;
+
+	for (uint32_t i = 0; i < desc.mipCount; i++) {
+
+		if (max(desc.width >> i, desc.height >> i) <= tailSize) {
+
+			t->tailMip = i;
+			break;
+		}
+	}
+
+	t->residentMip = desc.mipCount;
+	t->wantedMip = t->tailMip;
+	t->requestedMip.store(noRequest, memory_order_relaxed);
+
+	// The mip tail is always resident
+	vector<uint8_t> data;
+
+	if (!backend->loadMips(backendTexture, t->tailMip, desc.mipCount - 1, data) || !backend->commitMips(backendTexture, t->tailMip, desc.mipCount, data)) {
+
+		delete t;
+		return CGD_INVALID_STREAMED_TEXTURE;
+	}
+
+	t->residentMip = t->tailMip;
+	residentBytes += MipRangeBytes(t, t->tailMip, desc.mipCount);
+	stats.fullResidencyBytes += MipRangeBytes(t, 0, desc.mipCount);
+	stats.peakResidentBytes = max(stats.peakResidentBytes, residentBytes);
+
+	for (uint32_t i = 0; i < textures.size(); i++) {
+
+		if (!textures[i]) {
+
+			textures[i] = t;
+			return i;
+		}
+	}
+
+	textures.push_back(t);
+
+	return (uint32_t)textures.size() - 1;
+}
+
+
+void CGDTextureStreamer::unregisterTexture(uint32_t id) {
+
+	if (id >= textures.size() || !textures[id])
+		return;
+
+	StreamedTexture *t = textures[id];
+
+	if (t->loading) {
+
+		if (jobSystem)
+			jobSystem->wait(&t->loadCounter);
+
+		loadsInFlight--;
+		reservedBytes -= MipRangeBytes(t, t->loadMip, t->residentMip);
+	}
+
+	residentBytes -= MipRangeBytes(t, t->residentMip, t->desc.mipCount);
+	stats.fullResidencyBytes -= MipRangeBytes(t, 0, t->desc.mipCount);
+
+	delete t;
+	textures[id] = nullptr;
+}
+
+
+void CGDTextureStreamer::requestMip(uint32_t id, uint32_t mip) {
+
+	if (id >= textures.size() || !textures[id])
+		return;
+
+	atomic<uint32_t>& requested = textures[id]->requestedMip;
+	uint32_t current = requested.load(memory_order_relaxed);
+
+	while (mip < current && !requested.compare_exchange_weak(current, mip, memory_order_relaxed)) {}
+}
+
+
+uint32_t CGDTextureStreamer::update() {
+
+	PROFILE_SCOPE("CGDTextureStreamer::update");
+
+	uint32_t changes = 0;
+
+	frame++;
+
+	// Commit completed loads
+	for (size_t i = 0; i < textures.size(); i++) {
+
+		StreamedTexture *t = textures[i];
+
+		if (t && t->loading && t->loadCounter.done() && completeLoad(t))
+			changes++;
+	}
+
+	// Latch this frame's requests
+	for (size_t i = 0; i < textures.size(); i++) {
+
+		StreamedTexture *t = textures[i];
+
+		if (!t)
+			continue;
+
+		uint32_t requested = t->requestedMip.exchange(noRequest, memory_order_relaxed);
+
+		if (requested != noRequest) {
+
+			t->wantedMip = min(requested, t->tailMip);
+			t->lastRequestFrame = frame;
+		}
+	}
+
+	// Enforce a reduced budget
+	makeRoom(0, nullptr, changes);
+
+	// Load the textures requested this frame that need more detail, largest shortfall first.  Textures no longer requested keep what they have until the budget needs it
+	vector<StreamedTexture*> candidates;
+
+	for (size_t i = 0; i < textures.size(); i++) {
+
+		StreamedTexture *t = textures[i];
+
+		if (t && !t->loading && t->lastRequestFrame == frame && t->wantedMip < t->residentMip)
+			candidates.push_back(t);
+	}
+
+	stable_sort(candidates.begin(), candidates.end(), [](const StreamedTexture *a, const StreamedTexture *b) { return (a->residentMip - a->wantedMip) > (b->residentMip - b->wantedMip); });
+
+	for (size_t i = 0; i < candidates.size() && loadsInFlight < maxLoadsInFlight; i++) {
+
+		StreamedTexture *t = candidates[i];
+		uint32_t mip = t->wantedMip;
+
+		// Load as much of the request as fits in the budget
+		while (mip < t->residentMip && !makeRoom(MipRangeBytes(t, mip, t->residentMip), t, changes))
+			mip++;
+
+		if (mip < t->residentMip)
+			startLoad(t, mip);
+	}
+
+	// Loads run on this thread (or that have already finished) are committed straight away
+	for (size_t i = 0; i < textures.size(); i++) {
+
+		StreamedTexture *t = textures[i];
+
+		if (t && t->loading && t->loadCounter.done() && completeLoad(t))
+			changes++;
+	}
+
+	stats.peakResidentBytes = max(stats.peakResidentBytes, residentBytes);
+
+	return changes;
+}
+
+
+void CGDTextureStreamer::setBudget(size_t budgetBytes) {
+
+	budget = budgetBytes;
+}
+
+
+size_t CGDTextureStreamer::getBudget() const {
+
+	return budget;
+}
+
+
+uint32_t CGDTextureStreamer::residentMip(uint32_t id) const {
+
+	return textures[id]->residentMip;
+}
+
+
+const CGDStreamedTextureDesc& CGDTextureStreamer::getDesc(uint32_t id) const {
+
+	return textures[id]->desc;
+}
+
+
+bool CGDTextureStreamer::idle() const {
+
+	return loadsInFlight == 0;
+}
+
+
+CGDTextureStreamerStats CGDTextureStreamer::getStats() const {
+
+	CGDTextureStreamerStats s = stats;
+
+	s.textures = 0;
+
+	for (size_t i = 0; i < textures.size(); i++)
+		if (textures[i])
+			s.textures++;
+
+	s.budgetBytes = budget;
+	s.residentBytes = residentBytes;
+	s.meanLoadLatency = (stats.loadsCompleted > 0) ? totalLoadLatency / (double)stats.loadsCompleted : 0.0;
+
+	return s;
+}
+
+
+void CGDTextureStreamer::reportStats() const {
+
+	CGDTextureStreamerStats s = getStats();
+
+	cout << "Texture streaming: " << s.textures << " textures, " << s.residentBytes / 1024 << " KB resident of " << s.fullResidencyBytes / 1024 << " KB (peak " << s.peakResidentBytes / 1024 << " KB, budget " << s.budgetBytes / 1024 << " KB)" << endl;
+	cout << "Loads: " << s.loadsStarted << " started, " << s.loadsCompleted << " completed, " << s.loadsFailed << " failed, " << s.bytesLoaded / 1024 << " KB loaded, latency " << s.meanLoadLatency << " ms mean, " << s.maxLoadLatency << " ms max.  Evictions: " << s.evictions << endl;
+}
@@ -0,0 +1,170 @@
+//
+// CGDTextureStreamer.h
+//
+
+// Texture streaming manager.  Each registered texture always keeps its mip tail (the mips no larger than tailSize texels) resident and the more detailed mips are brought in and out under a global memory budget.  Renderers report the mip each texture needs every frame (requestMip - see MipForScreenSize and MipForDistance for estimates from screen coverage and distance) and update() turns the requests into residency changes: completed loads are committed, textures requested this frame that need more detail are loaded asynchronously on the job system (largest shortfall first) and when a load does not fit in the budget the least recently used textures give up their excess mips.  Textures that are never requested cost only their mip tail.
+//
+// Loading and committing mips is delegated to a CGDTextureStreamingBackend - DXTextureStreamingBackend reads DDS files and recreates the D3D11 texture with the new mip range - so residency decisions and budget enforcement do not depend on D3D.  requestMip may be called from any thread; all other methods must be called from the thread that owns the backend (the render thread).
+
+#pragma once
+
+#include <GUObject.h>
+#include <CGDClock.h>
+#include <CGDJobSystem.h>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+
+#define CGD_MAX_TEXTURE_MIPS				16
+#define CGD_INVALID_STREAMED_TEXTURE		0xFFFFFFFF
+
+
+// Streamed texture description.  mipBytes[i] is the memory used by mip i when resident
+struct CGDStreamedTextureDesc {
+
+	uint32_t				width;
+	uint32_t				height;
+	uint32_t				mipCount;
+	size_t					mipBytes[CGD_MAX_TEXTURE_MIPS];
+};
+
+
+// Loads and commits the mips of streamed textures (texture is the backend's handle passed to CGDTextureStreamer::registerTexture)
+class CGDTextureStreamingBackend : public GUObject {
+
+public:
+
+	// Read mips [firstMip, lastMip] of texture into data.  Called on a job system worker so must only read immutable texture state.  Return false on failure
+	virtual bool loadMips(void *texture, uint32_t firstMip, uint32_t lastMip, std::vector<uint8_t>& data) = 0;
+
+	// Make mips [residentMip, mipCount) of texture resident.  If residentMip < previousMip data holds mips [residentMip, previousMip - 1] as returned by loadMips, otherwise data is empty and the mips above residentMip are evicted.  previousMip = mipCount when the texture has no resident mips.  Called from CGDTextureStreamer::update on the owning thread.  Return false on failure (the residency is unchanged)
+	virtual bool commitMips(void *texture, uint32_t residentMip, uint32_t previousMip, const std::vector<uint8_t>& data) = 0;
+};
+
+
+// Streaming statistics (bytes and milliseconds)
+struct CGDTextureStreamerStats {
+
+	uint32_t				textures = 0;
+	size_t					budgetBytes = 0;
+	size_t					residentBytes = 0;
+	size_t					peakResidentBytes = 0;
+	size_t					fullResidencyBytes = 0; // memory needed with every mip of every texture resident
+	uint64_t				loadsStarted = 0;
+	uint64_t				loadsCompleted = 0;
+	uint64_t				loadsFailed = 0;
+	uint64_t				bytesLoaded = 0;
+	uint64_t				evictions = 0; // residency reductions
+	double					meanLoadLatency = 0.0; // from the load being issued to it being committed
+	double					maxLoadLatency = 0.0;
+};
+
+
+class CGDTextureStreamer : public GUObject {
+
+	struct StreamedTexture {
+
+		void								*backendTexture = nullptr; // nullptr if the slot is free
+		CGDStreamedTextureDesc				desc;
+		uint32_t							tailMip = 0; // first mip of the always resident tail
+		uint32_t							residentMip = 0;
+		uint32_t							wantedMip = 0; // from the most recent request
+		std::atomic<uint32_t>				requestedMip; // most detailed mip requested since the last update (noRequest if none)
+		uint64_t							lastRequestFrame = 0;
+
+		// In-flight load of mips [loadMip, residentMip - 1]
+		bool								loading = false;
+		uint32_t							loadMip = 0;
+		bool								loadSucceeded = false;
+		std::vector<uint8_t>				loadData;
+		CGDJobCounter						loadCounter;
+		gu_time_index						loadStart = 0;
+
+		StreamedTexture() : requestedMip(0) {}
+	};
+
+	CGDTextureStreamingBackend				*backend = nullptr;
+	CGDJobSystem							*jobSystem = nullptr; // nullptr = load on the update thread
+	size_t									budget;
+	uint32_t								tailSize;
+	uint32_t								maxLoadsInFlight;
+
+	std::vector<StreamedTexture*>			textures;
+	uint64_t								frame = 0;
+	uint32_t								loadsInFlight = 0;
+	size_t									residentBytes = 0;
+	size_t									reservedBytes = 0; // memory of the mips being loaded
+	gu_seconds								secondsPerTick;
+
+	CGDTextureStreamerStats					stats;
+	double									totalLoadLatency = 0.0;
+
+
+	//
+	// Private interface
+	//
+
+	// Constructor - called internally by the CreateTextureStreamer factory method
+	CGDTextureStreamer(CGDTextureStreamingBackend *backend, size_t budgetBytes, CGDJobSystem *jobSystem, uint32_t tailSize, uint32_t maxLoadsInFlight);
+
+	// Bytes used by mips [firstMip, lastMip - 1] of t
+	static size_t MipRangeBytes(const StreamedTexture *t, uint32_t firstMip, uint32_t lastMip);
+
+	// Start loading mips [mip, residentMip - 1] of t
+	void startLoad(StreamedTexture *t, uint32_t mip);
+
+	// Commit a completed load
+	bool completeLoad(StreamedTexture *t);
+
+	// Reduce the residency of t to mip.  Return false if the backend failed
+	bool evict(StreamedTexture *t, uint32_t mip);
+
+	// Free memory by evicting textures with lower priority than t (any texture if t is nullptr) until bytes more fit in the budget.  Over-resident textures (holding more detail than their last request) are trimmed first, least recently used first, then lower priority textures are reduced a mip at a time.  Return true if bytes fit
+	bool makeRoom(size_t bytes, const StreamedTexture *t, uint32_t& changes);
+
+
+public:
+
+	//
+	// Public interface
+	//
+
+	// Factory method.  The backend (and job system if given) are retained.  tailSize is the largest mip dimension that is always resident and maxLoadsInFlight limits the number of concurrent loads
+	static CGDTextureStreamer* CreateTextureStreamer(CGDTextureStreamingBackend *backend, size_t budgetBytes, CGDJobSystem *jobSystem = nullptr, uint32_t tailSize = 64, uint32_t maxLoadsInFlight = 4);
+
+	// Mip level whose texel density roughly matches the screen when a width x height texture covers screenWidth x screenHeight pixels
+	static uint32_t MipForScreenSize(uint32_t width, uint32_t height, float screenWidth, float screenHeight);
+
+	// Mip level for a texture mapped once across worldSize units of a surface seen from distance units away with vertical field of view fovY on a viewport viewportHeight pixels high
+	static uint32_t MipForDistance(uint32_t width, uint32_t height, float worldSize, float distance, float fovY, float viewportHeight);
+
+	// Destructor - waits for loads in flight
+	~CGDTextureStreamer();
+
+	// Register a texture and load its mip tail (synchronously).  backendTexture is passed to the backend.  Return the texture id or CGD_INVALID_STREAMED_TEXTURE if the description is invalid or the tail cannot be loaded
+	uint32_t registerTexture(const CGDStreamedTextureDesc& desc, void *backendTexture);
+
+	// Stop streaming a texture (waits for its load in flight).  The backend texture keeps its current mips
+	void unregisterTexture(uint32_t id);
+
+	// Report that texture id needs mip (or more detail) this frame.  Thread-safe
+	void requestMip(uint32_t id, uint32_t mip);
+
+	// Apply this frame's requests - commit completed loads, enforce the budget and start new loads.  Return the number of textures whose resident mips changed (their views must be rebound)
+	uint32_t update();
+
+	// Change the budget.  A smaller budget is enforced by the next update
+	void setBudget(size_t budgetBytes);
+	size_t getBudget() const;
+
+	// Most detailed resident mip of texture id
+	uint32_t residentMip(uint32_t id) const;
+	const CGDStreamedTextureDesc& getDesc(uint32_t id) const;
+
+	// Return true if no loads are in flight
+	bool idle() const;
+
+	CGDTextureStreamerStats getStats() const;
+	void reportStats() const;
+};
@@ -0,0 +1,127 @@
+
+//
+// CGDTimeSource.cpp
+//
+
+#include <stdafx.h>
+#include <CGDTimeSource.h>
+#include <thread>
+#include <chrono>
+
+using namespace std;
+
+
+// Longest real time sleep in waitUntil so interrupt is noticed promptly
+static const gu_seconds			maxRealTimeSleep = 0.005;
+
+
+
+//
+// CGDRealTimeSource
+//
+
+// Constructor - called internally by the CreateRealTimeSource factory method
+CGDRealTimeSource::CGDRealTimeSource() : interrupted(false) {
+
+	gu_time_index frequency = CGDClock::ActualTimeFrequency();
+
+	secondsPerTick = (frequency > 0) ? 1.0 / (gu_seconds)frequency : 0.0;
+	baseTime = CGDClock::ActualTime();
+}
+
+
+// Factory method
+CGDRealTimeSource* CGDRealTimeSource::CreateRealTimeSource() {
+
+	return new CGDRealTimeSource();
+}
+
+
+gu_seconds CGDRealTimeSource::now() {
+
+	return (gu_seconds)(CGDClock::ActualTime() - baseTime) * secondsPerTick;
+}
+
+
+void CGDRealTimeSource::waitUntil(gu_seconds t) {
+
+	gu_seconds remaining = t - now();
+
+	if (remaining <= 0.0 || interrupted)
+		return;
+
+	// Sleep in short slices - the OS may oversleep by a scheduler quantum so callers re-check the time anyway
+	if (remaining > maxRealTimeSleep)
+		remaining = maxRealTimeSleep;
+
+	this_thread::sleep_for(chrono::microseconds((long long)(remaining * 1000000.0)));
+}
+
+
+void CGDRealTimeSource::interrupt() {
+
+	interrupted = true;
+}
+
+
+
+//
+// CGDVirtualClock
+//
+
+// Constructor - called internally by the CreateVirtualClock factory method
+CGDVirtualClock::CGDVirtualClock(gu_seconds startTime) {
+
+	time = startTime;
+}
+
+
+// Factory method
+CGDVirtualClock* CGDVirtualClock::CreateVirtualClock(gu_seconds startTime) {
+
+	return new CGDVirtualClock(startTime);
+}
+
+
+void CGDVirtualClock::advance(gu_seconds dt) {
+
+	if (dt <= 0.0)
+		return;
+
+	{
+		lock_guard<mutex> lock(timeLock);
+
+		time += dt;
+	}
+
+	timeSignal.notify_all();
+}
+
+
+gu_seconds CGDVirtualClock::now() {
+
+	lock_guard<mutex> lock(timeLock);
+
+	return time;
+}
+
+
+void CGDVirtualClock::waitUntil(gu_seconds t) {
+
+	unique_lock<mutex> lock(timeLock);
+
+	while (time < t && !interrupted)
+		timeSignal.wait(lock);
+}
+
+
+void CGDVirtualClock::interrupt() {
+
+	{
+		lock_guard<mutex> lock(timeLock);
+
+		interrupted = true;
+	}
+
+	timeSignal.notify_all();
+}
@@ -0,0 +1,97 @@
+//
+// CGDTimeSource.h
+//
+
+// Time sources for driving a fixed-step simulation (see CGDSimulation).  CGDRealTimeSource follows the system clock (CGDClock::ActualTime) while CGDVirtualClock only moves when it is advanced explicitly - the scene advances it by the main clock's game time each frame (so pausing the main clock pauses the simulation) and headless tests advance it by fixed amounts so a run is exactly repeatable.
+//
+// Time sources are thread-safe - a simulation thread may wait on a time source while another thread advances or interrupts it.
+
+#pragma once
+
+#include <GUObject.h>
+#include <CGDClock.h>
+#include <cstdint>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+
+
+// Abstract time source.  Times are in seconds from an arbitrary origin
+class CGDTimeSource : public GUObject {
+
+public:
+
+	virtual gu_seconds now() = 0;
+
+	// Block until now() >= t or interrupt has been called.  May return early so callers should re-check the time
+	virtual void waitUntil(gu_seconds t) = 0;
+
+	// Release current and future waiters (used to shut down threads blocked in waitUntil)
+	virtual void interrupt() = 0;
+};
+
+
+// System clock time source.  Time is measured from when the source was created
+class CGDRealTimeSource : public CGDTimeSource {
+
+	gu_time_index				baseTime;
+	gu_seconds					secondsPerTick; // ActualTime frequency is queried here since CGDClock only initialises its conversion factor when a clock is created
+	std::atomic<bool>			interrupted;
+
+
+	//
+	// Private interface
+	//
+
+	// Constructor - called internally by the CreateRealTimeSource factory method
+	CGDRealTimeSource();
+
+
+public:
+
+	//
+	// Public interface
+	//
+
+	// Factory method
+	static CGDRealTimeSource* CreateRealTimeSource();
+
+	gu_seconds now();
+	void waitUntil(gu_seconds t);
+	void interrupt();
+};
+
+
+// Manually advanced time source
+class CGDVirtualClock : public CGDTimeSource {
+
+	std::mutex					timeLock;
+	std::condition_variable		timeSignal;
+	gu_seconds					time;
+	bool						interrupted = false;
+
+
+	//
+	// Private interface
+	//
+
+	// Constructor - called internally by the CreateVirtualClock factory method
+	CGDVirtualClock(gu_seconds startTime);
+
+
+public:
+
+	//
+	// Public interface
+	//
+
+	// Factory method
+	static CGDVirtualClock* CreateVirtualClock(gu_seconds startTime = 0.0);
+
+	// Move time forward by dt seconds (negative values are ignored) and wake threads waiting for the new time
+	void advance(gu_seconds dt);
+
+	gu_seconds now();
+	void waitUntil(gu_seconds t);
+	void interrupt();
+};
@@ -0,0 +1,230 @@
+
+//
+// CGDTools.cpp
+//
+
+#include <stdafx.h>
+#include <CGDTools.h>
+#include <HeadlessScene.h>
+#include <CGDCameraPath.h>
+#include <CGDBenchmark.h>
+#include <CGDTextureCompressor.h>
+#include <CGDJobSystem.h>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+using namespace std;
+
+
+typedef int(*CGDToolFunction)(const vector<string>& args);
+
+
+// The camera path benchmark replays the reduced headless scene on the software rasterizer, not Scene's D3D pass list, render queue and DXStateCache, so its metrics are labelled as coming from the stand-in (see CGDBenchmark)
+static const char				*benchmarkSource = "headlessScene";
+static const char				*benchmarkDescription = "stand-in headless scene on the software rasterizer, not the D3D scene";
+
+
+// Parse args[index] as an unsigned integer into value.  Return false (value unchanged) if there is no such argument or it is not a number
+static bool parseArg(const vector<string>& args, size_t index, uint32_t& value) {
+
+	if (index >= args.size())
+		return false;
+
+	istringstream arg(args[index]);
+	uint32_t v;
+
+	if (!(arg >> v))
+		return false;
+
+	value = v;
+
+	return true;
+}
+
+
+// Headless rendering (-headless [frames] [width] [height]).  Return the process exit code
+static int runHeadless(const vector<string>& args) {
+
+	uint32_t settings[3] = { 60, 1280, 720 }; // frames, width, height
+
+	for (size_t i = 0; i < 3 && parseArg(args, i, settings[i]); i++);
+
+	HeadlessScene *headlessScene = HeadlessScene::CreateHeadlessScene(settings[1], settings[2]);
+
+	if (!headlessScene)
+		throw runtime_error("Cannot create headless scene - are the models and textures in Resources/?");
+
+	// Step at the simulation rate so every frame advances the animation by one step
+	bool written = headlessScene->renderFrames(settings[0], 1.0 / 60.0, "headless_frame_");
+
+	headlessScene->release();
+
+	return (written) ? 0 : 1;
+}
+
+
+// Camera path benchmark (-benchmark [camera path] [frames] [baseline]).  frames = 0 plays the whole path.  If the baseline file does not exist the results are saved as the new baseline.  Return the process exit code - 1 if a metric regressed or the baseline is not from the headless scene
+static int runBenchmark(const vector<string>& args) {
+
+	string pathName = (args.size() > 0) ? args[0] : "Resources/Benchmarks/flythrough.txt";
+	string baseline = (args.size() > 2) ? args[2] : "";
+	uint32_t frames = 0;
+
+	if (args.size() > 1 && !parseArg(args, 1, frames))
+		throw runtime_error("Invalid frame count " + args[1]);
+
+	CGDCameraPath *path = CGDCameraPath::LoadCameraPath(pathName);
+
+	if (!path)
+		throw runtime_error("Cannot load benchmark camera path " + pathName);
+
+	HeadlessScene *headlessScene = HeadlessScene::CreateHeadlessScene(1280, 720);
+	CGDBenchmark *benchmark = CGDBenchmark::CreateBenchmark(pathName, benchmarkSource, benchmarkDescription);
+
+	if (!headlessScene || !benchmark) {
+
+		if (headlessScene)
+			headlessScene->release();
+
+		if (benchmark)
+			benchmark->release();
+
+		path->release();
+
+		throw runtime_error(headlessScene ? "Cannot create benchmark" : "Cannot create headless scene - are the models and textures in Resources/?");
+	}
+
+	headlessScene->runBenchmark(path, frames, 10, benchmark);
+
+	headlessScene->release();
+	path->release();
+
+	benchmark->report();
+	benchmark->exportJSON("benchmark_results.json");
+
+	int exitCode = 0;
+
+	if (!baseline.empty()) {
+
+		if (ifstream(baseline).is_open()) {
+
+			if (!benchmark->compareWithBaseline(baseline))
+				exitCode = 1;
+
+		} else if (benchmark->exportJSON(baseline)) {
+
+			cout << "Saved benchmark results as the new baseline " << baseline << endl;
+		}
+	}
+
+	benchmark->release();
+
+	return exitCode;
+}
+
+
+// Texture compression (-compress <image> [dds file] [format]).  The DDS file defaults to the image name with a .dds extension and the format is chosen from the image if not given (see CGDTextureCompressor::ChooseFormat).  Return the process exit code
+static int runCompress(const vector<string>& args) {
+
+	if (args.empty())
+		throw runtime_error("No image to compress");
+
+	string input = args[0];
+	string output = (args.size() > 1) ? args[1] : "";
+	string formatName = (args.size() > 2) ? args[2] : "";
+
+	// A single argument after the image is the format if it names one
+	if (formatName.empty() && CGDTextureCompressor::ParseFormat(output) != GU_DXGI_FORMAT_UNKNOWN) {
+
+		formatName = output;
+		output.clear();
+	}
+
+	if (output.empty())
+		output = input.substr(0, input.find_last_of('.')) + ".dds";
+
+	uint32_t format = GU_DXGI_FORMAT_UNKNOWN;
+
+	if (!formatName.empty()) {
+
+		format = CGDTextureCompressor::ParseFormat(formatName);
+
+		if (format == GU_DXGI_FORMAT_UNKNOWN)
+			throw runtime_error("Unknown texture compression format " + formatName);
+	}
+
+	CGDJobSystem *jobSystem = CGDJobSystem::CreateJobSystem();
+	CGDTextureCompressor *compressor = CGDTextureCompressor::CreateTextureCompressor(jobSystem);
+
+	bool compressed = compressor->compressFile(input, output, format);
+
+	compressor->release();
+	jobSystem->release();
+
+	if (!compressed)
+		cout << "Cannot compress " << input << " to " << output << endl;
+
+	return (compressed) ? 0 : 1;
+}
+
+
+// Tool modes
+struct CGDTool {
+
+	const char					*mode;
+	CGDToolFunction				run;
+	const char					*usage;
+};
+
+static const CGDTool tools[] = {
+
+	{ "-headless", runHeadless, "[frames] [width] [height] - render a reduced scene (no dropship or sky box, bushes drawn as boxes - see HeadlessScene) with the software rasterizer and write each frame to headless_frame_NNNN.png" },
+	{ "-benchmark", runBenchmark, "[camera path] [frames] [baseline] - replay a camera path through the reduced headless scene, write the results (labelled headlessScene - they measure the software rasterizer stand-in, not the D3D scene) to benchmark_results.json and compare them with (or save them as) a headless scene baseline" },
+	{ "-compress", runCompress, "<image> [dds file] [bc1|bc3|bc4|bc5|bc7] - compress an image to a DDS file with a full mip chain" }
+};
+
+static const size_t numTools = sizeof(tools) / sizeof(tools[0]);
+
+
+static const CGDTool* findTool(const string& mode) {
+
+	for (size_t i = 0; i < numTools; i++) {
+
+		if (mode == tools[i].mode)
+			return &tools[i];
+	}
+
+	return nullptr;
+}
+
+
+
+//
+// Public interface
+//
+
+bool CGDTools::IsToolMode(const string& mode) {
+
+	return findTool(mode) != nullptr;
+}
+
+
+int CGDTools::Run(const string& mode, const vector<string>& args) {
+
+	const CGDTool *tool = findTool(mode);
+
+	if (!tool)
+		throw runtime_error("Unknown tool mode " + mode);
+
+	return tool->run(args);
+}
+
+
+void CGDTools::ReportUsage() {
+
+	cout << "Tool modes:\n";
+
+	for (size_t i = 0; i < numTools; i++)
+		cout << "  " << tools[i].mode << " " << tools[i].usage << "\n";
+}
@@ -0,0 +1,29 @@
+//
+// CGDTools.h
+//
+
+// Command line tool modes.  The Windows application runs a tool mode instead of creating its window when the first command line argument names one (see main.cpp) and the portable build runs the same modes from the CGDTool executable (see ToolMain.cpp), so tool modes only use modules that build on every platform.  File names may use / on either platform.
+//
+//   -headless [frames] [width] [height] renders the reduced headless scene (see HeadlessScene) with the software rasterizer and writes each frame to headless_frame_NNNN.png
+//   -benchmark [camera path] [frames] [baseline] replays a recorded camera path (default Resources/Benchmarks/flythrough.txt) through the headless scene and writes the results to benchmark_results.json.  The metrics are named headlessScene.<metric> - they measure the stand-in scene on the software rasterizer, not the D3D Scene.  The exit code is 1 if any metric regressed against the baseline or the baseline holds no headless scene metrics (the results are saved as the baseline if it does not exist)
+//   -compress <image> [dds file] [bc1|bc3|bc4|bc5|bc7] compresses an image to a DDS file with a full mip chain.  The DDS file defaults to the image name with a .dds extension and the format is chosen from the image if not given
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+
+class CGDTools {
+
+public:
+
+	// Return true if mode (eg. "-headless") names a tool mode
+	static bool IsToolMode(const std::string& mode);
+
+	// Run tool mode with the arguments that followed it on the command line.  Return the process exit code.  Throw std::runtime_error if the mode cannot run (eg. an input file cannot be opened)
+	static int Run(const std::string& mode, const std::vector<std::string>& args);
+
+	// List the tool modes and their arguments
+	static void ReportUsage();
+};
@@ -0,0 +1,64 @@
+//
+// CGDTripleBuffer.h
+//
+
+// Lock-free single producer / single consumer handoff of the latest value of T.  The producer fills writeBuffer() and calls publish, the consumer calls acquire once per frame and reads readBuffer().  Of the three buffers one is owned by the producer, one by the consumer and one is shared - publish and acquire each swap their buffer with the shared one in a single atomic exchange, so neither side ever waits for the other and the consumer always sees the most recently published complete value (intermediate values published between two acquires are skipped).
+//
+// The buffer the producer gets back from publish holds an older value, so the producer must write the whole of T before each publish.  Used to hand simulation snapshots from the simulation thread to the rendering thread (see CGDSimulation).
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+
+template <typename T>
+class CGDTripleBuffer {
+
+	// The shared buffer index is stored with freshBit set when it holds a value the consumer has not seen
+	static const uint32_t			indexMask = 0x3;
+	static const uint32_t			freshBit = 0x4;
+
+	T								buffers[3];
+
+	uint32_t						producerIndex = 0;
+	uint32_t						consumerIndex = 1;
+	std::atomic<uint32_t>			shared;
+
+public:
+
+	CGDTripleBuffer() : shared(2) {}
+
+	// Producer interface
+	T& writeBuffer() { return buffers[producerIndex]; }
+
+	void publish() {
+
+		producerIndex = shared.exchange(producerIndex | freshBit, std::memory_order_acq_rel) & indexMask;
+	}
+
+	// Consumer interface.  Take the latest published value if there is one.  Return true if readBuffer() changed
+	bool acquire() {
+
+		if ((shared.load(std::memory_order_relaxed) & freshBit) == 0)
+			return false;
+
+		consumerIndex = shared.exchange(consumerIndex, std::memory_order_acq_rel) & indexMask;
+		return true;
+	}
+
+	const T& readBuffer() const { return buffers[consumerIndex]; }
+
+	// Set all three buffers (not thread-safe - call before the producer and consumer start)
+	void reset(const T& value) {
+
+		buffers[0] = value;
+		buffers[1] = value;
+		buffers[2] = value;
+	}
+
+private:
+
+	CGDTripleBuffer(const CGDTripleBuffer&);
+	CGDTripleBuffer& operator=(const CGDTripleBuffer&);
+};
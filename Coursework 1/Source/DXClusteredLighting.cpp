@@ -0,0 +1,240 @@
+//
+// DXClusteredLighting.cpp
+//
+
+#include <stdafx.h>
+#include <DXClusteredLighting.h>
+#include <CGDClusteredLighting.h>
+
+using namespace std;
+
+
+// Constants of the clustered lighting (clusterCBuffer in per_pixel_lighting_ps.hlsl)
+__declspec(align(16)) struct ClusterConstants {
+
+	DirectX::XMFLOAT4X4				viewMatrix; // main camera view the grid is built for
+	FLOAT							projScaleX; // _11 and _22 of the main camera projection
+	FLOAT							projScaleY;
+	FLOAT							sliceScale; // slice = floor(log(view depth) * sliceScale + sliceBias)
+	FLOAT							sliceBias;
+	UINT							tilesX;
+	UINT							tilesY;
+	UINT							slices;
+	UINT							lightCount; // 0 = no local lights
+};
+
+
+static const uint32_t				initialCapacity = 1024; // elements of each structured buffer on creation
+
+
+// Create a dynamic structured buffer of capacity elements of stride bytes with an SRV
+static bool CreateStructuredBuffer(ID3D11Device *device, uint32_t stride, uint32_t capacity, ID3D11Buffer **buffer, ID3D11ShaderResourceView **srv) {
+
+	D3D11_BUFFER_DESC desc;
+
+	ZeroMemory(&desc, sizeof(D3D11_BUFFER_DESC));
+
+	desc.ByteWidth = stride * capacity;
+	desc.Usage = D3D11_USAGE_DYNAMIC;
+	desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	desc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+	desc.StructureByteStride = stride;
+
+	HRESULT hr = device->CreateBuffer(&desc, nullptr, buffer);
+
+	if (SUCCEEDED(hr))
+		hr = device->CreateShaderResourceView(*buffer, nullptr, srv);
+
+	return SUCCEEDED(hr);
+}
+
+
+
+//
+// Private interface
+//
+
+// Constructor - called internally by the CreateClusteredLighting factory method
+DXClusteredLighting::DXClusteredLighting(CGDClusteredLighting *_lighting) {
+
+	ZeroMemory(&lightBuffer, sizeof(StructuredBuffer));
+	ZeroMemory(&gridBuffer, sizeof(StructuredBuffer));
+	ZeroMemory(&indexBuffer, sizeof(StructuredBuffer));
+
+	lighting = _lighting;
+	lighting->retain();
+}
+
+
+bool DXClusteredLighting::upload(ID3D11DeviceContext *context, StructuredBuffer& target, uint32_t stride, const void *data, uint32_t count) {
+
+	if (count > target.capacity) {
+
+		// Grow to the next power of 2 so a slowly rising light count does not recreate the buffer every frame
+		uint32_t capacity = target.capacity;
+
+		while (capacity < count)
+			capacity *= 2;
+
+		ID3D11Device *device = nullptr;
+		ID3D11Buffer *buffer = nullptr;
+		ID3D11ShaderResourceView *srv = nullptr;
+
+		context->GetDevice(&device);
+
+		bool created = CreateStructuredBuffer(device, stride, capacity, &buffer, &srv);
+
+		device->Release();
+
+		if (!created) {
+
+			if (buffer)
+				buffer->Release();
+
+			return false;
+		}
+
+		target.buffer->Release();
+		target.srv->Release();
+		target.buffer = buffer;
+		target.srv = srv;
+		target.capacity = capacity;
+	}
+
+	if (count == 0)
+		return true;
+
+	D3D11_MAPPED_SUBRESOURCE res;
+
+	if (!SUCCEEDED(context->Map(target.buffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &res)))
+		return false;
+
+	memcpy(res.pData, data, stride * count);
+	context->Unmap(target.buffer, 0);
+
+	return true;
+}
+
+
+
+//
+// Public interface
+//
+
+// Factory method
+DXClusteredLighting* DXClusteredLighting::CreateClusteredLighting(ID3D11Device *device, CGDClusteredLighting *lighting) {
+
+	if (!device || !lighting)
+		return nullptr;
+
+	DXClusteredLighting *clusters = new DXClusteredLighting(lighting);
+
+	D3D11_BUFFER_DESC cbufferDesc;
+
+	ZeroMemory(&cbufferDesc, sizeof(D3D11_BUFFER_DESC));
+
+	cbufferDesc.ByteWidth = sizeof(ClusterConstants);
+	cbufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+	cbufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	cbufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+
+	StructuredBuffer *buffers[3] = { &clusters->lightBuffer, &clusters->gridBuffer, &clusters->indexBuffer };
+	uint32_t strides[3] = { sizeof(CGDLight), 2 * sizeof(uint32_t), sizeof(uint32_t) };
+	bool created = SUCCEEDED(device->CreateBuffer(&cbufferDesc, nullptr, &clusters->constants));
+
+	// The grid always has one entry per cluster
+	for (int i = 0; i < 3 && created; i++) {
+
+		buffers[i]->capacity = (i == 1) ? lighting->getClusterCount() : initialCapacity;
+		created = CreateStructuredBuffer(device, strides[i], buffers[i]->capacity, &buffers[i]->buffer, &buffers[i]->srv);
+	}
+
+	if (!created) {
+
+		cout << "Cannot create clustered lighting buffers\n";
+
+		clusters->release();
+		return nullptr;
+	}
+
+	return clusters;
+}
+
+
+// Destructor
+DXClusteredLighting::~DXClusteredLighting() {
+
+	ID3D11DeviceChild *objects[] = { lightBuffer.buffer, lightBuffer.srv, gridBuffer.buffer, gridBuffer.srv, indexBuffer.buffer, indexBuffer.srv, constants };
+
+	for (auto object : objects) {
+
+		if (object)
+			object->Release();
+	}
+
+	lighting->release();
+}
+
+
+HRESULT DXClusteredLighting::update(ID3D11DeviceContext *context, const CGDLight *lights, uint32_t count) {
+
+	PROFILE_SCOPE("DXClusteredLighting::update");
+
+	lighting->assign(lights, count);
+
+	const vector<uint32_t>& grid = lighting->getClusterLights();
+	const vector<uint32_t>& indices = lighting->getLightIndices();
+
+	numLights = 0;
+
+	if (!upload(context, lightBuffer, sizeof(CGDLight), lights, count) ||
+		!upload(context, gridBuffer, 2 * sizeof(uint32_t), grid.data(), lighting->getClusterCount()) ||
+		!upload(context, indexBuffer, sizeof(uint32_t), indices.data(), (uint32_t)indices.size()))
+		return E_FAIL;
+
+	numLights = count;
+
+	return S_OK;
+}
+
+
+void DXClusteredLighting::bind(ID3D11DeviceContext *context, bool clustered) {
+
+	D3D11_MAPPED_SUBRESOURCE res;
+
+	if (!SUCCEEDED(context->Map(constants, 0, D3D11_MAP_WRITE_DISCARD, 0, &res)))
+		return;
+
+	const CGDClusterGridDesc& desc = lighting->getDesc();
+	ClusterConstants *c = (ClusterConstants*)res.pData;
+
+	memcpy(&c->viewMatrix, lighting->getViewMatrix(), sizeof(DirectX::XMFLOAT4X4));
+	c->projScaleX = lighting->getProjScaleX();
+	c->projScaleY = lighting->getProjScaleY();
+	c->sliceScale = lighting->getSliceScale();
+	c->sliceBias = lighting->getSliceBias();
+	c->tilesX = desc.tilesX;
+	c->tilesY = desc.tilesY;
+	c->slices = desc.slices;
+	c->lightCount = (clustered) ? numLights : 0;
+
+	context->Unmap(constants, 0);
+
+	ID3D11ShaderResourceView *views[3] = { lightBuffer.srv, gridBuffer.srv, indexBuffer.srv };
+
+	context->PSSetConstantBuffers(DX_CLUSTER_CONSTANT_BUFFER_SLOT, 1, &constants);
+	context->PSSetShaderResources(DX_CLUSTER_SHADER_RESOURCE_SLOT, 3, views);
+}
+
+
+CGDClusteredLighting* DXClusteredLighting::getLighting() const {
+
+	return lighting;
+}
+
+
+uint32_t DXClusteredLighting::getLightCount() const {
+
+	return numLights;
+}
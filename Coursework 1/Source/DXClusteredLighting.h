@@ -0,0 +1,74 @@
+//
+// DXClusteredLighting.h
+//
+
+// D3D11 buffers of a CGDClusteredLighting for the clustered lighting in per_pixel_lighting_ps.hlsl.  update assigns the frame's lights to the clusters of the main view and uploads the lights, the cluster grid and the light index list once per frame as dynamic structured buffers (grown when they overflow) - the per-object constant buffers no longer carry any lights other than the sun.  bind sets the cluster constants (b1) and the three buffers (t8 - t10) on a context before a pass is drawn.
+//
+// The grid is built for the main camera only so passes drawn from another camera (the reflection cube map faces) bind with clustered = false and are lit by the sun alone.
+
+#pragma once
+
+#include <d3d11_2.h>
+#include <GUObject.h>
+#include <cstdint>
+
+class CGDClusteredLighting;
+struct CGDLight;
+
+
+// Shader slots of the clustered lighting resources (see per_pixel_lighting_ps.hlsl)
+#define DX_CLUSTER_CONSTANT_BUFFER_SLOT		1
+#define DX_CLUSTER_SHADER_RESOURCE_SLOT		8
+
+
+class DXClusteredLighting : public GUObject {
+
+	// Dynamic structured buffer with an SRV
+	struct StructuredBuffer {
+
+		ID3D11Buffer				*buffer;
+		ID3D11ShaderResourceView	*srv;
+		uint32_t					capacity; // elements
+	};
+
+	CGDClusteredLighting			*lighting = nullptr;
+	StructuredBuffer				lightBuffer; // CGDLight
+	StructuredBuffer				gridBuffer; // uint2 (offset, count) per cluster
+	StructuredBuffer				indexBuffer; // uint light indices
+	ID3D11Buffer					*constants = nullptr;
+	uint32_t						numLights = 0; // lights in the last update
+
+
+	//
+	// Private interface
+	//
+
+	// Constructor - called internally by the CreateClusteredLighting factory method
+	DXClusteredLighting(CGDClusteredLighting *lighting);
+
+	// Write count elements of stride bytes to target, recreating it with a larger capacity if they do not fit.  Return false if the buffer cannot be created or mapped
+	bool upload(ID3D11DeviceContext *context, StructuredBuffer& target, uint32_t stride, const void *data, uint32_t count);
+
+
+public:
+
+	//
+	// Public interface
+	//
+
+	// Factory method.  lighting is retained.  Return nullptr if the buffers cannot be created
+	static DXClusteredLighting* CreateClusteredLighting(ID3D11Device *device, CGDClusteredLighting *lighting);
+
+	// Destructor
+	~DXClusteredLighting();
+
+	// Assign count lights to the clusters of the lighting's current view (see CGDClusteredLighting::setView) and upload the buffers on context (the immediate context)
+	HRESULT update(ID3D11DeviceContext *context, const CGDLight *lights, uint32_t count);
+
+	// Bind the constants and buffers to the pixel shader stage of context.  clustered = false binds constants with no local lights
+	void bind(ID3D11DeviceContext *context, bool clustered);
+
+	// Query methods
+	CGDClusteredLighting* getLighting() const;
+	uint32_t getLightCount() const;
+};
@@ -0,0 +1,129 @@
+
+//
+// DXCommandBackend.cpp
+//
+
+#include <stdafx.h>
+#include <DXCommandBackend.h>
+
+using namespace std;
+
+
+
+//
+// Private interface
+//
+
+// Constructor - called internally by the CreateCommandBackend factory method
+DXCommandBackend::DXCommandBackend(ID3D11DeviceContext *_context) {
+
+	context = _context;
+	context->AddRef();
+}
+
+
+
+//
+// Public interface
+//
+
+// Factory method
+DXCommandBackend* DXCommandBackend::CreateCommandBackend(ID3D11Device *device, ID3D11DeviceContext *context, uint32_t numContexts) {
+
+	if (!device || !context)
+		return nullptr;
+
+	DXCommandBackend *backend = new DXCommandBackend(context);
+
+	D3D11_FEATURE_DATA_THREADING threading;
+
+	ZeroMemory(&threading, sizeof(D3D11_FEATURE_DATA_THREADING));
+
+	if (SUCCEEDED(device->CheckFeatureSupport(D3D11_FEATURE_THREADING, &threading, sizeof(D3D11_FEATURE_DATA_THREADING))))
+		backend->driverCommandLists = (threading.DriverCommandLists == TRUE);
+
+	for (uint32_t i = 0; i < numContexts; i++) {
+
+		ID3D11DeviceContext *deferredContext = nullptr;
+
+		HRESULT hr = device->CreateDeferredContext(0, &deferredContext);
+
+		if (!SUCCEEDED(hr)) {
+
+			cout << "Cannot create deferred contexts - scene passes will be rendered on the immediate context\n";
+
+			// Use all or none so the pass distribution does not depend on how many contexts happened to be created
+			for (size_t j = 0; j < backend->deferredContexts.size(); j++)
+				backend->deferredContexts[j]->Release();
+
+			backend->deferredContexts.clear();
+			break;
+		}
+
+		backend->deferredContexts.push_back(deferredContext);
+	}
+
+	return backend;
+}
+
+
+// Destructor
+DXCommandBackend::~DXCommandBackend() {
+
+	for (size_t i = 0; i < deferredContexts.size(); i++)
+		deferredContexts[i]->Release();
+
+	context->Release();
+}
+
+
+ID3D11DeviceContext* DXCommandBackend::getDeferredContext(uint32_t index) const {
+
+	return deferredContexts[index];
+}
+
+
+bool DXCommandBackend::hasDriverCommandLists() const {
+
+	return driverCommandLists;
+}
+
+
+uint32_t DXCommandBackend::recordingContextCount() const {
+
+	return (uint32_t)deferredContexts.size();
+}
+
+
+void* DXCommandBackend::recordingContext(uint32_t index) {
+
+	return deferredContexts[index];
+}
+
+
+void* DXCommandBackend::immediateContext() {
+
+	return context;
+}
+
+
+void* DXCommandBackend::finishRecording(uint32_t index) {
+
+	ID3D11CommandList *commandList = nullptr;
+
+	HRESULT hr = deferredContexts[index]->FinishCommandList(FALSE, &commandList);
+
+	return (SUCCEEDED(hr)) ? commandList : nullptr;
+}
+
+
+void DXCommandBackend::executeCommandList(void *commandList) {
+
+	context->ExecuteCommandList((ID3D11CommandList*)commandList, FALSE);
+}
+
+
+void DXCommandBackend::releaseCommandList(void *commandList) {
+
+	((ID3D11CommandList*)commandList)->Release();
+}
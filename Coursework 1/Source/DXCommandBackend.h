@@ -0,0 +1,55 @@
+//
+// DXCommandBackend.h
+//
+
+// D3D11 implementation of CGDCommandBackend.  Recording contexts are deferred contexts and command lists are ID3D11CommandList objects.  Command lists are finished and executed without restoring context state (FALSE) so every pass starts from default state and must bind everything it uses (render targets, viewport and pipeline state).  If the device cannot create deferred contexts (eg. it was created with D3D11_CREATE_DEVICE_SINGLETHREADED) the backend is created with no recording contexts and CGDPassScheduler runs passes on the immediate context.
+
+#pragma once
+
+#include <d3d11_2.h>
+#include <CGDPassScheduler.h>
+#include <vector>
+
+
+class DXCommandBackend : public CGDCommandBackend {
+
+	ID3D11DeviceContext						*context = nullptr;
+	std::vector<ID3D11DeviceContext*>		deferredContexts;
+	bool									driverCommandLists = false;
+
+
+	//
+	// Private interface
+	//
+
+	// Constructor - called internally by the CreateCommandBackend factory method
+	DXCommandBackend(ID3D11DeviceContext *context);
+
+
+public:
+
+	//
+	// Public interface
+	//
+
+	// Factory method.  Create numContexts deferred contexts on device for recording passes that are executed on context.  Return nullptr if device or context is nullptr
+	static DXCommandBackend* CreateCommandBackend(ID3D11Device *device, ID3D11DeviceContext *context, uint32_t numContexts);
+
+	// Destructor
+	~DXCommandBackend();
+
+	// Return the deferred context with the given index
+	ID3D11DeviceContext* getDeferredContext(uint32_t index) const;
+
+	// Return true if the driver supports command lists natively (otherwise the runtime emulates them - still correct but recording saves less main thread time)
+	bool hasDriverCommandLists() const;
+
+	// CGDCommandBackend interface
+	uint32_t recordingContextCount() const;
+	void* recordingContext(uint32_t index);
+	void* immediateContext();
+
+	void* finishRecording(uint32_t index);
+	void executeCommandList(void *commandList);
+	void releaseCommandList(void *commandList);
+};
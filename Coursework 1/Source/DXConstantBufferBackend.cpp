@@ -0,0 +1,160 @@
+
+//
+// DXConstantBufferBackend.cpp
+//
+
+#include <stdafx.h>
+#include <DXConstantBufferBackend.h>
+
+using namespace std;
+
+
+
+//
+// Private interface
+//
+
+// Constructor - called internally by the CreateConstantBufferBackend factory method
+DXConstantBufferBackend::DXConstantBufferBackend(ID3D11DeviceContext *_context) {
+
+	context = _context;
+	context->AddRef();
+}
+
+
+bool DXConstantBufferBackend::WriteBuffer(ID3D11DeviceContext *context, ID3D11Buffer *buffer, D3D11_MAP mapType, uint32_t offset, const void *data, uint32_t size) {
+
+	D3D11_MAPPED_SUBRESOURCE res;
+
+	if (!SUCCEEDED(context->Map(buffer, 0, mapType, 0, &res)))
+		return false;
+
+	memcpy((uint8_t*)res.pData + offset, data, size);
+	context->Unmap(buffer, 0);
+
+	return true;
+}
+
+
+
+//
+// Public interface
+//
+
+// Factory method
+DXConstantBufferBackend* DXConstantBufferBackend::CreateConstantBufferBackend(ID3D11Device *device, ID3D11DeviceContext *context, uint32_t frameSize, uint32_t viewSize, uint32_t ringSize) {
+
+	if (!device || !context || frameSize == 0 || viewSize == 0 || ringSize == 0)
+		return nullptr;
+
+	// Objects are bound to their slots with constant offsets (D3D11.1 runtime)
+	D3D11_FEATURE_DATA_D3D11_OPTIONS options;
+
+	ZeroMemory(&options, sizeof(D3D11_FEATURE_DATA_D3D11_OPTIONS));
+
+	if (!SUCCEEDED(device->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &options, sizeof(D3D11_FEATURE_DATA_D3D11_OPTIONS))) || !options.ConstantBufferOffsetting) {
+
+		cout << "Constant buffer offsets are not supported\n";
+		return nullptr;
+	}
+
+	DXConstantBufferBackend *backend = new DXConstantBufferBackend(context);
+
+	backend->ringSize = ringSize;
+	backend->noOverwrite = (options.MapNoOverwriteOnDynamicConstantBuffer != FALSE);
+
+	D3D11_BUFFER_DESC cbufferDesc;
+
+	ZeroMemory(&cbufferDesc, sizeof(D3D11_BUFFER_DESC));
+
+	cbufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+	cbufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	cbufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+
+	cbufferDesc.ByteWidth = frameSize;
+	HRESULT hr = device->CreateBuffer(&cbufferDesc, nullptr, &backend->frameBuffer);
+
+	cbufferDesc.ByteWidth = viewSize;
+
+	if (SUCCEEDED(hr))
+		hr = device->CreateBuffer(&cbufferDesc, nullptr, &backend->viewBuffer);
+
+	cbufferDesc.ByteWidth = ringSize;
+
+	if (SUCCEEDED(hr))
+		hr = device->CreateBuffer(&cbufferDesc, nullptr, &backend->objectRing);
+
+	if (!SUCCEEDED(hr)) {
+
+		cout << "Cannot create constant buffers\n";
+
+		backend->release();
+		return nullptr;
+	}
+
+	return backend;
+}
+
+
+// Destructor
+DXConstantBufferBackend::~DXConstantBufferBackend() {
+
+	ID3D11DeviceChild *objects[] = { frameBuffer, viewBuffer, objectRing };
+
+	for (auto object : objects) {
+
+		if (object)
+			object->Release();
+	}
+
+	context->Release();
+}
+
+
+void* DXConstantBufferBackend::objectBuffer() const {
+
+	return objectRing;
+}
+
+
+uint32_t DXConstantBufferBackend::objectBufferSize() const {
+
+	return ringSize;
+}
+
+
+bool DXConstantBufferBackend::canAppend() const {
+
+	return noOverwrite;
+}
+
+
+bool DXConstantBufferBackend::writeObjects(uint32_t offset, const void *data, uint32_t size, bool discard) {
+
+	if (!discard && !noOverwrite)
+		return false;
+
+	return WriteBuffer(context, objectRing, (discard) ? D3D11_MAP_WRITE_DISCARD : D3D11_MAP_WRITE_NO_OVERWRITE, offset, data, size);
+}
+
+
+bool DXConstantBufferBackend::writeFrame(const void *data, uint32_t size) {
+
+	return WriteBuffer(context, frameBuffer, D3D11_MAP_WRITE_DISCARD, 0, data, size);
+}
+
+
+bool DXConstantBufferBackend::writeView(void *passContext, const void *data, uint32_t size) {
+
+	ID3D11DeviceContext *c = (ID3D11DeviceContext*)passContext;
+
+	if (!WriteBuffer(c, viewBuffer, D3D11_MAP_WRITE_DISCARD, 0, data, size))
+		return false;
+
+	ID3D11Buffer *buffers[] = { frameBuffer, viewBuffer };
+
+	c->VSSetConstantBuffers(DX_FRAME_CONSTANT_BUFFER_SLOT, 2, buffers);
+	c->PSSetConstantBuffers(DX_FRAME_CONSTANT_BUFFER_SLOT, 2, buffers);
+
+	return true;
+}
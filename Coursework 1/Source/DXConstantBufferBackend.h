@@ -0,0 +1,61 @@
+//
+// DXConstantBufferBackend.h
+//
+
+// D3D11 implementation of CGDConstantBufferBackend.  The frame, view and object buffers are dynamic constant buffers.  The object ring is written on the immediate context with D3D11_MAP_WRITE_NO_OVERWRITE where the device supports it for constant buffers (MapNoOverwriteOnDynamicConstantBuffer) and D3D11_MAP_WRITE_DISCARD otherwise, and its slots are bound with the constant offsets of the D3D11.1 runtime (ConstantBufferOffsetting - see DXRenderContext::setConstantBufferRange).  The view buffer is written with D3D11_MAP_WRITE_DISCARD on the context of each pass so every command list gets its own copy.
+//
+// writeView binds the frame and view buffers to b3 and b4 of the vertex and pixel shader stages (frameCBuffer and viewCBuffer in the scene's shaders).
+
+#pragma once
+
+#include <d3d11_2.h>
+#include <CGDConstantBuffers.h>
+
+
+// Shader slots of the frame and view constants (consecutive)
+#define DX_FRAME_CONSTANT_BUFFER_SLOT		3
+#define DX_VIEW_CONSTANT_BUFFER_SLOT		4
+
+
+class DXConstantBufferBackend : public CGDConstantBufferBackend {
+
+	ID3D11DeviceContext				*context = nullptr; // immediate context
+	ID3D11Buffer					*frameBuffer = nullptr;
+	ID3D11Buffer					*viewBuffer = nullptr;
+	ID3D11Buffer					*objectRing = nullptr;
+	uint32_t						ringSize = 0;
+	bool							noOverwrite = false;
+
+
+	//
+	// Private interface
+	//
+
+	// Constructor - called internally by the CreateConstantBufferBackend factory method
+	DXConstantBufferBackend(ID3D11DeviceContext *context);
+
+	// Map buffer on context, copy size bytes to offset and unmap it
+	static bool WriteBuffer(ID3D11DeviceContext *context, ID3D11Buffer *buffer, D3D11_MAP mapType, uint32_t offset, const void *data, uint32_t size);
+
+
+public:
+
+	//
+	// Public interface
+	//
+
+	// Factory method.  Create frameSize and viewSize byte buffers and a ringSize byte object ring.  Return nullptr if the buffers cannot be created or the runtime does not support constant buffer offsets
+	static DXConstantBufferBackend* CreateConstantBufferBackend(ID3D11Device *device, ID3D11DeviceContext *context, uint32_t frameSize, uint32_t viewSize, uint32_t ringSize = 65536);
+
+	// Destructor
+	~DXConstantBufferBackend();
+
+	// CGDConstantBufferBackend interface
+	void* objectBuffer() const;
+	uint32_t objectBufferSize() const;
+	bool canAppend() const;
+
+	bool writeObjects(uint32_t offset, const void *data, uint32_t size, bool discard);
+	bool writeFrame(const void *data, uint32_t size);
+	bool writeView(void *context, const void *data, uint32_t size);
+};
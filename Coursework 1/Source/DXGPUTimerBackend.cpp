@@ -0,0 +1,138 @@
+//
+// DXGPUTimerBackend.cpp
+//
+
+#include <stdafx.h>
+#include <DXGPUTimerBackend.h>
+
+using namespace std;
+
+
+
+//
+// Private interface
+//
+
+// Constructor - called internally by the CreateGPUTimerBackend factory method
+DXGPUTimerBackend::DXGPUTimerBackend(ID3D11DeviceContext *_context) {
+
+	context = _context;
+
+	if (context)
+		context->AddRef();
+}
+
+
+
+//
+// Public interface
+//
+
+DXGPUTimerBackend* DXGPUTimerBackend::CreateGPUTimerBackend(ID3D11Device *device, ID3D11DeviceContext *context, uint32_t framesInFlight, uint32_t maxTimestamps) {
+
+	if (!device || !context || framesInFlight == 0 || maxTimestamps == 0)
+		return nullptr;
+
+	DXGPUTimerBackend *backend = new DXGPUTimerBackend(context);
+
+	D3D11_QUERY_DESC disjointDesc = { D3D11_QUERY_TIMESTAMP_DISJOINT, 0 };
+	D3D11_QUERY_DESC timestampDesc = { D3D11_QUERY_TIMESTAMP, 0 };
+
+	backend->frames.resize(framesInFlight);
+	backend->maxTimestamps = maxTimestamps;
+
+	for (auto& f : backend->frames) {
+
+		HRESULT hr = device->CreateQuery(&disjointDesc, &f.disjoint);
+
+		f.timestamps.assign(maxTimestamps, nullptr);
+
+		for (uint32_t i = 0; i < maxTimestamps && SUCCEEDED(hr); i++)
+			hr = device->CreateQuery(&timestampDesc, &f.timestamps[i]);
+
+		if (!SUCCEEDED(hr)) {
+
+			cout << "Cannot create GPU timestamp queries\n";
+
+			backend->release();
+			return nullptr;
+		}
+	}
+
+	return backend;
+}
+
+
+// Destructor
+DXGPUTimerBackend::~DXGPUTimerBackend() {
+
+	for (auto& f : frames) {
+
+		if (f.disjoint)
+			f.disjoint->Release();
+
+		for (auto q : f.timestamps) {
+
+			if (q)
+				q->Release();
+		}
+	}
+
+	if (context)
+		context->Release();
+}
+
+
+uint32_t DXGPUTimerBackend::framesInFlight() const {
+
+	return (uint32_t)frames.size();
+}
+
+
+uint32_t DXGPUTimerBackend::maxTimestampsPerFrame() const {
+
+	return maxTimestamps;
+}
+
+
+void DXGPUTimerBackend::beginFrame(uint32_t slot) {
+
+	context->Begin(frames[slot].disjoint);
+}
+
+
+void DXGPUTimerBackend::endFrame(uint32_t slot) {
+
+	context->End(frames[slot].disjoint);
+}
+
+
+void DXGPUTimerBackend::timestamp(uint32_t slot, uint32_t index) {
+
+	// Timestamp queries only have an End
+	context->End(frames[slot].timestamps[index]);
+}
+
+
+CGDGPUQueryStatus DXGPUTimerBackend::resolveFrame(uint32_t slot, uint32_t numTimestamps, uint64_t *timestamps, uint64_t *frequency) {
+
+	FrameQueries& f = frames[slot];
+	D3D11_QUERY_DATA_TIMESTAMP_DISJOINT disjointData;
+
+	if (context->GetData(f.disjoint, &disjointData, sizeof(disjointData), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK)
+		return CGDGPUQueryStatus::NOT_READY;
+
+	for (uint32_t i = 0; i < numTimestamps && i < maxTimestamps; i++) {
+
+		UINT64 t = 0;
+
+		if (context->GetData(f.timestamps[i], &t, sizeof(UINT64), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK)
+			return CGDGPUQueryStatus::NOT_READY;
+
+		timestamps[i] = t;
+	}
+
+	*frequency = disjointData.Frequency;
+
+	return (disjointData.Disjoint) ? CGDGPUQueryStatus::DISJOINT : CGDGPUQueryStatus::VALID;
+}
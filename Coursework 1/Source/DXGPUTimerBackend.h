@@ -0,0 +1,56 @@
+//
+// DXGPUTimerBackend.h
+//
+
+// D3D11 implementation of CGDGPUTimerBackend.  Each frame slot holds a D3D11_QUERY_TIMESTAMP_DISJOINT query and a fixed pool of D3D11_QUERY_TIMESTAMP queries.  Results are read with D3D11_ASYNC_GETDATA_DONOTFLUSH so resolving a slot never blocks
+
+#pragma once
+
+#include <d3d11_2.h>
+#include <CGDGPUProfiler.h>
+#include <vector>
+
+
+class DXGPUTimerBackend : public CGDGPUTimerBackend {
+
+	struct FrameQueries {
+
+		ID3D11Query						*disjoint = nullptr;
+		std::vector<ID3D11Query*>		timestamps;
+	};
+
+	ID3D11DeviceContext				*context = nullptr;
+	std::vector<FrameQueries>		frames;
+	uint32_t						maxTimestamps = 0;
+
+
+	//
+	// Private interface
+	//
+
+	// Constructor - called internally by the CreateGPUTimerBackend factory method
+	DXGPUTimerBackend(ID3D11DeviceContext *context);
+
+
+public:
+
+	//
+	// Public interface
+	//
+
+	// Factory method.  Create framesInFlight query slots (3 = triple buffered) of maxTimestamps timestamp queries each.  Return nullptr if the queries cannot be created
+	static DXGPUTimerBackend* CreateGPUTimerBackend(ID3D11Device *device, ID3D11DeviceContext *context, uint32_t framesInFlight = 3, uint32_t maxTimestamps = 64);
+
+	// Destructor
+	~DXGPUTimerBackend();
+
+	// CGDGPUTimerBackend interface
+	uint32_t framesInFlight() const;
+	uint32_t maxTimestampsPerFrame() const;
+
+	void beginFrame(uint32_t slot);
+	void endFrame(uint32_t slot);
+	void timestamp(uint32_t slot, uint32_t index);
+
+	CGDGPUQueryStatus resolveFrame(uint32_t slot, uint32_t numTimestamps, uint64_t *timestamps, uint64_t *frequency);
+};
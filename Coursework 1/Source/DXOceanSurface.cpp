@@ -0,0 +1,366 @@
+
+//
+// DXOceanSurface.cpp
+//
+
+#include <stdafx.h>
+#include <DXOceanSurface.h>
+#include <DXPipelineCache.h>
+#include <CGDOcean.h>
+#include <CGDRenderQueue.h>
+#include <Effect.h>
+#include <Grid.h>
+#include <DXVertexExt.h>
+
+using namespace std;
+
+
+// Constants of the compute shaders (see ocean_fft_rows_cs.hlsl)
+__declspec(align(16)) struct OceanComputeConstants {
+
+	UINT							size;
+	UINT							log2Size;
+	FLOAT							fraction; // phases are 2 pi frac(frequency steps * fraction)
+	FLOAT							choppiness;
+	FLOAT							frequencySpacing; // 2 pi / patchSize
+	FLOAT							gravity;
+	FLOAT							repeatPeriod;
+	FLOAT							padding;
+};
+
+
+static const UINT					fftGroupSize = 256; // threads per row / column (numthreads of the compute shaders)
+
+
+// Create a size * size R32G32B32A32_FLOAT texture with an SRV (and a UAV if uav is not nullptr).  data (if not nullptr) is the initial content
+static bool CreateMapTexture(ID3D11Device *device, uint32_t size, const float *data, ID3D11Texture2D **texture, ID3D11ShaderResourceView **srv, ID3D11UnorderedAccessView **uav) {
+
+	D3D11_TEXTURE2D_DESC desc;
+
+	ZeroMemory(&desc, sizeof(D3D11_TEXTURE2D_DESC));
+
+	desc.Width = size;
+	desc.Height = size;
+	desc.MipLevels = 1;
+	desc.ArraySize = 1;
+	desc.Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
+	desc.SampleDesc.Count = 1;
+	desc.Usage = D3D11_USAGE_DEFAULT;
+	desc.BindFlags = D3D11_BIND_SHADER_RESOURCE | ((uav) ? D3D11_BIND_UNORDERED_ACCESS : 0);
+
+	D3D11_SUBRESOURCE_DATA initData = { data, size * 4 * sizeof(float), 0 };
+
+	HRESULT hr = device->CreateTexture2D(&desc, (data) ? &initData : nullptr, texture);
+
+	if (SUCCEEDED(hr))
+		hr = device->CreateShaderResourceView(*texture, nullptr, srv);
+
+	if (SUCCEEDED(hr) && uav)
+		hr = device->CreateUnorderedAccessView(*texture, nullptr, uav);
+
+	return SUCCEEDED(hr);
+}
+
+
+
+//
+// Private interface
+//
+
+// Constructor - called internally by the CreateOceanSurface factory method
+DXOceanSurface::DXOceanSurface(CGDOcean *_ocean, Effect *_effect, uint32_t _tilesPerSide, uint32_t _tileQuads) {
+
+	ocean = _ocean;
+	ocean->retain();
+
+	effect = _effect;
+	tilesPerSide = _tilesPerSide;
+	tileQuads = _tileQuads;
+}
+
+
+bool DXOceanSurface::createMaps(ID3D11Device *device) {
+
+	uint32_t size = ocean->getResolution();
+
+	return CreateMapTexture(device, size, ocean->getDisplacementMap(), &displacementTexture, &displacementSRV, &displacementUAV) &&
+		CreateMapTexture(device, size, ocean->getNormalMap(), &normalTexture, &normalSRV, &normalUAV);
+}
+
+
+bool DXOceanSurface::createSimulation(ID3D11Device *device, DXPipelineCache *pipelineCache) {
+
+	uint32_t size = ocean->getResolution();
+
+	// The initial spectrum does not change so it is uploaded once
+	ID3D11Texture2D *spectrumTexture = nullptr;
+
+	if (!CreateMapTexture(device, size, ocean->getInitialSpectrum(), &spectrumTexture, &spectrumSRV, nullptr)) {
+
+		if (spectrumTexture)
+			spectrumTexture->Release();
+
+		return false;
+	}
+
+	spectrumTexture->Release();
+
+	// Rows transformed by the first pass, one slice per transform
+	D3D11_TEXTURE2D_DESC rowsDesc;
+
+	ZeroMemory(&rowsDesc, sizeof(D3D11_TEXTURE2D_DESC));
+
+	rowsDesc.Width = size;
+	rowsDesc.Height = size;
+	rowsDesc.MipLevels = 1;
+	rowsDesc.ArraySize = 3;
+	rowsDesc.Format = DXGI_FORMAT_R32G32_FLOAT;
+	rowsDesc.SampleDesc.Count = 1;
+	rowsDesc.Usage = D3D11_USAGE_DEFAULT;
+	rowsDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_UNORDERED_ACCESS;
+
+	ID3D11Texture2D *rowsTexture = nullptr;
+	HRESULT hr = device->CreateTexture2D(&rowsDesc, nullptr, &rowsTexture);
+
+	if (SUCCEEDED(hr))
+		hr = device->CreateShaderResourceView(rowsTexture, nullptr, &rowsSRV);
+
+	if (SUCCEEDED(hr))
+		hr = device->CreateUnorderedAccessView(rowsTexture, nullptr, &rowsUAV);
+
+	if (rowsTexture)
+		rowsTexture->Release();
+
+	if (!SUCCEEDED(hr))
+		return false;
+
+	D3D11_BUFFER_DESC cbufferDesc;
+
+	ZeroMemory(&cbufferDesc, sizeof(D3D11_BUFFER_DESC));
+
+	cbufferDesc.ByteWidth = sizeof(OceanComputeConstants);
+	cbufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+	cbufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	cbufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+
+	if (!SUCCEEDED(device->CreateBuffer(&cbufferDesc, nullptr, &computeConstants)))
+		return false;
+
+	rowsShader = pipelineCache->getComputeShader("Shaders\\cso\\ocean_fft_rows_cs.cso");
+	columnsShader = pipelineCache->getComputeShader("Shaders\\cso\\ocean_fft_columns_cs.cso");
+
+	return rowsShader && columnsShader;
+}
+
+
+void DXOceanSurface::simulate(ID3D11DeviceContext *context, double time) {
+
+	const CGDOceanDesc& desc = ocean->getDesc();
+	uint32_t size = ocean->getResolution();
+	uint32_t log2Size = 0;
+
+	while ((1u << log2Size) < size)
+		log2Size++;
+
+	D3D11_MAPPED_SUBRESOURCE res;
+
+	if (!SUCCEEDED(context->Map(computeConstants, 0, D3D11_MAP_WRITE_DISCARD, 0, &res)))
+		return;
+
+	// The fraction of the repeat period is found in double precision so the phases stay accurate however large time grows
+	OceanComputeConstants *constants = (OceanComputeConstants*)res.pData;
+
+	constants->size = size;
+	constants->log2Size = log2Size;
+	constants->fraction = (FLOAT)ocean->getPeriodFraction(time);
+	constants->choppiness = desc.choppiness;
+	constants->frequencySpacing = (FLOAT)(2.0 * 3.14159265358979323846) / desc.patchSize; // as CGDOcean so the frequencies match
+	constants->gravity = desc.gravity;
+	constants->repeatPeriod = desc.repeatPeriod;
+	constants->padding = 0.0f;
+
+	context->Unmap(computeConstants, 0);
+
+	ID3D11ShaderResourceView *nullSRVs[2] = { nullptr, nullptr };
+	ID3D11UnorderedAccessView *nullUAVs[2] = { nullptr, nullptr };
+
+	// Spectrum and row transforms - one group per row
+	context->CSSetShader(rowsShader, nullptr, 0);
+	context->CSSetConstantBuffers(0, 1, &computeConstants);
+	context->CSSetShaderResources(0, 1, &spectrumSRV);
+	context->CSSetUnorderedAccessViews(0, 1, &rowsUAV, nullptr);
+	context->Dispatch(1, size, 1);
+
+	// Column transforms and the maps - one group per column.  The maps are unbound from the draw stages first so they can be bound for writing
+	ID3D11UnorderedAccessView *mapUAVs[2] = { displacementUAV, normalUAV };
+
+	context->VSSetShaderResources(0, 2, nullSRVs);
+	context->PSSetShaderResources(0, 2, nullSRVs);
+	context->CSSetUnorderedAccessViews(0, 2, nullUAVs, nullptr);
+	context->CSSetShader(columnsShader, nullptr, 0);
+	context->CSSetShaderResources(0, 1, &rowsSRV);
+	context->CSSetUnorderedAccessViews(0, 2, mapUAVs, nullptr);
+	context->Dispatch(size, 1, 1);
+
+	context->CSSetShaderResources(0, 1, nullSRVs);
+	context->CSSetUnorderedAccessViews(0, 2, nullUAVs, nullptr);
+	context->CSSetShader(nullptr, nullptr, 0);
+}
+
+
+
+//
+// Public interface
+//
+
+// Factory method
+DXOceanSurface* DXOceanSurface::CreateOceanSurface(ID3D11Device *device, DXPipelineCache *pipelineCache, CGDOcean *ocean, Effect *effect, Material *material, ID3D11ShaderResourceView *environmentMap, uint32_t tilesPerSide, uint32_t tileQuads) {
+
+	if (!device || !pipelineCache || !ocean || !effect || !material || tilesPerSide == 0 || tileQuads == 0)
+		return nullptr;
+
+	// The compute shaders transform a row or column in one group so the resolution is limited to 512 (see ocean_fft_rows_cs.hlsl)
+	if (ocean->getResolution() > fftGroupSize * 2)
+		return nullptr;
+
+	DXOceanSurface *surface = new DXOceanSurface(ocean, effect, tilesPerSide, tileQuads);
+
+	if (!surface->createMaps(device)) {
+
+		cout << "Cannot create ocean map textures\n";
+
+		surface->release();
+		return nullptr;
+	}
+
+	if (!surface->createSimulation(device, pipelineCache))
+		cout << "Ocean compute shaders not available - the ocean is simulated on the CPU\n";
+
+	D3D11_SAMPLER_DESC samplerDesc;
+
+	ZeroMemory(&samplerDesc, sizeof(D3D11_SAMPLER_DESC));
+
+	samplerDesc.Filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
+	samplerDesc.AddressU = D3D11_TEXTURE_ADDRESS_WRAP;
+	samplerDesc.AddressV = D3D11_TEXTURE_ADDRESS_WRAP;
+	samplerDesc.AddressW = D3D11_TEXTURE_ADDRESS_WRAP;
+	samplerDesc.MaxLOD = D3D11_FLOAT32_MAX;
+	samplerDesc.ComparisonFunc = D3D11_COMPARISON_NEVER;
+
+	surface->sampler = pipelineCache->getSamplerState(samplerDesc);
+
+	surface->environmentMap = environmentMap;
+
+	if (environmentMap)
+		environmentMap->AddRef();
+
+	surface->tile = new Grid(tileQuads + 1, tileQuads + 1, device, effect, nullptr, material);
+
+	return surface;
+}
+
+
+// Destructor
+DXOceanSurface::~DXOceanSurface() {
+
+	ID3D11DeviceChild *objects[] = { displacementTexture, normalTexture, displacementSRV, normalSRV, displacementUAV, normalUAV, environmentMap, sampler, spectrumSRV, rowsSRV, rowsUAV, computeConstants, rowsShader, columnsShader };
+
+	for (auto object : objects) {
+
+		if (object)
+			object->Release();
+	}
+
+	if (tile)
+		delete(tile);
+
+	ocean->release();
+}
+
+
+void DXOceanSurface::update(ID3D11DeviceContext *context, double time) {
+
+	PROFILE_SCOPE("DXOceanSurface::update");
+
+	if (gpuSimulation) {
+
+		simulate(context, time);
+		return;
+	}
+
+	ocean->update(time);
+
+	uint32_t pitch = ocean->getResolution() * 4 * sizeof(float);
+
+	context->UpdateSubresource(displacementTexture, 0, nullptr, ocean->getDisplacementMap(), pitch, 0);
+	context->UpdateSubresource(normalTexture, 0, nullptr, ocean->getNormalMap(), pitch, 0);
+}
+
+
+void DXOceanSurface::submit(CGDRenderQueue *queue, const CGDConstantBinding& constants, float depth, uint32_t layer) {
+
+	if (!queue || !tile || !tile->vertexBuffer || !tile->indexBuffer)
+		return;
+
+	CGDDrawPacket packet;
+
+	ZeroMemory(&packet, sizeof(CGDDrawPacket));
+
+	effect->preparePacket(&packet);
+	packet.constants = constants;
+
+	packet.shaderResources[0] = normalSRV;
+	packet.shaderResources[1] = environmentMap;
+	packet.numShaderResources = 2;
+	packet.vertexShaderResources[0] = displacementSRV;
+	packet.numVertexShaderResources = 1;
+	packet.sampler = sampler;
+
+	packet.vertexBuffer = tile->vertexBuffer;
+	packet.vertexStride = sizeof(DXVertexExt);
+	packet.indexBuffer = tile->indexBuffer;
+	packet.indexFormat = DXGI_FORMAT_R32_UINT;
+	packet.topology = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+	packet.indexCount = tile->getNumInd();
+	packet.instanceCount = tilesPerSide * tilesPerSide;
+
+	queue->submit(queue->makeKey(layer, effect, normalSRV, tile->vertexBuffer, depth), packet);
+}
+
+
+bool DXOceanSurface::setGPUSimulation(bool enable) {
+
+	gpuSimulation = enable && rowsShader && columnsShader;
+
+	return gpuSimulation;
+}
+
+
+bool DXOceanSurface::isGPUSimulation() const {
+
+	return gpuSimulation;
+}
+
+
+CGDOcean* DXOceanSurface::getOcean() const {
+
+	return ocean;
+}
+
+
+uint32_t DXOceanSurface::getTilesPerSide() const {
+
+	return tilesPerSide;
+}
+
+
+uint32_t DXOceanSurface::getTileQuads() const {
+
+	return tileQuads;
+}
+
+
+float DXOceanSurface::getPatchSize() const {
+
+	return ocean->getDesc().patchSize;
+}
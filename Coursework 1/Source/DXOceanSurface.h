@@ -0,0 +1,96 @@
+//
+// DXOceanSurface.h
+//
+
+// D3D11 water surface for a CGDOcean.  The displacement and normal maps live in two R32G32B32A32_FLOAT textures and the surface is drawn as one instanced draw of a flat grid tile - instance i is tile (i % tilesPerSide, i / tilesPerSide) and ocean_vs.hlsl offsets it by whole patches, samples the displacement map (which wraps every patch so the tiles join seamlessly) and moves the vertex.  ocean_ps.hlsl shades the water from the normal map with a Fresnel blend between the water colour and the environment map.
+//
+// The maps are produced on the CPU by default - update evaluates the ocean (the SSE FFT on the job system) and uploads both maps with UpdateSubresource.  With the GPU simulation enabled update instead dispatches two compute shaders on the context.  ocean_fft_rows_cs.hlsl evaluates the spectrum from the ocean's initial spectrum (uploaded once on creation) and transforms each row in groupshared memory, ocean_fft_columns_cs.hlsl transforms each column and writes the maps through UAVs.  The compute shaders follow CGDOcean::updateReference so either path can be checked against the CPU maps.  If the compute shaders cannot be created the surface stays on the CPU path.
+
+#pragma once
+
+#include <d3d11_2.h>
+#include <GUObject.h>
+#include <cstdint>
+
+class CGDOcean;
+class CGDRenderQueue;
+struct CGDConstantBinding;
+class DXPipelineCache;
+class Effect;
+class Grid;
+class Material;
+
+
+class DXOceanSurface : public GUObject {
+
+	CGDOcean						*ocean = nullptr;
+	Grid							*tile = nullptr;
+	Effect							*effect = nullptr;
+	uint32_t						tilesPerSide = 0;
+	uint32_t						tileQuads = 0;
+
+	// Maps (size * size, written by UpdateSubresource or the compute shaders)
+	ID3D11Texture2D					*displacementTexture = nullptr;
+	ID3D11Texture2D					*normalTexture = nullptr;
+	ID3D11ShaderResourceView		*displacementSRV = nullptr;
+	ID3D11ShaderResourceView		*normalSRV = nullptr;
+	ID3D11UnorderedAccessView		*displacementUAV = nullptr;
+	ID3D11UnorderedAccessView		*normalUAV = nullptr;
+	ID3D11ShaderResourceView		*environmentMap = nullptr;
+	ID3D11SamplerState				*sampler = nullptr; // linear wrap
+
+	// GPU simulation - initial spectrum, rows transformed by the first pass (3 slices, one per transform), constants and shaders
+	ID3D11ShaderResourceView		*spectrumSRV = nullptr;
+	ID3D11ShaderResourceView		*rowsSRV = nullptr;
+	ID3D11UnorderedAccessView		*rowsUAV = nullptr;
+	ID3D11Buffer					*computeConstants = nullptr;
+	ID3D11ComputeShader				*rowsShader = nullptr;
+	ID3D11ComputeShader				*columnsShader = nullptr;
+	bool							gpuSimulation = false;
+
+
+	//
+	// Private interface
+	//
+
+	// Constructor - called internally by the CreateOceanSurface factory method
+	DXOceanSurface(CGDOcean *ocean, Effect *effect, uint32_t tilesPerSide, uint32_t tileQuads);
+
+	// Create the map textures and views.  Return false if they cannot be created
+	bool createMaps(ID3D11Device *device);
+
+	// Create the GPU simulation resources and shaders.  Return false if the GPU simulation is not available
+	bool createSimulation(ID3D11Device *device, DXPipelineCache *pipelineCache);
+
+	// Dispatch the compute shaders for time
+	void simulate(ID3D11DeviceContext *context, double time);
+
+
+public:
+
+	//
+	// Public interface
+	//
+
+	// Factory method.  ocean is retained.  The surface is tilesPerSide * tilesPerSide patches, each drawn as a grid of tileQuads * tileQuads quads with effect (which must use ocean_vs.hlsl / ocean_ps.hlsl and outlive the surface).  environmentMap is the cube map reflected by the water.  Return nullptr if the surface cannot be created
+	static DXOceanSurface* CreateOceanSurface(ID3D11Device *device, DXPipelineCache *pipelineCache, CGDOcean *ocean, Effect *effect, Material *material, ID3D11ShaderResourceView *environmentMap, uint32_t tilesPerSide, uint32_t tileQuads = 64);
+
+	// Destructor
+	~DXOceanSurface();
+
+	// Produce the maps for time (seconds) on the CPU or GPU and make them current on context (the immediate context)
+	void update(ID3D11DeviceContext *context, double time);
+
+	// Queue the instanced draw of every tile with the given per-object constants (the tile layout is in the frame constants - see CBufferFrame::oceanPatchSize)
+	void submit(CGDRenderQueue *queue, const CGDConstantBinding& constants, float depth = 0.0f, uint32_t layer = 0);
+
+	// Use the compute shaders (true) or the CPU ocean (false).  Return the path in use - the GPU simulation is not available if its shaders could not be created
+	bool setGPUSimulation(bool enable);
+	bool isGPUSimulation() const;
+
+	// Query methods
+	CGDOcean* getOcean() const;
+	uint32_t getTilesPerSide() const;
+	uint32_t getTileQuads() const;
+	float getPatchSize() const;
+};
@@ -0,0 +1,300 @@
+
+//
+// DXPipelineCache.cpp
+//
+
+#include <stdafx.h>
+#include <DXPipelineCache.h>
+#include <string>
+
+using namespace std;
+
+
+// Input layout creation descriptor passed to DXPipelineDevice
+struct DXInputLayoutDesc {
+
+	const D3D11_INPUT_ELEMENT_DESC		*elements;
+	UINT								numElements;
+};
+
+
+// D3D11 implementation of CGDPipelineDevice.  All pipeline objects are COM interfaces so references are managed through IUnknown
+class DXPipelineDevice : public CGDPipelineDevice {
+
+	ID3D11Device				*device;
+
+public:
+
+	DXPipelineDevice(ID3D11Device *_device) {
+
+		device = _device;
+		device->AddRef();
+	}
+
+	~DXPipelineDevice() {
+
+		device->Release();
+	}
+
+	void* createObject(CGDPipelineObjectType type, const void *desc, const CGDShaderBytecode *bytecode) {
+
+		IUnknown *object = nullptr;
+		HRESULT hr = E_FAIL;
+
+		switch (type) {
+
+		case CGDPipelineObjectType::RASTERIZER_STATE: {
+
+			ID3D11RasterizerState *state = nullptr;
+			hr = device->CreateRasterizerState((const D3D11_RASTERIZER_DESC*)desc, &state);
+			object = state;
+			break;
+		}
+
+		case CGDPipelineObjectType::DEPTH_STENCIL_STATE: {
+
+			ID3D11DepthStencilState *state = nullptr;
+			hr = device->CreateDepthStencilState((const D3D11_DEPTH_STENCIL_DESC*)desc, &state);
+			object = state;
+			break;
+		}
+
+		case CGDPipelineObjectType::BLEND_STATE: {
+
+			ID3D11BlendState *state = nullptr;
+			hr = device->CreateBlendState((const D3D11_BLEND_DESC*)desc, &state);
+			object = state;
+			break;
+		}
+
+		case CGDPipelineObjectType::SAMPLER_STATE: {
+
+			ID3D11SamplerState *state = nullptr;
+			hr = device->CreateSamplerState((const D3D11_SAMPLER_DESC*)desc, &state);
+			object = state;
+			break;
+		}
+
+		case CGDPipelineObjectType::INPUT_LAYOUT: {
+
+			const DXInputLayoutDesc *layoutDesc = (const DXInputLayoutDesc*)desc;
+			ID3D11InputLayout *layout = nullptr;
+			hr = device->CreateInputLayout(layoutDesc->elements, layoutDesc->numElements, bytecode->data, bytecode->size, &layout);
+			object = layout;
+			break;
+		}
+
+		case CGDPipelineObjectType::VERTEX_SHADER: {
+
+			ID3D11VertexShader *shader = nullptr;
+			hr = device->CreateVertexShader(bytecode->data, bytecode->size, NULL, &shader);
+			object = shader;
+			break;
+		}
+
+		case CGDPipelineObjectType::PIXEL_SHADER: {
+
+			ID3D11PixelShader *shader = nullptr;
+			hr = device->CreatePixelShader(bytecode->data, bytecode->size, NULL, &shader);
+			object = shader;
+			break;
+		}
+
+		case CGDPipelineObjectType::GEOMETRY_SHADER: {
+
+			ID3D11GeometryShader *shader = nullptr;
+			hr = device->CreateGeometryShader(bytecode->data, bytecode->size, NULL, &shader);
+			object = shader;
+			break;
+		}
+
+		case CGDPipelineObjectType::COMPUTE_SHADER: {
+
+			ID3D11ComputeShader *shader = nullptr;
+			hr = device->CreateComputeShader(bytecode->data, bytecode->size, NULL, &shader);
+			object = shader;
+			break;
+		}
+
+		default:
+			break;
+		}
+
+		return (SUCCEEDED(hr)) ? object : nullptr;
+	}
+
+	void retainObject(void *object) {
+
+		((IUnknown*)object)->AddRef();
+	}
+
+	void releaseObject(void *object) {
+
+		((IUnknown*)object)->Release();
+	}
+};
+
+
+
+//
+// Private interface
+//
+
+// Constructor - called internally by the CreatePipelineCache factory method
+DXPipelineCache::DXPipelineCache(CGDPipelineDevice *device) : CGDPipelineCache(device) {
+}
+
+
+
+//
+// Public interface
+//
+
+// Factory method
+DXPipelineCache* DXPipelineCache::CreatePipelineCache(ID3D11Device *device) {
+
+	if (!device)
+		return nullptr;
+
+	DXPipelineDevice *pipelineDevice = new DXPipelineDevice(device);
+	DXPipelineCache *cache = new DXPipelineCache(pipelineDevice);
+
+	// The cache holds its own reference on the device
+	pipelineDevice->release();
+
+	return cache;
+}
+
+
+ID3D11RasterizerState* DXPipelineCache::getRasterizerState(const D3D11_RASTERIZER_DESC& desc) {
+
+	// D3D11_RASTERIZER_DESC has no padding so the descriptor is its own key
+	return (ID3D11RasterizerState*)(IUnknown*)acquireObject(CGDPipelineObjectType::RASTERIZER_STATE, &desc, sizeof(D3D11_RASTERIZER_DESC), &desc, nullptr);
+}
+
+
+ID3D11DepthStencilState* DXPipelineCache::getDepthStencilState(const D3D11_DEPTH_STENCIL_DESC& desc) {
+
+	// Copy fields individually so the padding following the stencil masks is zero in the key
+	D3D11_DEPTH_STENCIL_DESC key;
+
+	ZeroMemory(&key, sizeof(D3D11_DEPTH_STENCIL_DESC));
+
+	key.DepthEnable = desc.DepthEnable;
+	key.DepthWriteMask = desc.DepthWriteMask;
+	key.DepthFunc = desc.DepthFunc;
+	key.StencilEnable = desc.StencilEnable;
+	key.StencilReadMask = desc.StencilReadMask;
+	key.StencilWriteMask = desc.StencilWriteMask;
+	key.FrontFace = desc.FrontFace;
+	key.BackFace = desc.BackFace;
+
+	return (ID3D11DepthStencilState*)(IUnknown*)acquireObject(CGDPipelineObjectType::DEPTH_STENCIL_STATE, &key, sizeof(D3D11_DEPTH_STENCIL_DESC), &key, nullptr);
+}
+
+
+ID3D11BlendState* DXPipelineCache::getBlendState(const D3D11_BLEND_DESC& desc) {
+
+	// Copy fields individually so the padding following each write mask is zero in the key.  If independent blending is disabled only RenderTarget[0] is used so the remaining targets are left cleared
+	D3D11_BLEND_DESC key;
+
+	ZeroMemory(&key, sizeof(D3D11_BLEND_DESC));
+
+	key.AlphaToCoverageEnable = desc.AlphaToCoverageEnable;
+	key.IndependentBlendEnable = desc.IndependentBlendEnable;
+
+	UINT numTargets = (desc.IndependentBlendEnable) ? D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT : 1;
+
+	for (UINT i = 0; i < numTargets; i++) {
+
+		key.RenderTarget[i].BlendEnable = desc.RenderTarget[i].BlendEnable;
+		key.RenderTarget[i].SrcBlend = desc.RenderTarget[i].SrcBlend;
+		key.RenderTarget[i].DestBlend = desc.RenderTarget[i].DestBlend;
+		key.RenderTarget[i].BlendOp = desc.RenderTarget[i].BlendOp;
+		key.RenderTarget[i].SrcBlendAlpha = desc.RenderTarget[i].SrcBlendAlpha;
+		key.RenderTarget[i].DestBlendAlpha = desc.RenderTarget[i].DestBlendAlpha;
+		key.RenderTarget[i].BlendOpAlpha = desc.RenderTarget[i].BlendOpAlpha;
+		key.RenderTarget[i].RenderTargetWriteMask = desc.RenderTarget[i].RenderTargetWriteMask;
+	}
+
+	return (ID3D11BlendState*)(IUnknown*)acquireObject(CGDPipelineObjectType::BLEND_STATE, &key, sizeof(D3D11_BLEND_DESC), &key, nullptr);
+}
+
+
+ID3D11SamplerState* DXPipelineCache::getSamplerState(const D3D11_SAMPLER_DESC& desc) {
+
+	// D3D11_SAMPLER_DESC has no padding so the descriptor is its own key
+	return (ID3D11SamplerState*)(IUnknown*)acquireObject(CGDPipelineObjectType::SAMPLER_STATE, &desc, sizeof(D3D11_SAMPLER_DESC), &desc, nullptr);
+}
+
+
+ID3D11VertexShader* DXPipelineCache::getVertexShader(const char *path, const CGDShaderBytecode **bytecode) {
+
+	const CGDShaderBytecode *vsBytecode = loadBytecode(path);
+
+	if (bytecode)
+		*bytecode = vsBytecode;
+
+	if (!vsBytecode)
+		return nullptr;
+
+	// Bytecode with identical content is shared by the cache so the bytecode address identifies the shader
+	return (ID3D11VertexShader*)(IUnknown*)acquireObject(CGDPipelineObjectType::VERTEX_SHADER, &vsBytecode, sizeof(vsBytecode), nullptr, vsBytecode);
+}
+
+
+ID3D11PixelShader* DXPipelineCache::getPixelShader(const char *path) {
+
+	const CGDShaderBytecode *psBytecode = loadBytecode(path);
+
+	if (!psBytecode)
+		return nullptr;
+
+	return (ID3D11PixelShader*)(IUnknown*)acquireObject(CGDPipelineObjectType::PIXEL_SHADER, &psBytecode, sizeof(psBytecode), nullptr, psBytecode);
+}
+
+
+ID3D11GeometryShader* DXPipelineCache::getGeometryShader(const char *path) {
+
+	const CGDShaderBytecode *gsBytecode = loadBytecode(path);
+
+	if (!gsBytecode)
+		return nullptr;
+
+	return (ID3D11GeometryShader*)(IUnknown*)acquireObject(CGDPipelineObjectType::GEOMETRY_SHADER, &gsBytecode, sizeof(gsBytecode), nullptr, gsBytecode);
+}
+
+
+ID3D11ComputeShader* DXPipelineCache::getComputeShader(const char *path) {
+
+	const CGDShaderBytecode *csBytecode = loadBytecode(path);
+
+	if (!csBytecode)
+		return nullptr;
+
+	return (ID3D11ComputeShader*)(IUnknown*)acquireObject(CGDPipelineObjectType::COMPUTE_SHADER, &csBytecode, sizeof(csBytecode), nullptr, csBytecode);
+}
+
+
+ID3D11InputLayout* DXPipelineCache::getInputLayout(const D3D11_INPUT_ELEMENT_DESC *elements, UINT numElements, const CGDShaderBytecode *vsBytecode) {
+
+	if (!elements || numElements == 0 || !vsBytecode)
+		return nullptr;
+
+	// Key - the vertex shader input signature hash followed by each element with its semantic name stored inline
+	string key((const char*)&vsBytecode->inputSignatureHash, sizeof(uint64_t));
+
+	for (UINT i = 0; i < numElements; i++) {
+
+		const D3D11_INPUT_ELEMENT_DESC& e = elements[i];
+		UINT fields[6] = { e.SemanticIndex, (UINT)e.Format, e.InputSlot, e.AlignedByteOffset, (UINT)e.InputSlotClass, e.InstanceDataStepRate };
+
+		key.append(e.SemanticName);
+		key.push_back('\0');
+		key.append((const char*)fields, sizeof(fields));
+	}
+
+	DXInputLayoutDesc desc = { elements, numElements };
+
+	return (ID3D11InputLayout*)(IUnknown*)acquireObject(CGDPipelineObjectType::INPUT_LAYOUT, key.data(), key.size(), &desc, vsBytecode);
+}
@@ -0,0 +1,48 @@
+//
+// DXPipelineCache.h
+//
+
+// D3D11 front end for CGDPipelineCache.  Each get method returns the shared instance for the given descriptor, shader file or (vertex elements, vertex shader input signature) pair, creating it on first use.  Returned interfaces carry a reference for the caller so they are released with Release as if they had been created directly on the device.
+//
+// State keys are built from a canonical copy of the descriptor (padding zeroed and unused blend render targets cleared) so descriptors that D3D11 treats as equal share an object.  Shaders are keyed on their bytecode so effects that use the same .cso file (eg. per_pixel_lighting_ps.cso) share a single shader interface.  Input layouts are keyed on the vertex elements (semantic names compared by value) and the hash of the vertex shader input signature, so vertex shaders with the same inputs share a layout.
+
+#pragma once
+
+#include <d3d11_2.h>
+#include <CGDPipelineCache.h>
+
+
+class DXPipelineCache : public CGDPipelineCache {
+
+	//
+	// Private interface
+	//
+
+	// Constructor - called internally by the CreatePipelineCache factory method
+	DXPipelineCache(CGDPipelineDevice *device);
+
+
+public:
+
+	//
+	// Public interface
+	//
+
+	// Factory method.  Return nullptr if the cache cannot be created
+	static DXPipelineCache* CreatePipelineCache(ID3D11Device *device);
+
+	// State objects
+	ID3D11RasterizerState* getRasterizerState(const D3D11_RASTERIZER_DESC& desc);
+	ID3D11DepthStencilState* getDepthStencilState(const D3D11_DEPTH_STENCIL_DESC& desc);
+	ID3D11BlendState* getBlendState(const D3D11_BLEND_DESC& desc);
+	ID3D11SamplerState* getSamplerState(const D3D11_SAMPLER_DESC& desc);
+
+	// Shaders loaded from compiled shader object (.cso) files.  If bytecode is not nullptr the shader's bytecode is returned in *bytecode (owned by the cache)
+	ID3D11VertexShader* getVertexShader(const char *path, const CGDShaderBytecode **bytecode = nullptr);
+	ID3D11PixelShader* getPixelShader(const char *path);
+	ID3D11GeometryShader* getGeometryShader(const char *path);
+	ID3D11ComputeShader* getComputeShader(const char *path);
+
+	// Input layout for the given vertex elements and vertex shader bytecode
+	ID3D11InputLayout* getInputLayout(const D3D11_INPUT_ELEMENT_DESC *elements, UINT numElements, const CGDShaderBytecode *vsBytecode);
+};
@@ -0,0 +1,422 @@
+
+//
+// DXPostProcess.cpp
+//
+
+#include <stdafx.h>
+#include <DXPostProcess.h>
+#include <DXPipelineCache.h>
+#include <CGDGPUProfiler.h>
+
+using namespace std;
+
+
+// Constants of the post-processing shaders (see post_composite_ps.hlsl)
+__declspec(align(16)) struct PostConstants {
+
+	DirectX::XMFLOAT4				sourceSize; // width, height, 1 / width, 1 / height of the texture sampled by the pass
+	DirectX::XMFLOAT4				blurTaps[CGD_MAX_BLUR_TAPS]; // x = offset in texels, y = weight
+	UINT							blurTapCount;
+	FLOAT							bloomThreshold;
+	FLOAT							bloomIntensity;
+	FLOAT							focusDistance;
+	FLOAT							focusRange;
+	FLOAT							nearPlane;
+	FLOAT							farPlane;
+	FLOAT							padding;
+};
+
+
+static const DXGI_FORMAT			targetFormat = DXGI_FORMAT_R16G16B16A16_FLOAT;
+
+
+// Create a width * height render target with a shader resource view
+static bool CreateTarget(ID3D11Device *device, uint32_t width, uint32_t height, ID3D11RenderTargetView **rtv, ID3D11ShaderResourceView **srv) {
+
+	D3D11_TEXTURE2D_DESC desc;
+
+	ZeroMemory(&desc, sizeof(D3D11_TEXTURE2D_DESC));
+
+	desc.Width = width;
+	desc.Height = height;
+	desc.MipLevels = 1;
+	desc.ArraySize = 1;
+	desc.Format = targetFormat;
+	desc.SampleDesc.Count = 1;
+	desc.Usage = D3D11_USAGE_DEFAULT;
+	desc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
+
+	ID3D11Texture2D *texture = nullptr;
+	HRESULT hr = device->CreateTexture2D(&desc, nullptr, &texture);
+
+	if (SUCCEEDED(hr))
+		hr = device->CreateRenderTargetView(texture, nullptr, rtv);
+
+	if (SUCCEEDED(hr))
+		hr = device->CreateShaderResourceView(texture, nullptr, srv);
+
+	// The views hold a reference to the texture
+	if (texture)
+		texture->Release();
+
+	return SUCCEEDED(hr);
+}
+
+
+
+//
+// Private interface
+//
+
+// Constructor - called internally by the CreatePostProcess factory method
+DXPostProcess::DXPostProcess(const CGDPostProcessDesc& _desc) {
+
+	ZeroMemory(&scene, sizeof(Target));
+	ZeroMemory(&half, sizeof(Target));
+	ZeroMemory(&halfScratch, sizeof(Target));
+	ZeroMemory(&dofTarget, sizeof(Target));
+
+	setDesc(_desc);
+}
+
+
+bool DXPostProcess::createTargets(ID3D11Device *device, uint32_t width, uint32_t height, ID3D11Texture2D *depthBuffer) {
+
+	releaseTargets();
+
+	uint32_t levels = max(desc.bloomLevels, 1u);
+	uint32_t w = max(width / 2, 1u);
+	uint32_t h = max(height / 2, 1u);
+
+	scene.width = width;
+	scene.height = height;
+	half.width = halfScratch.width = dofTarget.width = w;
+	half.height = halfScratch.height = dofTarget.height = h;
+
+	bloomTargets.resize(levels);
+	bloomScratch.resize(levels);
+
+	for (uint32_t i = 0; i < levels; i++) {
+
+		ZeroMemory(&bloomTargets[i], sizeof(Target));
+		ZeroMemory(&bloomScratch[i], sizeof(Target));
+
+		bloomTargets[i].width = bloomScratch[i].width = w;
+		bloomTargets[i].height = bloomScratch[i].height = h;
+
+		w = max(w / 2, 1u);
+		h = max(h / 2, 1u);
+	}
+
+	bool created = CreateTarget(device, scene.width, scene.height, &scene.rtv, &scene.srv) &&
+		CreateTarget(device, half.width, half.height, &half.rtv, &half.srv) &&
+		CreateTarget(device, halfScratch.width, halfScratch.height, &halfScratch.rtv, &halfScratch.srv) &&
+		CreateTarget(device, dofTarget.width, dofTarget.height, &dofTarget.rtv, &dofTarget.srv);
+
+	for (uint32_t i = 0; i < levels && created; i++) {
+
+		created = CreateTarget(device, bloomTargets[i].width, bloomTargets[i].height, &bloomTargets[i].rtv, &bloomTargets[i].srv) &&
+			CreateTarget(device, bloomScratch[i].width, bloomScratch[i].height, &bloomScratch[i].rtv, &bloomScratch[i].srv);
+	}
+
+	// The depth buffer is read as the 24 bit depth of the R24G8 texture
+	D3D11_SHADER_RESOURCE_VIEW_DESC depthDesc;
+
+	ZeroMemory(&depthDesc, sizeof(D3D11_SHADER_RESOURCE_VIEW_DESC));
+
+	depthDesc.Format = DXGI_FORMAT_R24_UNORM_X8_TYPELESS;
+	depthDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+	depthDesc.Texture2D.MipLevels = 1;
+
+	return created && depthBuffer && SUCCEEDED(device->CreateShaderResourceView(depthBuffer, &depthDesc, &depthSRV));
+}
+
+
+void DXPostProcess::releaseTargets() {
+
+	vector<Target*> targets = { &scene, &half, &halfScratch, &dofTarget };
+
+	for (size_t i = 0; i < bloomTargets.size(); i++) {
+
+		targets.push_back(&bloomTargets[i]);
+		targets.push_back(&bloomScratch[i]);
+	}
+
+	for (Target *t : targets) {
+
+		if (t->rtv)
+			t->rtv->Release();
+
+		if (t->srv)
+			t->srv->Release();
+
+		t->rtv = nullptr;
+		t->srv = nullptr;
+	}
+
+	bloomTargets.clear();
+	bloomScratch.clear();
+
+	if (depthSRV)
+		depthSRV->Release();
+
+	depthSRV = nullptr;
+}
+
+
+void DXPostProcess::setConstants(ID3D11DeviceContext *context, const Target& source, const CGDBlurKernel *kernel) {
+
+	D3D11_MAPPED_SUBRESOURCE res;
+
+	if (!SUCCEEDED(context->Map(constants, 0, D3D11_MAP_WRITE_DISCARD, 0, &res)))
+		return;
+
+	PostConstants *c = (PostConstants*)res.pData;
+
+	c->sourceSize = DirectX::XMFLOAT4((float)source.width, (float)source.height, 1.0f / (float)source.width, 1.0f / (float)source.height);
+	c->blurTapCount = (kernel) ? kernel->numTaps : 0;
+
+	for (uint32_t i = 0; i < CGD_MAX_BLUR_TAPS; i++)
+		c->blurTaps[i] = (kernel && i < kernel->numTaps) ? DirectX::XMFLOAT4(kernel->offsets[i], kernel->weights[i], 0.0f, 0.0f) : DirectX::XMFLOAT4(0.0f, 0.0f, 0.0f, 0.0f);
+
+	c->bloomThreshold = desc.bloomThreshold;
+	c->bloomIntensity = desc.bloomIntensity;
+	c->focusDistance = desc.focusDistance;
+	c->focusRange = desc.focusRange;
+	c->nearPlane = desc.nearPlane;
+	c->farPlane = desc.farPlane;
+	c->padding = 0.0f;
+
+	context->Unmap(constants, 0);
+}
+
+
+void DXPostProcess::draw(ID3D11DeviceContext *context, ID3D11PixelShader *shader, const Target& source, const Target& target, const CGDBlurKernel *kernel, bool add) {
+
+	setConstants(context, source, kernel);
+
+	// Unbind the previous pass's source first in case it is this pass's target
+	ID3D11ShaderResourceView *nullSRV = nullptr;
+
+	context->PSSetShaderResources(0, 1, &nullSRV);
+	context->OMSetRenderTargets(1, &target.rtv, nullptr);
+	context->PSSetShaderResources(0, 1, &source.srv);
+
+	D3D11_VIEWPORT viewport = { 0.0f, 0.0f, (FLOAT)target.width, (FLOAT)target.height, 0.0f, 1.0f };
+
+	context->RSSetViewports(1, &viewport);
+	context->OMSetBlendState((add) ? additiveBlend : nullptr, nullptr, 0xFFFFFFFF);
+	context->PSSetShader(shader, nullptr, 0);
+	context->Draw(3, 0);
+}
+
+
+void DXPostProcess::blur(ID3D11DeviceContext *context, const Target& source, const Target& scratch, const Target& target, const CGDBlurKernel& kernel) {
+
+	draw(context, blurUShader, source, scratch, &kernel);
+	draw(context, blurVShader, scratch, target, &kernel);
+}
+
+
+
+//
+// Public interface
+//
+
+// Factory method
+DXPostProcess* DXPostProcess::CreatePostProcess(ID3D11Device *device, DXPipelineCache *pipelineCache, uint32_t width, uint32_t height, ID3D11Texture2D *depthBuffer, const CGDPostProcessDesc& desc) {
+
+	if (!device || !pipelineCache || width == 0 || height == 0 || !depthBuffer)
+		return nullptr;
+
+	DXPostProcess *postProcess = new DXPostProcess(desc);
+
+	postProcess->vertexShader = pipelineCache->getVertexShader("Shaders\\cso\\post_vs.cso");
+	postProcess->resampleShader = pipelineCache->getPixelShader("Shaders\\cso\\post_resample_ps.cso");
+	postProcess->brightShader = pipelineCache->getPixelShader("Shaders\\cso\\post_bright_ps.cso");
+	postProcess->blurUShader = pipelineCache->getPixelShader("Shaders\\cso\\convolve_u_ps.cso");
+	postProcess->blurVShader = pipelineCache->getPixelShader("Shaders\\cso\\convolve_v_ps.cso");
+	postProcess->compositeShader = pipelineCache->getPixelShader("Shaders\\cso\\post_composite_ps.cso");
+
+	D3D11_BUFFER_DESC cbufferDesc;
+
+	ZeroMemory(&cbufferDesc, sizeof(D3D11_BUFFER_DESC));
+
+	cbufferDesc.ByteWidth = sizeof(PostConstants);
+	cbufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+	cbufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	cbufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+
+	HRESULT hr = device->CreateBuffer(&cbufferDesc, nullptr, &postProcess->constants);
+
+	if (!SUCCEEDED(hr) || !postProcess->vertexShader || !postProcess->resampleShader || !postProcess->brightShader || !postProcess->blurUShader || !postProcess->blurVShader || !postProcess->compositeShader || !postProcess->createTargets(device, width, height, depthBuffer)) {
+
+		cout << "Cannot create post-processing shaders and targets\n";
+
+		postProcess->release();
+		return nullptr;
+	}
+
+	D3D11_SAMPLER_DESC samplerDesc;
+
+	ZeroMemory(&samplerDesc, sizeof(D3D11_SAMPLER_DESC));
+
+	samplerDesc.Filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
+	samplerDesc.AddressU = D3D11_TEXTURE_ADDRESS_CLAMP;
+	samplerDesc.AddressV = D3D11_TEXTURE_ADDRESS_CLAMP;
+	samplerDesc.AddressW = D3D11_TEXTURE_ADDRESS_CLAMP;
+	samplerDesc.MaxLOD = D3D11_FLOAT32_MAX;
+	samplerDesc.ComparisonFunc = D3D11_COMPARISON_NEVER;
+
+	postProcess->sampler = pipelineCache->getSamplerState(samplerDesc);
+
+	// Upsampled levels are added to the level above
+	D3D11_BLEND_DESC blendDesc;
+
+	ZeroMemory(&blendDesc, sizeof(D3D11_BLEND_DESC));
+
+	blendDesc.RenderTarget[0].BlendEnable = TRUE;
+	blendDesc.RenderTarget[0].SrcBlend = D3D11_BLEND_ONE;
+	blendDesc.RenderTarget[0].DestBlend = D3D11_BLEND_ONE;
+	blendDesc.RenderTarget[0].BlendOp = D3D11_BLEND_OP_ADD;
+	blendDesc.RenderTarget[0].SrcBlendAlpha = D3D11_BLEND_ONE;
+	blendDesc.RenderTarget[0].DestBlendAlpha = D3D11_BLEND_ONE;
+	blendDesc.RenderTarget[0].BlendOpAlpha = D3D11_BLEND_OP_ADD;
+	blendDesc.RenderTarget[0].RenderTargetWriteMask = D3D11_COLOR_WRITE_ENABLE_ALL;
+
+	postProcess->additiveBlend = pipelineCache->getBlendState(blendDesc);
+
+	return postProcess;
+}
+
+
+// Destructor
+DXPostProcess::~DXPostProcess() {
+
+	releaseTargets();
+
+	ID3D11DeviceChild *objects[] = { constants, vertexShader, resampleShader, brightShader, blurUShader, blurVShader, compositeShader, sampler, additiveBlend };
+
+	for (auto object : objects) {
+
+		if (object)
+			object->Release();
+	}
+}
+
+
+bool DXPostProcess::resize(ID3D11Device *device, uint32_t width, uint32_t height, ID3D11Texture2D *depthBuffer) {
+
+	if (!device || width == 0 || height == 0)
+		return false;
+
+	return createTargets(device, width, height, depthBuffer);
+}
+
+
+void DXPostProcess::setDesc(const CGDPostProcessDesc& _desc) {
+
+	desc = _desc;
+
+	bloomKernel = CGDCreateBlurKernel(desc.bloomSigma);
+	dofKernel = CGDCreateBlurKernel(desc.dofSigma);
+}
+
+
+void DXPostProcess::render(ID3D11DeviceContext *context, ID3D11RenderTargetView *output, CGDGPUProfiler *profiler) {
+
+	PROFILE_SCOPE("DXPostProcess::render");
+
+	if (!context || !output || !scene.srv || !depthSRV)
+		return;
+
+	bool dof = desc.focusDistance > 0.0f;
+	bool bloom = desc.bloomIntensity > 0.0f;
+	uint32_t levels = (uint32_t)bloomTargets.size();
+
+	// Every pass draws a full screen triangle without vertex buffers
+	context->IASetInputLayout(nullptr);
+	context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	context->VSSetShader(vertexShader, nullptr, 0);
+	context->GSSetShader(nullptr, nullptr, 0);
+	context->RSSetState(nullptr);
+	context->OMSetDepthStencilState(nullptr, 0);
+	context->PSSetConstantBuffers(0, 1, &constants);
+	context->PSSetSamplers(0, 1, &sampler);
+
+	{
+		CGDGPUZone zone(profiler, CGDPostPassName(CGDPostPass::DOWNSAMPLE));
+
+		draw(context, resampleShader, scene, half);
+	}
+
+	if (dof) {
+
+		CGDGPUZone zone(profiler, CGDPostPassName(CGDPostPass::DOF_BLUR));
+
+		blur(context, half, halfScratch, dofTarget, dofKernel);
+	}
+
+	if (bloom) {
+
+		{
+			CGDGPUZone zone(profiler, CGDPostPassName(CGDPostPass::BRIGHT_PASS));
+
+			draw(context, brightShader, half, bloomTargets[0]);
+		}
+
+		{
+			CGDGPUZone zone(profiler, CGDPostPassName(CGDPostPass::BLOOM_DOWNSAMPLE));
+
+			for (uint32_t i = 1; i < levels; i++)
+				draw(context, resampleShader, bloomTargets[i - 1], bloomTargets[i]);
+		}
+
+		{
+			CGDGPUZone zone(profiler, CGDPostPassName(CGDPostPass::BLOOM_BLUR));
+
+			for (uint32_t i = 0; i < levels; i++)
+				blur(context, bloomTargets[i], bloomScratch[i], bloomTargets[i], bloomKernel);
+		}
+
+		{
+			CGDGPUZone zone(profiler, CGDPostPassName(CGDPostPass::BLOOM_UPSAMPLE));
+
+			for (uint32_t i = levels - 1; i > 0; i--)
+				draw(context, resampleShader, bloomTargets[i], bloomTargets[i - 1], nullptr, true);
+		}
+	}
+
+	{
+		CGDGPUZone zone(profiler, CGDPostPassName(CGDPostPass::COMPOSITE));
+
+		setConstants(context, scene, nullptr);
+
+		ID3D11ShaderResourceView *views[4] = { scene.srv, dofTarget.srv, bloomTargets[0].srv, depthSRV };
+		D3D11_VIEWPORT viewport = { 0.0f, 0.0f, (FLOAT)scene.width, (FLOAT)scene.height, 0.0f, 1.0f };
+
+		context->OMSetRenderTargets(1, &output, nullptr);
+		context->PSSetShaderResources(0, 4, views);
+		context->RSSetViewports(1, &viewport);
+		context->OMSetBlendState(nullptr, nullptr, 0xFFFFFFFF);
+		context->PSSetShader(compositeShader, nullptr, 0);
+		context->Draw(3, 0);
+	}
+
+	// Unbind the chain so the scene target and depth buffer can be written next frame
+	ID3D11ShaderResourceView *nullSRVs[4] = { nullptr, nullptr, nullptr, nullptr };
+
+	context->PSSetShaderResources(0, 4, nullSRVs);
+}
+
+
+ID3D11RenderTargetView* DXPostProcess::getSceneRTV() const {
+
+	return scene.rtv;
+}
+
+
+const CGDPostProcessDesc& DXPostProcess::getDesc() const {
+
+	return desc;
+}
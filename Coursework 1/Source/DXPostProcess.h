@@ -0,0 +1,101 @@
+//
+// DXPostProcess.h
+//
+
+// D3D11 post-processing chain - the CGDPostProcess chain (bloom and depth of field) run with pixel shaders.  The scene is rendered into getSceneRTV (R16G16B16A16_FLOAT, so highlights above 1 survive to the bright pass) and render draws the chain into the given output, normally the back buffer.  Every pass is a full screen triangle (post_vs.hlsl) drawn into one render target with a linear clamp sampler - post_resample_ps.hlsl for the downsample and upsample passes (upsampling adds to the larger level with additive blending), post_bright_ps.hlsl for the bright pass, convolve_u_ps.hlsl / convolve_v_ps.hlsl for the separable blurs, which ping-pong between each image and a scratch target of the same size, and post_composite_ps.hlsl into the output.
+//
+// Blur kernels are generated from sigma by CGDCreateBlurKernel and passed to the shaders in the constant buffer, so the chain can be checked against CGDPostProcess::processReference.  Each pass is timed with the GPU profiler under its CGDPostPassName.
+
+#pragma once
+
+#include <d3d11_2.h>
+#include <GUObject.h>
+#include <CGDPostProcess.h>
+#include <cstdint>
+#include <vector>
+
+class CGDGPUProfiler;
+class DXPipelineCache;
+
+
+class DXPostProcess : public GUObject {
+
+	// Render target with a shader resource view
+	struct Target {
+
+		ID3D11RenderTargetView			*rtv;
+		ID3D11ShaderResourceView		*srv;
+		uint32_t						width;
+		uint32_t						height;
+	};
+
+	CGDPostProcessDesc					desc;
+	CGDBlurKernel						bloomKernel;
+	CGDBlurKernel						dofKernel;
+
+	// Chain targets (see CGDPostProcess)
+	Target								scene;
+	Target								half;
+	Target								halfScratch;
+	Target								dofTarget;
+	std::vector<Target>					bloomTargets; // bloomLevels targets from half resolution down
+	std::vector<Target>					bloomScratch;
+	ID3D11ShaderResourceView			*depthSRV = nullptr; // scene depth buffer
+
+	ID3D11Buffer						*constants = nullptr;
+	ID3D11VertexShader					*vertexShader = nullptr;
+	ID3D11PixelShader					*resampleShader = nullptr;
+	ID3D11PixelShader					*brightShader = nullptr;
+	ID3D11PixelShader					*blurUShader = nullptr;
+	ID3D11PixelShader					*blurVShader = nullptr;
+	ID3D11PixelShader					*compositeShader = nullptr;
+	ID3D11SamplerState					*sampler = nullptr; // linear clamp
+	ID3D11BlendState					*additiveBlend = nullptr;
+
+
+	//
+	// Private interface
+	//
+
+	// Constructor - called internally by the CreatePostProcess factory method
+	DXPostProcess(const CGDPostProcessDesc& desc);
+
+	// Create the targets for a width * height scene and the view of its depth buffer.  Return false if they cannot be created
+	bool createTargets(ID3D11Device *device, uint32_t width, uint32_t height, ID3D11Texture2D *depthBuffer);
+	void releaseTargets();
+
+	// Write the constants for a pass sampling source (with kernel if it is a blur)
+	void setConstants(ID3D11DeviceContext *context, const Target& source, const CGDBlurKernel *kernel);
+
+	// Draw a full screen triangle into target with shader, sampling source.  add = blend additively into the target
+	void draw(ID3D11DeviceContext *context, ID3D11PixelShader *shader, const Target& source, const Target& target, const CGDBlurKernel *kernel = nullptr, bool add = false);
+
+	// Horizontal pass source -> scratch, vertical pass scratch -> target
+	void blur(ID3D11DeviceContext *context, const Target& source, const Target& scratch, const Target& target, const CGDBlurKernel& kernel);
+
+
+public:
+
+	//
+	// Public interface
+	//
+
+	// Factory method.  width * height is the scene size and depthBuffer its depth buffer, which must have been created with a typeless 24 bit depth format (R24G8_TYPELESS) and shader resource binding (see DXSystem).  Return nullptr if the shaders or targets cannot be created
+	static DXPostProcess* CreatePostProcess(ID3D11Device *device, DXPipelineCache *pipelineCache, uint32_t width, uint32_t height, ID3D11Texture2D *depthBuffer, const CGDPostProcessDesc& desc = CGDPostProcessDesc());
+
+	// Destructor
+	~DXPostProcess();
+
+	// Recreate the targets for a new scene size (eg. after the swap chain is resized).  Return false if they cannot be created
+	bool resize(ID3D11Device *device, uint32_t width, uint32_t height, ID3D11Texture2D *depthBuffer);
+
+	// Replace the settings.  Changing bloomLevels needs a resize to take effect
+	void setDesc(const CGDPostProcessDesc& desc);
+
+	// Run the chain on the scene target into output on context.  Each pass is timed by profiler (may be nullptr).  The context's pipeline state is changed - callers caching state must invalidate it
+	void render(ID3D11DeviceContext *context, ID3D11RenderTargetView *output, CGDGPUProfiler *profiler = nullptr);
+
+	// Query methods
+	ID3D11RenderTargetView* getSceneRTV() const;
+	const CGDPostProcessDesc& getDesc() const;
+};
@@ -0,0 +1,234 @@
+
+//
+// DXRenderContext.cpp
+//
+
+#include <stdafx.h>
+#include <DXRenderContext.h>
+
+using namespace std;
+
+
+
+//
+// Private interface
+//
+
+// Constructor - called internally by the CreateRenderContext factory method
+DXRenderContext::DXRenderContext(ID3D11DeviceContext *_context) {
+
+	context = _context;
+	context->AddRef();
+
+	if (!SUCCEEDED(context->QueryInterface(__uuidof(ID3D11DeviceContext1), (void**)&context1)))
+		context1 = nullptr;
+}
+
+
+
+//
+// Public interface
+//
+
+// Factory method
+DXRenderContext* DXRenderContext::CreateRenderContext(ID3D11DeviceContext *context) {
+
+	if (!context)
+		return nullptr;
+
+	return new DXRenderContext(context);
+}
+
+
+// Destructor
+DXRenderContext::~DXRenderContext() {
+
+	if (context1)
+		context1->Release();
+
+	context->Release();
+}
+
+
+void DXRenderContext::setInputLayout(void *layout) {
+
+	context->IASetInputLayout((ID3D11InputLayout*)layout);
+}
+
+
+void DXRenderContext::setVertexBuffer(uint32_t slot, void *buffer, uint32_t stride, uint32_t offset) {
+
+	ID3D11Buffer *vertexBuffer = (ID3D11Buffer*)buffer;
+
+	context->IASetVertexBuffers(slot, 1, &vertexBuffer, &stride, &offset);
+}
+
+
+void DXRenderContext::setIndexBuffer(void *buffer, uint32_t format, uint32_t offset) {
+
+	context->IASetIndexBuffer((ID3D11Buffer*)buffer, (DXGI_FORMAT)format, offset);
+}
+
+
+void DXRenderContext::setPrimitiveTopology(uint32_t topology) {
+
+	context->IASetPrimitiveTopology((D3D11_PRIMITIVE_TOPOLOGY)topology);
+}
+
+
+void DXRenderContext::setShader(CGDShaderStage stage, void *shader) {
+
+	switch (stage) {
+
+	case CGDShaderStage::VERTEX:
+		context->VSSetShader((ID3D11VertexShader*)shader, 0, 0);
+		break;
+
+	case CGDShaderStage::PIXEL:
+		context->PSSetShader((ID3D11PixelShader*)shader, 0, 0);
+		break;
+
+	case CGDShaderStage::GEOMETRY:
+		context->GSSetShader((ID3D11GeometryShader*)shader, 0, 0);
+		break;
+
+	default:
+		break;
+	}
+}
+
+
+void DXRenderContext::setConstantBuffers(CGDShaderStage stage, uint32_t slot, uint32_t count, void *const *buffers) {
+
+	ID3D11Buffer *const *b = (ID3D11Buffer *const *)buffers;
+
+	switch (stage) {
+
+	case CGDShaderStage::VERTEX:
+		context->VSSetConstantBuffers(slot, count, b);
+		break;
+
+	case CGDShaderStage::PIXEL:
+		context->PSSetConstantBuffers(slot, count, b);
+		break;
+
+	case CGDShaderStage::GEOMETRY:
+		context->GSSetConstantBuffers(slot, count, b);
+		break;
+
+	default:
+		break;
+	}
+}
+
+
+void DXRenderContext::setConstantBufferRange(CGDShaderStage stage, uint32_t slot, void *buffer, uint32_t firstConstant, uint32_t numConstants) {
+
+	ID3D11Buffer *b = (ID3D11Buffer*)buffer;
+
+	// Binding the whole buffer would give the shader the first slot's constants, so a range cannot be bound without the D3D11.1 runtime (DXConstantBufferBackend is not created without it)
+	if (!context1)
+		throw exception("Constant buffer ranges need the D3D11.1 runtime");
+
+	switch (stage) {
+
+	case CGDShaderStage::VERTEX:
+		context1->VSSetConstantBuffers1(slot, 1, &b, &firstConstant, &numConstants);
+		break;
+
+	case CGDShaderStage::PIXEL:
+		context1->PSSetConstantBuffers1(slot, 1, &b, &firstConstant, &numConstants);
+		break;
+
+	case CGDShaderStage::GEOMETRY:
+		context1->GSSetConstantBuffers1(slot, 1, &b, &firstConstant, &numConstants);
+		break;
+
+	default:
+		break;
+	}
+}
+
+
+void DXRenderContext::setShaderResources(CGDShaderStage stage, uint32_t slot, uint32_t count, void *const *views) {
+
+	ID3D11ShaderResourceView *const *v = (ID3D11ShaderResourceView *const *)views;
+
+	switch (stage) {
+
+	case CGDShaderStage::VERTEX:
+		context->VSSetShaderResources(slot, count, v);
+		break;
+
+	case CGDShaderStage::PIXEL:
+		context->PSSetShaderResources(slot, count, v);
+		break;
+
+	case CGDShaderStage::GEOMETRY:
+		context->GSSetShaderResources(slot, count, v);
+		break;
+
+	default:
+		break;
+	}
+}
+
+
+void DXRenderContext::setSamplers(CGDShaderStage stage, uint32_t slot, uint32_t count, void *const *samplers) {
+
+	ID3D11SamplerState *const *s = (ID3D11SamplerState *const *)samplers;
+
+	switch (stage) {
+
+	case CGDShaderStage::VERTEX:
+		context->VSSetSamplers(slot, count, s);
+		break;
+
+	case CGDShaderStage::PIXEL:
+		context->PSSetSamplers(slot, count, s);
+		break;
+
+	case CGDShaderStage::GEOMETRY:
+		context->GSSetSamplers(slot, count, s);
+		break;
+
+	default:
+		break;
+	}
+}
+
+
+void DXRenderContext::setRasterizerState(void *state) {
+
+	context->RSSetState((ID3D11RasterizerState*)state);
+}
+
+
+void DXRenderContext::setDepthStencilState(void *state, uint32_t stencilRef) {
+
+	context->OMSetDepthStencilState((ID3D11DepthStencilState*)state, stencilRef);
+}
+
+
+void DXRenderContext::setBlendState(void *state, const float blendFactor[4], uint32_t sampleMask) {
+
+	context->OMSetBlendState((ID3D11BlendState*)state, blendFactor, sampleMask);
+}
+
+
+void DXRenderContext::drawIndexed(uint32_t indexCount, uint32_t startIndex, int32_t baseVertex) {
+
+	context->DrawIndexed(indexCount, startIndex, baseVertex);
+}
+
+
+void DXRenderContext::drawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t startIndex, int32_t baseVertex, uint32_t startInstance) {
+
+	context->DrawIndexedInstanced(indexCount, instanceCount, startIndex, baseVertex, startInstance);
+}
+
+
+void DXRenderContext::draw(uint32_t vertexCount, uint32_t startVertex) {
+
+	context->Draw(vertexCount, startVertex);
+}
@@ -0,0 +1,58 @@
+//
+// DXRenderContext.h
+//
+
+// D3D11 implementation of CGDRenderContext.  Forwards each call to the wrapped ID3D11DeviceContext - handles are the corresponding D3D11 interfaces and formats / topologies the DXGI_FORMAT and D3D11_PRIMITIVE_TOPOLOGY values.  Constant buffer ranges are bound with the *SSetConstantBuffers1 methods of ID3D11DeviceContext1 - without the D3D11.1 runtime setConstantBufferRange throws
+
+#pragma once
+
+#include <d3d11_2.h>
+#include <CGDStateCache.h>
+
+
+class DXRenderContext : public CGDRenderContext {
+
+	ID3D11DeviceContext				*context = nullptr;
+	ID3D11DeviceContext1			*context1 = nullptr; // constant buffer ranges (D3D11.1 runtime)
+
+
+	//
+	// Private interface
+	//
+
+	// Constructor - called internally by the CreateRenderContext factory method
+	DXRenderContext(ID3D11DeviceContext *context);
+
+
+public:
+
+	//
+	// Public interface
+	//
+
+	// Factory method.  Return nullptr if context is nullptr
+	static DXRenderContext* CreateRenderContext(ID3D11DeviceContext *context);
+
+	// Destructor
+	~DXRenderContext();
+
+	// CGDRenderContext interface
+	void setInputLayout(void *layout);
+	void setVertexBuffer(uint32_t slot, void *buffer, uint32_t stride, uint32_t offset);
+	void setIndexBuffer(void *buffer, uint32_t format, uint32_t offset);
+	void setPrimitiveTopology(uint32_t topology);
+
+	void setShader(CGDShaderStage stage, void *shader);
+	void setConstantBuffers(CGDShaderStage stage, uint32_t slot, uint32_t count, void *const *buffers);
+	void setConstantBufferRange(CGDShaderStage stage, uint32_t slot, void *buffer, uint32_t firstConstant, uint32_t numConstants);
+	void setShaderResources(CGDShaderStage stage, uint32_t slot, uint32_t count, void *const *views);
+	void setSamplers(CGDShaderStage stage, uint32_t slot, uint32_t count, void *const *samplers);
+
+	void setRasterizerState(void *state);
+	void setDepthStencilState(void *state, uint32_t stencilRef);
+	void setBlendState(void *state, const float blendFactor[4], uint32_t sampleMask);
+
+	void drawIndexed(uint32_t indexCount, uint32_t startIndex, int32_t baseVertex);
+	void drawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t startIndex, int32_t baseVertex, uint32_t startInstance);
+	void draw(uint32_t vertexCount, uint32_t startVertex);
+};
@@ -0,0 +1,276 @@
+//
+// DXShadowMaps.cpp
+//
+
+#include <stdafx.h>
+#include <DXShadowMaps.h>
+#include <DXPipelineCache.h>
+#include <Effect.h>
+#include <VertexStructures.h>
+
+using namespace std;
+
+
+// Constants of the shadow maps (shadowCBuffer in per_pixel_lighting_ps.hlsl)
+__declspec(align(16)) struct ShadowConstants {
+
+	DirectX::XMFLOAT4X4				cascadeMatrix[CGD_MAX_SHADOW_CASCADES]; // world to cascade clip space
+	DirectX::XMFLOAT4				texelSize[CGD_MAX_SHADOW_CASCADES]; // x = world units per texel (normal offset)
+	UINT							cascadeCount; // 0 = no shadows
+	FLOAT							mapTexel; // 1 / resolution
+	FLOAT							padding[2];
+};
+
+
+
+//
+// Private interface
+//
+
+// Constructor - called internally by the CreateShadowMaps factory method
+DXShadowMaps::DXShadowMaps(CGDCascadedShadows *_shadows) {
+
+	ZeroMemory(mapDSV, sizeof(mapDSV));
+	ZeroMemory(staticDSV, sizeof(staticDSV));
+
+	shadows = _shadows;
+	shadows->retain();
+
+	float resolution = (float)shadows->getDesc().resolution;
+
+	viewport.TopLeftX = 0.0f;
+	viewport.TopLeftY = 0.0f;
+	viewport.Width = resolution;
+	viewport.Height = resolution;
+	viewport.MinDepth = 0.0f;
+	viewport.MaxDepth = 1.0f;
+}
+
+
+bool DXShadowMaps::createMaps(ID3D11Device *device, ID3D11Texture2D **texture, ID3D11DepthStencilView **dsv, ID3D11ShaderResourceView **srv) {
+
+	uint32_t count = shadows->getCascadeCount();
+
+	// Typeless so the slices can be written as D32_FLOAT depth and read as R32_FLOAT
+	D3D11_TEXTURE2D_DESC desc;
+
+	ZeroMemory(&desc, sizeof(D3D11_TEXTURE2D_DESC));
+
+	desc.Width = shadows->getDesc().resolution;
+	desc.Height = shadows->getDesc().resolution;
+	desc.MipLevels = 1;
+	desc.ArraySize = count;
+	desc.Format = DXGI_FORMAT_R32_TYPELESS;
+	desc.SampleDesc.Count = 1;
+	desc.Usage = D3D11_USAGE_DEFAULT;
+	desc.BindFlags = D3D11_BIND_DEPTH_STENCIL | ((srv) ? D3D11_BIND_SHADER_RESOURCE : 0);
+
+	HRESULT hr = device->CreateTexture2D(&desc, nullptr, texture);
+
+	for (uint32_t i = 0; i < count && SUCCEEDED(hr); i++) {
+
+		D3D11_DEPTH_STENCIL_VIEW_DESC dsvDesc;
+
+		ZeroMemory(&dsvDesc, sizeof(D3D11_DEPTH_STENCIL_VIEW_DESC));
+
+		dsvDesc.Format = DXGI_FORMAT_D32_FLOAT;
+		dsvDesc.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2DARRAY;
+		dsvDesc.Texture2DArray.FirstArraySlice = i;
+		dsvDesc.Texture2DArray.ArraySize = 1;
+
+		hr = device->CreateDepthStencilView(*texture, &dsvDesc, &dsv[i]);
+	}
+
+	if (SUCCEEDED(hr) && srv) {
+
+		D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc;
+
+		ZeroMemory(&srvDesc, sizeof(D3D11_SHADER_RESOURCE_VIEW_DESC));
+
+		srvDesc.Format = DXGI_FORMAT_R32_FLOAT;
+		srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2DARRAY;
+		srvDesc.Texture2DArray.MipLevels = 1;
+		srvDesc.Texture2DArray.ArraySize = count;
+
+		hr = device->CreateShaderResourceView(*texture, &srvDesc, srv);
+	}
+
+	return SUCCEEDED(hr);
+}
+
+
+
+//
+// Public interface
+//
+
+// Factory method
+DXShadowMaps* DXShadowMaps::CreateShadowMaps(ID3D11Device *device, DXPipelineCache *pipelineCache, CGDCascadedShadows *shadows) {
+
+	if (!device || !pipelineCache || !shadows)
+		return nullptr;
+
+	DXShadowMaps *maps = new DXShadowMaps(shadows);
+
+	D3D11_BUFFER_DESC cbufferDesc;
+
+	ZeroMemory(&cbufferDesc, sizeof(D3D11_BUFFER_DESC));
+
+	cbufferDesc.ByteWidth = sizeof(ShadowConstants);
+	cbufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+	cbufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	cbufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+
+	bool created = maps->createMaps(device, &maps->mapTexture, maps->mapDSV, &maps->mapSRV) && SUCCEEDED(device->CreateBuffer(&cbufferDesc, nullptr, &maps->constants));
+
+	if (created && shadows->getDesc().cacheStatic)
+		created = maps->createMaps(device, &maps->staticTexture, maps->staticDSV, nullptr);
+
+	if (!created) {
+
+		cout << "Cannot create shadow maps\n";
+
+		maps->release();
+		return nullptr;
+	}
+
+	// Outside the map (border) compares as lit
+	D3D11_SAMPLER_DESC samplerDesc;
+
+	ZeroMemory(&samplerDesc, sizeof(D3D11_SAMPLER_DESC));
+
+	samplerDesc.Filter = D3D11_FILTER_COMPARISON_MIN_MAG_LINEAR_MIP_POINT;
+	samplerDesc.AddressU = D3D11_TEXTURE_ADDRESS_BORDER;
+	samplerDesc.AddressV = D3D11_TEXTURE_ADDRESS_BORDER;
+	samplerDesc.AddressW = D3D11_TEXTURE_ADDRESS_BORDER;
+	samplerDesc.ComparisonFunc = D3D11_COMPARISON_LESS_EQUAL;
+	samplerDesc.BorderColor[0] = 1.0f;
+	samplerDesc.BorderColor[1] = 1.0f;
+	samplerDesc.BorderColor[2] = 1.0f;
+	samplerDesc.BorderColor[3] = 1.0f;
+
+	maps->sampler = pipelineCache->getSamplerState(samplerDesc);
+
+	// Caster effect - the default states with depth bias (constant and slope scaled) against acne and no depth clipping (pancaking)
+	maps->casterEffect = new Effect(pipelineCache, "Shaders\\cso\\shadow_caster_vs.cso", nullptr, extVertexDesc, ARRAYSIZE(extVertexDesc));
+
+	D3D11_RASTERIZER_DESC RSdesc;
+
+	ZeroMemory(&RSdesc, sizeof(D3D11_RASTERIZER_DESC));
+
+	RSdesc.FillMode = D3D11_FILL_SOLID;
+	RSdesc.CullMode = D3D11_CULL_NONE;
+	RSdesc.FrontCounterClockwise = TRUE;
+	RSdesc.DepthBias = 100;
+	RSdesc.SlopeScaledDepthBias = 2.0f;
+	RSdesc.DepthBiasClamp = 0.0f;
+	RSdesc.DepthClipEnable = FALSE;
+
+	ID3D11RasterizerState *rasterizerState = pipelineCache->getRasterizerState(RSdesc);
+
+	if (rasterizerState) {
+
+		maps->casterEffect->getRasterizerState()->Release();
+		maps->casterEffect->setRasterizerState(rasterizerState);
+	}
+
+	return maps;
+}
+
+
+// Destructor
+DXShadowMaps::~DXShadowMaps() {
+
+	ID3D11DeviceChild *objects[] = { mapTexture, mapSRV, staticTexture, sampler, constants };
+
+	for (auto object : objects) {
+
+		if (object)
+			object->Release();
+	}
+
+	for (uint32_t i = 0; i < CGD_MAX_SHADOW_CASCADES; i++) {
+
+		if (mapDSV[i])
+			mapDSV[i]->Release();
+
+		if (staticDSV[i])
+			staticDSV[i]->Release();
+	}
+
+	if (casterEffect)
+		delete(casterEffect);
+
+	shadows->release();
+}
+
+
+void DXShadowMaps::beginCascade(ID3D11DeviceContext *context, uint32_t i, DXShadowLayer layer) {
+
+	// The maps cannot be read while they are drawn
+	ID3D11ShaderResourceView *nullSRV = nullptr;
+
+	context->PSSetShaderResources(DX_SHADOW_SHADER_RESOURCE_SLOT, 1, &nullSRV);
+	context->RSSetViewports(1, &viewport);
+
+	if (layer == DXShadowLayer::STATIC && staticTexture) {
+
+		context->ClearDepthStencilView(staticDSV[i], D3D11_CLEAR_DEPTH, 1.0f, 0);
+		context->OMSetRenderTargets(0, nullptr, staticDSV[i]);
+		return;
+	}
+
+	if (layer == DXShadowLayer::DYNAMIC && staticTexture) {
+
+		UINT subresource = D3D11CalcSubresource(0, i, 1);
+
+		context->OMSetRenderTargets(0, nullptr, nullptr);
+		context->CopySubresourceRegion(mapTexture, subresource, 0, 0, 0, staticTexture, subresource, nullptr);
+
+	} else {
+
+		context->ClearDepthStencilView(mapDSV[i], D3D11_CLEAR_DEPTH, 1.0f, 0);
+	}
+
+	context->OMSetRenderTargets(0, nullptr, mapDSV[i]);
+}
+
+
+void DXShadowMaps::bind(ID3D11DeviceContext *context, bool enabled) {
+
+	D3D11_MAPPED_SUBRESOURCE res;
+
+	if (!SUCCEEDED(context->Map(constants, 0, D3D11_MAP_WRITE_DISCARD, 0, &res)))
+		return;
+
+	ShadowConstants *c = (ShadowConstants*)res.pData;
+
+	for (uint32_t i = 0; i < shadows->getCascadeCount(); i++) {
+
+		const CGDShadowCascade& cascade = shadows->getCascade(i);
+
+		memcpy(&c->cascadeMatrix[i], cascade.viewProj, sizeof(DirectX::XMFLOAT4X4));
+		c->texelSize[i] = DirectX::XMFLOAT4(cascade.texelSize, 0.0f, 0.0f, 0.0f);
+	}
+
+	c->cascadeCount = (enabled) ? shadows->getCascadeCount() : 0;
+	c->mapTexel = 1.0f / (float)shadows->getDesc().resolution;
+
+	context->Unmap(constants, 0);
+
+	context->PSSetConstantBuffers(DX_SHADOW_CONSTANT_BUFFER_SLOT, 1, &constants);
+	context->PSSetShaderResources(DX_SHADOW_SHADER_RESOURCE_SLOT, 1, &mapSRV);
+	context->PSSetSamplers(DX_SHADOW_SAMPLER_SLOT, 1, &sampler);
+}
+
+
+CGDCascadedShadows* DXShadowMaps::getShadows() const {
+
+	return shadows;
+}
+
+
+Effect* DXShadowMaps::getCasterEffect() const {
+
+	return casterEffect;
+}
@@ -0,0 +1,81 @@
+//
+// DXShadowMaps.h
+//
+
+// D3D11 shadow maps of a CGDCascadedShadows for the sun.  The cascades are the slices of one D32 texture array (a DSV per slice and one SRV of the array) so the pixel shaders select and sample a cascade with a single Texture2DArray and comparison sampler (see sunShadow in per_pixel_lighting_ps.hlsl).  Casters are drawn with the caster effect - shadow_caster_vs.hlsl with no pixel shader and a rasterizer state with slope scaled depth bias and depth clipping off, so casters between the light and a cascade's near plane are flattened onto it (pancaking) rather than clipped.
+//
+// With cacheStatic the static casters of each cascade are drawn into a second texture array that is only redrawn when the cascade is refitted (staticDirty).  The dynamic layer of a cascade starts as a copy of its static slice (CopySubresourceRegion on the GPU) and the dynamic casters are drawn over it.
+//
+// bind sets the cascade constants (b2), the shadow maps (t11) and the comparison sampler (s1) on a context before a lit pass is drawn.
+
+#pragma once
+
+#include <d3d11_2.h>
+#include <GUObject.h>
+#include <CGDCascadedShadows.h>
+#include <cstdint>
+
+class DXPipelineCache;
+class Effect;
+
+
+// Shader slots of the shadow resources (see per_pixel_lighting_ps.hlsl)
+#define DX_SHADOW_CONSTANT_BUFFER_SLOT		2
+#define DX_SHADOW_SHADER_RESOURCE_SLOT		11
+#define DX_SHADOW_SAMPLER_SLOT				1
+
+
+// Casters a cascade is prepared for - all of them (uncached), the static casters into the cached layer or the dynamic casters over a copy of the cached layer
+enum class DXShadowLayer : uint8_t { ALL = 0, STATIC, DYNAMIC };
+
+
+class DXShadowMaps : public GUObject {
+
+	CGDCascadedShadows				*shadows = nullptr;
+
+	// Shadow maps (one slice per cascade) and the static layer (cacheStatic only)
+	ID3D11Texture2D					*mapTexture = nullptr;
+	ID3D11ShaderResourceView		*mapSRV = nullptr;
+	ID3D11DepthStencilView			*mapDSV[CGD_MAX_SHADOW_CASCADES];
+	ID3D11Texture2D					*staticTexture = nullptr;
+	ID3D11DepthStencilView			*staticDSV[CGD_MAX_SHADOW_CASCADES];
+
+	ID3D11SamplerState				*sampler = nullptr; // linear comparison, border 1 (lit outside the map)
+	ID3D11Buffer					*constants = nullptr;
+	Effect							*casterEffect = nullptr;
+	D3D11_VIEWPORT					viewport;
+
+
+	//
+	// Private interface
+	//
+
+	// Constructor - called internally by the CreateShadowMaps factory method
+	DXShadowMaps(CGDCascadedShadows *shadows);
+
+	// Create a D32 texture array of one slice per cascade with a DSV per slice (and an SRV if srv is not nullptr).  Return false if it cannot be created
+	bool createMaps(ID3D11Device *device, ID3D11Texture2D **texture, ID3D11DepthStencilView **dsv, ID3D11ShaderResourceView **srv);
+
+
+public:
+
+	//
+	// Public interface
+	//
+
+	// Factory method.  shadows is retained.  Return nullptr if the shadow maps cannot be created
+	static DXShadowMaps* CreateShadowMaps(ID3D11Device *device, DXPipelineCache *pipelineCache, CGDCascadedShadows *shadows);
+
+	// Destructor
+	~DXShadowMaps();
+
+	// Prepare cascade i of layer for drawing casters on context - bind its depth stencil view (no render target) and viewport, clearing it (ALL and STATIC) or copying the static layer into it (DYNAMIC).  The caster's world matrix times the cascade's view projection goes in the caster's constant buffer
+	void beginCascade(ID3D11DeviceContext *context, uint32_t i, DXShadowLayer layer);
+
+	// Bind the constants, shadow maps and sampler to the pixel shader stage of context.  enabled = false binds constants with no cascades (unshadowed)
+	void bind(ID3D11DeviceContext *context, bool enabled);
+
+	// Query methods
+	CGDCascadedShadows* getShadows() const;
+	Effect* getCasterEffect() const; // depth only effect for drawing casters (see Model::submit)
+};
@@ -108,8 +108,7 @@ HRESULT DXSystem::setupDeviceDependentResources(HWND hwnd) {
 			defaultAdapter,
 			D3D_DRIVER_TYPE_UNKNOWN, // Specify TYPE_UNKNOWN since we're specifying our own adapter 'defaultAdapter'
 			NULL,
-			D3D11_CREATE_DEVICE_DEBUG |
-			D3D11_CREATE_DEVICE_SINGLETHREADED |
+			D3D11_CREATE_DEVICE_DEBUG | // Not SINGLETHREADED - scene passes are recorded on deferred contexts from worker threads
 			D3D11_CREATE_DEVICE_BGRA_SUPPORT, // Needed for D2D interop
 			dxFeatureLevels,
 			2,
@@ -0,0 +1,127 @@
+//
+// DXTextureStreamingBackend.cpp
+//
+
+#include <stdafx.h>
+#include <DXTextureStreamingBackend.h>
+#include <Texture.h>
+
+using namespace std;
+
+
+
+//
+// Private interface
+//
+
+// Constructor - called internally by the CreateTextureStreamingBackend factory method
+DXTextureStreamingBackend::DXTextureStreamingBackend(ID3D11Device *_device, ID3D11DeviceContext *_context) {
+
+	device = _device;
+	device->AddRef();
+
+	context = _context;
+	context->AddRef();
+}
+
+
+
+//
+// Public interface
+//
+
+DXTextureStreamingBackend* DXTextureStreamingBackend::CreateTextureStreamingBackend(ID3D11Device *device, ID3D11DeviceContext *context) {
+
+	if (!device || !context)
+		return nullptr;
+
+	return new DXTextureStreamingBackend(device, context);
+}
+
+
+DXTextureStreamingBackend::~DXTextureStreamingBackend() {
+
+	context->Release();
+	device->Release();
+}
+
+
+bool DXTextureStreamingBackend::loadMips(void *texture, uint32_t firstMip, uint32_t lastMip, vector<uint8_t>& data) {
+
+	Texture *t = static_cast<Texture*>(texture);
+
+	return gu_dds_read_mips(t->streamFile.c_str(), t->ddsInfo, firstMip, lastMip, data);
+}
+
+
+bool DXTextureStreamingBackend::commitMips(void *texture, uint32_t residentMip, uint32_t previousMip, const vector<uint8_t>& data) {
+
+	Texture *t = static_cast<Texture*>(texture);
+	const gu_dds_info& info = t->ddsInfo;
+
+	// Mips [residentMip, loadedEnd) come from data and the rest are copied from the old texture
+	uint32_t loadedEnd = max(residentMip, previousMip);
+
+	if (residentMip < previousMip && data.size() != gu_dds_mip_offset(info, previousMip) - gu_dds_mip_offset(info, residentMip))
+		return false;
+
+	if (loadedEnd < info.mipCount && !t->texture)
+		return false;
+
+	D3D11_TEXTURE2D_DESC desc;
+
+	ZeroMemory(&desc, sizeof(D3D11_TEXTURE2D_DESC));
+
+	desc.Width = max(info.width >> residentMip, 1u);
+	desc.Height = max(info.height >> residentMip, 1u);
+	desc.MipLevels = info.mipCount - residentMip;
+	desc.ArraySize = 1;
+	desc.Format = (DXGI_FORMAT)info.format;
+	desc.SampleDesc.Count = 1;
+	desc.SampleDesc.Quality = 0;
+	desc.Usage = D3D11_USAGE_DEFAULT;
+	desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+	ID3D11Texture2D *newTexture = nullptr;
+	ID3D11ShaderResourceView *newSRV = nullptr;
+
+	HRESULT hr = device->CreateTexture2D(&desc, nullptr, &newTexture);
+
+	if (SUCCEEDED(hr))
+		hr = device->CreateShaderResourceView(newTexture, nullptr, &newSRV);
+
+	if (!SUCCEEDED(hr)) {
+
+		cout << "Cannot create streamed texture " << t->streamFile << " (mip " << residentMip << ")\n";
+
+		if (newTexture)
+			newTexture->Release();
+
+		return false;
+	}
+
+	size_t offset = 0;
+
+	for (uint32_t i = residentMip; i < loadedEnd; i++) {
+
+		uint32_t rowPitch, rowCount;
+		size_t size = gu_dds_mip_size(info, i, &rowPitch, &rowCount);
+
+		context->UpdateSubresource(newTexture, i - residentMip, nullptr, data.data() + offset, rowPitch, rowPitch * rowCount);
+		offset += size;
+	}
+
+	for (uint32_t i = loadedEnd; i < info.mipCount; i++)
+		context->CopySubresourceRegion(newTexture, i - residentMip, 0, 0, 0, t->texture, i - previousMip, nullptr);
+
+	if (t->SRV)
+		t->SRV->Release();
+
+	if (t->texture)
+		t->texture->Release();
+
+	t->texture = newTexture;
+	t->SRV = newSRV;
+
+	return true;
+}
@@ -0,0 +1,42 @@
+//
+// DXTextureStreamingBackend.h
+//
+
+// D3D11 implementation of CGDTextureStreamingBackend for Texture objects streamed from DDS files (see Texture).  loadMips reads the mip range from the texture's DDS file.  D3D11 textures cannot change their mip count so commitMips creates a texture holding the new mip range, uploads the loaded mips with UpdateSubresource, copies the mips it keeps from the old texture on the GPU and replaces the texture's SRV.  Views of the old texture stay valid (they keep it alive) until they are rebound
+
+#pragma once
+
+#include <d3d11_2.h>
+#include <CGDTextureStreamer.h>
+
+
+class DXTextureStreamingBackend : public CGDTextureStreamingBackend {
+
+	ID3D11Device					*device = nullptr;
+	ID3D11DeviceContext				*context = nullptr;
+
+
+	//
+	// Private interface
+	//
+
+	// Constructor - called internally by the CreateTextureStreamingBackend factory method
+	DXTextureStreamingBackend(ID3D11Device *device, ID3D11DeviceContext *context);
+
+
+public:
+
+	//
+	// Public interface
+	//
+
+	// Factory method.  Mips are committed on context (the immediate context).  Return nullptr if device or context is nullptr
+	static DXTextureStreamingBackend* CreateTextureStreamingBackend(ID3D11Device *device, ID3D11DeviceContext *context);
+
+	// Destructor
+	~DXTextureStreamingBackend();
+
+	// CGDTextureStreamingBackend interface (texture is a Texture*)
+	bool loadMips(void *texture, uint32_t firstMip, uint32_t lastMip, std::vector<uint8_t>& data);
+	bool commitMips(void *texture, uint32_t residentMip, uint32_t previousMip, const std::vector<uint8_t>& data);
+};
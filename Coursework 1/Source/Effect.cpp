@@ -1,5 +1,7 @@
 #include "stdafx.h"
 #include "Effect.h"
+#include <DXPipelineCache.h>
+#include <CGDRenderQueue.h>
 //#include <string.h>
 //
 //#include <Windows.h>
@@ -16,7 +18,20 @@ void Effect::bindPipeline(ID3D11DeviceContext *context){
 	context->GSSetShader(GeometryShader, 0, 0);
 }
 
-void Effect::initDefaultStates(ID3D11Device *device ){
+void Effect::preparePacket(CGDDrawPacket *packet){
+	packet->vertexShader = VertexShader;
+	packet->pixelShader = PixelShader;
+	packet->geometryShader = GeometryShader;
+	packet->inputLayout = VSInputLayout;
+	packet->rasterizerState = RasterizerState;
+	packet->depthStencilState = DepthStencilState;
+	packet->blendState = BlendState;
+	for (int i = 0; i < 4; i++)
+		packet->blendFactor[i] = blendFactor[i];
+	packet->sampleMask = sampleMask;
+}
+
+void Effect::initDefaultStates(DXPipelineCache *pipelineCache){
 	
 	D3D11_RASTERIZER_DESC			RSdesc;
 	ZeroMemory(&RSdesc, sizeof(D3D11_RASTERIZER_DESC));
@@ -31,9 +46,9 @@ void Effect::initDefaultStates(ID3D11Device *device ){
 	RSdesc.ScissorEnable = FALSE;
 	RSdesc.MultisampleEnable = TRUE;
 	RSdesc.AntialiasedLineEnable = FALSE;
-	HRESULT hr = device->CreateRasterizerState(&RSdesc, &RasterizerState);
+	RasterizerState = pipelineCache->getRasterizerState(RSdesc);
 
-	if (!SUCCEEDED(hr))
+	if (!RasterizerState)
 		throw std::exception("Cannot create Rasterise state interface");
 
 	// Output - Merger Stage
@@ -57,8 +72,8 @@ void Effect::initDefaultStates(ID3D11Device *device ){
 	dsDesc.BackFace.StencilPassOp = D3D11_STENCIL_OP_KEEP;
 	dsDesc.BackFace.StencilFailOp = D3D11_STENCIL_OP_KEEP;
 	// Initialise depth-stencil state object based on the given descriptor
-	hr = device->CreateDepthStencilState(&dsDesc, &DepthStencilState);
-	if (!SUCCEEDED(hr))
+	DepthStencilState = pipelineCache->getDepthStencilState(dsDesc);
+	if (!DepthStencilState)
 		throw std::exception("Cannot create DepthStencil state interface");
 
 	// Initialise default blend state object (Alpha Blending On)
@@ -109,55 +124,78 @@ void Effect::initDefaultStates(ID3D11Device *device ){
 
 
 	// Create blendState
-	hr = device->CreateBlendState(&blendDesc, &BlendState);
-	if (!SUCCEEDED(hr))
+	BlendState = pipelineCache->getBlendState(blendDesc);
+	if (!BlendState)
 		throw std::exception("Cannot create Blend state interface");
 
 	blendFactor[0] = blendFactor[1] = blendFactor[2] = blendFactor[3] = 1.0f;
 	sampleMask = 0xFFFFFFFF; // Bitwise flags to determine which samples to process in an MSAA context
 }
-Effect::Effect(ID3D11Device *device, ID3D11VertexShader	*_VertexShader, ID3D11PixelShader *_PixelShader, ID3D11InputLayout *_VSInputLayout)
+Effect::Effect(DXPipelineCache *pipelineCache, ID3D11VertexShader	*_VertexShader, ID3D11PixelShader *_PixelShader, ID3D11InputLayout *_VSInputLayout)
 {
 	VertexShader = _VertexShader;
 	PixelShader = _PixelShader;
 	GeometryShader = NULL;
 	VSInputLayout = _VSInputLayout;
-	initDefaultStates(device);
+	initDefaultStates(pipelineCache);
 	VertexShader->AddRef();
 	PixelShader->AddRef();
 	VSInputLayout->AddRef();
 
 }
 
-Effect::Effect(ID3D11Device *device, ID3D11VertexShader	*_VertexShader, ID3D11PixelShader *_PixelShader, ID3D11GeometryShader *_GeometryShader, ID3D11InputLayout *_VSInputLayout)
+Effect::Effect(DXPipelineCache *pipelineCache, ID3D11VertexShader	*_VertexShader, ID3D11PixelShader *_PixelShader, ID3D11GeometryShader *_GeometryShader, ID3D11InputLayout *_VSInputLayout)
 {
 	VertexShader = _VertexShader;
 	PixelShader = _PixelShader;
 	GeometryShader = _GeometryShader;
 	VSInputLayout = _VSInputLayout;
-	initDefaultStates(device);
+	initDefaultStates(pipelineCache);
 	VertexShader->AddRef();
 	PixelShader->AddRef();
+	if (GeometryShader)
+		GeometryShader->AddRef();
 	VSInputLayout->AddRef();
 
 }
-Effect::Effect(ID3D11Device *device, const char *vertexShaderPath, const char * pixelShaderPath, const D3D11_INPUT_ELEMENT_DESC vertexDesc[], UINT numVertexElements)
+Effect::Effect(DXPipelineCache *pipelineCache, const char *vertexShaderPath, const char * pixelShaderPath, const D3D11_INPUT_ELEMENT_DESC vertexDesc[], UINT numVertexElements)
 {
-	char *tmpShaderBytecode = nullptr;
-	uint32_t tmpVSSizeBytes = CreateVertexShader(device, vertexShaderPath, &tmpShaderBytecode, &VertexShader);
-	device->CreateInputLayout(vertexDesc, numVertexElements, tmpShaderBytecode, tmpVSSizeBytes, &VSInputLayout);
-	CreatePixelShader(device, pixelShaderPath, &tmpShaderBytecode, &PixelShader);
-	initDefaultStates(device);
+	PROFILE_SCOPE("Effect::Effect");
+	GU_MEMORY_TAG_SCOPE(gu_mem_shader);
+	const CGDShaderBytecode *VSBytecode = nullptr;
+	VertexShader = pipelineCache->getVertexShader(vertexShaderPath, &VSBytecode);
+	if (!VertexShader)
+		throw std::exception("Cannot create VertexShader interface");
+	VSInputLayout = pipelineCache->getInputLayout(vertexDesc, numVertexElements, VSBytecode);
+	if (!VSInputLayout)
+		throw std::exception("Cannot create InputLayout interface");
+	// No pixel shader for depth only effects
+	if (pixelShaderPath) {
+		PixelShader = pipelineCache->getPixelShader(pixelShaderPath);
+		if (!PixelShader)
+			throw std::exception("Cannot create PixelShader interface");
+	}
+	initDefaultStates(pipelineCache);
 }
 
-Effect::Effect(ID3D11Device *device, const char *vertexShaderPath, const char * pixelShaderPath, const char * geometryShaderPath, const D3D11_INPUT_ELEMENT_DESC vertexDesc[], UINT numVertexElements)
+Effect::Effect(DXPipelineCache *pipelineCache, const char *vertexShaderPath, const char * pixelShaderPath, const char * geometryShaderPath, const D3D11_INPUT_ELEMENT_DESC vertexDesc[], UINT numVertexElements)
 {
-	char *tmpShaderBytecode = nullptr;
-	uint32_t tmpVSSizeBytes = CreateVertexShader(device, vertexShaderPath, &tmpShaderBytecode, &VertexShader);
-	device->CreateInputLayout(vertexDesc, numVertexElements, tmpShaderBytecode, tmpVSSizeBytes, &VSInputLayout);
-	CreatePixelShader(device, pixelShaderPath, &tmpShaderBytecode, &PixelShader);
-	CreateGeometryShader(device, geometryShaderPath, &tmpShaderBytecode, &GeometryShader);
-	initDefaultStates(device);
+	PROFILE_SCOPE("Effect::Effect");
+	GU_MEMORY_TAG_SCOPE(gu_mem_shader);
+	const CGDShaderBytecode *VSBytecode = nullptr;
+	VertexShader = pipelineCache->getVertexShader(vertexShaderPath, &VSBytecode);
+	if (!VertexShader)
+		throw std::exception("Cannot create VertexShader interface");
+	VSInputLayout = pipelineCache->getInputLayout(vertexDesc, numVertexElements, VSBytecode);
+	if (!VSInputLayout)
+		throw std::exception("Cannot create InputLayout interface");
+	PixelShader = pipelineCache->getPixelShader(pixelShaderPath);
+	if (!PixelShader)
+		throw std::exception("Cannot create PixelShader interface");
+	GeometryShader = pipelineCache->getGeometryShader(geometryShaderPath);
+	if (!GeometryShader)
+		throw std::exception("Cannot create GeometryShader interface");
+	initDefaultStates(pipelineCache);
 }
 
 Effect::~Effect()
@@ -172,122 +210,11 @@ Effect::~Effect()
 		VertexShader->Release();
 	if (PixelShader)
 		PixelShader->Release();
+	if (GeometryShader)
+		GeometryShader->Release();
 	if (VSInputLayout)
 		VSInputLayout->Release();
 
 
 
 }
-HRESULT Effect::CreateGeometryShader(ID3D11Device *device, const char *filename, char **GSBytecode, ID3D11GeometryShader **geometryShader){
-
-	char *GSBytecodeLocal;
-
-	//Load the compiled shader byte code.
-	uint32_t shaderBytes = LoadShader(filename, &GSBytecodeLocal);
-
-	GSBytecode = &GSBytecodeLocal;
-	cout << "Done: GShader memory bytes = " << shaderBytes << endl;
-	// Create shader objects
-	HRESULT hr = device->CreateGeometryShader(GSBytecodeLocal, shaderBytes, NULL, geometryShader);
-
-	if (!SUCCEEDED(hr))
-		throw std::exception("Cannot create GeometryShader interface");
-	return hr;
-}
-HRESULT Effect::CreatePixelShader(ID3D11Device *device, const char *filename, char **PSBytecode, ID3D11PixelShader **pixelShader){
-
-	char *PSBytecodeLocal;
-
-	//Load the compiled shader byte code.
-	uint32_t shaderBytes = LoadShader(filename, &PSBytecodeLocal);
-
-	PSBytecode = &PSBytecodeLocal;
-	cout << "Done: PShader memory bytes = " << shaderBytes << endl;
-	// Create shader objects
-	HRESULT hr = device->CreatePixelShader(PSBytecodeLocal, shaderBytes, NULL, pixelShader);
-
-	if (!SUCCEEDED(hr))
-		throw std::exception("Cannot create PixelShader interface");
-	return hr;
-}
-uint32_t Effect::CreateVertexShader(ID3D11Device *device, const char *filename, char **VSBytecode, ID3D11VertexShader **vertexShader){
-
-	char *VSBytecodeLocal;
-
-	//Load the compiled shader byte code.
-	uint32_t shaderBytes = LoadShader(filename, &VSBytecodeLocal);
-	//VSBytecode =(char*) malloc(shaderBytes);
-	cout << "Done: VShader memory bytes = " << shaderBytes << endl;
-	//for (int i = 0; i < shaderBytes; i++)
-	//	*VSBytecode[i] = 'a';
-	*VSBytecode = VSBytecodeLocal;
-	cout << "Done: VShader writting = " << shaderBytes << endl;
-	HRESULT hr = device->CreateVertexShader(VSBytecodeLocal, shaderBytes, NULL, vertexShader);
-	cout << "Done: VShader return = " << hr << endl;
-	if (!SUCCEEDED(hr))
-		throw std::exception("Cannot create VertexShader interface");
-	return shaderBytes;
-}
-uint32_t Effect::LoadShader(const char *filename, char **bytecode)
-{
-
-	ifstream	*fp = nullptr;
-	//char		*memBlock = nullptr;
-	//bytecode = nullptr;
-	uint32_t shaderBytes = -1;
-	cout << "loading shader" << endl;
-
-	try
-	{
-		// Validate parameters
-		if (!filename)
-			throw exception("loadCSO: Invalid parameters");
-
-		// Open file
-		fp = new ifstream(filename, ios::in | ios::binary);
-
-		if (!fp->is_open())
-			throw exception("loadCSO: Cannot open file");
-
-		// Get file size
-		fp->seekg(0, ios::end);
-		shaderBytes = (uint32_t)fp->tellg();
-
-		// Create blob object to store bytecode (exceptions propagate up if any occur)
-		//memBlock = new DXBlob(size);
-		cout << "allocating shader memory bytes = " << shaderBytes << endl;
-		*bytecode = (char*)malloc(shaderBytes);
-		// Read binary data into blob object
-		fp->seekg(0, ios::beg);
-		fp->read(*bytecode, shaderBytes);
-
-
-		// Close file and release local resources
-		fp->close();
-		delete fp;
-
-		// Return DXBlob - ownership implicity passed to caller
-		//*bytecode = memBlock;
-		cout << "Done: shader memory bytes = " << shaderBytes << endl;
-	}
-	catch (exception& e)
-	{
-		cout << e.what() << endl;
-
-		// Cleanup local resources
-		if (fp) {
-
-			if (fp->is_open())
-				fp->close();
-
-			delete fp;
-		}
-
-		if (bytecode)
-			delete bytecode;
-
-		// Re-throw exception
-		throw;
-	}
-	return shaderBytes;
-}
\ No newline at end of file
@@ -1,4 +1,8 @@
 #pragma once
+
+class DXPipelineCache;
+struct CGDDrawPacket;
+
 class Effect
 {
 	ID3D11RasterizerState					*RasterizerState = nullptr;
@@ -13,13 +17,14 @@ class Effect
 	FLOAT			blendFactor[4];
 	UINT			sampleMask;
 
-	uint32_t LoadShader(const char *filename, char **bytecode);
 public:
-	Effect(ID3D11Device *device, ID3D11VertexShader	*_VertexShader, ID3D11PixelShader *_PixelShader, ID3D11InputLayout *_VSInputLayout);
-	Effect(ID3D11Device *device, ID3D11VertexShader	*_VertexShader, ID3D11PixelShader *_PixelShader, ID3D11GeometryShader *_GeometryShader, ID3D11InputLayout *_VSInputLayout);
+	// Shaders, input layouts and states are obtained from pipelineCache so effects built from the same shader files and state descriptors share a single instance of each
+	Effect(DXPipelineCache *pipelineCache, ID3D11VertexShader	*_VertexShader, ID3D11PixelShader *_PixelShader, ID3D11InputLayout *_VSInputLayout);
+	Effect(DXPipelineCache *pipelineCache, ID3D11VertexShader	*_VertexShader, ID3D11PixelShader *_PixelShader, ID3D11GeometryShader *_GeometryShader, ID3D11InputLayout *_VSInputLayout);
 
-	Effect(ID3D11Device *device, const char *vertexShaderPath, const char *pixelShaderPath, const D3D11_INPUT_ELEMENT_DESC vertexDesc[], UINT numVertexElements);
-	Effect(ID3D11Device *device, const char *vertexShaderPath, const char *pixelShaderPath, const char *geometryShaderPath, const D3D11_INPUT_ELEMENT_DESC vertexDesc[], UINT numVertexElements);
+	// pixelShaderPath may be nullptr for a depth only effect (eg. shadow casters)
+	Effect(DXPipelineCache *pipelineCache, const char *vertexShaderPath, const char *pixelShaderPath, const D3D11_INPUT_ELEMENT_DESC vertexDesc[], UINT numVertexElements);
+	Effect(DXPipelineCache *pipelineCache, const char *vertexShaderPath, const char *pixelShaderPath, const char *geometryShaderPath, const D3D11_INPUT_ELEMENT_DESC vertexDesc[], UINT numVertexElements);
 
 	ID3D11InputLayout *getVSInputLayout(){ return VSInputLayout; };
 	ID3D11VertexShader *getVertexShader(){ return VertexShader; };
@@ -36,12 +41,11 @@ public:
 	void setRasterizerState(ID3D11RasterizerState	*_RasterizerState){ RasterizerState = _RasterizerState; };
 	void setDepthStencilState(ID3D11DepthStencilState	*_DepthStencilState){ DepthStencilState = _DepthStencilState; };
 	void setBlendState(ID3D11BlendState	*_BlendState){ BlendState = _BlendState; };
-	void initDefaultStates(ID3D11Device *device);
+	void initDefaultStates(DXPipelineCache *pipelineCache);
 	void bindPipeline(ID3D11DeviceContext *context);
+	// Fill in the pipeline fields (shaders, input layout and states) of a render queue draw packet
+	void preparePacket(CGDDrawPacket *packet);
 
-	uint32_t Effect::CreateVertexShader(ID3D11Device *device, const char *filename, char **VSBytecode, ID3D11VertexShader **vertexShader);
-	HRESULT Effect::CreatePixelShader(ID3D11Device *device, const char *filename, char **PSBytecode, ID3D11PixelShader **pixelShader);
-	HRESULT Effect::CreateGeometryShader(ID3D11Device *device, const char *filename, char **GSBytecode, ID3D11GeometryShader **geometryShader);
 	~Effect();
 };
 
@@ -24,6 +24,10 @@ XMMATRIX FirstPersonCamera::getViewMatrix()
 	lookAt = pos + dir;
 	return 		DirectX::XMMatrixLookAtLH(pos, lookAt, up);
 }
+DirectX::XMVECTOR FirstPersonCamera::getDir()
+{
+	return dir;
+}
 void FirstPersonCamera::move(float d)
 {
 	pos += (dir*d);
@@ -23,6 +23,9 @@ public:
 	void turn(float d);
 	void elevate(float d);
 
+	// View direction (the camera looks at pos + dir)
+	DirectX::XMVECTOR getDir();
+
 	//overrides
 	DirectX::XMMATRIX FirstPersonCamera::getViewMatrix();
 
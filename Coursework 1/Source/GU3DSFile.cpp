@@ -0,0 +1,224 @@
+//
+// GU3DSFile.cpp
+//
+
+#include <stdafx.h>
+#include <GU3DSFile.h>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+
+using namespace std;
+
+
+// Chunk ids - the main and editor chunks hold objects, an object (named) holds a triangle mesh and the mesh holds its vertex, face and texture coordinate lists
+static const uint32_t			mainChunk = 0x4D4D;
+static const uint32_t			editorChunk = 0x3D3D;
+static const uint32_t			objectChunk = 0x4000;
+static const uint32_t			triMeshChunk = 0x4100;
+static const uint32_t			vertexListChunk = 0x4110;
+static const uint32_t			faceListChunk = 0x4120;
+static const uint32_t			texCoordListChunk = 0x4140;
+
+static const size_t				chunkHeaderSize = 6;
+
+
+static inline uint32_t readUInt16(const uint8_t *p) {
+
+	return (uint32_t)p[0] | ((uint32_t)p[1] << 8);
+}
+
+
+static inline uint32_t readUInt32(const uint8_t *p) {
+
+	return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+
+static inline float readFloat(const uint8_t *p) {
+
+	uint32_t bits = readUInt32(p);
+	float f;
+
+	memcpy(&f, &bits, sizeof(f));
+
+	return f;
+}
+
+
+// Append the vertices, faces and texture coordinates of the triangle mesh chunk in [p, end) to mesh
+static bool decodeTriMesh(const uint8_t *p, const uint8_t *end, gu_3ds_mesh& mesh) {
+
+	uint32_t base = (uint32_t)mesh.vertexCount(), numVertices = 0;
+	size_t firstIndex = mesh.indices.size();
+	const uint8_t *texCoords = nullptr;
+
+	while (end - p >= (ptrdiff_t)chunkHeaderSize) {
+
+		uint32_t id = readUInt16(p), length = readUInt32(p + 2);
+
+		if (length < chunkHeaderSize || length > (size_t)(end - p))
+			return false;
+
+		const uint8_t *data = p + chunkHeaderSize;
+		size_t dataSize = length - chunkHeaderSize;
+
+		if (id == vertexListChunk && dataSize >= 2) {
+
+			numVertices = readUInt16(data);
+
+			if (numVertices * 12 + 2 > dataSize)
+				return false;
+
+			for (uint32_t i = 0; i < numVertices * 3; i++)
+				mesh.positions.push_back(readFloat(data + 2 + i * 4));
+
+		} else if (id == faceListChunk && dataSize >= 2) {
+
+			// Each face is 3 indices and a flags word.  Material and smoothing group sub-chunks follow the faces and are skipped
+			uint32_t numFaces = readUInt16(data);
+
+			if (numFaces * 8 + 2 > dataSize)
+				return false;
+
+			for (uint32_t i = 0; i < numFaces; i++) {
+
+				const uint8_t *face = data + 2 + i * 8;
+
+				for (int k = 0; k < 3; k++)
+					mesh.indices.push_back(base + readUInt16(face + k * 2));
+			}
+
+		} else if (id == texCoordListChunk && dataSize >= 2) {
+
+			if (readUInt16(data) * 8 + 2 > dataSize)
+				return false;
+
+			texCoords = data;
+		}
+
+		p += length;
+	}
+
+	// Texture coordinates are only used if there is one per vertex
+	bool useTexCoords = texCoords && readUInt16(texCoords) == numVertices;
+
+	for (uint32_t i = 0; i < numVertices * 2; i++)
+		mesh.texCoords.push_back(useTexCoords ? readFloat(texCoords + 2 + i * 4) : 0.0f);
+
+	for (size_t i = firstIndex; i < mesh.indices.size(); i++)
+		if (mesh.indices[i] >= base + numVertices)
+			return false;
+
+	return true;
+}
+
+
+// Walk the chunks in [p, end), descending into the chunks that hold objects and meshes
+static bool decodeChunks(const uint8_t *p, const uint8_t *end, gu_3ds_mesh& mesh) {
+
+	while (end - p >= (ptrdiff_t)chunkHeaderSize) {
+
+		uint32_t id = readUInt16(p), length = readUInt32(p + 2);
+
+		if (length < chunkHeaderSize || length > (size_t)(end - p))
+			return false;
+
+		const uint8_t *data = p + chunkHeaderSize, *next = p + length;
+
+		if (id == editorChunk) {
+
+			if (!decodeChunks(data, next, mesh))
+				return false;
+
+		} else if (id == objectChunk) {
+
+			// Skip the object's name (null terminated)
+			const uint8_t *name = (const uint8_t*)memchr(data, 0, next - data);
+
+			if (!name || !decodeChunks(name + 1, next, mesh))
+				return false;
+
+		} else if (id == triMeshChunk) {
+
+			if (!decodeTriMesh(data, next, mesh))
+				return false;
+		}
+
+		p = next;
+	}
+
+	return true;
+}
+
+
+// Average the (area weighted) face normals around each vertex
+static void computeNormals(gu_3ds_mesh& mesh) {
+
+	mesh.normals.assign(mesh.positions.size(), 0.0f);
+
+	for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+
+		const float *a = &mesh.positions[mesh.indices[i] * 3];
+		const float *b = &mesh.positions[mesh.indices[i + 1] * 3];
+		const float *c = &mesh.positions[mesh.indices[i + 2] * 3];
+		float u[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+		float v[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+		float n[3] = { u[1] * v[2] - u[2] * v[1], u[2] * v[0] - u[0] * v[2], u[0] * v[1] - u[1] * v[0] };
+
+		for (int k = 0; k < 3; k++)
+			for (int j = 0; j < 3; j++)
+				mesh.normals[mesh.indices[i + k] * 3 + j] += n[j];
+	}
+
+	for (size_t i = 0; i < mesh.normals.size(); i += 3) {
+
+		float *n = &mesh.normals[i];
+		float length = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+
+		if (length > 0.0f) {
+
+			n[0] /= length;
+			n[1] /= length;
+			n[2] /= length;
+		}
+	}
+}
+
+
+bool gu_3ds_decode(const uint8_t *data, size_t size, gu_3ds_mesh& mesh) {
+
+	mesh = gu_3ds_mesh();
+
+	if (size < chunkHeaderSize || readUInt16(data) != mainChunk || readUInt32(data + 2) > size || readUInt32(data + 2) < chunkHeaderSize)
+		return false;
+
+	if (!decodeChunks(data + chunkHeaderSize, data + readUInt32(data + 2), mesh) || mesh.indices.empty())
+		return false;
+
+	computeNormals(mesh);
+
+	return true;
+}
+
+
+bool gu_3ds_read(const char *filename, gu_3ds_mesh& mesh) {
+
+	ifstream file(filename, ios::in | ios::binary);
+
+	if (!file.is_open()) {
+
+		cout << "Cannot open 3DS file " << filename << endl;
+		return false;
+	}
+
+	vector<uint8_t> data((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+
+	if (!gu_3ds_decode(data.data(), data.size(), mesh)) {
+
+		cout << filename << " is not a 3DS file or is corrupt\n";
+		return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,30 @@
+//
+// GU3DSFile.h
+//
+
+// Minimal 3D Studio (.3ds) mesh reader for the models used by the scene.  Only the triangle mesh chunks (vertex list, face list and texture coordinates) of each object are read - materials, keyframes, lights and cameras are skipped - so models can be loaded without CGImport (see HeadlessScene).  Vertices are returned as stored in the file and Model's conversion to the left-handed D3D system is left to the caller.
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+
+// The triangle meshes of a 3DS file.  The objects in the file are appended in order so vertices of later objects follow those of earlier ones and indices refer to the combined list
+struct gu_3ds_mesh {
+
+	std::vector<float>		positions;	// x, y, z per vertex
+	std::vector<float>		normals;	// x, y, z per vertex - 3DS files store no normals so the face normals around each vertex are averaged
+	std::vector<float>		texCoords;	// s, t per vertex (0, 0 for objects without texture coordinates)
+	std::vector<uint32_t>	indices;	// 3 per triangle, counter-clockwise
+
+	size_t vertexCount() const { return positions.size() / 3; }
+};
+
+
+// Decode a 3DS file in memory (size bytes) into mesh.  Return false if data is not a 3DS file, is truncated or holds no triangles
+bool gu_3ds_decode(const uint8_t *data, size_t size, gu_3ds_mesh& mesh);
+
+// Read filename into mesh.  Return false (and report why) if the file cannot be read or decoded
+bool gu_3ds_read(const char *filename, gu_3ds_mesh& mesh);
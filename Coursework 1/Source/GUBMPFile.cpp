@@ -0,0 +1,119 @@
+
+//
+// GUBMPFile.cpp
+//
+
+#include <stdafx.h>
+#include <GUBMPFile.h>
+#include <fstream>
+
+using namespace std;
+
+
+static const size_t				fileHeaderSize = 14;
+static const uint32_t			biRGB = 0;
+static const uint32_t			biBitFields = 3;
+
+
+static inline uint32_t readUInt16(const uint8_t *p) {
+
+	return (uint32_t)p[0] | ((uint32_t)p[1] << 8);
+}
+
+
+static inline uint32_t readUInt32(const uint8_t *p) {
+
+	return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+
+bool gu_bmp_decode(const uint8_t *data, size_t size, uint32_t& width, uint32_t& height, vector<uint8_t>& rgba) {
+
+	if (size < fileHeaderSize + 40 || data[0] != 'B' || data[1] != 'M')
+		return false;
+
+	const uint8_t *info = data + fileHeaderSize;
+	uint32_t infoSize = readUInt32(info);
+	int32_t w = (int32_t)readUInt32(info + 4);
+	int32_t h = (int32_t)readUInt32(info + 8);
+	uint32_t bitCount = readUInt16(info + 14);
+	uint32_t compression = readUInt32(info + 16);
+	uint32_t paletteSize = readUInt32(info + 32);
+	size_t pixelOffset = readUInt32(data + 10);
+
+	bool topDown = h < 0;
+
+	width = (uint32_t)w;
+	height = (uint32_t)((topDown) ? -h : h);
+
+	// 32-bit bitmaps written with BI_BITFIELDS use the standard BGRA masks
+	bool supported = (compression == biRGB && (bitCount == 8 || bitCount == 24 || bitCount == 32)) || (compression == biBitFields && bitCount == 32);
+
+	size_t rowBytes = (((size_t)width * bitCount + 31) / 32) * 4;
+
+	if (!supported || w <= 0 || height == 0 || pixelOffset + rowBytes * height > size)
+		return false;
+
+	if (bitCount == 8 && paletteSize == 0)
+		paletteSize = 256;
+
+	const uint8_t *palette = info + infoSize;
+
+	// Truncated palette
+	if (bitCount == 8 && (size_t)(palette - data) + paletteSize * 4 > size)
+		return false;
+
+	rgba.resize((size_t)width * height * 4);
+
+	for (uint32_t y = 0; y < height; y++) {
+
+		const uint8_t *src = data + pixelOffset + rowBytes * ((topDown) ? y : height - 1 - y);
+		uint8_t *dst = rgba.data() + (size_t)y * width * 4;
+
+		for (uint32_t x = 0; x < width; x++, dst += 4) {
+
+			const uint8_t *bgr = (bitCount == 8) ? palette + min((uint32_t)src[x], paletteSize - 1) * 4 : src + x * (bitCount / 8);
+
+			dst[0] = bgr[2];
+			dst[1] = bgr[1];
+			dst[2] = bgr[0];
+			dst[3] = (bitCount == 32) ? bgr[3] : 255;
+		}
+	}
+
+	// Most 32-bit bitmaps leave the fourth byte zero rather than storing alpha
+	if (bitCount == 32) {
+
+		bool hasAlpha = false;
+
+		for (size_t i = 3; i < rgba.size() && !hasAlpha; i += 4)
+			hasAlpha = rgba[i] != 0;
+
+		for (size_t i = 3; i < rgba.size() && !hasAlpha; i += 4)
+			rgba[i] = 255;
+	}
+
+	return true;
+}
+
+
+bool gu_bmp_read(const char *filename, uint32_t& width, uint32_t& height, vector<uint8_t>& rgba) {
+
+	ifstream file(filename, ios::in | ios::binary);
+
+	if (!file.is_open()) {
+
+		cout << "Cannot open BMP file " << filename << endl;
+		return false;
+	}
+
+	vector<uint8_t> data((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+
+	if (!gu_bmp_decode(data.data(), data.size(), width, height, rgba)) {
+
+		cout << filename << " is not a BMP file or uses an unsupported encoding\n";
+		return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,18 @@
+//
+// GUBMPFile.h
+//
+
+// Minimal BMP file reader for the uncompressed (BI_RGB) 8-bit palettized, 24-bit and 32-bit bitmaps used by the texture resources.  Images are returned as top-down RGBA8 so they can be processed without WIC (see GUImageDecoder).
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+
+// Decode a BMP file in memory (size bytes) into rgba (width * 4 bytes per row, top row first).  Alpha is 255 unless a 32-bit bitmap stores it.  Return false if data is not a BMP file or uses an unsupported encoding
+bool gu_bmp_decode(const uint8_t *data, size_t size, uint32_t& width, uint32_t& height, std::vector<uint8_t>& rgba);
+
+// Read filename into rgba (width * 4 bytes per row, top row first).  Alpha is 255 unless a 32-bit bitmap stores it.  Return false if the file cannot be read or uses an unsupported encoding
+bool gu_bmp_read(const char *filename, uint32_t& width, uint32_t& height, std::vector<uint8_t>& rgba);
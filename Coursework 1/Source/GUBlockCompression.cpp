@@ -0,0 +1,866 @@
+
+//
+// GUBlockCompression.cpp
+//
+
+#include <stdafx.h>
+#include <GUBlockCompression.h>
+#include <GUDDSFile.h>
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <emmintrin.h>
+
+using namespace std;
+
+
+// Endpoint refinement passes per block (the best result is kept)
+static const int				refinementPasses = 3;
+
+// Interpolation weights of the second endpoint by index
+static const float				bc1FourColourWeights[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+static const float				bc1ThreeColourWeights[4] = { 0.0f, 1.0f, 0.5f, 0.0f };
+static const float				bc4Weights[8] = { 0.0f, 1.0f, 1.0f / 7.0f, 2.0f / 7.0f, 3.0f / 7.0f, 4.0f / 7.0f, 5.0f / 7.0f, 6.0f / 7.0f };
+static const uint32_t			bc7Weights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+
+// Block texels as floats - per texel for the endpoint fits and in groups of 4 texels for SSE index selection.  Channel i holds texel channel (firstChannel + i) % 4
+struct Block {
+
+	float			x[4][16];
+	__m128			groups[4][4]; // [channel][texel / 4]
+};
+
+
+static void loadBlock(const uint8_t rgba[64], uint32_t firstChannel, Block& block) {
+
+	for (uint32_t c = 0; c < 4; c++) {
+
+		uint32_t channel = (firstChannel + c) & 3;
+
+		for (uint32_t i = 0; i < 16; i++)
+			block.x[c][i] = (float)rgba[i * 4 + channel];
+
+		for (uint32_t g = 0; g < 4; g++)
+			block.groups[c][g] = _mm_loadu_ps(&block.x[c][g * 4]);
+	}
+}
+
+
+// Select the nearest of the numColours palette entries for each texel, comparing the first numChannels channels.  Return the total squared error
+static float selectIndices(const Block& block, uint32_t numChannels, const float palette[][4], uint32_t numColours, uint8_t indices[16]) {
+
+	__m128 total = _mm_setzero_ps();
+
+	for (uint32_t g = 0; g < 4; g++) {
+
+		__m128 best = _mm_set1_ps(FLT_MAX);
+		__m128i bestIndex = _mm_setzero_si128();
+
+		for (uint32_t k = 0; k < numColours; k++) {
+
+			__m128 d = _mm_setzero_ps();
+
+			for (uint32_t c = 0; c < numChannels; c++) {
+
+				__m128 diff = _mm_sub_ps(block.groups[c][g], _mm_set1_ps(palette[k][c]));
+				d = _mm_add_ps(d, _mm_mul_ps(diff, diff));
+			}
+
+			__m128i closer = _mm_castps_si128(_mm_cmplt_ps(d, best));
+
+			best = _mm_min_ps(d, best);
+			bestIndex = _mm_or_si128(_mm_and_si128(closer, _mm_set1_epi32((int)k)), _mm_andnot_si128(closer, bestIndex));
+		}
+
+		total = _mm_add_ps(total, best);
+
+		int32_t groupIndices[4];
+
+		_mm_storeu_si128((__m128i*)groupIndices, bestIndex);
+
+		for (uint32_t i = 0; i < 4; i++)
+			indices[g * 4 + i] = (uint8_t)groupIndices[i];
+	}
+
+	float sums[4];
+
+	_mm_storeu_ps(sums, total);
+
+	return sums[0] + sums[1] + sums[2] + sums[3];
+}
+
+
+// Endpoints at the extremes of the block's projection onto the principal axis of its first numChannels channels
+static void principalEndpoints(const Block& block, uint32_t numChannels, float e0[4], float e1[4]) {
+
+	float mean[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	float covariance[4][4] = {};
+
+	for (uint32_t c = 0; c < numChannels; c++) {
+
+		for (uint32_t i = 0; i < 16; i++)
+			mean[c] += block.x[c][i];
+
+		mean[c] /= 16.0f;
+	}
+
+	for (uint32_t i = 0; i < 16; i++)
+		for (uint32_t c = 0; c < numChannels; c++)
+			for (uint32_t d = c; d < numChannels; d++)
+				covariance[c][d] += (block.x[c][i] - mean[c]) * (block.x[d][i] - mean[d]);
+
+	for (uint32_t c = 0; c < numChannels; c++)
+		for (uint32_t d = 0; d < c; d++)
+			covariance[c][d] = covariance[d][c];
+
+	// Power iteration starting from the channel with the largest variance
+	uint32_t start = 0;
+
+	for (uint32_t c = 1; c < numChannels; c++)
+		if (covariance[c][c] > covariance[start][start])
+			start = c;
+
+	float axis[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+
+	for (uint32_t c = 0; c < numChannels; c++)
+		axis[c] = covariance[c][start];
+
+	for (int iteration = 0; iteration < 8; iteration++) {
+
+		float next[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+		float largest = 0.0f;
+
+		for (uint32_t c = 0; c < numChannels; c++) {
+
+			for (uint32_t d = 0; d < numChannels; d++)
+				next[c] += covariance[c][d] * axis[d];
+
+			largest = max(largest, fabs(next[c]));
+		}
+
+		if (largest < 1e-6f)
+			break;
+
+		for (uint32_t c = 0; c < numChannels; c++)
+			axis[c] = next[c] / largest;
+	}
+
+	float length = 0.0f;
+
+	for (uint32_t c = 0; c < numChannels; c++)
+		length += axis[c] * axis[c];
+
+	if (length < 1e-12f) {
+
+		// Flat block
+		for (uint32_t c = 0; c < 4; c++)
+			e0[c] = e1[c] = mean[c];
+
+		return;
+	}
+
+	length = sqrt(length);
+
+	float minT = FLT_MAX, maxT = -FLT_MAX;
+
+	for (uint32_t i = 0; i < 16; i++) {
+
+		float t = 0.0f;
+
+		for (uint32_t c = 0; c < numChannels; c++)
+			t += (block.x[c][i] - mean[c]) * axis[c] / length;
+
+		minT = min(minT, t);
+		maxT = max(maxT, t);
+	}
+
+	for (uint32_t c = 0; c < 4; c++) {
+
+		e0[c] = mean[c] + axis[c] / length * minT;
+		e1[c] = mean[c] + axis[c] / length * maxT;
+	}
+}
+
+
+// Least squares endpoints for the selected indices (weights[i] is the weight of e1 for index i).  Return false if every texel uses the same weight
+static bool refineEndpoints(const Block& block, uint32_t numChannels, const uint8_t indices[16], const float *weights, float e0[4], float e1[4]) {
+
+	float a = 0.0f, b = 0.0f, c = 0.0f;
+	float x0[4] = { 0.0f, 0.0f, 0.0f, 0.0f }, x1[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+
+	for (uint32_t i = 0; i < 16; i++) {
+
+		float w = weights[indices[i]];
+		float v = 1.0f - w;
+
+		a += v * v;
+		b += v * w;
+		c += w * w;
+
+		for (uint32_t ch = 0; ch < numChannels; ch++) {
+
+			x0[ch] += v * block.x[ch][i];
+			x1[ch] += w * block.x[ch][i];
+		}
+	}
+
+	float det = a * c - b * b;
+
+	if (fabs(det) < 1e-6f)
+		return false;
+
+	for (uint32_t ch = 0; ch < numChannels; ch++) {
+
+		e0[ch] = min(max((x0[ch] * c - x1[ch] * b) / det, 0.0f), 255.0f);
+		e1[ch] = min(max((x1[ch] * a - x0[ch] * b) / det, 0.0f), 255.0f);
+	}
+
+	return true;
+}
+
+
+static inline uint32_t quantize(float value, uint32_t maxValue) {
+
+	return (uint32_t)min(max(value * (float)maxValue / 255.0f + 0.5f, 0.0f), (float)maxValue);
+}
+
+
+static inline uint16_t packRGB565(const float c[4]) {
+
+	return (uint16_t)((quantize(c[0], 31) << 11) | (quantize(c[1], 63) << 5) | quantize(c[2], 31));
+}
+
+
+static inline void unpackRGB565(uint16_t v, uint32_t c[3]) {
+
+	uint32_t r = v >> 11, g = (v >> 5) & 63, b = v & 31;
+
+	c[0] = (r << 3) | (r >> 2);
+	c[1] = (g << 2) | (g >> 4);
+	c[2] = (b << 3) | (b >> 2);
+}
+
+
+// Decoded BC1 palette (RGBA).  Return the number of colours - 3 in the 3 colour mode, where entry 3 is transparent black
+static uint32_t bc1Palette(uint16_t c0, uint16_t c1, bool fourColour, uint32_t palette[4][4]) {
+
+	unpackRGB565(c0, palette[0]);
+	unpackRGB565(c1, palette[1]);
+
+	for (uint32_t c = 0; c < 3; c++) {
+
+		if (fourColour) {
+
+			palette[2][c] = (2 * palette[0][c] + palette[1][c] + 1) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c] + 1) / 3;
+
+		} else {
+
+			palette[2][c] = (palette[0][c] + palette[1][c] + 1) / 2;
+			palette[3][c] = 0;
+		}
+	}
+
+	for (uint32_t k = 0; k < 4; k++)
+		palette[k][3] = (fourColour || k < 3) ? 255 : 0;
+
+	return (fourColour) ? 4 : 3;
+}
+
+
+// Fit a BC1 colour block.  BC3 colour blocks always use 4 colours (forceFourColour) whatever the endpoint order; BC1 blocks use 3 colours when threeColour is set.  Return the squared error
+static float fitColour(const Block& block, bool threeColour, bool forceFourColour, uint16_t endpoints[2], uint8_t indices[16]) {
+
+	float e0[4], e1[4];
+
+	principalEndpoints(block, 3, e0, e1);
+
+	float bestError = FLT_MAX;
+
+	for (int pass = 0; pass < refinementPasses; pass++) {
+
+		uint16_t q0 = packRGB565(e0), q1 = packRGB565(e1);
+
+		// c0 > c1 selects the 4 colour mode in BC1
+		if ((threeColour) ? q0 > q1 : q0 < q1)
+			swap(q0, q1);
+
+		bool fourColour = forceFourColour || q0 > q1;
+		uint32_t palette[4][4];
+		uint32_t numColours = bc1Palette(q0, q1, fourColour, palette);
+		float paletteF[4][4];
+
+		for (uint32_t k = 0; k < 4; k++)
+			for (uint32_t c = 0; c < 4; c++)
+				paletteF[k][c] = (float)palette[k][c];
+
+		uint8_t passIndices[16];
+		float error = selectIndices(block, 3, paletteF, numColours, passIndices);
+
+		if (error < bestError) {
+
+			bestError = error;
+			endpoints[0] = q0;
+			endpoints[1] = q1;
+			memcpy(indices, passIndices, 16);
+		}
+
+		if (error == 0.0f || !refineEndpoints(block, 3, passIndices, (fourColour) ? bc1FourColourWeights : bc1ThreeColourWeights, e0, e1))
+			break;
+	}
+
+	return bestError;
+}
+
+
+static void writeColourBlock(const uint16_t endpoints[2], const uint8_t indices[16], uint8_t block[8]) {
+
+	uint32_t bits = 0;
+
+	for (uint32_t i = 0; i < 16; i++)
+		bits |= (uint32_t)indices[i] << (i * 2);
+
+	block[0] = (uint8_t)endpoints[0];
+	block[1] = (uint8_t)(endpoints[0] >> 8);
+	block[2] = (uint8_t)endpoints[1];
+	block[3] = (uint8_t)(endpoints[1] >> 8);
+
+	for (uint32_t i = 0; i < 4; i++)
+		block[4 + i] = (uint8_t)(bits >> (i * 8));
+}
+
+
+// Decoded BC4 palette
+static void bc4Palette(uint32_t a, uint32_t b, uint32_t palette[8]) {
+
+	palette[0] = a;
+	palette[1] = b;
+
+	if (a > b) {
+
+		for (uint32_t i = 2; i < 8; i++)
+			palette[i] = ((8 - i) * a + (i - 1) * b + 3) / 7;
+
+	} else {
+
+		for (uint32_t i = 2; i < 6; i++)
+			palette[i] = ((6 - i) * a + (i - 1) * b + 2) / 5;
+
+		palette[6] = 0;
+		palette[7] = 255;
+	}
+}
+
+
+// Fit a BC4 block to channel 0 of block
+static void fitBC4(const Block& block, uint8_t out[8]) {
+
+	float e0[4] = { 0.0f, 0.0f, 0.0f, 0.0f }, e1[4] = { 255.0f, 0.0f, 0.0f, 0.0f };
+
+	for (uint32_t i = 0; i < 16; i++) {
+
+		e0[0] = max(e0[0], block.x[0][i]);
+		e1[0] = min(e1[0], block.x[0][i]);
+	}
+
+	float bestError = FLT_MAX;
+	uint32_t best0 = 0, best1 = 0;
+	uint8_t indices[16];
+
+	for (int pass = 0; pass < refinementPasses; pass++) {
+
+		uint32_t q0 = quantize(e0[0], 255), q1 = quantize(e1[0], 255);
+
+		// a > b selects the 8 value mode
+		if (q0 < q1)
+			swap(q0, q1);
+
+		uint32_t palette[8];
+		float paletteF[8][4];
+
+		bc4Palette(q0, q1, palette);
+
+		for (uint32_t k = 0; k < 8; k++)
+			paletteF[k][0] = (float)palette[k];
+
+		uint8_t passIndices[16];
+		float error = selectIndices(block, 1, paletteF, 8, passIndices);
+
+		if (error < bestError) {
+
+			bestError = error;
+			best0 = q0;
+			best1 = q1;
+			memcpy(indices, passIndices, 16);
+		}
+
+		if (error == 0.0f || q0 == q1 || !refineEndpoints(block, 1, passIndices, bc4Weights, e0, e1))
+			break;
+	}
+
+	uint64_t bits = 0;
+
+	for (uint32_t i = 0; i < 16; i++)
+		bits |= (uint64_t)indices[i] << (i * 3);
+
+	out[0] = (uint8_t)best0;
+	out[1] = (uint8_t)best1;
+
+	for (uint32_t i = 0; i < 6; i++)
+		out[2 + i] = (uint8_t)(bits >> (i * 8));
+}
+
+
+// Bit packing for BC7 blocks (least significant bit first)
+struct BitStream {
+
+	uint8_t			*data;
+	uint32_t		position;
+
+	void write(uint32_t value, uint32_t bits) {
+
+		for (uint32_t i = 0; i < bits; i++, position++)
+			if ((value >> i) & 1)
+				data[position >> 3] |= (uint8_t)(1 << (position & 7));
+	}
+
+	uint32_t read(uint32_t bits) {
+
+		uint32_t value = 0;
+
+		for (uint32_t i = 0; i < bits; i++, position++)
+			value |= (uint32_t)((data[position >> 3] >> (position & 7)) & 1) << i;
+
+		return value;
+	}
+};
+
+
+// Quantize a BC7 mode 6 endpoint - 7 bits per channel plus a p-bit shared by the channels
+static void quantizeMode6Endpoint(const float e[4], uint32_t q7[4], uint32_t& pBit) {
+
+	float bestError = FLT_MAX;
+
+	for (uint32_t p = 0; p < 2; p++) {
+
+		uint32_t candidate[4];
+		float error = 0.0f;
+
+		for (uint32_t c = 0; c < 4; c++) {
+
+			candidate[c] = (uint32_t)min(max((e[c] - (float)p) * 0.5f + 0.5f, 0.0f), 127.0f);
+
+			float d = (float)(candidate[c] * 2 + p) - e[c];
+
+			error += d * d;
+		}
+
+		if (error < bestError) {
+
+			bestError = error;
+			pBit = p;
+			memcpy(q7, candidate, sizeof(candidate));
+		}
+	}
+}
+
+
+// Encode a 4x4 block of RGBA texels as BC7 mode 6
+static void fitBC7Mode6(const Block& block, uint8_t out[16]) {
+
+	float weights[16];
+
+	for (uint32_t i = 0; i < 16; i++)
+		weights[i] = (float)bc7Weights4[i] / 64.0f;
+
+	float e0[4], e1[4];
+
+	principalEndpoints(block, 4, e0, e1);
+
+	float bestError = FLT_MAX;
+	uint32_t best[2][4], bestP[2];
+	uint8_t indices[16];
+
+	for (int pass = 0; pass < refinementPasses; pass++) {
+
+		uint32_t q[2][4], p[2];
+
+		quantizeMode6Endpoint(e0, q[0], p[0]);
+		quantizeMode6Endpoint(e1, q[1], p[1]);
+
+		float palette[16][4];
+
+		for (uint32_t c = 0; c < 4; c++) {
+
+			uint32_t a = q[0][c] * 2 + p[0], b = q[1][c] * 2 + p[1];
+
+			for (uint32_t k = 0; k < 16; k++)
+				palette[k][c] = (float)(((64 - bc7Weights4[k]) * a + bc7Weights4[k] * b + 32) >> 6);
+		}
+
+		uint8_t passIndices[16];
+		float error = selectIndices(block, 4, palette, 16, passIndices);
+
+		if (error < bestError) {
+
+			bestError = error;
+			memcpy(best, q, sizeof(q));
+			memcpy(bestP, p, sizeof(p));
+			memcpy(indices, passIndices, 16);
+		}
+
+		if (error == 0.0f || !refineEndpoints(block, 4, passIndices, weights, e0, e1))
+			break;
+	}
+
+	// The most significant bit of the first index is implicitly 0 - swap the endpoints if it is set
+	if (indices[0] & 8) {
+
+		swap(best[0], best[1]);
+		swap(bestP[0], bestP[1]);
+
+		for (uint32_t i = 0; i < 16; i++)
+			indices[i] = (uint8_t)(15 - indices[i]);
+	}
+
+	memset(out, 0, 16);
+
+	BitStream bits = { out, 0 };
+
+	bits.write(1 << 6, 7); // mode 6
+
+	for (uint32_t c = 0; c < 4; c++) {
+
+		bits.write(best[0][c], 7);
+		bits.write(best[1][c], 7);
+	}
+
+	bits.write(bestP[0], 1);
+	bits.write(bestP[1], 1);
+	bits.write(indices[0], 3);
+
+	for (uint32_t i = 1; i < 16; i++)
+		bits.write(indices[i], 4);
+}
+
+
+static void decodeColourBlock(const uint8_t block[8], bool forceFourColour, uint8_t rgba[64]) {
+
+	uint16_t c0 = (uint16_t)(block[0] | (block[1] << 8));
+	uint16_t c1 = (uint16_t)(block[2] | (block[3] << 8));
+	uint32_t bits = (uint32_t)block[4] | ((uint32_t)block[5] << 8) | ((uint32_t)block[6] << 16) | ((uint32_t)block[7] << 24);
+	uint32_t palette[4][4];
+
+	bc1Palette(c0, c1, forceFourColour || c0 > c1, palette);
+
+	for (uint32_t i = 0; i < 16; i++)
+		for (uint32_t c = 0; c < 4; c++)
+			rgba[i * 4 + c] = (uint8_t)palette[(bits >> (i * 2)) & 3][c];
+}
+
+
+
+//
+// Public interface
+//
+
+uint32_t gu_bc_block_bytes(uint32_t format) {
+
+	switch (format) {
+
+		case GU_DXGI_FORMAT_BC1_UNORM:
+		case GU_DXGI_FORMAT_BC1_UNORM_SRGB:
+		case GU_DXGI_FORMAT_BC4_UNORM:
+			return 8;
+
+		case GU_DXGI_FORMAT_BC3_UNORM:
+		case GU_DXGI_FORMAT_BC3_UNORM_SRGB:
+		case GU_DXGI_FORMAT_BC5_UNORM:
+		case GU_DXGI_FORMAT_BC7_UNORM:
+		case GU_DXGI_FORMAT_BC7_UNORM_SRGB:
+			return 16;
+	}
+
+	return 0;
+}
+
+
+void gu_bc1_compress_block(const uint8_t rgba[64], uint8_t block[8]) {
+
+	uint8_t texels[64];
+	bool transparent[16];
+	bool threeColour = false;
+	int opaque = -1;
+
+	memcpy(texels, rgba, 64);
+
+	for (uint32_t i = 0; i < 16; i++) {
+
+		transparent[i] = rgba[i * 4 + 3] < 128;
+
+		if (transparent[i])
+			threeColour = true;
+		else if (opaque < 0)
+			opaque = (int)i;
+	}
+
+	// Transparent texels take index 3 whatever their colour so give them an opaque colour for the fit
+	if (threeColour) {
+
+		for (uint32_t i = 0; i < 16; i++)
+			if (transparent[i])
+				memcpy(texels + i * 4, (opaque >= 0) ? rgba + opaque * 4 : texels + i * 4, 3);
+	}
+
+	Block b;
+	uint16_t endpoints[2] = { 0, 0 };
+	uint8_t indices[16];
+
+	loadBlock(texels, 0, b);
+
+	if (opaque >= 0)
+		fitColour(b, threeColour, false, endpoints, indices);
+	else
+		memset(indices, 0, 16);
+
+	for (uint32_t i = 0; i < 16; i++)
+		if (transparent[i])
+			indices[i] = 3;
+
+	writeColourBlock(endpoints, indices, block);
+}
+
+
+void gu_bc3_compress_block(const uint8_t rgba[64], uint8_t block[16]) {
+
+	Block b;
+	uint16_t endpoints[2];
+	uint8_t indices[16];
+
+	gu_bc4_compress_block(rgba, 3, block);
+
+	loadBlock(rgba, 0, b);
+	fitColour(b, false, true, endpoints, indices);
+	writeColourBlock(endpoints, indices, block + 8);
+}
+
+
+void gu_bc4_compress_block(const uint8_t rgba[64], uint32_t channel, uint8_t block[8]) {
+
+	Block b;
+
+	loadBlock(rgba, channel, b);
+	fitBC4(b, block);
+}
+
+
+void gu_bc5_compress_block(const uint8_t rgba[64], uint8_t block[16]) {
+
+	gu_bc4_compress_block(rgba, 0, block);
+	gu_bc4_compress_block(rgba, 1, block + 8);
+}
+
+
+void gu_bc7_compress_block(const uint8_t rgba[64], uint8_t block[16]) {
+
+	Block b;
+
+	loadBlock(rgba, 0, b);
+	fitBC7Mode6(b, block);
+}
+
+
+void gu_bc1_decompress_block(const uint8_t block[8], uint8_t rgba[64]) {
+
+	decodeColourBlock(block, false, rgba);
+}
+
+
+void gu_bc3_decompress_block(const uint8_t block[16], uint8_t rgba[64]) {
+
+	decodeColourBlock(block + 8, true, rgba);
+	gu_bc4_decompress_block(block, 3, rgba);
+}
+
+
+void gu_bc4_decompress_block(const uint8_t block[8], uint32_t channel, uint8_t rgba[64]) {
+
+	uint32_t palette[8];
+	uint64_t bits = 0;
+
+	bc4Palette(block[0], block[1], palette);
+
+	for (uint32_t i = 0; i < 6; i++)
+		bits |= (uint64_t)block[2 + i] << (i * 8);
+
+	for (uint32_t i = 0; i < 16; i++)
+		rgba[i * 4 + channel] = (uint8_t)palette[(bits >> (i * 3)) & 7];
+}
+
+
+void gu_bc5_decompress_block(const uint8_t block[16], uint8_t rgba[64]) {
+
+	for (uint32_t i = 0; i < 16; i++) {
+
+		rgba[i * 4 + 2] = 0;
+		rgba[i * 4 + 3] = 255;
+	}
+
+	gu_bc4_decompress_block(block, 0, rgba);
+	gu_bc4_decompress_block(block + 8, 1, rgba);
+}
+
+
+bool gu_bc7_decompress_block(const uint8_t block[16], uint8_t rgba[64]) {
+
+	if ((block[0] & 0x7F) != 0x40) {
+
+		memset(rgba, 0, 64);
+		return false;
+	}
+
+	uint8_t data[16];
+
+	memcpy(data, block, 16);
+
+	BitStream bits = { data, 7 };
+	uint32_t e[2][4];
+
+	for (uint32_t c = 0; c < 4; c++) {
+
+		e[0][c] = bits.read(7) << 1;
+		e[1][c] = bits.read(7) << 1;
+	}
+
+	uint32_t p0 = bits.read(1), p1 = bits.read(1);
+
+	for (uint32_t c = 0; c < 4; c++) {
+
+		e[0][c] |= p0;
+		e[1][c] |= p1;
+	}
+
+	for (uint32_t i = 0; i < 16; i++) {
+
+		uint32_t w = bc7Weights4[bits.read((i == 0) ? 3 : 4)];
+
+		for (uint32_t c = 0; c < 4; c++)
+			rgba[i * 4 + c] = (uint8_t)(((64 - w) * e[0][c] + w * e[1][c] + 32) >> 6);
+	}
+
+	return true;
+}
+
+
+bool gu_bc_compress_rows(uint32_t format, uint32_t width, uint32_t height, const uint8_t *rgba, size_t stride, uint32_t firstBlockRow, uint32_t lastBlockRow, uint8_t *output) {
+
+	uint32_t blockBytes = gu_bc_block_bytes(format);
+
+	if (blockBytes == 0 || width == 0 || height == 0)
+		return false;
+
+	uint32_t blocksWide = (width + 3) / 4;
+	uint8_t texels[64];
+
+	for (uint32_t by = firstBlockRow; by < lastBlockRow; by++) {
+
+		for (uint32_t bx = 0; bx < blocksWide; bx++) {
+
+			for (uint32_t y = 0; y < 4; y++) {
+
+				const uint8_t *row = rgba + min(by * 4 + y, height - 1) * stride;
+
+				for (uint32_t x = 0; x < 4; x++)
+					memcpy(texels + (y * 4 + x) * 4, row + min(bx * 4 + x, width - 1) * 4, 4);
+			}
+
+			uint8_t *block = output + ((size_t)by * blocksWide + bx) * blockBytes;
+
+			switch (format) {
+
+				case GU_DXGI_FORMAT_BC1_UNORM:
+				case GU_DXGI_FORMAT_BC1_UNORM_SRGB:
+					gu_bc1_compress_block(texels, block);
+					break;
+
+				case GU_DXGI_FORMAT_BC3_UNORM:
+				case GU_DXGI_FORMAT_BC3_UNORM_SRGB:
+					gu_bc3_compress_block(texels, block);
+					break;
+
+				case GU_DXGI_FORMAT_BC4_UNORM:
+					gu_bc4_compress_block(texels, 0, block);
+					break;
+
+				case GU_DXGI_FORMAT_BC5_UNORM:
+					gu_bc5_compress_block(texels, block);
+					break;
+
+				default:
+					gu_bc7_compress_block(texels, block);
+					break;
+			}
+		}
+	}
+
+	return true;
+}
+
+
+bool gu_bc_decompress(uint32_t format, uint32_t width, uint32_t height, const uint8_t *blocks, uint8_t *rgba) {
+
+	uint32_t blockBytes = gu_bc_block_bytes(format);
+
+	if (blockBytes == 0)
+		return false;
+
+	uint32_t blocksWide = (width + 3) / 4, blocksHigh = (height + 3) / 4;
+	uint8_t texels[64];
+
+	for (uint32_t by = 0; by < blocksHigh; by++) {
+
+		for (uint32_t bx = 0; bx < blocksWide; bx++) {
+
+			const uint8_t *block = blocks + ((size_t)by * blocksWide + bx) * blockBytes;
+
+			switch (format) {
+
+				case GU_DXGI_FORMAT_BC1_UNORM:
+				case GU_DXGI_FORMAT_BC1_UNORM_SRGB:
+					gu_bc1_decompress_block(block, texels);
+					break;
+
+				case GU_DXGI_FORMAT_BC3_UNORM:
+				case GU_DXGI_FORMAT_BC3_UNORM_SRGB:
+					gu_bc3_decompress_block(block, texels);
+					break;
+
+				case GU_DXGI_FORMAT_BC4_UNORM:
+					for (uint32_t i = 0; i < 16; i++) {
+
+						texels[i * 4 + 1] = texels[i * 4 + 2] = 0;
+						texels[i * 4 + 3] = 255;
+					}
+
+					gu_bc4_decompress_block(block, 0, texels);
+					break;
+
+				case GU_DXGI_FORMAT_BC5_UNORM:
+					gu_bc5_decompress_block(block, texels);
+					break;
+
+				default:
+					gu_bc7_decompress_block(block, texels);
+					break;
+			}
+
+			for (uint32_t y = 0; y < 4 && by * 4 + y < height; y++)
+				for (uint32_t x = 0; x < 4 && bx * 4 + x < width; x++)
+					memcpy(rgba + ((size_t)(by * 4 + y) * width + bx * 4 + x) * 4, texels + (y * 4 + x) * 4, 4);
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,33 @@
+//
+// GUBlockCompression.h
+//
+
+// BCn block compression.  Each encoder compresses one 4x4 block of RGBA8 texels (row-major, 64 bytes).  Endpoints start on the principal axis of the block colours and are refined by least squares on the selected indices, keeping the best of a few iterations; index selection compares 4 texels at a time with SSE.  BC1 switches to the 3 colour mode with transparent texels when the block contains alpha below 128, BC3 stores alpha as a BC4 block, BC5 stores red and green as two BC4 blocks (tangent space normal maps - the shader reconstructs z) and BC7 uses mode 6 (one subset, RGBA endpoints with p-bits and 4-bit indices).  The decoders support the blocks the encoders produce (BC7 mode 6 only) and are used to measure compression error.
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+
+// Bytes per 4x4 block of a BCn format (GU_DXGI_FORMAT_* - see GUDDSFile.h).  Return 0 for formats the encoder does not support
+uint32_t gu_bc_block_bytes(uint32_t format);
+
+void gu_bc1_compress_block(const uint8_t rgba[64], uint8_t block[8]);
+void gu_bc3_compress_block(const uint8_t rgba[64], uint8_t block[16]);
+void gu_bc4_compress_block(const uint8_t rgba[64], uint32_t channel, uint8_t block[8]);
+void gu_bc5_compress_block(const uint8_t rgba[64], uint8_t block[16]);
+void gu_bc7_compress_block(const uint8_t rgba[64], uint8_t block[16]);
+
+// Decoders write all four channels (BC4 writes channel and leaves the others unchanged).  gu_bc7_decompress_block returns false (and writes zero) for modes other than 6
+void gu_bc1_decompress_block(const uint8_t block[8], uint8_t rgba[64]);
+void gu_bc3_decompress_block(const uint8_t block[16], uint8_t rgba[64]);
+void gu_bc4_decompress_block(const uint8_t block[8], uint32_t channel, uint8_t rgba[64]);
+void gu_bc5_decompress_block(const uint8_t block[16], uint8_t rgba[64]);
+bool gu_bc7_decompress_block(const uint8_t block[16], uint8_t rgba[64]);
+
+// Compress block rows [firstBlockRow, lastBlockRow) of a width x height RGBA8 image (rows stride bytes apart) in format.  Edge blocks repeat the last row / column.  output points to the start of the compressed surface.  Return false if format is not supported
+bool gu_bc_compress_rows(uint32_t format, uint32_t width, uint32_t height, const uint8_t *rgba, size_t stride, uint32_t firstBlockRow, uint32_t lastBlockRow, uint8_t *output);
+
+// Decompress a width x height surface into RGBA8 (width * 4 bytes per row).  Channels the format does not store are set to 0 (colour) or 255 (alpha).  Return false if format is not supported
+bool gu_bc_decompress(uint32_t format, uint32_t width, uint32_t height, const uint8_t *blocks, uint8_t *rgba);
@@ -0,0 +1,368 @@
+
+//
+// GUDDSFile.cpp
+//
+
+#include <stdafx.h>
+#include <GUDDSFile.h>
+#include <cstring>
+#include <fstream>
+
+using namespace std;
+
+
+// Header layout (see the DDS_HEADER and DDS_HEADER_DXT10 documentation)
+static const uint32_t			ddsMagic = 0x20534444; // "DDS "
+static const size_t				headerSize = 124;
+static const size_t				dx10HeaderSize = 20;
+
+static const uint32_t			ddsdCaps = 0x1;
+static const uint32_t			ddsdHeight = 0x2;
+static const uint32_t			ddsdWidth = 0x4;
+static const uint32_t			ddsdPixelFormat = 0x1000;
+static const uint32_t			ddsdMipMapCount = 0x20000;
+static const uint32_t			ddsdLinearSize = 0x80000;
+static const uint32_t			ddpfAlphaPixels = 0x1;
+static const uint32_t			ddpfFourCC = 0x4;
+static const uint32_t			ddpfRGB = 0x40;
+static const uint32_t			ddpfLuminance = 0x20000;
+static const uint32_t			ddsCapsComplex = 0x8;
+static const uint32_t			ddsCapsTexture = 0x1000;
+static const uint32_t			ddsCapsMipMap = 0x400000;
+static const uint32_t			ddsCaps2CubeMap = 0x200;
+static const uint32_t			ddsCaps2Volume = 0x200000;
+
+static const uint32_t			dx10Texture2D = 3;
+static const uint32_t			dx10Texture3D = 4;
+static const uint32_t			dx10MiscTextureCube = 0x4;
+
+
+static inline uint32_t makeFourCC(char a, char b, char c, char d) {
+
+	return (uint32_t)(uint8_t)a | ((uint32_t)(uint8_t)b << 8) | ((uint32_t)(uint8_t)c << 16) | ((uint32_t)(uint8_t)d << 24);
+}
+
+
+static inline uint32_t readUInt32(const uint8_t *p) {
+
+	return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+
+static inline void writeUInt32(uint8_t *p, uint32_t value) {
+
+	p[0] = (uint8_t)value;
+	p[1] = (uint8_t)(value >> 8);
+	p[2] = (uint8_t)(value >> 16);
+	p[3] = (uint8_t)(value >> 24);
+}
+
+
+// Map a legacy (pre-DX10) pixel format to a DXGI format
+static uint32_t legacyFormat(const uint8_t *pf) {
+
+	uint32_t flags = readUInt32(pf + 4);
+	uint32_t fourCC = readUInt32(pf + 8);
+	uint32_t bitCount = readUInt32(pf + 12);
+	uint32_t r = readUInt32(pf + 16), g = readUInt32(pf + 20), b = readUInt32(pf + 24), a = readUInt32(pf + 28);
+
+	if (flags & ddpfFourCC) {
+
+		if (fourCC == makeFourCC('D', 'X', 'T', '1'))
+			return GU_DXGI_FORMAT_BC1_UNORM;
+		if (fourCC == makeFourCC('D', 'X', 'T', '2') || fourCC == makeFourCC('D', 'X', 'T', '3'))
+			return GU_DXGI_FORMAT_BC2_UNORM;
+		if (fourCC == makeFourCC('D', 'X', 'T', '4') || fourCC == makeFourCC('D', 'X', 'T', '5'))
+			return GU_DXGI_FORMAT_BC3_UNORM;
+		if (fourCC == makeFourCC('A', 'T', 'I', '1') || fourCC == makeFourCC('B', 'C', '4', 'U'))
+			return GU_DXGI_FORMAT_BC4_UNORM;
+		if (fourCC == makeFourCC('B', 'C', '4', 'S'))
+			return GU_DXGI_FORMAT_BC4_SNORM;
+		if (fourCC == makeFourCC('A', 'T', 'I', '2') || fourCC == makeFourCC('B', 'C', '5', 'U'))
+			return GU_DXGI_FORMAT_BC5_UNORM;
+		if (fourCC == makeFourCC('B', 'C', '5', 'S'))
+			return GU_DXGI_FORMAT_BC5_SNORM;
+
+		// D3DFORMAT values stored as a FourCC
+		if (fourCC == 36)
+			return GU_DXGI_FORMAT_R16G16B16A16_UNORM;
+		if (fourCC == 113)
+			return GU_DXGI_FORMAT_R16G16B16A16_FLOAT;
+		if (fourCC == 116)
+			return GU_DXGI_FORMAT_R32G32B32A32_FLOAT;
+
+		return GU_DXGI_FORMAT_UNKNOWN;
+	}
+
+	if ((flags & ddpfRGB) && bitCount == 32) {
+
+		if (r == 0x000000FF && g == 0x0000FF00 && b == 0x00FF0000 && a == 0xFF000000)
+			return GU_DXGI_FORMAT_R8G8B8A8_UNORM;
+		if (r == 0x00FF0000 && g == 0x0000FF00 && b == 0x000000FF && a == 0xFF000000)
+			return GU_DXGI_FORMAT_B8G8R8A8_UNORM;
+		if (r == 0x00FF0000 && g == 0x0000FF00 && b == 0x000000FF && (a == 0 || !(flags & ddpfAlphaPixels)))
+			return GU_DXGI_FORMAT_B8G8R8X8_UNORM;
+		if (r == 0x3FF00000 && g == 0x000FFC00 && b == 0x000003FF && a == 0xC0000000)
+			return GU_DXGI_FORMAT_R10G10B10A2_UNORM; // the masks are swapped in files written by D3DX
+		if (r == 0x000003FF && g == 0x000FFC00 && b == 0x3FF00000 && a == 0xC0000000)
+			return GU_DXGI_FORMAT_R10G10B10A2_UNORM;
+	}
+
+	if ((flags & ddpfLuminance) && bitCount == 8 && r == 0xFF)
+		return GU_DXGI_FORMAT_R8_UNORM;
+
+	if ((flags & ddpfLuminance) && bitCount == 16 && r == 0x00FF && a == 0xFF00)
+		return GU_DXGI_FORMAT_R8G8_UNORM;
+
+	return GU_DXGI_FORMAT_UNKNOWN;
+}
+
+
+uint32_t gu_dds_bytes_per_block(uint32_t format, uint32_t *blockDim) {
+
+	uint32_t dim = 1, bytes = 0;
+
+	switch (format) {
+
+		case GU_DXGI_FORMAT_R32G32B32A32_FLOAT:
+			bytes = 16;
+			break;
+
+		case GU_DXGI_FORMAT_R16G16B16A16_FLOAT:
+		case GU_DXGI_FORMAT_R16G16B16A16_UNORM:
+			bytes = 8;
+			break;
+
+		case GU_DXGI_FORMAT_R10G10B10A2_UNORM:
+		case GU_DXGI_FORMAT_R8G8B8A8_UNORM:
+		case GU_DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+		case GU_DXGI_FORMAT_B8G8R8A8_UNORM:
+		case GU_DXGI_FORMAT_B8G8R8X8_UNORM:
+		case GU_DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+		case GU_DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:
+			bytes = 4;
+			break;
+
+		case GU_DXGI_FORMAT_R8G8_UNORM:
+			bytes = 2;
+			break;
+
+		case GU_DXGI_FORMAT_R8_UNORM:
+			bytes = 1;
+			break;
+
+		case GU_DXGI_FORMAT_BC1_UNORM:
+		case GU_DXGI_FORMAT_BC1_UNORM_SRGB:
+		case GU_DXGI_FORMAT_BC4_UNORM:
+		case GU_DXGI_FORMAT_BC4_SNORM:
+			dim = 4;
+			bytes = 8;
+			break;
+
+		case GU_DXGI_FORMAT_BC2_UNORM:
+		case GU_DXGI_FORMAT_BC2_UNORM_SRGB:
+		case GU_DXGI_FORMAT_BC3_UNORM:
+		case GU_DXGI_FORMAT_BC3_UNORM_SRGB:
+		case GU_DXGI_FORMAT_BC5_UNORM:
+		case GU_DXGI_FORMAT_BC5_SNORM:
+		case GU_DXGI_FORMAT_BC6H_UF16:
+		case GU_DXGI_FORMAT_BC6H_SF16:
+		case GU_DXGI_FORMAT_BC7_UNORM:
+		case GU_DXGI_FORMAT_BC7_UNORM_SRGB:
+			dim = 4;
+			bytes = 16;
+			break;
+	}
+
+	if (blockDim)
+		*blockDim = dim;
+
+	return bytes;
+}
+
+
+bool gu_dds_parse_info(const uint8_t *data, size_t size, gu_dds_info& info) {
+
+	if (size < 4 + headerSize || readUInt32(data) != ddsMagic || readUInt32(data + 4) != headerSize)
+		return false;
+
+	const uint8_t *h = data + 4;
+	const uint8_t *pf = h + 72;
+
+	memset(&info, 0, sizeof(info));
+
+	info.height = readUInt32(h + 8);
+	info.width = readUInt32(h + 12);
+	info.depth = 1;
+	info.mipCount = (readUInt32(h + 4) & ddsdMipMapCount) ? max(readUInt32(h + 24), 1u) : 1;
+	info.arraySize = 1;
+	info.dataOffset = 4 + headerSize;
+
+	uint32_t caps2 = readUInt32(h + 108);
+
+	if ((readUInt32(pf + 4) & ddpfFourCC) && readUInt32(pf + 8) == makeFourCC('D', 'X', '1', '0')) {
+
+		const uint8_t *dx10 = data + 4 + headerSize;
+
+		if (size < 4 + headerSize + dx10HeaderSize)
+			return false;
+
+		uint32_t dimension = readUInt32(dx10 + 4);
+
+		info.format = readUInt32(dx10);
+		info.arraySize = max(readUInt32(dx10 + 12), 1u);
+		info.cubeMap = (readUInt32(dx10 + 8) & dx10MiscTextureCube) != 0;
+		info.volume = (dimension == dx10Texture3D);
+		info.dataOffset += dx10HeaderSize;
+
+		// Only 2D and 3D textures
+		if (dimension != dx10Texture2D && dimension != dx10Texture3D)
+			return false;
+
+	} else {
+
+		info.format = legacyFormat(pf);
+		info.cubeMap = (caps2 & ddsCaps2CubeMap) != 0;
+		info.volume = (caps2 & ddsCaps2Volume) != 0;
+	}
+
+	if (info.volume)
+		info.depth = max(readUInt32(h + 20), 1u);
+
+	if (info.cubeMap)
+		info.arraySize *= 6;
+
+	return gu_dds_bytes_per_block(info.format) != 0 && info.width != 0 && info.height != 0 && info.mipCount <= 32;
+}
+
+
+bool gu_dds_read_info(const char *filename, gu_dds_info& info) {
+
+	ifstream file(filename, ios::in | ios::binary);
+
+	if (!file.is_open()) {
+
+		cout << "Cannot open DDS file " << filename << endl;
+		return false;
+	}
+
+	uint8_t header[4 + headerSize + dx10HeaderSize];
+
+	file.read((char*)header, sizeof(header));
+
+	if (!gu_dds_parse_info(header, (size_t)file.gcount(), info)) {
+
+		cout << filename << " is not a DDS file or uses an unsupported format\n";
+		return false;
+	}
+
+	return true;
+}
+
+
+size_t gu_dds_mip_size(const gu_dds_info& info, uint32_t mip, uint32_t *rowPitch, uint32_t *rowCount) {
+
+	uint32_t blockDim;
+	uint32_t blockBytes = gu_dds_bytes_per_block(info.format, &blockDim);
+
+	uint32_t w = max(info.width >> mip, 1u);
+	uint32_t h = max(info.height >> mip, 1u);
+	uint32_t d = max(info.depth >> mip, 1u);
+
+	uint32_t pitch = ((w + blockDim - 1) / blockDim) * blockBytes;
+	uint32_t rows = (h + blockDim - 1) / blockDim;
+
+	if (rowPitch)
+		*rowPitch = pitch;
+
+	if (rowCount)
+		*rowCount = rows;
+
+	return (size_t)pitch * rows * d;
+}
+
+
+size_t gu_dds_mip_offset(const gu_dds_info& info, uint32_t mip) {
+
+	size_t offset = 0;
+
+	for (uint32_t i = 0; i < mip; i++)
+		offset += gu_dds_mip_size(info, i);
+
+	return offset;
+}
+
+
+bool gu_dds_read_mips(const char *filename, const gu_dds_info& info, uint32_t firstMip, uint32_t lastMip, vector<uint8_t>& data) {
+
+	if (firstMip > lastMip || lastMip >= info.mipCount)
+		return false;
+
+	size_t offset = gu_dds_mip_offset(info, firstMip);
+	size_t size = gu_dds_mip_offset(info, lastMip + 1) - offset;
+
+	ifstream file(filename, ios::in | ios::binary);
+
+	if (!file.is_open()) {
+
+		cout << "Cannot open DDS file " << filename << endl;
+		return false;
+	}
+
+	data.resize(size);
+
+	if (!file.seekg((streamoff)(info.dataOffset + offset)) || !file.read((char*)data.data(), (streamsize)size)) {
+
+		cout << filename << " is truncated (mips " << firstMip << " to " << lastMip << ")\n";
+
+		data.clear();
+		return false;
+	}
+
+	return true;
+}
+
+
+bool gu_dds_write(const char *filename, const gu_dds_info& info, const vector<uint8_t>& data) {
+
+	if (info.cubeMap || info.volume || info.arraySize != 1 || info.mipCount == 0 || gu_dds_bytes_per_block(info.format) == 0 || data.size() != gu_dds_mip_offset(info, info.mipCount))
+		return false;
+
+	uint8_t header[4 + headerSize + dx10HeaderSize];
+	uint8_t *h = header + 4;
+	uint8_t *pf = h + 72;
+	uint8_t *dx10 = h + headerSize;
+
+	memset(header, 0, sizeof(header));
+
+	writeUInt32(header, ddsMagic);
+	writeUInt32(h, (uint32_t)headerSize);
+	writeUInt32(h + 4, ddsdCaps | ddsdHeight | ddsdWidth | ddsdPixelFormat | ddsdLinearSize | ((info.mipCount > 1) ? ddsdMipMapCount : 0));
+	writeUInt32(h + 8, info.height);
+	writeUInt32(h + 12, info.width);
+	writeUInt32(h + 16, (uint32_t)gu_dds_mip_size(info, 0));
+	writeUInt32(h + 24, info.mipCount);
+
+	writeUInt32(pf, 32);
+	writeUInt32(pf + 4, ddpfFourCC);
+	writeUInt32(pf + 8, makeFourCC('D', 'X', '1', '0'));
+
+	writeUInt32(h + 104, ddsCapsTexture | ((info.mipCount > 1) ? ddsCapsComplex | ddsCapsMipMap : 0));
+
+	writeUInt32(dx10, info.format);
+	writeUInt32(dx10 + 4, dx10Texture2D);
+	writeUInt32(dx10 + 12, 1);
+
+	ofstream file(filename, ios::out | ios::binary);
+
+	if (!file.is_open()) {
+
+		cout << "Cannot create DDS file " << filename << endl;
+		return false;
+	}
+
+	file.write((const char*)header, sizeof(header));
+	file.write((const char*)data.data(), (streamsize)data.size());
+
+	return file.good();
+}
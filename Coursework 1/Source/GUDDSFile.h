@@ -0,0 +1,78 @@
+//
+// GUDDSFile.h
+//
+
+// Minimal DDS file reader and writer.  gu_dds_read_info (gu_dds_parse_info for files in memory) parses the DDS header (legacy pixel formats and the DX10 extended header) into a gu_dds_info and gu_dds_read_mips reads a range of mip levels of the first surface without loading the rest of the file, which is what the texture streamer (see CGDTextureStreamer) needs to bring higher resolution mips in on demand.  gu_dds_write stores a 2D texture with a mip chain (see CGDTextureCompressor).  Formats are identified by their DXGI_FORMAT value so the description can be passed straight to D3D11 without this file depending on the D3D headers.
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+
+// DXGI_FORMAT values of the formats understood by the reader
+#define GU_DXGI_FORMAT_UNKNOWN					0
+#define GU_DXGI_FORMAT_R32G32B32A32_FLOAT		2
+#define GU_DXGI_FORMAT_R16G16B16A16_FLOAT		10
+#define GU_DXGI_FORMAT_R16G16B16A16_UNORM		11
+#define GU_DXGI_FORMAT_R10G10B10A2_UNORM		24
+#define GU_DXGI_FORMAT_R8G8B8A8_UNORM			28
+#define GU_DXGI_FORMAT_R8G8B8A8_UNORM_SRGB		29
+#define GU_DXGI_FORMAT_R8G8_UNORM				49
+#define GU_DXGI_FORMAT_R8_UNORM					61
+#define GU_DXGI_FORMAT_BC1_UNORM				71
+#define GU_DXGI_FORMAT_BC1_UNORM_SRGB			72
+#define GU_DXGI_FORMAT_BC2_UNORM				74
+#define GU_DXGI_FORMAT_BC2_UNORM_SRGB			75
+#define GU_DXGI_FORMAT_BC3_UNORM				77
+#define GU_DXGI_FORMAT_BC3_UNORM_SRGB			78
+#define GU_DXGI_FORMAT_BC4_UNORM				80
+#define GU_DXGI_FORMAT_BC4_SNORM				81
+#define GU_DXGI_FORMAT_BC5_UNORM				83
+#define GU_DXGI_FORMAT_BC5_SNORM				84
+#define GU_DXGI_FORMAT_B8G8R8A8_UNORM			87
+#define GU_DXGI_FORMAT_B8G8R8X8_UNORM			88
+#define GU_DXGI_FORMAT_B8G8R8A8_UNORM_SRGB		91
+#define GU_DXGI_FORMAT_B8G8R8X8_UNORM_SRGB		93
+#define GU_DXGI_FORMAT_BC6H_UF16				95
+#define GU_DXGI_FORMAT_BC6H_SF16				96
+#define GU_DXGI_FORMAT_BC7_UNORM				98
+#define GU_DXGI_FORMAT_BC7_UNORM_SRGB			99
+
+
+// Description of the surfaces stored in a DDS file
+struct gu_dds_info {
+
+	uint32_t			width;
+	uint32_t			height;
+	uint32_t			depth; // 1 unless volume is true
+	uint32_t			mipCount;
+	uint32_t			arraySize; // number of 2D surfaces (6 per cube for cube maps)
+	uint32_t			format; // DXGI_FORMAT
+	bool				cubeMap;
+	bool				volume;
+	size_t				dataOffset; // file offset of mip 0 of the first surface
+};
+
+
+// Bytes per block of 4x4 texels for block compressed formats or bytes per texel otherwise.  blockDim (optional) is set to 4 or 1.  Return 0 for unsupported formats
+uint32_t gu_dds_bytes_per_block(uint32_t format, uint32_t *blockDim = nullptr);
+
+// Parse and validate the header at the start of a DDS file in memory (size bytes).  Return false if data is not a DDS file or uses an unsupported format
+bool gu_dds_parse_info(const uint8_t *data, size_t size, gu_dds_info& info);
+
+// Read and validate the header of filename.  Return false if the file cannot be read or uses an unsupported format
+bool gu_dds_read_info(const char *filename, gu_dds_info& info);
+
+// Size in bytes of mip level mip of one surface.  rowPitch and rowCount (optional) are the bytes per row of texels / blocks and the number of rows per depth slice
+size_t gu_dds_mip_size(const gu_dds_info& info, uint32_t mip, uint32_t *rowPitch = nullptr, uint32_t *rowCount = nullptr);
+
+// Offset of mip level mip of the first surface from info.dataOffset
+size_t gu_dds_mip_offset(const gu_dds_info& info, uint32_t mip);
+
+// Read mip levels [firstMip, lastMip] of the first surface (mips are stored contiguously).  data is resized to the total size.  Return false on failure
+bool gu_dds_read_mips(const char *filename, const gu_dds_info& info, uint32_t firstMip, uint32_t lastMip, std::vector<uint8_t>& data);
+
+// Write a 2D texture (info.arraySize = 1, no cube map or volume) with info.mipCount mips stored contiguously in data (mip 0 first) using the DX10 header.  Return false on failure
+bool gu_dds_write(const char *filename, const gu_dds_info& info, const std::vector<uint8_t>& data);
@@ -0,0 +1,167 @@
+
+//
+// GUImageDecoder.cpp
+//
+
+#include <stdafx.h>
+#include <GUImageDecoder.h>
+#include <GUPNGReader.h>
+#include <GUJPEGReader.h>
+#include <GUBMPFile.h>
+#include <GUTIFFReader.h>
+#include <cstring>
+#include <fstream>
+
+using namespace std;
+
+
+gu_image_format gu_image_detect(const uint8_t *data, size_t size) {
+
+	static const uint8_t pngSignature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+
+	if (size >= 8 && memcmp(data, pngSignature, 8) == 0)
+		return gu_image_png;
+
+	if (size >= 3 && data[0] == 0xFF && data[1] == 0xD8 && data[2] == 0xFF)
+		return gu_image_jpeg;
+
+	if (size >= 4 && memcmp(data, "DDS ", 4) == 0)
+		return gu_image_dds;
+
+	if (size >= 4 && ((data[0] == 'I' && data[1] == 'I' && data[2] == 42 && data[3] == 0) || (data[0] == 'M' && data[1] == 'M' && data[2] == 0 && data[3] == 42)))
+		return gu_image_tiff;
+
+	if (size >= 2 && data[0] == 'B' && data[1] == 'M')
+		return gu_image_bmp;
+
+	return gu_image_unknown;
+}
+
+
+gu_image_format gu_image_detect_file(const char *filename) {
+
+	ifstream file(filename, ios::in | ios::binary);
+	uint8_t header[8];
+
+	if (!file.is_open())
+		return gu_image_unknown;
+
+	file.read((char*)header, sizeof(header));
+
+	return gu_image_detect(header, (size_t)file.gcount());
+}
+
+
+const char* gu_image_format_name(gu_image_format format) {
+
+	switch (format) {
+
+		case gu_image_png:
+			return "PNG";
+
+		case gu_image_jpeg:
+			return "JPEG";
+
+		case gu_image_bmp:
+			return "BMP";
+
+		case gu_image_tiff:
+			return "TIFF";
+
+		case gu_image_dds:
+			return "DDS";
+
+		default:
+			return "unknown";
+	}
+}
+
+
+bool gu_image_decode(const uint8_t *data, size_t size, gu_image& image) {
+
+	image.format = gu_image_detect(data, size);
+
+	bool decoded = false;
+
+	switch (image.format) {
+
+		case gu_image_png:
+			decoded = gu_png_decode(data, size, image.width, image.height, image.pixels);
+			break;
+
+		case gu_image_jpeg:
+			decoded = gu_jpeg_decode(data, size, image.width, image.height, image.pixels);
+			break;
+
+		case gu_image_bmp:
+			decoded = gu_bmp_decode(data, size, image.width, image.height, image.pixels);
+			break;
+
+		case gu_image_tiff:
+			decoded = gu_tiff_decode(data, size, image.width, image.height, image.pixels);
+			break;
+
+		case gu_image_dds: {
+
+			if (!gu_dds_parse_info(data, size, image.dds))
+				break;
+
+			size_t surfaceBytes = gu_dds_mip_offset(image.dds, image.dds.mipCount) * image.dds.arraySize;
+
+			if (image.dds.dataOffset + surfaceBytes > size)
+				break;
+
+			image.width = image.dds.width;
+			image.height = image.dds.height;
+			image.pixels.assign(data + image.dds.dataOffset, data + image.dds.dataOffset + surfaceBytes);
+			decoded = true;
+			break;
+		}
+
+		default:
+			break;
+	}
+
+	return decoded;
+}
+
+
+bool gu_image_read_file(const char *filename, vector<uint8_t>& data) {
+
+	ifstream file(filename, ios::in | ios::binary | ios::ate);
+
+	if (!file.is_open())
+		return false;
+
+	streamoff size = file.tellg();
+
+	data.resize((size_t)size);
+	file.seekg(0);
+
+	return size == 0 || (bool)file.read((char*)data.data(), size);
+}
+
+
+bool gu_image_read_rgba(const char *filename, uint32_t& width, uint32_t& height, vector<uint8_t>& rgba) {
+
+	vector<uint8_t> data;
+	gu_image image;
+
+	if (!gu_image_read_file(filename, data)) {
+
+		cout << "Cannot open image file " << filename << endl;
+		return false;
+	}
+
+	if (!gu_image_decode(data.data(), data.size(), image) || image.format == gu_image_dds) {
+
+		cout << filename << " is not a supported image file (" << gu_image_format_name(image.format) << ")\n";
+		return false;
+	}
+
+	width = image.width;
+	height = image.height;
+	rgba.swap(image.pixels);
+
+	return true;
+}
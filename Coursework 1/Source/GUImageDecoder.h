@@ -0,0 +1,53 @@
+//
+// GUImageDecoder.h
+//
+
+// Portable image decoding.  The format of a file is identified by its leading (magic) bytes rather than its name so ".jpeg", upper case extensions or misnamed files load correctly.  PNG, JPEG, BMP and TIFF files are decoded to RGBA8 (see GUPNGReader, GUJPEGReader, GUBMPFile and GUTIFFReader) and DDS files are parsed and kept in their stored format (all surfaces and mips) so they can be handed to the device directly.  There is no Windows dependency so images can be decoded on any thread (see CGDImageLoader).
+
+#pragma once
+
+#include <GUDDSFile.h>
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+
+typedef enum {
+
+	gu_image_unknown = 0,
+	gu_image_png,
+	gu_image_jpeg,
+	gu_image_bmp,
+	gu_image_tiff,
+	gu_image_dds
+
+} gu_image_format;
+
+
+// A decoded image.  pixels holds width x height RGBA8 texels (top row first) or, for DDS files, the surface data described by dds
+struct gu_image {
+
+	gu_image_format			format = gu_image_unknown;
+	uint32_t				width = 0;
+	uint32_t				height = 0;
+	gu_dds_info				dds;
+	std::vector<uint8_t>	pixels;
+};
+
+
+// Identify a file from its first size bytes (at least 8 are needed)
+gu_image_format gu_image_detect(const uint8_t *data, size_t size);
+
+// Identify filename from its first bytes.  Return gu_image_unknown if the file cannot be read
+gu_image_format gu_image_detect_file(const char *filename);
+
+const char* gu_image_format_name(gu_image_format format);
+
+// Decode a file in memory into image.  image.pixels is reused so decoding into the same gu_image repeatedly does not reallocate.  Return false if the format is not recognised or the file is corrupt / uses an unsupported feature
+bool gu_image_decode(const uint8_t *data, size_t size, gu_image& image);
+
+// Read filename into data (reusing its storage).  Return false if the file cannot be read
+bool gu_image_read_file(const char *filename, std::vector<uint8_t>& data);
+
+// Read and decode a PNG, JPEG, BMP or TIFF file to RGBA8.  Return false (and report why) if the file cannot be read or decoded or is a DDS file
+bool gu_image_read_rgba(const char *filename, uint32_t& width, uint32_t& height, std::vector<uint8_t>& rgba);
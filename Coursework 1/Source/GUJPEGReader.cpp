@@ -0,0 +1,898 @@
+
+//
+// GUJPEGReader.cpp
+//
+
+#include <stdafx.h>
+#include <GUJPEGReader.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using namespace std;
+
+
+// Natural (row-major) position of the k'th coefficient in zigzag order
+static const uint8_t			zigzag[64] = { 0, 1, 8, 16, 9, 2, 3, 10, 17, 24, 32, 25, 18, 11, 4, 5, 12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13, 6, 7, 14, 21, 28, 35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51, 58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63 };
+
+// Huffman codes up to fastBits long are decoded with a single table lookup
+static const uint32_t			fastBits = 9;
+
+static const uint32_t			maxComponents = 3;
+
+// Larger images are rejected rather than allocated (D3D11 textures are limited to 16384 texels a side)
+static const uint32_t			maxDimension = 16384;
+
+
+// IDCT basis - basis[x][u] = C(u) / 2 * cos((2x + 1) u pi / 16) with C(0) = 1 / sqrt(2) and C(u) = 1 otherwise
+struct IDCTBasis {
+
+	float			basis[8][8];
+
+	IDCTBasis() {
+
+		for (int x = 0; x < 8; x++) {
+
+			for (int u = 0; u < 8; u++)
+				basis[x][u] = (float)(((u == 0) ? sqrt(0.5) : 1.0) * 0.5 * cos((2 * x + 1) * u * 3.14159265358979323846 / 16.0));
+		}
+	}
+};
+
+static const IDCTBasis			idct;
+
+
+struct HuffmanTable {
+
+	uint8_t				fastLength[1 << fastBits]; // 0 if the code is longer than fastBits
+	uint8_t				fastSymbol[1 << fastBits];
+	int					maxCode[17]; // largest code of each length (-1 if there are none)
+	int					valueOffset[17]; // index in values of a code of each length minus the code
+	uint8_t				values[256];
+};
+
+
+struct Component {
+
+	uint32_t			id;
+	uint32_t			h;
+	uint32_t			v;
+	uint32_t			quant;
+	uint32_t			blocksX; // allocated blocks (whole MCUs)
+	uint32_t			blocksY;
+	uint32_t			width; // samples covered by the image
+	uint32_t			height;
+	uint32_t			dcTable = 0;
+	uint32_t			acTable = 0;
+	int					dcPredictor = 0;
+	std::vector<int16_t> coefficients; // 64 per block in natural order
+	std::vector<uint8_t> plane; // blocksX * 8 samples per row
+};
+
+
+// MSB-first entropy coded data.  Stuffed zero bytes after 0xFF are removed and zero bits are returned once a marker is reached
+struct BitReader {
+
+	const uint8_t		*p = nullptr;
+	const uint8_t		*end = nullptr;
+	uint32_t			bits = 0;
+	int					count = 0;
+	bool				marker = false;
+
+	void reset(const uint8_t *_p, const uint8_t *_end) {
+
+		p = _p;
+		end = _end;
+		bits = 0;
+		count = 0;
+		marker = false;
+	}
+
+	void fill() {
+
+		while (count <= 24) {
+
+			uint32_t byte = 0;
+
+			if (!marker && p < end) {
+
+				if (*p != 0xFF) {
+
+					byte = *p++;
+
+				} else if (p + 1 < end && p[1] == 0x00) {
+
+					byte = 0xFF;
+					p += 2;
+
+				} else {
+
+					marker = true;
+				}
+			}
+
+			bits |= byte << (24 - count);
+			count += 8;
+		}
+	}
+
+	// n <= 16
+	uint32_t get(uint32_t n) {
+
+		if (n == 0)
+			return 0;
+
+		fill();
+
+		uint32_t value = bits >> (32 - n);
+
+		bits <<= n;
+		count -= n;
+
+		return value;
+	}
+};
+
+
+// Sign extend an n bit magnitude category value
+static inline int extend(uint32_t value, uint32_t n) {
+
+	return (n == 0) ? 0 : (value < (1u << (n - 1))) ? (int)value - (1 << n) + 1 : (int)value;
+}
+
+
+static void buildTable(const uint8_t counts[16], const uint8_t *values, uint32_t numValues, HuffmanTable& table) {
+
+	int code = 0, k = 0;
+
+	memset(table.fastLength, 0, sizeof(table.fastLength));
+	memcpy(table.values, values, numValues);
+
+	for (uint32_t len = 1; len <= 16; len++) {
+
+		table.valueOffset[len] = k - code;
+		table.maxCode[len] = (counts[len - 1]) ? code + counts[len - 1] - 1 : -1;
+
+		for (uint32_t i = 0; i < counts[len - 1]; i++, code++, k++) {
+
+			// Codes longer than fastBits or beyond an over-subscribed table's range are left to the slow path
+			if (len > fastBits || (uint32_t)code >= (1u << len))
+				continue;
+
+			uint32_t first = (uint32_t)code << (fastBits - len);
+
+			for (uint32_t j = 0; j < (1u << (fastBits - len)); j++) {
+
+				table.fastLength[first + j] = (uint8_t)len;
+				table.fastSymbol[first + j] = values[k];
+			}
+		}
+
+		code <<= 1;
+	}
+}
+
+
+// Decode one Huffman symbol.  Return -1 for an invalid code
+static int decodeSymbol(BitReader& reader, const HuffmanTable& table) {
+
+	reader.fill();
+
+	uint32_t look = reader.bits >> (32 - fastBits);
+	uint32_t length = table.fastLength[look];
+
+	if (length) {
+
+		reader.bits <<= length;
+		reader.count -= length;
+
+		return table.fastSymbol[look];
+	}
+
+	for (uint32_t len = fastBits + 1; len <= 16; len++) {
+
+		int code = (int)(reader.bits >> (32 - len));
+
+		if (code <= table.maxCode[len]) {
+
+			reader.bits <<= len;
+			reader.count -= len;
+
+			return table.values[table.valueOffset[len] + code];
+		}
+	}
+
+	return -1;
+}
+
+
+struct Decoder {
+
+	HuffmanTable		dcTables[4];
+	HuffmanTable		acTables[4];
+	uint16_t			quant[4][64]; // natural order
+	Component			components[maxComponents];
+	uint32_t			componentCount = 0;
+	uint32_t			width = 0;
+	uint32_t			height = 0;
+	uint32_t			hMax = 1;
+	uint32_t			vMax = 1;
+	uint32_t			mcusX = 0;
+	uint32_t			mcusY = 0;
+	bool				progressive = false;
+	bool				frame = false;
+	uint32_t			restartInterval = 0;
+	int					adobeTransform = -1; // APP14 colour transform (-1 if there is no Adobe marker)
+	BitReader			reader;
+
+	// Scan parameters
+	uint32_t			spectralStart = 0;
+	uint32_t			spectralEnd = 63;
+	uint32_t			approxHigh = 0;
+	uint32_t			approxLow = 0;
+	uint32_t			eobRun = 0;
+};
+
+
+// Sequential (baseline) block
+static bool decodeBlock(Decoder& d, Component& c, int16_t *block) {
+
+	int t = decodeSymbol(d.reader, d.dcTables[c.dcTable]);
+
+	if (t < 0 || t > 16)
+		return false;
+
+	c.dcPredictor += extend(d.reader.get(t), t);
+	block[0] = (int16_t)c.dcPredictor;
+
+	for (uint32_t k = 1; k < 64;) {
+
+		int rs = decodeSymbol(d.reader, d.acTables[c.acTable]);
+
+		if (rs < 0)
+			return false;
+
+		uint32_t r = rs >> 4, s = rs & 15;
+
+		if (s == 0) {
+
+			if (r != 15)
+				break;
+
+			k += 16;
+			continue;
+		}
+
+		k += r;
+
+		if (k > 63)
+			return false;
+
+		block[zigzag[k++]] = (int16_t)extend(d.reader.get(s), s);
+	}
+
+	return true;
+}
+
+
+// Progressive DC scan (first pass or refinement)
+static bool decodeBlockDC(Decoder& d, Component& c, int16_t *block) {
+
+	if (d.approxHigh == 0) {
+
+		int t = decodeSymbol(d.reader, d.dcTables[c.dcTable]);
+
+		if (t < 0 || t > 16)
+			return false;
+
+		c.dcPredictor += extend(d.reader.get(t), t);
+		block[0] = (int16_t)(c.dcPredictor * (1 << d.approxLow));
+
+	} else if (d.reader.get(1)) {
+
+		block[0] |= (int16_t)(1 << d.approxLow);
+	}
+
+	return true;
+}
+
+
+// Progressive AC scan - first pass (G.1.2.2 of the JPEG specification)
+static bool decodeBlockACFirst(Decoder& d, Component& c, int16_t *block) {
+
+	if (d.eobRun > 0) {
+
+		d.eobRun--;
+		return true;
+	}
+
+	for (uint32_t k = d.spectralStart; k <= d.spectralEnd;) {
+
+		int rs = decodeSymbol(d.reader, d.acTables[c.acTable]);
+
+		if (rs < 0)
+			return false;
+
+		uint32_t r = rs >> 4, s = rs & 15;
+
+		if (s == 0) {
+
+			if (r < 15) {
+
+				d.eobRun = (1u << r) - 1 + d.reader.get(r);
+				break;
+			}
+
+			k += 16;
+			continue;
+		}
+
+		k += r;
+
+		if (k > 63)
+			return false;
+
+		block[zigzag[k++]] = (int16_t)(extend(d.reader.get(s), s) * (1 << d.approxLow));
+	}
+
+	return true;
+}
+
+
+// Progressive AC scan - refinement (G.1.2.3).  Coefficients that are already non-zero receive a correction bit and zero runs skip only zero coefficients
+static bool decodeBlockACRefine(Decoder& d, Component& c, int16_t *block) {
+
+	int p1 = 1 << d.approxLow, m1 = -p1;
+	uint32_t k = d.spectralStart;
+
+	auto refine = [&](int16_t& coefficient) {
+
+		if (d.reader.get(1) && (coefficient & p1) == 0)
+			coefficient = (int16_t)(coefficient + ((coefficient >= 0) ? p1 : m1));
+	};
+
+	if (d.eobRun == 0) {
+
+		for (; k <= d.spectralEnd; k++) {
+
+			int rs = decodeSymbol(d.reader, d.acTables[c.acTable]);
+
+			if (rs < 0)
+				return false;
+
+			int r = rs >> 4, s = rs & 15, value = 0;
+
+			if (s) {
+
+				value = (d.reader.get(1)) ? p1 : m1;
+
+			} else if (r != 15) {
+
+				d.eobRun = (1u << r) + d.reader.get(r);
+				break;
+			}
+
+			// Skip r zero coefficients (refining the non-zero ones passed over) and place value in the next zero coefficient
+			for (; k <= d.spectralEnd; k++) {
+
+				int16_t& coefficient = block[zigzag[k]];
+
+				if (coefficient != 0)
+					refine(coefficient);
+				else if (--r < 0)
+					break;
+			}
+
+			if (value && k <= d.spectralEnd)
+				block[zigzag[k]] = (int16_t)value;
+		}
+	}
+
+	if (d.eobRun > 0) {
+
+		for (; k <= d.spectralEnd; k++) {
+
+			if (block[zigzag[k]] != 0)
+				refine(block[zigzag[k]]);
+		}
+
+		d.eobRun--;
+	}
+
+	return true;
+}
+
+
+static bool decodeBlockInScan(Decoder& d, Component& c, uint32_t bx, uint32_t by) {
+
+	int16_t *block = c.coefficients.data() + ((size_t)by * c.blocksX + bx) * 64;
+
+	if (!d.progressive)
+		return decodeBlock(d, c, block);
+
+	if (d.spectralStart == 0)
+		return decodeBlockDC(d, c, block);
+
+	return (d.approxHigh == 0) ? decodeBlockACFirst(d, c, block) : decodeBlockACRefine(d, c, block);
+}
+
+
+// Move past the next RSTn marker and reset the decoder state
+static void restart(Decoder& d, const uint8_t *end) {
+
+	const uint8_t *p = d.reader.p;
+
+	while (p + 1 < end && !(p[0] == 0xFF && p[1] >= 0xD0 && p[1] <= 0xD7))
+		p++;
+
+	d.reader.reset(min(p + 2, end), end);
+	d.eobRun = 0;
+
+	for (uint32_t i = 0; i < d.componentCount; i++)
+		d.components[i].dcPredictor = 0;
+}
+
+
+// Decode the scan whose header starts at sos (after the length field).  Return the end of the entropy coded data
+static const uint8_t* decodeScan(Decoder& d, const uint8_t *sos, uint32_t length, const uint8_t *end) {
+
+	uint32_t count = sos[0];
+	Component *scan[maxComponents];
+
+	if (!d.frame || count == 0 || count > d.componentCount || length < 4 + count * 2)
+		return nullptr;
+
+	for (uint32_t i = 0; i < count; i++) {
+
+		uint32_t id = sos[1 + i * 2], tables = sos[2 + i * 2];
+
+		scan[i] = nullptr;
+
+		for (uint32_t j = 0; j < d.componentCount; j++) {
+
+			if (d.components[j].id == id)
+				scan[i] = d.components + j;
+		}
+
+		if (!scan[i])
+			return nullptr;
+
+		scan[i]->dcTable = (tables >> 4) & 3;
+		scan[i]->acTable = tables & 3;
+	}
+
+	const uint8_t *parameters = sos + 1 + count * 2;
+
+	d.spectralStart = parameters[0];
+	d.spectralEnd = parameters[1];
+	d.approxHigh = parameters[2] >> 4;
+	d.approxLow = parameters[2] & 15;
+
+	if (d.progressive && (d.spectralEnd > 63 || d.spectralStart > d.spectralEnd || (d.spectralStart > 0 && count != 1)))
+		return nullptr;
+
+	if (!d.progressive) {
+
+		d.spectralStart = 0;
+		d.spectralEnd = 63;
+	}
+
+	d.reader.reset(sos + length - 2, end);
+	d.eobRun = 0;
+
+	for (uint32_t i = 0; i < d.componentCount; i++)
+		d.components[i].dcPredictor = 0;
+
+	uint32_t restartsToGo = d.restartInterval;
+
+	if (count == 1) {
+
+		// Non-interleaved - one block per MCU over the blocks covered by the image
+		Component& c = *scan[0];
+		uint32_t blocksX = (c.width + 7) / 8, blocksY = (c.height + 7) / 8;
+
+		for (uint32_t by = 0; by < blocksY; by++) {
+
+			for (uint32_t bx = 0; bx < blocksX; bx++) {
+
+				if (!decodeBlockInScan(d, c, bx, by))
+					return nullptr;
+
+				if (d.restartInterval && --restartsToGo == 0 && (by + 1 < blocksY || bx + 1 < blocksX)) {
+
+					restart(d, end);
+					restartsToGo = d.restartInterval;
+				}
+			}
+		}
+
+	} else {
+
+		for (uint32_t my = 0; my < d.mcusY; my++) {
+
+			for (uint32_t mx = 0; mx < d.mcusX; mx++) {
+
+				for (uint32_t i = 0; i < count; i++) {
+
+					Component& c = *scan[i];
+
+					for (uint32_t v = 0; v < c.v; v++) {
+
+						for (uint32_t h = 0; h < c.h; h++) {
+
+							if (!decodeBlockInScan(d, c, mx * c.h + h, my * c.v + v))
+								return nullptr;
+						}
+					}
+				}
+
+				if (d.restartInterval && --restartsToGo == 0 && (my + 1 < d.mcusY || mx + 1 < d.mcusX)) {
+
+					restart(d, end);
+					restartsToGo = d.restartInterval;
+				}
+			}
+		}
+	}
+
+	return d.reader.p;
+}
+
+
+static bool readFrame(Decoder& d, const uint8_t *sof, uint32_t length) {
+
+	if (d.frame || length < 8 || sof[0] != 8)
+		return false;
+
+	d.height = (sof[1] << 8) | sof[2];
+	d.width = (sof[3] << 8) | sof[4];
+	d.componentCount = sof[5];
+
+	if (d.width == 0 || d.height == 0 || d.width > maxDimension || d.height > maxDimension || (d.componentCount != 1 && d.componentCount != 3) || length < 8 + d.componentCount * 3)
+		return false;
+
+	for (uint32_t i = 0; i < d.componentCount; i++) {
+
+		Component& c = d.components[i];
+
+		c.id = sof[6 + i * 3];
+		c.h = sof[7 + i * 3] >> 4;
+		c.v = sof[7 + i * 3] & 15;
+		c.quant = sof[8 + i * 3] & 3;
+
+		if (c.h < 1 || c.h > 4 || c.v < 1 || c.v > 4)
+			return false;
+
+		d.hMax = max(d.hMax, c.h);
+		d.vMax = max(d.vMax, c.v);
+	}
+
+	d.mcusX = (d.width + 8 * d.hMax - 1) / (8 * d.hMax);
+	d.mcusY = (d.height + 8 * d.vMax - 1) / (8 * d.vMax);
+
+	for (uint32_t i = 0; i < d.componentCount; i++) {
+
+		Component& c = d.components[i];
+
+		c.blocksX = d.mcusX * c.h;
+		c.blocksY = d.mcusY * c.v;
+		c.width = (d.width * c.h + d.hMax - 1) / d.hMax;
+		c.height = (d.height * c.v + d.vMax - 1) / d.vMax;
+		c.coefficients.assign((size_t)c.blocksX * c.blocksY * 64, 0);
+	}
+
+	d.frame = true;
+
+	return true;
+}
+
+
+// Dequantise and inverse transform every block of c into c.plane
+static void transformComponent(const Decoder& d, Component& c) {
+
+	const uint16_t *q = d.quant[c.quant];
+	size_t stride = (size_t)c.blocksX * 8;
+
+	c.plane.resize(stride * c.blocksY * 8);
+
+	for (uint32_t by = 0; by < c.blocksY; by++) {
+
+		for (uint32_t bx = 0; bx < c.blocksX; bx++) {
+
+			const int16_t *block = c.coefficients.data() + ((size_t)by * c.blocksX + bx) * 64;
+			float rows[8][8]; // rows[v][x] - horizontal transform of frequency row v
+			int lastRow = -1;
+
+			for (int v = 0; v < 8; v++) {
+
+				const int16_t *f = block + v * 8;
+				bool ac = false;
+
+				for (int u = 1; u < 8; u++)
+					ac = ac || f[u] != 0;
+
+				if (!ac && f[0] == 0) {
+
+					memset(rows[v], 0, sizeof(rows[v]));
+					continue;
+				}
+
+				lastRow = v;
+
+				if (!ac) {
+
+					float value = f[0] * q[v * 8] * idct.basis[0][0];
+
+					for (int x = 0; x < 8; x++)
+						rows[v][x] = value;
+
+					continue;
+				}
+
+				float coefficients[8];
+
+				for (int u = 0; u < 8; u++)
+					coefficients[u] = (float)(f[u] * q[v * 8 + u]);
+
+				for (int x = 0; x < 8; x++) {
+
+					float sum = 0.0f;
+
+					for (int u = 0; u < 8; u++)
+						sum += coefficients[u] * idct.basis[x][u];
+
+					rows[v][x] = sum;
+				}
+			}
+
+			uint8_t *out = c.plane.data() + (size_t)by * 8 * stride + bx * 8;
+
+			for (int y = 0; y < 8; y++, out += stride) {
+
+				for (int x = 0; x < 8; x++) {
+
+					float sum = 128.0f;
+
+					for (int v = 0; v <= lastRow; v++)
+						sum += rows[v][x] * idct.basis[y][v];
+
+					out[x] = (uint8_t)min(max((int)floorf(sum + 0.5f), 0), 255);
+				}
+			}
+		}
+	}
+}
+
+
+// Upsample component c to image resolution (bilinear, sample centres aligned as in JFIF) and write it to channel of each row of dst
+static void upsampleComponent(const Decoder& d, const Component& c, vector<uint8_t>& dst, uint32_t channel) {
+
+	size_t stride = (size_t)c.blocksX * 8;
+
+	if (c.h == d.hMax && c.v == d.vMax) {
+
+		for (uint32_t y = 0; y < d.height; y++) {
+
+			const uint8_t *src = c.plane.data() + y * stride;
+			uint8_t *out = dst.data() + (size_t)y * d.width * 4 + channel;
+
+			for (uint32_t x = 0; x < d.width; x++)
+				out[x * 4] = src[x];
+		}
+
+		return;
+	}
+
+	float scaleX = (float)c.h / d.hMax, scaleY = (float)c.v / d.vMax;
+	vector<uint32_t> x0(d.width), x1(d.width);
+	vector<float> wx(d.width);
+
+	for (uint32_t x = 0; x < d.width; x++) {
+
+		float fx = max((x + 0.5f) * scaleX - 0.5f, 0.0f);
+
+		x0[x] = min((uint32_t)fx, c.width - 1);
+		x1[x] = min(x0[x] + 1, c.width - 1);
+		wx[x] = fx - (float)(uint32_t)fx;
+	}
+
+	for (uint32_t y = 0; y < d.height; y++) {
+
+		float fy = max((y + 0.5f) * scaleY - 0.5f, 0.0f);
+		uint32_t y0 = min((uint32_t)fy, c.height - 1), y1 = min(y0 + 1, c.height - 1);
+		float wy = fy - (float)(uint32_t)fy;
+
+		const uint8_t *row0 = c.plane.data() + y0 * stride;
+		const uint8_t *row1 = c.plane.data() + y1 * stride;
+		uint8_t *out = dst.data() + (size_t)y * d.width * 4 + channel;
+
+		for (uint32_t x = 0; x < d.width; x++) {
+
+			float top = row0[x0[x]] + (row0[x1[x]] - row0[x0[x]]) * wx[x];
+			float bottom = row1[x0[x]] + (row1[x1[x]] - row1[x0[x]]) * wx[x];
+
+			out[x * 4] = (uint8_t)(top + (bottom - top) * wy + 0.5f);
+		}
+	}
+}
+
+
+static inline uint8_t clamp8(float x) {
+
+	return (uint8_t)min(max((int)floorf(x + 0.5f), 0), 255);
+}
+
+
+bool gu_jpeg_decode(const uint8_t *data, size_t size, uint32_t& width, uint32_t& height, vector<uint8_t>& rgba) {
+
+	if (size < 4 || data[0] != 0xFF || data[1] != 0xD8)
+		return false;
+
+	Decoder d;
+	const uint8_t *p = data + 2, *end = data + size;
+	bool complete = false;
+	uint32_t scans = 0;
+
+	// Scans that reference tables the file never defines decode garbage rather than reading uninitialised memory
+	memset(d.quant, 0, sizeof(d.quant));
+	memset(d.dcTables, 0, sizeof(d.dcTables));
+	memset(d.acTables, 0, sizeof(d.acTables));
+
+	while (p + 4 <= end && !complete) {
+
+		// Find the next marker (skipping fill bytes)
+		if (*p != 0xFF) {
+
+			p++;
+			continue;
+		}
+
+		uint8_t marker = p[1];
+
+		if (marker == 0xFF || marker == 0x00 || (marker >= 0xD0 && marker <= 0xD7)) {
+
+			p++;
+			continue;
+		}
+
+		if (marker == 0xD9) {
+
+			complete = true;
+			break;
+		}
+
+		uint32_t length = (p[2] << 8) | p[3];
+		const uint8_t *segment = p + 4;
+
+		if (length < 2 || segment + length - 2 > end)
+			return false;
+
+		switch (marker) {
+
+			case 0xC0:
+			case 0xC1:
+			case 0xC2:
+				d.progressive = marker == 0xC2;
+
+				if (!readFrame(d, segment, length))
+					return false;
+
+				break;
+
+			case 0xC4: {
+
+				// DHT - one or more tables
+				const uint8_t *t = segment, *tEnd = segment + length - 2;
+
+				while (t + 17 <= tEnd) {
+
+					uint32_t tableClass = t[0] >> 4, index = t[0] & 3, total = 0;
+
+					for (uint32_t i = 0; i < 16; i++)
+						total += t[1 + i];
+
+					if (tableClass > 1 || total > 256 || t + 17 + total > tEnd)
+						return false;
+
+					buildTable(t + 1, t + 17, total, (tableClass == 0) ? d.dcTables[index] : d.acTables[index]);
+					t += 17 + total;
+				}
+
+				break;
+			}
+
+			case 0xDB: {
+
+				// DQT - one or more tables of 8 or 16-bit values in zigzag order
+				const uint8_t *t = segment, *tEnd = segment + length - 2;
+
+				while (t < tEnd) {
+
+					uint32_t precision = t[0] >> 4, index = t[0] & 3;
+
+					if (t + 1 + 64 * (precision + 1) > tEnd)
+						return false;
+
+					for (uint32_t k = 0; k < 64; k++)
+						d.quant[index][zigzag[k]] = (uint16_t)((precision) ? (t[1 + k * 2] << 8) | t[2 + k * 2] : t[1 + k]);
+
+					t += 1 + 64 * (precision + 1);
+				}
+
+				break;
+			}
+
+			case 0xDD:
+				if (length < 4)
+					return false;
+
+				d.restartInterval = (segment[0] << 8) | segment[1];
+				break;
+
+			case 0xEE:
+				if (length >= 14 && memcmp(segment, "Adobe", 5) == 0)
+					d.adobeTransform = segment[11];
+
+				break;
+
+			case 0xDA: {
+
+				const uint8_t *next = decodeScan(d, segment, length, end);
+
+				if (!next)
+					return false;
+
+				scans++;
+				p = next;
+				continue;
+			}
+
+			default:
+				// Other SOF markers (lossless, hierarchical, arithmetic coding) are not supported
+				if (marker >= 0xC3 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC)
+					return false;
+
+				break;
+		}
+
+		p = segment + length - 2;
+	}
+
+	// Truncated files decode whatever scans were complete
+	if (!d.frame || scans == 0)
+		return false;
+
+	width = d.width;
+	height = d.height;
+	rgba.resize((size_t)width * height * 4);
+
+	for (uint32_t i = 0; i < d.componentCount; i++) {
+
+		transformComponent(d, d.components[i]);
+		upsampleComponent(d, d.components[i], rgba, (d.componentCount == 1) ? 0 : i);
+	}
+
+	bool rgb = d.componentCount == 3 && (d.adobeTransform == 0 || (d.components[0].id == 'R' && d.components[1].id == 'G' && d.components[2].id == 'B'));
+
+	for (size_t i = 0; i < (size_t)width * height; i++) {
+
+		uint8_t *t = rgba.data() + i * 4;
+
+		if (d.componentCount == 1) {
+
+			t[1] = t[2] = t[0];
+
+		} else if (!rgb) {
+
+			float y = t[0], cb = t[1] - 128.0f, cr = t[2] - 128.0f;
+
+			t[0] = clamp8(y + 1.402f * cr);
+			t[1] = clamp8(y - 0.344136f * cb - 0.714136f * cr);
+			t[2] = clamp8(y + 1.772f * cb);
+		}
+
+		t[3] = 255;
+	}
+
+	return true;
+}
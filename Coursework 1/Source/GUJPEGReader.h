@@ -0,0 +1,15 @@
+//
+// GUJPEGReader.h
+//
+
+// Self-contained JPEG decoder for the portable image decoder (see GUImageDecoder).  Supports baseline and progressive Huffman coded JPEG/JFIF files with 8-bit precision, 1 (greyscale) or 3 (YCbCr) components, any sampling factors and restart intervals.  Every scan is decoded into per-component DCT coefficients, which are then dequantised and transformed (separable IDCT that skips columns with no AC energy), upsampled (bilinear, with sample centres placed as in JFIF) and converted to RGB.  Arithmetic coded, lossless, 12-bit and CMYK files are rejected.
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+
+// Decode a JPEG file in memory (size bytes) into rgba (width * 4 bytes per row, top row first, alpha 255).  Return false if data is not a supported JPEG file or is corrupt
+bool gu_jpeg_decode(const uint8_t *data, size_t size, uint32_t& width, uint32_t& height, std::vector<uint8_t>& rgba);
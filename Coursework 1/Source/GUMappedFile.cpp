@@ -0,0 +1,137 @@
+
+//
+// GUMappedFile.cpp
+//
+
+#include <stdafx.h>
+#include <GUMappedFile.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+using namespace std;
+
+
+
+//
+// Private interface
+//
+
+// Constructor - called internally by the CreateMappedFile factory method
+GUMappedFile::GUMappedFile() {
+}
+
+
+
+//
+// Public interface
+//
+
+// Factory method
+GUMappedFile* GUMappedFile::CreateMappedFile(const char *path) {
+
+	if (!path)
+		return nullptr;
+
+	GUMappedFile *file = new GUMappedFile();
+
+#ifdef _WIN32
+
+	HANDLE fileHandle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+
+	if (fileHandle == INVALID_HANDLE_VALUE) {
+
+		file->release();
+		return nullptr;
+	}
+
+	file->fileHandle = fileHandle;
+
+	LARGE_INTEGER fileSize;
+
+	if (!GetFileSizeEx(fileHandle, &fileSize) || fileSize.QuadPart == 0 || (uint64_t)fileSize.QuadPart > (uint64_t)SIZE_MAX) {
+
+		file->release();
+		return nullptr;
+	}
+
+	file->mappingHandle = CreateFileMappingA(fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+
+	if (!file->mappingHandle) {
+
+		file->release();
+		return nullptr;
+	}
+
+	file->data = MapViewOfFile(file->mappingHandle, FILE_MAP_READ, 0, 0, 0);
+	file->size = (size_t)fileSize.QuadPart;
+
+#else
+
+	file->fd = open(path, O_RDONLY);
+
+	struct stat st;
+
+	if (file->fd < 0 || fstat(file->fd, &st) != 0 || st.st_size == 0) {
+
+		file->release();
+		return nullptr;
+	}
+
+	void *p = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, file->fd, 0);
+
+	file->data = (p != MAP_FAILED) ? p : nullptr;
+	file->size = (size_t)st.st_size;
+
+#endif
+
+	if (!file->data) {
+
+		file->release();
+		return nullptr;
+	}
+
+	return file;
+}
+
+
+// Destructor
+GUMappedFile::~GUMappedFile() {
+
+#ifdef _WIN32
+
+	if (data)
+		UnmapViewOfFile(data);
+
+	if (mappingHandle)
+		CloseHandle(mappingHandle);
+
+	if (fileHandle)
+		CloseHandle(fileHandle);
+
+#else
+
+	if (data)
+		munmap((void*)data, size);
+
+	if (fd >= 0)
+		close(fd);
+
+#endif
+}
+
+
+const void* GUMappedFile::getData() const {
+
+	return data;
+}
+
+
+size_t GUMappedFile::getSize() const {
+
+	return size;
+}
@@ -0,0 +1,49 @@
+//
+// GUMappedFile.h
+//
+
+// Read-only memory mapped file.  The file contents are mapped into the address space of the host process so no heap buffer is allocated and pages are only read from disk (or the OS file cache) when they are first touched.  The mapping remains valid for the lifetime of the GUMappedFile instance.
+
+#pragma once
+
+#include <GUObject.h>
+#include <cstddef>
+
+
+class GUMappedFile : public GUObject {
+
+	const void				*data = nullptr;
+	size_t					size = 0;
+
+#ifdef _WIN32
+	void					*fileHandle = nullptr;
+	void					*mappingHandle = nullptr;
+#else
+	int						fd = -1;
+#endif
+
+
+	//
+	// Private interface
+	//
+
+	// Constructor - called internally by the CreateMappedFile factory method
+	GUMappedFile();
+
+
+public:
+
+	//
+	// Public interface
+	//
+
+	// Factory method.  Map the file at path.  Return nullptr if the file cannot be opened or mapped (empty files cannot be mapped)
+	static GUMappedFile* CreateMappedFile(const char *path);
+
+	// Destructor
+	~GUMappedFile();
+
+	// Accessor methods
+	const void* getData() const;
+	size_t getSize() const;
+};
@@ -5,157 +5,542 @@
 
 #include <stdafx.h>
 #include <GUMemory.h>
+#include <CGDClock.h>
 #include <iostream>
+#include <cstring>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <algorithm>
+
+#ifdef _WIN32
+#include <DbgHelp.h>
+#pragma comment(lib, "dbghelp.lib")
+#elif defined(__GLIBC__)
+#include <execinfo.h>
+#endif
+
+
+// This module implements the tracking functions so always refers to the CRT allocation functions directly
+#undef malloc
+#undef calloc
+#undef free
+#undef _aligned_malloc
+#undef _aligned_free
 
 
 using namespace std;
 
 
+#ifndef _WIN32
+
+// The CRT aligned allocation functions are Windows only
+static void* _aligned_malloc(size_t size, size_t alignment) {
+
+	void *ptr = nullptr;
+
+	return (posix_memalign(&ptr, max(alignment, sizeof(void*)), size) == 0) ? ptr : nullptr;
+}
+
+static void _aligned_free(void *ptr) {
+
+	free(ptr);
+}
+
+#endif
+
+
+#ifdef _WIN32
+#define GU_THREAD_LOCAL		__declspec(thread)
+#define GU_CACHE_ALIGNED	__declspec(align(64))
+#else
+#define GU_THREAD_LOCAL		__thread
+#define GU_CACHE_ALIGNED	__attribute__((aligned(64)))
+#endif
+
+
+
 //
-// Memory allocation / free counters
+// Memory allocation counters
 //
 
-static unsigned long			total_malloc_calls = 0;
-static unsigned long			total_free_calls = 0;
+// Per-tag counters (padded so tags updated by different threads do not share a cache line).  The allocation / free counts share the cache line already updated for the live byte count so they add no further cache traffic, and the stats are read without taking any of the side table locks
+struct gu_tag_counters {
+
+	atomic<int64_t>			live_bytes;
+	atomic<int64_t>			peak_bytes;
+	atomic<uint64_t>		allocations;
+	atomic<uint64_t>		deallocations;
+	atomic<uint64_t>		bytes_allocated;
+
+	char					padding[64 - 5 * sizeof(int64_t)];
+};
+
+static GU_CACHE_ALIGNED gu_tag_counters	tag_counters[gu_mem_num_tags];
+
+static atomic<int64_t>			total_live_bytes;
+static atomic<int64_t>			total_peak_bytes;
+static atomic<uint64_t>			untracked_frees; // free calls on memory not allocated through GUMemory (eg. allocated by another module)
+
+// Legacy counter adjustments (see compensate_malloc_count / compensate_free_count)
+static atomic<unsigned long>	malloc_compensation;
+static atomic<unsigned long>	free_compensation;
+
+static atomic<bool>				stack_capture_enabled;
+
+static GU_THREAD_LOCAL int		current_tag = gu_mem_general;
+
+static const char				*tag_names[gu_mem_num_tags] = { "general", "scene", "mesh", "texture", "shader", "matrix", "particles", "profiler", "arena", "jobs" };
+
+// Allocation rates - updated by gu_memory_update_rates
+static mutex					rate_lock;
+static gu_time_index			rate_sample_time = 0;
+static uint64_t					rate_sample_allocations[gu_mem_num_tags];
+static uint64_t					rate_sample_bytes[gu_mem_num_tags];
+static double					allocation_rate[gu_mem_num_tags];
+static double					byte_rate[gu_mem_num_tags];
 
 
 
 //
-// Memory handling functions
+// Call stack table.  Captured stacks are interned so allocations made from the same call site share a single stack record.  Stack id 0 denotes no stack
 //
 
-void gu_memAssertFail(const char *ptrString, const char *fnString) {
+static const int				gu_stack_depth = 16;
+static const int				gu_stack_skip = 2; // skip captureStack and trackAllocation
 
-	cout << "gu_memAssert(" << ptrString << ") in function " << fnString << "() failed.  Aborting process.\n\n";
-	abort();
-}
+struct gu_stack_record {
 
+	uint64_t				hash;
+	uint32_t				depth;
+	void					*frames[gu_stack_depth];
+};
+
+static atomic<bool>				stack_table_lock;
+static gu_stack_record			*stack_records = nullptr; // stack id i is stack_records[i - 1]
+static uint32_t					num_stack_records = 0;
+static uint32_t					stack_records_capacity = 0;
+static uint32_t					*stack_index = nullptr; // open addressed hash table of stack ids
+static uint32_t					stack_index_capacity = 0;
 
 
 
 //
-// Memory tracking functions
+// Allocation side table.  Sharded on the pointer hash to reduce lock contention.  Each shard is an open addressed (linear probing) hash table allocated directly from the CRT
 //
 
+struct gu_alloc_record {
 
-void *gu_malloc(size_t memreq)
-{
-	void			*ptr;
+	void					*ptr; // nullptr denotes an empty slot
+	size_t					size;
+	uint32_t				stack;
+	uint8_t					tag;
+};
 
-#ifdef __GU_DEBUG_MEMORY__
-	// Avoid recursive call due to malloc = gu_malloc
-#undef malloc
+struct gu_alloc_shard_fields {
 
-	ptr = malloc(memreq);
+	atomic<bool>			lock;
+	gu_alloc_record			*records;
+	size_t					capacity;
+	size_t					count;
+};
 
-#define malloc gu_malloc
+// Shards are padded to a whole number of cache lines (computed from the size of all of the fields so neighbouring shards never share a cache line) and the shard table is cache line aligned
+struct gu_alloc_shard : public gu_alloc_shard_fields {
 
-#else
+	char					padding[64 - sizeof(gu_alloc_shard_fields) % 64];
+};
 
-	ptr = malloc(memreq);
+static_assert(sizeof(gu_alloc_shard) % 64 == 0, "gu_alloc_shard must be a whole number of cache lines");
 
-#endif
+static const int				gu_num_shards = 64;
+static const size_t				gu_initial_shard_capacity = 1024;
 
+static GU_CACHE_ALIGNED gu_alloc_shard	shards[gu_num_shards];
 
-	if (ptr)
-		total_malloc_calls++;
 
-	return ptr;
+
+//
+// Private helper functions
+//
+
+static void spinLock(atomic<bool>& lock) {
+
+	for (int spins = 0; lock.exchange(true, memory_order_acquire); spins++) {
+
+		if (spins >= 64)
+			this_thread::yield();
+	}
 }
 
 
-void *gu_calloc(size_t num, size_t size)
-{
-	void			*ptr;
+static void spinUnlock(atomic<bool>& lock) {
 
-#ifdef __GU_DEBUG_MEMORY__
-	// Avoid recursive call due to calloc = gu_calloc
-#undef calloc
+	lock.store(false, memory_order_release);
+}
 
-	ptr = calloc(num, size);
 
-#define calloc gu_calloc
+static uint64_t hashPointer(const void *ptr) {
 
-#else
+	uint64_t h = (uint64_t)(uintptr_t)ptr >> 4;
 
-	ptr = calloc(num, size);
+	return h * 0x9E3779B97F4A7C15ull;
+}
 
-#endif
 
+static void updatePeak(atomic<int64_t>& peak, int64_t value) {
 
-	if (ptr)
-		total_malloc_calls++;
+	int64_t p = peak.load(memory_order_relaxed);
 
-	return ptr;
+	while (value > p && !peak.compare_exchange_weak(p, value, memory_order_relaxed));
 }
 
 
-void* gu_aligned_malloc(size_t _Size, size_t _Alignment)
-{
-	void			*ptr;
+static void countAllocation(int tag, size_t size) {
 
-#ifdef __GU_DEBUG_MEMORY__
-	// Avoid recursive call due to _aligned_malloc = gu_aligned_malloc
-#undef _aligned_malloc
+	gu_tag_counters& c = tag_counters[tag];
 
-	ptr = _aligned_malloc(_Size, _Alignment);
+	c.allocations.fetch_add(1, memory_order_relaxed);
+	c.bytes_allocated.fetch_add(size, memory_order_relaxed);
 
-#define _aligned_malloc		gu_aligned_malloc
+	updatePeak(c.peak_bytes, c.live_bytes.fetch_add((int64_t)size, memory_order_relaxed) + (int64_t)size);
+	updatePeak(total_peak_bytes, total_live_bytes.fetch_add((int64_t)size, memory_order_relaxed) + (int64_t)size);
+}
 
-#else
 
-	ptr = _aligned_malloc(_Size, _Alignment);
+static void countDeallocation(int tag, size_t size) {
+
+	gu_tag_counters& c = tag_counters[tag];
+
+	c.deallocations.fetch_add(1, memory_order_relaxed);
+	c.live_bytes.fetch_sub((int64_t)size, memory_order_relaxed);
+	total_live_bytes.fetch_sub((int64_t)size, memory_order_relaxed);
+}
+
+
+// Capture the calling thread's stack and return the interned stack id (0 if the stack cannot be captured)
+static uint32_t captureStack() {
+
+	void *frames[gu_stack_depth + gu_stack_skip];
+	int depth = 0;
 
+#ifdef _WIN32
+	depth = CaptureStackBackTrace(gu_stack_skip, gu_stack_depth, frames, nullptr);
+#elif defined(__GLIBC__)
+	depth = backtrace(frames, gu_stack_depth + gu_stack_skip) - gu_stack_skip;
+
+	if (depth > 0)
+		memmove(frames, frames + gu_stack_skip, depth * sizeof(void*));
 #endif
 
-	if (ptr)
-		total_malloc_calls++;
+	if (depth <= 0)
+		return 0;
 
-	return ptr;
+	// FNV-1a hash of the return addresses
+	uint64_t hash = 14695981039346656037ull;
+
+	for (int i = 0; i < depth; i++) {
+
+		hash ^= (uint64_t)(uintptr_t)frames[i];
+		hash *= 1099511628211ull;
+	}
+
+	spinLock(stack_table_lock);
+
+	// Grow the index so it is at most half full
+	if ((num_stack_records + 1) * 2 > stack_index_capacity) {
+
+		uint32_t newCapacity = max<uint32_t>(1024, stack_index_capacity * 2);
+		uint32_t *newIndex = (uint32_t*)calloc(newCapacity, sizeof(uint32_t));
+
+		if (!newIndex) {
+
+			spinUnlock(stack_table_lock);
+			return 0;
+		}
+
+		for (uint32_t i = 0; i < stack_index_capacity; i++) {
+
+			uint32_t id = stack_index[i];
+
+			if (id) {
+
+				uint32_t j = (uint32_t)stack_records[id - 1].hash & (newCapacity - 1);
+
+				while (newIndex[j])
+					j = (j + 1) & (newCapacity - 1);
+
+				newIndex[j] = id;
+			}
+		}
+
+		free(stack_index);
+		stack_index = newIndex;
+		stack_index_capacity = newCapacity;
+	}
+
+	// Find an existing record for the stack
+	uint32_t j = (uint32_t)hash & (stack_index_capacity - 1);
+
+	for (; stack_index[j]; j = (j + 1) & (stack_index_capacity - 1)) {
+
+		gu_stack_record& r = stack_records[stack_index[j] - 1];
+
+		if (r.hash == hash && r.depth == (uint32_t)depth && memcmp(r.frames, frames, depth * sizeof(void*)) == 0) {
+
+			uint32_t id = stack_index[j];
+
+			spinUnlock(stack_table_lock);
+			return id;
+		}
+	}
+
+	// Add a new record
+	if (num_stack_records == stack_records_capacity) {
+
+		uint32_t newCapacity = max<uint32_t>(256, stack_records_capacity * 2);
+		gu_stack_record *newRecords = (gu_stack_record*)malloc(newCapacity * sizeof(gu_stack_record));
+
+		if (!newRecords) {
+
+			spinUnlock(stack_table_lock);
+			return 0;
+		}
+
+		if (stack_records)
+			memcpy(newRecords, stack_records, num_stack_records * sizeof(gu_stack_record));
+
+		free(stack_records);
+		stack_records = newRecords;
+		stack_records_capacity = newCapacity;
+	}
+
+	gu_stack_record& r = stack_records[num_stack_records];
+
+	r.hash = hash;
+	r.depth = (uint32_t)depth;
+	memcpy(r.frames, frames, depth * sizeof(void*));
+
+	uint32_t id = ++num_stack_records;
+
+	stack_index[j] = id;
+
+	spinUnlock(stack_table_lock);
+
+	return id;
 }
 
 
-void gu_free(void *ptr)
-{
-	if (ptr)
-		total_free_calls++;
+// Insert record r into the given shard.  The shard must be locked and have at least one free slot
+static void shardInsert(gu_alloc_shard& s, const gu_alloc_record& r, uint64_t hash) {
 
-#ifdef __GU_DEBUG_MEMORY__
-	// Avoid recursive call due to free = gu_free
-#undef free
+	size_t i = (size_t)(hash >> 32) & (s.capacity - 1);
 
-	free(ptr);
+	while (s.records[i].ptr)
+		i = (i + 1) & (s.capacity - 1);
 
-#define	free gu_free
+	s.records[i] = r;
+	s.count++;
+}
 
-#else
 
-	free(ptr);
+// Grow the given (locked) shard.  Return false if the shard cannot be grown
+static bool shardGrow(gu_alloc_shard& s) {
 
-#endif
+	size_t newCapacity = (s.capacity) ? s.capacity * 2 : gu_initial_shard_capacity;
+	gu_alloc_record *newRecords = (gu_alloc_record*)calloc(newCapacity, sizeof(gu_alloc_record));
+
+	if (!newRecords)
+		return false;
+
+	gu_alloc_record *oldRecords = s.records;
+	size_t oldCapacity = s.capacity;
+
+	s.records = newRecords;
+	s.capacity = newCapacity;
+	s.count = 0;
+
+	for (size_t i = 0; i < oldCapacity; i++) {
+
+		if (oldRecords[i].ptr)
+			shardInsert(s, oldRecords[i], hashPointer(oldRecords[i].ptr));
+	}
 
+	free(oldRecords);
+
+	return true;
 }
 
 
-void gu_aligned_free(void* ptr)
+// Remove ptr from the given (locked) shard and return its record in *r.  Return false if ptr is not in the shard
+static bool shardRemove(gu_alloc_shard& s, const void *ptr, uint64_t hash, gu_alloc_record *r) {
+
+	if (s.count == 0)
+		return false;
+
+	size_t mask = s.capacity - 1;
+	size_t i = (size_t)(hash >> 32) & mask;
+
+	for (; s.records[i].ptr != ptr; i = (i + 1) & mask) {
+
+		if (!s.records[i].ptr)
+			return false;
+	}
+
+	*r = s.records[i];
+
+	// Backward shift deletion - move subsequent records in the probe sequence back so no tombstones are needed
+	size_t j = i;
+
+	while (true) {
+
+		j = (j + 1) & mask;
+
+		if (!s.records[j].ptr)
+			break;
+
+		size_t k = (size_t)(hashPointer(s.records[j].ptr) >> 32) & mask;
+
+		// Move record j into the gap at i if its home slot k is not cyclically in (i, j]
+		if ((j > i && (k <= i || k > j)) || (j < i && (k <= i && k > j))) {
+
+			s.records[i] = s.records[j];
+			i = j;
+		}
+	}
+
+	s.records[i].ptr = nullptr;
+	s.count--;
+
+	return true;
+}
+
+
+static void trackAllocation(void *ptr, size_t size) {
+
+	gu_alloc_record r;
+
+	r.ptr = ptr;
+	r.size = size;
+	r.tag = (uint8_t)current_tag;
+	r.stack = (stack_capture_enabled.load(memory_order_relaxed)) ? captureStack() : 0;
+
+	uint64_t hash = hashPointer(ptr);
+	gu_alloc_shard& s = shards[hash >> 58];
+	gu_alloc_record stale;
+
+	spinLock(s.lock);
+
+	// A stale record for the same address means the previous block was released outside GUMemory (eg. by another module) - retire it
+	bool hasStale = shardRemove(s, ptr, hash, &stale);
+	bool tracked = ((s.count + 1) * 2 <= s.capacity || shardGrow(s));
+
+	if (tracked)
+		shardInsert(s, r, hash);
+
+	spinUnlock(s.lock);
+
+	if (hasStale)
+		countDeallocation(stale.tag, stale.size);
+
+	if (tracked)
+		countAllocation(r.tag, size);
+}
+
+
+// Stop tracking ptr.  Return false if ptr is not a tracked allocation
+static bool untrackAllocation(void *ptr) {
+
+	uint64_t hash = hashPointer(ptr);
+	gu_alloc_shard& s = shards[hash >> 58];
+	gu_alloc_record r;
+
+	spinLock(s.lock);
+
+	bool found = shardRemove(s, ptr, hash, &r);
+
+	spinUnlock(s.lock);
+
+	if (found)
+		countDeallocation(r.tag, r.size);
+
+	return found;
+}
+
+
+static int64_t clampCounter(int64_t v) {
+
+	return (v > 0) ? v : 0;
+}
+
+
+
+//
+// Memory handling functions
+//
+
+void gu_memAssertFail(const char *ptrString, const char *fnString) {
+
+	cout << "gu_memAssert(" << ptrString << ") in function " << fnString << "() failed.  Aborting process.\n\n";
+	abort();
+}
+
+
+
+
+//
+// Memory tracking functions
+//
+
+
+void *gu_malloc(size_t memreq)
 {
+	void *ptr = malloc(memreq);
+
 	if (ptr)
-		total_free_calls++;
+		trackAllocation(ptr, memreq);
 
-#ifdef __GU_DEBUG_MEMORY__
-	// Avoid recursive call due to _aligned_free = gu_aligned_free
-#undef _aligned_free
+	return ptr;
+}
 
-	_aligned_free(ptr);
 
-#define _aligned_free gu_aligned_free
+void *gu_calloc(size_t num, size_t size)
+{
+	void *ptr = calloc(num, size);
 
-#else
+	if (ptr)
+		trackAllocation(ptr, num * size);
 
-	_aligned_free(ptr);
+	return ptr;
+}
 
-#endif
 
+void* gu_aligned_malloc(size_t _Size, size_t _Alignment)
+{
+	void *ptr = _aligned_malloc(_Size, _Alignment);
+
+	if (ptr)
+		trackAllocation(ptr, _Size);
+
+	return ptr;
+}
+
+
+void gu_free(void *ptr)
+{
+	if (ptr && !untrackAllocation(ptr))
+		untracked_frees.fetch_add(1, memory_order_relaxed);
+
+	free(ptr);
+}
+
+
+void gu_aligned_free(void* ptr)
+{
+	if (ptr && !untrackAllocation(ptr))
+		untracked_frees.fetch_add(1, memory_order_relaxed);
+
+	_aligned_free(ptr);
 }
 
 
@@ -164,43 +549,93 @@ void gu_aligned_free(void* ptr)
 
 void *operator new(size_t size){
 
-	return malloc(size);
+	return gu_malloc(size);
 }
 
 void operator delete(void *ptr) {
 
-	free(ptr);
+	gu_free(ptr);
 }
 
 
 void *operator new[](size_t size) {
 
-	return malloc(size);
+	return gu_malloc(size);
 }
 
 
 void operator delete[](void *ptr) {
 
-	free(ptr);
+	gu_free(ptr);
 }
 
 #endif
 
 
 
+//
+// Memory tag functions
+//
+
+gu_memory_tag gu_memory_set_tag(gu_memory_tag tag) {
+
+	gu_memory_tag prevTag = (gu_memory_tag)current_tag;
+
+	if (tag >= 0 && tag < gu_mem_num_tags)
+		current_tag = tag;
+
+	return prevTag;
+}
+
+
+gu_memory_tag gu_memory_get_tag() {
+
+	return (gu_memory_tag)current_tag;
+}
+
+
+const char* gu_memory_tag_name(gu_memory_tag tag) {
+
+	return (tag >= 0 && tag < gu_mem_num_tags) ? tag_names[tag] : "unknown";
+}
+
+
+void gu_memory_capture_stacks(bool enable) {
+
+	stack_capture_enabled.store(enable, memory_order_relaxed);
+}
+
+
+bool gu_memory_ignore(void *ptr) {
+
+	return (ptr) ? untrackAllocation(ptr) : false;
+}
+
+
+
 //
 // Memory reporting functions
 //
 
 unsigned long gu_memory_allocations() {
 
-	return total_malloc_calls;
+	uint64_t n = malloc_compensation.load(memory_order_relaxed);
+
+	for (int i = 0; i < gu_mem_num_tags; i++)
+		n += tag_counters[i].allocations.load(memory_order_relaxed);
+
+	return (unsigned long)n;
 }
 
 
 unsigned long gu_memory_deallocations() {
 
-	return total_free_calls;
+	uint64_t n = free_compensation.load(memory_order_relaxed);
+
+	for (int i = 0; i < gu_mem_num_tags; i++)
+		n += tag_counters[i].deallocations.load(memory_order_relaxed);
+
+	return (unsigned long)n;
 }
 
 
@@ -210,9 +645,245 @@ unsigned long gu_memory_error() {
 }
 
 
+gu_memory_stats gu_memory_get_stats(gu_memory_tag tag) {
+
+	gu_memory_stats stats = {};
+
+	if (tag < 0 || tag >= gu_mem_num_tags)
+		return stats;
+
+	const gu_tag_counters& c = tag_counters[tag];
+
+	stats.live_bytes = (size_t)clampCounter(c.live_bytes.load(memory_order_relaxed));
+	stats.peak_bytes = (size_t)clampCounter(c.peak_bytes.load(memory_order_relaxed));
+	stats.allocations = c.allocations.load(memory_order_relaxed);
+	stats.deallocations = c.deallocations.load(memory_order_relaxed);
+	stats.bytes_allocated = c.bytes_allocated.load(memory_order_relaxed);
+
+	lock_guard<mutex> lock(rate_lock);
+
+	stats.allocation_rate = allocation_rate[tag];
+	stats.byte_rate = byte_rate[tag];
+
+	return stats;
+}
+
+
+gu_memory_stats gu_memory_get_total_stats() {
+
+	gu_memory_stats stats = {};
+
+	for (int i = 0; i < gu_mem_num_tags; i++) {
+
+		stats.allocations += tag_counters[i].allocations.load(memory_order_relaxed);
+		stats.deallocations += tag_counters[i].deallocations.load(memory_order_relaxed);
+		stats.bytes_allocated += tag_counters[i].bytes_allocated.load(memory_order_relaxed);
+	}
+
+	lock_guard<mutex> lock(rate_lock);
+
+	for (int i = 0; i < gu_mem_num_tags; i++) {
+
+		stats.allocation_rate += allocation_rate[i];
+		stats.byte_rate += byte_rate[i];
+	}
+
+	stats.live_bytes = (size_t)clampCounter(total_live_bytes.load(memory_order_relaxed));
+	stats.peak_bytes = (size_t)clampCounter(total_peak_bytes.load(memory_order_relaxed));
+
+	return stats;
+}
+
+
+void gu_memory_update_rates(double minInterval) {
+
+	gu_time_index t = CGDClock::ActualTime();
+	gu_time_index frequency = CGDClock::ActualTimeFrequency();
+
+	lock_guard<mutex> lock(rate_lock);
+
+	double elapsed = (frequency > 0) ? (double)(t - rate_sample_time) / (double)frequency : 0.0;
+
+	// Nothing to do until minInterval has elapsed (the first call just records the initial sample)
+	if (rate_sample_time != 0 && (elapsed < minInterval || elapsed <= 0.0))
+		return;
+
+	for (int i = 0; i < gu_mem_num_tags; i++) {
+
+		uint64_t allocations = tag_counters[i].allocations.load(memory_order_relaxed), bytes = tag_counters[i].bytes_allocated.load(memory_order_relaxed);
+
+		if (rate_sample_time != 0) {
+
+			allocation_rate[i] = (double)(allocations - rate_sample_allocations[i]) / elapsed;
+			byte_rate[i] = (double)(bytes - rate_sample_bytes[i]) / elapsed;
+		}
+
+		rate_sample_allocations[i] = allocations;
+		rate_sample_bytes[i] = bytes;
+	}
+
+	rate_sample_time = t;
+}
+
+
 void gu_memory_report() {
 
-	cout << "malloc(" << gu_memory_allocations() << ") free(" << gu_memory_deallocations() << ") error(" << gu_memory_error() << ")\n\n";
+	cout << "malloc(" << gu_memory_allocations() << ") free(" << gu_memory_deallocations() << ") error(" << gu_memory_error() << ")\n";
+
+	gu_memory_stats total = gu_memory_get_total_stats();
+
+	cout << "live bytes = " << total.live_bytes << ", peak bytes = " << total.peak_bytes << ", untracked frees = " << untracked_frees.load(memory_order_relaxed) << endl;
+
+	for (int i = 0; i < gu_mem_num_tags; i++) {
+
+		gu_memory_stats s = gu_memory_get_stats((gu_memory_tag)i);
+
+		if (s.allocations == 0)
+			continue;
+
+		cout << "  " << tag_names[i] << ": live = " << s.live_bytes << ", peak = " << s.peak_bytes << ", allocations = " << s.allocations << ", frees = " << s.deallocations << ", allocations/s = " << s.allocation_rate << ", bytes/s = " << s.byte_rate << endl;
+	}
+
+	cout << endl;
+}
+
+
+void gu_memory_report_leaks(unsigned int maxSites) {
+
+	// Snapshot outstanding allocations.  Shard locks are released before anything is written to cout since output may itself allocate
+	size_t capacity = 0;
+
+	for (int i = 0; i < gu_num_shards; i++) {
+
+		spinLock(shards[i].lock);
+		capacity += shards[i].count;
+		spinUnlock(shards[i].lock);
+	}
+
+	capacity += capacity / 4 + 64; // allow for allocations made by other threads in the meantime
+
+	gu_alloc_record *records = (gu_alloc_record*)malloc(capacity * sizeof(gu_alloc_record));
+
+	if (!records)
+		return;
+
+	size_t n = 0;
+
+	for (int i = 0; i < gu_num_shards; i++) {
+
+		spinLock(shards[i].lock);
+
+		for (size_t j = 0; j < shards[i].capacity && n < capacity; j++) {
+
+			if (shards[i].records[j].ptr)
+				records[n++] = shards[i].records[j];
+		}
+
+		spinUnlock(shards[i].lock);
+	}
+
+	// Group by call site (stack, tag)
+	sort(records, records + n, [](const gu_alloc_record& a, const gu_alloc_record& b) { return (a.stack != b.stack) ? a.stack < b.stack : a.tag < b.tag; });
+
+	struct LeakSite {
+
+		uint32_t				stack;
+		uint8_t					tag;
+		size_t					count;
+		size_t					bytes;
+	};
+
+	LeakSite *sites = (LeakSite*)malloc((n + 1) * sizeof(LeakSite));
+
+	if (!sites) {
+
+		free(records);
+		return;
+	}
+
+	size_t numSites = 0, totalBytes = 0;
+
+	for (size_t i = 0; i < n; i++) {
+
+		if (numSites == 0 || sites[numSites - 1].stack != records[i].stack || sites[numSites - 1].tag != records[i].tag) {
+
+			LeakSite site = { records[i].stack, records[i].tag, 0, 0 };
+			sites[numSites++] = site;
+		}
+
+		sites[numSites - 1].count++;
+		sites[numSites - 1].bytes += records[i].size;
+		totalBytes += records[i].size;
+	}
+
+	free(records);
+
+	sort(sites, sites + numSites, [](const LeakSite& a, const LeakSite& b) { return a.bytes > b.bytes; });
+
+	cout << "Outstanding allocations = " << n << ", bytes = " << totalBytes << ", call sites = " << numSites << endl;
+
+#ifdef _WIN32
+	HANDLE process = GetCurrentProcess();
+	bool symbolsLoaded = (SymInitialize(process, nullptr, TRUE) != FALSE);
+
+	if (symbolsLoaded)
+		SymSetOptions(SymGetOptions() | SYMOPT_LOAD_LINES | SYMOPT_UNDNAME);
+#endif
+
+	for (size_t i = 0; i < numSites && i < maxSites; i++) {
+
+		cout << "  [" << tag_names[sites[i].tag] << "] " << sites[i].count << " allocation(s), " << sites[i].bytes << " bytes\n";
+
+		if (sites[i].stack == 0)
+			continue;
+
+		spinLock(stack_table_lock);
+		gu_stack_record r = stack_records[sites[i].stack - 1];
+		spinUnlock(stack_table_lock);
+
+#ifdef _WIN32
+		for (uint32_t j = 0; j < r.depth; j++) {
+
+			char symbolBuffer[sizeof(SYMBOL_INFO) + 256];
+			SYMBOL_INFO *symbol = (SYMBOL_INFO*)symbolBuffer;
+			IMAGEHLP_LINE64 line;
+			DWORD lineDisplacement = 0;
+
+			ZeroMemory(symbolBuffer, sizeof(symbolBuffer));
+			symbol->SizeOfStruct = sizeof(SYMBOL_INFO);
+			symbol->MaxNameLen = 255;
+
+			ZeroMemory(&line, sizeof(IMAGEHLP_LINE64));
+			line.SizeOfStruct = sizeof(IMAGEHLP_LINE64);
+
+			cout << "      " << r.frames[j];
+
+			if (symbolsLoaded && SymFromAddr(process, (DWORD64)r.frames[j], nullptr, symbol))
+				cout << " " << symbol->Name;
+
+			if (symbolsLoaded && SymGetLineFromAddr64(process, (DWORD64)r.frames[j], &lineDisplacement, &line))
+				cout << " (" << line.FileName << ":" << line.LineNumber << ")";
+
+			cout << endl;
+		}
+#elif defined(__GLIBC__)
+		char **symbols = backtrace_symbols(r.frames, (int)r.depth);
+
+		for (uint32_t j = 0; j < r.depth; j++)
+			cout << "      " << ((symbols) ? symbols[j] : "?") << endl;
+
+		free(symbols);
+#endif
+	}
+
+#ifdef _WIN32
+	if (symbolsLoaded)
+		SymCleanup(process);
+#endif
+
+	free(sites);
+
+	cout << endl;
 }
 
 
@@ -225,24 +896,24 @@ We can broadly classify 4 different types of memory allocation that will affect
 
 (i) Appication managed allocation and disposal of memory resources.  These are trapped by this library and do not present a problem.
 
-(ii) OS allocated memory.  The Operating system or pre-compiled API will allocate memory and return it to the application.  The application has "ownership" of the returned memory and is responsible for disposal.  This can affect the alloc/dealloc counters maintained by this library.  To address this the compensate_malloc_count() function can be used explicitly.  This increments the alloc counter to reflect the OS memory allocations returned to the application.  When the application then frees the memory, the alloc/dealloc counters should correspond.
+(ii) OS allocated memory.  The Operating system or pre-compiled API will allocate memory and return it to the application.  The application has "ownership" of the returned memory and is responsible for disposal.  Since allocations are tracked by address, freeing such memory is recorded as an untracked free and does not affect the alloc/dealloc counters.
 
-(iii) Application allocated memory - The application allocates memory which is then passed to the OS / API.  For example, the GLU library implements callbacks that return memory to the GLU API.  Ownership of the memory is passed to the API.  To address this the compensate_free_count() function can be called to increment the dealloc counter to reflect the memory that the OS / API will free up.
+(iii) Application allocated memory - The application allocates memory which is then passed to the OS / API.  For example, the GLU library implements callbacks that return memory to the GLU API.  Ownership of the memory is passed to the API.  To address this the compensate_free_count() function can be called to increment the dealloc counter to reflect the memory that the OS / API will free up.  Where the pointer is known, gu_memory_ignore() is preferred since it also corrects the live byte counts and removes the allocation from the leak report.
 
 (iv) Static allocations during optimisation.  When building against existing libraries, different malloc/dealloc behaviour can be observed for code compiled with the debug and release versions of the libraries.  For example, certain libraries may allocate buffers so memeory allocation is not required on subsequent calls.
 
 */
 
 
-// Compensate_malloc_count: Some memory may be allocated by the operating system not not explicity with malloc by the application.  In such cases, freeing the memory explicity can give rise to malloc counter errors.  This should be called after freeing os allocated memory to ensure the counter is correct.
+// Compensate_malloc_count: Adjust the reported allocation count by c.  Retained for compatibility - memory freed here that was not allocated here is no longer counted as a free so this is not normally required
 void compensate_malloc_count(unsigned long c)
 {
-	total_malloc_calls += c;
+	malloc_compensation.fetch_add(c, memory_order_relaxed);
 }
 
 
 // Compensate_free_count: Memory may be allocated by the application and returned to the OS / calling API.  It may appear a leak has occured  when in fact the OS has freed the memory.  Use this to increment the number of deallocs to refelect memory returned to the OS.  This should be called after or just before returning memory to the OS to ensure the counter is correct.
 void compensate_free_count(unsigned long c)
 {
-	total_free_calls += c;
+	free_compensation.fetch_add(c, memory_order_relaxed);
 }
@@ -1,16 +1,19 @@
-
 //
 // GUMemory.h
 //
 
 // Define C++ memory handling functions and macros to simplify the creation, validation and tracking of heap allocated memory during debugging.  GUMemory defines the gu_memAssert(v) macro to validate allocated memory.  If v==nullptr then a message is logged to stdout and the host process is aborted.  Memory tracking versions of malloc, calloc and free are also defined along with memory tracking overrides of new, new[], delete and delete[].  To override the standard malloc, calloc and free calls with the memory tracking versions __GU_DEBUG_MEMORY__ must be defined in the host application or framework.
+//
+// Each tracked allocation is recorded (size, tag and optionally the call stack) in a side table keyed on the returned pointer so no header is added to the allocation itself.  Memory can therefore safely cross module (DLL) boundaries - memory freed here that was not allocated here is simply counted as an untracked free.  Allocations are attributed to the calling thread's current gu_memory_tag (see GU_MEMORY_TAG_SCOPE) and live bytes, peak bytes and allocation rates are maintained per tag with atomic counters so tracking is thread-safe and cheap enough to leave enabled in optimised (staging) builds.
 
 #pragma once
 
 #include <cstddef>
 #include <cstdlib>
+#include <cstdint>
 #include <new>
 #include <memory>
+#include <type_traits>
 
 #ifdef __GU_DEBUG_MEMORY__
 
@@ -18,7 +21,7 @@
 
 #define	malloc				gu_malloc
 #define	calloc				gu_calloc
-#define	free				gu_free 
+#define	free				gu_free
 #define _aligned_malloc		gu_aligned_malloc
 #define _aligned_free		gu_aligned_free
 
@@ -42,6 +45,39 @@ void gu_memAssertFail(const char *ptrString, const char *fnString);
 
 
 
+// Memory tags - subsystems that allocations are attributed to
+typedef enum {
+
+	gu_mem_general = 0,
+	gu_mem_scene,
+	gu_mem_mesh,
+	gu_mem_texture,
+	gu_mem_shader,
+	gu_mem_matrix,
+	gu_mem_particles,
+	gu_mem_profiler,
+	gu_mem_arena, // memory arena and object pool blocks (see GUMemoryArena and GUObjectPool)
+	gu_mem_jobs, // job system jobs and work queues (see CGDJobSystem)
+
+	gu_mem_num_tags
+
+} gu_memory_tag;
+
+
+// Memory statistics for a single tag (or all tags)
+struct gu_memory_stats {
+
+	size_t				live_bytes;
+	size_t				peak_bytes;
+	uint64_t			allocations;
+	uint64_t			deallocations;
+	uint64_t			bytes_allocated; // total bytes allocated
+	double				allocation_rate; // allocations per second over the last rate sample interval (see gu_memory_update_rates)
+	double				byte_rate; // bytes allocated per second over the last rate sample interval
+};
+
+
+
 // Memory tracking functions
 
 void* gu_malloc(std::size_t memreq);
@@ -51,15 +87,102 @@ void gu_free(void* ptr);
 void gu_aligned_free(void* ptr);
 
 
+// Memory tag functions.  gu_memory_set_tag sets the calling thread's current tag and returns the previous tag
+gu_memory_tag gu_memory_set_tag(gu_memory_tag tag);
+gu_memory_tag gu_memory_get_tag();
+const char* gu_memory_tag_name(gu_memory_tag tag);
+
+// Enable / disable call stack capture for subsequent allocations (disabled by default).  Captured stacks are reported by gu_memory_report_leaks
+void gu_memory_capture_stacks(bool enable);
+
+// Stop tracking the given allocation as if it had been freed - use this for memory that must outlive the final memory report (eg. the debug console).  Return false if ptr is not a tracked allocation
+bool gu_memory_ignore(void *ptr);
+
+
 // Memory reporting functions
 
 unsigned long gu_memory_allocations();
 unsigned long gu_memory_deallocations();
 unsigned long gu_memory_error();
+
+gu_memory_stats gu_memory_get_stats(gu_memory_tag tag);
+gu_memory_stats gu_memory_get_total_stats();
+
+// Sample allocation counters to update allocation rates.  This can be called every frame - the rates are only updated once minInterval seconds have elapsed since the last sample
+void gu_memory_update_rates(double minInterval = 1.0);
+
 void gu_memory_report();
 
+// Report outstanding allocations grouped by call site (tag and call stack), largest first.  Report at most maxSites call sites
+void gu_memory_report_leaks(unsigned int maxSites = 20);
+
 
 // Memory counter adjustment functions
 
 void compensate_malloc_count(unsigned long c);
 void compensate_free_count(unsigned long c);
+
+
+// RAII memory tag scope - allocations made by the calling thread within the scope are attributed to the given tag
+class GUMemoryTagScope {
+
+	gu_memory_tag			prevTag;
+
+public:
+
+	GUMemoryTagScope(gu_memory_tag tag) : prevTag(gu_memory_set_tag(tag)) {}
+
+	~GUMemoryTagScope() {
+
+		gu_memory_set_tag(prevTag);
+	}
+
+private:
+
+	GUMemoryTagScope(const GUMemoryTagScope&);
+	GUMemoryTagScope& operator=(const GUMemoryTagScope&);
+};
+
+
+// Aligned allocation of count default-constructed objects of type T.  The alignment is the larger of 16 bytes and the natural alignment of T (eg. DirectX::XMMATRIX members).  Return nullptr if the memory cannot be allocated.  Objects must be disposed of with gu_aligned_delete
+template <typename T>
+T* gu_aligned_new(size_t count = 1) {
+
+	const size_t alignment = (std::alignment_of<T>::value > 16) ? std::alignment_of<T>::value : 16;
+
+	T *ptr = (T*)gu_aligned_malloc(sizeof(T) * count, alignment);
+
+	if (ptr) {
+
+		for (size_t i = 0; i < count; i++)
+			new(ptr + i) T();
+	}
+
+	return ptr;
+}
+
+template <typename T>
+void gu_aligned_delete(T *ptr, size_t count = 1) {
+
+	if (!ptr)
+		return;
+
+	for (size_t i = 0; i < count; i++)
+		ptr[i].~T();
+
+	gu_aligned_free(ptr);
+}
+
+
+#ifdef __GU_DEBUG_MEMORY__
+
+#define GU_MEMORY_CONCAT_(a, b)				a##b
+#define GU_MEMORY_CONCAT(a, b)				GU_MEMORY_CONCAT_(a, b)
+
+#define GU_MEMORY_TAG_SCOPE(tag)			GUMemoryTagScope GU_MEMORY_CONCAT(_guMemoryTag, __LINE__)(tag)
+
+#else
+
+#define GU_MEMORY_TAG_SCOPE(tag)
+
+#endif
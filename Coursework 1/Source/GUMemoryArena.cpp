@@ -0,0 +1,281 @@
+
+//
+// GUMemoryArena.cpp
+//
+
+#include <stdafx.h>
+#include <GUMemoryArena.h>
+#include <iostream>
+
+using namespace std;
+
+
+#ifdef _WIN32
+#define GU_THREAD_LOCAL		__declspec(thread)
+#else
+#define GU_THREAD_LOCAL		__thread
+#endif
+
+
+// Block header size - the first allocation in a block is aligned to a cache line
+static const size_t						blockHeaderSize = 64;
+
+// Default scratch arena block size
+static const size_t						scratchBlockSize = 1 << 20;
+
+static GU_THREAD_LOCAL GUMemoryArena	*threadScratch = nullptr;
+
+
+
+//
+// Private interface
+//
+
+// Constructor - called internally by the CreateArena factory method
+GUMemoryArena::GUMemoryArena(size_t _blockSize, gu_memory_tag _tag) {
+
+	blockSize = _blockSize;
+	tag = _tag;
+}
+
+
+GUMemoryArena::Block* GUMemoryArena::createBlock(size_t minSize) {
+
+	GU_MEMORY_TAG_SCOPE(tag);
+
+	size_t size = (minSize > blockSize) ? minSize : blockSize;
+	Block *block = (Block*)gu_aligned_malloc(blockHeaderSize + size, blockHeaderSize);
+
+	if (block) {
+
+		block->next = nullptr;
+		block->size = size;
+		block->used = 0;
+	}
+
+	return block;
+}
+
+
+void GUMemoryArena::releaseBlocks() {
+
+	Block *block = firstBlock;
+
+	while (block) {
+
+		Block *next = block->next;
+
+		gu_aligned_free(block);
+		block = next;
+	}
+
+	firstBlock = currentBlock = nullptr;
+	bytesBefore = 0;
+}
+
+
+char* GUMemoryArena::blockData(Block *block) {
+
+	return (char*)block + blockHeaderSize;
+}
+
+
+
+//
+// Public interface
+//
+
+// Arena factory method
+GUMemoryArena* GUMemoryArena::CreateArena(size_t blockSize, gu_memory_tag tag) {
+
+	if (blockSize == 0)
+		return nullptr;
+
+	GUMemoryArena *arena = new GUMemoryArena(blockSize, tag);
+
+	// Allocate the first block up front so the first frame does not pay for it
+	arena->firstBlock = arena->currentBlock = arena->createBlock(blockSize);
+
+	if (!arena->firstBlock) {
+
+		arena->release();
+		return nullptr;
+	}
+
+	return arena;
+}
+
+
+// Destructor
+GUMemoryArena::~GUMemoryArena() {
+
+	releaseBlocks();
+}
+
+
+void* GUMemoryArena::allocate(size_t size, size_t alignment) {
+
+	if (alignment == 0 || (alignment & (alignment - 1)) != 0)
+		return nullptr;
+
+	while (currentBlock) {
+
+		uintptr_t base = (uintptr_t)blockData(currentBlock);
+		uintptr_t p = (base + currentBlock->used + alignment - 1) & ~(uintptr_t)(alignment - 1);
+
+		if (p + size <= base + currentBlock->size) {
+
+			currentBlock->used = (size_t)(p + size - base);
+			numAllocations++;
+
+			size_t used = bytesBefore + currentBlock->used;
+
+			if (used > frameHighWaterMark)
+				frameHighWaterMark = used;
+
+			if (used > highWaterMark)
+				highWaterMark = used;
+
+			return (void*)p;
+		}
+
+		// Move to the next block if it is large enough, otherwise insert a new block after the current one.  Blocks following currentBlock are always empty
+		Block *next = currentBlock->next;
+
+		if (!next || next->size < size + alignment) {
+
+			Block *newBlock = createBlock(size + alignment);
+
+			if (!newBlock)
+				return nullptr;
+
+			newBlock->next = next;
+			currentBlock->next = newBlock;
+			next = newBlock;
+		}
+
+		bytesBefore += currentBlock->used;
+		currentBlock = next;
+		currentBlock->used = 0;
+	}
+
+	// No blocks (the arena could not be re-created on reset) - try again from scratch
+	firstBlock = currentBlock = createBlock(size + alignment);
+
+	return (currentBlock) ? allocate(size, alignment) : nullptr;
+}
+
+
+GUMemoryArena::Marker GUMemoryArena::getMarker() const {
+
+	Marker m;
+
+	m.block = currentBlock;
+	m.used = (currentBlock) ? currentBlock->used : 0;
+	m.bytesBefore = bytesBefore;
+
+	return m;
+}
+
+
+void GUMemoryArena::rewind(const Marker& marker) {
+
+	if (!marker.block) {
+
+		reset();
+		return;
+	}
+
+	// Blocks after the marker block are reset when they are next entered in allocate
+	currentBlock = marker.block;
+	currentBlock->used = marker.used;
+	bytesBefore = marker.bytesBefore;
+}
+
+
+void GUMemoryArena::reset() {
+
+	// Consolidate into a single block if the last frame overflowed the first block
+	if (firstBlock && firstBlock->next && frameHighWaterMark > firstBlock->size) {
+
+		size_t size = blockSize;
+
+		while (size < frameHighWaterMark)
+			size *= 2;
+
+		releaseBlocks();
+		firstBlock = createBlock(size);
+	}
+
+	currentBlock = firstBlock;
+	bytesBefore = 0;
+	frameHighWaterMark = 0;
+
+	if (currentBlock)
+		currentBlock->used = 0;
+}
+
+
+size_t GUMemoryArena::bytesUsed() const {
+
+	return bytesBefore + ((currentBlock) ? currentBlock->used : 0);
+}
+
+
+size_t GUMemoryArena::bytesReserved() const {
+
+	size_t n = 0;
+
+	for (Block *block = firstBlock; block; block = block->next)
+		n += block->size;
+
+	return n;
+}
+
+
+size_t GUMemoryArena::peakBytesUsed() const {
+
+	return highWaterMark;
+}
+
+
+uint64_t GUMemoryArena::allocationCount() const {
+
+	return numAllocations;
+}
+
+
+uint32_t GUMemoryArena::blockCount() const {
+
+	uint32_t n = 0;
+
+	for (Block *block = firstBlock; block; block = block->next)
+		n++;
+
+	return n;
+}
+
+
+void GUMemoryArena::reportUsage(const char *name) const {
+
+	cout << name << ": used = " << bytesUsed() << ", peak = " << peakBytesUsed() << ", reserved = " << bytesReserved() << " in " << blockCount() << " block(s), allocations = " << allocationCount() << endl;
+}
+
+
+GUMemoryArena* GUMemoryArena::ThreadScratch() {
+
+	if (!threadScratch)
+		threadScratch = GUMemoryArena::CreateArena(scratchBlockSize, gu_mem_arena);
+
+	return threadScratch;
+}
+
+
+void GUMemoryArena::ReleaseThreadScratch() {
+
+	if (threadScratch) {
+
+		threadScratch->release();
+		threadScratch = nullptr;
+	}
+}
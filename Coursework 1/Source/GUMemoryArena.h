@@ -0,0 +1,153 @@
+//
+// GUMemoryArena.h
+//
+
+// Linear (bump pointer) memory arena.  Memory is allocated from a chain of large blocks obtained from the tracked heap (see GUMemory) so individual allocations cost a pointer increment and are not tracked - the arena's blocks are attributed to the arena's memory tag instead.  Allocations are not freed individually.  Instead the arena is rewound to a previously obtained marker or reset.  Destructors are not called so the arena is intended for POD data (vertex staging, per-frame scratch buffers etc).
+//
+// Two uses are supported...
+//
+// (i) Frame arena - an arena owned by a frame loop and reset at the start of each frame.  If a frame needed more than one block the blocks are replaced on reset by a single block large enough for the high water mark so the steady state makes no heap allocations.
+//
+// (ii) Scratch stack - each thread has its own arena (see ThreadScratch) used in strict LIFO order through GUScratchScope.  This replaces short lived malloc / free pairs such as load-time staging buffers.
+//
+// GUMemoryArena is not thread-safe - an arena must only be used by one thread at a time.
+
+#pragma once
+
+#include <GUObject.h>
+#include <GUMemory.h>
+#include <cstdint>
+
+
+class GUMemoryArena : public GUObject {
+
+	// Block header - stored at the start of each block
+	struct Block {
+
+		Block				*next;
+		size_t				size; // usable bytes following the header
+		size_t				used;
+	};
+
+public:
+
+	// Arena position returned by getMarker and restored by rewind
+	struct Marker {
+
+		Block				*block;
+		size_t				used;
+		size_t				bytesBefore; // bytes used in the blocks preceding block
+	};
+
+private:
+
+	Block					*firstBlock = nullptr;
+	Block					*currentBlock = nullptr;
+	size_t					bytesBefore = 0; // bytes used in the blocks preceding currentBlock
+
+	size_t					blockSize;
+	gu_memory_tag			tag;
+
+	size_t					highWaterMark = 0;
+	size_t					frameHighWaterMark = 0; // high water mark since the last reset
+	uint64_t				numAllocations = 0;
+
+
+	//
+	// Private interface
+	//
+
+	// Constructor - called internally by the CreateArena factory method
+	GUMemoryArena(size_t blockSize, gu_memory_tag tag);
+
+	// Allocate a new block with at least minSize usable bytes.  Return nullptr if the block cannot be allocated
+	Block* createBlock(size_t minSize);
+
+	void releaseBlocks();
+
+	static char* blockData(Block *block);
+
+
+public:
+
+	//
+	// Public interface
+	//
+
+	// Arena factory method.  Blocks of blockSize bytes are allocated as needed (larger blocks are allocated for requests that do not fit in a single block).  Block memory is attributed to the given memory tag
+	static GUMemoryArena* CreateArena(size_t blockSize = 1 << 20, gu_memory_tag tag = gu_mem_arena);
+
+	// Destructor
+	~GUMemoryArena();
+
+	// Allocate size bytes aligned to alignment (a power of 2).  Return nullptr if the memory cannot be allocated
+	void* allocate(size_t size, size_t alignment = 16);
+
+	// Allocate an array of count objects of type T (not constructed)
+	template <typename T>
+	T* allocateArray(size_t count) {
+
+		return (T*)allocate(sizeof(T) * count, (std::alignment_of<T>::value > 16) ? std::alignment_of<T>::value : 16);
+	}
+
+	// Markers.  rewind releases all memory allocated since the given marker was obtained
+	Marker getMarker() const;
+	void rewind(const Marker& marker);
+
+	// Release all allocations.  If more than one block was used the blocks are replaced with a single block that can hold the high water mark
+	void reset();
+
+	// Query methods
+	size_t bytesUsed() const;
+	size_t bytesReserved() const; // total block capacity
+	size_t peakBytesUsed() const;
+	uint64_t allocationCount() const;
+	uint32_t blockCount() const;
+
+	void reportUsage(const char *name) const;
+
+	// Return the calling thread's scratch arena (created on first use).  Return nullptr if the arena cannot be created
+	static GUMemoryArena* ThreadScratch();
+
+	// Release the calling thread's scratch arena.  Threads that use scratch memory should call this before they exit
+	static void ReleaseThreadScratch();
+};
+
+
+// RAII scratch memory scope.  Memory allocated through the scope comes from the calling thread's scratch arena and is released when the scope ends.  Scopes must be nested in LIFO order on each thread
+class GUScratchScope {
+
+	GUMemoryArena				*arena;
+	GUMemoryArena::Marker		marker;
+
+public:
+
+	GUScratchScope() : arena(GUMemoryArena::ThreadScratch()) {
+
+		if (arena)
+			marker = arena->getMarker();
+	}
+
+	~GUScratchScope() {
+
+		if (arena)
+			arena->rewind(marker);
+	}
+
+	// Allocate size bytes aligned to alignment.  Return nullptr if the memory cannot be allocated
+	void* allocate(size_t size, size_t alignment = 16) {
+
+		return (arena) ? arena->allocate(size, alignment) : nullptr;
+	}
+
+	template <typename T>
+	T* allocateArray(size_t count) {
+
+		return (arena) ? arena->allocateArray<T>(count) : nullptr;
+	}
+
+private:
+
+	GUScratchScope(const GUScratchScope&);
+	GUScratchScope& operator=(const GUScratchScope&);
+};
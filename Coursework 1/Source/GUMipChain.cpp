@@ -0,0 +1,357 @@
+
+//
+// GUMipChain.cpp
+//
+
+#include <stdafx.h>
+#include <GUMipChain.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <xmmintrin.h>
+
+using namespace std;
+
+
+// Kaiser filter support in destination texels either side of the texel centre and window shape
+static const float				kaiserWidth = 3.0f;
+static const float				kaiserAlpha = 4.0f;
+
+// Alpha scale search range and binary search steps for coverage preservation
+static const float				maxAlphaScale = 8.0f;
+static const int				alphaScaleSteps = 16;
+
+
+// sRGB <-> linear conversion tables.  An 8-bit sRGB value k is decoded by table lookup and a linear value x is encoded as the number of thresholds (the linear values of the sRGB midpoints k + 0.5) below x, which rounds exactly in sRGB space
+struct SRGBTables {
+
+	float			toLinear[256];
+	float			thresholds[255];
+
+	SRGBTables() {
+
+		for (int k = 0; k < 256; k++)
+			toLinear[k] = decode(k / 255.0);
+
+		for (int k = 0; k < 255; k++)
+			thresholds[k] = decode((k + 0.5) / 255.0);
+	}
+
+	static float decode(double s) {
+
+		return (float)((s <= 0.04045) ? s / 12.92 : pow((s + 0.055) / 1.055, 2.4));
+	}
+
+	uint8_t encode(float x) const {
+
+		return (uint8_t)(lower_bound(thresholds, thresholds + 255, x) - thresholds);
+	}
+};
+
+static const SRGBTables			srgb;
+
+
+// Filter taps of one axis - count source texels (index) and weights per destination texel
+struct Taps {
+
+	uint32_t			count;
+	vector<uint32_t>	index;
+	vector<float>		weight;
+};
+
+
+// Modified Bessel function of the first kind of order 0 (power series)
+static double besselI0(double x) {
+
+	double sum = 1.0, term = 1.0, q = x * x * 0.25;
+
+	for (int k = 1; k < 32 && term > sum * 1e-12; k++) {
+
+		term *= q / ((double)k * k);
+		sum += term;
+	}
+
+	return sum;
+}
+
+
+// Kaiser windowed sinc at t destination texels from the texel centre
+static double kaiser(double t) {
+
+	if (fabs(t) >= kaiserWidth)
+		return 0.0;
+
+	double x = t / kaiserWidth;
+	double sinc = (t == 0.0) ? 1.0 : sin(3.14159265358979323846 * t) / (3.14159265358979323846 * t);
+
+	return sinc * besselI0(kaiserAlpha * sqrt(1.0 - x * x)) / besselI0(kaiserAlpha);
+}
+
+
+// Taps to reduce srcSize texels to dstSize.  Texels beyond the edge are clamped
+static void buildTaps(uint32_t srcSize, uint32_t dstSize, gu_mip_filter filter, Taps& taps) {
+
+	vector<vector<pair<uint32_t, float> > > texels(dstSize);
+	double scale = (double)srcSize / dstSize;
+	double halfWidth = (filter == gu_mip_box || srcSize == dstSize) ? scale * 0.5 : kaiserWidth * scale;
+
+	taps.count = 1;
+
+	for (uint32_t d = 0; d < dstSize; d++) {
+
+		double centre = (d + 0.5) * scale, total = 0.0;
+		int first = (int)floor(centre - halfWidth), last = (int)ceil(centre + halfWidth);
+
+		for (int i = first; i < last; i++) {
+
+			double w;
+
+			if (filter == gu_mip_box || srcSize == dstSize)
+				w = max(0.0, min(i + 1.0, centre + halfWidth) - max((double)i, centre - halfWidth));
+			else
+				w = kaiser((i + 0.5 - centre) / scale);
+
+			if (fabs(w) < 1e-6)
+				continue;
+
+			texels[d].push_back(make_pair((uint32_t)min(max(i, 0), (int)srcSize - 1), (float)w));
+			total += w;
+		}
+
+		for (size_t k = 0; k < texels[d].size(); k++)
+			texels[d][k].second = (float)(texels[d][k].second / total);
+
+		taps.count = max(taps.count, (uint32_t)texels[d].size());
+	}
+
+	// Pad to count taps per texel with zero weights
+	taps.index.assign((size_t)dstSize * taps.count, 0);
+	taps.weight.assign((size_t)dstSize * taps.count, 0.0f);
+
+	for (uint32_t d = 0; d < dstSize; d++) {
+
+		for (size_t k = 0; k < texels[d].size(); k++) {
+
+			taps.index[d * taps.count + k] = texels[d][k].first;
+			taps.weight[d * taps.count + k] = texels[d][k].second;
+		}
+	}
+}
+
+
+// Filter a width x height level of float RGBA texels down to dstWidth x dstHeight - rows first, then columns
+static void filterLevel(uint32_t width, uint32_t height, const float *src, uint32_t dstWidth, uint32_t dstHeight, gu_mip_filter filter, vector<float>& dst) {
+
+	Taps horizontal, vertical;
+
+	buildTaps(width, dstWidth, filter, horizontal);
+	buildTaps(height, dstHeight, filter, vertical);
+
+	vector<float> rows((size_t)dstWidth * height * 4);
+
+	for (uint32_t y = 0; y < height; y++) {
+
+		const float *srcRow = src + (size_t)y * width * 4;
+		float *row = rows.data() + (size_t)y * dstWidth * 4;
+
+		for (uint32_t x = 0; x < dstWidth; x++) {
+
+			const uint32_t *index = horizontal.index.data() + x * horizontal.count;
+			const float *weight = horizontal.weight.data() + x * horizontal.count;
+			__m128 sum = _mm_setzero_ps();
+
+			for (uint32_t k = 0; k < horizontal.count; k++)
+				sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weight[k]), _mm_loadu_ps(srcRow + index[k] * 4)));
+
+			_mm_storeu_ps(row + x * 4, sum);
+		}
+	}
+
+	dst.assign((size_t)dstWidth * dstHeight * 4, 0.0f);
+
+	for (uint32_t y = 0; y < dstHeight; y++) {
+
+		float *dstRow = dst.data() + (size_t)y * dstWidth * 4;
+
+		for (uint32_t k = 0; k < vertical.count; k++) {
+
+			const float *row = rows.data() + (size_t)vertical.index[y * vertical.count + k] * dstWidth * 4;
+			__m128 w = _mm_set1_ps(vertical.weight[y * vertical.count + k]);
+
+			for (uint32_t x = 0; x < dstWidth; x++)
+				_mm_storeu_ps(dstRow + x * 4, _mm_add_ps(_mm_loadu_ps(dstRow + x * 4), _mm_mul_ps(w, _mm_loadu_ps(row + x * 4))));
+		}
+	}
+}
+
+
+static float floatCoverage(const vector<float>& level, float alphaScale, float alphaTestRef) {
+
+	size_t count = level.size() / 4, passed = 0;
+
+	for (size_t i = 0; i < count; i++)
+		passed += (level[i * 4 + 3] * alphaScale > alphaTestRef) ? 1 : 0;
+
+	return (float)passed / (float)count;
+}
+
+
+// Alpha scale that makes the coverage of level closest to target
+static float coverageScale(const vector<float>& level, float alphaTestRef, float target) {
+
+	float low = 0.0f, high = maxAlphaScale;
+
+	for (int i = 0; i < alphaScaleSteps; i++) {
+
+		float mid = (low + high) * 0.5f;
+
+		if (floatCoverage(level, mid, alphaTestRef) < target)
+			low = mid;
+		else
+			high = mid;
+	}
+
+	return (fabs(floatCoverage(level, low, alphaTestRef) - target) < fabs(floatCoverage(level, high, alphaTestRef) - target)) ? low : high;
+}
+
+
+static uint8_t unorm8(float x) {
+
+	return (uint8_t)(min(max(x, 0.0f), 1.0f) * 255.0f + 0.5f);
+}
+
+
+// Write a float level as RGBA8
+static void encodeLevel(const vector<float>& level, gu_mip_content content, float alphaScale, vector<uint8_t>& rgba) {
+
+	size_t count = level.size() / 4;
+
+	rgba.resize(count * 4);
+
+	for (size_t i = 0; i < count; i++) {
+
+		const float *t = level.data() + i * 4;
+		uint8_t *out = rgba.data() + i * 4;
+
+		if (content == gu_mip_colour) {
+
+			for (int c = 0; c < 3; c++)
+				out[c] = srgb.encode(t[c]);
+
+		} else if (content == gu_mip_normal) {
+
+			float length = sqrtf(t[0] * t[0] + t[1] * t[1] + t[2] * t[2]);
+			float n[3] = { 0.0f, 0.0f, 1.0f };
+
+			if (length > 1e-6f) {
+
+				for (int c = 0; c < 3; c++)
+					n[c] = t[c] / length;
+			}
+
+			for (int c = 0; c < 3; c++)
+				out[c] = unorm8(n[c] * 0.5f + 0.5f);
+
+		} else {
+
+			for (int c = 0; c < 3; c++)
+				out[c] = unorm8(t[c]);
+		}
+
+		out[3] = unorm8(t[3] * alphaScale);
+	}
+}
+
+
+uint32_t gu_mip_count(uint32_t width, uint32_t height) {
+
+	uint32_t count = 1;
+
+	for (uint32_t size = max(width, height); size > 1; size >>= 1)
+		count++;
+
+	return count;
+}
+
+
+gu_mip_options gu_mip_default_options(const char *filename, uint32_t width, uint32_t height, const uint8_t *rgba) {
+
+	gu_mip_options options;
+	string name = filename;
+
+	transform(name.begin(), name.end(), name.begin(), ::tolower);
+
+	bool grey = true, opaque = true;
+
+	for (size_t i = 0; i < (size_t)width * height; i++) {
+
+		const uint8_t *t = rgba + i * 4;
+
+		grey = grey && t[0] == t[1] && t[1] == t[2];
+		opaque = opaque && t[3] == 255;
+	}
+
+	if (name.find("normal") != string::npos)
+		options.content = gu_mip_normal;
+	else if (grey)
+		options.content = gu_mip_linear;
+
+	if (!opaque)
+		options.alphaTestRef = 0.5f;
+
+	return options;
+}
+
+
+float gu_mip_alpha_coverage(uint32_t width, uint32_t height, const uint8_t *rgba, float alphaTestRef) {
+
+	size_t count = (size_t)width * height, passed = 0;
+
+	for (size_t i = 0; i < count; i++)
+		passed += (rgba[i * 4 + 3] / 255.0f > alphaTestRef) ? 1 : 0;
+
+	return (count) ? (float)passed / (float)count : 0.0f;
+}
+
+
+void gu_mip_generate(uint32_t width, uint32_t height, const uint8_t *rgba, const gu_mip_options& options, vector<vector<uint8_t> >& mips) {
+
+	size_t count = (size_t)width * height;
+
+	mips.resize(gu_mip_count(width, height));
+	mips[0].assign(rgba, rgba + count * 4);
+
+	// Decode mip 0 to linear floats
+	vector<float> level(count * 4), next;
+
+	for (size_t i = 0; i < count * 4; i++) {
+
+		bool alpha = (i & 3) == 3;
+
+		if (alpha || options.content == gu_mip_linear)
+			level[i] = rgba[i] / 255.0f;
+		else if (options.content == gu_mip_colour)
+			level[i] = srgb.toLinear[rgba[i]];
+		else
+			level[i] = rgba[i] * (2.0f / 255.0f) - 1.0f;
+	}
+
+	float coverage = (options.alphaTestRef > 0.0f) ? gu_mip_alpha_coverage(width, height, rgba, options.alphaTestRef) : 0.0f;
+
+	for (size_t m = 1; m < mips.size(); m++) {
+
+		uint32_t w = max(width >> 1, 1u), h = max(height >> 1, 1u);
+
+		filterLevel(width, height, level.data(), w, h, options.filter, next);
+		level.swap(next);
+
+		// Levels keep unscaled alpha so the scale of one level does not feed into the next
+		float alphaScale = (options.alphaTestRef > 0.0f) ? coverageScale(level, options.alphaTestRef, coverage) : 1.0f;
+
+		encodeLevel(level, options.content, alphaScale, mips[m]);
+
+		width = w;
+		height = h;
+	}
+}
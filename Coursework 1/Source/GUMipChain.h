@@ -0,0 +1,50 @@
+//
+// GUMipChain.h
+//
+
+// CPU mip chain generation for RGBA8 images, used when textures are loaded (see Texture) and by the offline compressor (see CGDTextureCompressor) so mips do not depend on ID3D11DeviceContext::GenerateMips.  Each level is filtered from the previous level, kept as floats, with a separable box or Kaiser windowed sinc filter (4 channels of a texel per SSE register).  Colour images are filtered in linear space (sRGB is decoded first and encoded again when the level is written), normal maps are filtered as vectors and renormalised and alpha can be rescaled per level so the fraction of texels that pass an alpha test matches mip 0 - without this alpha tested foliage thins out and disappears in the distance.
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+
+typedef enum {
+
+	gu_mip_box = 0, // 2x2 average (for even sizes)
+	gu_mip_kaiser // Kaiser windowed sinc - sharper mips with less aliasing
+
+} gu_mip_filter;
+
+
+// How the RGB channels are interpreted.  Alpha is always linear
+typedef enum {
+
+	gu_mip_colour = 0, // sRGB colour
+	gu_mip_linear, // data such as height maps - filtered as stored
+	gu_mip_normal // tangent space normals stored as n * 0.5 + 0.5
+
+} gu_mip_content;
+
+
+struct gu_mip_options {
+
+	gu_mip_filter		filter = gu_mip_kaiser;
+	gu_mip_content		content = gu_mip_colour;
+	float				alphaTestRef = 0.0f; // alpha test reference whose coverage is preserved in every mip (0 = alpha is filtered like the other channels)
+};
+
+
+// Number of mips in the full chain of a width x height image (down to 1x1)
+uint32_t gu_mip_count(uint32_t width, uint32_t height);
+
+// Options for an image - gu_mip_normal for normal maps (file names containing "normal"), gu_mip_linear for greyscale images and gu_mip_colour otherwise.  Images with transparent texels preserve alpha test coverage at 0.5
+gu_mip_options gu_mip_default_options(const char *filename, uint32_t width, uint32_t height, const uint8_t *rgba);
+
+// Fraction of the texels of a width x height RGBA8 image with alpha above alphaTestRef
+float gu_mip_alpha_coverage(uint32_t width, uint32_t height, const uint8_t *rgba, float alphaTestRef);
+
+// Build the full mip chain of a width x height RGBA8 image (rows width * 4 bytes apart).  mips[0] is a copy of rgba and mips[i] is max(width >> i, 1) x max(height >> i, 1)
+void gu_mip_generate(uint32_t width, uint32_t height, const uint8_t *rgba, const gu_mip_options& options, std::vector<std::vector<uint8_t> >& mips);
@@ -0,0 +1,154 @@
+//
+// GUObjectPool.h
+//
+
+// Fixed-size object pool.  Objects of type T are allocated from chunks of objectsPerChunk slots.  Free slots are kept on an intrusive free list so create and destroy are O(1) and make no heap allocations once the pool has grown to its working size.  Chunks are obtained from the tracked heap (see GUMemory) and attributed to the pool's memory tag, and are only released when the pool is destroyed.  Intended for large numbers of small, frequently created objects such as particles and scene nodes.
+//
+// GUObjectPool is not thread-safe.
+
+#pragma once
+
+#include <GUMemory.h>
+#include <cstdint>
+#include <iostream>
+#include <type_traits>
+#include <utility>
+
+
+template <typename T>
+class GUObjectPool {
+
+	// A slot either holds a T or, when free, a pointer to the next free slot
+	union Slot {
+
+		Slot				*next;
+		typename std::aligned_storage<sizeof(T), std::alignment_of<T>::value>::type		storage;
+	};
+
+	// Chunk header - the chunk's slots follow the header
+	struct Chunk {
+
+		Chunk				*next;
+	};
+
+	static const size_t		slotAlignment = (std::alignment_of<Slot>::value > 16) ? std::alignment_of<Slot>::value : 16;
+	static const size_t		headerSize = (sizeof(Chunk) + slotAlignment - 1) & ~(slotAlignment - 1);
+
+	Chunk					*chunks = nullptr;
+	Slot					*freeList = nullptr;
+
+	size_t					objectsPerChunk;
+	gu_memory_tag			tag;
+
+	size_t					numLive = 0;
+	size_t					numSlots = 0;
+	size_t					peakLive = 0;
+
+
+	// Add a chunk of free slots to the pool.  Return false if the chunk cannot be allocated
+	bool grow() {
+
+		GU_MEMORY_TAG_SCOPE(tag);
+
+		Chunk *chunk = (Chunk*)gu_aligned_malloc(headerSize + objectsPerChunk * sizeof(Slot), slotAlignment);
+
+		if (!chunk)
+			return false;
+
+		chunk->next = chunks;
+		chunks = chunk;
+
+		Slot *slots = (Slot*)((char*)chunk + headerSize);
+
+		// Thread the new slots onto the free list in address order
+		for (size_t i = objectsPerChunk; i > 0; i--) {
+
+			slots[i - 1].next = freeList;
+			freeList = &slots[i - 1];
+		}
+
+		numSlots += objectsPerChunk;
+
+		return true;
+	}
+
+public:
+
+	GUObjectPool(size_t _objectsPerChunk = 256, gu_memory_tag _tag = gu_mem_arena) {
+
+		objectsPerChunk = (_objectsPerChunk > 0) ? _objectsPerChunk : 1;
+		tag = _tag;
+	}
+
+	// Destructor.  Live objects are not destroyed - all objects should be returned with destroy before the pool is disposed of
+	~GUObjectPool() {
+
+		if (numLive > 0)
+			std::cout << "GUObjectPool destroyed with " << numLive << " live object(s)\n";
+
+		while (chunks) {
+
+			Chunk *next = chunks->next;
+
+			gu_aligned_free(chunks);
+			chunks = next;
+		}
+	}
+
+	// Ensure at least count objects can be created without further chunk allocation
+	bool reserve(size_t count) {
+
+		while (numSlots < count) {
+
+			if (!grow())
+				return false;
+		}
+
+		return true;
+	}
+
+	// Construct a new object from the given arguments.  Return nullptr if the pool cannot grow
+	template <typename... Args>
+	T* create(Args&&... args) {
+
+		if (!freeList && !grow())
+			return nullptr;
+
+		Slot *slot = freeList;
+
+		freeList = slot->next;
+
+		numLive++;
+
+		if (numLive > peakLive)
+			peakLive = numLive;
+
+		return new(&slot->storage) T(std::forward<Args>(args)...);
+	}
+
+	// Destroy an object created by this pool
+	void destroy(T *obj) {
+
+		if (!obj)
+			return;
+
+		obj->~T();
+
+		Slot *slot = (Slot*)obj;
+
+		slot->next = freeList;
+		freeList = slot;
+
+		numLive--;
+	}
+
+	// Query methods
+	size_t size() const { return numLive; }
+	size_t capacity() const { return numSlots; }
+	size_t peakSize() const { return peakLive; }
+
+private:
+
+	GUObjectPool(const GUObjectPool&);
+	GUObjectPool& operator=(const GUObjectPool&);
+};
@@ -0,0 +1,651 @@
+
+//
+// GUPNGReader.cpp
+//
+
+#include <stdafx.h>
+#include <GUPNGReader.h>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+using namespace std;
+
+
+// Deflate length and distance code tables (RFC 1951 3.2.5)
+static const uint16_t			lengthBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+static const uint8_t			lengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+static const uint16_t			distanceBase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+static const uint8_t			distanceExtra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+// Order of the code length code lengths in a dynamic block header
+static const uint8_t			codeLengthOrder[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+// Huffman codes up to fastBits long are decoded with a single table lookup
+static const uint32_t			fastBits = 9;
+
+// Larger images are rejected rather than allocated (D3D11 textures are limited to 16384 texels a side)
+static const uint32_t			maxDimension = 16384;
+
+// Adam7 pass origins and spacing
+static const uint32_t			adam7X[7] = { 0, 4, 0, 2, 0, 1, 0 };
+static const uint32_t			adam7Y[7] = { 0, 0, 4, 0, 2, 0, 1 };
+static const uint32_t			adam7DX[7] = { 8, 8, 4, 4, 2, 2, 1 };
+static const uint32_t			adam7DY[7] = { 8, 8, 8, 4, 4, 2, 2 };
+
+
+// Canonical Huffman code.  fast[bits] holds symbol | (length << 9) for codes of at most fastBits (0 if the code is longer)
+struct HuffmanTable {
+
+	uint16_t			fast[1 << fastBits];
+	uint16_t			count[16]; // codes per length
+	uint16_t			symbols[288]; // in canonical order
+};
+
+
+// LSB-first bit stream over the concatenated IDAT data.  Reads past the end return zero bits and set overrun
+struct BitReader {
+
+	const uint8_t		*p;
+	const uint8_t		*end;
+	uint32_t			bits = 0;
+	uint32_t			count = 0;
+	bool				overrun = false;
+
+	BitReader(const uint8_t *data, size_t size) : p(data), end(data + size) {}
+
+	void fill() {
+
+		while (count <= 24) {
+
+			uint32_t byte = 0;
+
+			if (p < end)
+				byte = *p++;
+			else
+				overrun = true;
+
+			bits |= byte << count;
+			count += 8;
+		}
+	}
+
+	uint32_t get(uint32_t n) {
+
+		if (n == 0)
+			return 0;
+
+		fill();
+
+		uint32_t value = bits & ((1u << n) - 1);
+
+		bits >>= n;
+		count -= n;
+
+		return value;
+	}
+
+	void alignToByte() {
+
+		bits >>= count & 7;
+		count -= count & 7;
+	}
+};
+
+
+// Build a table from code lengths.  Return false if the lengths over-subscribe the code
+static bool buildTable(const uint8_t *lengths, uint32_t n, HuffmanTable& table) {
+
+	uint16_t offsets[16];
+
+	memset(table.fast, 0, sizeof(table.fast));
+	memset(table.count, 0, sizeof(table.count));
+
+	for (uint32_t i = 0; i < n; i++)
+		table.count[lengths[i]]++;
+
+	table.count[0] = 0;
+
+	int left = 1;
+
+	for (uint32_t len = 1; len < 16; len++) {
+
+		left = (left << 1) - table.count[len];
+
+		if (left < 0)
+			return false;
+	}
+
+	offsets[1] = 0;
+
+	for (uint32_t len = 1; len < 15; len++)
+		offsets[len + 1] = offsets[len] + table.count[len];
+
+	for (uint32_t i = 0; i < n; i++) {
+
+		if (lengths[i])
+			table.symbols[offsets[lengths[i]]++] = (uint16_t)i;
+	}
+
+	// Fast table - codes are assigned in canonical order and stored bit reversed in the stream
+	uint32_t code = 0, index = 0;
+
+	for (uint32_t len = 1; len <= fastBits; len++) {
+
+		for (uint32_t i = 0; i < table.count[len]; i++, code++, index++) {
+
+			uint32_t reversed = 0;
+
+			for (uint32_t b = 0; b < len; b++)
+				reversed |= ((code >> b) & 1) << (len - 1 - b);
+
+			for (uint32_t fill = reversed; fill < (1u << fastBits); fill += 1u << len)
+				table.fast[fill] = (uint16_t)(table.symbols[index] | (len << 9));
+		}
+
+		code <<= 1;
+	}
+
+	return true;
+}
+
+
+// Decode one symbol.  Return -1 for an invalid code
+static int decodeSymbol(BitReader& reader, const HuffmanTable& table) {
+
+	reader.fill();
+
+	uint32_t entry = table.fast[reader.bits & ((1 << fastBits) - 1)];
+
+	if (entry) {
+
+		reader.bits >>= entry >> 9;
+		reader.count -= entry >> 9;
+
+		return entry & 511;
+	}
+
+	// Longer codes one bit at a time
+	int code = 0, first = 0, index = 0;
+
+	for (uint32_t len = 1; len < 16; len++) {
+
+		code |= (int)reader.get(1);
+
+		int count = table.count[len];
+
+		if (code - count < first)
+			return table.symbols[index + (code - first)];
+
+		index += count;
+		first = (first + count) << 1;
+		code <<= 1;
+	}
+
+	return -1;
+}
+
+
+static bool inflateBlock(BitReader& reader, const HuffmanTable& literals, const HuffmanTable& distances, vector<uint8_t>& output) {
+
+	for (;;) {
+
+		int symbol = decodeSymbol(reader, literals);
+
+		if (symbol < 0 || reader.overrun)
+			return false;
+
+		if (symbol < 256) {
+
+			output.push_back((uint8_t)symbol);
+			continue;
+		}
+
+		if (symbol == 256)
+			return true;
+
+		symbol -= 257;
+
+		if (symbol >= 29)
+			return false;
+
+		uint32_t length = lengthBase[symbol] + reader.get(lengthExtra[symbol]);
+		int distanceSymbol = decodeSymbol(reader, distances);
+
+		if (distanceSymbol < 0 || distanceSymbol >= 30)
+			return false;
+
+		size_t distance = distanceBase[distanceSymbol] + reader.get(distanceExtra[distanceSymbol]);
+
+		if (distance > output.size())
+			return false;
+
+		// Matches may overlap the bytes they produce
+		size_t from = output.size() - distance;
+
+		for (uint32_t i = 0; i < length; i++)
+			output.push_back(output[from + i]);
+	}
+}
+
+
+// Decompress a zlib stream (RFC 1950) into output
+static bool inflate(const uint8_t *data, size_t size, vector<uint8_t>& output) {
+
+	if (size < 2 || (data[0] & 15) != 8 || ((data[0] << 8) | data[1]) % 31 != 0 || (data[1] & 0x20))
+		return false;
+
+	BitReader reader(data + 2, size - 2);
+	HuffmanTable literals, distances;
+	bool last = false;
+
+	while (!last) {
+
+		last = reader.get(1) != 0;
+
+		uint32_t type = reader.get(2);
+
+		if (type == 0) {
+
+			// Stored block
+			reader.alignToByte();
+
+			uint32_t length = reader.get(16);
+
+			if ((reader.get(16) ^ 0xFFFF) != length)
+				return false;
+
+			for (uint32_t i = 0; i < length; i++)
+				output.push_back((uint8_t)reader.get(8));
+
+			if (reader.overrun)
+				return false;
+
+		} else if (type == 1) {
+
+			uint8_t lengths[288];
+
+			for (uint32_t i = 0; i < 288; i++)
+				lengths[i] = (i < 144) ? 8 : (i < 256) ? 9 : (i < 280) ? 7 : 8;
+
+			buildTable(lengths, 288, literals);
+
+			for (uint32_t i = 0; i < 30; i++)
+				lengths[i] = 5;
+
+			buildTable(lengths, 30, distances);
+
+			if (!inflateBlock(reader, literals, distances, output))
+				return false;
+
+		} else if (type == 2) {
+
+			uint32_t literalCount = reader.get(5) + 257;
+			uint32_t distanceCount = reader.get(5) + 1;
+			uint32_t codeLengthCount = reader.get(4) + 4;
+			uint8_t codeLengths[19] = {};
+			uint8_t lengths[288 + 32];
+			HuffmanTable codeLengthTable;
+
+			for (uint32_t i = 0; i < codeLengthCount; i++)
+				codeLengths[codeLengthOrder[i]] = (uint8_t)reader.get(3);
+
+			if (!buildTable(codeLengths, 19, codeLengthTable))
+				return false;
+
+			for (uint32_t i = 0; i < literalCount + distanceCount;) {
+
+				int symbol = decodeSymbol(reader, codeLengthTable);
+				uint32_t repeat;
+				uint8_t value = 0;
+
+				if (symbol < 0)
+					return false;
+
+				if (symbol < 16) {
+
+					lengths[i++] = (uint8_t)symbol;
+					continue;
+				}
+
+				if (symbol == 16) {
+
+					if (i == 0)
+						return false;
+
+					value = lengths[i - 1];
+					repeat = 3 + reader.get(2);
+
+				} else if (symbol == 17) {
+
+					repeat = 3 + reader.get(3);
+
+				} else {
+
+					repeat = 11 + reader.get(7);
+				}
+
+				if (i + repeat > literalCount + distanceCount)
+					return false;
+
+				while (repeat--)
+					lengths[i++] = value;
+			}
+
+			if (!buildTable(lengths, literalCount, literals) || !buildTable(lengths + literalCount, distanceCount, distances))
+				return false;
+
+			if (!inflateBlock(reader, literals, distances, output))
+				return false;
+
+		} else {
+
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+static inline uint32_t readUInt32BE(const uint8_t *p) {
+
+	return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+
+static inline uint8_t paeth(int a, int b, int c) {
+
+	int p = a + b - c;
+	int pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+
+	return (uint8_t)((pa <= pb && pa <= pc) ? a : (pb <= pc) ? b : c);
+}
+
+
+// Reverse the scanline filters of a rows x rowBytes image (each row preceded by its filter type) in place.  bpp is the filter distance in bytes
+static bool unfilter(uint8_t *data, uint32_t rows, size_t rowBytes, uint32_t bpp) {
+
+	const uint8_t *prior = nullptr;
+
+	for (uint32_t y = 0; y < rows; y++) {
+
+		uint8_t filter = data[0];
+		uint8_t *row = data + 1;
+
+		for (size_t x = 0; x < rowBytes; x++) {
+
+			int a = (x >= bpp) ? row[x - bpp] : 0;
+			int b = (prior) ? prior[x] : 0;
+			int c = (prior && x >= bpp) ? prior[x - bpp] : 0;
+
+			switch (filter) {
+
+				case 0:
+					break;
+
+				case 1:
+					row[x] = (uint8_t)(row[x] + a);
+					break;
+
+				case 2:
+					row[x] = (uint8_t)(row[x] + b);
+					break;
+
+				case 3:
+					row[x] = (uint8_t)(row[x] + ((a + b) >> 1));
+					break;
+
+				case 4:
+					row[x] = (uint8_t)(row[x] + paeth(a, b, c));
+					break;
+
+				default:
+					return false;
+			}
+		}
+
+		prior = row;
+		data += rowBytes + 1;
+	}
+
+	return true;
+}
+
+
+// Image properties from IHDR, PLTE and tRNS
+struct PNGFormat {
+
+	uint32_t			width;
+	uint32_t			height;
+	uint32_t			bitDepth;
+	uint32_t			colourType;
+	uint32_t			channels;
+	uint8_t				palette[256][4];
+	bool				hasKey = false;
+	uint16_t			key[3]; // transparent grey / RGB sample for colour types 0 and 2
+};
+
+
+// Sample i (0-based) of a row at the image bit depth, scaled to 16 bits for comparison with the transparent key
+static inline uint32_t sample(const uint8_t *row, size_t i, uint32_t bitDepth) {
+
+	switch (bitDepth) {
+
+		case 16:
+			return ((uint32_t)row[i * 2] << 8) | row[i * 2 + 1];
+
+		case 8:
+			return row[i];
+
+		default: {
+
+			size_t bit = i * bitDepth;
+
+			return (row[bit >> 3] >> (8 - bitDepth - (bit & 7))) & ((1u << bitDepth) - 1);
+		}
+	}
+}
+
+
+// Convert an unfiltered row of count pixels to RGBA8, writing every step'th texel of dst
+static void convertRow(const PNGFormat& format, const uint8_t *row, uint32_t count, uint8_t *dst, uint32_t step) {
+
+	uint32_t maxValue = (1u << format.bitDepth) - 1;
+
+	for (uint32_t x = 0; x < count; x++, dst += step * 4) {
+
+		uint32_t s[4];
+
+		for (uint32_t c = 0; c < format.channels; c++)
+			s[c] = sample(row, (size_t)x * format.channels + c, format.bitDepth);
+
+		// 8 bit value of sample v
+		auto to8 = [&](uint32_t v) { return (uint8_t)((format.bitDepth == 16) ? v >> 8 : v * 255 / maxValue); };
+
+		switch (format.colourType) {
+
+			case 0:
+				dst[0] = dst[1] = dst[2] = to8(s[0]);
+				dst[3] = (format.hasKey && s[0] == format.key[0]) ? 0 : 255;
+				break;
+
+			case 2:
+				dst[0] = to8(s[0]);
+				dst[1] = to8(s[1]);
+				dst[2] = to8(s[2]);
+				dst[3] = (format.hasKey && s[0] == format.key[0] && s[1] == format.key[1] && s[2] == format.key[2]) ? 0 : 255;
+				break;
+
+			case 3:
+				memcpy(dst, format.palette[s[0] & 255], 4);
+				break;
+
+			case 4:
+				dst[0] = dst[1] = dst[2] = to8(s[0]);
+				dst[3] = to8(s[1]);
+				break;
+
+			default:
+				dst[0] = to8(s[0]);
+				dst[1] = to8(s[1]);
+				dst[2] = to8(s[2]);
+				dst[3] = to8(s[3]);
+				break;
+		}
+	}
+}
+
+
+bool gu_png_decode(const uint8_t *data, size_t size, uint32_t& width, uint32_t& height, vector<uint8_t>& rgba) {
+
+	static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+
+	if (size < 8 || memcmp(data, signature, 8) != 0)
+		return false;
+
+	PNGFormat format;
+	uint32_t interlace = 0;
+	bool header = false;
+	vector<uint8_t> compressed;
+
+	memset(format.palette, 0, sizeof(format.palette));
+
+	for (uint32_t i = 0; i < 256; i++)
+		format.palette[i][3] = 255;
+
+	// Chunks
+	for (size_t offset = 8; offset + 12 <= size;) {
+
+		uint32_t length = readUInt32BE(data + offset);
+		const uint8_t *type = data + offset + 4;
+		const uint8_t *chunk = data + offset + 8;
+
+		if (length > size - offset - 12)
+			return false;
+
+		if (memcmp(type, "IHDR", 4) == 0 && length >= 13) {
+
+			format.width = readUInt32BE(chunk);
+			format.height = readUInt32BE(chunk + 4);
+			format.bitDepth = chunk[8];
+			format.colourType = chunk[9];
+			interlace = chunk[12];
+			header = true;
+
+		} else if (memcmp(type, "PLTE", 4) == 0) {
+
+			for (uint32_t i = 0; i < length / 3 && i < 256; i++)
+				memcpy(format.palette[i], chunk + i * 3, 3);
+
+		} else if (memcmp(type, "tRNS", 4) == 0) {
+
+			if (format.colourType == 3) {
+
+				for (uint32_t i = 0; i < length && i < 256; i++)
+					format.palette[i][3] = chunk[i];
+
+			} else if (length >= 2) {
+
+				format.hasKey = true;
+
+				for (uint32_t c = 0; c < 3; c++)
+					format.key[c] = (uint16_t)((length >= c * 2 + 2) ? (chunk[c * 2] << 8) | chunk[c * 2 + 1] : 0);
+			}
+
+		} else if (memcmp(type, "IDAT", 4) == 0) {
+
+			compressed.insert(compressed.end(), chunk, chunk + length);
+
+		} else if (memcmp(type, "IEND", 4) == 0) {
+
+			break;
+		}
+
+		offset += (size_t)length + 12;
+	}
+
+	if (!header || format.width == 0 || format.height == 0 || format.width > maxDimension || format.height > maxDimension || interlace > 1)
+		return false;
+
+	switch (format.colourType) {
+
+		case 0:
+			format.channels = 1;
+			break;
+
+		case 2:
+			format.channels = 3;
+			break;
+
+		case 3:
+			format.channels = 1;
+			break;
+
+		case 4:
+			format.channels = 2;
+			break;
+
+		case 6:
+			format.channels = 4;
+			break;
+
+		default:
+			return false;
+	}
+
+	bool validDepth = (format.bitDepth == 8) || (format.bitDepth == 16 && format.colourType != 3) || ((format.bitDepth == 1 || format.bitDepth == 2 || format.bitDepth == 4) && (format.colourType == 0 || format.colourType == 3));
+
+	if (!validDepth)
+		return false;
+
+	width = format.width;
+	height = format.height;
+
+	uint32_t bitsPerPixel = format.channels * format.bitDepth;
+	uint32_t bpp = max(bitsPerPixel / 8, 1u);
+	uint32_t passes = (interlace) ? 7 : 1;
+	size_t expected = 0;
+
+	for (uint32_t pass = 0; pass < passes; pass++) {
+
+		uint32_t w = (interlace) ? (width + adam7DX[pass] - 1 - adam7X[pass]) / adam7DX[pass] : width;
+		uint32_t h = (interlace) ? (height + adam7DY[pass] - 1 - adam7Y[pass]) / adam7DY[pass] : height;
+
+		if (w && h)
+			expected += (((size_t)w * bitsPerPixel + 7) / 8 + 1) * h;
+	}
+
+	vector<uint8_t> raw;
+
+	raw.reserve(expected);
+
+	if (!inflate(compressed.data(), compressed.size(), raw) || raw.size() < expected)
+		return false;
+
+	rgba.resize((size_t)width * height * 4);
+
+	uint8_t *pass = raw.data();
+
+	for (uint32_t p = 0; p < passes; p++) {
+
+		uint32_t x0 = (interlace) ? adam7X[p] : 0, y0 = (interlace) ? adam7Y[p] : 0;
+		uint32_t dx = (interlace) ? adam7DX[p] : 1, dy = (interlace) ? adam7DY[p] : 1;
+		uint32_t w = (width + dx - 1 - x0) / dx, h = (height + dy - 1 - y0) / dy;
+
+		if (x0 >= width || y0 >= height || w == 0 || h == 0)
+			continue;
+
+		size_t rowBytes = ((size_t)w * bitsPerPixel + 7) / 8;
+
+		if (!unfilter(pass, h, rowBytes, bpp))
+			return false;
+
+		for (uint32_t y = 0; y < h; y++)
+			convertRow(format, pass + y * (rowBytes + 1) + 1, w, rgba.data() + (((size_t)(y0 + y * dy)) * width + x0) * 4, dx);
+
+		pass += (rowBytes + 1) * h;
+	}
+
+	return true;
+}
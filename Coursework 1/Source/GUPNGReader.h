@@ -0,0 +1,15 @@
+//
+// GUPNGReader.h
+//
+
+// Self-contained PNG decoder (no zlib dependency) - the counterpart of GUPNGWriter used by the portable image decoder (see GUImageDecoder).  Supports every standard colour type and bit depth (16-bit samples are reduced to 8 bits), palettes and tRNS transparency and Adam7 interlacing.  Chunk CRCs and the zlib checksum are not verified.
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+
+// Decode a PNG file in memory (size bytes) into rgba (width * 4 bytes per row, top row first).  Return false if data is not a PNG file or is corrupt
+bool gu_png_decode(const uint8_t *data, size_t size, uint32_t& width, uint32_t& height, std::vector<uint8_t>& rgba);
@@ -0,0 +1,384 @@
+
+//
+// GUPNGWriter.cpp
+//
+
+#include <stdafx.h>
+#include <GUPNGWriter.h>
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+
+using namespace std;
+
+
+// LZ77 parameters
+static const uint32_t			windowSize = 32768;
+static const uint32_t			hashBits = 15;
+static const uint32_t			maxChainLength = 32;
+static const uint32_t			minMatch = 3;
+static const uint32_t			maxMatch = 258;
+
+
+// Deflate length and distance code tables (RFC 1951 3.2.5)
+static const uint16_t			lengthBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+static const uint8_t			lengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+static const uint16_t			distanceBase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+static const uint8_t			distanceExtra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+
+// LSB-first bit stream
+struct BitWriter {
+
+	vector<uint8_t>			&output;
+	uint32_t				bits = 0;
+	uint32_t				count = 0;
+
+	BitWriter(vector<uint8_t>& _output) : output(_output) {}
+
+	void put(uint32_t value, uint32_t n) {
+
+		bits |= value << count;
+		count += n;
+
+		while (count >= 8) {
+
+			output.push_back((uint8_t)bits);
+			bits >>= 8;
+			count -= 8;
+		}
+	}
+
+	// Huffman codes are sent most significant bit first
+	void putCode(uint32_t code, uint32_t length) {
+
+		uint32_t reversed = 0;
+
+		for (uint32_t i = 0; i < length; i++)
+			reversed |= ((code >> i) & 1) << (length - 1 - i);
+
+		put(reversed, length);
+	}
+
+	void flush() {
+
+		if (count > 0)
+			output.push_back((uint8_t)bits);
+
+		bits = 0;
+		count = 0;
+	}
+};
+
+
+// Fixed Huffman literal / length code
+static void putLiteralLength(BitWriter& writer, uint32_t symbol) {
+
+	if (symbol < 144)
+		writer.putCode(0x30 + symbol, 8);
+	else if (symbol < 256)
+		writer.putCode(0x190 + (symbol - 144), 9);
+	else if (symbol < 280)
+		writer.putCode(symbol - 256, 7);
+	else
+		writer.putCode(0xC0 + (symbol - 280), 8);
+}
+
+
+static void putMatch(BitWriter& writer, uint32_t length, uint32_t distance) {
+
+	uint32_t l = 28;
+
+	while (lengthBase[l] > length)
+		l--;
+
+	putLiteralLength(writer, 257 + l);
+	writer.put(length - lengthBase[l], lengthExtra[l]);
+
+	uint32_t d = 29;
+
+	while (distanceBase[d] > distance)
+		d--;
+
+	writer.putCode(d, 5);
+	writer.put(distance - distanceBase[d], distanceExtra[d]);
+}
+
+
+static inline uint32_t hash3(const uint8_t *p) {
+
+	return ((p[0] << 16 | p[1] << 8 | p[2]) * 2654435761u) >> (32 - hashBits);
+}
+
+
+// zlib stream (RFC 1950) holding one fixed-Huffman deflate block
+static void deflate(const vector<uint8_t>& data, vector<uint8_t>& output) {
+
+	// CMF = deflate with a 32K window, FLG = no dictionary, fastest compression level (header check bits make it a multiple of 31)
+	output.push_back(0x78);
+	output.push_back(0x01);
+
+	BitWriter writer(output);
+
+	writer.put(1, 1); // BFINAL
+	writer.put(1, 2); // BTYPE = fixed Huffman
+
+	vector<int32_t> head((size_t)1 << hashBits, -1);
+	vector<int32_t> previous(data.size(), -1);
+
+	size_t n = data.size();
+	size_t i = 0;
+
+	while (i < n) {
+
+		uint32_t bestLength = 0;
+		uint32_t bestDistance = 0;
+
+		if (i + minMatch <= n) {
+
+			uint32_t h = hash3(&data[i]);
+			int32_t candidate = head[h];
+			uint32_t limit = (uint32_t)min((size_t)maxMatch, n - i);
+
+			for (uint32_t chain = 0; candidate >= 0 && chain < maxChainLength; chain++) {
+
+				if (i - candidate > windowSize)
+					break;
+
+				uint32_t length = 0;
+
+				while (length < limit && data[candidate + length] == data[i + length])
+					length++;
+
+				if (length > bestLength) {
+
+					bestLength = length;
+					bestDistance = (uint32_t)(i - candidate);
+
+					if (length == limit)
+						break;
+				}
+
+				candidate = previous[candidate];
+			}
+
+			previous[i] = head[h];
+			head[h] = (int32_t)i;
+		}
+
+		if (bestLength >= minMatch) {
+
+			putMatch(writer, bestLength, bestDistance);
+
+			// Insert the matched positions into the hash chains
+			for (size_t j = i + 1; j < i + bestLength && j + minMatch <= n; j++) {
+
+				uint32_t h = hash3(&data[j]);
+
+				previous[j] = head[h];
+				head[h] = (int32_t)j;
+			}
+
+			i += bestLength;
+
+		} else {
+
+			putLiteralLength(writer, data[i]);
+			i++;
+		}
+	}
+
+	putLiteralLength(writer, 256); // end of block
+	writer.flush();
+
+	// Adler-32 of the uncompressed data (big-endian)
+	uint32_t a = 1, b = 0;
+
+	for (size_t j = 0; j < n; j++) {
+
+		a = (a + data[j]) % 65521;
+		b = (b + a) % 65521;
+	}
+
+	uint32_t adler = (b << 16) | a;
+
+	output.push_back((uint8_t)(adler >> 24));
+	output.push_back((uint8_t)(adler >> 16));
+	output.push_back((uint8_t)(adler >> 8));
+	output.push_back((uint8_t)adler);
+}
+
+
+// CRC-32 lookup table, built during static initialisation so encoding is thread-safe
+struct CRCTable {
+
+	uint32_t				entries[256];
+
+	CRCTable() {
+
+		for (uint32_t n = 0; n < 256; n++) {
+
+			uint32_t c = n;
+
+			for (int k = 0; k < 8; k++)
+				c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+
+			entries[n] = c;
+		}
+	}
+};
+
+static const CRCTable			crcTable;
+
+
+static uint32_t crc32(const uint8_t *data, size_t length) {
+
+	uint32_t crc = 0xFFFFFFFF;
+
+	for (size_t i = 0; i < length; i++)
+		crc = crcTable.entries[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+
+	return ~crc;
+}
+
+
+static void putUInt32(vector<uint8_t>& output, uint32_t v) {
+
+	output.push_back((uint8_t)(v >> 24));
+	output.push_back((uint8_t)(v >> 16));
+	output.push_back((uint8_t)(v >> 8));
+	output.push_back((uint8_t)v);
+}
+
+
+static void putChunk(vector<uint8_t>& output, const char type[4], const uint8_t *data, size_t length) {
+
+	putUInt32(output, (uint32_t)length);
+
+	size_t start = output.size();
+
+	output.insert(output.end(), type, type + 4);
+
+	if (length > 0)
+		output.insert(output.end(), data, data + length);
+
+	putUInt32(output, crc32(&output[start], length + 4));
+}
+
+
+static inline uint8_t paeth(uint8_t a, uint8_t b, uint8_t c) {
+
+	int p = (int)a + (int)b - (int)c;
+	int pa = abs(p - (int)a), pb = abs(p - (int)b), pc = abs(p - (int)c);
+
+	return (pa <= pb && pa <= pc) ? a : ((pb <= pc) ? b : c);
+}
+
+
+bool gu_png_encode(uint32_t width, uint32_t height, const uint8_t *rgba, size_t stride, vector<uint8_t>& output) {
+
+	if (width == 0 || height == 0 || !rgba)
+		return false;
+
+	const size_t rowBytes = (size_t)width * 4;
+
+	// Filter each scanline, choosing the filter with the smallest sum of absolute (signed) residuals
+	vector<uint8_t> filtered;
+	vector<uint8_t> candidate[5];
+	vector<uint8_t> zeroRow(rowBytes, 0);
+
+	filtered.reserve((rowBytes + 1) * height);
+
+	for (int f = 0; f < 5; f++)
+		candidate[f].resize(rowBytes);
+
+	for (uint32_t y = 0; y < height; y++) {
+
+		const uint8_t *row = rgba + y * stride;
+		const uint8_t *above = (y > 0) ? rgba + (y - 1) * stride : zeroRow.data();
+
+		uint32_t bestFilter = 0;
+		uint64_t bestScore = ~0ull;
+
+		for (uint32_t f = 0; f < 5; f++) {
+
+			uint8_t *out = candidate[f].data();
+			uint64_t score = 0;
+
+			for (size_t x = 0; x < rowBytes; x++) {
+
+				uint8_t a = (x >= 4) ? row[x - 4] : 0;
+				uint8_t b = above[x];
+				uint8_t c = (x >= 4) ? above[x - 4] : 0;
+				uint8_t predictor = 0;
+
+				switch (f) {
+
+					case 1: predictor = a; break;
+					case 2: predictor = b; break;
+					case 3: predictor = (uint8_t)(((uint32_t)a + (uint32_t)b) / 2); break;
+					case 4: predictor = paeth(a, b, c); break;
+				}
+
+				out[x] = (uint8_t)(row[x] - predictor);
+				score += (out[x] < 128) ? out[x] : 256 - out[x];
+			}
+
+			if (score < bestScore) {
+
+				bestScore = score;
+				bestFilter = f;
+			}
+		}
+
+		filtered.push_back((uint8_t)bestFilter);
+		filtered.insert(filtered.end(), candidate[bestFilter].begin(), candidate[bestFilter].end());
+	}
+
+	static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+
+	output.assign(signature, signature + 8);
+
+	// IHDR - 8 bits per channel, colour type 6 (RGBA), deflate, adaptive filtering, no interlace
+	uint8_t header[13];
+
+	header[0] = (uint8_t)(width >> 24); header[1] = (uint8_t)(width >> 16); header[2] = (uint8_t)(width >> 8); header[3] = (uint8_t)width;
+	header[4] = (uint8_t)(height >> 24); header[5] = (uint8_t)(height >> 16); header[6] = (uint8_t)(height >> 8); header[7] = (uint8_t)height;
+	header[8] = 8;
+	header[9] = 6;
+	header[10] = 0;
+	header[11] = 0;
+	header[12] = 0;
+
+	putChunk(output, "IHDR", header, 13);
+
+	vector<uint8_t> compressed;
+
+	deflate(filtered, compressed);
+
+	putChunk(output, "IDAT", compressed.data(), compressed.size());
+	putChunk(output, "IEND", nullptr, 0);
+
+	return true;
+}
+
+
+bool gu_png_write(const char *filename, uint32_t width, uint32_t height, const uint8_t *rgba, size_t stride) {
+
+	vector<uint8_t> png;
+
+	if (!gu_png_encode(width, height, rgba, stride, png))
+		return false;
+
+	ofstream file(filename, ios::out | ios::binary);
+
+	if (!file.is_open()) {
+
+		cout << "Cannot open " << filename << " for writing\n";
+		return false;
+	}
+
+	file.write((const char*)png.data(), png.size());
+
+	return file.good();
+}
@@ -0,0 +1,18 @@
+//
+// GUPNGWriter.h
+//
+
+// Minimal PNG encoder for 8-bit RGBA images (rendered frames for regression tests and benchmarks).  Each scanline uses the filter (None, Sub, Up, Average or Paeth) with the smallest sum of absolute differences and the filtered data is compressed with a single fixed-Huffman deflate block using hash-chain LZ77 matching, so the encoder is self-contained (no zlib dependency) and the output is byte-for-byte deterministic.
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+
+// Encode a width x height RGBA8 image (rows stride bytes apart) as a PNG file in output.  Return false if the image is empty
+bool gu_png_encode(uint32_t width, uint32_t height, const uint8_t *rgba, size_t stride, std::vector<uint8_t>& output);
+
+// Encode and write to filename.  Return false on failure
+bool gu_png_write(const char *filename, uint32_t width, uint32_t height, const uint8_t *rgba, size_t stride);
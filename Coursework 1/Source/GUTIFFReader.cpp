@@ -0,0 +1,337 @@
+
+//
+// GUTIFFReader.cpp
+//
+
+#include <stdafx.h>
+#include <GUTIFFReader.h>
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+
+
+// Tags
+static const uint32_t			tagWidth = 256;
+static const uint32_t			tagHeight = 257;
+static const uint32_t			tagBitsPerSample = 258;
+static const uint32_t			tagCompression = 259;
+static const uint32_t			tagPhotometric = 262;
+static const uint32_t			tagStripOffsets = 273;
+static const uint32_t			tagSamplesPerPixel = 277;
+static const uint32_t			tagRowsPerStrip = 278;
+static const uint32_t			tagStripByteCounts = 279;
+static const uint32_t			tagPlanarConfig = 284;
+static const uint32_t			tagPredictor = 317;
+static const uint32_t			tagColourMap = 320;
+
+static const uint32_t			compressionNone = 1;
+static const uint32_t			compressionLZW = 5;
+static const uint32_t			compressionPackBits = 32773;
+
+static const uint32_t			photometricWhiteIsZero = 0;
+static const uint32_t			photometricBlackIsZero = 1;
+static const uint32_t			photometricRGB = 2;
+static const uint32_t			photometricPalette = 3;
+
+// Field types
+static const uint32_t			typeShort = 3;
+static const uint32_t			typeLong = 4;
+
+// Larger images are rejected rather than allocated (D3D11 textures are limited to 16384 texels a side)
+static const uint32_t			maxDimension = 16384;
+
+
+struct TIFFReader {
+
+	const uint8_t		*data;
+	size_t				size;
+	bool				bigEndian;
+
+	uint32_t uint16(size_t offset) const {
+
+		if (offset + 2 > size)
+			return 0;
+
+		return (bigEndian) ? (data[offset] << 8) | data[offset + 1] : data[offset] | (data[offset + 1] << 8);
+	}
+
+	uint32_t uint32(size_t offset) const {
+
+		if (offset + 4 > size)
+			return 0;
+
+		return (bigEndian) ? ((uint32_t)data[offset] << 24) | (data[offset + 1] << 16) | (data[offset + 2] << 8) | data[offset + 3] : data[offset] | (data[offset + 1] << 8) | (data[offset + 2] << 16) | ((uint32_t)data[offset + 3] << 24);
+	}
+};
+
+
+// An IFD entry - count values of type stored inline or at an offset
+struct Field {
+
+	uint32_t			type = 0;
+	uint32_t			count = 0;
+	size_t				offset = 0; // of the first value
+
+	uint32_t value(const TIFFReader& reader, uint32_t i) const {
+
+		if (i >= count)
+			return 0;
+
+		return (type == typeShort) ? reader.uint16(offset + i * 2) : (type == typeLong) ? reader.uint32(offset + i * 4) : 0;
+	}
+};
+
+
+static void unpackBits(const uint8_t *src, size_t size, vector<uint8_t>& out, size_t expected) {
+
+	for (size_t i = 0; i < size && out.size() < expected;) {
+
+		int n = (int8_t)src[i++];
+
+		if (n >= 0) {
+
+			size_t count = min((size_t)n + 1, size - i);
+
+			out.insert(out.end(), src + i, src + i + count);
+			i += count;
+
+		} else if (n != -128 && i < size) {
+
+			out.insert(out.end(), (size_t)(1 - n), src[i++]);
+		}
+	}
+}
+
+
+// TIFF LZW (MSB-first codes of 9 to 12 bits, code width grows one code early)
+static bool lzwDecode(const uint8_t *src, size_t size, vector<uint8_t>& out, size_t expected) {
+
+	static const uint32_t clearCode = 256, endCode = 257;
+
+	vector<uint16_t> prefix(4096);
+	vector<uint8_t> suffix(4096), first(4096);
+	vector<uint8_t> stack(4096);
+	uint32_t width = 9, next = 258, bitCount = 0;
+	int previous = -1;
+	uint64_t bitBuffer = 0;
+
+	for (uint32_t i = 0; i < 256; i++) {
+
+		suffix[i] = (uint8_t)i;
+		first[i] = (uint8_t)i;
+	}
+
+	size_t position = 0;
+
+	while (out.size() < expected) {
+
+		while (bitCount < width) {
+
+			bitBuffer = (bitBuffer << 8) | ((position < size) ? src[position] : 0);
+			position++;
+			bitCount += 8;
+		}
+
+		uint32_t code = (uint32_t)(bitBuffer >> (bitCount - width)) & ((1u << width) - 1);
+
+		bitCount -= width;
+
+		if (code == endCode || position > size + 2)
+			break;
+
+		if (code == clearCode) {
+
+			width = 9;
+			next = 258;
+			previous = -1;
+			continue;
+		}
+
+		if (previous < 0) {
+
+			if (code > 255)
+				return false;
+
+			out.push_back((uint8_t)code);
+			previous = (int)code;
+			continue;
+		}
+
+		if (code > next || next >= 4096)
+			return false;
+
+		// The string for code == next is previous followed by its own first byte
+		uint32_t c = (code == next) ? (uint32_t)previous : code;
+		size_t depth = 0;
+
+		if (code == next)
+			stack[depth++] = first[previous];
+
+		for (; c >= 258; c = prefix[c])
+			stack[depth++] = suffix[c];
+
+		stack[depth++] = (uint8_t)c;
+
+		while (depth)
+			out.push_back(stack[--depth]);
+
+		prefix[next] = (uint16_t)previous;
+		suffix[next] = first[(code == next) ? previous : code];
+		first[next] = first[previous];
+		next++;
+
+		if (next + 1 >= (1u << width) && width < 12)
+			width++;
+
+		previous = (int)code;
+	}
+
+	return true;
+}
+
+
+bool gu_tiff_decode(const uint8_t *data, size_t size, uint32_t& width, uint32_t& height, vector<uint8_t>& rgba) {
+
+	if (size < 8 || !((data[0] == 'I' && data[1] == 'I') || (data[0] == 'M' && data[1] == 'M')))
+		return false;
+
+	TIFFReader reader = { data, size, data[0] == 'M' };
+
+	if (reader.uint16(2) != 42)
+		return false;
+
+	size_t ifd = reader.uint32(4);
+	uint32_t entries = reader.uint16(ifd);
+	Field fields[tagColourMap + 1 - tagWidth];
+
+	if (ifd + 2 + (size_t)entries * 12 > size)
+		return false;
+
+	for (uint32_t i = 0; i < entries; i++) {
+
+		size_t entry = ifd + 2 + (size_t)i * 12;
+		uint32_t tag = reader.uint16(entry);
+
+		if (tag < tagWidth || tag > tagColourMap)
+			continue;
+
+		Field& field = fields[tag - tagWidth];
+
+		field.type = reader.uint16(entry + 2);
+		field.count = reader.uint32(entry + 4);
+
+		size_t valueBytes = (size_t)field.count * ((field.type == typeLong) ? 4 : 2);
+
+		field.offset = (valueBytes <= 4) ? entry + 8 : reader.uint32(entry + 8);
+
+		if (field.offset + valueBytes > size)
+			return false;
+	}
+
+	auto field = [&](uint32_t tag) -> const Field& { return fields[tag - tagWidth]; };
+	auto value = [&](uint32_t tag, uint32_t defaultValue) { return (field(tag).count) ? field(tag).value(reader, 0) : defaultValue; };
+
+	width = value(tagWidth, 0);
+	height = value(tagHeight, 0);
+
+	uint32_t samples = value(tagSamplesPerPixel, 1);
+	uint32_t compression = value(tagCompression, compressionNone);
+	uint32_t photometric = value(tagPhotometric, photometricBlackIsZero);
+	uint32_t rowsPerStrip = min(value(tagRowsPerStrip, height), height);
+	uint32_t predictor = value(tagPredictor, 1);
+	const Field& offsets = field(tagStripOffsets);
+	const Field& byteCounts = field(tagStripByteCounts);
+
+	for (uint32_t i = 0; i < samples; i++) {
+
+		if (field(tagBitsPerSample).count && field(tagBitsPerSample).value(reader, min(i, field(tagBitsPerSample).count - 1)) != 8)
+			return false;
+	}
+
+	bool supported = width > 0 && height > 0 && width <= maxDimension && height <= maxDimension && rowsPerStrip > 0 && samples >= 1 && samples <= 4 && value(tagPlanarConfig, 1) == 1 && offsets.count > 0 && (compression == compressionNone || compression == compressionLZW || compression == compressionPackBits) && (photometric <= photometricPalette) && (photometric != photometricPalette || (samples == 1 && field(tagColourMap).count == 768)) && (photometric != photometricRGB || samples >= 3);
+
+	if (!supported)
+		return false;
+
+	// Decompress every strip into a single chunky image
+	size_t rowBytes = (size_t)width * samples;
+	size_t expected = rowBytes * height;
+	vector<uint8_t> pixels;
+
+	pixels.reserve(expected);
+
+	uint32_t strips = (height + rowsPerStrip - 1) / rowsPerStrip;
+
+	for (uint32_t s = 0; s < strips && s < offsets.count; s++) {
+
+		size_t offset = offsets.value(reader, s);
+		size_t count = (byteCounts.count) ? byteCounts.value(reader, s) : size - offset;
+		size_t stripBytes = rowBytes * min(rowsPerStrip, height - s * rowsPerStrip);
+
+		if (offset >= size)
+			return false;
+
+		count = min(count, size - offset);
+
+		size_t start = pixels.size();
+
+		if (compression == compressionNone)
+			pixels.insert(pixels.end(), data + offset, data + offset + min(count, stripBytes));
+		else if (compression == compressionPackBits)
+			unpackBits(data + offset, count, pixels, start + stripBytes);
+		else if (!lzwDecode(data + offset, count, pixels, start + stripBytes))
+			return false;
+
+		pixels.resize(start + stripBytes, 0);
+	}
+
+	if (pixels.size() < expected)
+		return false;
+
+	if (predictor == 2) {
+
+		for (uint32_t y = 0; y < height; y++) {
+
+			uint8_t *row = pixels.data() + y * rowBytes;
+
+			for (size_t i = samples; i < rowBytes; i++)
+				row[i] = (uint8_t)(row[i] + row[i - samples]);
+		}
+	}
+
+	rgba.resize((size_t)width * height * 4);
+
+	const Field& colourMap = field(tagColourMap);
+
+	for (size_t i = 0; i < (size_t)width * height; i++) {
+
+		const uint8_t *src = pixels.data() + i * samples;
+		uint8_t *dst = rgba.data() + i * 4;
+
+		if (photometric == photometricPalette) {
+
+			// 16-bit red, green and blue tables
+			for (uint32_t c = 0; c < 3; c++)
+				dst[c] = (uint8_t)(colourMap.value(reader, c * 256 + src[0]) >> 8);
+
+			dst[3] = 255;
+
+		} else if (photometric == photometricRGB) {
+
+			dst[0] = src[0];
+			dst[1] = src[1];
+			dst[2] = src[2];
+			dst[3] = (samples > 3) ? src[3] : 255;
+
+		} else {
+
+			uint8_t grey = (photometric == photometricWhiteIsZero) ? 255 - src[0] : src[0];
+
+			dst[0] = dst[1] = dst[2] = grey;
+			dst[3] = (samples > 1) ? src[1] : 255;
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,15 @@
+//
+// GUTIFFReader.h
+//
+
+// Minimal TIFF decoder for the portable image decoder (see GUImageDecoder).  Reads the first image of little or big endian files with 8-bit greyscale, palette, RGB or RGBA samples stored in strips (chunky planar configuration), uncompressed or compressed with PackBits or LZW (with or without the horizontal predictor).  Tiled, planar and JPEG / deflate compressed files are rejected.
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+
+// Decode a TIFF file in memory (size bytes) into rgba (width * 4 bytes per row, top row first).  Alpha is 255 unless the image has an extra sample, which is used as alpha whatever its ExtraSamples type - the particle textures store their masks as unspecified extra samples.  Return false if data is not a supported TIFF file or is corrupt
+bool gu_tiff_decode(const uint8_t *data, size_t size, uint32_t& width, uint32_t& height, std::vector<uint8_t>& rgba);
@@ -3,6 +3,7 @@
 #include <Grid.h>
 #include <DXVertexExt.h>
 #include <Material.h>
+#include <GUMemoryArena.h>
 using namespace std;
 using namespace DirectX;
 
@@ -16,10 +17,15 @@ Grid::Grid(UINT widthl, UINT heightl, ID3D11Device *device, Effect *_effect, ID3
 	height = heightl;
 	numInd = ((width - 1) * 2 * 3)*(height - 1);
 	vertices = (DXVertexExt*)malloc(sizeof(DXVertexExt)*width*height);
-	indices = (UINT*)malloc(sizeof(UINT)*numInd);
+
+	// Indices are only needed until the index buffer is created
+	GUScratchScope scratch;
+	UINT *indices = scratch.allocateArray<UINT>(numInd);
 	
 	try
 	{
+		if (!vertices || !indices)
+			throw exception("Cannot create grid vertex / index arrays");
 
 		// Setup grid vertex buffer
 
@@ -90,10 +96,7 @@ Grid::Grid(UINT widthl, UINT heightl, ID3D11Device *device, Effect *_effect, ID3
 		if (!SUCCEEDED(hr))
 			throw exception("Vertex buffer cannot be created");
 
-		textureResourceView = tex_view;
-
-		if (textureResourceView)
-			textureResourceView->AddRef(); // We didnt create it here but dont want it deleted by the creator untill we have deconstructed
+		// textureResourceView is set (and retained) by the Mesh constructor
 
 		D3D11_SAMPLER_DESC samplerDesc;
 
@@ -106,7 +109,7 @@ Grid::Grid(UINT widthl, UINT heightl, ID3D11Device *device, Effect *_effect, ID3
 		samplerDesc.AddressW = D3D11_TEXTURE_ADDRESS_WRAP;
 		samplerDesc.MaxAnisotropy = 16;
 		samplerDesc.MinLOD = 0.0f;
-		samplerDesc.MaxLOD = 0.0f;
+		samplerDesc.MaxLOD = D3D11_FLOAT32_MAX;
 		samplerDesc.MipLODBias = 0.0f;
 		samplerDesc.ComparisonFunc = D3D11_COMPARISON_ALWAYS;
 
@@ -129,6 +132,9 @@ Grid::Grid(UINT widthl, UINT heightl, ID3D11Device *device, Effect *_effect, ID3
 
 Grid::~Grid() {
 
+	if (vertices)
+		free(vertices);
+
 	if (vertexBuffer)
 		vertexBuffer->Release();
 
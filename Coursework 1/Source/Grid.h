@@ -6,11 +6,8 @@ class Grid : public Mesh {
 protected:
 
 
-	// Create the indices
-
 	UINT width, height;
-	UINT *indices;
-	DXVertexExt *vertices;
+	DXVertexExt *vertices; // retained for height queries (see Terrain)
 
 	public:
 
@@ -0,0 +1,580 @@
+
+//
+// HeadlessScene.cpp
+//
+
+#include <stdafx.h>
+#include <HeadlessScene.h>
+#include <CGDBenchmark.h>
+#include <CGDCameraPath.h>
+#include <CGDJobSystem.h>
+#include <CGDSoftwareRasterizer.h>
+#include <CGDSoftwareTexture.h>
+#include <CGDTimeSource.h>
+#include <CGDSimulation.h>
+#include <CGDScatterMap.h>
+#include <CGDOcean.h>
+#include <GU3DSFile.h>
+#include <GUImageDecoder.h>
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+
+using namespace std;
+
+
+// Material colours (XMCOLOR 0xAARRGGBB) of Scene's mattWhite and glossWhite
+static const uint32_t			whiteColour = 0xFFFFFFFF;
+static const uint32_t			mattSpecular = 0x00000000;
+static const uint32_t			glossSpecular = 0xFFFFFFFF;
+
+// The sky box is not rendered - clear to a sky colour instead
+static const float				skyColour[4] = { 0.45f, 0.6f, 0.85f, 1.0f };
+
+// Ocean - waterTiles x waterTiles patches of the water mesh (waterTileQuads x waterTileQuads quads) around the floor at waterLevel (as Scene)
+static const uint32_t			waterTiles = 4;
+static const uint32_t			waterTileQuads = 32;
+static const float				waterLevel = -3.5f;
+
+
+// Integer hash used to generate texture noise
+static uint32_t hashTexel(uint32_t x, uint32_t y, uint32_t seed) {
+
+	uint32_t h = x * 374761393u + y * 668265263u + seed * 2246822519u;
+
+	h = (h ^ (h >> 13)) * 1274126177u;
+
+	return h ^ (h >> 16);
+}
+
+
+static CGDSoftwareVertex makeVertex(float x, float y, float z, float nx, float ny, float nz, float u, float v, uint32_t diffuse, uint32_t specular) {
+
+	CGDSoftwareVertex vertex = { { x, y, z }, { nx, ny, nz }, diffuse, specular, { u, v } };
+
+	return vertex;
+}
+
+
+// Read a 3DS model into mesh with Model's conversion to the left-handed D3D system.  3DS files are z-up so each vertex is first rotated to y-up (x, z, -y) as CGImport returns it, then x is mirrored, t is flipped and each triangle's winding is reversed
+static bool loadMesh(const char *filename, uint32_t specular, vector<CGDSoftwareVertex>& vertices, vector<uint32_t>& indices) {
+
+	gu_3ds_mesh model;
+
+	if (!gu_3ds_read(filename, model))
+		return false;
+
+	vertices.clear();
+
+	for (size_t i = 0; i < model.vertexCount(); i++) {
+
+		const float *p = &model.positions[i * 3], *n = &model.normals[i * 3], *t = &model.texCoords[i * 2];
+
+		vertices.push_back(makeVertex(-p[0], p[2], -p[1], -n[0], n[2], -n[1], t[0], 1.0f - t[1], whiteColour, specular));
+	}
+
+	indices = model.indices;
+
+	for (size_t i = 0; i < indices.size(); i += 3)
+		swap(indices[i], indices[i + 2]);
+
+	return true;
+}
+
+
+static CGDSoftwareTexture* loadTexture(const char *filename, CGDTextureAddress address) {
+
+	uint32_t w = 0, h = 0;
+	vector<uint8_t> rgba;
+
+	if (!gu_image_read_rgba(filename, w, h, rgba))
+		return nullptr;
+
+	// RGBA8 bytes are the texture's R8G8B8A8 texels
+	vector<uint32_t> texels(w * h);
+
+	memcpy(texels.data(), rgba.data(), rgba.size());
+
+	return CGDSoftwareTexture::CreateTexture(w, h, texels.data(), address);
+}
+
+
+
+//
+// Private interface
+//
+
+// Constructor - called internally by the CreateHeadlessScene factory method
+HeadlessScene::HeadlessScene(uint32_t _width, uint32_t _height) {
+
+	width = _width;
+	height = _height;
+}
+
+
+void HeadlessScene::buildGeometry() {
+
+	// Floor - the same 100x100 grid as Grid (mattWhite)
+	const uint32_t gridWidth = 100, gridHeight = 100;
+
+	for (uint32_t i = 0; i < gridHeight; i++)
+		for (uint32_t j = 0; j < gridWidth; j++)
+			floor.vertices.push_back(makeVertex((float)j, 0.0f, (float)i, 0.0f, 1.0f, 0.0f, (float)j / gridWidth, (float)i / gridHeight, whiteColour, mattSpecular));
+
+	for (uint32_t i = 0; i < gridHeight - 1; i++) {
+
+		for (uint32_t j = 0; j < gridWidth - 1; j++) {
+
+			uint32_t v = i * gridWidth + j;
+			uint32_t quad[6] = { v, v + gridWidth, v + 1, v + 1, v + gridWidth, v + gridWidth + 1 };
+
+			floor.indices.insert(floor.indices.end(), quad, quad + 6);
+		}
+	}
+
+	// Water - a flat patch of waterTileQuads x waterTileQuads quads, displaced each frame (glossWhite)
+	const uint32_t waterWidth = waterTileQuads + 1;
+
+	for (uint32_t i = 0; i < waterWidth; i++)
+		for (uint32_t j = 0; j < waterWidth; j++)
+			water.vertices.push_back(makeVertex((float)j, 0.0f, (float)i, 0.0f, 1.0f, 0.0f, (float)j / waterTileQuads, (float)i / waterTileQuads, whiteColour, glossSpecular));
+
+	for (uint32_t i = 0; i < waterWidth - 1; i++) {
+
+		for (uint32_t j = 0; j < waterWidth - 1; j++) {
+
+			uint32_t v = i * waterWidth + j;
+			uint32_t quad[6] = { v, v + waterWidth, v + 1, v + 1, v + waterWidth, v + waterWidth + 1 };
+
+			water.indices.insert(water.indices.end(), quad, quad + 6);
+		}
+	}
+
+	// Unit box (+/-1) with per-face normals and texture coordinates (mattWhite)
+	static const float faceNormals[6][3] = { { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 } };
+
+	for (int f = 0; f < 6; f++) {
+
+		const float *n = faceNormals[f];
+
+		// Tangent axes of the face
+		float s[3] = { n[1] + n[2], n[0], 0.0f };
+		float t[3] = { n[1] * s[2] - n[2] * s[1], n[2] * s[0] - n[0] * s[2], n[0] * s[1] - n[1] * s[0] };
+		uint32_t base = (uint32_t)box.vertices.size();
+
+		for (int k = 0; k < 4; k++) {
+
+			float a = (k == 1 || k == 2) ? 1.0f : -1.0f;
+			float b = (k >= 2) ? 1.0f : -1.0f;
+
+			box.vertices.push_back(makeVertex(n[0] + a * s[0] + b * t[0], n[1] + a * s[1] + b * t[1], n[2] + a * s[2] + b * t[2], n[0], n[1], n[2], (a + 1.0f) * 0.5f, (b + 1.0f) * 0.5f, whiteColour, mattSpecular));
+		}
+
+		uint32_t quad[6] = { base, base + 1, base + 2, base, base + 2, base + 3 };
+
+		box.indices.insert(box.indices.end(), quad, quad + 6);
+	}
+
+	// Bush positions (as Scene::initialiseSceneResources) - scattered over the floor outside a clearing around the sphere
+	float clearing[32 * 32];
+
+	for (int z = 0; z < 32; z++) {
+
+		for (int x = 0; x < 32; x++) {
+
+			float dx = ((float)x / 31.0f - 0.5f) * 100.0f;
+			float dz = ((float)z / 31.0f - 0.5f) * 100.0f;
+
+			clearing[z * 32 + x] = (dx * dx + dz * dz < 25.0f * 25.0f) ? 0.0f : 1.0f;
+		}
+	}
+
+	CGDFoliageScatterDesc bushDesc;
+
+	bushDesc.bounds[0][0] = -50.0f; bushDesc.bounds[0][1] = -50.0f;
+	bushDesc.bounds[1][0] = 49.0f; bushDesc.bounds[1][1] = 49.0f;
+	bushDesc.spacing = 12.0f;
+	bushDesc.clusterSize = 100.0f;
+	bushDesc.minScale = 0.4f;
+	bushDesc.maxScale = 0.6f;
+	bushDesc.densityMap = CGDScatterMap::CreateScatterMap(32, 32, clearing);
+
+	CGDFoliageScatter *bushScatter = CGDFoliageScatter::CreateFoliageScatter(bushDesc);
+	CGDFoliageCluster bushCluster;
+
+	bushDesc.densityMap->release();
+	bushScatter->generateCluster(0, 0, bushCluster);
+	bushScatter->release();
+
+	numBushes = (uint32_t)min(bushCluster.instances.size(), (size_t)40);
+
+	for (uint32_t i = 0; i < numBushes; i++)
+		bushes[i] = bushCluster.instances[i];
+}
+
+
+void HeadlessScene::buildTextures() {
+
+	// Bush - dark green blotches (Scene's grass.png is not in the repository)
+	const uint32_t size = 256;
+	vector<uint32_t> texels(size * size);
+
+	for (uint32_t y = 0; y < size; y++) {
+
+		for (uint32_t x = 0; x < size; x++) {
+
+			uint32_t h = hashTexel(x / 8, y / 8, 2) ^ (hashTexel(x, y, 3) & 0x0F0F0F);
+			uint32_t r = 20 + (h & 0x1F), g = 70 + ((h >> 8) & 0x3F), b = 15 + ((h >> 16) & 0x0F);
+
+			texels[y * size + x] = r | (g << 8) | (b << 16) | 0xFF000000;
+		}
+	}
+
+	bushTexture = CGDSoftwareTexture::CreateTexture(size, size, texels.data(), CGDTextureAddress::MIRROR);
+
+	// Water - blue with faint streaks along the wind
+	for (uint32_t y = 0; y < size; y++) {
+
+		for (uint32_t x = 0; x < size; x++) {
+
+			uint32_t h = hashTexel((x + y) / 4, (x - y) & 0xFF, 4) & 0x0F;
+			uint32_t r = 10 + h, g = 60 + h * 2, b = 110 + h * 3;
+
+			texels[y * size + x] = r | (g << 8) | (b << 16) | 0xFF000000;
+		}
+	}
+
+	waterTexture = CGDSoftwareTexture::CreateTexture(size, size, texels.data(), CGDTextureAddress::WRAP);
+}
+
+
+bool HeadlessScene::loadModels() {
+
+	// Bridge (mattWhite) and sphere (glossWhite)
+	return loadMesh("Resources/Models/bridge.3DS", mattSpecular, bridge.vertices, bridge.indices) && loadMesh("Resources/Models/spherehighres.3ds", glossSpecular, sphere.vertices, sphere.indices);
+}
+
+
+bool HeadlessScene::loadTextures() {
+
+	grassTexture = loadTexture("Resources/Textures/grassTex.jpg", CGDTextureAddress::WRAP);
+	brickTexture = loadTexture("Resources/Textures/Brick_DIFFUSE.jpg", CGDTextureAddress::WRAP);
+	rustTexture = loadTexture("Resources/Textures/rustDiff.jpg", CGDTextureAddress::WRAP);
+
+	return grassTexture && brickTexture && rustTexture;
+}
+
+
+void HeadlessScene::buildCameraAndLights() {
+
+	// Scene's main camera - FirstPersonCamera at (25, 2, -14.5) facing (-1, 0, 1)
+	float position[3] = { 25.0f, 2.0f, -14.5f };
+	float direction[3] = { -1.0f, 0.0f, 1.0f };
+
+	setCamera(position, direction);
+
+	// The sun and the scene's first two local lights as fixed lights
+	CGDSoftwareLight lights[3] = {
+		{ { -250.0f, 130.0f, 145.0f, 1.0f }, { 0.3f, 0.3f, 0.3f, 1.0f }, { 0.8f, 0.8f, 0.8f, 1.0f }, { 1.0f, 1.0f, 1.0f, 1.0f } },
+		{ { 250.0f, 130.0f, 145.0f, 1.0f }, { 0.1f, 0.3f, 0.3f, 1.0f }, { 0.1f, 0.4f, 0.3f, 1.0f }, { 1.0f, 1.0f, 1.0f, 1.0f } },
+		{ { -20.0f, 20.0f, 20.0f, 0.0f }, { 0.1f, 0.05f, 0.1f, 1.0f }, { 0.2f, 0.1f, 0.2f, 1.0f }, { 1.0f, 1.0f, 1.0f, 1.0f } }
+	};
+
+	for (int i = 0; i < 3; i++)
+		lighting.lights[i] = lights[i];
+
+}
+
+
+// Advance the animation by one fixed step (as Scene::stepSimulation)
+void HeadlessScene::stepSimulation(gu_seconds time) {
+
+	previousState = currentState;
+
+	currentState.time = time;
+	currentState.bushHeight = (dancingBushes) ? (float)(int)time : 0.0f;
+}
+
+
+void HeadlessScene::updateWater(gu_seconds time) {
+
+	PROFILE_SCOPE("HeadlessScene::updateWater");
+
+	// The fast path gives the same maps with any number of worker threads so frames stay reproducible
+	ocean->update(time);
+
+	float spacing = ocean->getDesc().patchSize / (float)waterTileQuads;
+	const uint32_t waterWidth = waterTileQuads + 1;
+
+	for (uint32_t i = 0; i < waterWidth; i++) {
+
+		for (uint32_t j = 0; j < waterWidth; j++) {
+
+			CGDSoftwareVertex& v = water.vertices[i * waterWidth + j];
+			float x = (float)j * spacing, z = (float)i * spacing;
+			float displacement[3];
+
+			ocean->sample(x, z, displacement, v.normal);
+
+			v.pos[0] = x + displacement[0];
+			v.pos[1] = displacement[1];
+			v.pos[2] = z + displacement[2];
+		}
+	}
+}
+
+
+void HeadlessScene::drawMesh(const Mesh& mesh, const CGDSoftwareMatrix& world, CGDSoftwareTexture *texture) {
+
+	lighting.worldMatrix = world;
+	lighting.worldITMatrix = world.inverseTranspose();
+	lighting.worldViewProjMatrix = world * viewProjMatrix;
+
+	rasterizer->drawIndexed(mesh.vertices.data(), (uint32_t)mesh.vertices.size(), mesh.indices.data(), (uint32_t)mesh.indices.size(), lighting, texture);
+}
+
+
+
+//
+// Public interface
+//
+
+// Factory method
+HeadlessScene* HeadlessScene::CreateHeadlessScene(uint32_t width, uint32_t height, uint32_t numWorkers) {
+
+	if (width == 0 || height == 0)
+		return nullptr;
+
+	GU_MEMORY_TAG_SCOPE(gu_mem_scene);
+
+	HeadlessScene *scene = new HeadlessScene(width, height);
+
+	scene->jobSystem = CGDJobSystem::CreateJobSystem(numWorkers);
+	scene->rasterizer = CGDSoftwareRasterizer::CreateSoftwareRasterizer(width, height, scene->jobSystem);
+	scene->simClock = CGDVirtualClock::CreateVirtualClock();
+
+	if (!scene->rasterizer || !scene->simClock) {
+
+		scene->release();
+		return nullptr;
+	}
+
+	scene->simulation = CGDSimulation::CreateSimulation(scene->simClock, 1.0 / 60.0, [=](gu_seconds time, gu_seconds) { scene->stepSimulation(time); }, false);
+
+	if (!scene->simulation) {
+
+		scene->release();
+		return nullptr;
+	}
+
+	CGDOceanDesc oceanDesc;
+
+	oceanDesc.resolution = 128;
+	scene->ocean = CGDOcean::CreateOcean(oceanDesc, scene->jobSystem);
+
+	scene->buildGeometry();
+	scene->buildTextures();
+	scene->buildCameraAndLights();
+
+	if (!scene->loadModels() || !scene->loadTextures()) {
+
+		scene->release();
+		return nullptr;
+	}
+
+	return scene;
+}
+
+
+// Destructor
+HeadlessScene::~HeadlessScene() {
+
+	// The rasterizer releases the textures of queued draws so release it first
+	if (rasterizer)
+		rasterizer->release();
+
+	if (grassTexture)
+		grassTexture->release();
+
+	if (brickTexture)
+		brickTexture->release();
+
+	if (rustTexture)
+		rustTexture->release();
+
+	if (bushTexture)
+		bushTexture->release();
+
+	if (waterTexture)
+		waterTexture->release();
+
+	if (ocean)
+		ocean->release();
+
+	if (simulation)
+		simulation->release();
+
+	if (simClock)
+		simClock->release();
+
+	if (jobSystem)
+		jobSystem->release();
+}
+
+
+void HeadlessScene::setCamera(const float position[3], const float direction[3]) {
+
+	float at[3] = { position[0] + direction[0], position[1] + direction[1], position[2] + direction[2] };
+	float up[3] = { 0.0f, 1.0f, 0.0f };
+
+	for (int i = 0; i < 3; i++)
+		eyePos[i] = lighting.eyePos[i] = position[i];
+
+	lighting.eyePos[3] = 1.0f;
+
+	viewProjMatrix = CGDSoftwareMatrix::LookAtLH(eyePos, at, up) * CGDSoftwareMatrix::PerspectiveFovLH(0.25f * 3.14f, (float)width / (float)height, 1.0f, 1000.0f);
+}
+
+
+void HeadlessScene::renderFrame(gu_seconds frameTime) {
+
+	PROFILE_SCOPE("HeadlessScene::renderFrame");
+
+	simClock->advance(frameTime);
+	simulation->update();
+
+	// Bush height is stepped (see Scene::updateScene) so the latest state is used rather than interpolating
+	float bushHeight = currentState.bushHeight;
+
+	rasterizer->clear(skyColour);
+
+	drawMesh(floor, CGDSoftwareMatrix::Translation(-50.0f, -2.0f, -50.0f), grassTexture);
+
+	// Every tile draws the same patch - the ocean is periodic so the tiles join
+	if (ocean) {
+
+		updateWater(currentState.time);
+
+		float patchSize = ocean->getDesc().patchSize;
+		float corner = -patchSize * (float)waterTiles * 0.5f;
+
+		for (uint32_t i = 0; i < waterTiles; i++)
+			for (uint32_t j = 0; j < waterTiles; j++)
+				drawMesh(water, CGDSoftwareMatrix::Translation(corner + (float)j * patchSize, waterLevel, corner + (float)i * patchSize), waterTexture);
+	}
+	drawMesh(bridge, CGDSoftwareMatrix::Scaling(0.05f, 0.05f, 0.05f) * CGDSoftwareMatrix::Translation(0.0f, -2.0f, 12.0f), brickTexture);
+	drawMesh(sphere, CGDSoftwareMatrix::Identity(), rustTexture);
+
+	for (uint32_t i = 0; i < numBushes; i++) {
+
+		const CGDFoliageInstance& b = bushes[i];
+
+		drawMesh(box, CGDSoftwareMatrix::Scaling(b.scale, b.scale, b.scale) * CGDSoftwareMatrix::RotationY(b.rotation) * CGDSoftwareMatrix::Translation(b.position[0], b.position[1] + bushHeight, b.position[2]), bushTexture);
+	}
+
+	rasterizer->flush();
+
+	framesRendered++;
+}
+
+
+bool HeadlessScene::renderFrames(uint32_t numFrames, gu_seconds frameTime, const string& outputPrefix) {
+
+	// CGDClock's tick conversion is set up when the first clock is created so convert using the counter frequency directly
+	gu_seconds secondsPerTick = 1.0 / (gu_seconds)CGDClock::ActualTimeFrequency();
+	gu_seconds totalTime = 0.0, minTime = 1.0e9, maxTime = 0.0;
+	bool ok = true;
+
+	rasterizer->resetStats();
+
+	for (uint32_t i = 0; i < numFrames; i++) {
+
+		gu_time_index start = CGDClock::ActualTime();
+
+		renderFrame(frameTime);
+
+		gu_seconds t = (gu_seconds)(CGDClock::ActualTime() - start) * secondsPerTick;
+
+		totalTime += t;
+		minTime = min(minTime, t);
+		maxTime = max(maxTime, t);
+
+		if (!outputPrefix.empty()) {
+
+			ostringstream filename;
+
+			filename << outputPrefix << setw(4) << setfill('0') << i << ".png";
+
+			if (!writeFrame(filename.str().c_str()))
+				ok = false;
+		}
+	}
+
+	if (numFrames > 0) {
+
+		CGDSoftwareRasterizerStats stats = rasterizer->frameStats();
+
+		cout << "Headless scene " << width << "x" << height << ", " << jobSystem->threadCount() << " threads: " << numFrames << " frames, ";
+		cout << (totalTime / numFrames) * 1000.0 << " ms average (min " << minTime * 1000.0 << " ms, max " << maxTime * 1000.0 << " ms)" << endl;
+		cout << "Per frame: " << stats.drawCalls / numFrames << " draw calls, " << stats.stateChanges / numFrames << " state changes, " << stats.trianglesSubmitted / numFrames << " triangles submitted, " << stats.trianglesCulled / numFrames << " culled, " << stats.trianglesClipped / numFrames << " clipped, ";
+		cout << stats.binnedTriangles / numFrames << " binned, " << stats.pixelsShaded / numFrames << " pixels shaded" << endl;
+	}
+
+	return ok;
+}
+
+
+void HeadlessScene::runBenchmark(const CGDCameraPath *path, uint32_t numFrames, uint32_t warmupFrames, CGDBenchmark *benchmark) {
+
+	gu_seconds step = path->getStepSize();
+	uint64_t keyframes = max((uint64_t)path->keyframeCount(), (uint64_t)1);
+	gu_seconds secondsPerTick = 1.0 / (gu_seconds)CGDClock::ActualTimeFrequency();
+
+	if (numFrames == 0)
+		numFrames = (uint32_t)keyframes;
+
+	for (uint32_t i = 0; i < warmupFrames + numFrames; i++) {
+
+		// Frame i shows keyframe i (the path loops if there are more frames than keyframes)
+		uint32_t frame = (i < warmupFrames) ? i : i - warmupFrames;
+		float position[3], direction[3];
+
+		path->sample((gu_seconds)(frame % keyframes) * step, position, direction);
+
+		gu_time_index start = CGDClock::ActualTime();
+
+		CGDSoftwareRasterizerStats before = rasterizer->frameStats();
+
+		setCamera(position, direction);
+		renderFrame(step);
+
+		CGDSoftwareRasterizerStats after = rasterizer->frameStats();
+
+		if (i >= warmupFrames) {
+
+			CGDBenchmarkFrame f;
+
+			f.frameTimeMs = (gu_seconds)(CGDClock::ActualTime() - start) * secondsPerTick * 1000.0;
+			f.drawCalls = after.drawCalls - before.drawCalls;
+			f.stateChanges = after.stateChanges - before.stateChanges;
+			f.trianglesSubmitted = after.trianglesSubmitted - before.trianglesSubmitted;
+
+			benchmark->recordFrame(f);
+		}
+	}
+
+	benchmark->finish();
+}
+
+
+bool HeadlessScene::writeFrame(const char *filename) {
+
+	return rasterizer->writePNG(filename);
+}
+
+
+CGDSoftwareRasterizer* HeadlessScene::getRasterizer() const {
+
+	return rasterizer;
+}
@@ -0,0 +1,135 @@
+//
+// HeadlessScene.h
+//
+
+// Headless version of Scene rendered with the software rasterizer (see CGDSoftwareRasterizer) - no window, swap chain or GPU is created so it can run on build and render machines.  This is a reduced scene.  The bridge and sphere models are read from the same .3ds files as Scene (with GU3DSFile and Model's conversion rather than CGImport) and drawn with Scene's brick, rust and grass textures (decoded with GUImageDecoder), and the 100x100 floor grid and the ocean (CGDOcean on the CPU, displacing a water tile mesh each frame) are built as Scene builds them, with Scene's main camera, lights and materials.  The dropship is not drawn (dropship.gsf is CGImport's own format and has no portable reader), a sky colour replaces the sky box (Scene's grassenvmap1024.dds cube map is not in the repository) and the 40 bushes are drawn as boxes at the bush positions with a procedural texture (Bush.3ds and grass.png are not in the repository).  The sphere is lit with the rust texture rather than Scene's reflection map effect.
+//
+// Animation uses the same fixed-step simulation as Scene, driven by a virtual clock that advances by a fixed frame time, so frame n of a run is identical on every machine and with any number of worker threads.
+
+#pragma once
+
+#include <GUObject.h>
+#include <CGDClock.h>
+#include <CGDSoftwareShaders.h>
+#include <CGDFoliageScatter.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class CGDJobSystem;
+class CGDSoftwareRasterizer;
+class CGDSoftwareTexture;
+class CGDVirtualClock;
+class CGDSimulation;
+class CGDCameraPath;
+class CGDBenchmark;
+class CGDOcean;
+
+
+class HeadlessScene : public GUObject {
+
+	// Animated state (as Scene::SceneState)
+	struct State {
+
+		gu_seconds							time = 0.0;
+		float								bushHeight = 0.0f;
+	};
+
+	// Indexed triangle list in the extVertexDesc layout
+	struct Mesh {
+
+		std::vector<CGDSoftwareVertex>		vertices;
+		std::vector<uint32_t>				indices;
+	};
+
+	uint32_t								width;
+	uint32_t								height;
+
+	CGDJobSystem							*jobSystem = nullptr;
+	CGDSoftwareRasterizer					*rasterizer = nullptr;
+
+	CGDSoftwareTexture						*grassTexture = nullptr;
+	CGDSoftwareTexture						*brickTexture = nullptr;
+	CGDSoftwareTexture						*rustTexture = nullptr;
+	CGDSoftwareTexture						*bushTexture = nullptr;
+	CGDSoftwareTexture						*waterTexture = nullptr;
+
+	Mesh									floor;
+	Mesh									box;
+	Mesh									bridge;
+	Mesh									sphere;
+	Mesh									water; // one ocean patch, displaced by updateWater and drawn once per tile
+
+	CGDOcean								*ocean = nullptr;
+
+	CGDFoliageInstance						bushes[40];
+	uint32_t								numBushes = 0;
+	bool									dancingBushes = true;
+
+	// Fixed-step simulation - previousState and currentState are the last two simulated states
+	CGDVirtualClock							*simClock = nullptr;
+	CGDSimulation							*simulation = nullptr;
+	State									previousState;
+	State									currentState;
+
+	// Camera and lights
+	float									eyePos[3];
+	CGDSoftwareMatrix						viewProjMatrix;
+	CGDLightingConstants					lighting;
+
+	uint64_t								framesRendered = 0;
+
+
+	//
+	// Private interface
+	//
+
+	// Constructor - called internally by the CreateHeadlessScene factory method
+	HeadlessScene(uint32_t width, uint32_t height);
+
+	void buildGeometry();
+	void buildTextures();
+
+	// Load Scene's bridge and sphere models and textures.  Return false if a file cannot be read
+	bool loadModels();
+	bool loadTextures();
+	void buildCameraAndLights();
+
+	void stepSimulation(gu_seconds time);
+
+	// Evaluate the ocean at time and displace the water mesh
+	void updateWater(gu_seconds time);
+
+	// Draw mesh with the given world matrix (material colours are in the vertices as in the D3D path)
+	void drawMesh(const Mesh& mesh, const CGDSoftwareMatrix& world, CGDSoftwareTexture *texture);
+
+
+public:
+
+	//
+	// Public interface
+	//
+
+	// Factory method.  numWorkers is passed to CGDJobSystem::CreateJobSystem (0 = one per hardware thread).  Models and textures are read from Resources/ relative to the working directory.  Return nullptr if width or height is 0 or a model or texture cannot be read
+	static HeadlessScene* CreateHeadlessScene(uint32_t width, uint32_t height, uint32_t numWorkers = 0);
+
+	// Destructor
+	~HeadlessScene();
+
+	// Place the camera at position looking along direction (as FirstPersonCamera - up is +y)
+	void setCamera(const float position[3], const float direction[3]);
+
+	// Advance the simulation by frameTime and render a frame
+	void renderFrame(gu_seconds frameTime);
+
+	// Render numFrames frames frameTime seconds apart.  If outputPrefix is not empty frame n is written to <outputPrefix><n>.png (n zero-padded to 4 digits).  Report per-frame timing when done.  Return false if a frame could not be written
+	bool renderFrames(uint32_t numFrames, gu_seconds frameTime, const std::string& outputPrefix);
+
+	// Replay path for numFrames frames (0 = one frame per keyframe) stepping the simulation by the path's step size each frame, after warmupFrames frames that are not recorded.  Each frame's CPU time and rasterizer counters are recorded in benchmark, which is finished when done
+	void runBenchmark(const CGDCameraPath *path, uint32_t numFrames, uint32_t warmupFrames, CGDBenchmark *benchmark);
+
+	// Write the last rendered frame to a PNG file
+	bool writeFrame(const char *filename);
+
+	CGDSoftwareRasterizer* getRasterizer() const;
+};
@@ -2,6 +2,7 @@
 #include "Mesh.h"
 #include "Material.h"
 #include "Effect.h"
+#include <CGDRenderQueue.h>
 
 Mesh::Mesh(ID3D11Device *device, Effect *_effect, ID3D11ShaderResourceView *_texView, Material *_material)
 {
@@ -26,7 +27,7 @@ Mesh::Mesh(ID3D11Device *device, Effect *_effect, ID3D11ShaderResourceView *_tex
 	samplerDesc.AddressW = D3D11_TEXTURE_ADDRESS_WRAP;
 	samplerDesc.MaxAnisotropy = 16;
 	samplerDesc.MinLOD = 0.0f;
-	samplerDesc.MaxLOD = 0.0f;
+	samplerDesc.MaxLOD = D3D11_FLOAT32_MAX;
 	samplerDesc.MipLODBias = 0.0f;
 	samplerDesc.ComparisonFunc = D3D11_COMPARISON_ALWAYS;
 
@@ -39,6 +40,21 @@ Mesh::~Mesh()
 }
 
 
+void Mesh::setTexture(ID3D11ShaderResourceView *tex_view) {
+
+	if (textureResourceView == tex_view)
+		return;
+
+	if (tex_view)
+		tex_view->AddRef();
+
+	if (textureResourceView)
+		textureResourceView->Release();
+
+	textureResourceView = tex_view;
+}
+
+
 void Mesh::render(ID3D11DeviceContext *context) {
 
 	effect->bindPipeline(context);
@@ -81,3 +97,35 @@ void Mesh::render(ID3D11DeviceContext *context) {
 	// Draw Mesh
 	context->DrawIndexed(numInd, 0, 0);
 }
+
+
+void Mesh::submit(CGDRenderQueue *queue, const CGDConstantBinding& constants, float depth, uint32_t layer, uint32_t instanceCount) {
+
+	// Validate DXModel before rendering (see notes in constructor)
+	if (!queue || !vertexBuffer || !indexBuffer || !effect)
+		return;
+
+	CGDDrawPacket packet;
+
+	ZeroMemory(&packet, sizeof(CGDDrawPacket));
+
+	effect->preparePacket(&packet);
+	packet.constants = constants;
+
+	if (textureResourceView && linearSampler) {
+
+		packet.shaderResources[0] = textureResourceView;
+		packet.numShaderResources = 1;
+		packet.sampler = linearSampler;
+	}
+
+	packet.vertexBuffer = vertexBuffer;
+	packet.vertexStride = sizeof(DXVertexExt);
+	packet.indexBuffer = indexBuffer;
+	packet.indexFormat = DXGI_FORMAT_R32_UINT;
+	packet.topology = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+	packet.indexCount = numInd;
+	packet.instanceCount = instanceCount;
+
+	queue->submit(queue->makeKey(layer, effect, textureResourceView, vertexBuffer, depth), packet);
+}
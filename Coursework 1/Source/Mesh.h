@@ -5,6 +5,8 @@
 class Texture;
 class Material;
 class Effect;
+class CGDRenderQueue;
+struct CGDConstantBinding;
 
 class Mesh
 {
@@ -24,6 +26,10 @@ class Mesh
 public:
 	Mesh(ID3D11Device *device, Effect *_effect, ID3D11ShaderResourceView *tex_view, Material *_material);
 	void render(ID3D11DeviceContext *context);
+	// Queue the mesh draw on the render queue with the given per-object constants.  depth is the normalised view depth used to order draws that share a mesh.  instanceCount > 0 draws the mesh instanced (the effect's shaders select per-instance data from SV_InstanceID)
+	void submit(CGDRenderQueue *queue, const CGDConstantBinding& constants, float depth = 0.0f, uint32_t layer = 0, uint32_t instanceCount = 0);
+	// Replace the texture view - used to rebind streamed textures
+	void setTexture(ID3D11ShaderResourceView *tex_view);
 	~Mesh();
 };
 
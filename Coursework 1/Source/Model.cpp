@@ -3,6 +3,8 @@
 #include <Model.h>
 #include <Material.h>
 #include <Effect.h>
+#include <GUMemoryArena.h>
+#include <CGDRenderQueue.h>
 #include <iostream>
 #include <exception>
 #include <CoreStructures\CoreStructures.h>
@@ -27,11 +29,15 @@ Model::Model(ID3D11Device *device, Effect *_effect, const std::wstring& filename
 	for (int i=1; i < Num_Textures; i++)
 	{
 		textureResourceViewArray[i] = _tex_view_array[i];
+		if (textureResourceViewArray[i])
+			textureResourceViewArray[i]->AddRef();
 	}
 
 
 }	
 void Model::load(ID3D11Device *device, Effect *_effect, const std::wstring& filename, ID3D11ShaderResourceView *tex_view, Material *_material) {
+	PROFILE_SCOPE("Model::load");
+	GU_MEMORY_TAG_SCOPE(gu_mem_mesh);
 	printf("entering model init");
 	
 	effect = _effect;
@@ -39,11 +45,15 @@ void Model::load(ID3D11Device *device, Effect *_effect, const std::wstring& file
 	inputLayout->AddRef();
 	material = _material;
 	worldMatrix = XMMatrixIdentity();
+	ZeroMemory(boundingSphere, sizeof(boundingSphere));
 	
 	CGModel *actualModel = nullptr;
 	DXVertexExt *_vertexBuffer = nullptr;
 	uint32_t *_indexBuffer = nullptr;
 
+	// Vertex and index staging buffers are only needed until the DX buffers are created so take them from the thread's scratch arena
+	GUScratchScope scratch;
+
 	try
 	{
 		if (!device || !inputLayout)
@@ -107,14 +117,14 @@ void Model::load(ID3D11Device *device, Effect *_effect, const std::wstring& file
 		
 
 		// Create vertex buffer
-		_vertexBuffer = (DXVertexExt*)malloc(numVertices * sizeof(DXVertexExt));
+		_vertexBuffer = scratch.allocateArray<DXVertexExt>(numVertices);
 
 		if (!_vertexBuffer)
 			throw exception("Cannot create vertex buffer");
 
 
 		// Create index buffer
-		_indexBuffer = (uint32_t*)malloc(numIndices * sizeof(uint32_t));
+		_indexBuffer = scratch.allocateArray<uint32_t>(numIndices);
 
 		if (!_indexBuffer)
 			throw exception("Cannot create index buffer");
@@ -161,6 +171,23 @@ void Model::load(ID3D11Device *device, Effect *_effect, const std::wstring& file
 			}
 		}
 
+		// Bounding sphere around the centre of the vertex bounds
+		XMVECTOR boundsMin = XMLoadFloat3(&_vertexBuffer[0].pos), boundsMax = boundsMin;
+
+		for (uint32_t i = 1; i < numVertices; i++) {
+
+			boundsMin = XMVectorMin(boundsMin, XMLoadFloat3(&_vertexBuffer[i].pos));
+			boundsMax = XMVectorMax(boundsMax, XMLoadFloat3(&_vertexBuffer[i].pos));
+		}
+
+		XMVECTOR centre = (boundsMin + boundsMax) * 0.5f, radius = XMVectorZero();
+
+		for (uint32_t i = 0; i < numVertices; i++)
+			radius = XMVectorMax(radius, XMVector3Length(XMLoadFloat3(&_vertexBuffer[i].pos) - centre));
+
+		XMStoreFloat3((XMFLOAT3*)boundingSphere, centre);
+		boundingSphere[3] = XMVectorGetX(radius);
+
 		
 		//
 		// Setup DX vertex buffer interfaces
@@ -217,7 +244,7 @@ void Model::load(ID3D11Device *device, Effect *_effect, const std::wstring& file
 		linearDesc.AddressV = D3D11_TEXTURE_ADDRESS_MIRROR;
 		linearDesc.AddressW = D3D11_TEXTURE_ADDRESS_MIRROR;
 		linearDesc.MinLOD = 0.0f;
-		linearDesc.MaxLOD = 0.0f;
+		linearDesc.MaxLOD = D3D11_FLOAT32_MAX;
 		linearDesc.MipLODBias = 0.0f;
 		//linearDesc.MaxAnisotropy = 0; // Unused for isotropic filtering
 		linearDesc.ComparisonFunc = D3D11_COMPARISON_ALWAYS;
@@ -232,9 +259,7 @@ void Model::load(ID3D11Device *device, Effect *_effect, const std::wstring& file
 
 
 
-		// Dispose of local resources
-		free(_vertexBuffer);
-		free(_indexBuffer);
+		// Dispose of local resources (staging buffers are released when scratch goes out of scope)
 		actualModel->release();
 	}
 	catch (exception& e)
@@ -242,12 +267,6 @@ void Model::load(ID3D11Device *device, Effect *_effect, const std::wstring& file
 		cout << "Model could not be instantiated due to:\n";
 		cout << e.what() << endl;
 
-		if (_vertexBuffer)
-			free(_vertexBuffer);
-
-		if (_indexBuffer)
-			free(_indexBuffer);
-
 		if (actualModel)
 			actualModel->release();
 
@@ -275,6 +294,20 @@ Model::~Model() {
 
 }
 
+void Model::setTexture(int index, ID3D11ShaderResourceView *tex_view) {
+
+	if (index < 0 || index >= Num_Textures || textureResourceViewArray[index] == tex_view)
+		return;
+
+	if (tex_view)
+		tex_view->AddRef();
+
+	if (textureResourceViewArray[index])
+		textureResourceViewArray[index]->Release();
+
+	textureResourceViewArray[index] = tex_view;
+}
+
 //void Model::update(ID3D11DeviceContext *context) {
 
 void Model::render(ID3D11DeviceContext *context) {
@@ -318,6 +351,49 @@ void Model::render(ID3D11DeviceContext *context) {
 }
 
 
+void Model::submit(CGDRenderQueue *queue, const CGDConstantBinding& constants, float depth, uint32_t layer, Effect *passEffect) {
+
+	// Validate Model before rendering (see notes in constructor)
+	if (!queue || !vertexBuffer || !indexBuffer || !effect)
+		return;
+
+	CGDDrawPacket packet;
+	Effect *drawEffect = (passEffect) ? passEffect : effect;
+
+	ZeroMemory(&packet, sizeof(CGDDrawPacket));
+
+	drawEffect->preparePacket(&packet);
+	packet.constants = constants;
+
+	if (!passEffect && textureResourceViewArray[0] && sampler) {
+
+		packet.numShaderResources = min(Num_Textures, CGD_MAX_PACKET_SHADER_RESOURCES);
+
+		for (uint32_t i = 0; i < packet.numShaderResources; i++)
+			packet.shaderResources[i] = textureResourceViewArray[i];
+
+		packet.sampler = sampler;
+	}
+
+	packet.vertexBuffer = vertexBuffer;
+	packet.vertexStride = sizeof(DXVertexExt);
+	packet.indexBuffer = indexBuffer;
+	packet.indexFormat = DXGI_FORMAT_R32_UINT;
+	packet.topology = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+
+	uint64_t key = queue->makeKey(layer, drawEffect, packet.shaderResources[0], vertexBuffer, depth);
+
+	for (uint32_t indexOffset = 0, i = 0; i < numMeshes; indexOffset += indexCount[i], ++i) {
+
+		packet.indexCount = indexCount[i];
+		packet.startIndex = indexOffset;
+		packet.baseVertex = baseVertexOffset[i];
+
+		queue->submit(key, packet);
+	}
+}
+
+
 //void Model::update(ID3D11DeviceContext *context) {
 
 void Model::renderSimp(ID3D11DeviceContext *context) {
@@ -355,3 +431,10 @@ void Model::renderSimp(ID3D11DeviceContext *context) {
 	for (uint32_t indexOffset = 0, i = 0; i < numMeshes; indexOffset += indexCount[i], ++i)
 		context->DrawIndexed(indexCount[i], indexOffset, baseVertexOffset[i]);
 }
+
+
+void Model::getBoundingSphere(float sphere[4]) const {
+
+	for (int i = 0; i < 4; i++)
+		sphere[i] = boundingSphere[i];
+}
@@ -18,6 +18,8 @@
 class Texture;
 class Material;
 class Effect;
+class CGDRenderQueue;
+struct CGDConstantBinding;
 
 
 class Model : public DXBaseModel {
@@ -34,6 +36,7 @@ class Model : public DXBaseModel {
 	ID3D11ShaderResourceView			*textureResourceViewArray[8];
 	ID3D11SamplerState					*sampler = nullptr;
 	DirectX::XMMATRIX worldMatrix;
+	float								boundingSphere[4]; // model space centre and radius
 public:
 
 	Model(ID3D11Device *device, Effect *_effect, const std::wstring& filename, ID3D11ShaderResourceView *tex_view, Material *_material);
@@ -46,5 +49,11 @@ public:
 	void update(ID3D11DeviceContext *context, double time);
 	void render(ID3D11DeviceContext *context);
 	void renderSimp(ID3D11DeviceContext *context);
+	// Queue the model's draws (one per mesh) on the render queue with the given per-object constants.  depth is the normalised view depth used to order draws that share a mesh.  passEffect replaces the model's effect for passes that draw the model with other shaders (eg. shadow casters) - no textures are bound with it
+	void submit(CGDRenderQueue *queue, const CGDConstantBinding& constants, float depth = 0.0f, uint32_t layer = 0, Effect *passEffect = nullptr);
+	// Bounding sphere of the vertices in model space (centre of their bounding box and the distance to the furthest vertex)
+	void getBoundingSphere(float sphere[4]) const;
 	void setAnimation(Animation *newAnimation){ animation = newAnimation; };
+	// Replace texture index (0 <= index < the number of textures) - used to rebind streamed textures
+	void setTexture(int index, ID3D11ShaderResourceView *tex_view);
 };
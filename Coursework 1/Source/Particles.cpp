@@ -132,7 +132,7 @@ Particles::Particles(ID3D11Device *device, Effect *_effect, ID3D11ShaderResource
 		samplerDesc.AddressW = D3D11_TEXTURE_ADDRESS_WRAP;
 		samplerDesc.MaxAnisotropy=16;
 		samplerDesc.MinLOD = 0.0f;
-		samplerDesc.MaxLOD = 0.0f;
+		samplerDesc.MaxLOD = D3D11_FLOAT32_MAX;
 		samplerDesc.MipLODBias = 0.0f;
 		samplerDesc.ComparisonFunc = D3D11_COMPARISON_ALWAYS;
 
@@ -69,7 +69,7 @@ Quad::Quad(ID3D11Device *device, ID3D11InputLayout	*_inputLayout) {
 		samplerDesc.AddressW = D3D11_TEXTURE_ADDRESS_WRAP;
 		samplerDesc.MaxAnisotropy = 16;
 		samplerDesc.MinLOD = 0.0f;
-		samplerDesc.MaxLOD = 0.0f;
+		samplerDesc.MaxLOD = D3D11_FLOAT32_MAX;
 		samplerDesc.MipLODBias = 0.0f;
 		samplerDesc.ComparisonFunc = D3D11_COMPARISON_ALWAYS;
 
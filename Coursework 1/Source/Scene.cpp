@@ -5,6 +5,7 @@
 
 #include <stdafx.h>
 #include <string.h>
+#include <cfloat>
 #include <d3d11shader.h>
 #include <d3dcompiler.h>
 #include <Scene.h>
@@ -13,6 +14,29 @@
 #include <DirectXTK\DDSTextureLoader.h>
 #include <DirectXTK\WICTextureLoader.h>
 #include <CGDClock.h>
+#include <CGDGPUProfiler.h>
+#include <DXGPUTimerBackend.h>
+#include <GUMemoryArena.h>
+#include <DXPipelineCache.h>
+#include <DXRenderContext.h>
+#include <CGDRenderQueue.h>
+#include <CGDJobSystem.h>
+#include <CGDPassScheduler.h>
+#include <DXCommandBackend.h>
+#include <CGDTimeSource.h>
+#include <CGDSimulation.h>
+#include <CGDCameraPath.h>
+#include <CGDTextureStreamer.h>
+#include <DXTextureStreamingBackend.h>
+#include <CGDImageLoader.h>
+#include <CGDScatterMap.h>
+#include <CGDOcean.h>
+#include <DXOceanSurface.h>
+#include <DXPostProcess.h>
+#include <DXClusteredLighting.h>
+#include <DXShadowMaps.h>
+#include <CGDConstantBuffers.h>
+#include <DXConstantBufferBackend.h>
 #include <Model.h>
 #include <LookAtCamera.h>
 #include <FirstPersonCamera.h>
@@ -25,78 +49,12 @@ using namespace std;
 using namespace DirectX;
 using namespace DirectX::PackedVector;
 
-// Load the Compiled Shader Object (CSO) file 'filename' and return the bytecode in the blob object **bytecode.  This is used to create shader interfaces that require class linkage interfaces.
-// Taken from DXShaderFactory by Paul Angel. This function has been included here for clarity.
-uint32_t DXLoadCSO(const char *filename, char **bytecode)
-{
-
-	ifstream	*fp = nullptr;
-	//char		*memBlock = nullptr;
-	//bytecode = nullptr;
-	uint32_t shaderBytes = -1;
-	cout << "loading shader" << endl;
-
-	try
-	{
-		// Validate parameters
-		if (!filename )
-			throw exception("loadCSO: Invalid parameters");
-
-		// Open file
-		fp = new ifstream(filename, ios::in | ios::binary);
-
-		if (!fp->is_open())
-			throw exception("loadCSO: Cannot open file");
-
-		// Get file size
-		fp->seekg(0, ios::end);
-		shaderBytes = (uint32_t)fp->tellg();
-
-		// Create blob object to store bytecode (exceptions propagate up if any occur)
-		//memBlock = new DXBlob(size);
-		cout << "allocating shader memory bytes = " << shaderBytes << endl;
-		*bytecode = (char*)malloc(shaderBytes);
-		// Read binary data into blob object
-		fp->seekg(0, ios::beg);
-		fp->read(*bytecode, shaderBytes);
-
-
-		// Close file and release local resources
-		fp->close();
-		delete fp;
-
-		// Return DXBlob - ownership implicity passed to caller
-		//*bytecode = memBlock;
-		cout << "Done: shader memory bytes = " << shaderBytes << endl;
-	}
-	catch (exception& e)
-	{
-		cout << e.what() << endl;
-
-		// Cleanup local resources
-		if (fp) {
-
-			if (fp->is_open())
-				fp->close();
-
-			delete fp;
-		}
-
-		if (bytecode)
-			delete bytecode;
-
-		// Re-throw exception
-		throw;
-	}
-	return shaderBytes;
-}
-
 //
 // Private interface implementation
 //
 
 // Private constructor
-Scene::Scene(const LONG _width, const LONG _height, const wchar_t* wndClassName, const wchar_t* wndTitle, int nCmdShow, HINSTANCE hInstance, WNDPROC WndProc) {
+Scene::Scene(const LONG _width, const LONG _height, const wchar_t* wndClassName, const wchar_t* wndTitle, int nCmdShow, HINSTANCE hInstance, WNDPROC WndProc) : dancingBushes(false) {
 
 	try
 	{
@@ -158,19 +116,72 @@ Scene::Scene(const LONG _width, const LONG _height, const wchar_t* wndClassName,
 		if (!dx)
 			throw exception("Cannot create Direct3D device and context model");
 
-		// 7. Setup application-specific objects
+		// 7. Create shader / pipeline state cache (used by initialiseSceneResources to create effects)
+		pipelineCache = DXPipelineCache::CreatePipelineCache(dx->getDevice());
+
+		if (!pipelineCache)
+			throw exception("Cannot create pipeline cache");
+
+		// 8. Create worker threads (optional - used for texture loads and pass recording) and the texture streamer (64MB budget)
+		jobSystem = CGDJobSystem::CreateJobSystem();
+
+		DXTextureStreamingBackend *textureStreamingBackend = DXTextureStreamingBackend::CreateTextureStreamingBackend(dx->getDevice(), dx->getDeviceContext());
+
+		if (!textureStreamingBackend)
+			throw exception("Cannot create texture streaming backend");
+
+		textureStreamer = CGDTextureStreamer::CreateTextureStreamer(textureStreamingBackend, 64 << 20, jobSystem);
+		textureStreamingBackend->release();
+
+		if (!textureStreamer)
+			throw exception("Cannot create texture streamer");
+
+		// 9. Setup application-specific objects
 		HRESULT hr = initialiseSceneResources();
 
 		if (!SUCCEEDED(hr))
 			throw exception("Cannot initalise scene resources");
 
+		pipelineCache->reportStats();
+
 
-		// 8. Create main clock / FPS timer (do this last with deferred start of 3 seconds so min FPS / SPF are not skewed by start-up events firing and taking CPU cycles).
+		// 10. Create main clock / FPS timer (do this last with deferred start of 3 seconds so min FPS / SPF are not skewed by start-up events firing and taking CPU cycles).
 		mainClock = CGDClock::CreateClock(string("mainClock"), 3.0f);
 
 		if (!mainClock)
 			throw exception("Cannot create main clock / timer");
 
+		// 11. Create per-frame memory arena
+		frameArena = GUMemoryArena::CreateArena(1 << 20, gu_mem_scene);
+
+		if (!frameArena)
+			throw exception("Cannot create frame memory arena");
+
+		// 12. Create GPU pass profiler (triple buffered timestamp queries).  GPU timing is optional so failure here is not fatal
+		DXGPUTimerBackend *gpuTimerBackend = DXGPUTimerBackend::CreateGPUTimerBackend(dx->getDevice(), dx->getDeviceContext());
+
+		if (gpuTimerBackend) {
+
+			gpuProfiler = CGDGPUProfiler::CreateGPUProfiler(gpuTimerBackend);
+			gpuTimerBackend->release();
+		}
+
+		// 13. Create deferred contexts and register the cube map and main passes
+		hr = initialisePasses();
+
+		if (!SUCCEEDED(hr))
+			throw exception("Cannot create scene passes");
+
+		// 14. Create the fixed-step scene simulation (60 Hz).  It runs inline in updateScene against simClock, which follows the main clock's game time so the simulation pauses with the main clock
+		simClock = CGDVirtualClock::CreateVirtualClock();
+
+		if (!simClock)
+			throw exception("Cannot create simulation clock");
+
+		simulation = CGDSimulation::CreateSimulation(simClock, 1.0 / 60.0, [=](gu_seconds time, gu_seconds dt) { stepSimulation(time, dt); }, false);
+
+		if (!simulation)
+			throw exception("Cannot create scene simulation");
 	}
 	catch (exception &e)
 	{
@@ -194,6 +205,120 @@ BOOL Scene::isMinimised() {
 	return (GetWindowPlacement(wndHandle, &wp) != 0 && wp.showCmd == SW_SHOWMINIMIZED);
 }
 
+// Create the deferred contexts and per-context render state and register the scene passes
+HRESULT Scene::initialisePasses() {
+
+	// Worker threads are optional (see the constructor) - without them the passes are rendered on the immediate context
+	// One deferred context per thread that can record (the workers plus the main thread while it waits), at most one per deferred pass
+	uint32_t numContexts = (jobSystem) ? min(jobSystem->workerCount() + 1, 7u) : 0;
+
+	commandBackend = DXCommandBackend::CreateCommandBackend(dx->getDevice(), dx->getDeviceContext(), numContexts);
+
+	if (!commandBackend)
+		return E_FAIL;
+
+	if (commandBackend->recordingContextCount() > 0 && !commandBackend->hasDriverCommandLists())
+		cout << "Driver does not support command lists natively - deferred contexts are emulated by the runtime\n";
+
+	passScheduler = CGDPassScheduler::CreatePassScheduler(commandBackend, jobSystem);
+
+	if (!passScheduler)
+		return E_FAIL;
+
+	passScheduler->setGPUProfiler(gpuProfiler);
+
+	// Render queue and state cache for each deferred context followed by the immediate context
+	numContexts = commandBackend->recordingContextCount();
+
+	sceneContexts.resize(numContexts + 1);
+
+	for (uint32_t i = 0; i <= numContexts; i++) {
+
+		SceneContext& sc = sceneContexts[i];
+
+		sc.context = (i < numContexts) ? commandBackend->getDeferredContext(i) : dx->getDeviceContext();
+		sc.renderQueue = CGDRenderQueue::CreateRenderQueue();
+
+		DXRenderContext *renderContext = DXRenderContext::CreateRenderContext(sc.context);
+
+		if (renderContext) {
+
+			sc.stateCache = CGDStateCache::CreateStateCache(renderContext);
+			renderContext->release();
+		}
+
+		if (!sc.renderQueue || !sc.stateCache)
+			return E_FAIL;
+	}
+
+	// Shadow cascades first since the faces and the main view sample them, then the cube map faces, then mip generation once all faces are rendered, then the main view which samples the cube map
+	vector<uint32_t> shadowPasses;
+
+	for (uint32_t i = 0; shadowMaps && i < cascadedShadows->getCascadeCount(); i++)
+		shadowPasses.push_back(passScheduler->addPass("shadowCascade", [this, i](void *context, uint32_t contextIndex) { recordShadowCascade(getSceneContext(contextIndex), i); }));
+
+	uint32_t facePasses[6];
+
+	for (int i = 0; i < 6; i++)
+		facePasses[i] = passScheduler->addPass("cubeMapFace", [this, i](void *context, uint32_t contextIndex) { recordCubeMapFace(getSceneContext(contextIndex), i); });
+
+	// GenerateMips runs on the immediate context between the face and main command lists
+	uint32_t mipsPass = passScheduler->addPass("generateMips", [this](void *context, uint32_t contextIndex) { ((ID3D11DeviceContext*)context)->GenerateMips(mDynamicCubeMapSRV); }, false);
+
+	uint32_t mainPass = passScheduler->addPass("mainPass", [this](void *context, uint32_t contextIndex) { recordMainPass(getSceneContext(contextIndex)); });
+
+	// The post-processing chain runs on the immediate context so each of its passes can be timed by the GPU profiler
+	uint32_t postPass = passScheduler->addPass("postProcess", [this](void *context, uint32_t contextIndex) { renderPostProcess(getSceneContext(contextIndex)); }, false);
+
+	for (int i = 0; i < 6; i++)
+		passScheduler->addDependency(mipsPass, facePasses[i]);
+
+	passScheduler->addDependency(mainPass, mipsPass);
+
+	for (uint32_t shadowPass : shadowPasses) {
+
+		for (int i = 0; i < 6; i++)
+			passScheduler->addDependency(facePasses[i], shadowPass);
+
+		passScheduler->addDependency(mainPass, shadowPass);
+	}
+	passScheduler->addDependency(postPass, mainPass);
+
+	cout << "Scene passes recorded on " << numContexts << " deferred contexts" << ((passScheduler->isParallel()) ? "" : " (serial)") << endl;
+
+	return S_OK;
+}
+
+void Scene::releasePasses() {
+
+	// Release the scheduler first - it retains the job system and backend
+	if (passScheduler)
+		passScheduler->release();
+
+	for (size_t i = 0; i < sceneContexts.size(); i++) {
+
+		if (sceneContexts[i].renderQueue)
+			sceneContexts[i].renderQueue->release();
+
+		if (sceneContexts[i].stateCache)
+			sceneContexts[i].stateCache->release();
+	}
+
+	sceneContexts.clear();
+
+	if (commandBackend)
+		commandBackend->release();
+
+	if (jobSystem)
+		jobSystem->release();
+}
+
+// Return the SceneContext for a pass context index (see CGDPassFunction)
+Scene::SceneContext& Scene::getSceneContext(uint32_t contextIndex) {
+
+	return (contextIndex == CGD_IMMEDIATE_CONTEXT) ? sceneContexts.back() : sceneContexts[contextIndex];
+}
+
 //
 // Public interface implementation
 //
@@ -222,15 +347,26 @@ Scene::~Scene() {
 	
 	//free local resources
 
-	if (cBufferExtSrc)
-		_aligned_free(cBufferExtSrc);
+	// Save any camera path still being recorded
+	if (cameraPath)
+		toggleCameraPathRecording();
+
+	if (frameConstants)
+		gu_aligned_delete(frameConstants);
 
 	if (mainCamera)
 		delete(mainCamera);
 
 
-	if (brickTexture)
-		delete(brickTexture);
+	// Delete the textures before the streamer they are registered with
+	Texture *textures[] = { brickTexture, rustDiffTexture, rustSpecTexture, envMapTexture, grassDiffuseMap, grassAlphaMap, grassHeightMap, grassNormalMap, grassTex, dropshipTex };
+
+	for (Texture *t : textures)
+		if (t)
+			delete(t);
+
+	if (textureStreamer)
+		textureStreamer->release();
 	
 	if (perPixelLightingEffect)
 		delete(perPixelLightingEffect);
@@ -240,8 +376,25 @@ Scene::~Scene() {
 	if (mainClock)
 		mainClock->release();
 
-	if (cBufferBridge)
-		cBufferBridge->Release();
+	if (simulation)
+		simulation->release();
+
+	if (simClock)
+		simClock->release();
+
+	if (gpuProfiler)
+		gpuProfiler->release();
+
+	if (frameArena)
+		frameArena->release();
+
+	releasePasses();
+
+	if (pipelineCache)
+		pipelineCache->release();
+
+	if (constantBuffers)
+		constantBuffers->release();
 
 	if (bridge)
 		bridge->release();
@@ -249,6 +402,36 @@ Scene::~Scene() {
 	if (cube)
 		cube->release();
 
+	if (grassShells)
+		delete(grassShells);
+
+	if (oceanSurface)
+		oceanSurface->release();
+
+	if (postProcess)
+		postProcess->release();
+
+	if (lightClusters)
+		lightClusters->release();
+
+	if (clusteredLighting)
+		clusteredLighting->release();
+
+	if (shadowMaps)
+		shadowMaps->release();
+
+	if (cascadedShadows)
+		cascadedShadows->release();
+
+	if (ocean)
+		ocean->release();
+
+	if (oceanEffect)
+		delete(oceanEffect);
+
+	if (shellGrass)
+		shellGrass->release();
+
 	if (dx) {
 
 		dx->release();
@@ -279,6 +462,14 @@ HRESULT Scene::resizeResources() {
 		// Only process resize if the DXSystem *dx exists (on initial resize window creation this will not be the case so this branch is ignored)
 		HRESULT hr = dx->resizeSwapChainBuffers(wndHandle);
 		rebuildViewport(mainCamera);
+
+		// The post-processing targets follow the back buffer size and the view of the depth buffer is rebuilt for the new buffer
+		if (postProcess && !postProcess->resize(dx->getDevice(), (uint32_t)viewport.Width, (uint32_t)viewport.Height, dx->getDepthStencilBuffer())) {
+
+			postProcess->release();
+			postProcess = nullptr;
+		}
+
 		RECT clientRect;
 		GetClientRect(wndHandle, &clientRect);
 
@@ -290,12 +481,18 @@ HRESULT Scene::resizeResources() {
 
 // Helper function to call updateScene followed by renderScene
 HRESULT Scene::updateAndRenderScene() {
-	ID3D11DeviceContext *context = dx->getDeviceContext();
-	HRESULT hr = updateScene(context, mainCamera);
+
+	// Release the previous frame's scratch memory
+	frameArena->reset();
+
+	HRESULT hr = updateScene();
 
 	if (SUCCEEDED(hr))
 		hr = renderScene();
 
+	// Sample allocation rates (updated at most once per second)
+	gu_memory_update_rates();
+
 	return hr;
 }
 
@@ -315,6 +512,31 @@ void Scene::reportTimingData() {
 	cout << "Actual time elapsed = " << mainClock->actualTimeElapsed() << endl;
 	cout << "Game time elapsed = " << mainClock->gameTimeElapsed() << endl << endl;
 	mainClock->reportTimingData();
+
+	if (gpuProfiler)
+		gpuProfiler->reportTimingData();
+
+	frameArena->reportUsage("\nFrame arena");
+
+	for (size_t i = 0; i < sceneContexts.size(); i++) {
+
+		cout << ((i + 1 < sceneContexts.size()) ? "Deferred context " : "Immediate context ") << i << ": ";
+		sceneContexts[i].stateCache->reportStats();
+	}
+
+	if (jobSystem)
+		jobSystem->reportStats();
+
+	simulation->reportStats();
+
+	if (textureStreamer)
+		textureStreamer->reportStats();
+
+	if (cascadedShadows)
+		cascadedShadows->reportStats();
+
+	if (constantBuffers)
+		constantBuffers->reportStats();
 }
 
 //
@@ -352,6 +574,39 @@ void Scene::handleKeyDown(const WPARAM keyCode, const LPARAM extKeyFlags) {
 			if (dancingBushes == true) dancingBushes = false;
 			else dancingBushes = true;
 			break;
+
+		case 'R':
+			toggleCameraPathRecording();
+			break;
+
+		case 'O':
+			if (oceanSurface)
+				cout << "Ocean simulated on the " << ((oceanSurface->setGPUSimulation(!oceanSurface->isGPUSimulation())) ? "GPU" : "CPU") << endl;
+			break;
+
+		case 'P':
+			if (postProcess) {
+
+				postProcessing = !postProcessing;
+				cout << "Post-processing " << ((postProcessing) ? "on" : "off") << endl;
+			}
+			break;
+
+		case 'L':
+			// Cycle the lit lanterns through 0, 256, 1024 and all of them
+			numLanterns = (numLanterns >= (uint32_t)lanternHeights.size()) ? 0 : min(max(numLanterns * 4, 256u), (uint32_t)lanternHeights.size());
+			cout << "Local lights: " << 2 + numLanterns << endl;
+			break;
+
+		case 'H':
+			if (shadowMaps) {
+
+				// Cached static layers are not kept up to date while shadows are off
+				shadowsEnabled = !shadowsEnabled;
+				cascadedShadows->invalidate();
+				cout << "Shadows " << ((shadowsEnabled) ? "on" : "off") << endl;
+			}
+			break;
 	}
 }
 
@@ -361,6 +616,26 @@ void Scene::handleKeyUp(const WPARAM keyCode, const LPARAM extKeyFlags) {
 	// Add key up handler here...
 }
 
+// Start recording mainCamera into a new camera path or stop and save the current recording.  Keyframes are added in updateScene for each simulation step so the path has the simulation's fixed timestep whatever the frame rate
+void Scene::toggleCameraPathRecording() {
+
+	if (!cameraPath) {
+
+		cameraPath = CGDCameraPath::CreateCameraPath(simulation->getStepSize());
+		cameraPathSteps = simulation->stepCount();
+
+		cout << "Recording camera path...\n";
+
+	} else {
+
+		if (cameraPath->save("camera_path.txt"))
+			cout << "Saved camera path (" << cameraPath->keyframeCount() << " keyframes) to camera_path.txt\n";
+
+		cameraPath->release();
+		cameraPath = nullptr;
+	}
+}
+
 //
 // Methods to handle initialisation, update and rendering of the scene
 //
@@ -429,44 +704,9 @@ HRESULT Scene::rebuildReflectiveViewport(Camera *camera) {
 }
 
 
-HRESULT Scene::LoadShader(ID3D11Device *device, const char *filename, char **PSBytecode, ID3D11PixelShader **pixelShader){
-
-	char *PSBytecodeLocal;
-
-	//Load the compiled shader byte code.
-	uint32_t shaderBytes = DXLoadCSO(filename, &PSBytecodeLocal);
-
-	PSBytecode = &PSBytecodeLocal;
-	cout << "Done: PShader memory bytes = " << shaderBytes << endl;
-	// Create shader object
-	HRESULT hr = device->CreatePixelShader(PSBytecodeLocal, shaderBytes, NULL, pixelShader);
-	
-	if (!SUCCEEDED(hr))
-		throw std::exception("Cannot create PixelShader interface");
-	return hr;
-}
-
-
-uint32_t Scene::LoadShader(ID3D11Device *device, const char *filename, char **VSBytecode, ID3D11VertexShader **vertexShader){
-
-	char *VSBytecodeLocal;
-
-	//Load the compiled shader byte code.
-	uint32_t shaderBytes = DXLoadCSO(filename, &VSBytecodeLocal);
-
-	cout << "Done: VShader memory bytes = " << shaderBytes << endl;
-
-	*VSBytecode = VSBytecodeLocal;
-	cout << "Done: VShader writting = " << shaderBytes << endl;
-	HRESULT hr = device->CreateVertexShader(VSBytecodeLocal, shaderBytes, NULL, vertexShader);
-	cout << "Done: VShader return = " << hr << endl;
-	if (!SUCCEEDED(hr))
-		throw std::exception("Cannot create VertexShader interface");
-	return shaderBytes;
-}
-
 // Main resource setup for the application.  These are setup around a given Direct3D device.
 HRESULT Scene::initialiseSceneResources() {
+	GU_MEMORY_TAG_SCOPE(gu_mem_scene);
 	//ID3D11DeviceContext *context = dx->getDeviceContext();
 	ID3D11Device *device = dx->getDevice();
 	if (!device)
@@ -570,122 +810,56 @@ HRESULT Scene::initialiseSceneResources() {
 	mCubeMapViewport.MinDepth = 0.0f;
 	mCubeMapViewport.MaxDepth = 1.0f;
 
-	//////////////////////////////////////////////////////// Tutorial Begin
-	//Tutorial 04 task 1 create render target texture
-	
-	D3D11_TEXTURE2D_DESC texDesc;
-	// fill out texture descrition
-	texDesc.Width = viewport.Width;
-	texDesc.Height = viewport.Height;
-	texDesc.MipLevels = 1;
-	texDesc.ArraySize =1;
-
-	//texDesc.SampleDesc.Count = 8; // Multi-sample properties much match the above DXGI_SWAP_CHAIN_DESC structure
-
-	texDesc.SampleDesc.Count = 1;
-	texDesc.SampleDesc.Quality = 0;
-	texDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
-	texDesc.Usage = D3D11_USAGE_DEFAULT;
-	texDesc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
-	texDesc.CPUAccessFlags = 0;
-	texDesc.MiscFlags = D3D11_RESOURCE_MISC_GENERATE_MIPS;
-
-	//Create Texture
-	ID3D11Texture2D *renderTargetTexture = nullptr;
-	hr = device->CreateTexture2D(&texDesc, 0, &renderTargetTexture);
-
-	//Create render target view
-	D3D11_RENDER_TARGET_VIEW_DESC rtvDesc;
-	rtvDesc.Format = texDesc.Format;
-	rtvDesc.ViewDimension = D3D11_RTV_DIMENSION_TEXTURE2DMS;
-	rtvDesc.Texture2DArray.MipSlice = 0;
-	rtvDesc.Texture2DArray.ArraySize = 1;
-	rtvDesc.Texture2DArray.FirstArraySlice = 0;
-
-	hr = device->CreateRenderTargetView(renderTargetTexture, &rtvDesc, &renderTargetRTV);
-
-	//Geometry Shader Stuff
-	//////////////////////////////
-
-	////Create shader resource view
-	//D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc;
-	//srvDesc.Format = texDesc.Format;
-	//srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
-	//srvDesc.Texture2D.MostDetailedMip = 0;
-	//srvDesc.Texture2D.MipLevels = 0;
-
-	//hr = device->CreateShaderResourceView(renderTargetTexture, &srvDesc, &renderTargetSRV);
-
-	//// Create the 6-face render target view
-	//D3D11_RENDER_TARGET_VIEW_DESC DescRT;
-	//DescRT.Format = dsvDesc.Format;
-	//DescRT.ViewDimension = D3D11_RTV_DIMENSION_TEXTURE2DARRAY;
-	//DescRT.Texture2DArray.FirstArraySlice = 0;
-	//DescRT.Texture2DArray.ArraySize = 6;
-	//DescRT.Texture2DArray.MipSlice = 0;
-	//device->CreateRenderTargetView(renderTargetTexture, &DescRT, &renderTargetRTV);
-
-	//ID3D11RenderTargetView* aRTViews[1] = { renderTargetRTV };
-	//context->OMSetRenderTargets(sizeof(aRTViews) / sizeof(aRTViews[0]),	aRTViews, mDynamicCubeMapDSV);
-
-	// View saves reference.
-	renderTargetTexture->Release();
+	// Post-processing chain.  The main pass renders into its scene target (the back buffer if it cannot be created)
+	postProcess = DXPostProcess::CreatePostProcess(device, pipelineCache, (uint32_t)viewport.Width, (uint32_t)viewport.Height, dx->getDepthStencilBuffer());
 
 	// Setup objects for the programmable (shader) stages of the pipeline
 
-	perPixelLightingEffect = new Effect(device, "Shaders\\cso\\per_pixel_lighting_vs.cso", "Shaders\\cso\\per_pixel_lighting_ps.cso", extVertexDesc, ARRAYSIZE(extVertexDesc));
-	perPixelLightingEffectGrass = new Effect(device, "Shaders\\cso\\per_pixel_lighting_grass_vs.cso", "Shaders\\cso\\per_pixel_lighting_ps.cso", extVertexDesc, ARRAYSIZE(extVertexDesc));
-
-	skyBoxEffect = new Effect(device, "Shaders\\cso\\sky_box_vs.cso", "Shaders\\cso\\sky_box_ps.cso", extVertexDesc, ARRAYSIZE(extVertexDesc));
-	//basicEffect = new Effect(device, "Shaders\\cso\\basic_colour_vs.cso", "Shaders\\cso\\basic_colour_ps.cso", "Shaders\\cso\\basic_colour_gs.cso", basicVertexDesc, ARRAYSIZE(basicVertexDesc));
-	basicEffect = new Effect(device, "Shaders\\cso\\basic_texture_vs.cso", "Shaders\\cso\\basic_texture_ps.cso", basicVertexDesc, ARRAYSIZE(basicVertexDesc));
-	refMapEffect = new Effect(device, "Shaders\\cso\\reflection_map_vs.cso", "Shaders\\cso\\reflection_map_ps.cso", extVertexDesc, ARRAYSIZE(extVertexDesc));
-	grassEffect = new Effect(device, "Shaders\\cso\\grass_vs.cso", "Shaders\\cso\\grass_ps.cso", extVertexDesc, ARRAYSIZE(extVertexDesc));
-
-	// Setup CBuffer
-	cBufferExtSrc = (CBufferExt*)_aligned_malloc(sizeof(CBufferExt), 16);
-	// Initialise CBuffer
-	cBufferExtSrc->worldMatrix = XMMatrixIdentity();
-	cBufferExtSrc->worldITMatrix = XMMatrixIdentity();
-	//cBufferExtSrc->WVPMatrix = mainCamera->getViewMatrix()*projMatrix->projMatrix;
-	cBufferExtSrc->WVPMatrix = mainCamera->getViewMatrix()*mainCamera->getProjMatrix();
-	cBufferExtSrc->lightVec = XMFLOAT4(-250.0, 130.0, 145.0, 1.0); // Positional light
-	cBufferExtSrc->lightAmbient = XMFLOAT4(0.3, 0.3, 0.3, 1.0);
-	cBufferExtSrc->lightDiffuse = XMFLOAT4(0.8, 0.8, 0.8, 1.0);
-	cBufferExtSrc->lightSpecular = XMFLOAT4(1.0, 1.0, 1.0, 1.0);
-
-	cBufferExtSrc->lightVec2 = XMFLOAT4(250.0, 130.0, 145.0, 1.0); // Positional light
-	cBufferExtSrc->lightAmbient2 = XMFLOAT4(0.1, 0.3, 0.3, 1.0);
-	cBufferExtSrc->lightDiffuse2 = XMFLOAT4(0.1, 0.4, 0.3, 1.0);
-	cBufferExtSrc->lightSpecular2 = XMFLOAT4(1.0, 1.0, 1.0, 1.0);
-
-	cBufferExtSrc->lightVec3 = XMFLOAT4(-20.0, 20.0, 20.0, 0.0); // Spot light
-	cBufferExtSrc->lightAmbient3 = XMFLOAT4(0.1, 0.05, 0.1, 1.0);
-	cBufferExtSrc->lightDiffuse3 = XMFLOAT4(0.2, 0.1, 0.2, 1.0);
-	cBufferExtSrc->lightSpecular3 = XMFLOAT4(1.0, 1.0, 1.0, 1.0);
-
-	XMStoreFloat4(&cBufferExtSrc->eyePos, mainCamera->getPos());// camera->pos;
-
-	D3D11_BUFFER_DESC cbufferDesc;
-	D3D11_SUBRESOURCE_DATA cbufferInitData;
-	ZeroMemory(&cbufferDesc, sizeof(D3D11_BUFFER_DESC));
-	ZeroMemory(&cbufferInitData, sizeof(D3D11_SUBRESOURCE_DATA));
-	cbufferDesc.ByteWidth = sizeof(CBufferExt);
-	cbufferDesc.Usage = D3D11_USAGE_DYNAMIC;
-	cbufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
-	cbufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-	cbufferInitData.pSysMem = cBufferExtSrc;
-	
-	//Create CBuffers
-	hr = device->CreateBuffer(&cbufferDesc, &cbufferInitData, &cBufferBridge);
-	hr = device->CreateBuffer(&cbufferDesc, &cbufferInitData, &cBufferSkyBox);
-	hr = device->CreateBuffer(&cbufferDesc, &cbufferInitData, &cBufferSphere);
-	hr = device->CreateBuffer(&cbufferDesc, &cbufferInitData, &cBufferGrass);
-	hr = device->CreateBuffer(&cbufferDesc, &cbufferInitData, &cBufferDropship);
-	for (int i = 0; i < 40; i++)
-	{
-		hr = device->CreateBuffer(&cbufferDesc, &cbufferInitData, &cBufferBush[i]);
-	}
+	perPixelLightingEffect = new Effect(pipelineCache, "Shaders\\cso\\per_pixel_lighting_vs.cso", "Shaders\\cso\\per_pixel_lighting_ps.cso", extVertexDesc, ARRAYSIZE(extVertexDesc));
+	perPixelLightingEffectGrass = new Effect(pipelineCache, "Shaders\\cso\\per_pixel_lighting_grass_vs.cso", "Shaders\\cso\\per_pixel_lighting_ps.cso", extVertexDesc, ARRAYSIZE(extVertexDesc));
+
+	skyBoxEffect = new Effect(pipelineCache, "Shaders\\cso\\sky_box_vs.cso", "Shaders\\cso\\sky_box_ps.cso", extVertexDesc, ARRAYSIZE(extVertexDesc));
+	//basicEffect = new Effect(pipelineCache, "Shaders\\cso\\basic_colour_vs.cso", "Shaders\\cso\\basic_colour_ps.cso", "Shaders\\cso\\basic_colour_gs.cso", basicVertexDesc, ARRAYSIZE(basicVertexDesc));
+	basicEffect = new Effect(pipelineCache, "Shaders\\cso\\basic_texture_vs.cso", "Shaders\\cso\\basic_texture_ps.cso", basicVertexDesc, ARRAYSIZE(basicVertexDesc));
+	refMapEffect = new Effect(pipelineCache, "Shaders\\cso\\reflection_map_vs.cso", "Shaders\\cso\\reflection_map_ps.cso", extVertexDesc, ARRAYSIZE(extVertexDesc));
+	grassEffect = new Effect(pipelineCache, "Shaders\\cso\\grass_vs.cso", "Shaders\\cso\\grass_ps.cso", extVertexDesc, ARRAYSIZE(extVertexDesc));
+	oceanEffect = new Effect(pipelineCache, "Shaders\\cso\\ocean_vs.cso", "Shaders\\cso\\ocean_ps.cso", extVertexDesc, ARRAYSIZE(extVertexDesc));
+
+	// Setup CBuffers - frame (b3) and view (b4) buffers and a ring of per-object slots (b0) with room for every scene element (see CGDConstantBuffers)
+	CGDConstantBufferDesc constantDesc;
+
+	constantDesc.frameSize = sizeof(CBufferFrame);
+	constantDesc.viewSize = sizeof(CBufferView);
+	constantDesc.objectSize = sizeof(CBufferObject);
+	constantDesc.maxObjects = 64;
+
+	DXConstantBufferBackend *constantBackend = DXConstantBufferBackend::CreateConstantBufferBackend(device, dx->getDeviceContext(), constantDesc.frameSize, constantDesc.viewSize);
+
+	if (!constantBackend)
+		return E_FAIL;
+
+	constantBuffers = CGDConstantBuffers::CreateConstantBuffers(constantBackend, constantDesc);
+	constantBackend->release();
+
+	if (!constantBuffers)
+		return E_FAIL;
+
+	skyBoxObject = constantBuffers->addObject();
+	bridgeObject = constantBuffers->addObject();
+	sphereObject = constantBuffers->addObject();
+	grassObject = constantBuffers->addObject();
+	dropshipObject = constantBuffers->addObject();
+	oceanObject = constantBuffers->addObject();
+
+	// Initialise frame constants
+	frameConstants = gu_aligned_new<CBufferFrame>();
+
+	ZeroMemory(frameConstants, sizeof(CBufferFrame));
+
+	frameConstants->lightVec = XMFLOAT4(-250.0, 130.0, 145.0, 1.0); // Positional light
+	frameConstants->lightAmbient = XMFLOAT4(0.3, 0.3, 0.3, 1.0);
+	frameConstants->lightDiffuse = XMFLOAT4(0.8, 0.8, 0.8, 1.0);
+	frameConstants->lightSpecular = XMFLOAT4(1.0, 1.0, 1.0, 1.0);
 
 	// Setup example objects
 	//
@@ -693,16 +867,7 @@ HRESULT Scene::initialiseSceneResources() {
 	glossWhite.setSpecular(XMCOLOR(1, 1, 1, 1));
 	midWhite.setSpecular(XMCOLOR(0.5f, 0.5f, 0.5f, 1));
 
-	brickTexture = new Texture(device, L"Resources\\Textures\\brick_DIFFUSE.jpg");
-	envMapTexture = new Texture(device, L"Resources\\Textures\\grassenvmap1024.dds");
-	rustDiffTexture = new Texture(device, L"Resources\\Textures\\rustDiff.jpg");
-	rustSpecTexture = new Texture(device, L"Resources\\Textures\\rustSpec.jpg");
-	grassAlphaMap = new Texture(device, L"Resources\\Textures\\grassAlpha.tif");
-	grassDiffuseMap = new Texture(device, L"Resources\\Textures\\grass.png");
-	grassNormalMap = new Texture(device, L"Resources\\Textures\\normalmap.bmp");
-	grassHeightMap = new Texture(device, L"Resources\\Textures\\heightmap1.bmp");
-	grassTex = new Texture(device, L"Resources\\Textures\\grassTex.jpg");
-	dropshipTex = new Texture(device, L"Resources\\Textures\\dropship_texture.bmp");
+	loadTextures();
 
 	ID3D11ShaderResourceView *sphereTextureArray[] = { rustDiffTexture->SRV, mDynamicCubeMapSRV, rustSpecTexture->SRV };
 	ID3D11ShaderResourceView *grassTextureArray[] = { grassAlphaMap->SRV, grassDiffuseMap->SRV, grassNormalMap->SRV, grassHeightMap->SRV };
@@ -718,31 +883,141 @@ HRESULT Scene::initialiseSceneResources() {
 
 	floor = new Grid(100, 100, device, perPixelLightingEffectGrass, grassTex->SRV, &mattWhite);
 
-	//bush positions
-	for (int i = 0; i < 40; i++)
-	{
-		if (i < 10)
-		{
-			bushPosX[i] = 50;
-			bushPosZ[i] = 50 - (i * 10);
-		}
-		else if (i < 20)
-		{
-			bushPosX[i] = 50 - ((i-10) * 10);
-			bushPosZ[i] = -50;
-		}
-		else if (i < 30)
-		{
-			bushPosX[i] = -50;
-			bushPosZ[i] = -50 + ((i - 20) * 10);
-		}
-		else if (i < 40)
-		{
-			bushPosX[i] = -50 + ((i - 30) * 10);
-			bushPosZ[i] = 50;
+	// Grass shells over the floor - drawn as one instanced draw of the floor mesh (see CGDShellGrass)
+	grassShells = new Grid(100, 100, device, grassEffect, grassTex->SRV, &mattWhite);
+
+	CGDShellGrassDesc grassDesc;
+
+	grassDesc.bounds[0][0] = -50.0f; grassDesc.bounds[0][1] = -2.0f; grassDesc.bounds[0][2] = -50.0f;
+	grassDesc.bounds[1][0] = 49.0f; grassDesc.bounds[1][1] = -2.0f; grassDesc.bounds[1][2] = 49.0f;
+	grassDesc.height = grassLength * numGrassPasses;
+	grassDesc.maxShells = numGrassPasses;
+
+	shellGrass = CGDShellGrass::CreateShellGrass(grassDesc);
+
+	frameConstants->windDir = XMFLOAT4(0.8f, 0.0f, 0.6f, grassDesc.sway);
+	frameConstants->grassHeight = grassDesc.height;
+
+	// Bush positions - scattered over the floor outside a clearing around the sphere and bridge (see CGDFoliageScatter).  The floor is a single cluster so its instances are in random order and the first 40 are spread evenly over it
+	float clearing[32 * 32];
+
+	for (int z = 0; z < 32; z++) {
+
+		for (int x = 0; x < 32; x++) {
+
+			float dx = ((float)x / 31.0f - 0.5f) * 100.0f;
+			float dz = ((float)z / 31.0f - 0.5f) * 100.0f;
+
+			clearing[z * 32 + x] = (dx * dx + dz * dz < 25.0f * 25.0f) ? 0.0f : 1.0f;
 		}
 	}
 
+	CGDFoliageScatterDesc bushDesc;
+
+	bushDesc.bounds[0][0] = -50.0f; bushDesc.bounds[0][1] = -50.0f;
+	bushDesc.bounds[1][0] = 49.0f; bushDesc.bounds[1][1] = 49.0f;
+	bushDesc.spacing = 12.0f;
+	bushDesc.clusterSize = 100.0f;
+	bushDesc.minScale = 0.4f;
+	bushDesc.maxScale = 0.6f;
+	bushDesc.densityMap = CGDScatterMap::CreateScatterMap(32, 32, clearing);
+
+	CGDFoliageScatter *bushScatter = CGDFoliageScatter::CreateFoliageScatter(bushDesc);
+	CGDFoliageCluster bushCluster;
+
+	bushDesc.densityMap->release();
+	bushScatter->generateCluster(0, 0, bushCluster);
+	bushScatter->release();
+
+	numBushes = (uint32_t)min(bushCluster.instances.size(), (size_t)40);
+
+	for (uint32_t i = 0; i < numBushes; i++) {
+
+		bushes[i] = bushCluster.instances[i];
+		bushObjects[i] = constantBuffers->addObject();
+	}
+
+	// Clustered lighting.  The second and third lights of the per-object constants become a point light and a spot light on the sphere, followed by up to 4096 lanterns scattered over the floor - each lantern's range comes from its instance scale and its colour from its rotation
+	clusteredLighting = CGDClusteredLighting::CreateClusteredLighting();
+	lightClusters = DXClusteredLighting::CreateClusteredLighting(device, clusteredLighting);
+
+	const float pointPosition[3] = { 250.0f, 130.0f, 145.0f }, pointColour[3] = { 0.1f, 0.4f, 0.3f };
+	const float spotPosition[3] = { -20.0f, 20.0f, 20.0f }, spotDirection[3] = { 20.0f, -20.0f, -20.0f }, spotColour[3] = { 0.6f, 0.3f, 0.6f };
+
+	lights.push_back(CGDPointLight(pointPosition, 600.0f, pointColour));
+	lights.push_back(CGDSpotLight(spotPosition, spotDirection, 80.0f, 0.2f, 0.35f, spotColour));
+
+	CGDFoliageScatterDesc lanternDesc;
+
+	lanternDesc.bounds[0][0] = -50.0f; lanternDesc.bounds[0][1] = -50.0f;
+	lanternDesc.bounds[1][0] = 49.0f; lanternDesc.bounds[1][1] = 49.0f;
+	lanternDesc.spacing = 1.4f;
+	lanternDesc.clusterSize = 100.0f;
+	lanternDesc.minScale = 0.5f;
+	lanternDesc.maxScale = 1.5f;
+
+	CGDFoliageScatter *lanternScatter = CGDFoliageScatter::CreateFoliageScatter(lanternDesc);
+	CGDFoliageCluster lanternCluster;
+
+	lanternScatter->generateCluster(0, 0, lanternCluster);
+	lanternScatter->release();
+
+	for (size_t i = 0; i < lanternCluster.instances.size() && i < 4096; i++) {
+
+		const CGDFoliageInstance& l = lanternCluster.instances[i];
+		float colour[3];
+
+		for (int c = 0; c < 3; c++)
+			colour[c] = 0.75f + 0.75f * cosf(l.rotation + (float)c * 2.094f);
+
+		lanternHeights.push_back(l.scale - 1.5f);
+		lights.push_back(CGDPointLight(l.position, 2.0f + 2.0f * l.scale, colour));
+	}
+
+	numLanterns = min(numLanterns, (uint32_t)lanternHeights.size());
+
+	// Cascaded shadow maps of the sun.  The bridge and sphere never move so they are cached in the static layer of each cascade
+	CGDShadowDesc shadowDesc;
+
+	shadowDesc.resolution = 1024;
+	shadowDesc.cacheStatic = true;
+
+	cascadedShadows = CGDCascadedShadows::CreateCascadedShadows(shadowDesc);
+	shadowMaps = DXShadowMaps::CreateShadowMaps(device, pipelineCache, cascadedShadows);
+
+	ShadowCasterObject bridgeCaster = { bridge, bridgeObject, true }, sphereCaster = { sphere, sphereObject, true }, dropshipCaster = { dropship, dropshipObject, false };
+
+	shadowCasterObjects.push_back(bridgeCaster);
+	shadowCasterObjects.push_back(sphereCaster);
+	shadowCasterObjects.push_back(dropshipCaster);
+
+	for (uint32_t i = 0; i < numBushes; i++) {
+
+		ShadowCasterObject bushCaster = { bush, bushObjects[i], false };
+
+		shadowCasterObjects.push_back(bushCaster);
+	}
+
+	shadowCasters.resize(shadowCasterObjects.size());
+
+	// Ocean around the floor - 8 x 8 tiles of a 64 unit FFT patch centred on the floor (see CGDOcean and DXOceanSurface)
+	CGDOceanDesc oceanDesc;
+
+	oceanDesc.resolution = 256;
+	oceanDesc.patchSize = 64.0f;
+	oceanDesc.windDirX = 0.8f;
+	oceanDesc.windDirZ = 0.6f;
+
+	ocean = CGDOcean::CreateOcean(oceanDesc, jobSystem);
+	oceanSurface = DXOceanSurface::CreateOceanSurface(device, pipelineCache, ocean, oceanEffect, &glossWhite, envMapTexture->SRV, 8);
+
+	if (oceanSurface) {
+
+		frameConstants->oceanPatchSize = oceanSurface->getPatchSize();
+		frameConstants->oceanTilesPerSide = oceanSurface->getTilesPerSide();
+		frameConstants->oceanTileQuads = oceanSurface->getTileQuads();
+	}
+
 	BuildCubeFaceCamera(0, 0, 0);
 	return S_OK;
 }
@@ -791,248 +1066,471 @@ void Scene::BuildCubeFaceCamera(float x, float y, float z)
 	}
 }
 
-// Update scene state (perform animations etc)
-HRESULT Scene::updateScene(ID3D11DeviceContext *context, Camera *camera) {
+// Advance the scene animation by one fixed step.  Called by the simulation - publishes the previous and new state for rendering to interpolate between
+void Scene::stepSimulation(gu_seconds time, gu_seconds dt) {
 
-	mainClock->tick();
-	gu_seconds tDelta = mainClock->gameTimeElapsed();
+	SceneSimSnapshot& snapshot = simSnapshots.writeBuffer();
+
+	snapshot.previous = simState;
 
-	cBufferExtSrc->Timer = (FLOAT)tDelta;
-	XMStoreFloat4(&cBufferExtSrc->eyePos, camera->getPos());
+	simState.time = time;
+	simState.dropshipAngle = (float)(-time / 4.0);
+	simState.bushHeight = (dancingBushes) ? (float)(int)time : 0.0f;
 
-	// Update bridge cBuffer
-	// Scale and translate bridge world matrix
+	snapshot.current = simState;
 
-	cBufferExtSrc->worldMatrix = XMMatrixScaling(0.05, 0.05, 0.05)*XMMatrixTranslation(0, -2, 12);
-	cBufferExtSrc->worldITMatrix = XMMatrixTranspose(XMMatrixInverse(nullptr, cBufferExtSrc->worldMatrix));	
-	cBufferExtSrc->WVPMatrix = cBufferExtSrc->worldMatrix*camera->getViewMatrix()*camera->getProjMatrix();
-	mapCbuffer(cBufferExtSrc, cBufferBridge);
+	simSnapshots.publish();
+}
 
-	cBufferExtSrc->worldMatrix = XMMatrixScaling(1000 ,1000, 1000)*XMMatrixTranslation(0, 0, 0);
-	cBufferExtSrc->worldITMatrix = XMMatrixTranspose(XMMatrixInverse(nullptr, cBufferExtSrc->worldMatrix));
-	cBufferExtSrc->WVPMatrix = cBufferExtSrc->worldMatrix*camera->getViewMatrix()*camera->getProjMatrix();
-	mapCbuffer(cBufferExtSrc, cBufferSkyBox);
+// Update scene state (perform animations etc).  Called once per frame before the passes are recorded.  The simulation runs any fixed steps that are due and the latest snapshot is interpolated to the frame time once, so every pass sees the same state
+HRESULT Scene::updateScene() {
 
-	cBufferExtSrc->worldMatrix = XMMatrixScaling(1, 1, 1)*XMMatrixTranslation(0, 0, 0);//*XMMatrixRotationY(tDelta); // commented out due to edge issues
-	cBufferExtSrc->worldITMatrix = XMMatrixTranspose(XMMatrixInverse(nullptr, cBufferExtSrc->worldMatrix));
-	cBufferExtSrc->WVPMatrix = cBufferExtSrc->worldMatrix*camera->getViewMatrix()*camera->getProjMatrix();
-	mapCbuffer(cBufferExtSrc, cBufferSphere);
+	PROFILE_SCOPE("updateScene");
+	mainClock->tick();
 
-	cBufferExtSrc->worldMatrix = XMMatrixScaling(1, 1, 1)*XMMatrixTranslation(-50, -2, -50);
-	cBufferExtSrc->worldITMatrix = XMMatrixTranspose(XMMatrixInverse(nullptr, cBufferExtSrc->worldMatrix));
-	cBufferExtSrc->WVPMatrix = cBufferExtSrc->worldMatrix*camera->getViewMatrix()*camera->getProjMatrix();
-	mapCbuffer(cBufferExtSrc, cBufferGrass);
+	simClock->advance(mainClock->gameTimeDelta());
+	simulation->update();
 
-	cBufferExtSrc->worldMatrix = XMMatrixScaling(2, 2, 2)*XMMatrixTranslation(20, 10, 0)*XMMatrixRotationY(-tDelta/4);
-	cBufferExtSrc->worldITMatrix = XMMatrixTranspose(XMMatrixInverse(nullptr, cBufferExtSrc->worldMatrix));
-	cBufferExtSrc->WVPMatrix = cBufferExtSrc->worldMatrix*camera->getViewMatrix()*camera->getProjMatrix();
-	mapCbuffer(cBufferExtSrc, cBufferDropship);
+	// Record the camera once for each step the simulation ran this frame
+	if (cameraPath) {
 
-	int height = 0;
+		XMFLOAT3 position, direction;
 
-	if (dancingBushes == true)
-	{
-		height = tDelta;
-	}
+		XMStoreFloat3(&position, mainCamera->getPos());
+		XMStoreFloat3(&direction, mainCamera->getDir());
 
-	for (int i = 0; i < 40; i++)
-	{
-		cBufferExtSrc->worldMatrix = XMMatrixScaling(0.5, 0.5, 0.5)*XMMatrixTranslation(bushPosX[i]+50, height, bushPosZ[i]);
-		cBufferExtSrc->worldITMatrix = XMMatrixTranspose(XMMatrixInverse(nullptr, cBufferExtSrc->worldMatrix));
-		cBufferExtSrc->WVPMatrix = cBufferExtSrc->worldMatrix*camera->getViewMatrix()*camera->getProjMatrix();
-		mapCbuffer(cBufferExtSrc, cBufferBush[i]);
+		for (; cameraPathSteps < simulation->stepCount(); cameraPathSteps++)
+			cameraPath->record(&position.x, &direction.x);
 	}
 
+	simSnapshots.acquire();
+
+	const SceneSimSnapshot& snapshot = simSnapshots.readBuffer();
+	float alpha = CGDFixedStepLoop::InterpolationAlpha(simClock->now(), snapshot.current.time, simulation->getStepSize());
+
+	frameState.time = snapshot.previous.time + (snapshot.current.time - snapshot.previous.time) * alpha;
+	frameState.dropshipAngle = snapshot.previous.dropshipAngle + (snapshot.current.dropshipAngle - snapshot.previous.dropshipAngle) * alpha;
+	frameState.bushHeight = snapshot.current.bushHeight; // bushes jump between heights so are not interpolated
+
+	updateConstants();
+
+	// Ocean maps for the frame - on the immediate context before the passes that sample them are recorded
+	if (oceanSurface)
+		oceanSurface->update(dx->getDeviceContext(), frameState.time);
+
+	updateLighting();
+	updateShadows();
+	updateTextureStreaming();
+
 	return S_OK;
 }
 
-// Update scene state (perform animations etc)
-HRESULT Scene::updateScene(ID3D11DeviceContext *context, FirstPersonCamera *camera) {
+// Bob the lanterns over the floor, then assign the lit lights to the clusters of the main camera and upload them before the passes that read them are recorded
+void Scene::updateLighting() {
 
-	mainClock->tick();
-	gu_seconds tDelta = mainClock->gameTimeElapsed();
+	PROFILE_SCOPE("updateLighting");
 
-	cBufferExtSrc->Timer = (FLOAT)tDelta;
-	XMStoreFloat4(&cBufferExtSrc->eyePos, camera->getPos());
+	if (!lightClusters)
+		return;
 
-	// Update bridge cBuffer
-	// Scale and translate bridge world matrix
+	for (uint32_t i = 0; i < numLanterns; i++)
+		lights[2 + i].position[1] = lanternHeights[i] + 0.25f * sinf((float)frameState.time * 1.5f + (float)i * 0.37f);
 
-	cBufferExtSrc->worldMatrix = XMMatrixScaling(0.05, 0.05, 0.05)*XMMatrixTranslation(0, -2, 12);
-	cBufferExtSrc->worldITMatrix = XMMatrixTranspose(XMMatrixInverse(nullptr, cBufferExtSrc->worldMatrix));
-	cBufferExtSrc->WVPMatrix = cBufferExtSrc->worldMatrix*camera->getViewMatrix()*camera->getProjMatrix();
-	mapCbuffer(cBufferExtSrc, cBufferBridge);
+	XMFLOAT4X4 view, proj;
 
-	cBufferExtSrc->worldMatrix = XMMatrixScaling(1000, 1000, 1000)*XMMatrixTranslation(0, 0, 0);
-	cBufferExtSrc->worldITMatrix = XMMatrixTranspose(XMMatrixInverse(nullptr, cBufferExtSrc->worldMatrix));
-	cBufferExtSrc->WVPMatrix = cBufferExtSrc->worldMatrix*camera->getViewMatrix()*camera->getProjMatrix();
-	mapCbuffer(cBufferExtSrc, cBufferSkyBox);
+	XMStoreFloat4x4(&view, mainCamera->getViewMatrix());
+	XMStoreFloat4x4(&proj, mainCamera->getProjMatrix());
 
-	cBufferExtSrc->worldMatrix = XMMatrixScaling(1, 1, 1)*XMMatrixTranslation(0, 0, 0);//*XMMatrixRotationY(tDelta); // commented out due to edge issues
-	cBufferExtSrc->worldITMatrix = XMMatrixTranspose(XMMatrixInverse(nullptr, cBufferExtSrc->worldMatrix));
-	cBufferExtSrc->WVPMatrix = cBufferExtSrc->worldMatrix*camera->getViewMatrix()*camera->getProjMatrix();
-	mapCbuffer(cBufferExtSrc, cBufferSphere);
+	clusteredLighting->setView(&view._11, &proj._11);
+	lightClusters->update(dx->getDeviceContext(), lights.data(), 2 + numLanterns);
+}
 
-	cBufferExtSrc->worldMatrix = XMMatrixScaling(1, 1, 1)*XMMatrixTranslation(-50, -2, -50);
-	cBufferExtSrc->worldITMatrix = XMMatrixTranspose(XMMatrixInverse(nullptr, cBufferExtSrc->worldMatrix));
-	cBufferExtSrc->WVPMatrix = cBufferExtSrc->worldMatrix*camera->getViewMatrix()*camera->getProjMatrix();
-	mapCbuffer(cBufferExtSrc, cBufferGrass);
+// Move the casters' bounding spheres to world space for the frame, then fit the cascades to the main camera and cull the casters before the shadow passes are recorded
+void Scene::updateShadows() {
 
-	cBufferExtSrc->worldMatrix = XMMatrixScaling(2, 2, 2)*XMMatrixTranslation(20, 10, 0)*XMMatrixRotationY(-tDelta / 4);
-	cBufferExtSrc->worldITMatrix = XMMatrixTranspose(XMMatrixInverse(nullptr, cBufferExtSrc->worldMatrix));
-	cBufferExtSrc->WVPMatrix = cBufferExtSrc->worldMatrix*camera->getViewMatrix()*camera->getProjMatrix();
-	mapCbuffer(cBufferExtSrc, cBufferDropship);
+	PROFILE_SCOPE("updateShadows");
 
-	int height = 0;
+	if (!shadowMaps || !shadowsEnabled)
+		return;
 
-	if (dancingBushes == true)
-	{
-		height = tDelta;
+	for (uint32_t j = 0; j < (uint32_t)shadowCasterObjects.size(); j++) {
+
+		float sphere[4];
+		XMMATRIX world = casterWorldMatrix(j);
+
+		shadowCasterObjects[j].model->getBoundingSphere(sphere);
+
+		// The radius grows with the largest scale of the world matrix
+		float scale = max(max(XMVectorGetX(XMVector3Length(world.r[0])), XMVectorGetX(XMVector3Length(world.r[1]))), XMVectorGetX(XMVector3Length(world.r[2])));
+
+		XMStoreFloat3((XMFLOAT3*)shadowCasters[j].sphere, XMVector3TransformCoord(XMLoadFloat3((XMFLOAT3*)sphere), world));
+		shadowCasters[j].sphere[3] = sphere[3] * scale;
+		shadowCasters[j].isStatic = shadowCasterObjects[j].isStatic;
 	}
 
-	for (int i = 0; i < 40; i++)
-	{
-		cBufferExtSrc->worldMatrix = XMMatrixScaling(0.5, 0.5, 0.5)*XMMatrixTranslation(bushPosX[i]+50, height, bushPosZ[i]);
-		cBufferExtSrc->worldITMatrix = XMMatrixTranspose(XMMatrixInverse(nullptr, cBufferExtSrc->worldMatrix));
-		cBufferExtSrc->WVPMatrix = cBufferExtSrc->worldMatrix*camera->getViewMatrix()*camera->getProjMatrix();
-		mapCbuffer(cBufferExtSrc, cBufferBush[i]);
+	// The sun is a positional light far from the scene so its shadows are cast along the direction from it to the centre of the scene
+	float lightDirection[3] = { -frameConstants->lightVec.x, -frameConstants->lightVec.y, -frameConstants->lightVec.z };
+	XMFLOAT4X4 view, proj;
+
+	XMStoreFloat4x4(&view, mainCamera->getViewMatrix());
+	XMStoreFloat4x4(&proj, mainCamera->getProjMatrix());
+
+	cascadedShadows->update(&view._11, &proj._11, lightDirection, shadowCasters.data(), (uint32_t)shadowCasters.size());
+}
+
+// Set the frame constants and each object's world matrices for the frame, then upload the ones that changed on the immediate context.  Objects that have not moved since the last frame (the bridge, sphere, sky box, floor and ocean, and the bushes while they are not dancing) are not uploaded again
+void Scene::updateConstants() {
+
+	PROFILE_SCOPE("updateConstants");
+
+	frameConstants->Timer = (FLOAT)frameState.time;
+	constantBuffers->setFrame(frameConstants);
+
+	auto setObject = [this](uint32_t id, CXMMATRIX worldMatrix) {
+
+		CBufferObject constants;
+
+		constants.worldMatrix = worldMatrix;
+		constants.worldITMatrix = XMMatrixTranspose(XMMatrixInverse(nullptr, worldMatrix));
+		constantBuffers->setObject(id, &constants);
+	};
+
+	setObject(bridgeObject, casterWorldMatrix(0));
+	setObject(skyBoxObject, XMMatrixScaling(1000, 1000, 1000)*XMMatrixTranslation(0, 0, 0));
+	setObject(sphereObject, casterWorldMatrix(1));
+	setObject(grassObject, XMMatrixScaling(1, 1, 1)*XMMatrixTranslation(-50, -2, -50));
+	setObject(dropshipObject, casterWorldMatrix(2));
+
+	for (uint32_t i = 0; i < numBushes; i++)
+		setObject(bushObjects[i], casterWorldMatrix(3 + i));
+
+	// Ocean tiles start at the corner of the water, below the floor so the waves do not break through it
+	if (oceanSurface) {
+
+		float halfWidth = oceanSurface->getPatchSize() * (float)oceanSurface->getTilesPerSide() * 0.5f;
+
+		setObject(oceanObject, XMMatrixTranslation(-halfWidth, -3.5f, -halfWidth));
 	}
 
-	return S_OK;
+	constantBuffers->flush();
 }
 
-// Helper function to copy cbuffer data from cpu to gpu
-HRESULT Scene::mapCbuffer(void *cBufferExtSrcL, ID3D11Buffer *cBufferExtL)
-{
-	ID3D11DeviceContext *context = dx->getDeviceContext();
-	// Map cBuffer
-	D3D11_MAPPED_SUBRESOURCE res;
-	HRESULT hr = context->Map(cBufferExtL, 0, D3D11_MAP_WRITE_DISCARD, 0, &res);
+XMMATRIX Scene::casterWorldMatrix(uint32_t j) const {
+
+	switch (j) {
+
+		case 0:
+			return XMMatrixScaling(0.05, 0.05, 0.05)*XMMatrixTranslation(0, -2, 12);
 
-	if (SUCCEEDED(hr)) {
-		memcpy(res.pData, cBufferExtSrcL, sizeof(CBufferExt));
-		context->Unmap(cBufferExtL, 0);
+		case 1:
+			return XMMatrixScaling(1, 1, 1)*XMMatrixTranslation(0, 0, 0);//*XMMatrixRotationY(frameState.time); // commented out due to edge issues
+
+		case 2:
+			return XMMatrixScaling(2, 2, 2)*XMMatrixTranslation(20, 10, 0)*XMMatrixRotationY(frameState.dropshipAngle);
 	}
-	return hr;
+
+	const CGDFoliageInstance& b = bushes[j - 3];
+
+	return XMMatrixScaling(b.scale, b.scale, b.scale)*XMMatrixRotationY(b.rotation)*XMMatrixTranslation(b.position[0], b.position[1] + frameState.bushHeight, b.position[2]);
+}
+
+// Load the scene's textures in one batch.  Textures with a DDS version (with a mip chain) are streamed and the other images are decoded in parallel on the job system before their textures are created (see Texture::LoadBatch)
+void Scene::loadTextures() {
+
+	static const wchar_t *files[] = {
+
+		L"Resources\\Textures\\brick_DIFFUSE.jpg",
+		L"Resources\\Textures\\grassenvmap1024.dds",
+		L"Resources\\Textures\\rustDiff.jpg",
+		L"Resources\\Textures\\rustSpec.jpg",
+		L"Resources\\Textures\\grassAlpha.tif",
+		L"Resources\\Textures\\grass.png",
+		L"Resources\\Textures\\normalmap.bmp",
+		L"Resources\\Textures\\heightmap1.bmp",
+		L"Resources\\Textures\\grassTex.jpg",
+		L"Resources\\Textures\\dropship_texture.bmp"
+	};
+
+	Texture **textures[] = { &brickTexture, &envMapTexture, &rustDiffTexture, &rustSpecTexture, &grassAlphaMap, &grassDiffuseMap, &grassNormalMap, &grassHeightMap, &grassTex, &dropshipTex };
+
+	vector<wstring> filenames(files, files + sizeof(files) / sizeof(files[0]));
+	vector<Texture*> loaded;
+	CGDImageLoader *loader = CGDImageLoader::CreateImageLoader(jobSystem);
+
+	Texture::LoadBatch(dx->getDevice(), filenames, textureStreamer, loader, loaded);
+
+	loader->release();
+
+	for (size_t i = 0; i < loaded.size(); i++)
+		*textures[i] = loaded[i];
+}
+
+// Request the texture detail each object needs from the main camera (texture sizes in world units are approximate), apply the residency changes and rebind the views of the textures whose mips changed.  Textures that are not requested (the unused grass maps and the sky box) keep only their mip tail
+void Scene::updateTextureStreaming() {
+
+	PROFILE_SCOPE("updateTextureStreaming");
+
+	XMVECTOR eyePos = mainCamera->getPos();
+	float fovY = 0.25f*3.14f; // see rebuildViewport
+	float viewportHeight = viewport.Height;
+
+	auto distance = [&](FXMVECTOR p) { return XMVectorGetX(XMVector3Length(p - eyePos)); };
+
+	brickTexture->requestDetail(20.0f, distance(XMVectorSet(0, -2, 12, 1)), fovY, viewportHeight);
+	dropshipTex->requestDetail(10.0f, distance(XMVector3Transform(XMVectorSet(20, 10, 0, 1), XMMatrixRotationY(frameState.dropshipAngle))), fovY, viewportHeight);
+	rustDiffTexture->requestDetail(2.0f, distance(XMVectorZero()), fovY, viewportHeight);
+	rustSpecTexture->requestDetail(2.0f, distance(XMVectorZero()), fovY, viewportHeight);
+
+	// The nearest bush needs the most detail
+	float nearestBush = FLT_MAX;
+
+	for (uint32_t i = 0; i < numBushes; i++)
+		nearestBush = min(nearestBush, distance(XMVectorSet(bushes[i].position[0], bushes[i].position[1] + frameState.bushHeight, bushes[i].position[2], 1)));
+
+	grassDiffuseMap->requestDetail(2.0f, nearestBush, fovY, viewportHeight);
+
+	// The floor texture spans the 100 unit grid - the nearest point is directly below the camera
+	grassTex->requestDetail(100.0f, max(fabs(XMVectorGetY(eyePos) + 2.0f), 1.0f), fovY, viewportHeight);
+
+	if (textureStreamer->update() == 0)
+		return;
+
+	bridge->setTexture(0, brickTexture->SRV);
+	dropship->setTexture(0, dropshipTex->SRV);
+	bush->setTexture(0, grassDiffuseMap->SRV);
+	sphere->setTexture(0, rustDiffTexture->SRV);
+	sphere->setTexture(2, rustSpecTexture->SRV);
+	floor->setTexture(grassTex->SRV);
+	grassShells->setTexture(grassTex->SRV);
+}
+
+// Update pass constants for the given camera
+HRESULT Scene::updateScene(SceneContext& sceneContext, Camera *camera) {
+
+	return updatePassConstants(sceneContext, camera->getPos(), camera->getViewMatrix()*camera->getProjMatrix());
+}
+
+// Update pass constants for the given camera
+HRESULT Scene::updateScene(SceneContext& sceneContext, FirstPersonCamera *camera) {
+
+	return updatePassConstants(sceneContext, camera->getPos(), camera->getViewMatrix()*camera->getProjMatrix());
+}
+
+// Write the view constants of a pass and find the grass shells and bush depths it draws.  The object constants were uploaded once for the frame by updateConstants.  Each context writes its own copy of the view constants (see CGDConstantBuffers::setView) so passes can update concurrently
+HRESULT Scene::updatePassConstants(SceneContext& sceneContext, FXMVECTOR eyePos, CXMMATRIX viewProjMatrix) {
+
+	PROFILE_SCOPE("updatePassConstants");
+
+	// Grass shells visible from the pass camera
+	XMFLOAT4X4 viewProj;
+	XMFLOAT3 eye;
+
+	XMStoreFloat4x4(&viewProj, viewProjMatrix);
+	XMStoreFloat3(&eye, eyePos);
+	sceneContext.grassShells = shellGrass->visibleShells(&eye.x, &viewProj._11);
+
+	CBufferView view;
+
+	ZeroMemory(&view, sizeof(CBufferView));
+
+	view.viewProjMatrix = viewProjMatrix;
+	XMStoreFloat4(&view.eyePos, eyePos);
+	view.grassFirstShell = sceneContext.grassShells.firstShell;
+	view.grassShellCount = sceneContext.grassShells.shellCount;
+
+	constantBuffers->setView(sceneContext.context, &view);
+
+	// View space depth of each bush origin (w of the transformed origin)
+	for (uint32_t i = 0; i < numBushes; i++)
+		sceneContext.bushViewDepth[i] = XMVectorGetW(XMVector4Transform(casterWorldMatrix(3 + i).r[3], viewProjMatrix));
+
+	return S_OK;
 }
 
 // Render scene
 HRESULT Scene::renderScene()
 {
+	PROFILE_SCOPE("renderScene");
 
 	ID3D11DeviceContext *context = dx->getDeviceContext();
 	// Validate window and D3D context
 	if (isMinimised() || !context)
 		return E_FAIL;
 
-	// Clear the screen
-	static const FLOAT clearColor[4] = {1.0f, 0.0f, 0.0f, 1.0f };
-
-	// Save current render targets
-	ID3D11RenderTargetView* defaultRenderTargetView;
-	ID3D11DepthStencilView* defaultDepthStencilView;
+	if (gpuProfiler)
+		gpuProfiler->beginFrame();
 
-	context->OMGetRenderTargets(1, &defaultRenderTargetView, &defaultDepthStencilView);
-
-	ID3D11RenderTargetView* renderTargets[1];
-	// Generate the cube map by rendering to each cube map face.
-	context->RSSetViewports(1, &mCubeMapViewport);
+	// Cameras and viewports are only read while the passes are recorded so set them up first
 	for (int i = 0; i < 6; ++i)
-	{
-		updateScene(context, &mCubeMapCamera[i]);
 		rebuildReflectiveViewport(&mCubeMapCamera[i]);
-		// Clear cube map face and depth buffer.
-		context->ClearRenderTargetView(mDynamicCubeMapRTV[i], clearColor);
-		context->ClearDepthStencilView(mDynamicCubeMapDSV, D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0f, 0);
 
-		// Bind cube map face as render target.
-		renderTargets[0] = mDynamicCubeMapRTV[i];
-		context->OMSetRenderTargets(1, renderTargets, mDynamicCubeMapDSV);
-		// Draw the scene with the exception of the
-		// center sphere, to this cube map face.
-		renderSceneElements(context);
+	rebuildViewport(mainCamera);
+
+	// Record the cube map faces and main view (on worker threads if deferred contexts are available) and execute them in order
+	passScheduler->execute();
+
+	if (gpuProfiler)
+		gpuProfiler->endFrame();
+
+	// Present current frame to the screen
+	PROFILE_SCOPE("present");
+	HRESULT hr = dx->presentBackBuffer();
+
+	return S_OK;
+}
+
+// Record a shadow cascade.  With the static layer cached the static casters are only drawn when the cascade was refitted and the dynamic casters are drawn over a copy of them
+void Scene::recordShadowCascade(SceneContext& sceneContext, uint32_t cascade)
+{
+	if (!shadowsEnabled)
+		return;
+
+	ID3D11DeviceContext *context = sceneContext.context;
 
+	// The casters are drawn with the cascade's view projection
+	CBufferView view;
+
+	ZeroMemory(&view, sizeof(CBufferView));
+
+	view.viewProjMatrix = XMLoadFloat4x4((const XMFLOAT4X4*)cascadedShadows->getCascade(cascade).viewProj);
+	constantBuffers->setView(context, &view);
+
+	if (cascadedShadows->getDesc().cacheStatic) {
+
+		if (cascadedShadows->getCascade(cascade).staticDirty) {
+
+			shadowMaps->beginCascade(context, cascade, DXShadowLayer::STATIC);
+			drawShadowCasters(sceneContext, cascade, cascadedShadows->getStaticCasters(cascade));
+		}
+
+		shadowMaps->beginCascade(context, cascade, DXShadowLayer::DYNAMIC);
+		drawShadowCasters(sceneContext, cascade, cascadedShadows->getDynamicCasters(cascade));
+
+	} else {
+
+		shadowMaps->beginCascade(context, cascade, DXShadowLayer::ALL);
+		drawShadowCasters(sceneContext, cascade, cascadedShadows->getStaticCasters(cascade));
+		drawShadowCasters(sceneContext, cascade, cascadedShadows->getDynamicCasters(cascade));
 	}
-	// Have hardware generate lower mipmap levels of cube map.
-	context->GenerateMips(mDynamicCubeMapSRV);
+}
+
+// Record a cube map face.  Command lists start from default state so the face binds its own render target and viewport
+void Scene::recordCubeMapFace(SceneContext& sceneContext, int face)
+{
+	ID3D11DeviceContext *context = sceneContext.context;
+
+	static const FLOAT clearColor[4] = { 1.0f, 0.0f, 0.0f, 1.0f };
+
+	context->RSSetViewports(1, &mCubeMapViewport);
+
+	// Clear cube map face and depth buffer.
+	context->ClearRenderTargetView(mDynamicCubeMapRTV[face], clearColor);
+	context->ClearDepthStencilView(mDynamicCubeMapDSV, D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0f, 0);
+
+	// Bind cube map face as render target.
+	context->OMSetRenderTargets(1, &mDynamicCubeMapRTV[face], mDynamicCubeMapDSV);
+
+	// The light clusters are built for the main camera so the faces are lit by the sun alone.  The shadow cascades are fitted to the main camera too - pixels outside them are unshadowed
+	if (lightClusters)
+		lightClusters->bind(context, false);
+
+	if (shadowMaps)
+		shadowMaps->bind(context, shadowsEnabled);
+
+	// Draw the scene with the exception of the
+	// center sphere, to this cube map face.
+	updateScene(sceneContext, &mCubeMapCamera[face]);
+	renderSceneElements(sceneContext);
+}
+
+// Record the main view
+void Scene::recordMainPass(SceneContext& sceneContext)
+{
+	ID3D11DeviceContext *context = sceneContext.context;
+
+	static const FLOAT clearColor[4] = { 1.0f, 0.0f, 0.0f, 1.0f };
+
+	// With post-processing the view is rendered into the scene target and the postProcess pass draws it into the back buffer
+	ID3D11RenderTargetView *renderTargetView = (postProcess && postProcessing) ? postProcess->getSceneRTV() : dx->getBackBufferRTV();
+	ID3D11DepthStencilView *depthStencilView = dx->getDepthStencil();
 
-	// Restore old viewport and render targets.
 	context->RSSetViewports(1, &viewport);
-	renderTargets[0] = renderTargetRTV;
-	context->OMSetRenderTargets(1, &defaultRenderTargetView, defaultDepthStencilView);
+	context->ClearRenderTargetView(renderTargetView, clearColor);
+	context->ClearDepthStencilView(depthStencilView, D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0f, 0);
+	context->OMSetRenderTargets(1, &renderTargetView, depthStencilView);
 
-	//update scene for main camera
-	rebuildViewport(mainCamera);
-	updateScene(context, mainCamera);
+	if (lightClusters)
+		lightClusters->bind(context, true);
+
+	if (shadowMaps)
+		shadowMaps->bind(context, shadowsEnabled);
 
 	// Now draw the scene as normal, but with the center sphere.
-	context->ClearRenderTargetView(defaultRenderTargetView, clearColor);
-	context->ClearDepthStencilView(defaultDepthStencilView, D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0f, 0);
+	updateScene(sceneContext, mainCamera);
 
-	// Tutorial 04
-	renderSceneElements(context);
+	if (sphere)
+		sphere->submit(sceneContext.renderQueue, constantBuffers->getObjectBinding(sphereObject));
 
-	if (sphere) {
-		
-		// Apply the sphere cBuffer.
-		context->VSSetConstantBuffers(0, 1, &cBufferSphere);
-		context->PSSetConstantBuffers(0, 1, &cBufferSphere);
-		// Render
-		sphere->render(context);
-	}
+	renderSceneElements(sceneContext);
+}
 
-	// Present current frame to the screen
-	HRESULT hr = dx->presentBackBuffer();
+// Run the post-processing chain on the main view.  The chain sets state directly on the context so the context's state cache is invalidated
+void Scene::renderPostProcess(SceneContext& sceneContext)
+{
+	if (!postProcess || !postProcessing)
+		return;
 
-	return S_OK;
+	postProcess->render(sceneContext.context, dx->getBackBufferRTV(), gpuProfiler);
+	sceneContext.stateCache->invalidate();
 }
 
-HRESULT Scene::renderSceneElements(ID3D11DeviceContext *context)
+HRESULT Scene::renderSceneElements(SceneContext& sceneContext)
 {
-	if (bridge) {
-
-		// Setup pipeline for effect
-		// Apply the bridge cBuffer.
-		context->VSSetConstantBuffers(0, 1, &cBufferBridge);
-		context->PSSetConstantBuffers(0, 1, &cBufferBridge);
-		// Render
-		bridge->render(context);
-	}
+	PROFILE_SCOPE("renderSceneElements");
 
-	if (box) {
-		// Apply the box cBuffer.
-		context->VSSetConstantBuffers(0, 1, &cBufferSkyBox);
-		context->PSSetConstantBuffers(0, 1, &cBufferSkyBox);
-		// Render
-		box->render(context);
-	}
+	CGDRenderQueue *renderQueue = sceneContext.renderQueue;
 
-	if (floor) {
-		// Apply the box cBuffer.
-		context->VSSetConstantBuffers(0, 1, &cBufferGrass);
-		context->PSSetConstantBuffers(0, 1, &cBufferGrass);
-		// Render
-		floor->render(context);
-	}
+	// Queue the scene's draws.  The queue sorts them by effect, texture and mesh and replays them through the state cache so only state that changes between draws is set on the context (eg. consecutive bushes only change the offset of their object constants)
+	if (bridge)
+		bridge->submit(renderQueue, constantBuffers->getObjectBinding(bridgeObject));
 
-	if (dropship) {
-		// Apply the box cBuffer.
-		context->VSSetConstantBuffers(0, 1, &cBufferDropship);
-		context->PSSetConstantBuffers(0, 1, &cBufferDropship);
-		// Render
-		dropship->render(context);
-	}
+	if (box)
+		box->submit(renderQueue, constantBuffers->getObjectBinding(skyBoxObject));
 
-	for (int i = 0; i < 40; i++)
-	{
-		if (bush) {
-			// Apply the box cBuffer.
-			context->VSSetConstantBuffers(0, 1, &cBufferBush[i]);
-			context->PSSetConstantBuffers(0, 1, &cBufferBush[i]);
-			// Render
-			bush->render(context);
-		}
+	if (floor)
+		floor->submit(renderQueue, constantBuffers->getObjectBinding(grassObject));
+
+	if (oceanSurface)
+		oceanSurface->submit(renderQueue, constantBuffers->getObjectBinding(oceanObject));
+
+	// Every visible grass shell in one instanced draw, after the rest of the scene (layer 1) so the shells are depth tested against everything in front of them
+	if (grassShells && sceneContext.grassShells.instanceCount > 0)
+		grassShells->submit(renderQueue, constantBuffers->getObjectBinding(grassObject), 0.0f, 1, sceneContext.grassShells.instanceCount);
+
+	if (dropship)
+		dropship->submit(renderQueue, constantBuffers->getObjectBinding(dropshipObject));
+
+	if (bush) {
+
+		// Bushes are drawn nearest first (depth normalised by the far plane distance)
+		for (uint32_t i = 0; i < numBushes; i++)
+			bush->submit(renderQueue, constantBuffers->getObjectBinding(bushObjects[i]), sceneContext.bushViewDepth[i] / 1000.0f);
 	}
 
+	renderQueue->execute(sceneContext.stateCache);
+
 	return S_OK;
+}
+
+void Scene::drawShadowCasters(SceneContext& sceneContext, uint32_t cascade, const vector<uint32_t>& casters)
+{
+	// Casters are drawn with the object constants of the frame - the cascade's view projection is in the view constants (see recordShadowCascade)
+	for (uint32_t j : casters) {
+
+		const ShadowCasterObject& caster = shadowCasterObjects[j];
+
+		caster.model->submit(sceneContext.renderQueue, constantBuffers->getObjectBinding(caster.object), 0.0f, 0, shadowMaps->getCasterEffect());
+	}
+
+	sceneContext.renderQueue->execute(sceneContext.stateCache);
 }
\ No newline at end of file
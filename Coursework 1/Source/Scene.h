@@ -12,9 +12,34 @@
 #include <CBufferStructures.h>
 #include <Material.h>
 #include <Grid.h>
+#include <CGDTripleBuffer.h>
+#include <CGDShellGrass.h>
+#include <CGDFoliageScatter.h>
+#include <CGDClusteredLighting.h>
+#include <CGDCascadedShadows.h>
+#include <atomic>
+#include <vector>
 
 class DXSystem;
 class CGDClock;
+class CGDGPUProfiler;
+class GUMemoryArena;
+class DXPipelineCache;
+class CGDRenderQueue;
+class CGDStateCache;
+class CGDJobSystem;
+class CGDPassScheduler;
+class DXCommandBackend;
+class CGDVirtualClock;
+class CGDSimulation;
+class CGDCameraPath;
+class CGDTextureStreamer;
+class CGDOcean;
+class DXOceanSurface;
+class DXPostProcess;
+class DXClusteredLighting;
+class DXShadowMaps;
+class CGDConstantBuffers;
 class Model;
 class Camera;
 class LookAtCamera;
@@ -24,6 +49,39 @@ class Effect;
 
 class Scene : public GUObject {
 
+	// Per-context rendering state.  Each recording context (and the immediate context) has its own render queue and state cache so passes recorded concurrently never share them
+	struct SceneContext {
+
+		ID3D11DeviceContext					*context = nullptr;
+		CGDRenderQueue						*renderQueue = nullptr;
+		CGDStateCache						*stateCache = nullptr;
+		float								bushViewDepth[40]; // view space depth of each bush for the pass being recorded (render queue sort order)
+		CGDShellRange						grassShells; // grass shells visible in the pass being recorded
+	};
+
+	// Animated scene state, advanced in fixed steps by stepSimulation
+	struct SceneState {
+
+		gu_seconds							time = 0.0;
+		float								dropshipAngle = 0.0f;
+		float								bushHeight = 0.0f;
+	};
+
+	// Simulation output handed to rendering - the last two simulated states so rendering can interpolate between them
+	struct SceneSimSnapshot {
+
+		SceneState							previous;
+		SceneState							current;
+	};
+
+	// Model drawn into the shadow maps with the id of its object constants
+	struct ShadowCasterObject {
+
+		Model								*model;
+		uint32_t							object;
+		bool								isStatic;
+	};
+
 	HINSTANCE								hInst = NULL;
 	HWND									wndHandle = NULL;
 
@@ -47,13 +105,18 @@ class Scene : public GUObject {
 	Effect									*basicEffect;
 	Effect									*refMapEffect;
 	Effect									*grassEffect;
-	ID3D11Buffer							*cBufferSkyBox = nullptr;
-	ID3D11Buffer							*cBufferBridge = nullptr;
-	ID3D11Buffer							*cBufferSphere = nullptr;
-	ID3D11Buffer							*cBufferGrass = nullptr;
-	ID3D11Buffer							*cBufferDropship = nullptr;
-	ID3D11Buffer							*cBufferBush[40];
-	CBufferExt								*cBufferExtSrc = nullptr;
+	Effect									*oceanEffect = nullptr;
+
+	// Shader constants split by update frequency (see CGDConstantBuffers) - the frame constants and the object constants id of each scene element.  The floor and the grass shells share grassObject
+	CGDConstantBuffers						*constantBuffers = nullptr;
+	CBufferFrame							*frameConstants = nullptr;
+	uint32_t								skyBoxObject = 0;
+	uint32_t								bridgeObject = 0;
+	uint32_t								sphereObject = 0;
+	uint32_t								grassObject = 0;
+	uint32_t								dropshipObject = 0;
+	uint32_t								bushObjects[40];
+	uint32_t								oceanObject = 0;
 
 	//Textures
 	Texture									*brickTexture = nullptr;
@@ -67,9 +130,8 @@ class Scene : public GUObject {
 	Texture									*grassTex = nullptr;
 	Texture									*dropshipTex = nullptr;
 
-	// Tutorial 04
-	ID3D11ShaderResourceView				*renderTargetSRV;
-	ID3D11RenderTargetView					*renderTargetRTV;
+	// Texture streaming.  Textures with a DDS version are streamed under a memory budget - the mips each one needs are requested every frame from its distance to the camera (see updateTextureStreaming)
+	CGDTextureStreamer						*textureStreamer = nullptr;
 
 	ID3D11ShaderResourceView				*mDynamicCubeMapSRV;
 	ID3D11RenderTargetView					*mDynamicCubeMapRTV[6];
@@ -89,21 +151,73 @@ class Scene : public GUObject {
 	Quad									*triangle = nullptr;
 	Box										*cube = nullptr;
 	Grid									*floor = nullptr;
+	Grid									*grassShells = nullptr; // the floor mesh drawn with grassEffect, one instance per grass shell
 	Model									*dropship = nullptr;
 	Model									*bush = nullptr;
 
-	float									bushPosX[40];
-	float									bushPosZ[40];
-	bool									dancingBushes = false;
+	CGDFoliageInstance						bushes[40]; // scattered bush placements (scale and rotation about y included)
+	uint32_t								numBushes = 0;
+	std::atomic<bool>						dancingBushes; // set by input handling, read by the simulation
 
 	// Main FPS clock
 	CGDClock								*mainClock = nullptr;
 
+	// Fixed-step simulation.  simClock is advanced by the main clock's game time each frame and the simulation steps simState at a fixed rate against it, publishing snapshots to simSnapshots.  frameState is the snapshot interpolated to the current frame - every pass reads it so all passes of a frame see the same animation state
+	CGDVirtualClock							*simClock = nullptr;
+	CGDSimulation							*simulation = nullptr;
+	SceneState								simState;
+	CGDTripleBuffer<SceneSimSnapshot>		simSnapshots;
+	SceneState								frameState;
+
+	// GPU pass timer (nullptr if timestamp queries are unavailable)
+	CGDGPUProfiler							*gpuProfiler = nullptr;
+
+	// Per-frame scratch memory - reset at the start of each frame
+	GUMemoryArena							*frameArena = nullptr;
+
+	// Shared shader bytecode, shaders, input layouts and pipeline states
+	DXPipelineCache							*pipelineCache = nullptr;
+
+	// Pass recording.  The cube map faces and main pass are recorded into deferred context command lists on worker threads and executed in order on the immediate context
+	CGDJobSystem							*jobSystem = nullptr;
+	DXCommandBackend						*commandBackend = nullptr;
+	CGDPassScheduler						*passScheduler = nullptr;
+	std::vector<SceneContext>				sceneContexts; // one per deferred context followed by the immediate context
+
 	//Camera
 	FirstPersonCamera						*mainCamera = nullptr;
 	//LookAtCamera							*mainCamera = nullptr;
 	Camera									mCubeMapCamera[6];
 
+	// Camera path recording (toggled with R) - one keyframe of mainCamera per simulation step, saved to camera_path.txt when recording stops
+	CGDCameraPath							*cameraPath = nullptr;
+	uint64_t								cameraPathSteps = 0; // simulation steps recorded into cameraPath
+
+	// Shell grass visibility - numGrassPasses shells grassLength apart over the floor (see CGDShellGrass)
+	CGDShellGrass							*shellGrass = nullptr;
+
+	// FFT ocean around the floor - tiled by oceanSurface, simulated on the CPU (job system) or with compute shaders (toggled with O)
+	CGDOcean								*ocean = nullptr;
+	DXOceanSurface							*oceanSurface = nullptr;
+
+	// Bloom and depth of field (toggled with P) - the main pass renders into the post-processing scene target and the chain draws it into the back buffer
+	DXPostProcess							*postProcess = nullptr;
+	bool									postProcessing = true;
+
+	// Clustered lighting of the main view - two scene lights followed by small point lights (lanterns) bobbing over the floor, of which the first numLanterns are lit (cycled with L).  lanternHeights holds the rest height of each lantern
+	CGDClusteredLighting					*clusteredLighting = nullptr;
+	DXClusteredLighting						*lightClusters = nullptr;
+	std::vector<CGDLight>					lights;
+	std::vector<float>						lanternHeights;
+	uint32_t								numLanterns = 1024;
+
+	// Cascaded shadow maps of the sun (toggled with H).  shadowCasterObjects are the bridge and sphere (static, cached) followed by the dropship and bushes, shadowCasters their world bounding spheres for the frame
+	CGDCascadedShadows						*cascadedShadows = nullptr;
+	DXShadowMaps							*shadowMaps = nullptr;
+	std::vector<ShadowCasterObject>			shadowCasterObjects;
+	std::vector<CGDShadowCaster>			shadowCasters;
+	bool									shadowsEnabled = true;
+
 	//Variables
 	float									grassLength = 0.005f;
 	int										numGrassPasses = 40;
@@ -118,6 +232,46 @@ class Scene : public GUObject {
 	// Return TRUE if the window is in a minimised state, FALSE otherwise
 	BOOL isMinimised();
 
+	// Create the job system, deferred contexts and per-context render state and register the scene passes
+	HRESULT initialisePasses();
+	void releasePasses();
+
+	// Return the SceneContext for a pass context index (see CGDPassFunction)
+	SceneContext& getSceneContext(uint32_t contextIndex);
+
+	// Simulation step function (see CGDStepFunction)
+	void stepSimulation(gu_seconds time, gu_seconds dt);
+
+	// Start recording mainCamera into a new camera path or stop and save the current recording
+	void toggleCameraPathRecording();
+
+	// Load the scene's textures in one batch (streaming those with a DDS version)
+	void loadTextures();
+
+	// Request the texture detail needed from the main camera, apply the residency changes and rebind the views of textures that changed
+	void updateTextureStreaming();
+
+	// Animate the lanterns, assign the lights to the clusters of the main camera and upload them
+	void updateLighting();
+
+	// Fit the shadow cascades to the main camera and cull the shadow casters against them
+	void updateShadows();
+
+	// Set the frame constants and the constants of every object for the frame and upload those that changed before the passes are recorded
+	void updateConstants();
+
+	// World matrix of shadowCasterObjects[j] - 0 = bridge, 1 = sphere, 2 = dropship, 3 + i = bush i (also used for the object constants)
+	DirectX::XMMATRIX casterWorldMatrix(uint32_t j) const;
+
+	// Pass functions - record a shadow cascade / a cube map face / the main view (with the reflective sphere) into sceneContext and run the post-processing chain on the main view
+	void recordShadowCascade(SceneContext& sceneContext, uint32_t cascade);
+	void recordCubeMapFace(SceneContext& sceneContext, int face);
+	void recordMainPass(SceneContext& sceneContext);
+	void renderPostProcess(SceneContext& sceneContext);
+
+	// Draw shadowCasterObjects[j] for each j in casters into the cascade bound by DXShadowMaps::beginCascade
+	void drawShadowCasters(SceneContext& sceneContext, uint32_t cascade, const std::vector<uint32_t>& casters);
+
 public:
 
 	//
@@ -137,7 +291,6 @@ public:
 
 	// Helper function to call updateScene followed by renderScene
 	HRESULT updateAndRenderScene();
-	HRESULT mapCbuffer(void *cBufferExtSrcL, ID3D11Buffer *cBufferExtL);
 	// Clock handling methods
 	void startClock();
 	void stopClock();
@@ -168,14 +321,16 @@ public:
 	HRESULT rebuildReflectiveViewport(Camera *camera);
 	HRESULT initDefaultPipeline();
 	HRESULT bindDefaultPipeline();
-	HRESULT LoadShader(ID3D11Device *device, const char *filename, char **PSBytecode, ID3D11PixelShader **pixelShader);
-	uint32_t LoadShader(ID3D11Device *device, const char *filename, char **VSBytecode, ID3D11VertexShader **vertexShader);
 	HRESULT initialiseSceneResources();
 	void BuildCubeFaceCamera(float x, float y, float z);
-	HRESULT updateScene(ID3D11DeviceContext *context, Camera *camera);
-	HRESULT Scene::updateScene(ID3D11DeviceContext *context, FirstPersonCamera *camera);
+	// Advance the main clock and simulation and build the frame's interpolated scene state.  Called once per frame before the passes are recorded
+	HRESULT updateScene();
+	// Write the view constants for a pass viewed from camera.  Only reads shared scene state so passes can update concurrently
+	HRESULT updateScene(SceneContext& sceneContext, Camera *camera);
+	HRESULT updateScene(SceneContext& sceneContext, FirstPersonCamera *camera);
+	HRESULT updatePassConstants(SceneContext& sceneContext, DirectX::FXMVECTOR eyePos, DirectX::CXMMATRIX viewProjMatrix);
 	HRESULT renderScene();
-	HRESULT renderSceneElements(ID3D11DeviceContext *context);
+	HRESULT renderSceneElements(SceneContext& sceneContext);
 
 
 
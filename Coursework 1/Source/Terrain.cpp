@@ -1,6 +1,8 @@
 #include "stdafx.h"
 #include "Terrain.h"
 #include "Effect.h"
+#include "CGDScatterMap.h"
+#include <vector>
 using namespace std;
 using namespace DirectX;
 using namespace DirectX::PackedVector;
@@ -133,6 +135,16 @@ float Terrain::CalculateYValue(float x, float z)
 	return ((float)finalHeight);
 }
 
+CGDScatterMap* Terrain::createHeightMap() const
+{
+	std::vector<float> heights(width * height);
+
+	for (UINT i = 0; i < width * height; i++)
+		heights[i] = vertices[i].pos.y;
+
+	return CGDScatterMap::CreateScatterMap(width, height, heights.data());
+}
+
 Terrain::~Terrain()
 {
 }
@@ -3,6 +3,7 @@
 
 class Effect;
 class Material;
+class CGDScatterMap;
 
 
 class Terrain : public Grid
@@ -12,6 +13,8 @@ public:
 		ID3D11ShaderResourceView *tex_view, Material *_material, ID3D11Texture2D *tex_height, ID3D11Texture2D *tex_normal);
 
 	float CalculateYValue(float x, float z);
+	// Copy the vertex heights to a map over the terrain (u along x, v along z) - eg. the height map of foliage scattered on the terrain (see CGDFoliageScatter)
+	CGDScatterMap* createHeightMap() const;
 	void Terrain::render(ID3D11DeviceContext *context);
 	~Terrain();
 };
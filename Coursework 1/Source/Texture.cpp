@@ -4,25 +4,64 @@
 #include <exception>
 #include <DirectXTK\DDSTextureLoader.h>
 #include <DirectXTK\WICTextureLoader.h>
+#include <CGDTextureStreamer.h>
+#include <CGDImageLoader.h>
 
 using namespace std;
 using namespace DirectX;
 using namespace DirectX::PackedVector;
+
+
+Texture::Texture()
+{
+}
+
+
 Texture::Texture(ID3D11Device *device, const std::wstring& filename)
+{
+	load(device, preferCompressed(filename));
+}
+
+
+wstring Texture::preferCompressed(const std::wstring& filename)
+{
+	wstring ddsFilename = filename.substr(0, filename.find_last_of(L'.')) + L".dds";
+
+	return (GetFileAttributesW(ddsFilename.c_str()) != INVALID_FILE_ATTRIBUTES) ? ddsFilename : filename;
+}
+
+
+// Load every mip of the texture
+void Texture::load(ID3D11Device *device, const std::wstring& filename)
+{
+	PROFILE_SCOPE("Texture::load");
+	GU_MEMORY_TAG_SCOPE(gu_mem_texture);
+
+	// Resource paths are ASCII
+	CGDLoadedImage image;
+
+	if (CGDImageLoader::ReadImage(string(filename.begin(), filename.end()), image) && create(device, image))
+		return;
+
+	loadFallback(device, filename);
+}
+
+
+void Texture::loadFallback(ID3D11Device *device, const std::wstring& filename)
 {
 	SRV = nullptr;
 	ID3D11Resource *resource = static_cast<ID3D11Resource*>(texture);
 	HRESULT hr;
 
-	// Get filename extension
-	wstring ext = filename.substr(filename.length() - 4);
+	// The format is identified by the file contents so misnamed files and upper case or ".jpeg" extensions load
+	gu_image_format format = gu_image_detect_file(string(filename.begin(), filename.end()).c_str());
 
 	try
 	{
-		if (0 == ext.compare(L".bmp") || 0 == ext.compare(L".jpg") || 0 == ext.compare(L".png") || 0 == ext.compare(L".tif"))
-			hr = CreateWICTextureFromFile(device, filename.c_str(), &resource, &SRV);
-		else if (0 == ext.compare(L".dds"))
+		if (format == gu_image_dds)
 			hr = CreateDDSTextureFromFile(device, filename.c_str(), &resource, &SRV);
+		else if (format != gu_image_unknown)
+			hr = CreateWICTextureFromFile(device, filename.c_str(), &resource, &SRV);
 		else throw exception("Texture file format not supported");
 	}
 	catch (exception& e)
@@ -35,6 +74,224 @@ Texture::Texture(ID3D11Device *device, const std::wstring& filename)
 }
 
 
+bool Texture::create(ID3D11Device *device, const CGDLoadedImage& image)
+{
+	const gu_dds_info& dds = image.image.dds;
+	bool ddsImage = image.image.format == gu_image_dds;
+
+	if (ddsImage && dds.volume)
+		return false;
+
+	D3D11_TEXTURE2D_DESC desc;
+	vector<D3D11_SUBRESOURCE_DATA> initData;
+
+	ZeroMemory(&desc, sizeof(D3D11_TEXTURE2D_DESC));
+
+	desc.Width = image.image.width;
+	desc.Height = image.image.height;
+	desc.SampleDesc.Count = 1;
+	desc.Usage = D3D11_USAGE_IMMUTABLE;
+	desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+	if (ddsImage) {
+
+		desc.MipLevels = dds.mipCount;
+		desc.ArraySize = dds.arraySize;
+		desc.Format = (DXGI_FORMAT)dds.format;
+		desc.MiscFlags = (dds.cubeMap) ? D3D11_RESOURCE_MISC_TEXTURECUBE : 0;
+
+		// Surfaces are stored one after another, each with its own mip chain
+		size_t surfaceBytes = gu_dds_mip_offset(dds, dds.mipCount);
+
+		for (uint32_t i = 0; i < dds.arraySize; i++) {
+
+			for (uint32_t m = 0; m < dds.mipCount; m++) {
+
+				D3D11_SUBRESOURCE_DATA mip;
+				uint32_t rowPitch;
+
+				gu_dds_mip_size(dds, m, &rowPitch);
+
+				mip.pSysMem = image.image.pixels.data() + i * surfaceBytes + gu_dds_mip_offset(dds, m);
+				mip.SysMemPitch = rowPitch;
+				mip.SysMemSlicePitch = 0;
+
+				initData.push_back(mip);
+			}
+		}
+
+	} else {
+
+		desc.MipLevels = (UINT)image.mips.size();
+		desc.ArraySize = 1;
+		desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+
+		for (size_t i = 0; i < image.mips.size(); i++) {
+
+			D3D11_SUBRESOURCE_DATA mip;
+
+			mip.pSysMem = image.mips[i].data();
+			mip.SysMemPitch = max(desc.Width >> i, 1u) * 4;
+			mip.SysMemSlicePitch = 0;
+
+			initData.push_back(mip);
+		}
+	}
+
+	HRESULT hr = device->CreateTexture2D(&desc, initData.data(), &texture);
+
+	if (SUCCEEDED(hr)) {
+
+		D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc;
+
+		ZeroMemory(&srvDesc, sizeof(D3D11_SHADER_RESOURCE_VIEW_DESC));
+
+		srvDesc.Format = desc.Format;
+
+		if (desc.MiscFlags & D3D11_RESOURCE_MISC_TEXTURECUBE) {
+
+			srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURECUBE;
+			srvDesc.TextureCube.MipLevels = desc.MipLevels;
+
+		} else if (desc.ArraySize > 1) {
+
+			srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2DARRAY;
+			srvDesc.Texture2DArray.MipLevels = desc.MipLevels;
+			srvDesc.Texture2DArray.ArraySize = desc.ArraySize;
+
+		} else {
+
+			srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+			srvDesc.Texture2D.MipLevels = desc.MipLevels;
+		}
+
+		hr = device->CreateShaderResourceView(texture, &srvDesc, &SRV);
+	}
+
+	if (FAILED(hr)) {
+
+		if (texture)
+			texture->Release();
+
+		texture = nullptr;
+		return false;
+	}
+
+	return true;
+}
+
+
+bool Texture::stream(const std::wstring& filename, CGDTextureStreamer *_streamer)
+{
+	// Resource paths are ASCII
+	streamFile.assign(filename.begin(), filename.end());
+
+	if (!_streamer || gu_image_detect_file(streamFile.c_str()) != gu_image_dds || !gu_dds_read_info(streamFile.c_str(), ddsInfo))
+		return false;
+
+	if (ddsInfo.cubeMap || ddsInfo.volume || ddsInfo.arraySize != 1 || ddsInfo.mipCount < 2 || ddsInfo.mipCount > CGD_MAX_TEXTURE_MIPS)
+		return false;
+
+	CGDStreamedTextureDesc desc;
+
+	desc.width = ddsInfo.width;
+	desc.height = ddsInfo.height;
+	desc.mipCount = ddsInfo.mipCount;
+
+	for (uint32_t i = 0; i < desc.mipCount; i++)
+		desc.mipBytes[i] = gu_dds_mip_size(ddsInfo, i);
+
+	// The streamer loads the mip tail and the backend creates texture and SRV
+	streamId = _streamer->registerTexture(desc, this);
+
+	if (streamId == CGD_INVALID_STREAMED_TEXTURE)
+		return false;
+
+	streamer = _streamer;
+	streamer->retain();
+
+	return true;
+}
+
+
+Texture::Texture(ID3D11Device *device, const std::wstring& filename, CGDTextureStreamer *_streamer)
+{
+	PROFILE_SCOPE("Texture::Texture");
+	GU_MEMORY_TAG_SCOPE(gu_mem_texture);
+
+	wstring name = preferCompressed(filename);
+
+	if (!stream(name, _streamer))
+		load(device, name);
+}
+
+
+void Texture::LoadBatch(ID3D11Device *device, const std::vector<std::wstring>& files, CGDTextureStreamer *streamer, CGDImageLoader *loader, vector<Texture*>& textures)
+{
+	PROFILE_SCOPE("Texture::LoadBatch");
+	GU_MEMORY_TAG_SCOPE(gu_mem_texture);
+
+	vector<wstring> names;
+	vector<string> decodeFiles;
+	vector<size_t> decodeTextures;
+
+	textures.resize(files.size());
+
+	for (size_t i = 0; i < files.size(); i++) {
+
+		textures[i] = new Texture();
+		names.push_back(preferCompressed(files[i]));
+
+		if (!textures[i]->stream(names[i], streamer)) {
+
+			// Resource paths are ASCII
+			decodeFiles.push_back(string(names[i].begin(), names[i].end()));
+			decodeTextures.push_back(i);
+		}
+	}
+
+	CGDImageLoader *batchLoader = (loader) ? loader : CGDImageLoader::CreateImageLoader();
+	vector<CGDLoadedImage*> images;
+
+	batchLoader->load(decodeFiles, images);
+
+	for (size_t i = 0; i < images.size(); i++) {
+
+		Texture *texture = textures[decodeTextures[i]];
+
+		if (!images[i]->loaded || !texture->create(device, *images[i]))
+			texture->loadFallback(device, names[decodeTextures[i]]);
+	}
+
+	batchLoader->recycle(images);
+
+	if (!loader)
+		batchLoader->release();
+}
+
+
 Texture::~Texture()
 {
+	if (streamer) {
+
+		streamer->unregisterTexture(streamId);
+		streamer->release();
+	}
+
+	if (SRV)
+		SRV->Release();
+
+	if (texture)
+		texture->Release();
+}
+
+
+void Texture::requestDetail(float worldSize, float distance, float fovY, float viewportHeight)
+{
+	if (!streamer)
+		return;
+
+	const CGDStreamedTextureDesc& desc = streamer->getDesc(streamId);
+
+	streamer->requestMip(streamId, CGDTextureStreamer::MipForDistance(desc.width, desc.height, worldSize, distance, fovY, viewportHeight));
 }
@@ -3,16 +3,54 @@
 #include <vector>
 #include <cstdint>
 #include <d3d11_2.h>
+#include <GUDDSFile.h>
+
+class CGDTextureStreamer;
+class CGDImageLoader;
+struct CGDLoadedImage;
 
 class Texture
 {
+	// Used by LoadBatch
+	Texture();
+
+	// Decode filename on the calling thread and create the texture (see create), falling back to DirectXTK if the image cannot be decoded
+	void load(ID3D11Device *device, const std::wstring& filename);
+
+	// Create the texture with the DirectXTK DDS or WIC loader (chosen from the file contents)
+	void loadFallback(ID3D11Device *device, const std::wstring& filename);
+
+	// Create an immutable texture from a loaded image - RGBA8 with the image's CPU built mip chain (see GUMipChain) or the stored format, surfaces and mips of a DDS file.  Return false if the device rejects the texture or the image is a volume texture
+	bool create(ID3D11Device *device, const CGDLoadedImage& image);
+
+	// Register the texture with streamer if filename is a 2D DDS file with a mip chain.  Return false if it is not streamable
+	bool stream(const std::wstring& filename, CGDTextureStreamer *streamer);
+
+	// filename with a .dds extension if that file exists (written by CGDTextureCompressor), otherwise filename
+	static std::wstring preferCompressed(const std::wstring& filename);
+
 public:
 // Direct3D scene textures and resource views
 	ID3D11Texture2D							*texture = nullptr;
 	ID3D11ShaderResourceView				*SRV = nullptr;
 	ID3D11DepthStencilView					*DSV = nullptr;
 	ID3D11RenderTargetView					*RTV = nullptr;
+
+// Streaming state (streamer is nullptr if the texture is fully loaded).  texture and SRV are replaced when the resident mips change so views bound elsewhere must be rebound after CGDTextureStreamer::update reports changes
+	CGDTextureStreamer						*streamer = nullptr;
+	uint32_t								streamId = 0;
+	std::string								streamFile;
+	gu_dds_info								ddsInfo;
+
+	// Both constructors load a compressed .dds file next to filename in place of filename
 	Texture(ID3D11Device *device, const std::wstring& filename);
+	// Stream the texture with streamer if filename is a 2D DDS file with a mip chain, otherwise load it fully
+	Texture(ID3D11Device *device, const std::wstring& filename, CGDTextureStreamer *streamer);
 	~Texture();
-};
 
+	// Load files (see the streaming constructor) into textures.  Streamable files are registered with streamer and the remaining files are decoded in parallel by loader (on the calling thread if loader is nullptr) before their textures are created together on the calling thread
+	static void LoadBatch(ID3D11Device *device, const std::vector<std::wstring>& files, CGDTextureStreamer *streamer, CGDImageLoader *loader, std::vector<Texture*>& textures);
+
+	// Request the mip needed to draw the texture mapped once across worldSize units of a surface distance units away (see CGDTextureStreamer::MipForDistance).  Ignored if the texture is not streamed
+	void requestDetail(float worldSize, float distance, float fovY, float viewportHeight);
+};
@@ -0,0 +1,48 @@
+
+//
+// ToolMain.cpp
+//
+
+// Entry point of the portable CGDTool executable (see CMakeLists.txt).  CGDTool <mode> [arguments] runs one of the tool modes of the Windows application (see CGDTools.h) with the same arguments.  The exit code is the tool's, or 1 if the mode is unknown or fails to run.
+
+#include <stdafx.h>
+#include <CGDTools.h>
+#include <GUMemoryArena.h>
+#include <exception>
+
+using namespace std;
+
+
+int main(int argc, char *argv[]) {
+
+	if (argc < 2 || !CGDTools::IsToolMode(argv[1])) {
+
+		cout << "usage: CGDTool <mode> [arguments]\n";
+		CGDTools::ReportUsage();
+
+		return 1;
+	}
+
+	int exitCode;
+
+	try
+	{
+		vector<string> args(argv + 2, argv + argc); // freed before the leak report
+
+		exitCode = CGDTools::Run(argv[1], args);
+	}
+	catch (exception& e)
+	{
+		cout << e.what() << endl;
+		exitCode = 1;
+	}
+
+	PROFILE_REPORT();
+
+	GUMemoryArena::ReleaseThreadScratch();
+
+	gu_memory_report();
+	gu_memory_report_leaks();
+
+	return exitCode;
+}
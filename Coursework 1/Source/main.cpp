@@ -8,12 +8,16 @@
 #include <exception>
 #include <CGDConsole.h>
 #include <Scene.h>
+#include <CGDTools.h>
+#include <GUMemoryArena.h>
+#include <sstream>
 
 using namespace std;
 
 
 // Forward declarations of functions included in this code module:
 LRESULT CALLBACK WndProc(HWND, UINT, WPARAM, LPARAM);
+static string narrow(const wstring& s);
 
 
 int APIENTRY _tWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPTSTR lpCmdLine, int nCmdShow) {
@@ -30,6 +34,11 @@ int APIENTRY _tWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPTSTR lpCm
 	if (!SUCCEEDED(CoInitialize(NULL)))
 		return 0;
 
+#ifdef _DEBUG
+	// Record call stacks of allocations so outstanding allocations can be traced at shutdown
+	gu_memory_capture_stacks(true);
+#endif
+
 	try
 	{
 		// 1.3 Initialise debug console
@@ -38,12 +47,49 @@ int APIENTRY _tWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPTSTR lpCm
 		if (!debugConsole)
 			throw exception("Cannot create debug console");
 
-		// Since we have to create the console before any memory report can be generated we have +1 malloc error so compensate for this.  debugConsole must be released once the final memory report is given!
-		compensate_free_count(1);
+		// Since we have to create the console before any memory report can be generated exclude it from memory tracking.  debugConsole must be released once the final memory report is given!
+		gu_memory_ignore(debugConsole);
 
 		cout << "Hello DirectX 11...\n\n";
-		
-		// 1.4 Create main application scene object (singleton)
+
+		// 1.4 Tool modes (CGDTools - eg. -headless, -benchmark and -compress) render the scene with the software rasterizer or process files - no window or D3D device is created.  They also run on other platforms through the CGDTool executable.  The process exit code is the mode's, or 1 if the mode throws
+		wistringstream commandLine(lpCmdLine);
+		wstring option;
+
+		if (commandLine >> option && CGDTools::IsToolMode(narrow(option))) {
+
+			int exitCode;
+
+			try
+			{
+				vector<string> toolArgs;
+				wstring arg;
+
+				while (commandLine >> arg)
+					toolArgs.push_back(narrow(arg));
+
+				exitCode = CGDTools::Run(narrow(option), toolArgs);
+			}
+			catch (exception& e)
+			{
+				cout << e.what() << endl;
+				exitCode = 1;
+			}
+
+			PROFILE_REPORT();
+
+			GUMemoryArena::ReleaseThreadScratch();
+
+			gu_memory_report();
+			gu_memory_report_leaks();
+
+			debugConsole->release();
+			CoUninitialize();
+
+			return exitCode;
+		}
+
+		// 1.5 Create main application scene object (singleton)
 		mainScene = Scene::CreateScene(600, 600, L"DirectX 11", L"DirectX 11", nCmdShow, hInstance, WndProc);
 
 		if (!mainScene)
@@ -56,12 +102,17 @@ int APIENTRY _tWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPTSTR lpCm
 		if (mainScene)
 			mainScene->release();
 
+		GUMemoryArena::ReleaseThreadScratch();
+
+		gu_memory_report();
+		gu_memory_report_leaks();
+
 		if (debugConsole)
 			debugConsole->release();
 
 		CoUninitialize();
 
-		return 0;
+		return 1;
 	}
 
 #pragma endregion
@@ -92,9 +143,17 @@ int APIENTRY _tWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPTSTR lpCm
 
 	// 3.1 Report final timing data...
 	mainScene->reportTimingData();
+	PROFILE_REPORT();
+	PROFILE_EXPORT_TRACE("profile_trace.json");
 	
 	// 3.2 Dispose of application resources
 	mainScene->release();
+
+	// 3.3 Report memory usage and any allocations still outstanding
+	GUMemoryArena::ReleaseThreadScratch();
+
+	gu_memory_report();
+	gu_memory_report_leaks();
 	
 	// 3.4 Close debug console
 	if (debugConsole)
@@ -110,6 +169,18 @@ int APIENTRY _tWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPTSTR lpCm
 }
 
 
+// Convert a command line argument (file name) to a narrow string.  Arguments are expected to be ASCII
+static string narrow(const wstring& s) {
+
+	string result;
+
+	for (size_t i = 0; i < s.length(); i++)
+		result += (char)s[i];
+
+	return result;
+}
+
+
 // Application event handler
 LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
 {
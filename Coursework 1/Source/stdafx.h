@@ -2,10 +2,12 @@
 // stdafx.h
 //
 
-// Pre-compiled header
+// Pre-compiled header.  The portable build (CMakeLists.txt) only compiles the core, software rendering and tool modules so on other platforms the Windows, console and DirectX headers are replaced with the standard headers the Windows SDK would otherwise pull in
 
 #pragma once
 
+#ifdef _WIN32
+
 #include <targetver.h>
 
 
@@ -16,18 +18,57 @@
 
 #include <windows.h>
 
+#else
+
+// Standard headers are included before GUMemory.h defines its malloc / free macros since the C++ library headers declare std::malloc and std::free
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+#include <cmath>
+#include <cfloat>
+#include <malloc.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <list>
+#include <map>
+#include <set>
+#include <unordered_map>
+#include <array>
+#include <memory>
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <stdexcept>
+#if defined(__i386__) || defined(__x86_64__)
+#include <x86intrin.h>
+#endif
+
+#endif
+
 
 // Memory handling headers
 #include <GUMemory.h>
 
 
 // C RunTime and STL Header Files
+#ifdef _WIN32
 #include <stdlib.h>
 #include <malloc.h>
 #include <memory.h>
 #include <tchar.h>
-#include <cstdint>
 #include <conio.h>
+#endif
+#include <cstdint>
 #include <iostream>
 #include <fstream>
 #include <functional>
@@ -38,6 +79,10 @@
 // Core types
 #include <GUObject.h>
 #include <CGDClock.h>
+#include <CGDProfiler.h>
+
+#ifdef _WIN32
+
 #include <CGDConsole.h>
 
 
@@ -52,3 +97,5 @@
 #include <DXSystem.h>
 #include <DXVertexBasic.h>
 #include <DXVertexExt.h>
+
+#endif
@@ -0,0 +1,322 @@
+
+//
+// CGDCascadedShadowsTests.cpp
+//
+
+// CGDCascadedShadows split schemes and cascade fits.  The fly-through camera path is replayed with the cascades Scene uses for the sun and stand-ins for its casters - the bridge and sphere (static) and the dropship and 40 bushes (dynamic, bounded by spheres from their positions) - with and without cached static cascades.  Every frame each cascade must contain the corners of its slice, a fixed world point must stay at the same sub-texel position while a cascade's size is unchanged (texel snapping) and the casters of each cascade must match a sphere / plane test against the cascade's clip volume.
+
+#include <stdafx.h>
+#include <CGDCascadedShadows.h>
+#include <CGDCameraPath.h>
+#include <CGDShellGrass.h>
+#include <CGDSoftwareShaders.h>
+#include "CGDTest.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <functional>
+#include <vector>
+
+using namespace std;
+
+
+namespace {
+
+	const float		lightDirection[3] = { 250.0f, -130.0f, -145.0f }; // the sun shines from its position towards the scene centre
+
+	// Casters - bridge, sphere, dropship (circling the centre, moved by setFrame) and bushes
+	vector<CGDShadowCaster> sceneCasters() {
+
+		vector<CGDShadowCaster> casters(43);
+		uint32_t state = 1;
+
+		for (uint32_t i = 0; i < 40; i++) {
+
+			float angle, distance;
+
+			state ^= state << 13; state ^= state >> 17; state ^= state << 5;
+			angle = (float)(state >> 8) / 16777216.0f * 6.2832f;
+			state ^= state << 13; state ^= state >> 17; state ^= state << 5;
+			distance = 25.0f + (float)(state >> 8) / 16777216.0f * 20.0f;
+
+			CGDShadowCaster bush = { { cosf(angle) * distance, -1.0f, sinf(angle) * distance, 1.5f }, false };
+			casters[3 + i] = bush;
+		}
+
+		CGDShadowCaster bridge = { { 0.0f, 0.0f, 12.0f, 12.0f }, true }, sphere = { { 0.0f, 0.0f, 0.0f, 5.0f }, true };
+
+		casters[0] = bridge;
+		casters[1] = sphere;
+
+		return casters;
+	}
+
+	// Replay the fly-through with shadows created from desc.  visit is called after the update of each frame with the frame, its view matrix and the projection
+	void replay(const CGDShadowDesc& desc, const function<void(CGDCascadedShadows*, size_t, const float*, const float*, const vector<CGDShadowCaster>&)>& visit) {
+
+		CGDCameraPath *path = CGDCameraPath::LoadCameraPath("Resources/Benchmarks/flythrough.txt");
+		CGDCascadedShadows *shadows = CGDCascadedShadows::CreateCascadedShadows(desc);
+
+		CGD_CHECK(path && path->keyframeCount() > 100);
+		CGD_CHECK(shadows);
+
+		if (path && shadows) {
+
+			CGDSoftwareMatrix projMatrix = CGDSoftwareMatrix::PerspectiveFovLH(0.25f * 3.14f, 1.0f, 1.0f, 1000.0f);
+			vector<CGDShadowCaster> casters = sceneCasters();
+
+			for (size_t f = 0; f < path->keyframeCount(); f++) {
+
+				const CGDCameraKeyframe& k = path->keyframe(f);
+				float at[3] = { k.position[0] + k.direction[0], k.position[1] + k.direction[1], k.position[2] + k.direction[2] };
+				float up[3] = { 0.0f, 1.0f, 0.0f };
+				CGDSoftwareMatrix viewMatrix = CGDSoftwareMatrix::LookAtLH(k.position, at, up);
+				float dropshipAngle = (float)f * 0.01f;
+				CGDShadowCaster dropship = { { 40.0f * cosf(dropshipAngle), 20.0f, -40.0f * sinf(dropshipAngle), 8.0f }, false };
+
+				casters[2] = dropship;
+
+				shadows->update(&viewMatrix.m[0][0], &projMatrix.m[0][0], lightDirection, casters.data(), (uint32_t)casters.size());
+				visit(shadows, f, &viewMatrix.m[0][0], &projMatrix.m[0][0], casters);
+			}
+		}
+
+		if (shadows)
+			shadows->release();
+
+		if (path)
+			path->release();
+	}
+}
+
+
+CGD_TEST(CascadedShadows, ComputesSplits) {
+
+	// lambda = 0 / 1 give the uniform / logarithmic splits and the practical splits lie between them
+	float splits[3][CGD_MAX_SHADOW_CASCADES + 1];
+
+	for (int l = 0; l < 3; l++)
+		CGDCascadedShadows::ComputeSplits(1.0f, 150.0f, CGD_MAX_SHADOW_CASCADES, (float)l * 0.5f, splits[l]);
+
+	for (uint32_t i = 0; i <= CGD_MAX_SHADOW_CASCADES; i++) {
+
+		float t = (float)i / (float)CGD_MAX_SHADOW_CASCADES;
+
+		CGD_CHECK_NEAR(splits[0][i], 1.0f + 149.0f * t, 1e-3);
+		CGD_CHECK_NEAR(splits[2][i], powf(150.0f, t), 1e-3);
+		CGD_CHECK(splits[1][i] >= splits[2][i] - 1e-3f && splits[1][i] <= splits[0][i] + 1e-3f);
+		CGD_CHECK(i == 0 || splits[1][i] > splits[1][i - 1]);
+	}
+
+	CGD_CHECK(splits[1][0] == 1.0f && splits[1][CGD_MAX_SHADOW_CASCADES] == 150.0f);
+
+	// the slice sphere holds the corners of the slice
+	float centre, radius;
+
+	CGDCascadedShadows::SliceSphere(splits[1][1], splits[1][2], 2.4f, 2.4f, &centre, &radius);
+
+	for (int corner = 0; corner < 8; corner++) {
+
+		float z = (corner & 4) ? splits[1][2] : splits[1][1];
+		float x = z / 2.4f, y = z / 2.4f;
+
+		CGD_CHECK(sqrtf(x * x + y * y + (z - centre) * (z - centre)) <= radius * 1.0001f);
+	}
+}
+
+
+CGD_TEST(CascadedShadows, RejectsInvalidDescriptions) {
+
+	CGDShadowDesc desc;
+
+	desc.cascadeCount = 0;
+	CGD_CHECK(!CGDCascadedShadows::CreateCascadedShadows(desc));
+
+	desc.cascadeCount = CGD_MAX_SHADOW_CASCADES + 1;
+	CGD_CHECK(!CGDCascadedShadows::CreateCascadedShadows(desc));
+
+	desc = CGDShadowDesc();
+	desc.resolution = 1023;
+	CGD_CHECK(!CGDCascadedShadows::CreateCascadedShadows(desc));
+
+	desc = CGDShadowDesc();
+	desc.splitLambda = 1.5f;
+	CGD_CHECK(!CGDCascadedShadows::CreateCascadedShadows(desc));
+
+	CGDCascadedShadows *shadows = CGDCascadedShadows::CreateCascadedShadows();
+	CGD_REQUIRE(shadows);
+
+	CGD_CHECK(shadows->getCascadeCount() == 4);
+
+	shadows->release();
+}
+
+
+CGD_TEST(CascadedShadows, CascadesCoverTheirSlices) {
+
+	for (int cached = 0; cached < 2; cached++) {
+
+		CGDShadowDesc desc;
+		uint64_t failures = 0;
+
+		desc.cacheStatic = (cached != 0);
+
+		replay(desc, [&failures](CGDCascadedShadows *shadows, size_t, const float *view, const float *proj, const vector<CGDShadowCaster>&) {
+
+			for (uint32_t i = 0; i < shadows->getCascadeCount(); i++) {
+
+				const CGDShadowCascade& c = shadows->getCascade(i);
+				const float *m = c.viewProj;
+
+				// Slice corners (view space x = +-z / _11, y = +-z / _22 at the split depths) in cascade clip space
+				for (int corner = 0; corner < 8; corner++) {
+
+					float z = (corner & 4) ? c.splitFar : c.splitNear;
+					float v[3] = { ((corner & 1) ? z : -z) / proj[0], ((corner & 2) ? z : -z) / proj[5], z }, w[3];
+
+					for (int r = 0; r < 3; r++)
+						w[r] = -(view[12] * view[r * 4] + view[13] * view[r * 4 + 1] + view[14] * view[r * 4 + 2]) + v[0] * view[r * 4] + v[1] * view[r * 4 + 1] + v[2] * view[r * 4 + 2];
+
+					float x = w[0] * m[0] + w[1] * m[4] + w[2] * m[8] + m[12];
+					float y = w[0] * m[1] + w[1] * m[5] + w[2] * m[9] + m[13];
+					float d = w[0] * m[2] + w[1] * m[6] + w[2] * m[10] + m[14];
+
+					if (fabsf(x) > 1.0001f || fabsf(y) > 1.0001f || d < -1e-4f || d > 1.0001f)
+						failures++;
+				}
+			}
+		});
+
+		CGD_CHECK(failures == 0);
+	}
+}
+
+
+CGD_TEST(CascadedShadows, SnapsCascadesToWholeTexels) {
+
+	const float testPoint[3] = { 7.0f, -2.0f, 13.0f };
+
+	for (int cached = 0; cached < 2; cached++) {
+
+		CGDShadowDesc desc;
+		float snapRadius[CGD_MAX_SHADOW_CASCADES], snapOffset[CGD_MAX_SHADOW_CASCADES];
+		uint64_t failures = 0;
+
+		desc.cacheStatic = (cached != 0);
+
+		replay(desc, [&](CGDCascadedShadows *shadows, size_t f, const float*, const float*, const vector<CGDShadowCaster>&) {
+
+			for (uint32_t i = 0; i < shadows->getCascadeCount(); i++) {
+
+				const CGDShadowCascade& c = shadows->getCascade(i);
+				const float *m = c.viewProj;
+
+				// Texel position of the test point - its fraction only changes when the cascade's size does
+				float texel = (testPoint[0] * m[0] + testPoint[1] * m[4] + testPoint[2] * m[8] + m[12] + 1.0f) * 0.5f * (float)desc.resolution;
+				float offset = texel - floorf(texel);
+
+				if (f == 0 || c.radius != snapRadius[i]) {
+
+					snapRadius[i] = c.radius;
+					snapOffset[i] = offset;
+
+				} else if (fabsf(offset - snapOffset[i]) > 0.02f && fabsf(offset - snapOffset[i]) < 0.98f) {
+
+					failures++;
+				}
+			}
+		});
+
+		CGD_CHECK(failures == 0);
+	}
+}
+
+
+CGD_TEST(CascadedShadows, CullsCastersAgainstEachCascade) {
+
+	for (int cached = 0; cached < 2; cached++) {
+
+		CGDShadowDesc desc;
+		uint64_t failures = 0, drawn = 0;
+
+		desc.cacheStatic = (cached != 0);
+
+		replay(desc, [&failures, &drawn](CGDCascadedShadows *shadows, size_t, const float*, const float*, const vector<CGDShadowCaster>& casters) {
+
+			for (uint32_t i = 0; i < shadows->getCascadeCount(); i++) {
+
+				// Reference culling - each caster against the planes of the cascade's clip volume
+				float planes[6][4];
+				vector<bool> culled(casters.size(), true);
+
+				CGDShellGrass::FrustumPlanes(shadows->getCascade(i).viewProj, planes);
+
+				for (uint32_t s = 0; s < 2; s++) {
+
+					const vector<uint32_t>& list = (s == 0) ? shadows->getStaticCasters(i) : shadows->getDynamicCasters(i);
+
+					for (size_t j = 0; j < list.size(); j++) {
+
+						if (casters[list[j]].isStatic != (s == 0))
+							failures++;
+
+						culled[list[j]] = false;
+						drawn++;
+					}
+				}
+
+				for (size_t j = 0; j < casters.size(); j++) {
+
+					const float *sp = casters[j].sphere;
+					float margin = FLT_MAX;
+
+					for (int p = 0; p < 6; p++) {
+
+						float length = sqrtf(planes[p][0] * planes[p][0] + planes[p][1] * planes[p][1] + planes[p][2] * planes[p][2]);
+
+						margin = min(margin, (planes[p][0] * sp[0] + planes[p][1] * sp[1] + planes[p][2] * sp[2] + planes[p][3]) / length + sp[3]);
+					}
+
+					if (fabsf(margin) > 1e-3f && (margin < 0.0f) != culled[j])
+						failures++;
+				}
+			}
+		});
+
+		CGD_CHECK(drawn > 0);
+		CGD_CHECK(failures == 0);
+	}
+}
+
+
+CGD_TEST(CascadedShadows, CachedCascadesRefitLessOften) {
+
+	uint64_t redraws[2] = { 0, 0 }, frames = 0;
+
+	for (int cached = 0; cached < 2; cached++) {
+
+		CGDShadowDesc desc;
+
+		desc.cacheStatic = (cached != 0);
+
+		replay(desc, [&redraws, &frames, cached](CGDCascadedShadows *shadows, size_t f, const float*, const float*, const vector<CGDShadowCaster>&) {
+
+			for (uint32_t i = 0; i < shadows->getCascadeCount(); i++)
+				if (shadows->getCascade(i).staticDirty)
+					redraws[cached]++;
+
+			// the statistics count the same redraws
+			uint64_t counted = 0;
+
+			for (uint32_t i = 0; i < shadows->getCascadeCount(); i++)
+				counted += shadows->getStats(i).staticRedraws;
+
+			CGD_CHECK(counted == redraws[cached]);
+			frames = f + 1;
+		});
+	}
+
+	// without caching every cascade is redrawn every frame, with caching the distant cascades are redrawn less often
+	CGD_CHECK(redraws[0] == frames * 4);
+	CGD_CHECK(redraws[1] < redraws[0] / 2);
+}
@@ -0,0 +1,81 @@
+
+//
+// CGDClockTests.cpp
+//
+
+#include <stdafx.h>
+#include <CGDClock.h>
+#include <CGDFrameTimeLog.h>
+#include "CGDTest.h"
+#include <thread>
+#include <chrono>
+
+using namespace std;
+
+
+CGD_TEST(Clock, ActualTimeIsMonotonic) {
+
+	CGD_REQUIRE(CGDClock::ActualTimeFrequency() > 0);
+
+	gu_time_index previous = CGDClock::ActualTime();
+	uint64_t backwards = 0;
+
+	for (int i = 0; i < 100000; i++) {
+
+		gu_time_index t = CGDClock::ActualTime();
+
+		if (t < previous)
+			backwards++;
+
+		previous = t;
+	}
+
+	CGD_CHECK(backwards == 0);
+
+	gu_time_index start = CGDClock::ActualTime();
+
+	this_thread::sleep_for(chrono::milliseconds(20));
+
+	double elapsed = (double)(CGDClock::ActualTime() - start) / (double)CGDClock::ActualTimeFrequency();
+
+	CGD_CHECK(elapsed >= 0.019 && elapsed < 1.0);
+}
+
+
+CGD_TEST(Clock, TickRecordsFrameTimes) {
+
+	CGDClock *clock = CGDClock::CreateClock("test");
+
+	CGD_REQUIRE(clock != nullptr);
+
+	clock->start();
+
+	for (int i = 0; i < 5; i++) {
+
+		this_thread::sleep_for(chrono::milliseconds(2));
+		clock->tick();
+	}
+
+	CGDFrameTimeLog *log = clock->frameTimes();
+
+	CGD_REQUIRE(log != nullptr);
+	CGD_CHECK(log->framesRecorded() == 5);
+	CGD_CHECK(log->statistics().minimum >= 1.9);
+	CGD_CHECK(clock->gameTimeDelta() > 0.0);
+
+	// No complete one second window yet - the averages are zero rather than a division by zero
+	CGD_CHECK(clock->averageFPS() == 0.0);
+	CGD_CHECK(clock->averageSPF() == 0.0);
+
+	clock->stop();
+	clock->tick();
+
+	CGD_CHECK(clock->gameTimeDelta() == 0.0);
+	CGD_CHECK(log->framesRecorded() == 5);
+
+	clock->reset();
+
+	CGD_CHECK(log->framesRecorded() == 0);
+
+	clock->release();
+}
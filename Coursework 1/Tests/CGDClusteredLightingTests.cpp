@@ -0,0 +1,312 @@
+
+//
+// CGDClusteredLightingTests.cpp
+//
+
+// CGDClusteredLighting light volumes and bounds, the cluster lookup per_pixel_lighting_ps.hlsl makes, the SSE fast path against the scalar reference and the cluster lists themselves - each list in increasing light order and containing every light that reaches a point of its cluster.
+
+#include <stdafx.h>
+#include <CGDClusteredLighting.h>
+#include <CGDSoftwareShaders.h>
+#include "CGDTest.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+using namespace std;
+
+
+namespace {
+
+	// Uniform random number in [0, 1) (xorshift)
+	float random(uint32_t& state) {
+
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+
+		return (float)(state >> 8) / 16777216.0f;
+	}
+
+	// Lights scattered over a 200 x 200 unit ground, a quarter of them spot lights pointing down (the light benchmark's scene)
+	vector<CGDLight> scatterLights(uint32_t count, uint32_t seed = 1) {
+
+		vector<CGDLight> lights;
+		uint32_t state = seed;
+
+		for (uint32_t i = 0; i < count; i++) {
+
+			float position[3] = { (random(state) - 0.5f) * 200.0f, random(state) * 10.0f - 2.0f, (random(state) - 0.5f) * 200.0f };
+			float colour[3] = { random(state), random(state), random(state) };
+
+			if (i % 4 == 3) {
+
+				float direction[3] = { random(state) - 0.5f, -1.0f, random(state) - 0.5f };
+
+				lights.push_back(CGDSpotLight(position, direction, 4.0f + random(state) * 12.0f, 0.2f, 0.2f + random(state) * 1.2f, colour));
+
+			} else {
+
+				lights.push_back(CGDPointLight(position, 2.0f + random(state) * 8.0f, colour));
+			}
+		}
+
+		return lights;
+	}
+
+	// Grid with the default description for a 1280 x 720 view looking down on the ground
+	CGDClusteredLighting* createLighting() {
+
+		float eye[3] = { 0.0f, 15.0f, -40.0f }, at[3] = { 0.0f, 0.0f, 20.0f }, up[3] = { 0.0f, 1.0f, 0.0f };
+		CGDSoftwareMatrix view = CGDSoftwareMatrix::LookAtLH(eye, at, up);
+		CGDSoftwareMatrix proj = CGDSoftwareMatrix::PerspectiveFovLH(0.25f * 3.14f, 1280.0f / 720.0f, 1.0f, 1000.0f);
+		CGDClusteredLighting *lighting = CGDClusteredLighting::CreateClusteredLighting();
+
+		if (lighting)
+			lighting->setView(&view.m[0][0], &proj.m[0][0]);
+
+		return lighting;
+	}
+
+	// Move a world space point to view space with the grid's view matrix (row vectors)
+	void toView(const CGDClusteredLighting *lighting, const float world[3], float view[3]) {
+
+		const float *m = lighting->getViewMatrix();
+
+		for (int i = 0; i < 3; i++)
+			view[i] = world[0] * m[i] + world[1] * m[4 + i] + world[2] * m[8 + i] + m[12 + i];
+	}
+}
+
+
+CGD_TEST(ClusteredLighting, BuildsLightVolumes) {
+
+	const float position[3] = { 1.0f, 2.0f, 3.0f }, colour[3] = { 1.0f, 0.5f, 0.25f };
+	float sphere[4];
+
+	// a point light is bounded by its range
+	CGDLight point = CGDPointLight(position, 4.0f, colour);
+
+	CGD_CHECK(point.type == CGDLightType::POINT && point.range == 4.0f && point.colour[1] == 0.5f);
+	CGDLightBounds(point, sphere);
+	CGD_CHECK(sphere[0] == 1.0f && sphere[1] == 2.0f && sphere[2] == 3.0f && sphere[3] == 4.0f);
+
+	const float inside[3] = { 1.0f, 2.0f, 6.9f }, outside[3] = { 1.0f, 2.0f, 7.1f };
+
+	CGD_CHECK(CGDLightReaches(point, inside));
+	CGD_CHECK(!CGDLightReaches(point, outside));
+
+	// spot light directions are normalised and the angles stored as cosines (the inner angle is clamped to the outer)
+	const float down[3] = { 0.0f, -2.0f, 0.0f };
+	CGDLight spot = CGDSpotLight(position, down, 10.0f, 0.8f, 0.5f, colour);
+
+	CGD_CHECK(spot.type == CGDLightType::SPOT);
+	CGD_CHECK_NEAR(spot.direction[1], -1.0f, 1e-6);
+	CGD_CHECK_NEAR(spot.spotCosOuter, cosf(0.5f), 1e-6);
+	CGD_CHECK(spot.spotCosInner == spot.spotCosOuter);
+
+	const float below[3] = { 1.0f, -5.0f, 3.0f }, above[3] = { 1.0f, 5.0f, 3.0f }, beside[3] = { 6.0f, 1.0f, 3.0f };
+
+	CGD_CHECK(CGDLightReaches(spot, below));
+	CGD_CHECK(!CGDLightReaches(spot, above));
+	CGD_CHECK(!CGDLightReaches(spot, beside));
+
+	// the sphere around a narrow cone holds the apex and the rim and is smaller than the range
+	const float angles[3] = { 0.1f, 0.5f, 1.2f };
+
+	for (float angle : angles) {
+
+		CGDLight cone = CGDSpotLight(position, down, 10.0f, 0.0f, angle, colour);
+
+		CGDLightBounds(cone, sphere);
+		CGD_CHECK(sphere[3] < 10.0f);
+
+		float rim[3] = { position[0] + 10.0f * sinf(angle), position[1] - 10.0f * cosf(angle), position[2] };
+		float points[2][3] = { { position[0], position[1], position[2] }, { rim[0], rim[1], rim[2] } };
+
+		for (int i = 0; i < 2; i++) {
+
+			float d[3] = { points[i][0] - sphere[0], points[i][1] - sphere[1], points[i][2] - sphere[2] };
+
+			CGD_CHECK(sqrtf(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]) <= sphere[3] * 1.0001f);
+		}
+	}
+
+	// a cone wider than a hemisphere is bounded by its range
+	CGDLight wide = CGDSpotLight(position, down, 10.0f, 0.0f, 2.0f, colour);
+
+	CGDLightBounds(wide, sphere);
+	CGD_CHECK(sphere[0] == 1.0f && sphere[1] == 2.0f && sphere[2] == 3.0f && sphere[3] == 10.0f);
+}
+
+
+CGD_TEST(ClusteredLighting, RejectsEmptyGrids) {
+
+	CGDClusterGridDesc desc;
+
+	desc.tilesX = 0;
+	CGD_CHECK(!CGDClusteredLighting::CreateClusteredLighting(desc));
+
+	desc = CGDClusterGridDesc();
+	desc.slices = 0;
+	CGD_CHECK(!CGDClusteredLighting::CreateClusteredLighting(desc));
+
+	desc = CGDClusterGridDesc();
+	desc.nearPlane = 0.0f;
+	CGD_CHECK(!CGDClusteredLighting::CreateClusteredLighting(desc));
+
+	desc = CGDClusterGridDesc();
+	desc.farPlane = desc.nearPlane;
+	CGD_CHECK(!CGDClusteredLighting::CreateClusteredLighting(desc));
+
+	CGDClusteredLighting *lighting = CGDClusteredLighting::CreateClusteredLighting();
+	CGD_REQUIRE(lighting);
+
+	CGD_CHECK(lighting->getClusterCount() == 16 * 9 * 24);
+
+	lighting->release();
+}
+
+
+CGD_TEST(ClusteredLighting, FindsTheClusterOfAViewPosition) {
+
+	CGDClusteredLighting *lighting = createLighting();
+	CGD_REQUIRE(lighting);
+
+	const CGDClusterGridDesc& desc = lighting->getDesc();
+	auto cluster = [&desc](uint32_t x, uint32_t y, uint32_t slice) { return (slice * desc.tilesY + y) * desc.tilesX + x; };
+
+	// the centre of the screen is between tiles 7 and 8 and in tile row 4, and slice k starts at near * (far / near) ^ (k / slices)
+	for (uint32_t k = 0; k < desc.slices; k++) {
+
+		float z = desc.nearPlane * powf(desc.farPlane / desc.nearPlane, ((float)k + 0.5f) / (float)desc.slices);
+		float centre[3] = { 0.001f * z, 0.0f, z };
+
+		CGD_CHECK(lighting->clusterIndex(centre) == cluster(8, 4, k));
+	}
+
+	// the corners of the screen
+	float z = 10.0f;
+	float x = z / lighting->getProjScaleX() * 0.99f, y = z / lighting->getProjScaleY() * 0.99f;
+	float topLeft[3] = { -x, y, z }, bottomRight[3] = { x, -y, z };
+	uint32_t slice = lighting->clusterIndex(topLeft) / (desc.tilesX * desc.tilesY);
+
+	CGD_CHECK(lighting->clusterIndex(topLeft) == cluster(0, 0, slice));
+	CGD_CHECK(lighting->clusterIndex(bottomRight) == cluster(15, 8, slice));
+
+	// positions outside the grid are clamped
+	float behind[3] = { 0.001f, 0.0f, -50.0f }, beyond[3] = { 0.001f, 0.0f, 5000.0f }, left[3] = { -1000.0f, 0.0f, z };
+
+	CGD_CHECK(lighting->clusterIndex(behind) == cluster(8, 4, 0));
+	CGD_CHECK(lighting->clusterIndex(beyond) == cluster(8, 4, desc.slices - 1));
+	CGD_CHECK(lighting->clusterIndex(left) == cluster(0, 4, slice));
+
+	lighting->release();
+}
+
+
+CGD_TEST(ClusteredLighting, FastPathMatchesReference) {
+
+	CGDClusteredLighting *lighting = createLighting();
+	CGD_REQUIRE(lighting);
+
+	// counts that are and are not multiples of the SSE width
+	const uint32_t counts[5] = { 0, 1, 7, 256, 2049 };
+
+	for (uint32_t count : counts) {
+
+		vector<CGDLight> lights = scatterLights(count);
+
+		lighting->assignReference(lights.data(), count);
+
+		vector<uint32_t> clusterLights = lighting->getClusterLights();
+		vector<uint32_t> lightIndices = lighting->getLightIndices();
+		uint32_t maxClusterLights = lighting->getMaxClusterLights();
+
+		CGD_CHECK(lighting->getLightCount() == count);
+		CGD_CHECK(clusterLights.size() == lighting->getClusterCount() * 2);
+		CGD_CHECK(count < 256 || !lightIndices.empty());
+
+		lighting->assign(lights.data(), count);
+
+		CGD_CHECK(lighting->getLightCount() == count);
+		CGD_CHECK(lighting->getClusterLights() == clusterLights);
+		CGD_CHECK(lighting->getLightIndices() == lightIndices);
+		CGD_CHECK(lighting->getMaxClusterLights() == maxClusterLights);
+	}
+
+	lighting->release();
+}
+
+
+CGD_TEST(ClusteredLighting, ListsHoldEveryLightReachingTheirClusters) {
+
+	CGDClusteredLighting *lighting = createLighting();
+	CGD_REQUIRE(lighting);
+
+	const uint32_t count = 1024;
+	vector<CGDLight> lights = scatterLights(count, 7);
+
+	lighting->assign(lights.data(), count);
+
+	const vector<uint32_t>& clusterLights = lighting->getClusterLights();
+	const vector<uint32_t>& lightIndices = lighting->getLightIndices();
+	uint32_t total = 0, longest = 0;
+
+	// each list is in the index buffer, in increasing light order and only holds assigned lights
+	for (uint32_t c = 0; c < lighting->getClusterCount(); c++) {
+
+		uint32_t offset = clusterLights[c * 2], length = clusterLights[c * 2 + 1];
+		CGD_REQUIRE(offset + length <= lightIndices.size());
+
+		for (uint32_t i = 0; i < length; i++) {
+
+			CGD_CHECK(lightIndices[offset + i] < count);
+			CGD_CHECK(i == 0 || lightIndices[offset + i - 1] < lightIndices[offset + i]);
+		}
+
+		total += length;
+		longest = max(longest, length);
+	}
+
+	CGD_CHECK(total == lightIndices.size());
+	CGD_CHECK(longest == lighting->getMaxClusterLights());
+
+	// every light reaching a point on or above the ground in the view is in the list of the point's cluster
+	const CGDClusterGridDesc& desc = lighting->getDesc();
+	uint32_t state = 3, samples = 0, missed = 0;
+
+	for (int s = 0; s < 20000; s++) {
+
+		float world[3] = { (random(state) - 0.5f) * 220.0f, random(state) * 12.0f - 3.0f, (random(state) - 0.5f) * 220.0f }, view[3];
+
+		toView(lighting, world, view);
+
+		if (view[2] < desc.nearPlane || view[2] > desc.farPlane || fabsf(view[0] * lighting->getProjScaleX()) > view[2] || fabsf(view[1] * lighting->getProjScaleY()) > view[2])
+			continue;
+
+		uint32_t c = lighting->clusterIndex(view);
+		const uint32_t *list = lightIndices.data() + clusterLights[c * 2];
+		const uint32_t *listEnd = list + clusterLights[c * 2 + 1];
+
+		for (uint32_t l = 0; l < count; l++)
+			if (CGDLightReaches(lights[l], world) && !binary_search(list, listEnd, l))
+				missed++;
+
+		samples++;
+	}
+
+	CGD_CHECK(samples > 1000);
+	CGD_CHECK(missed == 0);
+
+	// a light behind the camera is in no list
+	float position[3] = { 0.0f, 15.0f, -80.0f }, colour[3] = { 1.0f, 1.0f, 1.0f };
+	CGDLight behind = CGDPointLight(position, 5.0f, colour);
+
+	lighting->assign(&behind, 1);
+
+	CGD_CHECK(lighting->getLightIndices().empty());
+	CGD_CHECK(lighting->getMaxClusterLights() == 0);
+
+	lighting->release();
+}
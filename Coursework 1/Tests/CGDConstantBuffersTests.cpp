@@ -0,0 +1,251 @@
+
+//
+// CGDConstantBuffersTests.cpp
+//
+
+// CGDConstantBuffers against a CGDMemoryConstantBackend.  The scene's constants are replayed - the frame block (timer), the sky box, bridge, sphere, floor, ocean, dropship (moved every frame) and 40 bushes (moved every 30 frames) and the views of the 6 cube map faces, the main pass and 4 shadow cascades - with a ring that is appended to, a ring small enough to be discarded and a device that cannot append.  Every object drawn in a pass must be bound to a ring slot holding its latest constants, the pass must see the latest frame and its own view and only changed constants may be uploaded.
+
+#include <stdafx.h>
+#include <CGDConstantBuffers.h>
+#include <CGDMemoryConstantBackend.h>
+#include <CGDRenderQueue.h>
+#include "CGDTest.h"
+#include <cstring>
+#include <vector>
+
+using namespace std;
+
+
+namespace {
+
+	// Sizes of the scene's blocks - CBufferObject, CBufferView and CBufferFrame (CBufferStructures.h needs DirectXMath)
+	const uint32_t		objectSize = 128, viewSize = 96, frameSize = 112;
+
+	CGDConstantBufferDesc sceneDesc() {
+
+		CGDConstantBufferDesc desc;
+
+		desc.frameSize = frameSize;
+		desc.viewSize = viewSize;
+		desc.objectSize = objectSize;
+		desc.maxObjects = 64;
+
+		return desc;
+	}
+
+	// Return true if object id is bound to a slot of the ring holding data
+	bool boundTo(const CGDConstantBuffers *constants, const CGDMemoryConstantBackend *backend, uint32_t id, const void *data) {
+
+		CGDConstantBinding binding = constants->getObjectBinding(id);
+
+		return binding.buffer == backend->objectBuffer() && binding.numConstants == CGD_CONSTANT_SLOT_CONSTANTS && memcmp(backend->getObjects(binding.firstConstant * 16), data, objectSize) == 0;
+	}
+}
+
+
+CGD_TEST(ConstantBuffers, RejectsInvalidDescriptions) {
+
+	CGDMemoryConstantBackend *backend = CGDMemoryConstantBackend::CreateMemoryConstantBackend(64 * CGD_CONSTANT_SLOT_SIZE);
+	CGD_REQUIRE(backend);
+
+	CGDConstantBufferDesc desc = sceneDesc();
+
+	CGD_CHECK(!CGDConstantBuffers::CreateConstantBuffers(nullptr, desc));
+
+	desc.frameSize = 0;
+	CGD_CHECK(!CGDConstantBuffers::CreateConstantBuffers(backend, desc));
+
+	desc = sceneDesc();
+	desc.viewSize = 40;
+	CGD_CHECK(!CGDConstantBuffers::CreateConstantBuffers(backend, desc));
+
+	desc = sceneDesc();
+	desc.objectSize = CGD_CONSTANT_SLOT_SIZE + 16;
+	CGD_CHECK(!CGDConstantBuffers::CreateConstantBuffers(backend, desc));
+
+	// the ring must hold a slot for every object
+	desc = sceneDesc();
+	desc.maxObjects = 65;
+	CGD_CHECK(!CGDConstantBuffers::CreateConstantBuffers(backend, desc));
+
+	desc.maxObjects = 2;
+
+	CGDConstantBuffers *constants = CGDConstantBuffers::CreateConstantBuffers(backend, desc);
+	CGD_REQUIRE(constants);
+
+	CGD_CHECK(constants->addObject() == 0);
+	CGD_CHECK(constants->addObject() == 1);
+	CGD_CHECK(constants->addObject() == CGD_INVALID_CONSTANT_OBJECT);
+	CGD_CHECK(constants->objectCount() == 2);
+
+	constants->release();
+	backend->release();
+}
+
+
+CGD_TEST(ConstantBuffers, UploadsOnlyChangedConstants) {
+
+	CGDMemoryConstantBackend *backend = CGDMemoryConstantBackend::CreateMemoryConstantBackend(65536);
+	CGDConstantBuffers *constants = CGDConstantBuffers::CreateConstantBuffers(backend, sceneDesc());
+	CGD_REQUIRE(constants);
+
+	vector<float> frameData(frameSize / sizeof(float), 1.0f);
+	vector<vector<float>> objectData(4, vector<float>(objectSize / sizeof(float), 0.0f));
+	uint32_t objects[4];
+
+	for (uint32_t i = 0; i < 4; i++) {
+
+		objects[i] = constants->addObject();
+		objectData[i][0] = (float)i;
+		constants->setObject(objects[i], objectData[i].data());
+	}
+
+	constants->setFrame(frameData.data());
+	constants->flush();
+
+	CGDConstantStats stats = constants->getStats();
+
+	// the first flush writes every object to the ring in one upload
+	CGD_CHECK(stats.frameUploads == 1 && stats.frameBytes == frameSize);
+	CGD_CHECK(stats.objectUploads == 1 && stats.objectsWritten == 4 && stats.discards == 1);
+	CGD_CHECK(stats.objectBytes == 4 * CGD_CONSTANT_SLOT_SIZE);
+
+	for (uint32_t i = 0; i < 4; i++)
+		CGD_CHECK(boundTo(constants, backend, objects[i], objectData[i].data()));
+
+	// setting the same constants again uploads nothing
+	constants->resetStats();
+
+	for (uint32_t i = 0; i < 4; i++)
+		constants->setObject(objects[i], objectData[i].data());
+
+	constants->setFrame(frameData.data());
+	constants->flush();
+
+	stats = constants->getStats();
+	CGD_CHECK(stats.frames == 1 && stats.frameUploads == 0 && stats.objectUploads == 0);
+
+	// a changed object is appended to the ring and the others keep their slots
+	CGDConstantBinding unchanged = constants->getObjectBinding(objects[3]);
+
+	objectData[2][12] = 5.0f;
+	constants->setObject(objects[2], objectData[2].data());
+	constants->flush();
+
+	stats = constants->getStats();
+	CGD_CHECK(stats.objectUploads == 1 && stats.objectsWritten == 1 && stats.discards == 0);
+	CGD_CHECK(constants->getObjectBinding(objects[2]).firstConstant == 4 * CGD_CONSTANT_SLOT_CONSTANTS);
+	CGD_CHECK(constants->getObjectBinding(objects[3]).firstConstant == unchanged.firstConstant);
+
+	for (uint32_t i = 0; i < 4; i++)
+		CGD_CHECK(boundTo(constants, backend, objects[i], objectData[i].data()));
+
+	// the manager accounts for every byte the backend received
+	CGD_CHECK(backend->getBytesWritten() == frameSize + 5 * CGD_CONSTANT_SLOT_SIZE);
+
+	constants->release();
+	backend->release();
+}
+
+
+CGD_TEST(ConstantBuffers, PassesSeeTheLatestConstants) {
+
+	const uint32_t frames = 120, numObjects = 46, dropshipObject = 5, firstBush = 6, numPasses = 11;
+
+	struct TestConfig {
+
+		uint32_t		ringSize;
+		bool			canAppend;
+	};
+
+	const TestConfig configs[3] = { { 65536, true }, { 64 * CGD_CONSTANT_SLOT_SIZE, true }, { 65536, false } };
+	uint64_t objectBytes[3];
+
+	for (int c = 0; c < 3; c++) {
+
+		CGDMemoryConstantBackend *backend = CGDMemoryConstantBackend::CreateMemoryConstantBackend(configs[c].ringSize, configs[c].canAppend);
+		CGDConstantBuffers *constants = CGDConstantBuffers::CreateConstantBuffers(backend, sceneDesc());
+		CGD_REQUIRE(constants);
+
+		vector<uint32_t> objects(numObjects);
+
+		for (uint32_t i = 0; i < numObjects; i++)
+			objects[i] = constants->addObject();
+
+		vector<float> frameData(frameSize / sizeof(float), 0.0f), viewData(viewSize / sizeof(float), 0.0f);
+		vector<vector<float>> objectData(numObjects, vector<float>(objectSize / sizeof(float), 0.0f));
+		uint64_t staleBindings = 0, staleFrames = 0, staleViews = 0, draws = 0;
+		uint8_t passContexts[numPasses];
+
+		for (uint32_t f = 0; f < frames; f++) {
+
+			// Frame constants change with the timer
+			frameData[0] = (float)f / 60.0f;
+			constants->setFrame(frameData.data());
+
+			// World matrices - objects are only uploaded when they change
+			for (uint32_t i = 0; i < numObjects; i++) {
+
+				if (f == 0)
+					objectData[i][0] = (float)i;
+
+				if (i == dropshipObject)
+					objectData[i][12] = (float)f * 0.01f;
+				else if (i >= firstBush && f % 30 == 0)
+					objectData[i][13] = (float)(f / 30);
+
+				constants->setObject(objects[i], objectData[i].data());
+			}
+
+			constants->flush();
+
+			// Passes - cube map faces draw everything but the sphere, the main pass everything and the shadow cascades the bridge, sphere, dropship and bushes
+			for (uint32_t p = 0; p < numPasses; p++) {
+
+				viewData[0] = (float)p;
+				viewData[1] = (float)f;
+				constants->setView(&passContexts[p], viewData.data());
+
+				if (memcmp(backend->getFrame(), frameData.data(), frameSize) != 0)
+					staleFrames++;
+
+				if (memcmp(backend->getView(&passContexts[p]), viewData.data(), viewSize) != 0)
+					staleViews++;
+
+				for (uint32_t i = 0; i < numObjects; i++) {
+
+					bool drawn = (p < 6) ? (i != 2) : (p == 6) ? true : (i == 1 || i == 2 || i >= dropshipObject);
+
+					if (!drawn)
+						continue;
+
+					if (!boundTo(constants, backend, objects[i], objectData[i].data()))
+						staleBindings++;
+
+					draws++;
+				}
+			}
+		}
+
+		CGDConstantStats stats = constants->getStats();
+		uint64_t bytes = stats.frameBytes + stats.viewBytes + stats.objectBytes;
+
+		CGD_CHECK(staleBindings == 0);
+		CGD_CHECK(staleFrames == 0);
+		CGD_CHECK(staleViews == 0);
+		CGD_CHECK(bytes == backend->getBytesWritten());
+
+		// far less is uploaded than one buffer per object written for every draw (the previous scheme)
+		CGD_CHECK(bytes * 4 < draws * (objectSize + viewSize + frameSize));
+
+		objectBytes[c] = stats.objectBytes;
+
+		constants->release();
+		backend->release();
+	}
+
+	// appending uploads only the changed objects, a small ring is sometimes discarded and a device that cannot append rewrites every object every frame
+	CGD_CHECK(objectBytes[0] < objectBytes[1]);
+	CGD_CHECK(objectBytes[1] < objectBytes[2]);
+	CGD_CHECK(objectBytes[2] == (uint64_t)frames * numObjects * CGD_CONSTANT_SLOT_SIZE);
+}
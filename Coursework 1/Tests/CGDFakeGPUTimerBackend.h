@@ -0,0 +1,136 @@
+//
+// CGDFakeGPUTimerBackend.h
+//
+
+// Deterministic GPU timestamp query source for testing CGDGPUProfiler without a device.  The fake GPU clock only moves when the test calls advance() (simulating GPU work between timestamps) and the queries of a frame slot become readable a configurable number of present() calls after the slot's endFrame, which models the read back latency of D3D11 queries (the GPU keeps presenting whether or not a frame was profiled).  Frames can be flagged disjoint to model a GPU clock frequency change.
+
+#pragma once
+
+#include <CGDGPUProfiler.h>
+#include <cstdint>
+#include <vector>
+
+
+class CGDFakeGPUTimerBackend : public CGDGPUTimerBackend {
+
+	struct Slot {
+
+		std::vector<uint64_t>	timestamps;
+		uint64_t				readyAt = UINT64_MAX; // present count at which the slot's queries are readable
+		bool					disjoint = false;
+		bool					active = false;
+	};
+
+	uint32_t					numTimestamps;
+	uint64_t					latency;
+	uint64_t					frequency;
+
+	std::vector<Slot>			slots;
+	uint64_t					clock = 0;
+	uint64_t					presents = 0;
+	bool						disjointNext = false;
+
+	uint64_t					notReadyCount = 0;
+	uint64_t					protocolErrors = 0;
+
+
+	// Constructor - called internally by the CreateFakeGPUTimerBackend factory method
+	CGDFakeGPUTimerBackend(uint32_t framesInFlight, uint32_t maxTimestamps, uint64_t latency, uint64_t frequency) : numTimestamps(maxTimestamps), latency(latency), frequency(frequency), slots(framesInFlight) {
+
+		for (auto& s : slots)
+			s.timestamps.resize(maxTimestamps, 0);
+	}
+
+public:
+
+	// Fake backend factory method.  Results of a frame slot become readable after latency further calls to present().  Timestamps tick at frequency ticks per second
+	static CGDFakeGPUTimerBackend* CreateFakeGPUTimerBackend(uint32_t framesInFlight, uint32_t maxTimestamps, uint64_t latency, uint64_t frequency = 1000000) {
+
+		return new CGDFakeGPUTimerBackend(framesInFlight, maxTimestamps, latency, frequency);
+	}
+
+	// Advance the fake GPU clock
+	void advance(uint64_t ticks) { clock += ticks; }
+
+	// Complete a GPU frame
+	void present() { presents++; }
+
+	// Mark the next frame begun as disjoint
+	void makeNextFrameDisjoint() { disjointNext = true; }
+
+	// Number of resolveFrame calls that returned NOT_READY
+	uint64_t notReadyResolves() const { return notReadyCount; }
+
+	// Number of calls made out of order (timestamps outside a frame, beyond the slot capacity, or a slot reused before it was read back)
+	uint64_t protocolErrorCount() const { return protocolErrors; }
+
+
+	// CGDGPUTimerBackend interface
+
+	uint32_t framesInFlight() const { return (uint32_t)slots.size(); }
+
+	uint32_t maxTimestampsPerFrame() const { return numTimestamps; }
+
+	void beginFrame(uint32_t slot) {
+
+		Slot& s = slots[slot];
+
+		if (s.active || s.readyAt != UINT64_MAX)
+			protocolErrors++;
+
+		s.active = true;
+		s.disjoint = disjointNext;
+		disjointNext = false;
+	}
+
+	void endFrame(uint32_t slot) {
+
+		Slot& s = slots[slot];
+
+		if (!s.active)
+			protocolErrors++;
+
+		s.active = false;
+		s.readyAt = presents + latency;
+	}
+
+	void timestamp(uint32_t slot, uint32_t index) {
+
+		if (!slots[slot].active || index >= numTimestamps) {
+
+			protocolErrors++;
+			return;
+		}
+
+		slots[slot].timestamps[index] = clock;
+	}
+
+	CGDGPUQueryStatus resolveFrame(uint32_t slot, uint32_t count, uint64_t *timestamps, uint64_t *ticksPerSecond) {
+
+		Slot& s = slots[slot];
+
+		if (s.readyAt == UINT64_MAX || count > numTimestamps) {
+
+			protocolErrors++;
+			return CGDGPUQueryStatus::NOT_READY;
+		}
+
+		if (presents < s.readyAt) {
+
+			notReadyCount++;
+			return CGDGPUQueryStatus::NOT_READY;
+		}
+
+		s.readyAt = UINT64_MAX;
+
+		if (s.disjoint)
+			return CGDGPUQueryStatus::DISJOINT;
+
+		for (uint32_t i = 0; i < count; i++)
+			timestamps[i] = s.timestamps[i];
+
+		*ticksPerSecond = frequency;
+
+		return CGDGPUQueryStatus::VALID;
+	}
+};
@@ -0,0 +1,195 @@
+//
+// CGDFakeStreamingBackend.h
+//
+
+// Texture streaming backend for testing CGDTextureStreamer without D3D or texture files.  Textures are created by the backend (createTexture returns the handle to register with the streamer and fills in its description) and each mip's data is a byte pattern derived from the texture and mip so commits can check they were given the mips they asked for.  Loads can be given a simulated I/O time and made to fail per texture.  The backend tracks the residency it was told about and counts the protocol errors the streamer must avoid: commits whose previous mip does not match the residency, loaded data of the wrong size or contents, and loads running concurrently beyond a limit.
+
+#pragma once
+
+#include <CGDTextureStreamer.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+
+class CGDFakeStreamingBackend : public CGDTextureStreamingBackend {
+
+public:
+
+	struct Texture {
+
+		uint32_t					index;
+		CGDStreamedTextureDesc		desc;
+		uint32_t					residentMip; // as committed (desc.mipCount if nothing is resident)
+		std::atomic<bool>			failLoads;
+		std::atomic<uint32_t>		loads;
+
+		Texture() : index(0), residentMip(0), failLoads(false), loads(0) {}
+	};
+
+private:
+
+	std::vector<Texture*>			textures;
+	uint32_t						loadMicroseconds;
+
+	std::atomic<uint32_t>			loadsRunning;
+	std::atomic<uint32_t>			maxLoadsRunning;
+	std::atomic<uint64_t>			loadCount;
+	uint64_t						commitCount = 0;
+	uint64_t						protocolErrors = 0;
+
+
+	// Constructor - called internally by the CreateFakeStreamingBackend factory method
+	CGDFakeStreamingBackend(uint32_t loadMicroseconds) : loadMicroseconds(loadMicroseconds), loadsRunning(0), maxLoadsRunning(0), loadCount(0) {}
+
+	// Pattern byte of mip of texture t
+	static uint8_t MipPattern(const Texture *t, uint32_t mip) {
+
+		return (uint8_t)(t->index * 16 + mip + 1);
+	}
+
+public:
+
+	// Fake backend factory method.  Each load sleeps for loadMicroseconds to model file I/O
+	static CGDFakeStreamingBackend* CreateFakeStreamingBackend(uint32_t loadMicroseconds = 0) {
+
+		return new CGDFakeStreamingBackend(loadMicroseconds);
+	}
+
+	~CGDFakeStreamingBackend() {
+
+		for (size_t i = 0; i < textures.size(); i++)
+			delete textures[i];
+	}
+
+	// Create a width x height texture with a full mip chain of bytesPerTexel texels (mips are at least 1 byte).  desc receives its description
+	void* createTexture(uint32_t width, uint32_t height, uint32_t bytesPerTexel, CGDStreamedTextureDesc& desc) {
+
+		Texture *t = new Texture();
+
+		t->index = (uint32_t)textures.size();
+		t->desc.width = width;
+		t->desc.height = height;
+		t->desc.mipCount = 0;
+
+		for (uint32_t w = width, h = height; t->desc.mipCount < CGD_MAX_TEXTURE_MIPS; w = std::max(w >> 1, 1u), h = std::max(h >> 1, 1u)) {
+
+			t->desc.mipBytes[t->desc.mipCount++] = std::max((size_t)w * (size_t)h * bytesPerTexel, (size_t)1);
+
+			if (w == 1 && h == 1)
+				break;
+		}
+
+		t->residentMip = t->desc.mipCount;
+		textures.push_back(t);
+
+		desc = t->desc;
+
+		return t;
+	}
+
+	Texture* texture(void *handle) { return static_cast<Texture*>(handle); }
+
+	// Bytes resident across every texture as committed
+	size_t residentBytes() const {
+
+		size_t bytes = 0;
+
+		for (size_t i = 0; i < textures.size(); i++)
+			for (uint32_t m = textures[i]->residentMip; m < textures[i]->desc.mipCount; m++)
+				bytes += textures[i]->desc.mipBytes[m];
+
+		return bytes;
+	}
+
+	// Most loads seen running at the same time
+	uint32_t maxConcurrentLoads() const { return maxLoadsRunning; }
+
+	uint64_t loadsIssued() const { return loadCount; }
+
+	uint64_t commitsMade() const { return commitCount; }
+
+	uint64_t protocolErrorCount() const { return protocolErrors; }
+
+
+	// CGDTextureStreamingBackend interface
+
+	bool loadMips(void *handle, uint32_t firstMip, uint32_t lastMip, std::vector<uint8_t>& data) {
+
+		Texture *t = texture(handle);
+		uint32_t running = ++loadsRunning;
+		uint32_t peak = maxLoadsRunning.load();
+
+		while (running > peak && !maxLoadsRunning.compare_exchange_weak(peak, running)) {}
+
+		loadCount++;
+		t->loads++;
+
+		if (loadMicroseconds > 0)
+			std::this_thread::sleep_for(std::chrono::microseconds(loadMicroseconds));
+
+		bool ok = !t->failLoads && firstMip <= lastMip && lastMip < t->desc.mipCount;
+
+		if (ok) {
+
+			data.clear();
+
+			for (uint32_t m = firstMip; m <= lastMip; m++)
+				data.insert(data.end(), t->desc.mipBytes[m], MipPattern(t, m));
+		}
+
+		loadsRunning--;
+
+		return ok;
+	}
+
+	bool commitMips(void *handle, uint32_t residentMip, uint32_t previousMip, const std::vector<uint8_t>& data) {
+
+		Texture *t = texture(handle);
+
+		commitCount++;
+
+		if (previousMip != t->residentMip || residentMip >= t->desc.mipCount) {
+
+			protocolErrors++;
+			return false;
+		}
+
+		if (residentMip < previousMip) {
+
+			// data must hold mips [residentMip, previousMip - 1] in order
+			size_t offset = 0;
+
+			for (uint32_t m = residentMip; m < previousMip; m++) {
+
+				for (size_t i = 0; i < t->desc.mipBytes[m]; i++) {
+
+					if (offset + i >= data.size() || data[offset + i] != MipPattern(t, m)) {
+
+						protocolErrors++;
+						return false;
+					}
+				}
+
+				offset += t->desc.mipBytes[m];
+			}
+
+			if (offset != data.size()) {
+
+				protocolErrors++;
+				return false;
+			}
+
+		} else if (!data.empty()) {
+
+			protocolErrors++;
+			return false;
+		}
+
+		t->residentMip = residentMip;
+
+		return true;
+	}
+};
@@ -0,0 +1,391 @@
+
+//
+// CGDFoliageScatterTests.cpp
+//
+
+// CGDFoliageScatter placement (Poisson-disk spacing within and across clusters, density thinning and height map placement), deterministic cluster generation on the calling thread and the job system, streaming around a camera and the selection of visible clusters with their level of detail.  CGDScatterMap is loaded from the scene's height map.
+
+#include <stdafx.h>
+#include <CGDFoliageScatter.h>
+#include <CGDScatterMap.h>
+#include <CGDJobSystem.h>
+#include <CGDSoftwareShaders.h>
+#include "CGDTest.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+using namespace std;
+
+
+namespace {
+
+	// Ground of width x depth units from the origin
+	CGDFoliageScatterDesc ground(float width, float depth) {
+
+		CGDFoliageScatterDesc desc;
+
+		desc.bounds[0][0] = 0.0f; desc.bounds[0][1] = 0.0f;
+		desc.bounds[1][0] = width; desc.bounds[1][1] = depth;
+
+		return desc;
+	}
+
+	// Map with the same value everywhere
+	CGDScatterMap* constantMap(float value) {
+
+		float values[4] = { value, value, value, value };
+
+		return CGDScatterMap::CreateScatterMap(2, 2, values);
+	}
+
+	// Every resident instance
+	vector<CGDFoliageInstance> residentInstances(const CGDFoliageScatter *scatter) {
+
+		vector<CGDFoliageInstance> instances;
+
+		for (const CGDFoliageCluster *cluster : scatter->getClusters())
+			instances.insert(instances.end(), cluster->instances.begin(), cluster->instances.end());
+
+		return instances;
+	}
+
+	bool sameInstances(const vector<CGDFoliageInstance>& a, const vector<CGDFoliageInstance>& b) {
+
+		if (a.size() != b.size())
+			return false;
+
+		for (size_t i = 0; i < a.size(); i++) {
+
+			if (a[i].position[0] != b[i].position[0] || a[i].position[1] != b[i].position[1] || a[i].position[2] != b[i].position[2] || a[i].rotation != b[i].rotation || a[i].scale != b[i].scale)
+				return false;
+		}
+
+		return true;
+	}
+
+	// World to clip space matrix of a camera at eye looking along direction
+	CGDSoftwareMatrix viewProj(const float eye[3], const float direction[3]) {
+
+		float at[3] = { eye[0] + direction[0], eye[1] + direction[1], eye[2] + direction[2] };
+		float up[3] = { 0.0f, 1.0f, 0.0f };
+
+		return CGDSoftwareMatrix::LookAtLH(eye, at, up) * CGDSoftwareMatrix::PerspectiveFovLH(0.25f * 3.14f, 1.0f, 1.0f, 1000.0f);
+	}
+}
+
+
+CGD_TEST(FoliageScatter, KeepsInstancesApart) {
+
+	// 3 x 2 clusters, the last column clipped to the ground
+	CGDFoliageScatter *scatter = CGDFoliageScatter::CreateFoliageScatter(ground(80.0f, 64.0f));
+	CGD_REQUIRE(scatter);
+
+	scatter->generateAll(false);
+
+	const CGDFoliageScatterDesc& desc = scatter->getDesc();
+	vector<CGDFoliageInstance> instances = residentInstances(scatter);
+
+	CGD_CHECK(scatter->getClusters().size() == 6);
+	CGD_CHECK(scatter->getStats().instancesResident == instances.size());
+
+	// Poisson-disk sampling with spacing 1 packs about 0.79 instances per unit area
+	CGD_CHECK(instances.size() > (size_t)(80 * 64 * 0.6));
+
+	float minDistance2 = 1e30f;
+
+	for (size_t i = 0; i < instances.size(); i++) {
+
+		for (size_t j = i + 1; j < instances.size(); j++) {
+
+			float dx = instances[i].position[0] - instances[j].position[0];
+			float dz = instances[i].position[2] - instances[j].position[2];
+
+			minDistance2 = min(minDistance2, dx * dx + dz * dz);
+		}
+	}
+
+	CGD_CHECK(sqrtf(minDistance2) >= desc.spacing * 0.999f);
+
+	// instances lie on the ground inside their cluster's bounds with a random orientation and scale
+	for (const CGDFoliageCluster *cluster : scatter->getClusters()) {
+
+		float x0 = (float)cluster->x * desc.clusterSize, z0 = (float)cluster->z * desc.clusterSize;
+
+		for (const CGDFoliageInstance& instance : cluster->instances) {
+
+			CGD_CHECK(instance.position[0] >= x0 && instance.position[0] < min(x0 + desc.clusterSize, 80.0f));
+			CGD_CHECK(instance.position[2] >= z0 && instance.position[2] < min(z0 + desc.clusterSize, 64.0f));
+			CGD_CHECK(instance.position[1] == 0.0f);
+
+			for (int k = 0; k < 3; k++)
+				CGD_CHECK(instance.position[k] >= cluster->bounds[0][k] && instance.position[k] <= cluster->bounds[1][k]);
+
+			CGD_CHECK(instance.rotation >= 0.0f && instance.rotation < 6.2832f);
+			CGD_CHECK(instance.scale >= desc.minScale && instance.scale <= desc.maxScale);
+		}
+	}
+
+	scatter->release();
+}
+
+
+CGD_TEST(FoliageScatter, ThinsByDensityAndPlacesOnHeight) {
+
+	CGDFoliageScatterDesc desc = ground(64.0f, 64.0f);
+	CGDFoliageScatter *scatter = CGDFoliageScatter::CreateFoliageScatter(desc);
+
+	scatter->generateAll(false);
+	uint64_t full = scatter->getStats().instancesResident;
+	scatter->release();
+
+	// half density keeps about half the instances and zero density keeps none
+	desc.densityMap = constantMap(0.5f);
+	scatter = CGDFoliageScatter::CreateFoliageScatter(desc);
+	desc.densityMap->release();
+
+	scatter->generateAll(false);
+	CGD_CHECK_NEAR((double)scatter->getStats().instancesResident / (double)full, 0.5, 0.05);
+	scatter->release();
+
+	desc.densityMap = constantMap(0.0f);
+	scatter = CGDFoliageScatter::CreateFoliageScatter(desc);
+	desc.densityMap->release();
+
+	scatter->generateAll(false);
+	CGD_CHECK(scatter->getStats().instancesResident == 0);
+	scatter->release();
+
+	// a height map rising from 0 to 10 along x over the ground, raised by baseHeight
+	float ramp[2] = { 0.0f, 10.0f };
+
+	desc.densityMap = nullptr;
+	desc.heightMap = CGDScatterMap::CreateScatterMap(2, 1, ramp);
+	desc.baseHeight = 1.0f;
+	scatter = CGDFoliageScatter::CreateFoliageScatter(desc);
+	desc.heightMap->release();
+
+	scatter->generateAll(false);
+
+	vector<CGDFoliageInstance> instances = residentInstances(scatter);
+	double maxError = 0.0;
+
+	CGD_CHECK(instances.size() == full);
+
+	for (const CGDFoliageInstance& instance : instances)
+		maxError = max(maxError, fabs((double)instance.position[1] - (1.0 + 10.0 * instance.position[0] / 64.0)));
+
+	CGD_CHECK(maxError < 1e-4);
+
+	scatter->release();
+}
+
+
+CGD_TEST(FoliageScatter, GeneratesClustersDeterministically) {
+
+	CGDFoliageScatterDesc desc = ground(160.0f, 96.0f);
+
+	desc.densityMap = constantMap(0.7f);
+
+	CGDJobSystem *jobSystem = CGDJobSystem::CreateJobSystem(3);
+	CGDFoliageScatter *serial = CGDFoliageScatter::CreateFoliageScatter(desc);
+	CGDFoliageScatter *parallel = CGDFoliageScatter::CreateFoliageScatter(desc, jobSystem);
+
+	desc.densityMap->release();
+
+	// a cluster is the same however often it is generated
+	CGDFoliageCluster a, b;
+
+	CGD_CHECK(serial->generateCluster(2, 1, a));
+	CGD_CHECK(serial->generateCluster(2, 1, b));
+	CGD_CHECK(!a.instances.empty());
+	CGD_CHECK(sameInstances(a.instances, b.instances));
+	CGD_CHECK(!serial->generateCluster(5, 0, b));
+	CGD_CHECK(!serial->generateCluster(0, -1, b));
+
+	// and on whichever thread it is generated
+	serial->generateAll(false);
+	parallel->generateAll(true);
+
+	CGD_REQUIRE(serial->getClusters().size() == 15);
+	CGD_REQUIRE(parallel->getClusters().size() == 15);
+
+	for (const CGDFoliageCluster *cluster : parallel->getClusters()) {
+
+		CGDFoliageCluster expected;
+
+		CGD_CHECK(serial->generateCluster(cluster->x, cluster->z, expected));
+		CGD_CHECK(sameInstances(cluster->instances, expected.instances));
+	}
+
+	// a different seed places different instances
+	desc.seed = 2;
+	desc.densityMap = nullptr;
+
+	CGDFoliageScatter *reseeded = CGDFoliageScatter::CreateFoliageScatter(desc);
+
+	CGD_CHECK(reseeded->generateCluster(2, 1, b));
+	CGD_CHECK(!sameInstances(a.instances, b.instances));
+
+	reseeded->release();
+	serial->release();
+	parallel->release();
+	jobSystem->release();
+}
+
+
+CGD_TEST(FoliageScatter, StreamsClustersAroundTheCamera) {
+
+	CGDFoliageScatterDesc desc = ground(1024.0f, 1024.0f);
+
+	desc.streamRadius = 100.0f;
+
+	CGDJobSystem *jobSystem = CGDJobSystem::CreateJobSystem(2);
+	CGDFoliageScatter *scatter = CGDFoliageScatter::CreateFoliageScatter(desc, jobSystem);
+	float eye[3] = { 512.0f, 10.0f, 512.0f };
+
+	// clusters within the stream radius - the 8 x 8 clusters around the centre less the corners beyond the radius
+	const CGDFoliageStreamStats& stats = scatter->update(eye);
+	uint32_t inRadius = 0;
+
+	for (int32_t cz = 0; cz < 32; cz++) {
+
+		for (int32_t cx = 0; cx < 32; cx++) {
+
+			float dx = max(max((float)cx * 32.0f - eye[0], eye[0] - (float)(cx + 1) * 32.0f), 0.0f);
+			float dz = max(max((float)cz * 32.0f - eye[2], eye[2] - (float)(cz + 1) * 32.0f), 0.0f);
+
+			if (sqrtf(dx * dx + dz * dz) <= desc.streamRadius)
+				inRadius++;
+		}
+	}
+
+	CGD_CHECK(inRadius > 0);
+	CGD_CHECK(stats.clustersGenerated == inRadius);
+	CGD_CHECK(stats.clustersResident == inRadius);
+	CGD_CHECK(stats.instancesResident == residentInstances(scatter).size());
+
+	// a steady camera generates and evicts nothing
+	scatter->update(eye);
+
+	CGD_CHECK(stats.clustersGenerated == 0);
+	CGD_CHECK(stats.clustersEvicted == 0);
+
+	// a small step stays within the margin, a large one evicts the clusters left behind
+	eye[0] += 16.0f;
+	scatter->update(eye);
+
+	CGD_CHECK(stats.clustersEvicted == 0);
+
+	uint32_t resident = stats.clustersResident;
+
+	eye[0] += 400.0f;
+	scatter->update(eye);
+
+	CGD_CHECK(stats.clustersEvicted == resident);
+	CGD_CHECK(stats.clustersResident == stats.clustersGenerated);
+	CGD_CHECK(stats.instancesResident == residentInstances(scatter).size());
+
+	// maxGenerate makes the nearest clusters resident first
+	scatter->evictAll();
+	scatter->update(eye, 4);
+
+	CGD_CHECK(stats.clustersGenerated == 4);
+
+	for (const CGDFoliageCluster *cluster : scatter->getClusters())
+		CGD_CHECK(fabs((float)cluster->x * 32.0f + 16.0f - eye[0]) <= 48.0f && fabs((float)cluster->z * 32.0f + 16.0f - eye[2]) <= 48.0f);
+
+	scatter->release();
+	jobSystem->release();
+}
+
+
+CGD_TEST(FoliageScatter, SelectsVisibleClustersWithLOD) {
+
+	CGDFoliageScatterDesc desc = ground(512.0f, 512.0f);
+	CGDFoliageScatter *scatter = CGDFoliageScatter::CreateFoliageScatter(desc);
+
+	scatter->generateAll(false);
+
+	const CGDFoliageCluster& cluster = *scatter->getClusters()[0];
+	uint32_t count = (uint32_t)cluster.instances.size();
+
+	// every instance up to lodNear, thinning to lodMinFraction at lodFar and nothing from drawDistance
+	CGD_CHECK(scatter->lodInstanceCount(cluster, 0.0f) == count);
+	CGD_CHECK(scatter->lodInstanceCount(cluster, desc.lodNear) == count);
+	CGD_CHECK(scatter->lodInstanceCount(cluster, desc.lodFar) == (uint32_t)ceilf((float)count * desc.lodMinFraction));
+	CGD_CHECK(scatter->lodInstanceCount(cluster, desc.drawDistance) == 0);
+
+	uint32_t previous = count;
+
+	for (float d = desc.lodNear; d < desc.drawDistance; d += 4.0f) {
+
+		uint32_t lod = scatter->lodInstanceCount(cluster, d);
+
+		CGD_CHECK(lod <= previous && lod > 0);
+		previous = lod;
+	}
+
+	// looking along +x from the middle of the ground only clusters ahead of the camera are drawn
+	float eye[3] = { 256.0f, 10.0f, 256.0f };
+	float forward[3] = { 1.0f, -0.2f, 0.0f };
+	float back[3] = { -1.0f, -0.2f, 0.0f };
+	CGDSoftwareMatrix m = viewProj(eye, forward);
+	vector<CGDFoliageDraw> draws;
+
+	uint64_t drawn = scatter->select(eye, &m.m[0][0], draws);
+	uint64_t total = 0;
+
+	CGD_CHECK(!draws.empty());
+
+	for (const CGDFoliageDraw& draw : draws) {
+
+		CGD_CHECK(draw.cluster->bounds[1][0] > eye[0]);
+		CGD_CHECK(draw.instanceCount > 0 && draw.instanceCount <= draw.cluster->instances.size());
+
+		total += draw.instanceCount;
+	}
+
+	CGD_CHECK(drawn == total);
+	CGD_CHECK(drawn < scatter->getStats().instancesResident);
+
+	m = viewProj(eye, back);
+	scatter->select(eye, &m.m[0][0], draws);
+
+	for (const CGDFoliageDraw& draw : draws)
+		CGD_CHECK(draw.cluster->bounds[0][0] < eye[0]);
+
+	scatter->release();
+}
+
+
+CGD_TEST(FoliageScatter, LoadsScatterMaps) {
+
+	// the Terrain height map scaled as Terrain
+	CGDScatterMap *heightMap = CGDScatterMap::LoadScatterMap("Resources/Textures/heightmap1.bmp", 5.0f);
+	CGD_REQUIRE(heightMap);
+
+	CGD_CHECK(heightMap->getWidth() > 0 && heightMap->getHeight() > 0);
+	CGD_CHECK(heightMap->mean() > 0.0f && heightMap->mean() < 5.0f);
+
+	for (float v = 0.0f; v <= 1.0f; v += 0.125f)
+		for (float u = 0.0f; u <= 1.0f; u += 0.125f)
+			CGD_CHECK(heightMap->sample(u, v) >= 0.0f && heightMap->sample(u, v) <= 5.0f);
+
+	heightMap->release();
+
+	// samples interpolate bilinearly between texel centres at the edges and corners of [0, 1] and clamp outside
+	float values[4] = { 0.0f, 1.0f, 2.0f, 3.0f };
+	CGDScatterMap *map = CGDScatterMap::CreateScatterMap(2, 2, values);
+
+	CGD_CHECK(map->sample(0.0f, 0.0f) == 0.0f);
+	CGD_CHECK(map->sample(1.0f, 1.0f) == 3.0f);
+	CGD_CHECK_NEAR(map->sample(0.5f, 0.5f), 1.5f, 1e-6);
+	CGD_CHECK(map->sample(-1.0f, 2.0f) == 2.0f);
+	CGD_CHECK_NEAR(map->mean(), 1.5f, 1e-6);
+
+	map->release();
+
+	CGD_CHECK(!CGDScatterMap::LoadScatterMap("Resources/Textures/no_such_map.bmp"));
+	CGD_CHECK(!CGDScatterMap::CreateScatterMap(0, 2, values));
+}
@@ -0,0 +1,179 @@
+
+//
+// CGDFrameTimeLogTests.cpp
+//
+
+#include <stdafx.h>
+#include <CGDFrameTimeLog.h>
+#include "CGDTest.h"
+#include <sstream>
+#include <thread>
+#include <atomic>
+
+using namespace std;
+
+
+CGD_TEST(FrameTimeLog, PercentilesUseNearestRank) {
+
+	vector<float> frames;
+
+	// 1..100 shuffled - the nearest rank of p is ceil(p / 100 * N)
+	for (int i = 0; i < 100; i++)
+		frames.push_back((float)((i * 37) % 100 + 1));
+
+	CGDFrameTimeStats stats = CGDFrameTimeLog::CalculateStatistics(frames);
+
+	CGD_CHECK(stats.frameCount == 100);
+	CGD_CHECK(stats.minimum == 1.0);
+	CGD_CHECK(stats.p50 == 50.0);
+	CGD_CHECK(stats.p95 == 95.0);
+	CGD_CHECK(stats.p99 == 99.0);
+	CGD_CHECK(stats.maximum == 100.0);
+	CGD_CHECK_NEAR(stats.mean, 50.5, 1e-9);
+
+	vector<float> three = { 30.0f, 10.0f, 20.0f };
+
+	CGD_CHECK(CGDFrameTimeLog::Percentile(three, 0.0) == 10.0);
+	CGD_CHECK(CGDFrameTimeLog::Percentile(three, 34.0) == 20.0);
+	CGD_CHECK(CGDFrameTimeLog::Percentile(three, 100.0) == 30.0);
+	CGD_CHECK(CGDFrameTimeLog::Percentile(three, 150.0) == 30.0);
+
+	vector<float> none;
+
+	CGD_CHECK(CGDFrameTimeLog::Percentile(none, 50.0) == 0.0);
+	CGD_CHECK(CGDFrameTimeLog::CalculateStatistics(none).frameCount == 0);
+}
+
+
+CGD_TEST(FrameTimeLog, HistogramCountsOverflow) {
+
+	vector<float> frames = { 0.0f, 0.5f, 1.0f, 1.9f, 4.0f, 16.6f, 33.3f };
+	CGDFrameTimeHistogram h = CGDFrameTimeLog::CalculateHistogram(frames, 1.0, 5);
+
+	CGD_REQUIRE(h.bins.size() == 5);
+	CGD_CHECK(h.bins[0] == 2);
+	CGD_CHECK(h.bins[1] == 2);
+	CGD_CHECK(h.bins[2] == 0);
+	CGD_CHECK(h.bins[4] == 1);
+	CGD_CHECK(h.overflow == 2);
+}
+
+
+CGD_TEST(FrameTimeLog, RingWrapsAround) {
+
+	CGDFrameTimeLog *log = CGDFrameTimeLog::CreateFrameTimeLog(6);
+
+	CGD_CHECK(log->capacity() == 8);
+
+	for (int i = 0; i < 5; i++)
+		log->record((double)i);
+
+	uint64_t first = 99;
+	vector<float> frames = log->snapshot(0, &first);
+
+	CGD_CHECK(frames.size() == 5 && first == 0 && frames[4] == 4.0f);
+
+	for (int i = 5; i < 20; i++)
+		log->record((double)i);
+
+	frames = log->snapshot(0, &first);
+
+	CGD_CHECK(log->framesRecorded() == 20);
+	CGD_REQUIRE(frames.size() == 8);
+	CGD_CHECK(first == 12);
+
+	for (size_t i = 0; i < frames.size(); i++)
+		CGD_CHECK(frames[i] == (float)(12 + i));
+
+	frames = log->snapshot(3, &first);
+
+	CGD_REQUIRE(frames.size() == 3);
+	CGD_CHECK(first == 17 && frames[0] == 17.0f && frames[2] == 19.0f);
+
+	CGD_CHECK(log->statistics().maximum == 19.0);
+	CGD_CHECK(log->statistics(4).minimum == 16.0);
+
+	log->clear();
+
+	CGD_CHECK(log->snapshot().empty());
+	CGD_CHECK(log->framesRecorded() == 0);
+
+	log->release();
+}
+
+
+CGD_TEST(FrameTimeLog, CSVNumbersFramesFromTheSnapshot) {
+
+	CGDFrameTimeLog *log = CGDFrameTimeLog::CreateFrameTimeLog(4);
+
+	for (int i = 0; i < 10; i++)
+		log->record(1.5 * i);
+
+	ostringstream csv;
+
+	log->writeCSV(csv);
+
+	CGD_CHECK(csv.str() == "frame,ms\n6,9\n7,10.5\n8,12\n9,13.5\n");
+
+	ostringstream json;
+
+	log->writeJSON(json, 5.0, 4);
+
+	CGD_CHECK(json.str().find("\"framesRecorded\": 10") != string::npos);
+	CGD_CHECK(json.str().find("\"bins\": [0, 1, 3, 0]") != string::npos);
+
+	log->release();
+}
+
+
+// One thread records frame i as the value i while another takes snapshots.  Every snapshot must be a run of consecutive frames starting at the reported first frame - a frame overwritten during the copy must be dropped rather than returned with the value of a later frame
+CGD_TEST(FrameTimeLog, SnapshotWhileWriting) {
+
+	const uint64_t frames = 4000000; // frame indices stay exact as floats
+	CGDFrameTimeLog *log = CGDFrameTimeLog::CreateFrameTimeLog(64);
+	atomic<bool> done(false);
+	uint64_t snapshots = 0, torn = 0, misnumbered = 0, lastFirst = 0, backwards = 0;
+
+	thread writer([&]() {
+
+		for (uint64_t i = 0; i < frames; i++)
+			log->record((double)i);
+
+		done.store(true);
+	});
+
+	while (!done.load() || snapshots == 0) {
+
+		uint64_t first;
+		vector<float> s = log->snapshot(0, &first);
+
+		for (size_t i = 0; i < s.size(); i++) {
+
+			if (s[i] != (float)(first + i))
+				torn++;
+		}
+
+		if (s.size() > 64)
+			misnumbered++;
+
+		if (first < lastFirst)
+			backwards++;
+
+		lastFirst = first;
+		snapshots++;
+	}
+
+	writer.join();
+
+	uint64_t first;
+	vector<float> s = log->snapshot(0, &first);
+
+	CGD_CHECK(torn == 0);
+	CGD_CHECK(misnumbered == 0);
+	CGD_CHECK(backwards == 0);
+	CGD_CHECK(s.size() == 64 && first == frames - 64 && s.back() == (float)(frames - 1));
+
+	cout << "  " << snapshots << " snapshots" << endl;
+
+	log->release();
+}
@@ -0,0 +1,253 @@
+
+//
+// CGDGPUProfilerTests.cpp
+//
+
+#include <stdafx.h>
+#include <CGDGPUProfiler.h>
+#include "CGDFakeGPUTimerBackend.h"
+#include "CGDTest.h"
+
+using namespace std;
+
+
+// Create a profiler over the given fake backend.  The profiler retains the backend so the caller's reference is not needed beyond the returned pointer
+static CGDGPUProfiler* createProfiler(CGDFakeGPUTimerBackend *backend) {
+
+	CGDGPUProfiler *profiler = CGDGPUProfiler::CreateGPUProfiler(backend);
+	backend->release();
+
+	return profiler;
+}
+
+
+CGD_TEST(GPUProfiler, RejectsUnusableBackends) {
+
+	CGD_CHECK(CGDGPUProfiler::CreateGPUProfiler(nullptr) == nullptr);
+
+	CGDFakeGPUTimerBackend *noSlots = CGDFakeGPUTimerBackend::CreateFakeGPUTimerBackend(0, 16, 0);
+	CGDFakeGPUTimerBackend *tooFewTimestamps = CGDFakeGPUTimerBackend::CreateFakeGPUTimerBackend(2, 3, 0);
+
+	CGD_CHECK(CGDGPUProfiler::CreateGPUProfiler(noSlots) == nullptr);
+	CGD_CHECK(CGDGPUProfiler::CreateGPUProfiler(tooFewTimestamps) == nullptr);
+
+	noSlots->release();
+	tooFewTimestamps->release();
+}
+
+
+CGD_TEST(GPUProfiler, MeasuresNestedPasses) {
+
+	// 1 MHz clock so 1000 ticks = 1 ms
+	CGDFakeGPUTimerBackend *backend = CGDFakeGPUTimerBackend::CreateFakeGPUTimerBackend(3, 16, 2);
+	backend->retain();
+
+	CGDGPUProfiler *profiler = createProfiler(backend);
+	CGD_REQUIRE(profiler);
+
+	for (int frame = 0; frame < 10; frame++) {
+
+		profiler->beginFrame();
+		backend->advance(500);
+
+		{
+			CGDGPUZone shadows(profiler, "shadows");
+			backend->advance(1000);
+
+			{
+				CGDGPUZone cascade(profiler, "cascade");
+				backend->advance(2000 + 1000 * frame);
+			}
+		}
+
+		{
+			CGDGPUZone main(profiler, "main");
+			backend->advance(4000);
+		}
+
+		profiler->endFrame();
+		backend->present();
+	}
+
+	// results lag 2 presents behind so frames 0..7 have been read back
+	CGD_CHECK(profiler->frameCount() == 10);
+	CGD_CHECK(profiler->resolvedFrameCount() == 8);
+	CGD_CHECK(profiler->skippedFrameCount() == 0);
+	CGD_CHECK(profiler->readbackLatency() == 2);
+	CGD_CHECK(backend->protocolErrorCount() == 0);
+
+	const CGDGPUPassStats *shadows = profiler->passStats("shadows");
+	const CGDGPUPassStats *cascade = profiler->passStats("cascade");
+	const CGDGPUPassStats *main = profiler->passStats("main");
+
+	CGD_REQUIRE(shadows && cascade && main);
+	CGD_CHECK(profiler->passStats("missing") == nullptr);
+
+	CGD_CHECK(shadows->depth == 0 && cascade->depth == 1 && main->depth == 0);
+	CGD_CHECK(cascade->samples == 8);
+
+	CGD_CHECK_NEAR(cascade->minimum, 2.0, 1.0e-9);
+	CGD_CHECK_NEAR(cascade->maximum, 9.0, 1.0e-9);
+	CGD_CHECK_NEAR(cascade->last, 9.0, 1.0e-9);
+	CGD_CHECK_NEAR(shadows->last, 10.0, 1.0e-9);
+	CGD_CHECK_NEAR(main->minimum, 4.0, 1.0e-9);
+	CGD_CHECK_NEAR(main->maximum, 4.0, 1.0e-9);
+	CGD_CHECK_NEAR(profiler->frameTime().last, 14.5, 1.0e-9);
+
+	// passes are reported in first-seen order
+	CGD_REQUIRE(profiler->passStats().size() == 3);
+	CGD_CHECK(profiler->passStats()[0].name == "shadows" && profiler->passStats()[1].name == "cascade" && profiler->passStats()[2].name == "main");
+
+	profiler->release();
+	backend->release();
+}
+
+
+CGD_TEST(GPUProfiler, SkipsFramesRatherThanStalling) {
+
+	// results take longer than the pool can cover - frames whose slot is still in flight are skipped
+	CGDFakeGPUTimerBackend *backend = CGDFakeGPUTimerBackend::CreateFakeGPUTimerBackend(2, 16, 3);
+	backend->retain();
+
+	CGDGPUProfiler *profiler = createProfiler(backend);
+	CGD_REQUIRE(profiler);
+
+	for (int frame = 0; frame < 20; frame++) {
+
+		profiler->beginFrame();
+
+		{
+			CGDGPUZone pass(profiler, "pass");
+			backend->advance(1000);
+		}
+
+		profiler->endFrame();
+		backend->present();
+	}
+
+	CGD_CHECK(profiler->frameCount() == 20);
+	CGD_CHECK(profiler->skippedFrameCount() > 0);
+	CGD_CHECK(profiler->resolvedFrameCount() > 0);
+	CGD_CHECK(profiler->resolvedFrameCount() + profiler->skippedFrameCount() <= 20);
+	CGD_CHECK(backend->notReadyResolves() > 0);
+	CGD_CHECK(backend->protocolErrorCount() == 0);
+
+	const CGDGPUPassStats *pass = profiler->passStats("pass");
+	CGD_REQUIRE(pass);
+	CGD_CHECK(pass->samples == profiler->resolvedFrameCount());
+	CGD_CHECK_NEAR(pass->average, 1.0, 1.0e-9);
+
+	profiler->release();
+	backend->release();
+}
+
+
+CGD_TEST(GPUProfiler, DiscardsDisjointFrames) {
+
+	CGDFakeGPUTimerBackend *backend = CGDFakeGPUTimerBackend::CreateFakeGPUTimerBackend(2, 16, 0);
+	backend->retain();
+
+	CGDGPUProfiler *profiler = createProfiler(backend);
+	CGD_REQUIRE(profiler);
+
+	for (int frame = 0; frame < 4; frame++) {
+
+		if (frame == 1)
+			backend->makeNextFrameDisjoint();
+
+		profiler->beginFrame();
+
+		{
+			CGDGPUZone pass(profiler, "pass");
+			backend->advance((frame == 1) ? 1000000 : 1000);
+		}
+
+		profiler->endFrame();
+		backend->present();
+	}
+
+	CGD_CHECK(profiler->resolvedFrameCount() == 3);
+	CGD_CHECK(profiler->disjointFrameCount() == 1);
+
+	const CGDGPUPassStats *pass = profiler->passStats("pass");
+	CGD_REQUIRE(pass);
+	CGD_CHECK(pass->samples == 3);
+	CGD_CHECK_NEAR(pass->maximum, 1.0, 1.0e-9);
+
+	profiler->release();
+	backend->release();
+}
+
+
+CGD_TEST(GPUProfiler, IgnoresPassesBeyondCapacity) {
+
+	// 8 timestamps = frame begin / end + 3 passes
+	CGDFakeGPUTimerBackend *backend = CGDFakeGPUTimerBackend::CreateFakeGPUTimerBackend(2, 8, 0);
+	backend->retain();
+
+	CGDGPUProfiler *profiler = createProfiler(backend);
+	CGD_REQUIRE(profiler);
+
+	profiler->beginFrame();
+
+	{
+		CGDGPUZone outer(profiler, "outer");
+
+		for (int i = 0; i < 10; i++) {
+
+			CGDGPUZone inner(profiler, "inner");
+			backend->advance(1000);
+		}
+
+		backend->advance(1000);
+	}
+
+	profiler->endFrame();
+
+	CGD_CHECK(backend->protocolErrorCount() == 0);
+	CGD_CHECK(profiler->resolvedFrameCount() == 1);
+
+	const CGDGPUPassStats *outer = profiler->passStats("outer");
+	const CGDGPUPassStats *inner = profiler->passStats("inner");
+
+	CGD_REQUIRE(outer && inner);
+	CGD_CHECK_NEAR(outer->last, 11.0, 1.0e-9);
+	CGD_CHECK(inner->samples == 2);
+	CGD_CHECK_NEAR(profiler->frameTime().last, 11.0, 1.0e-9);
+
+	profiler->release();
+	backend->release();
+}
+
+
+CGD_TEST(GPUProfiler, ClosesPassesLeftOpen) {
+
+	CGDFakeGPUTimerBackend *backend = CGDFakeGPUTimerBackend::CreateFakeGPUTimerBackend(2, 16, 0);
+	backend->retain();
+
+	CGDGPUProfiler *profiler = createProfiler(backend);
+	CGD_REQUIRE(profiler);
+
+	// passes outside a frame are ignored
+	profiler->beginPass("outside");
+	profiler->endPass();
+
+	profiler->beginFrame();
+	profiler->beginPass("open");
+	backend->advance(3000);
+
+	// beginFrame ends the previous frame (closing its passes) before starting the next
+	profiler->beginFrame();
+	profiler->endFrame();
+
+	CGD_CHECK(backend->protocolErrorCount() == 0);
+	CGD_CHECK(profiler->resolvedFrameCount() == 2);
+	CGD_CHECK(profiler->passStats("outside") == nullptr);
+
+	const CGDGPUPassStats *open = profiler->passStats("open");
+	CGD_REQUIRE(open);
+	CGD_CHECK_NEAR(open->last, 3.0, 1.0e-9);
+
+	profiler->release();
+	backend->release();
+}
@@ -0,0 +1,117 @@
+
+//
+// CGDHeadlessSceneTests.cpp
+//
+
+// HeadlessScene frames rendered by the software rasterizer.  Frames must not depend on the number of worker threads, and a frame of the default animation is compared with the golden image Tests/Golden/headless_frame.png.  If the golden image is missing it is written and the test fails - check the new image and commit it.
+
+#include <stdafx.h>
+#include <HeadlessScene.h>
+#include <CGDSoftwareRasterizer.h>
+#include <GUImageDecoder.h>
+#include <GUPNGWriter.h>
+#include "CGDTest.h"
+#include <cstdlib>
+#include <fstream>
+#include <vector>
+
+using namespace std;
+
+
+namespace {
+
+	const uint32_t			frameWidth = 256;
+	const uint32_t			frameHeight = 144;
+
+	const char				*goldenFrame = "Tests/Golden/headless_frame.png";
+
+	// Largest difference (8 bit levels) from the golden image accepted - rounding may differ between compilers and instruction sets
+	const int				goldenTolerance = 2;
+
+	// Render frames frames at 60 Hz with numWorkers workers and return the last frame as R8G8B8A8 values
+	vector<uint32_t> renderFrames(uint32_t frames, uint32_t numWorkers) {
+
+		vector<uint32_t> rgba;
+		HeadlessScene *scene = HeadlessScene::CreateHeadlessScene(frameWidth, frameHeight, numWorkers);
+
+		if (!scene)
+			return rgba;
+
+		for (uint32_t i = 0; i < frames; i++)
+			scene->renderFrame(1.0 / 60.0);
+
+		rgba.resize(frameWidth * frameHeight);
+		scene->getRasterizer()->readColour(rgba.data());
+
+		scene->release();
+
+		return rgba;
+	}
+}
+
+
+CGD_TEST(HeadlessScene, RejectsEmptyFrames) {
+
+	CGD_CHECK(HeadlessScene::CreateHeadlessScene(0, 16, 1) == nullptr);
+	CGD_CHECK(HeadlessScene::CreateHeadlessScene(16, 0, 1) == nullptr);
+}
+
+
+CGD_TEST(HeadlessScene, FramesDoNotDependOnWorkerCount) {
+
+	vector<uint32_t> single = renderFrames(8, 1);
+	vector<uint32_t> multiple = renderFrames(8, 3);
+
+	CGD_REQUIRE(single.size() == frameWidth * frameHeight);
+	CGD_CHECK(single == multiple);
+
+	// the frame is not blank
+	size_t distinct = 0;
+
+	for (size_t i = 1; i < single.size(); i++)
+		distinct += (single[i] != single[0]);
+
+	CGD_CHECK(distinct > single.size() / 4);
+}
+
+
+CGD_TEST(HeadlessScene, MatchesGoldenFrame) {
+
+	// 30 frames - the bushes have moved and the ocean has animated
+	vector<uint32_t> frame = renderFrames(30, 2);
+	CGD_REQUIRE(frame.size() == frameWidth * frameHeight);
+
+	const uint8_t *rgba = (const uint8_t*)frame.data();
+	vector<uint8_t> golden;
+	uint32_t goldenWidth = 0, goldenHeight = 0;
+
+	if (!ifstream(goldenFrame).is_open()) {
+
+		bool written = gu_png_write(goldenFrame, frameWidth, frameHeight, rgba, frameWidth * 4);
+
+		cout << "  " << (written ? "wrote golden image " : "cannot write golden image ") << goldenFrame << endl;
+		CGD_REQUIRE(!"golden image missing");
+	}
+
+	CGD_REQUIRE(gu_image_read_rgba(goldenFrame, goldenWidth, goldenHeight, golden));
+	CGD_REQUIRE(goldenWidth == frameWidth && goldenHeight == frameHeight);
+
+	int maxDifference = 0;
+	size_t differentPixels = 0;
+
+	for (size_t i = 0; i < golden.size(); i += 4) {
+
+		int pixelDifference = 0;
+
+		for (int c = 0; c < 4; c++)
+			pixelDifference = max(pixelDifference, abs((int)rgba[i + c] - (int)golden[i + c]));
+
+		maxDifference = max(maxDifference, pixelDifference);
+		differentPixels += (pixelDifference > 0);
+	}
+
+	if (maxDifference > goldenTolerance)
+		cout << "  largest difference from " << goldenFrame << ": " << maxDifference << " (" << differentPixels << " pixels differ)" << endl;
+
+	CGD_CHECK(maxDifference <= goldenTolerance);
+}
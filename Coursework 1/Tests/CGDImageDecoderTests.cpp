@@ -0,0 +1,321 @@
+
+//
+// CGDImageDecoderTests.cpp
+//
+
+// GUImageDecoder format detection and decoding (PNG round trips through GUPNGWriter, BMP files built in memory and the scene's textures of each format) and CGDImageLoader directory listing and batch loading.
+
+#include <stdafx.h>
+#include <GUImageDecoder.h>
+#include <GUPNGWriter.h>
+#include <CGDImageLoader.h>
+#include <CGDJobSystem.h>
+#include "CGDTest.h"
+#include <algorithm>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+
+namespace {
+
+	// width x height RGBA8 image of pseudo-random texels
+	vector<uint8_t> noiseImage(uint32_t width, uint32_t height) {
+
+		vector<uint8_t> rgba((size_t)width * height * 4);
+		uint32_t state = 9;
+
+		for (size_t i = 0; i < rgba.size(); i++) {
+
+			state ^= state << 13; state ^= state >> 17; state ^= state << 5;
+			rgba[i] = (uint8_t)(state >> 24);
+		}
+
+		return rgba;
+	}
+
+	void writeUInt16(vector<uint8_t>& data, uint32_t v) {
+
+		data.push_back((uint8_t)v);
+		data.push_back((uint8_t)(v >> 8));
+	}
+
+	void writeUInt32(vector<uint8_t>& data, uint32_t v) {
+
+		writeUInt16(data, v & 0xFFFF);
+		writeUInt16(data, v >> 16);
+	}
+
+	// 24-bit BMP file of rgba (alpha is dropped) - rows bottom-up (or top-down with a negative height) and padded to 4 bytes
+	vector<uint8_t> bmpFile(uint32_t width, uint32_t height, const vector<uint8_t>& rgba, bool topDown) {
+
+		uint32_t rowBytes = (width * 3 + 3) & ~3u;
+		vector<uint8_t> data;
+
+		data.push_back('B');
+		data.push_back('M');
+		writeUInt32(data, 54 + rowBytes * height);
+		writeUInt32(data, 0);
+		writeUInt32(data, 54);
+
+		writeUInt32(data, 40);
+		writeUInt32(data, width);
+		writeUInt32(data, (topDown) ? (uint32_t)-(int32_t)height : height);
+		writeUInt16(data, 1);
+		writeUInt16(data, 24);
+		writeUInt32(data, 0); // BI_RGB
+		writeUInt32(data, rowBytes * height);
+		writeUInt32(data, 2835);
+		writeUInt32(data, 2835);
+		writeUInt32(data, 0);
+		writeUInt32(data, 0);
+
+		for (uint32_t r = 0; r < height; r++) {
+
+			uint32_t y = (topDown) ? r : height - 1 - r;
+
+			for (uint32_t x = 0; x < width; x++) {
+
+				const uint8_t *t = &rgba[((size_t)y * width + x) * 4];
+
+				data.push_back(t[2]);
+				data.push_back(t[1]);
+				data.push_back(t[0]);
+			}
+
+			data.insert(data.end(), rowBytes - width * 3, 0);
+		}
+
+		return data;
+	}
+}
+
+
+CGD_TEST(ImageDecoder, DetectsFormatsFromMagicBytes) {
+
+	const uint8_t png[8] = { 0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A };
+	const uint8_t jpeg[8] = { 0xFF, 0xD8, 0xFF, 0xE0, 0, 0x10, 'J', 'F' };
+	const uint8_t bmp[8] = { 'B', 'M', 0, 0, 0, 0, 0, 0 };
+	const uint8_t tiffLittle[8] = { 'I', 'I', 42, 0, 8, 0, 0, 0 };
+	const uint8_t tiffBig[8] = { 'M', 'M', 0, 42, 0, 0, 0, 8 };
+	const uint8_t dds[8] = { 'D', 'D', 'S', ' ', 124, 0, 0, 0 };
+	const uint8_t text[8] = { 'h', 'e', 'l', 'l', 'o', ' ', ' ', ' ' };
+
+	CGD_CHECK(gu_image_detect(png, 8) == gu_image_png);
+	CGD_CHECK(gu_image_detect(jpeg, 8) == gu_image_jpeg);
+	CGD_CHECK(gu_image_detect(bmp, 8) == gu_image_bmp);
+	CGD_CHECK(gu_image_detect(tiffLittle, 8) == gu_image_tiff);
+	CGD_CHECK(gu_image_detect(tiffBig, 8) == gu_image_tiff);
+	CGD_CHECK(gu_image_detect(dds, 8) == gu_image_dds);
+	CGD_CHECK(gu_image_detect(text, 8) == gu_image_unknown);
+	CGD_CHECK(gu_image_detect(png, 3) == gu_image_unknown);
+
+	// files are identified by content, not extension
+	CGD_CHECK(gu_image_detect_file("Resources/Textures/Brick_DIFFUSE.jpg") == gu_image_jpeg);
+	CGD_CHECK(gu_image_detect_file("Resources/Textures/tree.tif") == gu_image_tiff);
+	CGD_CHECK(gu_image_detect_file("Resources/Textures/Waves.dds") == gu_image_dds);
+	CGD_CHECK(gu_image_detect_file("Resources/Textures/Thumbs.db") == gu_image_unknown);
+	CGD_CHECK(gu_image_detect_file("Resources/Textures/no_such_file.png") == gu_image_unknown);
+}
+
+
+CGD_TEST(ImageDecoder, RoundTripsPNG) {
+
+	const uint32_t sizes[3][2] = { { 1, 1 }, { 37, 21 }, { 256, 3 } };
+
+	for (int s = 0; s < 3; s++) {
+
+		uint32_t width = sizes[s][0], height = sizes[s][1];
+		vector<uint8_t> rgba = noiseImage(width, height), png;
+		gu_image image;
+
+		CGD_REQUIRE(gu_png_encode(width, height, rgba.data(), width * 4, png));
+		CGD_REQUIRE(gu_image_decode(png.data(), png.size(), image));
+
+		CGD_CHECK(image.format == gu_image_png);
+		CGD_CHECK(image.width == width && image.height == height);
+		CGD_CHECK(image.pixels == rgba);
+
+		// corrupt and truncated files fail cleanly
+		vector<uint8_t> truncated(png.begin(), png.begin() + png.size() / 2);
+
+		CGD_CHECK(!gu_image_decode(truncated.data(), truncated.size(), image));
+
+		for (size_t i = 40; i < png.size(); i += 7)
+			png[i] ^= 0x5A;
+
+		CGD_CHECK(!gu_image_decode(png.data(), png.size(), image));
+	}
+}
+
+
+CGD_TEST(ImageDecoder, DecodesBMP) {
+
+	// odd widths need row padding
+	vector<uint8_t> rgba = noiseImage(5, 3);
+
+	for (size_t i = 3; i < rgba.size(); i += 4)
+		rgba[i] = 255;
+
+	for (int topDown = 0; topDown < 2; topDown++) {
+
+		vector<uint8_t> bmp = bmpFile(5, 3, rgba, topDown != 0);
+		gu_image image;
+
+		CGD_REQUIRE(gu_image_decode(bmp.data(), bmp.size(), image));
+
+		CGD_CHECK(image.format == gu_image_bmp);
+		CGD_CHECK(image.width == 5 && image.height == 3);
+		CGD_CHECK(image.pixels == rgba);
+
+		bmp.resize(bmp.size() - 10);
+
+		CGD_CHECK(!gu_image_decode(bmp.data(), bmp.size(), image));
+	}
+}
+
+
+CGD_TEST(ImageDecoder, DecodesSceneTextures) {
+
+	struct Expected {
+
+		const char			*filename;
+		gu_image_format		format;
+		uint32_t			width;
+		uint32_t			height;
+	};
+
+	const Expected textures[] = {
+
+		{ "Resources/Textures/heightmap1.bmp", gu_image_bmp, 1024, 1024 },
+		{ "Resources/Textures/logs.jpg", gu_image_jpeg, 410, 149 },
+		{ "Resources/Textures/NormalMap.png", gu_image_png, 1024, 1024 },
+		{ "Resources/Textures/tree.tif", gu_image_tiff, 256, 256 },
+		{ "Resources/Textures/orb.tif", gu_image_tiff, 512, 128 }
+	};
+
+	gu_image image;
+
+	for (const Expected& t : textures) {
+
+		vector<uint8_t> file;
+
+		CGD_REQUIRE(gu_image_read_file(t.filename, file));
+		CGD_CHECK(gu_image_decode(file.data(), file.size(), image));
+		CGD_CHECK(image.format == t.format);
+
+		CGD_CHECK(image.width == t.width && image.height == t.height);
+		CGD_CHECK(image.pixels.size() == (size_t)image.width * image.height * 4);
+	}
+
+	// the height map is greyscale and opaque and the tree is cut out with alpha
+	uint32_t width, height;
+	vector<uint8_t> rgba;
+
+	CGD_REQUIRE(gu_image_read_rgba("Resources/Textures/heightmap1.bmp", width, height, rgba));
+
+	bool grey = true, opaque = true;
+
+	for (size_t i = 0; i < rgba.size(); i += 4) {
+
+		grey = grey && rgba[i] == rgba[i + 1] && rgba[i + 1] == rgba[i + 2];
+		opaque = opaque && rgba[i + 3] == 255;
+	}
+
+	CGD_CHECK(grey && opaque);
+
+	CGD_REQUIRE(gu_image_read_rgba("Resources/Textures/tree.tif", width, height, rgba));
+
+	size_t transparent = 0;
+
+	for (size_t i = 3; i < rgba.size(); i += 4)
+		transparent += (rgba[i] == 0) ? 1 : 0;
+
+	CGD_CHECK(transparent > 0 && transparent < (size_t)width * height);
+
+	// DDS files are parsed, not decoded, and gu_image_read_rgba refuses them
+	vector<uint8_t> file;
+
+	CGD_REQUIRE(gu_image_read_file("Resources/Textures/Waves.dds", file));
+	CGD_CHECK(gu_image_decode(file.data(), file.size(), image));
+	CGD_CHECK(image.format == gu_image_dds);
+	CGD_CHECK(image.dds.width == image.width && image.dds.height == image.height);
+	CGD_CHECK(!gu_image_read_rgba("Resources/Textures/Waves.dds", width, height, rgba));
+}
+
+
+CGD_TEST(ImageDecoder, ListsDirectories) {
+
+	vector<string> files;
+
+	CGD_REQUIRE(CGDImageLoader::ListFiles("Resources/Textures", files));
+
+	CGD_CHECK(is_sorted(files.begin(), files.end()));
+	CGD_CHECK(find(files.begin(), files.end(), "Resources/Textures/tree.tif") != files.end());
+	CGD_CHECK(find(files.begin(), files.end(), "Resources/Textures/Thumbs.db") != files.end());
+
+	// subdirectories are not listed
+	CGD_REQUIRE(CGDImageLoader::ListFiles("Resources", files));
+
+	CGD_CHECK(find(files.begin(), files.end(), "Resources/Textures") == files.end());
+
+	CGD_CHECK(!CGDImageLoader::ListFiles("Resources/no_such_directory", files));
+	CGD_CHECK(files.empty());
+}
+
+
+CGD_TEST(ImageDecoder, LoadsBatchesInParallel) {
+
+	CGDJobSystem *jobSystem = CGDJobSystem::CreateJobSystem(2);
+	CGD_REQUIRE(jobSystem);
+
+	CGDImageLoader *loader = CGDImageLoader::CreateImageLoader(jobSystem);
+	vector<string> files;
+
+	files.push_back("Resources/Textures/logs.jpg");
+	files.push_back("Resources/Textures/tree.tif");
+	files.push_back("Resources/Textures/Waves.dds");
+	files.push_back("Resources/Textures/Thumbs.db");
+	files.push_back("Resources/Textures/smoke.tif");
+
+	vector<CGDLoadedImage*> serial, parallel;
+
+	loader->load(files, serial, false);
+	loader->load(files, parallel, true);
+
+	CGD_REQUIRE(serial.size() == files.size() && parallel.size() == files.size());
+
+	for (size_t i = 0; i < files.size(); i++) {
+
+		bool image = (i != 3);
+
+		CGD_CHECK(serial[i] != parallel[i]);
+		CGD_CHECK(serial[i]->filename == files[i]);
+		CGD_CHECK(serial[i]->loaded == image && parallel[i]->loaded == image);
+		CGD_CHECK(serial[i]->image.pixels == parallel[i]->image.pixels);
+		CGD_CHECK(serial[i]->mips == parallel[i]->mips);
+
+		// RGBA8 images get a full mip chain, DDS files keep their own
+		if (image)
+			CGD_CHECK(serial[i]->mips.empty() == (serial[i]->image.format == gu_image_dds));
+	}
+
+	// recycled staging images are reused by the next batch
+	CGDLoadedImage *first = serial[0];
+
+	loader->recycle(serial);
+
+	CGD_CHECK(serial.empty());
+
+	vector<CGDLoadedImage*> batch;
+
+	loader->load(files, batch);
+
+	CGD_CHECK(find(batch.begin(), batch.end(), first) != batch.end());
+
+	loader->recycle(batch);
+	loader->recycle(parallel);
+	loader->release();
+	jobSystem->release();
+}
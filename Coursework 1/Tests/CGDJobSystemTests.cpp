@@ -0,0 +1,316 @@
+
+//
+// CGDJobSystemTests.cpp
+//
+
+// CGDJobSystem scheduling, dependencies and shutdown.  The suite is also run under ThreadSanitizer (CGD_SANITIZER=thread, see CMakeLists.txt).
+
+#include <stdafx.h>
+#include <CGDJobSystem.h>
+#include "CGDTest.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+
+namespace {
+
+	// Live bytes of the job system's memory tag (0 if memory tracking is disabled)
+	size_t liveJobBytes() {
+
+		return gu_memory_get_stats(gu_mem_jobs).live_bytes;
+	}
+
+	// Worker counts exercised by each test.  More workers than hardware threads is deliberate - it makes preemption inside the deque and counter protocols likely
+	const uint32_t		workerCounts[3] = { 1, 2, 7 };
+}
+
+
+CGD_TEST(JobSystem, RunsEveryJob) {
+
+	for (int w = 0; w < 3; w++) {
+
+		CGDJobSystem *jobSystem = CGDJobSystem::CreateJobSystem(workerCounts[w], (w == 1) ? CGDThreadAffinity::PIN_WORKERS : CGDThreadAffinity::NONE);
+		CGD_REQUIRE(jobSystem);
+
+		CGD_CHECK(jobSystem->workerCount() == workerCounts[w]);
+		CGD_CHECK(jobSystem->threadCount() == workerCounts[w] + 1);
+		CGD_CHECK(jobSystem->threadIndex() == 0);
+
+		atomic<int> n(0);
+		CGDJobCounter counter;
+
+		for (int i = 0; i < 5000; i++)
+			jobSystem->run([&n]() { n++; }, &counter);
+
+		jobSystem->wait(&counter);
+
+		CGD_CHECK(counter.done());
+		CGD_CHECK(n == 5000);
+
+		// every thread index seen inside a job is valid
+		atomic<uint32_t> badIndices(0);
+		CGDJobCounter indexCounter;
+
+		for (int i = 0; i < 1000; i++)
+			jobSystem->run([&]() { if (jobSystem->threadIndex() >= jobSystem->threadCount()) badIndices++; }, &indexCounter);
+
+		jobSystem->wait(&indexCounter);
+
+		CGD_CHECK(badIndices == 0);
+
+		uint64_t executed = 0;
+
+		for (uint32_t t = 0; t < jobSystem->threadCount(); t++)
+			executed += jobSystem->threadStats(t).jobsExecuted;
+
+		CGD_CHECK(executed == 6000);
+
+		jobSystem->release();
+	}
+}
+
+
+CGD_TEST(JobSystem, WaitsInsideJobs) {
+
+	for (int w = 0; w < 3; w++) {
+
+		CGDJobSystem *jobSystem = CGDJobSystem::CreateJobSystem(workerCounts[w]);
+		CGD_REQUIRE(jobSystem);
+
+		// jobs that spawn jobs and wait for them must not deadlock the pool even with a single worker
+		atomic<int> n(0);
+		atomic<int> notDone(0);
+		CGDJobCounter outer;
+
+		for (int i = 0; i < 16; i++) {
+
+			jobSystem->run([&]() {
+
+				CGDJobCounter inner;
+
+				for (int k = 0; k < 64; k++)
+					jobSystem->run([&n]() { n++; }, &inner);
+
+				jobSystem->wait(&inner);
+
+				if (!inner.done())
+					notDone++;
+
+			}, &outer);
+		}
+
+		jobSystem->wait(&outer);
+
+		CGD_CHECK(n == 16 * 64);
+		CGD_CHECK(notDone == 0);
+
+		// a counter completed by hand from a job wakes a sleeping waiter
+		for (int i = 0; i < 20; i++) {
+
+			CGDJobCounter manual;
+			manual.add();
+
+			jobSystem->run([&manual]() {
+
+				this_thread::sleep_for(chrono::microseconds(200));
+				manual.complete();
+			});
+
+			jobSystem->wait(&manual);
+
+			CGD_CHECK(manual.done());
+		}
+
+		jobSystem->release();
+	}
+}
+
+
+CGD_TEST(JobSystem, ParallelForCoversRangeOnce) {
+
+	CGDJobSystem *jobSystem = CGDJobSystem::CreateJobSystem(3);
+	CGD_REQUIRE(jobSystem);
+
+	const uint32_t begin = 3, end = 10007;
+	uint32_t grainSizes[4] = { 0, 1, 7, 20000 };
+
+	for (int g = 0; g < 4; g++) {
+
+		uint32_t grain = grainSizes[g];
+		vector<atomic<int> > hits(end);
+		atomic<uint32_t> badRanges(0);
+
+		for (uint32_t i = 0; i < end; i++)
+			hits[i] = 0;
+
+		jobSystem->parallelFor(begin, end, grain, [&](uint32_t b, uint32_t e) {
+
+			if (b >= e || (grain && e - b > grain))
+				badRanges++;
+
+			for (uint32_t i = b; i < e; i++)
+				hits[i]++;
+		});
+
+		uint32_t wrong = 0;
+
+		for (uint32_t i = 0; i < end; i++)
+			wrong += (hits[i] != ((i >= begin) ? 1 : 0));
+
+		CGD_CHECK(wrong == 0);
+		CGD_CHECK(badRanges == 0);
+	}
+
+	// empty range
+	bool called = false;
+
+	jobSystem->parallelFor(5, 5, 0, [&called](uint32_t, uint32_t) { called = true; });
+
+	CGD_CHECK(!called);
+
+	jobSystem->release();
+}
+
+
+CGD_TEST(JobSystem, RunAfterOrdersJobs) {
+
+	CGDJobSystem *jobSystem = CGDJobSystem::CreateJobSystem(3);
+	CGD_REQUIRE(jobSystem);
+
+	uint32_t orderErrors = 0;
+
+	// 8 jobs -> 4 continuations -> 1 continuation
+	for (int rep = 0; rep < 200; rep++) {
+
+		atomic<int> stage(0);
+		atomic<int> errors(0);
+		CGDJobCounter a, b, c;
+
+		for (int i = 0; i < 8; i++)
+			jobSystem->run([&stage]() { this_thread::yield(); stage.fetch_add(1); }, &a);
+
+		for (int i = 0; i < 4; i++)
+			jobSystem->runAfter(&a, [&]() { if (stage.load() < 8) errors++; stage.fetch_add(100); }, &b);
+
+		jobSystem->runAfter(&b, [&]() { if (stage.load() != 408) errors++; stage.fetch_add(1000); }, &c);
+
+		// waiting on c also waits for its dependencies
+		jobSystem->wait(&c);
+
+		if (stage != 1408 || errors != 0 || !a.done() || !b.done())
+			orderErrors++;
+	}
+
+	CGD_CHECK(orderErrors == 0);
+
+	// a dependency that is already done (or none) queues the job immediately
+	CGDJobCounter done, counter;
+	atomic<int> x(0);
+
+	jobSystem->runAfter(&done, [&x]() { x++; }, &counter);
+	jobSystem->runAfter(nullptr, [&x]() { x++; }, &counter);
+	jobSystem->wait(&counter);
+
+	CGD_CHECK(x == 2);
+
+	jobSystem->release();
+}
+
+
+CGD_TEST(JobSystem, AcceptsJobsFromExternalThreads) {
+
+	CGDJobSystem *jobSystem = CGDJobSystem::CreateJobSystem(2);
+	CGD_REQUIRE(jobSystem);
+
+	atomic<int> n(0);
+	atomic<uint32_t> externalIndex(0);
+	vector<thread> threads;
+
+	for (int t = 0; t < 3; t++) {
+
+		threads.push_back(thread([&]() {
+
+			externalIndex = jobSystem->threadIndex();
+
+			CGDJobCounter counter;
+
+			for (int i = 0; i < 1000; i++)
+				jobSystem->run([&n]() { n++; }, &counter);
+
+			jobSystem->wait(&counter);
+		}));
+	}
+
+	for (size_t t = 0; t < threads.size(); t++)
+		threads[t].join();
+
+	CGD_CHECK(n == 3000);
+	CGD_CHECK(externalIndex == CGD_JOB_EXTERNAL_THREAD);
+
+	jobSystem->release();
+}
+
+
+CGD_TEST(JobSystem, ShutdownDrainsAndReleasesJobs) {
+
+	size_t baseline = liveJobBytes();
+
+	// fire-and-forget jobs are completed before the workers exit
+	static atomic<int> fired(0);
+
+	CGDJobSystem *jobSystem = CGDJobSystem::CreateJobSystem(3);
+	CGD_REQUIRE(jobSystem);
+
+	for (int i = 0; i < 1000; i++)
+		jobSystem->run([]() { fired++; });
+
+	jobSystem->release();
+
+	CGD_CHECK(fired == 1000);
+	CGD_CHECK(liveJobBytes() == baseline);
+
+	// continuations whose dependency never completes are discarded at shutdown and detached from the counter
+	atomic<int> ran(0);
+
+	{
+		CGDJobCounter dependency;
+
+		jobSystem = CGDJobSystem::CreateJobSystem(2);
+
+		dependency.add();
+
+		for (int i = 0; i < 3; i++)
+			jobSystem->runAfter(&dependency, [&ran]() { ran++; });
+
+		jobSystem->release();
+
+		// completing the counter after shutdown must not queue anything
+		dependency.complete();
+
+		CGD_CHECK(dependency.done());
+	}
+
+	CGD_CHECK(ran == 0);
+	CGD_CHECK(liveJobBytes() == baseline);
+
+	// a counter destroyed before it completes discards its continuations
+	jobSystem = CGDJobSystem::CreateJobSystem(2);
+
+	{
+		CGDJobCounter abandoned;
+
+		abandoned.add();
+
+		for (int i = 0; i < 3; i++)
+			jobSystem->runAfter(&abandoned, [&ran]() { ran++; });
+	}
+
+	jobSystem->release();
+
+	CGD_CHECK(ran == 0);
+	CGD_CHECK(liveJobBytes() == baseline);
+}
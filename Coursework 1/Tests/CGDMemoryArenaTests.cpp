@@ -0,0 +1,255 @@
+
+//
+// CGDMemoryArenaTests.cpp
+//
+
+#include <stdafx.h>
+#include <GUMemoryArena.h>
+#include <GUObjectPool.h>
+#include "CGDTest.h"
+#include <cstring>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+
+namespace {
+
+	// Number of heap allocations attributed to the arena tag (arena blocks and pool chunks)
+	uint64_t arenaHeapAllocations() {
+
+		return gu_memory_get_stats(gu_mem_arena).allocations;
+	}
+
+	struct Counted {
+
+		static int		live;
+
+		int				value;
+		double			padding[3];
+
+		Counted(int v) : value(v) { live++; }
+		~Counted() { live--; }
+	};
+
+	int Counted::live = 0;
+}
+
+
+CGD_TEST(MemoryArena, AllocationsAreAlignedAndDisjoint) {
+
+	GUMemoryArena *arena = GUMemoryArena::CreateArena(4096);
+	CGD_REQUIRE(arena);
+
+	char *previousEnd = nullptr;
+
+	for (size_t i = 0; i < 64; i++) {
+
+		size_t alignment = size_t(1) << (i % 8);
+		size_t size = 1 + i * 7;
+		char *p = (char*)arena->allocate(size, alignment);
+
+		CGD_REQUIRE(p);
+		CGD_CHECK(((uintptr_t)p & (alignment - 1)) == 0);
+
+		// allocations within a block are laid out in order
+		if (previousEnd && arena->blockCount() == 1)
+			CGD_CHECK(p >= previousEnd);
+
+		memset(p, (int)i, size);
+		previousEnd = p + size;
+	}
+
+	CGD_CHECK(arena->allocate(16, 3) == nullptr);
+	CGD_CHECK(arena->allocate(16, 0) == nullptr);
+	CGD_CHECK(arena->allocationCount() == 64);
+
+	arena->release();
+}
+
+
+CGD_TEST(MemoryArena, RewindReleasesToMarker) {
+
+	GUMemoryArena *arena = GUMemoryArena::CreateArena(1024);
+	CGD_REQUIRE(arena);
+
+	arena->allocate(100);
+	size_t used = arena->bytesUsed();
+	GUMemoryArena::Marker marker = arena->getMarker();
+
+	// spill into further blocks
+	void *p = arena->allocate(200);
+
+	for (int i = 0; i < 20; i++)
+		arena->allocate(300);
+
+	CGD_CHECK(arena->blockCount() > 1);
+
+	arena->rewind(marker);
+	CGD_CHECK(arena->bytesUsed() == used);
+
+	// memory after the marker is handed out again
+	CGD_CHECK(arena->allocate(200) == p);
+
+	arena->release();
+}
+
+
+CGD_TEST(MemoryArena, ResetConsolidatesBlocks) {
+
+	GUMemoryArena *arena = GUMemoryArena::CreateArena(1024);
+	CGD_REQUIRE(arena);
+
+	// first frame overflows the initial block
+	for (int i = 0; i < 40; i++)
+		arena->allocate(256);
+
+	size_t peak = arena->peakBytesUsed();
+	CGD_CHECK(arena->blockCount() > 1);
+
+	arena->reset();
+
+	CGD_CHECK(arena->bytesUsed() == 0);
+	CGD_CHECK(arena->blockCount() == 1);
+	CGD_CHECK(arena->bytesReserved() >= peak);
+
+	// steady state frames make no further heap allocations
+	uint64_t heapAllocations = arenaHeapAllocations();
+
+	for (int frame = 0; frame < 10; frame++) {
+
+		for (int i = 0; i < 40; i++)
+			CGD_CHECK(arena->allocate(256) != nullptr);
+
+		arena->reset();
+	}
+
+	CGD_CHECK(arena->blockCount() == 1);
+	CGD_CHECK(arenaHeapAllocations() == heapAllocations);
+
+	arena->release();
+}
+
+
+CGD_TEST(MemoryArena, OversizedAllocationsGetTheirOwnBlock) {
+
+	GUMemoryArena *arena = GUMemoryArena::CreateArena(1024);
+	CGD_REQUIRE(arena);
+
+	char *small = (char*)arena->allocate(16);
+	char *large = (char*)arena->allocate(64 * 1024, 64);
+
+	CGD_REQUIRE(small && large);
+	CGD_CHECK(((uintptr_t)large & 63) == 0);
+	memset(large, 0xab, 64 * 1024);
+
+	CGD_CHECK(arena->bytesReserved() >= 1024 + 64 * 1024);
+	CGD_CHECK(arena->bytesUsed() >= 16 + 64 * 1024);
+
+	arena->release();
+}
+
+
+CGD_TEST(MemoryArena, ScratchScopesNest) {
+
+	GUMemoryArena *scratch = GUMemoryArena::ThreadScratch();
+	CGD_REQUIRE(scratch);
+
+	size_t base = scratch->bytesUsed();
+
+	{
+		GUScratchScope outer;
+		int *a = outer.allocateArray<int>(1000);
+		CGD_REQUIRE(a);
+
+		size_t afterOuter = scratch->bytesUsed();
+
+		{
+			GUScratchScope inner;
+			CGD_CHECK(inner.allocate(5000) != nullptr);
+			CGD_CHECK(scratch->bytesUsed() > afterOuter);
+		}
+
+		CGD_CHECK(scratch->bytesUsed() == afterOuter);
+	}
+
+	CGD_CHECK(scratch->bytesUsed() == base);
+
+	// each thread has its own scratch arena
+	GUMemoryArena *other = nullptr;
+
+	thread t([&]() {
+
+		other = GUMemoryArena::ThreadScratch();
+		GUMemoryArena::ReleaseThreadScratch();
+	});
+
+	t.join();
+
+	CGD_CHECK(other != nullptr && other != scratch);
+}
+
+
+CGD_TEST(ObjectPool, ConstructsAndDestroysObjects) {
+
+	{
+		GUObjectPool<Counted> pool(4);
+		vector<Counted*> objects;
+
+		for (int i = 0; i < 10; i++)
+			objects.push_back(pool.create(i));
+
+		CGD_CHECK(Counted::live == 10);
+		CGD_CHECK(pool.size() == 10 && pool.capacity() == 12 && pool.peakSize() == 10);
+
+		for (int i = 0; i < 10; i++) {
+
+			CGD_CHECK(objects[i]->value == i);
+			CGD_CHECK(((uintptr_t)objects[i] & (std::alignment_of<Counted>::value - 1)) == 0);
+		}
+
+		for (auto o : objects)
+			pool.destroy(o);
+
+		pool.destroy(nullptr);
+
+		CGD_CHECK(Counted::live == 0);
+		CGD_CHECK(pool.size() == 0 && pool.peakSize() == 10);
+	}
+}
+
+
+CGD_TEST(ObjectPool, ReusesFreedSlotsWithoutHeapAllocation) {
+
+	GUObjectPool<Counted> pool(64);
+	CGD_REQUIRE(pool.reserve(100));
+
+	size_t capacity = pool.capacity();
+	uint64_t heapAllocations = arenaHeapAllocations();
+
+	Counted *first = pool.create(1);
+	pool.destroy(first);
+
+	// the most recently freed slot is reused first
+	Counted *second = pool.create(2);
+	CGD_CHECK(second == first);
+	pool.destroy(second);
+
+	vector<Counted*> objects;
+
+	for (int round = 0; round < 10; round++) {
+
+		for (int i = 0; i < 100; i++)
+			objects.push_back(pool.create(i));
+
+		for (auto o : objects)
+			pool.destroy(o);
+
+		objects.clear();
+	}
+
+	CGD_CHECK(pool.capacity() == capacity);
+	CGD_CHECK(arenaHeapAllocations() == heapAllocations);
+	CGD_CHECK(Counted::live == 0);
+}
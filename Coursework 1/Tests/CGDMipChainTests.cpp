@@ -0,0 +1,325 @@
+
+//
+// CGDMipChainTests.cpp
+//
+
+// GUMipChain levels against a double precision reference of the box filter, and the properties of each content type - sRGB colour is averaged in linear space, normals stay unit length and alpha test coverage is preserved.
+
+#include <stdafx.h>
+#include <GUMipChain.h>
+#include "CGDTest.h"
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+using namespace std;
+
+
+namespace {
+
+	// width x height RGBA8 image of pseudo-random texels
+	vector<uint8_t> noiseImage(uint32_t width, uint32_t height, uint32_t seed) {
+
+		vector<uint8_t> rgba((size_t)width * height * 4);
+		uint32_t state = seed;
+
+		for (size_t i = 0; i < rgba.size(); i++) {
+
+			state ^= state << 13; state ^= state >> 17; state ^= state << 5;
+			rgba[i] = (uint8_t)(state >> 24);
+		}
+
+		return rgba;
+	}
+
+	// Grass blade cut-out - opaque blades 1 to 3 texels wide and of random heights over transparent texels, like the alpha of the grass texture
+	vector<uint8_t> bladeImage(uint32_t size) {
+
+		vector<uint8_t> rgba((size_t)size * size * 4, 0);
+		uint32_t state = 5;
+
+		for (size_t i = 0; i < (size_t)size * size; i++) {
+
+			rgba[i * 4] = 40;
+			rgba[i * 4 + 1] = 160;
+			rgba[i * 4 + 2] = 30;
+		}
+
+		for (int blade = 0; blade < 24; blade++) {
+
+			uint32_t r[3];
+
+			for (int k = 0; k < 3; k++) {
+
+				state ^= state << 13; state ^= state >> 17; state ^= state << 5;
+				r[k] = state;
+			}
+
+			uint32_t left = r[0] % size, right = min(left + 1 + r[1] % 3, size), top = r[2] % (size / 2);
+
+			for (uint32_t y = top; y < size; y++)
+				for (uint32_t x = left; x < right; x++)
+					rgba[((size_t)y * size + x) * 4 + 3] = 255;
+		}
+
+		return rgba;
+	}
+
+	double srgbToLinear(double s) {
+
+		return (s <= 0.04045) ? s / 12.92 : pow((s + 0.055) / 1.055, 2.4);
+	}
+
+	double linearToSRGB(double x) {
+
+		return (x <= 0.0031308) ? x * 12.92 : 1.055 * pow(x, 1.0 / 2.4) - 0.055;
+	}
+
+	// Reference box filtered chain of a size x size image (size a power of 2) - each level is the 2x2 average of the previous level in double precision.  Levels hold unrounded 8-bit values
+	vector<vector<double> > referenceBoxChain(uint32_t size, const vector<uint8_t>& rgba, bool srgb) {
+
+		vector<double> level(rgba.size());
+		vector<vector<double> > mips(1, vector<double>(rgba.begin(), rgba.end()));
+
+		for (size_t i = 0; i < rgba.size(); i++)
+			level[i] = (srgb && (i & 3) != 3) ? srgbToLinear(rgba[i] / 255.0) : rgba[i] / 255.0;
+
+		for (uint32_t s = size / 2; s >= 1; s /= 2) {
+
+			vector<double> next((size_t)s * s * 4);
+			vector<double> mip(next.size());
+
+			for (uint32_t y = 0; y < s; y++) {
+
+				for (uint32_t x = 0; x < s; x++) {
+
+					for (int c = 0; c < 4; c++) {
+
+						double sum = 0.0;
+
+						for (int k = 0; k < 4; k++)
+							sum += level[(((size_t)(y * 2 + k / 2) * s * 2) + x * 2 + k % 2) * 4 + c];
+
+						size_t i = ((size_t)y * s + x) * 4 + c;
+
+						next[i] = sum * 0.25;
+						mip[i] = ((srgb && c != 3) ? linearToSRGB(next[i]) : next[i]) * 255.0;
+					}
+				}
+			}
+
+			level.swap(next);
+			mips.push_back(mip);
+		}
+
+		return mips;
+	}
+}
+
+
+CGD_TEST(MipChain, BuildsTheFullChain) {
+
+	CGD_CHECK(gu_mip_count(1, 1) == 1);
+	CGD_CHECK(gu_mip_count(256, 256) == 9);
+	CGD_CHECK(gu_mip_count(37, 21) == 6);
+	CGD_CHECK(gu_mip_count(1, 5) == 3);
+
+	const uint32_t sizes[3][2] = { { 64, 64 }, { 37, 21 }, { 1, 5 } };
+
+	for (int s = 0; s < 3; s++) {
+
+		uint32_t width = sizes[s][0], height = sizes[s][1];
+		vector<uint8_t> rgba = noiseImage(width, height, 7);
+
+		for (int filter = gu_mip_box; filter <= gu_mip_kaiser; filter++) {
+
+			gu_mip_options options;
+			vector<vector<uint8_t> > mips;
+
+			options.filter = (gu_mip_filter)filter;
+			gu_mip_generate(width, height, rgba.data(), options, mips);
+
+			CGD_REQUIRE(mips.size() == gu_mip_count(width, height));
+			CGD_CHECK(mips[0] == rgba);
+
+			for (size_t m = 0; m < mips.size(); m++)
+				CGD_CHECK(mips[m].size() == (size_t)max(width >> m, 1u) * max(height >> m, 1u) * 4);
+		}
+	}
+}
+
+
+CGD_TEST(MipChain, BoxFilterMatchesReference) {
+
+	vector<uint8_t> rgba = noiseImage(64, 64, 11);
+
+	for (int c = 0; c < 2; c++) {
+
+		gu_mip_options options;
+		vector<vector<uint8_t> > mips;
+
+		options.filter = gu_mip_box;
+		options.content = (c == 0) ? gu_mip_colour : gu_mip_linear;
+
+		gu_mip_generate(64, 64, rgba.data(), options, mips);
+
+		vector<vector<double> > reference = referenceBoxChain(64, rgba, c == 0);
+
+		CGD_REQUIRE(mips.size() == reference.size());
+
+		// every value is the reference rounded to nearest - either way at an exact .5 tie, where float and double rounding may differ
+		double maxError = 0.0;
+
+		for (size_t m = 1; m < mips.size(); m++)
+			for (size_t i = 0; i < mips[m].size(); i++)
+				maxError = max(maxError, fabs((double)mips[m][i] - reference[m][i]));
+
+		CGD_CHECK(maxError <= 0.5 + 1e-3);
+	}
+}
+
+
+CGD_TEST(MipChain, KaiserFilterPreservesSmoothContent) {
+
+	// constant images stay constant
+	vector<uint8_t> constant(37 * 21 * 4);
+
+	for (size_t i = 0; i < constant.size(); i++)
+		constant[i] = (uint8_t)(50 + 40 * (i % 4));
+
+	gu_mip_options options;
+	vector<vector<uint8_t> > mips;
+
+	gu_mip_generate(37, 21, constant.data(), options, mips);
+
+	for (size_t m = 1; m < mips.size(); m++)
+		for (size_t i = 0; i < mips[m].size(); i++)
+			CGD_CHECK(mips[m][i] == constant[i % 4]);
+
+	// a linear ramp is reproduced away from the clamped edges - the filter is symmetric and its weights sum to 1
+	vector<uint8_t> ramp(64 * 64 * 4, 255);
+
+	for (uint32_t y = 0; y < 64; y++)
+		for (uint32_t x = 0; x < 64; x++)
+			ramp[(y * 64 + x) * 4] = ramp[(y * 64 + x) * 4 + 1] = ramp[(y * 64 + x) * 4 + 2] = (uint8_t)(x * 4);
+
+	options.content = gu_mip_linear;
+	gu_mip_generate(64, 64, ramp.data(), options, mips);
+
+	for (uint32_t y = 0; y < 32; y++)
+		for (uint32_t x = 4; x < 28; x++)
+			CGD_CHECK(abs((int)mips[1][(y * 32 + x) * 4] - (int)(x * 8 + 2)) <= 1);
+}
+
+
+CGD_TEST(MipChain, FiltersColourInLinearSpace) {
+
+	// black and white texels average to linear 0.5, which is sRGB 188 - not 128
+	vector<uint8_t> checker(2 * 2 * 4, 255);
+
+	for (int c = 0; c < 3; c++)
+		checker[c] = checker[12 + c] = 0;
+
+	gu_mip_options options;
+	vector<vector<uint8_t> > mips;
+
+	options.filter = gu_mip_box;
+	gu_mip_generate(2, 2, checker.data(), options, mips);
+
+	CGD_CHECK(mips[1][0] == 188);
+	CGD_CHECK(mips[1][3] == 255);
+
+	options.content = gu_mip_linear;
+	gu_mip_generate(2, 2, checker.data(), options, mips);
+
+	CGD_CHECK(mips[1][0] == 128);
+}
+
+
+CGD_TEST(MipChain, RenormalisesNormals) {
+
+	// random unit normals facing +z
+	vector<uint8_t> normals = noiseImage(64, 64, 3);
+
+	for (size_t i = 0; i < normals.size(); i += 4) {
+
+		double n[3] = { normals[i] / 127.5 - 1.0, normals[i + 1] / 127.5 - 1.0, 1.0 }, length = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+
+		for (int c = 0; c < 3; c++)
+			normals[i + c] = (uint8_t)floor((n[c] / length * 0.5 + 0.5) * 255.0 + 0.5);
+
+		normals[i + 3] = 255;
+	}
+
+	gu_mip_options options = gu_mip_default_options("Textures/NormalMap.png", 64, 64, normals.data());
+	vector<vector<uint8_t> > mips;
+
+	CGD_CHECK(options.content == gu_mip_normal);
+
+	gu_mip_generate(64, 64, normals.data(), options, mips);
+
+	double maxError = 0.0;
+
+	for (size_t m = 1; m < mips.size(); m++) {
+
+		for (size_t i = 0; i < mips[m].size(); i += 4) {
+
+			double n[3] = { mips[m][i] / 127.5 - 1.0, mips[m][i + 1] / 127.5 - 1.0, mips[m][i + 2] / 127.5 - 1.0 };
+
+			maxError = max(maxError, fabs(sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]) - 1.0));
+		}
+	}
+
+	// within the 8-bit quantisation of each component
+	CGD_CHECK(maxError < 0.015);
+}
+
+
+CGD_TEST(MipChain, PreservesAlphaTestCoverage) {
+
+	vector<uint8_t> blades = bladeImage(256);
+	gu_mip_options options = gu_mip_default_options("grassAlpha.tif", 256, 256, blades.data());
+	vector<vector<uint8_t> > preserved, plain;
+
+	CGD_CHECK(options.content == gu_mip_colour);
+	CGD_CHECK(options.alphaTestRef == 0.5f);
+
+	gu_mip_generate(256, 256, blades.data(), options, preserved);
+
+	options.alphaTestRef = 0.0f;
+	gu_mip_generate(256, 256, blades.data(), options, plain);
+
+	float coverage = gu_mip_alpha_coverage(256, 256, blades.data(), 0.5f);
+
+	CGD_CHECK(coverage > 0.05f);
+
+	// the blades vanish from the plain chain once they are narrower than a texel, while the preserved chain keeps their coverage down to 4x4
+	for (uint32_t m = 1; m <= 6; m++) {
+
+		uint32_t size = 256 >> m;
+
+		// small mips can only match to within a texel
+		CGD_CHECK_NEAR(gu_mip_alpha_coverage(size, size, preserved[m].data(), 0.5f), coverage, max(0.01, 1.0 / (size * size)));
+	}
+
+	CGD_CHECK(gu_mip_alpha_coverage(16, 16, plain[4].data(), 0.5f) < coverage * 0.5f);
+}
+
+
+CGD_TEST(MipChain, ChoosesOptionsFromContent) {
+
+	vector<uint8_t> grey(8 * 8 * 4, 100);
+
+	for (size_t i = 3; i < grey.size(); i += 4)
+		grey[i] = 255;
+
+	gu_mip_options options = gu_mip_default_options("heightmap.bmp", 8, 8, grey.data());
+
+	CGD_CHECK(options.content == gu_mip_linear);
+	CGD_CHECK(options.alphaTestRef == 0.0f);
+	CGD_CHECK(options.filter == gu_mip_kaiser);
+
+	grey[0] = 101;
+
+	CGD_CHECK(gu_mip_default_options("colour.bmp", 8, 8, grey.data()).content == gu_mip_colour);
+}
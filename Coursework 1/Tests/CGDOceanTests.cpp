@@ -0,0 +1,276 @@
+
+//
+// CGDOceanTests.cpp
+//
+
+// CGDOcean maps checked against a direct evaluation of the inverse transform of the initial spectrum, the SSE fast path against the double precision reference on the calling thread and the job system, the repeat period and the properties of the maps (real heights, unit normals and wrapping samples).
+
+#include <stdafx.h>
+#include <CGDOcean.h>
+#include <CGDJobSystem.h>
+#include "CGDTest.h"
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <vector>
+
+using namespace std;
+
+
+namespace {
+
+	const double	pi = 3.14159265358979323846;
+
+	// Ocean with Scene's settings at the given resolution
+	CGDOcean* createOcean(uint32_t resolution, CGDJobSystem *jobSystem = nullptr, uint32_t seed = 1) {
+
+		CGDOceanDesc desc;
+
+		desc.resolution = resolution;
+		desc.seed = seed;
+
+		return CGDOcean::CreateOcean(desc, jobSystem);
+	}
+
+	// Copy of a map (4 floats per texel)
+	vector<float> copyMap(const CGDOcean *ocean, const float *map) {
+
+		return vector<float>(map, map + (size_t)ocean->getResolution() * ocean->getResolution() * 4);
+	}
+
+	// Largest difference between two maps relative to the largest value of the second
+	double relativeDifference(const vector<float>& a, const vector<float>& b) {
+
+		double difference = 0.0, largest = 0.0;
+
+		for (size_t i = 0; i < a.size(); i++) {
+
+			difference = max(difference, fabs((double)a[i] - (double)b[i]));
+			largest = max(largest, fabs((double)b[i]));
+		}
+
+		return difference / max(largest, 1e-12);
+	}
+}
+
+
+CGD_TEST(Ocean, RejectsInvalidDescriptions) {
+
+	const uint32_t invalid[4] = { 8, 48, 1024, 0 };
+
+	for (uint32_t resolution : invalid)
+		CGD_CHECK(!createOcean(resolution));
+
+	CGDOceanDesc desc;
+
+	desc.patchSize = 0.0f;
+	CGD_CHECK(!CGDOcean::CreateOcean(desc));
+
+	desc.patchSize = 64.0f;
+	desc.repeatPeriod = -1.0f;
+	CGD_CHECK(!CGDOcean::CreateOcean(desc));
+
+	CGDOcean *ocean = createOcean(16);
+
+	CGD_CHECK(ocean && ocean->getResolution() == 16);
+
+	if (ocean)
+		ocean->release();
+}
+
+
+CGD_TEST(Ocean, HeightIsTheInverseTransformOfTheSpectrum) {
+
+	const uint32_t size = 16;
+	CGDOcean *ocean = createOcean(size);
+	CGD_REQUIRE(ocean);
+
+	// At time 0 h(k) = h0(k) + conj(h0(-k)), so the height at texel (m, n) is the sum over k of h(k) exp(2 pi i (j m + i n) / size) and has no imaginary part
+	const float *spectrum = ocean->getInitialSpectrum();
+	vector<float> height(size * size);
+	double largest = 0.0, imaginary = 0.0;
+
+	for (uint32_t n = 0; n < size; n++) {
+
+		for (uint32_t m = 0; m < size; m++) {
+
+			complex<double> sum(0.0, 0.0);
+
+			for (uint32_t i = 0; i < size; i++) {
+
+				for (uint32_t j = 0; j < size; j++) {
+
+					const float *e = &spectrum[(i * size + j) * 4];
+					complex<double> h(e[0] + e[2], e[1] + e[3]);
+
+					sum += h * polar(1.0, 2.0 * pi * (double)((j * m + i * n) % size) / (double)size);
+				}
+			}
+
+			height[n * size + m] = (float)sum.real();
+			largest = max(largest, fabs(sum.real()));
+			imaginary = max(imaginary, fabs(sum.imag()));
+		}
+	}
+
+	CGD_CHECK(largest > 0.0);
+	CGD_CHECK(imaginary <= largest * 1e-5);
+
+	for (int path = 0; path < 2; path++) {
+
+		if (path == 0)
+			ocean->updateReference(0.0);
+		else
+			ocean->update(0.0, false);
+
+		const float *displacement = ocean->getDisplacementMap();
+		double error = 0.0;
+
+		for (uint32_t t = 0; t < size * size; t++)
+			error = max(error, fabs((double)displacement[t * 4 + 1] - (double)height[t]));
+
+		CGD_CHECK(error <= largest * 1e-4);
+	}
+
+	ocean->release();
+}
+
+
+CGD_TEST(Ocean, FastPathMatchesReference) {
+
+	const uint32_t resolutions[3] = { 16, 64, 256 };
+	const double times[4] = { 0.0, 1.0 / 60.0, 37.3, 123456.789 };
+
+	for (uint32_t resolution : resolutions) {
+
+		CGDOcean *ocean = createOcean(resolution);
+		CGD_REQUIRE(ocean);
+
+		for (double time : times) {
+
+			ocean->updateReference(time);
+
+			vector<float> displacement = copyMap(ocean, ocean->getDisplacementMap());
+			vector<float> normal = copyMap(ocean, ocean->getNormalMap());
+
+			ocean->update(time, false);
+
+			CGD_CHECK(ocean->getTime() == time);
+			CGD_CHECK(relativeDifference(copyMap(ocean, ocean->getDisplacementMap()), displacement) <= 1e-3);
+			CGD_CHECK(relativeDifference(copyMap(ocean, ocean->getNormalMap()), normal) <= 1e-3);
+		}
+
+		ocean->release();
+	}
+}
+
+
+CGD_TEST(Ocean, SameMapsOnAnyThreadCount) {
+
+	CGDJobSystem *jobSystem = CGDJobSystem::CreateJobSystem(3);
+	CGD_REQUIRE(jobSystem);
+
+	CGDOcean *serial = createOcean(128);
+	CGDOcean *parallel = createOcean(128, jobSystem);
+
+	for (int i = 0; i < 3; i++) {
+
+		double time = 2.5 * (double)i;
+
+		serial->update(time, false);
+		parallel->update(time, true);
+
+		CGD_CHECK(copyMap(serial, serial->getDisplacementMap()) == copyMap(parallel, parallel->getDisplacementMap()));
+		CGD_CHECK(copyMap(serial, serial->getNormalMap()) == copyMap(parallel, parallel->getNormalMap()));
+	}
+
+	// the same seed draws the same spectrum and another seed a different one
+	CGDOcean *reseeded = createOcean(128, nullptr, 2);
+	vector<float> spectrum(serial->getInitialSpectrum(), serial->getInitialSpectrum() + 128 * 128 * 4);
+
+	CGD_CHECK(spectrum == vector<float>(parallel->getInitialSpectrum(), parallel->getInitialSpectrum() + 128 * 128 * 4));
+	CGD_CHECK(spectrum != vector<float>(reseeded->getInitialSpectrum(), reseeded->getInitialSpectrum() + 128 * 128 * 4));
+
+	reseeded->release();
+	serial->release();
+	parallel->release();
+	jobSystem->release();
+}
+
+
+CGD_TEST(Ocean, LoopsOverTheRepeatPeriod) {
+
+	CGDOcean *ocean = createOcean(64);
+	CGD_REQUIRE(ocean);
+
+	double period = (double)ocean->getDesc().repeatPeriod;
+
+	CGD_CHECK_NEAR(ocean->getPeriodFraction(period * 2.25), 0.25, 1e-12);
+	CGD_CHECK_NEAR(ocean->getFrequencyQuantum(), 2.0 * pi / period, 1e-6);
+
+	ocean->updateReference(12.0);
+	vector<float> first = copyMap(ocean, ocean->getDisplacementMap());
+
+	ocean->updateReference(12.0 + period * 3.0);
+	CGD_CHECK(relativeDifference(copyMap(ocean, ocean->getDisplacementMap()), first) <= 1e-6);
+
+	// and the surface moves within the period
+	ocean->updateReference(13.0);
+	CGD_CHECK(relativeDifference(copyMap(ocean, ocean->getDisplacementMap()), first) > 1e-2);
+
+	ocean->release();
+}
+
+
+CGD_TEST(Ocean, SamplesWrapAcrossPatches) {
+
+	CGDOcean *ocean = createOcean(64);
+	CGD_REQUIRE(ocean);
+
+	ocean->update(5.0, false);
+
+	const float *displacementMap = ocean->getDisplacementMap();
+	const float *normalMap = ocean->getNormalMap();
+	float patch = ocean->getDesc().patchSize;
+
+	// normals are unit length and face up
+	for (uint32_t t = 0; t < 64 * 64; t++) {
+
+		const float *n = &normalMap[t * 4];
+
+		CGD_CHECK_NEAR(sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]), 1.0f, 1e-5);
+		CGD_CHECK(n[1] > 0.0f);
+	}
+
+	// texel (x, z) is sampled at (x, z) * patchSize / resolution, in this and every other patch
+	const uint32_t texels[3][2] = { { 0, 0 }, { 5, 17 }, { 63, 40 } };
+
+	for (int i = 0; i < 3; i++) {
+
+		float x = (float)texels[i][0] * patch / 64.0f, z = (float)texels[i][1] * patch / 64.0f;
+		const float *expected = &displacementMap[(texels[i][1] * 64 + texels[i][0]) * 4];
+		float displacement[3], normal[3], wrapped[3], wrappedNormal[3];
+
+		ocean->sample(x, z, displacement, normal);
+		ocean->sample(x + patch * 3.0f, z - patch, wrapped, wrappedNormal);
+
+		for (int c = 0; c < 3; c++) {
+
+			CGD_CHECK_NEAR(displacement[c], expected[c], 1e-5);
+			CGD_CHECK_NEAR(wrapped[c], displacement[c], 1e-4);
+			CGD_CHECK_NEAR(wrappedNormal[c], normal[c], 1e-4);
+		}
+	}
+
+	// between texels the sample is the bilinear blend of its neighbours
+	float displacement[3], normal[3];
+
+	ocean->sample(patch * 10.5f / 64.0f, patch * 20.0f / 64.0f, displacement, normal);
+
+	for (int c = 0; c < 3; c++)
+		CGD_CHECK_NEAR(displacement[c], (displacementMap[(20 * 64 + 10) * 4 + c] + displacementMap[(20 * 64 + 11) * 4 + c]) * 0.5f, 1e-5);
+
+	CGD_CHECK_NEAR(sqrtf(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]), 1.0f, 1e-5);
+
+	ocean->release();
+}
@@ -0,0 +1,353 @@
+
+//
+// CGDPassSchedulerTests.cpp
+//
+
+// CGDPassScheduler over the software command backend.  Passes record numbered commands and the submitted stream of each frame is compared with serial execution.
+
+#include <stdafx.h>
+#include <CGDPassScheduler.h>
+#include <CGDJobSystem.h>
+#include <CGDGPUProfiler.h>
+#include "CGDSoftwareCommandBackend.h"
+#include "CGDFakeGPUTimerBackend.h"
+#include "CGDTest.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+using namespace std;
+
+
+namespace {
+
+	const uint32_t		commandsPerPass = 5;
+
+	// Command k of pass
+	uint32_t command(uint32_t pass, uint32_t k) {
+
+		return pass * 100 + k;
+	}
+
+	// Scene-like frame: six independent cube map faces, an immediate mip generation pass that depends on all of them and the main pass, added first, which depends on the mips
+	struct ScenePasses {
+
+		uint32_t			main;
+		uint32_t			faces[6];
+		uint32_t			mips;
+
+		// Recording state checked by the tests
+		atomic<uint64_t>	badContextIndices;
+		atomic<uint64_t>	immediateOffMainThread;
+		thread::id			mainThread;
+
+		ScenePasses() : badContextIndices(0), immediateOffMainThread(0), mainThread(this_thread::get_id()) {}
+
+		void add(CGDPassScheduler *scheduler, CGDSoftwareCommandBackend *backend, bool jitter) {
+
+			static const char *faceNames[6] = { "face0", "face1", "face2", "face3", "face4", "face5" };
+
+			main = addDeferred(scheduler, backend, "main", 0, jitter);
+
+			for (uint32_t i = 0; i < 6; i++)
+				faces[i] = addDeferred(scheduler, backend, faceNames[i], 1 + i, jitter);
+
+			mips = scheduler->addPass("mips", [this](void *context, uint32_t contextIndex) {
+
+				if (contextIndex != CGD_IMMEDIATE_CONTEXT)
+					badContextIndices++;
+
+				if (this_thread::get_id() != mainThread)
+					immediateOffMainThread++;
+
+				CGDSoftwareCommandBackend::Record(context, command(7, 0));
+
+			}, false);
+
+			for (uint32_t i = 0; i < 6; i++)
+				scheduler->addDependency(mips, faces[i]);
+
+			scheduler->addDependency(main, mips);
+		}
+
+		uint32_t addDeferred(CGDPassScheduler *scheduler, CGDSoftwareCommandBackend *backend, const char *name, uint32_t id, bool jitter) {
+
+			uint32_t numContexts = backend->recordingContextCount();
+
+			return scheduler->addPass(name, [this, id, jitter, numContexts](void *context, uint32_t contextIndex) {
+
+				if (contextIndex != CGD_IMMEDIATE_CONTEXT && contextIndex >= numContexts)
+					badContextIndices++;
+
+				for (uint32_t k = 0; k < commandsPerPass; k++) {
+
+					// vary recording time so passes finish out of order
+					if (jitter)
+						this_thread::sleep_for(chrono::microseconds(((id * 7 + k * 13) % 5) * 50));
+
+					CGDSoftwareCommandBackend::Record(context, command(id, k));
+				}
+			});
+		}
+	};
+
+	// Submitted stream the scene frame must produce: faces 0-5, mips, main
+	vector<uint32_t> expectedSceneStream() {
+
+		vector<uint32_t> stream;
+
+		for (uint32_t id = 1; id <= 6; id++)
+			for (uint32_t k = 0; k < commandsPerPass; k++)
+				stream.push_back(command(id, k));
+
+		stream.push_back(command(7, 0));
+
+		for (uint32_t k = 0; k < commandsPerPass; k++)
+			stream.push_back(command(0, k));
+
+		return stream;
+	}
+}
+
+
+CGD_TEST(PassScheduler, RejectsInvalidArguments) {
+
+	CGD_CHECK(CGDPassScheduler::CreatePassScheduler(nullptr, nullptr) == nullptr);
+
+	CGDSoftwareCommandBackend *backend = CGDSoftwareCommandBackend::CreateSoftwareCommandBackend(2);
+	CGDPassScheduler *scheduler = CGDPassScheduler::CreatePassScheduler(backend, nullptr);
+	CGD_REQUIRE(scheduler);
+
+	uint32_t a = scheduler->addPass("a", [](void*, uint32_t) {});
+
+	CGD_CHECK(scheduler->passCount() == 1);
+	CGD_CHECK(!scheduler->addDependency(a, a));
+	CGD_CHECK(!scheduler->addDependency(a, 1));
+	CGD_CHECK(!scheduler->addDependency(1, a));
+
+	// no job system - serial
+	CGD_CHECK(!scheduler->isParallel());
+
+	scheduler->release();
+	backend->release();
+}
+
+
+CGD_TEST(PassScheduler, OrdersPassesStably) {
+
+	CGDSoftwareCommandBackend *backend = CGDSoftwareCommandBackend::CreateSoftwareCommandBackend(0);
+	CGDPassScheduler *scheduler = CGDPassScheduler::CreatePassScheduler(backend, nullptr);
+	CGD_REQUIRE(scheduler);
+
+	ScenePasses scene;
+	scene.add(scheduler, backend, false);
+
+	// ties are broken by the order passes were added
+	const vector<uint32_t>& order = scheduler->getExecutionOrder();
+	uint32_t expected[8] = { 1, 2, 3, 4, 5, 6, 7, 0 };
+
+	CGD_REQUIRE(order.size() == 8);
+
+	for (int i = 0; i < 8; i++)
+		CGD_CHECK(order[i] == expected[i]);
+
+	// passes on a cycle run last, in the order they were added
+	uint32_t c0 = scheduler->addPass("cycle0", [](void*, uint32_t) {});
+	uint32_t c1 = scheduler->addPass("cycle1", [](void*, uint32_t) {});
+	uint32_t after = scheduler->addPass("after", [](void*, uint32_t) {});
+
+	scheduler->addDependency(c0, c1);
+	scheduler->addDependency(c1, c0);
+	scheduler->addDependency(scene.faces[0], after);
+
+	const vector<uint32_t>& cyclic = scheduler->getExecutionOrder();
+	uint32_t expectedCyclic[11] = { 2, 3, 4, 5, 6, 10, 1, 7, 0, 8, 9 };
+
+	CGD_REQUIRE(cyclic.size() == 11);
+
+	for (int i = 0; i < 11; i++)
+		CGD_CHECK(cyclic[i] == expectedCyclic[i]);
+
+	scheduler->release();
+	backend->release();
+}
+
+
+CGD_TEST(PassScheduler, SerialFallbackUsesImmediateContext) {
+
+	CGDJobSystem *jobSystem = CGDJobSystem::CreateJobSystem(2);
+	CGD_REQUIRE(jobSystem);
+
+	vector<uint32_t> expected = expectedSceneStream();
+
+	// no recording contexts, no job system and parallel recording disabled all fall back to the immediate context
+	for (int mode = 0; mode < 3; mode++) {
+
+		CGDSoftwareCommandBackend *backend = CGDSoftwareCommandBackend::CreateSoftwareCommandBackend(mode == 0 ? 0 : 3);
+		CGDPassScheduler *scheduler = CGDPassScheduler::CreatePassScheduler(backend, mode == 1 ? nullptr : jobSystem);
+
+		if (mode == 2)
+			scheduler->setParallel(false);
+
+		ScenePasses scene;
+		scene.add(scheduler, backend, false);
+
+		CGD_CHECK(!scheduler->isParallel());
+
+		for (int frame = 0; frame < 3; frame++) {
+
+			backend->clearSubmitted();
+			scheduler->execute();
+
+			CGD_CHECK(backend->submitted() == expected);
+		}
+
+		// every pass was given the immediate context
+		CGD_CHECK(backend->finishedCommandListCount() == 0);
+		CGD_CHECK(scene.badContextIndices == 0);
+
+		scheduler->release();
+		backend->release();
+	}
+
+	jobSystem->release();
+}
+
+
+CGD_TEST(PassScheduler, ParallelRecordingIsDeterministic) {
+
+	vector<uint32_t> expected = expectedSceneStream();
+
+	uint32_t workerCounts[2] = { 1, 3 };
+	uint32_t contextCounts[3] = { 1, 2, 7 };
+
+	for (int w = 0; w < 2; w++) {
+
+		CGDJobSystem *jobSystem = CGDJobSystem::CreateJobSystem(workerCounts[w]);
+		CGD_REQUIRE(jobSystem);
+
+		for (int c = 0; c < 3; c++) {
+
+			CGDSoftwareCommandBackend *backend = CGDSoftwareCommandBackend::CreateSoftwareCommandBackend(contextCounts[c]);
+			CGDPassScheduler *scheduler = CGDPassScheduler::CreatePassScheduler(backend, jobSystem);
+
+			ScenePasses scene;
+			scene.add(scheduler, backend, true);
+
+			CGD_CHECK(scheduler->isParallel());
+
+			uint32_t mismatches = 0;
+
+			for (int frame = 0; frame < 10; frame++) {
+
+				backend->clearSubmitted();
+				scheduler->execute();
+
+				if (backend->submitted() != expected)
+					mismatches++;
+
+				CGD_CHECK(backend->liveCommandListCount() == 0);
+			}
+
+			CGD_CHECK(mismatches == 0);
+
+			// one command list per deferred pass per frame, each context recorded by one thread at a time and the immediate context only used on the main thread
+			CGD_CHECK(backend->finishedCommandListCount() == 7 * 10);
+			CGD_CHECK(backend->overlappingRecordCount() == 0);
+			CGD_CHECK(backend->wrongThreadCallCount() == 0);
+			CGD_CHECK(scene.badContextIndices == 0);
+			CGD_CHECK(scene.immediateOffMainThread == 0);
+
+			scheduler->release();
+			backend->release();
+		}
+
+		jobSystem->release();
+	}
+}
+
+
+CGD_TEST(PassScheduler, SkipsPassesThatFailToRecord) {
+
+	CGDJobSystem *jobSystem = CGDJobSystem::CreateJobSystem(2);
+	CGDSoftwareCommandBackend *backend = CGDSoftwareCommandBackend::CreateSoftwareCommandBackend(1);
+	CGDPassScheduler *scheduler = CGDPassScheduler::CreatePassScheduler(backend, jobSystem);
+	CGD_REQUIRE(jobSystem && scheduler);
+
+	ScenePasses scene;
+	scene.add(scheduler, backend, false);
+
+	// a single context records the deferred passes in execution order, so the second and fourth lists (faces 1 and 3) fail
+	backend->setFailEvery(2);
+	backend->clearSubmitted();
+	scheduler->execute();
+	backend->setFailEvery(0);
+
+	vector<uint32_t> expected;
+
+	for (uint32_t id : { 1, 3, 5 })
+		for (uint32_t k = 0; k < commandsPerPass; k++)
+			expected.push_back(command(id, k));
+
+	expected.push_back(command(7, 0));
+
+	for (uint32_t k = 0; k < commandsPerPass; k++)
+		expected.push_back(command(0, k));
+
+	CGD_CHECK(backend->submitted() == expected);
+	CGD_CHECK(backend->liveCommandListCount() == 0);
+
+	// the next frame is complete
+	backend->clearSubmitted();
+	scheduler->execute();
+
+	CGD_CHECK(backend->submitted() == expectedSceneStream());
+
+	scheduler->release();
+	backend->release();
+	jobSystem->release();
+}
+
+
+CGD_TEST(PassScheduler, TimesPassesOnTheGPU) {
+
+	CGDJobSystem *jobSystem = CGDJobSystem::CreateJobSystem(2);
+	CGDSoftwareCommandBackend *backend = CGDSoftwareCommandBackend::CreateSoftwareCommandBackend(2);
+	CGDFakeGPUTimerBackend *timerBackend = CGDFakeGPUTimerBackend::CreateFakeGPUTimerBackend(3, 32, 1);
+	CGDGPUProfiler *profiler = CGDGPUProfiler::CreateGPUProfiler(timerBackend);
+	CGDPassScheduler *scheduler = CGDPassScheduler::CreatePassScheduler(backend, jobSystem);
+	CGD_REQUIRE(jobSystem && profiler && scheduler);
+
+	ScenePasses scene;
+	scene.add(scheduler, backend, false);
+
+	scheduler->setGPUProfiler(profiler);
+
+	for (int frame = 0; frame < 4; frame++) {
+
+		profiler->beginFrame();
+		scheduler->execute();
+		profiler->endFrame();
+		timerBackend->present();
+	}
+
+	// results lag one present so frames 0..2 have been read back
+	const char *names[8] = { "main", "face0", "face1", "face2", "face3", "face4", "face5", "mips" };
+
+	for (int i = 0; i < 8; i++) {
+
+		const CGDGPUPassStats *stats = profiler->passStats(names[i]);
+
+		CGD_CHECK(stats && stats->samples == 3 && stats->depth == 0);
+	}
+
+	CGD_CHECK(timerBackend->protocolErrorCount() == 0);
+
+	scheduler->setGPUProfiler(nullptr);
+
+	scheduler->release();
+	profiler->release();
+	timerBackend->release();
+	backend->release();
+	jobSystem->release();
+}
@@ -0,0 +1,271 @@
+
+//
+// CGDPipelineCacheTests.cpp
+//
+
+#include <stdafx.h>
+#include <CGDPipelineCache.h>
+#include "CGDStubPipelineDevice.h"
+#include "CGDTest.h"
+#include <cstring>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+
+namespace {
+
+	struct RasterizerDesc {
+
+		int			fillMode;
+		int			cullMode;
+		int			depthBias;
+	};
+
+	// Build a minimal DXBC container holding the given chunks (FourCC + data)
+	vector<uint8_t> dxbcContainer(const vector<pair<string, string> >& chunks) {
+
+		vector<uint8_t> data(32 + chunks.size() * 4, 0);
+		memcpy(data.data(), "DXBC", 4);
+
+		uint32_t numChunks = (uint32_t)chunks.size();
+		memcpy(data.data() + 28, &numChunks, 4);
+
+		for (size_t i = 0; i < chunks.size(); i++) {
+
+			uint32_t offset = (uint32_t)data.size(), size = (uint32_t)chunks[i].second.size();
+
+			memcpy(data.data() + 32 + i * 4, &offset, 4);
+
+			data.insert(data.end(), chunks[i].first.begin(), chunks[i].first.begin() + 4);
+			data.insert(data.end(), (uint8_t*)&size, (uint8_t*)&size + 4);
+			data.insert(data.end(), chunks[i].second.begin(), chunks[i].second.end());
+		}
+
+		uint32_t total = (uint32_t)data.size();
+		memcpy(data.data() + 24, &total, 4);
+
+		return data;
+	}
+
+	bool writeFile(const string& path, const vector<uint8_t>& data) {
+
+		ofstream file(path, ios::binary);
+		file.write((const char*)data.data(), data.size());
+
+		return file.good();
+	}
+}
+
+
+CGD_TEST(PipelineCache, SharesObjectsWithEqualKeys) {
+
+	CGD_CHECK(CGDPipelineCache::CreatePipelineCache(nullptr) == nullptr);
+
+	CGDStubPipelineDevice *device = CGDStubPipelineDevice::CreateStubPipelineDevice();
+	CGDPipelineCache *cache = CGDPipelineCache::CreatePipelineCache(device);
+	CGD_REQUIRE(cache);
+
+	RasterizerDesc solid = { 3, 3, 0 }, wire = { 2, 1, 0 }, solidCopy = solid;
+
+	void *a = cache->acquireObject(CGDPipelineObjectType::RASTERIZER_STATE, &solid, sizeof(solid), &solid, nullptr);
+	void *b = cache->acquireObject(CGDPipelineObjectType::RASTERIZER_STATE, &solidCopy, sizeof(solidCopy), &solidCopy, nullptr);
+	void *c = cache->acquireObject(CGDPipelineObjectType::RASTERIZER_STATE, &wire, sizeof(wire), &wire, nullptr);
+
+	// the same key of a different type is a different object
+	void *d = cache->acquireObject(CGDPipelineObjectType::BLEND_STATE, &solid, sizeof(solid), &solid, nullptr);
+
+	CGD_REQUIRE(a && b && c && d);
+	CGD_CHECK(a == b && a != c && a != d);
+	CGD_CHECK(device->createdCount(CGDPipelineObjectType::RASTERIZER_STATE) == 2);
+	CGD_CHECK(device->createdCount(CGDPipelineObjectType::BLEND_STATE) == 1);
+
+	// the cache holds one reference and each caller one
+	CGD_CHECK(device->refCount(a) == 3);
+	CGD_CHECK(device->refCount(c) == 2);
+
+	CGDPipelineCacheStats stats = cache->getObjectStats(CGDPipelineObjectType::RASTERIZER_STATE);
+	CGD_CHECK(stats.hits == 1 && stats.misses == 2 && stats.failures == 0 && stats.objects == 2);
+
+	device->releaseObject(a);
+	device->releaseObject(b);
+	device->releaseObject(c);
+	device->releaseObject(d);
+
+	CGD_CHECK(device->liveObjectCount() == 3);
+
+	cache->release();
+
+	CGD_CHECK(device->liveObjectCount() == 0);
+	CGD_CHECK(device->invalidReferenceCount() == 0);
+
+	device->release();
+}
+
+
+CGD_TEST(PipelineCache, FailedCreationIsNotCached) {
+
+	CGDStubPipelineDevice *device = CGDStubPipelineDevice::CreateStubPipelineDevice();
+	CGDPipelineCache *cache = CGDPipelineCache::CreatePipelineCache(device);
+	CGD_REQUIRE(cache);
+
+	int sampler[4] = { 1, 2, 3, 4 };
+
+	device->setFailing(CGDPipelineObjectType::SAMPLER_STATE, true);
+	CGD_CHECK(cache->acquireObject(CGDPipelineObjectType::SAMPLER_STATE, sampler, sizeof(sampler), sampler, nullptr) == nullptr);
+
+	CGDPipelineCacheStats stats = cache->getObjectStats(CGDPipelineObjectType::SAMPLER_STATE);
+	CGD_CHECK(stats.misses == 1 && stats.failures == 1 && stats.objects == 0);
+
+	// creation is retried once the device succeeds
+	device->setFailing(CGDPipelineObjectType::SAMPLER_STATE, false);
+	void *s = cache->acquireObject(CGDPipelineObjectType::SAMPLER_STATE, sampler, sizeof(sampler), sampler, nullptr);
+	CGD_CHECK(s != nullptr);
+
+	stats = cache->getObjectStats(CGDPipelineObjectType::SAMPLER_STATE);
+	CGD_CHECK(stats.misses == 2 && stats.failures == 1 && stats.objects == 1);
+
+	// invalid arguments
+	CGD_CHECK(cache->acquireObject(CGDPipelineObjectType::NUM_TYPES, sampler, sizeof(sampler), sampler, nullptr) == nullptr);
+	CGD_CHECK(cache->acquireObject(CGDPipelineObjectType::SAMPLER_STATE, nullptr, 0, sampler, nullptr) == nullptr);
+
+	device->releaseObject(s);
+	cache->release();
+
+	CGD_CHECK(device->liveObjectCount() == 0);
+	device->release();
+}
+
+
+CGD_TEST(PipelineCache, PurgeKeepsObjectsHeldElsewhere) {
+
+	CGDStubPipelineDevice *device = CGDStubPipelineDevice::CreateStubPipelineDevice();
+	CGDPipelineCache *cache = CGDPipelineCache::CreatePipelineCache(device);
+	CGD_REQUIRE(cache);
+
+	int depth[2] = { 1, 0 }, blend[2] = { 0, 1 };
+
+	void *held = cache->acquireObject(CGDPipelineObjectType::DEPTH_STENCIL_STATE, depth, sizeof(depth), depth, nullptr);
+	void *dropped = cache->acquireObject(CGDPipelineObjectType::BLEND_STATE, blend, sizeof(blend), blend, nullptr);
+
+	device->releaseObject(dropped);
+	cache->purgeObjects();
+
+	CGD_CHECK(device->isLive(held) && device->refCount(held) == 1);
+	CGD_CHECK(!device->isLive(dropped));
+	CGD_CHECK(cache->getObjectStats(CGDPipelineObjectType::DEPTH_STENCIL_STATE).objects == 0);
+
+	// a purged key creates a new object
+	void *again = cache->acquireObject(CGDPipelineObjectType::DEPTH_STENCIL_STATE, depth, sizeof(depth), depth, nullptr);
+	CGD_CHECK(again != held);
+	CGD_CHECK(device->createdCount(CGDPipelineObjectType::DEPTH_STENCIL_STATE) == 2);
+
+	device->releaseObject(held);
+	device->releaseObject(again);
+	cache->release();
+
+	CGD_CHECK(device->liveObjectCount() == 0);
+	CGD_CHECK(device->invalidReferenceCount() == 0);
+
+	device->release();
+}
+
+
+CGD_TEST(PipelineCache, BytecodeIsSharedByPathAndContent) {
+
+	CGDStubPipelineDevice *device = CGDStubPipelineDevice::CreateStubPipelineDevice();
+	CGDPipelineCache *cache = CGDPipelineCache::CreatePipelineCache(device);
+	CGD_REQUIRE(cache);
+
+	vector<pair<string, string> > chunks;
+	chunks.push_back(make_pair(string("ISGN"), string("position/normal/texcoord")));
+	chunks.push_back(make_pair(string("SHEX"), string("vertex shader A")));
+
+	vector<uint8_t> shaderA = dxbcContainer(chunks);
+
+	chunks[1].second = "vertex shader B";
+	vector<uint8_t> shaderB = dxbcContainer(chunks);
+
+	CGD_REQUIRE(writeFile("CGDPipelineCacheTests_a.cso", shaderA));
+	CGD_REQUIRE(writeFile("CGDPipelineCacheTests_copy_of_a.cso", shaderA));
+	CGD_REQUIRE(writeFile("CGDPipelineCacheTests_b.cso", shaderB));
+
+	const CGDShaderBytecode *a = cache->loadBytecode("CGDPipelineCacheTests_a.cso");
+	const CGDShaderBytecode *a2 = cache->loadBytecode("./CGDPipelineCacheTests_a.cso");
+	const CGDShaderBytecode *aAgain = cache->loadBytecode("CGDPipelineCacheTests_a.cso");
+	const CGDShaderBytecode *copy = cache->loadBytecode("CGDPipelineCacheTests_copy_of_a.cso");
+	const CGDShaderBytecode *b = cache->loadBytecode("CGDPipelineCacheTests_b.cso");
+
+	CGD_REQUIRE(a && a2 && copy && b);
+
+	CGD_CHECK(aAgain == a);
+	CGD_CHECK(a2 == a && copy == a); // identical content shares one mapping
+	CGD_CHECK(b != a);
+	CGD_CHECK(a->size == shaderA.size() && memcmp(a->data, shaderA.data(), a->size) == 0);
+
+	// both shaders have the same input signature so can share an input layout
+	CGD_CHECK(a->inputSignatureHash == b->inputSignatureHash && a->hash != b->hash);
+
+	CGD_CHECK(cache->loadBytecode("CGDPipelineCacheTests_missing.cso") == nullptr);
+	CGD_CHECK(cache->loadBytecode(nullptr) == nullptr);
+
+	CGDPipelineCacheStats stats = cache->getBytecodeStats();
+	CGD_CHECK(stats.hits == 1 && stats.misses == 5 && stats.failures == 1 && stats.objects == 2);
+	CGD_CHECK(cache->getBytecodeContentHits() == 2);
+	CGD_CHECK(cache->getBytesMapped() == shaderA.size() + shaderB.size());
+
+	cache->release();
+	device->release();
+
+	remove("CGDPipelineCacheTests_a.cso");
+	remove("CGDPipelineCacheTests_copy_of_a.cso");
+	remove("CGDPipelineCacheTests_b.cso");
+}
+
+
+CGD_TEST(PipelineCache, InputSignatureHash) {
+
+	vector<pair<string, string> > chunks;
+	chunks.push_back(make_pair(string("RDEF"), string("resources")));
+	chunks.push_back(make_pair(string("ISG1"), string("signature")));
+
+	vector<uint8_t> container = dxbcContainer(chunks);
+	uint64_t h = CGDPipelineCache::InputSignatureHash(container.data(), container.size());
+
+	CGD_CHECK(h != 0);
+	CGD_CHECK(h == CGDPipelineCache::Hash(container.data() + container.size() - 8 - 9, 8 + 9));
+
+	// no input signature, not DXBC, truncated or corrupt chunk tables
+	chunks[1].first = "OSGN";
+	vector<uint8_t> noSignature = dxbcContainer(chunks);
+
+	CGD_CHECK(CGDPipelineCache::InputSignatureHash(noSignature.data(), noSignature.size()) == 0);
+	CGD_CHECK(CGDPipelineCache::InputSignatureHash("garbage", 7) == 0);
+	CGD_CHECK(CGDPipelineCache::InputSignatureHash(container.data(), 31) == 0);
+
+	vector<uint8_t> corrupt = container;
+	uint32_t badCount = 0x7fffffff, badOffset = 0xfffffff0;
+	memcpy(corrupt.data() + 28, &badCount, 4);
+	CGD_CHECK(CGDPipelineCache::InputSignatureHash(corrupt.data(), corrupt.size()) == 0);
+
+	corrupt = container;
+	memcpy(corrupt.data() + 32, &badOffset, 4);
+	memcpy(corrupt.data() + 36, &badOffset, 4);
+	CGD_CHECK(CGDPipelineCache::InputSignatureHash(corrupt.data(), corrupt.size()) == 0);
+
+	// shaders compiled from the project (Debug/Shaders/cso) carry an input signature
+	CGDStubPipelineDevice *device = CGDStubPipelineDevice::CreateStubPipelineDevice();
+	CGDPipelineCache *cache = CGDPipelineCache::CreatePipelineCache(device);
+
+	const CGDShaderBytecode *vs = cache->loadBytecode("Debug/Shaders/cso/basic_texture_vs.cso");
+
+	CGD_REQUIRE(vs);
+	CGD_CHECK(vs->inputSignatureHash != vs->hash);
+	CGD_CHECK(vs->inputSignatureHash == CGDPipelineCache::InputSignatureHash(vs->data, vs->size));
+
+	cache->release();
+	device->release();
+}
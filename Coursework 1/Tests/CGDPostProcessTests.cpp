@@ -0,0 +1,288 @@
+
+//
+// CGDPostProcessTests.cpp
+//
+
+// CGDPostProcess blur kernels, the SSE fast path against the scalar reference on the calling thread and the job system, and the effects themselves.  The reference images of each stage of a headless scene frame are compared with the golden images Tests/Golden/post_<stage>.png.  If a golden image is missing it is written and the test fails - check the new image and commit it.
+
+#include <stdafx.h>
+#include <CGDPostProcess.h>
+#include <CGDJobSystem.h>
+#include <HeadlessScene.h>
+#include <CGDSoftwareRasterizer.h>
+#include <GUImageDecoder.h>
+#include <GUPNGWriter.h>
+#include "CGDTest.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+
+namespace {
+
+	// Largest difference (8 bit levels) from a golden image accepted - rounding may differ between compilers and instruction sets
+	const int				goldenTolerance = 2;
+
+	// Scene with smooth gradients, a few bright (> 1) spots for bloom and depth rising from the top of the frame to the bottom
+	struct TestFrame {
+
+		CGDPostImage		scene;
+		vector<float>		depth;
+		uint32_t			depthStride;
+
+		TestFrame(uint32_t width, uint32_t height) : depthStride(width + 3) {
+
+			scene.resize(width, height);
+			depth.assign((size_t)depthStride * height, 0.0f);
+
+			for (uint32_t y = 0; y < height; y++) {
+
+				for (uint32_t x = 0; x < width; x++) {
+
+					float *t = &scene.texels[((size_t)y * width + x) * 4];
+
+					t[0] = (float)x / (float)width;
+					t[1] = (float)y / (float)height;
+					t[2] = 0.5f + 0.5f * sinf((float)(x + y) * 0.3f);
+					t[3] = 1.0f;
+
+					if ((x / 8 + y / 8) % 5 == 0)
+						t[0] = t[1] = t[2] = 3.0f;
+
+					depth[(size_t)y * depthStride + x] = 0.9f + 0.1f * (float)y / (float)height;
+				}
+			}
+		}
+	};
+
+	float maxDifference(const CGDPostImage& a, const CGDPostImage& b) {
+
+		if (a.width != b.width || a.height != b.height)
+			return 1e30f;
+
+		float difference = 0.0f;
+
+		for (size_t i = 0; i < a.texels.size(); i++)
+			difference = max(difference, fabsf(a.texels[i] - b.texels[i]));
+
+		return difference;
+	}
+}
+
+
+CGD_TEST(PostProcess, BuildsLinearSamplingKernels) {
+
+	const float sigmas[6] = { 0.5f, 1.0f, 2.0f, 3.0f, 7.3f, 12.0f };
+
+	for (float sigma : sigmas) {
+
+		CGDBlurKernel kernel = CGDCreateBlurKernel(sigma);
+		vector<float> discrete;
+
+		CGD_CHECK(kernel.radius == min((uint32_t)ceilf(3.0f * sigma), 2u * (CGD_MAX_BLUR_TAPS - 1)));
+		CGD_CHECK(kernel.numTaps == 1 + (kernel.radius + 1) / 2);
+		CGD_CHECK(kernel.numTaps <= CGD_MAX_BLUR_TAPS);
+
+		CGDGaussianWeights(sigma, kernel.radius, discrete);
+
+		// the discrete weights are normalised Gaussian values
+		double sum = discrete[0];
+
+		for (uint32_t i = 1; i <= kernel.radius; i++) {
+
+			sum += 2.0 * discrete[i];
+			CGD_CHECK_NEAR(discrete[i] / discrete[0], exp(-(double)(i * i) / (2.0 * sigma * sigma)), 1e-5);
+		}
+
+		CGD_CHECK_NEAR(sum, 1.0, 1e-5);
+
+		// each tap splits back into the weights of the two texels either side of its offset
+		vector<float> expanded(kernel.radius + 2, 0.0f);
+
+		CGD_CHECK(kernel.offsets[0] == 0.0f);
+		expanded[0] = kernel.weights[0];
+
+		for (uint32_t t = 1; t < kernel.numTaps; t++) {
+
+			uint32_t i = 2 * t - 1;
+			float f = kernel.offsets[t] - (float)i;
+
+			CGD_CHECK(f >= 0.0f && f <= 1.0f);
+
+			expanded[i] += kernel.weights[t] * (1.0f - f);
+			expanded[i + 1] += kernel.weights[t] * f;
+		}
+
+		for (uint32_t i = 0; i <= kernel.radius; i++)
+			CGD_CHECK_NEAR(expanded[i], discrete[i], 1e-6);
+	}
+
+	// no blur is the identity
+	CGDBlurKernel identity = CGDCreateBlurKernel(0.0f);
+
+	CGD_CHECK(identity.radius == 0 && identity.numTaps == 1 && identity.weights[0] == 1.0f);
+}
+
+
+CGD_TEST(PostProcess, FastPathMatchesReference) {
+
+	// odd sizes so every resample and blur clamps at the edges
+	TestFrame frame(157, 93);
+	CGDJobSystem *jobSystem = CGDJobSystem::CreateJobSystem(3);
+	CGDPostProcess *postProcess = CGDPostProcess::CreatePostProcess(157, 93, CGDPostProcessDesc(), jobSystem);
+	CGD_REQUIRE(postProcess);
+
+	postProcess->processReference(frame.scene, frame.depth.data(), frame.depthStride);
+
+	CGDPostImage stages[4] = { postProcess->getHalf(), postProcess->getDepthOfField(), postProcess->getBloom(), postProcess->getOutput() };
+
+	// the frame has bloom and depth of field
+	CGD_CHECK(maxDifference(stages[3], frame.scene) > 0.05f);
+
+	for (int parallel = 0; parallel < 2; parallel++) {
+
+		postProcess->process(frame.scene, frame.depth.data(), frame.depthStride, parallel == 1);
+
+		CGD_CHECK(maxDifference(postProcess->getHalf(), stages[0]) <= 1e-4f);
+		CGD_CHECK(maxDifference(postProcess->getDepthOfField(), stages[1]) <= 1e-4f);
+		CGD_CHECK(maxDifference(postProcess->getBloom(), stages[2]) <= 1e-4f);
+		CGD_CHECK(maxDifference(postProcess->getOutput(), stages[3]) <= 1e-4f);
+	}
+
+	// frames of another size are ignored
+	TestFrame other(64, 64);
+	CGDPostImage output = postProcess->getOutput();
+
+	postProcess->process(other.scene, other.depth.data(), other.depthStride);
+
+	CGD_CHECK(maxDifference(postProcess->getOutput(), output) == 0.0f);
+	CGD_CHECK(!CGDPostProcess::CreatePostProcess(0, 16, CGDPostProcessDesc()));
+
+	postProcess->release();
+	jobSystem->release();
+}
+
+
+CGD_TEST(PostProcess, AppliesOnlyTheEnabledEffects) {
+
+	TestFrame frame(96, 64);
+	CGDPostProcessDesc desc;
+
+	desc.bloomIntensity = 0.0f;
+	desc.focusDistance = 0.0f;
+
+	CGDPostProcess *postProcess = CGDPostProcess::CreatePostProcess(96, 64, desc);
+	CGD_REQUIRE(postProcess);
+
+	// with both effects off the scene passes through
+	for (int path = 0; path < 2; path++) {
+
+		if (path == 0)
+			postProcess->processReference(frame.scene, frame.depth.data(), frame.depthStride);
+		else
+			postProcess->process(frame.scene, frame.depth.data(), frame.depthStride, false);
+
+		CGD_CHECK(maxDifference(postProcess->getOutput(), frame.scene) <= 1e-6f);
+	}
+
+	// nothing below the threshold blooms
+	for (size_t i = 0; i < frame.scene.texels.size(); i++)
+		if ((i & 3) != 3)
+			frame.scene.texels[i] = min(frame.scene.texels[i], 0.7f);
+
+	desc.bloomIntensity = 1.0f;
+	postProcess->setDesc(desc);
+	postProcess->process(frame.scene, frame.depth.data(), frame.depthStride, false);
+
+	CGDPostImage black;
+
+	black.resize(48, 32);
+
+	CGD_CHECK(maxDifference(postProcess->getBloom(), black) == 0.0f);
+	CGD_CHECK(maxDifference(postProcess->getOutput(), frame.scene) <= 1e-6f);
+
+	// a flat colour is unchanged by the depth of field blur, wherever the focus is
+	for (size_t i = 0; i < frame.scene.texels.size(); i++)
+		frame.scene.texels[i] = ((i & 3) == 3) ? 1.0f : 0.25f;
+
+	desc.bloomIntensity = 0.0f;
+	desc.focusDistance = 5.0f;
+	desc.focusRange = 1.0f;
+	postProcess->setDesc(desc);
+	postProcess->process(frame.scene, frame.depth.data(), frame.depthStride, false);
+
+	CGD_CHECK(maxDifference(postProcess->getOutput(), frame.scene) <= 1e-5f);
+
+	postProcess->release();
+}
+
+
+CGD_TEST(PostProcess, MatchesGoldenImages) {
+
+	HeadlessScene *headlessScene = HeadlessScene::CreateHeadlessScene(256, 144, 1);
+	CGD_REQUIRE(headlessScene);
+
+	headlessScene->renderFrame(1.0 / 60.0);
+
+	CGDSoftwareRasterizer *rasterizer = headlessScene->getRasterizer();
+	vector<uint32_t> rgba(256 * 144);
+	CGDPostImage scene;
+
+	rasterizer->readColour(rgba.data());
+	scene.fromRGBA8(256, 144, rgba.data());
+
+	// The rasterizer pads its depth rows to a multiple of 4 floats, which 256 already is
+	CGDPostProcess *postProcess = CGDPostProcess::CreatePostProcess(256, 144, CGDPostProcessDesc());
+
+	postProcess->processReference(scene, rasterizer->getDepthBuffer(), 256);
+
+	const char *stages[4] = { "half", "depth_of_field", "bloom", "output" };
+	const CGDPostImage *images[4] = { &postProcess->getHalf(), &postProcess->getDepthOfField(), &postProcess->getBloom(), &postProcess->getOutput() };
+	bool written = false;
+
+	for (int i = 0; i < 4; i++) {
+
+		string filename = string("Tests/Golden/post_") + stages[i] + ".png";
+		vector<uint8_t> image, golden;
+		uint32_t goldenWidth = 0, goldenHeight = 0;
+
+		images[i]->toRGBA8(image);
+
+		if (!ifstream(filename).is_open()) {
+
+			bool ok = gu_png_write(filename.c_str(), images[i]->width, images[i]->height, image.data(), images[i]->width * 4);
+
+			cout << "  " << (ok ? "wrote golden image " : "cannot write golden image ") << filename << endl;
+			written = true;
+			continue;
+		}
+
+		CGD_CHECK(gu_image_read_rgba(filename.c_str(), goldenWidth, goldenHeight, golden));
+
+		if (goldenWidth != images[i]->width || goldenHeight != images[i]->height) {
+
+			CGD_CHECK(!"golden image size differs");
+			continue;
+		}
+
+		int difference = 0;
+
+		for (size_t j = 0; j < image.size(); j++)
+			difference = max(difference, abs((int)image[j] - (int)golden[j]));
+
+		if (difference > goldenTolerance)
+			cout << "  largest difference from " << filename << ": " << difference << endl;
+
+		CGD_CHECK(difference <= goldenTolerance);
+	}
+
+	CGD_CHECK(!written);
+
+	postProcess->release();
+	headlessScene->release();
+}
@@ -0,0 +1,137 @@
+
+//
+// CGDProfilerTests.cpp
+//
+
+#include <stdafx.h>
+#include <CGDProfiler.h>
+#include "CGDTest.h"
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <atomic>
+#include <memory>
+
+using namespace std;
+
+
+CGD_TEST(Profiler, ZonesRecordDepthAndOrder) {
+
+	CGDProfiler::Reset();
+
+	{
+		CGDProfileZone outer("outer");
+		{
+			CGDProfileZone inner("inner");
+		}
+		CGDProfiler::Counter("counter", 42);
+	}
+
+	vector<CGDProfileEvent> events = CGDProfiler::ThreadBuffer()->snapshot();
+
+	// zones are recorded when they close so inner precedes outer
+	CGD_REQUIRE(events.size() == 3);
+	CGD_CHECK(string(events[0].name) == "inner" && events[0].depth == 1 && events[0].type == CGDProfileEventType::ZONE);
+	CGD_CHECK(string(events[1].name) == "counter" && events[1].depth == 1 && events[1].value == 42 && events[1].type == CGDProfileEventType::COUNTER);
+	CGD_CHECK(string(events[2].name) == "outer" && events[2].depth == 0);
+	CGD_CHECK(events[2].begin <= events[0].begin && events[0].end <= events[2].end);
+}
+
+
+CGD_TEST(Profiler, RingKeepsMostRecentEvents) {
+
+	unique_ptr<CGDProfileThreadBuffer> buffer(new CGDProfileThreadBuffer());
+	const uint64_t n = CGDProfileThreadBuffer::capacity + 1000;
+
+	for (uint64_t i = 0; i < n; i++) {
+
+		CGDProfileEvent e = { "event", i, i, (int64_t)i, 0, CGDProfileEventType::COUNTER };
+		buffer->push(e);
+	}
+
+	vector<CGDProfileEvent> events = buffer->snapshot();
+
+	CGD_REQUIRE(events.size() == CGDProfileThreadBuffer::capacity);
+	CGD_CHECK(events.front().begin == 1000 && events.back().begin == n - 1);
+}
+
+
+CGD_TEST(Profiler, SnapshotWhileWriting) {
+
+	unique_ptr<CGDProfileThreadBuffer> buffer(new CGDProfileThreadBuffer());
+	// enough events to wrap the ring several times while staying quick under ThreadSanitizer
+	const uint64_t n = 8 * CGDProfileThreadBuffer::capacity;
+	atomic<bool> done(false);
+	uint64_t snapshots = 0, torn = 0, outOfOrder = 0, tooMany = 0;
+
+	// each event stores its index in every field so a partially overwritten event is detectable
+	thread writer([&]() {
+
+		for (uint64_t i = 0; i < n; i++) {
+
+			CGDProfileEvent e = { "event", i, i * 3, (int64_t)i * 5, (uint16_t)(i & 0xffff), CGDProfileEventType::ZONE };
+			buffer->push(e);
+		}
+
+		done.store(true);
+	});
+
+	while (!done.load() || snapshots == 0) {
+
+		vector<CGDProfileEvent> events = buffer->snapshot();
+
+		for (size_t i = 0; i < events.size(); i++) {
+
+			const CGDProfileEvent& e = events[i];
+
+			if (e.end != e.begin * 3 || e.value != (int64_t)e.begin * 5 || e.depth != (uint16_t)(e.begin & 0xffff))
+				torn++;
+
+			if (i > 0 && e.begin <= events[i - 1].begin)
+				outOfOrder++;
+		}
+
+		if (events.size() > CGDProfileThreadBuffer::capacity)
+			tooMany++;
+
+		snapshots++;
+	}
+
+	writer.join();
+
+	CGD_CHECK(torn == 0);
+	CGD_CHECK(outOfOrder == 0);
+	CGD_CHECK(tooMany == 0);
+
+	vector<CGDProfileEvent> events = buffer->snapshot();
+	CGD_CHECK(events.size() == CGDProfileThreadBuffer::capacity && events.back().begin == n - 1);
+}
+
+
+CGD_TEST(Profiler, ExportsChromeTrace) {
+
+	CGDProfiler::Reset();
+	CGDProfiler::SetThreadName("test \"main\"");
+
+	{
+		CGDProfileZone zone("exported");
+		CGDProfiler::Counter("exportedCounter", 7);
+	}
+
+	const string filename = "CGDProfilerTests_trace.json";
+	CGD_REQUIRE(CGDProfiler::ExportChromeTrace(filename));
+
+	ifstream file(filename);
+	stringstream json;
+	json << file.rdbuf();
+	file.close();
+	remove(filename.c_str());
+
+	string s = json.str();
+
+	CGD_CHECK(s.find("\"traceEvents\"") != string::npos);
+	CGD_CHECK(s.find("{\"name\": \"exported\", \"ph\": \"X\"") != string::npos);
+	CGD_CHECK(s.find("{\"name\": \"exportedCounter\", \"ph\": \"C\"") != string::npos);
+	CGD_CHECK(s.find("\"args\": {\"value\": 7}") != string::npos);
+	CGD_CHECK(s.find("\"test \\\"main\\\"\"") != string::npos);
+}
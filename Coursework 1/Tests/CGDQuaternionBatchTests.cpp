@@ -0,0 +1,609 @@
+
+//
+// CGDQuaternionBatchTests.cpp
+//
+
+// Accuracy of the GUQuaternionBatch kernels against a double precision scalar reference.  Batch sizes of 0..13 cover the SSE path and every (n mod 4) scalar tail.  GUQuaternion and GUDualQuaternion are built in the Windows CoreStructures library so only the SoA entry points are exercised here - gu_dualquat_blend is tested with SoA bones, which shares its accumulation and normalisation with the GUDualQuaternion overload.
+
+#include <stdafx.h>
+#include <CoreStructures/GUQuaternionBatch.h>
+#include "CGDTest.h"
+#include <vector>
+#include <random>
+#include <cmath>
+
+using namespace std;
+using namespace CoreStructures;
+
+
+namespace {
+
+	struct Quat {
+
+		double s, i, j, k;
+	};
+
+	Quat refMul(const Quat& a, const Quat& b) {
+
+		Quat q = {
+			a.s*b.s - a.i*b.i - a.j*b.j - a.k*b.k,
+			a.s*b.i + a.i*b.s + a.j*b.k - a.k*b.j,
+			a.s*b.j - a.i*b.k + a.j*b.s + a.k*b.i,
+			a.s*b.k + a.i*b.j - a.j*b.i + a.k*b.s };
+
+		return q;
+	}
+
+	Quat conj(const Quat& q) {
+
+		Quat c = { q.s, -q.i, -q.j, -q.k };
+		return c;
+	}
+
+	double dot(const Quat& a, const Quat& b) {
+
+		return a.s*b.s + a.i*b.i + a.j*b.j + a.k*b.k;
+	}
+
+	// reference slerp along the shortest arc
+	Quat refSlerp(const Quat& a, Quat b, double t) {
+
+		double c = dot(a, b);
+
+		if (c < 0.0) {
+
+			c = -c;
+			b.s = -b.s; b.i = -b.i; b.j = -b.j; b.k = -b.k;
+		}
+
+		double c0 = 1.0 - t, c1 = t;
+
+		if (c < 1.0 - 1.0e-12) {
+
+			double theta = acos(c);
+			c0 = sin((1.0 - t) * theta) / sin(theta);
+			c1 = sin(t * theta) / sin(theta);
+		}
+
+		Quat q = { c0*a.s + c1*b.s, c0*a.i + c1*b.i, c0*a.j + c1*b.j, c0*a.k + c1*b.k };
+		double l = sqrt(dot(q, q));
+		q.s /= l; q.i /= l; q.j /= l; q.k /= l;
+
+		return q;
+	}
+
+	// angle between the rotations represented by unit quaternions a and b.  atan2 of the relative rotation is well conditioned where acos(a.b) is not (a.b ~ 1)
+	double rotationAngle(const Quat& a, const Quat& b) {
+
+		Quat r = refMul(a, conj(b));
+
+		return 2.0 * atan2(sqrt(r.i*r.i + r.j*r.j + r.k*r.k), fabs(r.s));
+	}
+
+	// SoA storage for n quaternions
+	struct QuatBuffer {
+
+		vector<float>		s, i, j, k;
+
+		explicit QuatBuffer(size_t n) : s(n), i(n), j(n), k(n) {}
+
+		GUQuaternionSoA soa() { return GUQuaternionSoA(s.data(), i.data(), j.data(), k.data()); }
+
+		Quat get(size_t x) const { Quat q = { s[x], i[x], j[x], k[x] }; return q; }
+		void set(size_t x, const Quat& q) { s[x] = float(q.s); i[x] = float(q.i); j[x] = float(q.j); k[x] = float(q.k); }
+	};
+
+	Quat randomUnitQuat(mt19937& rng) {
+
+		normal_distribution<double> N(0.0, 1.0);
+		Quat q = { N(rng), N(rng), N(rng), N(rng) };
+		double l = sqrt(dot(q, q));
+		q.s /= l; q.i /= l; q.j /= l; q.k /= l;
+
+		return q;
+	}
+
+	QuatBuffer randomUnitQuats(size_t n, mt19937& rng) {
+
+		QuatBuffer b(n);
+
+		for (size_t x = 0; x < n; x++)
+			b.set(x, randomUnitQuat(rng));
+
+		return b;
+	}
+
+	Quat scaled(const Quat& q, double w) {
+
+		Quat r = { w*q.s, w*q.i, w*q.j, w*q.k };
+		return r;
+	}
+
+	Quat added(const Quat& a, const Quat& b) {
+
+		Quat r = { a.s + b.s, a.i + b.i, a.j + b.j, a.k + b.k };
+		return r;
+	}
+
+	// unit dual quaternion r + ε(t r / 2) for rotation r and translation t
+	void randomRigidTransform(mt19937& rng, Quat& r, Quat& d) {
+
+		uniform_real_distribution<double> U(-5.0, 5.0);
+		Quat t = { 0.0, U(rng), U(rng), U(rng) };
+
+		r = randomUnitQuat(rng);
+		d = scaled(refMul(t, r), 0.5);
+	}
+
+	// reference dual quaternion linear blend - bones aligned to the hemisphere of the first influence, the sum normalised by ||r|| and d projected so <r, d> = 0
+	void refBlend(const QuatBuffer& boneR, const QuatBuffer& boneD, const unsigned int *bi, const float *bw, unsigned int influences, Quat& r, Quat& d) {
+
+		Quat zero = { 0.0, 0.0, 0.0, 0.0 }, r0 = boneR.get(bi[0]);
+
+		r = zero;
+		d = zero;
+
+		for (unsigned int b = 0; b < influences; b++) {
+
+			double w = (dot(boneR.get(bi[b]), r0) < 0.0) ? -bw[b] : bw[b];
+
+			r = added(r, scaled(boneR.get(bi[b]), w));
+			d = added(d, scaled(boneD.get(bi[b]), w));
+		}
+
+		double l = sqrt(dot(r, r));
+
+		r = scaled(r, 1.0 / l);
+		d = scaled(d, 1.0 / l);
+		d = added(d, scaled(r, -dot(r, d)));
+	}
+
+	// r p r* + 2 d r*
+	void refTransform(const Quat& r, const Quat& d, const double p[3], double out[3]) {
+
+		Quat v = { 0.0, p[0], p[1], p[2] };
+		Quat rv = refMul(refMul(r, v), conj(r)), t = scaled(refMul(d, conj(r)), 2.0);
+
+		out[0] = rv.i + t.i;
+		out[1] = rv.j + t.j;
+		out[2] = rv.k + t.k;
+	}
+}
+
+
+CGD_TEST(QuaternionBatch, MultiplyMatchesReference) {
+
+	mt19937 rng(1);
+
+	for (size_t n = 0; n < 14; n++) {
+
+		QuatBuffer a = randomUnitQuats(n, rng), b = randomUnitQuats(n, rng), out(n);
+
+		gu_quat_multiply(a.soa(), b.soa(), out.soa(), n);
+
+		for (size_t x = 0; x < n; x++) {
+
+			Quat r = refMul(a.get(x), b.get(x)), q = out.get(x);
+
+			CGD_CHECK_NEAR(q.s, r.s, 1.0e-6);
+			CGD_CHECK_NEAR(q.i, r.i, 1.0e-6);
+			CGD_CHECK_NEAR(q.j, r.j, 1.0e-6);
+			CGD_CHECK_NEAR(q.k, r.k, 1.0e-6);
+		}
+
+		// out may alias a
+		QuatBuffer ref = out;
+		gu_quat_multiply(a.soa(), b.soa(), a.soa(), n);
+
+		for (size_t x = 0; x < n; x++)
+			CGD_CHECK(a.s[x] == ref.s[x] && a.i[x] == ref.i[x] && a.j[x] == ref.j[x] && a.k[x] == ref.k[x]);
+	}
+}
+
+
+CGD_TEST(QuaternionBatch, NormaliseGivesUnitLength) {
+
+	mt19937 rng(2);
+	uniform_real_distribution<float> U(-10.0f, 10.0f);
+
+	for (size_t n = 0; n < 14; n++) {
+
+		QuatBuffer q(n);
+
+		for (size_t x = 0; x < n; x++) {
+
+			q.s[x] = U(rng); q.i[x] = U(rng); q.j[x] = U(rng); q.k[x] = U(rng);
+		}
+
+		// zero length quaternions become the identity in the SSE body and the tail
+		if (n > 0) {
+
+			q.s[0] = q.i[0] = q.j[0] = q.k[0] = 0.0f;
+			q.s[n - 1] = q.i[n - 1] = q.j[n - 1] = q.k[n - 1] = 0.0f;
+		}
+
+		QuatBuffer original = q;
+		gu_quat_normalise(q.soa(), n);
+
+		for (size_t x = 0; x < n; x++) {
+
+			Quat r = q.get(x);
+			CGD_CHECK_NEAR(sqrt(dot(r, r)), 1.0, 1.0e-6);
+
+			Quat o = original.get(x);
+
+			if (dot(o, o) == 0.0)
+				CGD_CHECK(r.s == 1.0 && r.i == 0.0 && r.j == 0.0 && r.k == 0.0);
+			else
+				CGD_CHECK_NEAR(dot(r, o), sqrt(dot(o, o)), 1.0e-5 * sqrt(dot(o, o)));
+		}
+	}
+}
+
+
+CGD_TEST(QuaternionBatch, SlerpAngularErrorIsSmall) {
+
+	mt19937 rng(3);
+	uniform_real_distribution<double> U(0.0, 1.0);
+
+	const size_t n = 4099;
+	QuatBuffer q0 = randomUnitQuats(n, rng), q1 = randomUnitQuats(n, rng), out(n), outT(n);
+
+	// include nearly coincident, antipodal and identical pairs to exercise the nlerp fallback and the hemisphere flip
+	for (size_t x = 0; x < n; x += 7) {
+
+		Quat a = q0.get(x);
+		Quat b = { a.s + 1.0e-3 * U(rng), a.i, a.j - 1.0e-3 * U(rng), a.k };
+		double l = sqrt(dot(b, b));
+		b.s /= l; b.i /= l; b.j /= l; b.k /= l;
+
+		if (x % 3 == 0) {
+
+			b.s = -b.s; b.i = -b.i; b.j = -b.j; b.k = -b.k;
+		}
+
+		q1.set(x, (x % 5 == 0) ? a : b);
+	}
+
+	vector<float> t(n);
+
+	for (size_t x = 0; x < n; x++)
+		t[x] = float(U(rng));
+
+	double maxError = 0.0, maxErrorT = 0.0;
+
+	const float ts[] = { 0.0f, 0.25f, 0.5f, 0.9f, 1.0f };
+
+	for (size_t tIndex = 0; tIndex < sizeof(ts) / sizeof(ts[0]); tIndex++) {
+
+		gu_quat_slerp(q0.soa(), q1.soa(), ts[tIndex], out.soa(), n);
+
+		for (size_t x = 0; x < n; x++)
+			maxError = max(maxError, rotationAngle(out.get(x), refSlerp(q0.get(x), q1.get(x), ts[tIndex])));
+	}
+
+	gu_quat_slerp(q0.soa(), q1.soa(), t.data(), outT.soa(), n);
+
+	for (size_t x = 0; x < n; x++)
+		maxErrorT = max(maxErrorT, rotationAngle(outT.get(x), refSlerp(q0.get(x), q1.get(x), t[x])));
+
+	// the polynomial acos / sin are accurate to ~1e-6 radians.  Single precision rounding of the inputs and the result adds a few ulp
+	CGD_CHECK(maxError < 2.0e-6);
+	CGD_CHECK(maxErrorT < 2.0e-6);
+}
+
+
+CGD_TEST(QuaternionBatch, NlerpFollowsShortestArc) {
+
+	mt19937 rng(4);
+
+	const size_t n = 13;
+	QuatBuffer q0 = randomUnitQuats(n, rng), q1 = randomUnitQuats(n, rng), out(n);
+
+	gu_quat_nlerp(q0.soa(), q1.soa(), 0.5f, out.soa(), n);
+
+	for (size_t x = 0; x < n; x++) {
+
+		Quat a = q0.get(x), b = q1.get(x), q = out.get(x);
+
+		if (dot(a, b) < 0.0) {
+
+			b.s = -b.s; b.i = -b.i; b.j = -b.j; b.k = -b.k;
+		}
+
+		Quat m = { a.s + b.s, a.i + b.i, a.j + b.j, a.k + b.k };
+		double l = sqrt(dot(m, m));
+
+		CGD_CHECK_NEAR(dot(q, m) / l, 1.0, 1.0e-5);
+	}
+}
+
+
+CGD_TEST(QuaternionBatch, RotateMatchesConjugation) {
+
+	mt19937 rng(5);
+	uniform_real_distribution<float> U(-5.0f, 5.0f);
+
+	for (size_t n = 0; n < 14; n++) {
+
+		QuatBuffer q = randomUnitQuats(n, rng);
+		vector<float> vx(n), vy(n), vz(n), ox(n), oy(n), oz(n);
+
+		for (size_t x = 0; x < n; x++) {
+
+			vx[x] = U(rng); vy[x] = U(rng); vz[x] = U(rng);
+		}
+
+		gu_quat_rotate(q.soa(), GUVector3SoA(vx.data(), vy.data(), vz.data()), GUVector3SoA(ox.data(), oy.data(), oz.data()), n);
+
+		for (size_t x = 0; x < n; x++) {
+
+			Quat v = { 0.0, vx[x], vy[x], vz[x] };
+			Quat r = refMul(refMul(q.get(x), v), conj(q.get(x)));
+
+			CGD_CHECK_NEAR(ox[x], r.i, 1.0e-5);
+			CGD_CHECK_NEAR(oy[x], r.j, 1.0e-5);
+			CGD_CHECK_NEAR(oz[x], r.k, 1.0e-5);
+		}
+	}
+}
+
+
+CGD_TEST(QuaternionBatch, DualQuaternionTransformsPoints) {
+
+	mt19937 rng(6);
+	uniform_real_distribution<float> U(-5.0f, 5.0f);
+
+	for (size_t n = 0; n < 14; n++) {
+
+		// build q = r + ε(t r / 2) from a random rotation r and translation t
+		QuatBuffer r = randomUnitQuats(n, rng), d(n);
+		vector<Quat> t(n);
+
+		for (size_t x = 0; x < n; x++) {
+
+			Quat tq = { 0.0, U(rng), U(rng), U(rng) };
+			Quat dq = refMul(tq, r.get(x));
+			dq.s *= 0.5; dq.i *= 0.5; dq.j *= 0.5; dq.k *= 0.5;
+
+			t[x] = tq;
+			d.set(x, dq);
+		}
+
+		GUDualQuaternionSoA q(r.soa(), d.soa());
+
+		vector<float> px(n), py(n), pz(n), ox(n), oy(n), oz(n), nx(n), ny(n), nz(n);
+
+		for (size_t x = 0; x < n; x++) {
+
+			px[x] = U(rng); py[x] = U(rng); pz[x] = U(rng);
+		}
+
+		GUVector3SoA p(px.data(), py.data(), pz.data());
+
+		gu_dualquat_transform(q, p, GUVector3SoA(ox.data(), oy.data(), oz.data()), n);
+		gu_dualquat_transform_normal(q, p, GUVector3SoA(nx.data(), ny.data(), nz.data()), n);
+
+		for (size_t x = 0; x < n; x++) {
+
+			Quat v = { 0.0, px[x], py[x], pz[x] };
+			Quat rv = refMul(refMul(r.get(x), v), conj(r.get(x)));
+
+			CGD_CHECK_NEAR(ox[x], rv.i + t[x].i, 5.0e-5);
+			CGD_CHECK_NEAR(oy[x], rv.j + t[x].j, 5.0e-5);
+			CGD_CHECK_NEAR(oz[x], rv.k + t[x].k, 5.0e-5);
+
+			CGD_CHECK_NEAR(nx[x], rv.i, 1.0e-5);
+			CGD_CHECK_NEAR(ny[x], rv.j, 1.0e-5);
+			CGD_CHECK_NEAR(nz[x], rv.k, 1.0e-5);
+		}
+	}
+}
+
+
+CGD_TEST(QuaternionBatch, DualQuaternionMultiplyComposesTransforms) {
+
+	mt19937 rng(7);
+
+	const size_t n = 11;
+	QuatBuffer ar = randomUnitQuats(n, rng), ad = randomUnitQuats(n, rng), br = randomUnitQuats(n, rng), bd = randomUnitQuats(n, rng);
+	QuatBuffer outR(n), outD(n);
+
+	gu_dualquat_multiply(GUDualQuaternionSoA(ar.soa(), ad.soa()), GUDualQuaternionSoA(br.soa(), bd.soa()), GUDualQuaternionSoA(outR.soa(), outD.soa()), n);
+
+	for (size_t x = 0; x < n; x++) {
+
+		Quat r = refMul(ar.get(x), br.get(x));
+		Quat d1 = refMul(ar.get(x), bd.get(x)), d2 = refMul(ad.get(x), br.get(x));
+		Quat d = { d1.s + d2.s, d1.i + d2.i, d1.j + d2.j, d1.k + d2.k };
+
+		CGD_CHECK_NEAR(outR.s[x], r.s, 1.0e-6);
+		CGD_CHECK_NEAR(outR.i[x], r.i, 1.0e-6);
+		CGD_CHECK_NEAR(outR.j[x], r.j, 1.0e-6);
+		CGD_CHECK_NEAR(outR.k[x], r.k, 1.0e-6);
+		CGD_CHECK_NEAR(outD.s[x], d.s, 2.0e-6);
+		CGD_CHECK_NEAR(outD.i[x], d.i, 2.0e-6);
+		CGD_CHECK_NEAR(outD.j[x], d.j, 2.0e-6);
+		CGD_CHECK_NEAR(outD.k[x], d.k, 2.0e-6);
+	}
+}
+
+
+CGD_TEST(QuaternionBatch, DualQuaternionBlendMatchesReference) {
+
+	mt19937 rng(8);
+	uniform_real_distribution<float> U(0.0f, 1.0f);
+
+	// 8 bones - half are stored with negated (antipodal) rotation so the blend must flip them to the first influence's hemisphere
+	const unsigned int numBones = 8, influences = 4;
+	QuatBuffer boneR(numBones), boneD(numBones);
+
+	for (unsigned int b = 0; b < numBones; b++) {
+
+		Quat r, d;
+		randomRigidTransform(rng, r, d);
+
+		if (b % 2) {
+
+			r = scaled(r, -1.0);
+			d = scaled(d, -1.0);
+		}
+
+		boneR.set(b, r);
+		boneD.set(b, d);
+	}
+
+	for (size_t n = 0; n < 14; n++) {
+
+		vector<unsigned int> boneIndices(n * influences);
+		vector<float> weights(n * influences);
+
+		for (size_t x = 0; x < n; x++) {
+
+			float sum = 0.0f;
+
+			for (unsigned int b = 0; b < influences; b++) {
+
+				boneIndices[x * influences + b] = (unsigned int)(rng() % numBones);
+				weights[x * influences + b] = 0.05f + U(rng);
+				sum += weights[x * influences + b];
+			}
+
+			for (unsigned int b = 0; b < influences; b++)
+				weights[x * influences + b] /= sum;
+		}
+
+		QuatBuffer outR(n), outD(n);
+		GUDualQuaternionSoA out(outR.soa(), outD.soa());
+
+		gu_dualquat_blend(GUDualQuaternionSoA(boneR.soa(), boneD.soa()), boneIndices.data(), weights.data(), influences, out, n);
+
+		vector<float> px(n), py(n), pz(n), ox(n), oy(n), oz(n), nx(n), ny(n), nz(n);
+
+		for (size_t x = 0; x < n; x++) {
+
+			px[x] = 10.0f * U(rng) - 5.0f; py[x] = 10.0f * U(rng) - 5.0f; pz[x] = 10.0f * U(rng) - 5.0f;
+		}
+
+		gu_dualquat_transform(out, GUVector3SoA(px.data(), py.data(), pz.data()), GUVector3SoA(ox.data(), oy.data(), oz.data()), n);
+		gu_dualquat_transform_normal(out, GUVector3SoA(px.data(), py.data(), pz.data()), GUVector3SoA(nx.data(), ny.data(), nz.data()), n);
+
+		for (size_t x = 0; x < n; x++) {
+
+			Quat r, d;
+			refBlend(boneR, boneD, &boneIndices[x * influences], &weights[x * influences], influences, r, d);
+
+			Quat qr = outR.get(x), qd = outD.get(x);
+
+			CGD_CHECK_NEAR(qr.s, r.s, 1.0e-6);
+			CGD_CHECK_NEAR(qr.i, r.i, 1.0e-6);
+			CGD_CHECK_NEAR(qr.j, r.j, 1.0e-6);
+			CGD_CHECK_NEAR(qr.k, r.k, 1.0e-6);
+			CGD_CHECK_NEAR(qd.s, d.s, 1.0e-5);
+			CGD_CHECK_NEAR(qd.i, d.i, 1.0e-5);
+			CGD_CHECK_NEAR(qd.j, d.j, 1.0e-5);
+			CGD_CHECK_NEAR(qd.k, d.k, 1.0e-5);
+
+			// the result is a unit dual quaternion
+			CGD_CHECK_NEAR(dot(qr, qr), 1.0, 1.0e-6);
+			CGD_CHECK_NEAR(dot(qr, qd), 0.0, 1.0e-5);
+
+			double p[3] = { px[x], py[x], pz[x] }, o[3], zero[3] = { 0.0, 0.0, 0.0 }, t[3], nrm[3];
+			Quat zeroD = { 0.0, 0.0, 0.0, 0.0 };
+
+			refTransform(r, d, p, o);
+			refTransform(r, zeroD, p, nrm);
+			refTransform(r, d, zero, t);
+
+			CGD_CHECK_NEAR(ox[x], o[0], 5.0e-5);
+			CGD_CHECK_NEAR(oy[x], o[1], 5.0e-5);
+			CGD_CHECK_NEAR(oz[x], o[2], 5.0e-5);
+			CGD_CHECK_NEAR(nx[x], nrm[0], 1.0e-5);
+			CGD_CHECK_NEAR(ny[x], nrm[1], 1.0e-5);
+			CGD_CHECK_NEAR(nz[x], nrm[2], 1.0e-5);
+
+			// the translation part alone moves the origin to t
+			CGD_CHECK_NEAR(ox[x] - nx[x], t[0], 5.0e-5);
+			CGD_CHECK_NEAR(oy[x] - ny[x], t[1], 5.0e-5);
+			CGD_CHECK_NEAR(oz[x] - nz[x], t[2], 5.0e-5);
+		}
+
+		// out may alias p
+		gu_dualquat_transform(out, GUVector3SoA(px.data(), py.data(), pz.data()), GUVector3SoA(px.data(), py.data(), pz.data()), n);
+
+		for (size_t x = 0; x < n; x++)
+			CGD_CHECK(px[x] == ox[x] && py[x] == oy[x] && pz[x] == oz[x]);
+	}
+}
+
+
+CGD_TEST(QuaternionBatch, DualQuaternionBlendAcrossAntipodalQuaternions) {
+
+	mt19937 rng(9);
+	uniform_real_distribution<float> U(0.0f, 1.0f);
+
+	// q and -q are the same rigid transform.  Bone 0 is q, bone 1 is -q, bone 2 is a second transform q2 and bone 3 is -q2
+	QuatBuffer boneR(4), boneD(4);
+
+	for (unsigned int b = 0; b < 4; b += 2) {
+
+		Quat r, d;
+		randomRigidTransform(rng, r, d);
+
+		boneR.set(b, r); boneD.set(b, d);
+		boneR.set(b + 1, scaled(r, -1.0)); boneD.set(b + 1, scaled(d, -1.0));
+	}
+
+	// Elements 0..7 blend q with -q (without alignment the sum would cancel to zero).  Elements 8..15 blend q with -q2 (even x) and q with q2 (odd x) using the same weights for each pair, which must agree
+	const size_t n = 16;
+	vector<unsigned int> boneIndices(n * 2);
+	vector<float> weights(n * 2);
+
+	for (size_t x = 0; x < n; x++) {
+
+		float w = (x == 3) ? 0.5f : (x > 8 && x % 2) ? weights[(x - 1) * 2] : U(rng);
+
+		boneIndices[x * 2] = 0;
+		boneIndices[x * 2 + 1] = (x < 8) ? 1 : (x % 2) ? 2 : 3;
+		weights[x * 2] = w;
+		weights[x * 2 + 1] = 1.0f - w;
+	}
+
+	QuatBuffer outR(n), outD(n);
+	GUDualQuaternionSoA out(outR.soa(), outD.soa());
+
+	gu_dualquat_blend(GUDualQuaternionSoA(boneR.soa(), boneD.soa()), boneIndices.data(), weights.data(), 2, out, n);
+
+	for (size_t x = 0; x < n; x++) {
+
+		Quat r, d;
+		refBlend(boneR, boneD, &boneIndices[x * 2], &weights[x * 2], 2, r, d);
+
+		CGD_CHECK_NEAR(outR.s[x], r.s, 1.0e-6);
+		CGD_CHECK_NEAR(outR.i[x], r.i, 1.0e-6);
+		CGD_CHECK_NEAR(outR.j[x], r.j, 1.0e-6);
+		CGD_CHECK_NEAR(outR.k[x], r.k, 1.0e-6);
+		CGD_CHECK_NEAR(outD.s[x], d.s, 1.0e-5);
+		CGD_CHECK_NEAR(outD.i[x], d.i, 1.0e-5);
+		CGD_CHECK_NEAR(outD.j[x], d.j, 1.0e-5);
+		CGD_CHECK_NEAR(outD.k[x], d.k, 1.0e-5);
+
+		if (x < 8) {
+
+			// blending q with -q gives back q
+			CGD_CHECK_NEAR(dot(outR.get(x), boneR.get(0)), 1.0, 1.0e-6);
+			CGD_CHECK_NEAR(outD.s[x], boneD.s[0], 1.0e-5);
+			CGD_CHECK_NEAR(outD.i[x], boneD.i[0], 1.0e-5);
+			CGD_CHECK_NEAR(outD.j[x], boneD.j[0], 1.0e-5);
+			CGD_CHECK_NEAR(outD.k[x], boneD.k[0], 1.0e-5);
+		}
+		else if (x % 2 == 0) {
+
+			CGD_CHECK_NEAR(dot(outR.get(x), outR.get(x + 1)), 1.0, 1.0e-6);
+			CGD_CHECK_NEAR(outD.s[x], outD.s[x + 1], 1.0e-5);
+			CGD_CHECK_NEAR(outD.i[x], outD.i[x + 1], 1.0e-5);
+			CGD_CHECK_NEAR(outD.j[x], outD.j[x + 1], 1.0e-5);
+			CGD_CHECK_NEAR(outD.k[x], outD.k[x + 1], 1.0e-5);
+		}
+	}
+}
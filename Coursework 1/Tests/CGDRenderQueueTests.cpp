@@ -0,0 +1,428 @@
+
+//
+// CGDRenderQueueTests.cpp
+//
+
+// CGDStateCache and CGDRenderQueue replayed into a CGDRecordingContext, which records the calls that would reach the device context.
+
+#include <stdafx.h>
+#include <CGDStateCache.h>
+#include <CGDRenderQueue.h>
+#include <CGDRecordingContext.h>
+#include "CGDTest.h"
+#include <algorithm>
+#include <random>
+#include <vector>
+#include <cstring>
+
+using namespace std;
+
+
+namespace {
+
+	// Opaque pipeline handle n
+	void* handle(uintptr_t n) {
+
+		return (void*)(n * 16);
+	}
+
+	// Recording context and state cache pair
+	struct Recorder {
+
+		CGDRecordingContext		*context;
+		CGDStateCache			*cache;
+
+		Recorder() : context(CGDRecordingContext::CreateRecordingContext()), cache(CGDStateCache::CreateStateCache(context)) {}
+
+		~Recorder() {
+
+			cache->release();
+			context->release();
+		}
+
+		uint64_t calls(CGDRenderCall call) const { return context->callCount(call); }
+
+		// count of the most recent recorded call
+		uint32_t lastCount() const { return context->getCalls().empty() ? 0 : context->getCalls().back().count; }
+	};
+
+	CGDDrawPacket makePacket(uintptr_t effect, uintptr_t material, uintptr_t mesh) {
+
+		CGDDrawPacket p;
+		memset(&p, 0, sizeof(p));
+
+		p.vertexShader = handle(100 + effect);
+		p.pixelShader = handle(200 + effect);
+		p.inputLayout = handle(300 + effect);
+		p.rasterizerState = handle(1);
+		p.depthStencilState = handle(2);
+		p.blendState = handle(3);
+		p.blendFactor[0] = p.blendFactor[1] = p.blendFactor[2] = p.blendFactor[3] = 1.0f;
+		p.sampleMask = 0xffffffff;
+
+		p.constants.buffer = handle(4);
+		p.constants.firstConstant = (uint32_t)(mesh * 16);
+		p.constants.numConstants = 16;
+
+		p.shaderResources[0] = handle(1000 + material * 2);
+		p.shaderResources[1] = handle(1001 + material * 2);
+		p.numShaderResources = 2;
+		p.sampler = handle(5);
+
+		p.vertexBuffer = handle(2000 + mesh);
+		p.vertexStride = 32;
+		p.indexBuffer = handle(3000 + mesh);
+		p.indexFormat = 42;
+		p.topology = 4;
+		p.indexCount = (uint32_t)(36 + mesh);
+
+		return p;
+	}
+}
+
+
+CGD_TEST(StateCache, FiltersRedundantCalls) {
+
+	CGD_CHECK(CGDStateCache::CreateStateCache(nullptr) == nullptr);
+
+	Recorder r;
+	float blend[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+
+	for (int i = 0; i < 3; i++) {
+
+		r.cache->setInputLayout(handle(1));
+		r.cache->setVertexBuffer(0, handle(2), 32, 0);
+		r.cache->setIndexBuffer(handle(3), 42, 0);
+		r.cache->setPrimitiveTopology(4);
+		r.cache->setShader(CGDShaderStage::VERTEX, handle(5));
+		r.cache->setShader(CGDShaderStage::PIXEL, handle(5));
+		r.cache->setRasterizerState(handle(6));
+		r.cache->setDepthStencilState(handle(7), 1);
+		r.cache->setBlendState(handle(8), blend, 0xffffffff);
+
+		// a null blend factor is the default {1, 1, 1, 1}
+		r.cache->setBlendState(handle(8), nullptr, 0xffffffff);
+
+		r.cache->drawIndexed(36, 0, 0);
+	}
+
+	CGD_CHECK(r.calls(CGDRenderCall::INPUT_LAYOUT) == 1);
+	CGD_CHECK(r.calls(CGDRenderCall::VERTEX_BUFFER) == 1);
+	CGD_CHECK(r.calls(CGDRenderCall::INDEX_BUFFER) == 1);
+	CGD_CHECK(r.calls(CGDRenderCall::PRIMITIVE_TOPOLOGY) == 1);
+	CGD_CHECK(r.calls(CGDRenderCall::SHADER) == 2); // stages are tracked separately
+	CGD_CHECK(r.calls(CGDRenderCall::RASTERIZER_STATE) == 1);
+	CGD_CHECK(r.calls(CGDRenderCall::DEPTH_STENCIL_STATE) == 1);
+	CGD_CHECK(r.calls(CGDRenderCall::BLEND_STATE) == 1);
+	CGD_CHECK(r.context->drawCount() == 3);
+
+	CGDRenderStats stats = r.cache->getStats();
+	CGD_CHECK(stats.callsIssued == 9 && stats.callsSkipped == 21 && stats.draws == 3 && stats.instances == 3);
+
+	// any part of a state that changes reissues it
+	r.context->clear();
+
+	r.cache->setVertexBuffer(0, handle(2), 16, 0);
+	r.cache->setIndexBuffer(handle(3), 42, 64);
+	r.cache->setDepthStencilState(handle(7), 2);
+	blend[3] = 0.5f;
+	r.cache->setBlendState(handle(8), blend, 0xffffffff);
+	r.cache->setBlendState(handle(8), blend, 0x0000ffff);
+
+	// vertex buffer slots other than 0 are always issued
+	r.cache->setVertexBuffer(1, handle(9), 16, 0);
+	r.cache->setVertexBuffer(1, handle(9), 16, 0);
+
+	CGD_CHECK(r.context->stateCallCount() == 7);
+
+	r.cache->resetStats();
+	CGD_CHECK(r.cache->getStats().callsIssued == 0);
+}
+
+
+CGD_TEST(StateCache, TrimsRangedCallsToChangedSlots) {
+
+	Recorder r;
+	void *views[8], *samplers[4];
+
+	for (int i = 0; i < 8; i++)
+		views[i] = handle(10 + i);
+
+	for (int i = 0; i < 4; i++)
+		samplers[i] = handle(20 + i);
+
+	r.cache->setShaderResources(CGDShaderStage::PIXEL, 0, 8, views);
+	CGD_CHECK(r.lastCount() == 8);
+
+	r.cache->setShaderResources(CGDShaderStage::PIXEL, 0, 8, views);
+	CGD_CHECK(r.calls(CGDRenderCall::SHADER_RESOURCES) == 1);
+
+	// only slots 3..5 are issued
+	views[3] = handle(30);
+	views[5] = handle(31);
+	r.cache->setShaderResources(CGDShaderStage::PIXEL, 0, 8, views);
+
+	CGD_CHECK(r.calls(CGDRenderCall::SHADER_RESOURCES) == 2);
+	CGD_CHECK(r.lastCount() == 3);
+
+	// a sub-range matching the shadow state is skipped
+	r.cache->setShaderResources(CGDShaderStage::PIXEL, 2, 4, views + 2);
+	CGD_CHECK(r.calls(CGDRenderCall::SHADER_RESOURCES) == 2);
+
+	// the vertex stage has its own shadow state
+	r.cache->setShaderResources(CGDShaderStage::VERTEX, 0, 2, views);
+	CGD_CHECK(r.calls(CGDRenderCall::SHADER_RESOURCES) == 3);
+
+	// slots beyond the cached range are always issued
+	r.cache->setShaderResources(CGDShaderStage::PIXEL, 7, 2, views);
+	r.cache->setShaderResources(CGDShaderStage::PIXEL, 7, 2, views);
+	CGD_CHECK(r.calls(CGDRenderCall::SHADER_RESOURCES) == 5);
+	CGD_CHECK(r.lastCount() == 1);
+
+	r.cache->setSamplers(CGDShaderStage::PIXEL, 0, 4, samplers);
+	samplers[0] = handle(40);
+	r.cache->setSamplers(CGDShaderStage::PIXEL, 0, 4, samplers);
+
+	CGD_CHECK(r.calls(CGDRenderCall::SAMPLERS) == 2);
+	CGD_CHECK(r.lastCount() == 1);
+}
+
+
+CGD_TEST(StateCache, TracksConstantBufferRanges) {
+
+	Recorder r;
+	void *buffer = handle(1), *other = handle(2);
+
+	r.cache->setConstantBufferRange(CGDShaderStage::VERTEX, 0, buffer, 0, 16);
+	r.cache->setConstantBufferRange(CGDShaderStage::VERTEX, 0, buffer, 0, 16);
+	CGD_CHECK(r.calls(CGDRenderCall::CONSTANT_BUFFERS) == 1);
+
+	// a different range of the same buffer
+	r.cache->setConstantBufferRange(CGDShaderStage::VERTEX, 0, buffer, 16, 16);
+	r.cache->setConstantBufferRange(CGDShaderStage::VERTEX, 0, buffer, 16, 32);
+	CGD_CHECK(r.calls(CGDRenderCall::CONSTANT_BUFFERS) == 3);
+
+	// binding the whole buffer replaces the range binding
+	r.cache->setConstantBuffers(CGDShaderStage::VERTEX, 0, 1, &buffer);
+	r.cache->setConstantBuffers(CGDShaderStage::VERTEX, 0, 1, &buffer);
+	CGD_CHECK(r.calls(CGDRenderCall::CONSTANT_BUFFERS) == 4);
+
+	// and a range binding replaces the whole buffer
+	r.cache->setConstantBufferRange(CGDShaderStage::VERTEX, 0, buffer, 16, 32);
+	CGD_CHECK(r.calls(CGDRenderCall::CONSTANT_BUFFERS) == 5);
+
+	void *pair[2] = { buffer, other };
+	r.cache->setConstantBuffers(CGDShaderStage::PIXEL, 0, 2, pair);
+	r.cache->setConstantBuffers(CGDShaderStage::PIXEL, 1, 1, &other);
+	CGD_CHECK(r.calls(CGDRenderCall::CONSTANT_BUFFERS) == 6);
+	CGD_CHECK(r.lastCount() == 2);
+}
+
+
+CGD_TEST(StateCache, InvalidateReissuesState) {
+
+	Recorder r;
+	void *view = handle(3);
+
+	r.cache->setShader(CGDShaderStage::PIXEL, handle(1));
+	r.cache->setRasterizerState(handle(2));
+	r.cache->setShaderResources(CGDShaderStage::PIXEL, 0, 1, &view);
+
+	// null handles are valid state (unbind) and are filtered like any other
+	r.cache->setShader(CGDShaderStage::GEOMETRY, nullptr);
+	r.cache->setShader(CGDShaderStage::GEOMETRY, nullptr);
+
+	CGD_CHECK(r.context->stateCallCount() == 4);
+
+	r.cache->invalidate();
+
+	r.cache->setShader(CGDShaderStage::PIXEL, handle(1));
+	r.cache->setRasterizerState(handle(2));
+	r.cache->setShaderResources(CGDShaderStage::PIXEL, 0, 1, &view);
+	r.cache->setShader(CGDShaderStage::GEOMETRY, nullptr);
+
+	CGD_CHECK(r.context->stateCallCount() == 8);
+}
+
+
+CGD_TEST(RenderQueue, RadixSortIsStable) {
+
+	mt19937_64 rng(11);
+	const size_t n = 10000;
+
+	vector<uint64_t> keys(n), tmpKeys(n);
+	vector<uint32_t> order(n), tmpOrder(n);
+
+	// few distinct values in the high bytes so equal keys and skipped passes both occur
+	for (size_t i = 0; i < n; i++)
+		keys[i] = ((rng() % 4) << 60) | ((rng() % 3) << 32) | (rng() % 100);
+
+	vector<pair<uint64_t, uint32_t> > expected(n);
+
+	for (size_t i = 0; i < n; i++)
+		expected[i] = make_pair(keys[i], (uint32_t)i);
+
+	stable_sort(expected.begin(), expected.end(), [](const pair<uint64_t, uint32_t>& a, const pair<uint64_t, uint32_t>& b) { return a.first < b.first; });
+
+	CGDRenderQueue::RadixSort(keys.data(), order.data(), tmpKeys.data(), tmpOrder.data(), n);
+
+	size_t mismatches = 0;
+
+	for (size_t i = 0; i < n; i++) {
+
+		if (keys[i] != expected[i].first || order[i] != expected[i].second)
+			mismatches++;
+	}
+
+	CGD_CHECK(mismatches == 0);
+
+	CGDRenderQueue::RadixSort(nullptr, nullptr, nullptr, nullptr, 0);
+}
+
+
+CGD_TEST(RenderQueue, KeysOrderByLayerStateAndDepth) {
+
+	CGDRenderQueue *queue = CGDRenderQueue::CreateRenderQueue();
+	CGD_REQUIRE(queue);
+
+	int effectA, effectB, material, mesh;
+
+	// ids are given in first-use order
+	uint64_t a = queue->makeKey(0, &effectA, &material, &mesh, 0.5f);
+	uint64_t b = queue->makeKey(0, &effectB, &material, &mesh, 0.0f);
+
+	CGD_CHECK(a < b);
+
+	// layer dominates, then effect; depth sorts nearest first and is clamped to [0, 1]
+	CGD_CHECK(queue->makeKey(1, &effectA, &material, &mesh, 0.0f) > b);
+	CGD_CHECK(queue->makeKey(0, &effectA, &material, &mesh, 0.25f) < a);
+	CGD_CHECK(queue->makeKey(0, &effectA, &material, &mesh, -1.0f) == queue->makeKey(0, &effectA, &material, &mesh, 0.0f));
+	CGD_CHECK(queue->makeKey(0, &effectA, &material, &mesh, 2.0f) == queue->makeKey(0, &effectA, &material, &mesh, 1.0f));
+
+	// ids persist so the same arguments give the same key
+	CGD_CHECK(queue->makeKey(0, &effectB, &material, &mesh, 0.0f) == b);
+
+	queue->release();
+}
+
+
+CGD_TEST(RenderQueue, SortIsRepeatable) {
+
+	CGDRenderQueue *queue = CGDRenderQueue::CreateRenderQueue();
+	CGD_REQUIRE(queue);
+
+	queue->sort();
+	CGD_CHECK(queue->size() == 0);
+
+	// submit meshes 3, 1, sort, then submit 2, 0 and sort again
+	uintptr_t meshes[4] = { 3, 1, 2, 0 };
+
+	for (int i = 0; i < 4; i++) {
+
+		CGDDrawPacket p = makePacket(0, 0, meshes[i]);
+		queue->submit(((uint64_t)meshes[i]) << 16, p);
+
+		if (i == 1)
+			queue->sort();
+	}
+
+	queue->sort();
+	queue->sort();
+
+	CGD_REQUIRE(queue->size() == 4);
+
+	for (size_t i = 0; i < 4; i++)
+		CGD_CHECK(queue->getPacket(i).vertexBuffer == handle(2000 + i));
+
+	queue->release();
+}
+
+
+CGD_TEST(RenderQueue, ExecuteGroupsStateChanges) {
+
+	const uintptr_t numEffects = 3, numMaterials = 4, numMeshes = 5, drawsPerMesh = 2;
+
+	CGDRenderQueue *queue = CGDRenderQueue::CreateRenderQueue();
+	Recorder r;
+	CGD_REQUIRE(queue);
+
+	// submit every (effect, material, mesh) draw in a shuffled order
+	struct Draw {
+
+		uintptr_t effect, material, mesh, index;
+	};
+
+	vector<Draw> draws;
+
+	for (uintptr_t e = 0; e < numEffects; e++)
+		for (uintptr_t m = 0; m < numMaterials; m++)
+			for (uintptr_t s = 0; s < numMeshes; s++)
+				for (uintptr_t d = 0; d < drawsPerMesh; d++)
+					draws.push_back(Draw{ e, m, s, d });
+
+	mt19937 rng(5);
+	shuffle(draws.begin(), draws.end(), rng);
+
+	for (int frame = 0; frame < 2; frame++) {
+
+		for (auto& d : draws) {
+
+			CGDDrawPacket p = makePacket(d.effect, d.material, d.mesh);
+			p.startIndex = (uint32_t)d.index;
+
+			queue->submit(queue->makeKey(0, p.vertexShader, p.shaderResources[0], p.vertexBuffer, 0.1f * (float)(drawsPerMesh - d.index)), p);
+		}
+
+		CGD_CHECK(queue->size() == draws.size());
+
+		if (frame == 0) {
+
+			// sorted order groups by effect, then material, then mesh and puts the nearest draw first
+			queue->sort();
+
+			size_t outOfOrder = 0;
+
+			for (size_t i = 1; i < queue->size(); i++) {
+
+				const CGDDrawPacket& p = queue->getPacket(i - 1);
+				const CGDDrawPacket& q = queue->getPacket(i);
+
+				if (p.vertexShader == q.vertexShader && p.shaderResources[0] == q.shaderResources[0] && p.vertexBuffer == q.vertexBuffer && p.startIndex < q.startIndex)
+					outOfOrder++;
+			}
+
+			CGD_CHECK(outOfOrder == 0);
+		}
+
+		r.context->clear();
+		r.cache->resetStats();
+
+		uint64_t allocations = gu_memory_get_total_stats().allocations;
+
+		queue->execute(r.cache);
+
+		// the second frame reuses the queue and recording storage
+		if (frame == 1)
+			CGD_CHECK(gu_memory_get_total_stats().allocations == allocations);
+
+		CGD_CHECK(queue->size() == 0);
+		CGD_CHECK(r.context->drawCount() == draws.size());
+
+		// vertex, pixel and (null) geometry shaders
+		CGD_CHECK(r.calls(CGDRenderCall::SHADER) == numEffects * 2 + 1);
+		CGD_CHECK(r.calls(CGDRenderCall::INPUT_LAYOUT) == numEffects);
+		CGD_CHECK(r.calls(CGDRenderCall::SHADER_RESOURCES) == numEffects * numMaterials);
+		CGD_CHECK(r.calls(CGDRenderCall::SAMPLERS) == 1);
+		CGD_CHECK(r.calls(CGDRenderCall::VERTEX_BUFFER) == numEffects * numMaterials * numMeshes);
+		CGD_CHECK(r.calls(CGDRenderCall::RASTERIZER_STATE) == 1);
+		CGD_CHECK(r.calls(CGDRenderCall::BLEND_STATE) == 1);
+
+		// each mesh uses its own constant range in both stages
+		CGD_CHECK(r.calls(CGDRenderCall::CONSTANT_BUFFERS) == numEffects * numMaterials * numMeshes * 2);
+
+		CGDRenderStats stats = r.cache->getStats();
+		CGD_CHECK(stats.callsIssued == r.context->stateCallCount() && stats.draws == draws.size());
+	}
+
+	queue->release();
+}
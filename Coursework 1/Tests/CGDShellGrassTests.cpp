@@ -0,0 +1,259 @@
+
+//
+// CGDShellGrassTests.cpp
+//
+
+// CGDShellGrass distance LOD, frustum and back face culling, and the draws of the grass replayed over the flythrough camera path as one draw per shell (the multi-pass fur technique) and as the single instanced draw of the visible shells.  Both are submitted through a render queue and state cache into a CGDRecordingContext, which counts the calls that would reach the device.
+
+#include <stdafx.h>
+#include <CGDShellGrass.h>
+#include <CGDCameraPath.h>
+#include <CGDRenderQueue.h>
+#include <CGDRecordingContext.h>
+#include <CGDSoftwareShaders.h>
+#include "CGDTest.h"
+#include <cstring>
+
+using namespace std;
+
+
+namespace {
+
+	// Grass as set up by Scene
+	CGDShellGrassDesc sceneGrass() {
+
+		CGDShellGrassDesc desc;
+
+		desc.bounds[0][0] = -50.0f; desc.bounds[0][1] = -2.0f; desc.bounds[0][2] = -50.0f;
+		desc.bounds[1][0] = 49.0f; desc.bounds[1][1] = -2.0f; desc.bounds[1][2] = 49.0f;
+		desc.height = 0.005f * 40;
+		desc.maxShells = 40;
+
+		return desc;
+	}
+
+	// World to clip space matrix of a camera at eye looking along direction with Scene's projection
+	CGDSoftwareMatrix viewProj(const float eye[3], const float direction[3]) {
+
+		float at[3] = { eye[0] + direction[0], eye[1] + direction[1], eye[2] + direction[2] };
+		float up[3] = { 0.0f, 1.0f, 0.0f };
+
+		return CGDSoftwareMatrix::LookAtLH(eye, at, up) * CGDSoftwareMatrix::PerspectiveFovLH(0.25f * 3.14f, 1.0f, 1.0f, 1000.0f);
+	}
+}
+
+
+CGD_TEST(ShellGrass, ShellCountFallsWithDistance) {
+
+	CGDShellGrass *grass = CGDShellGrass::CreateShellGrass(sceneGrass());
+	CGD_REQUIRE(grass);
+
+	const CGDShellGrassDesc& desc = grass->getDesc();
+
+	CGD_CHECK(grass->shellsForDistance(0.0f) == desc.maxShells);
+	CGD_CHECK(grass->shellsForDistance(desc.lodNear) == desc.maxShells);
+	CGD_CHECK(grass->shellsForDistance(desc.lodFar) == desc.minShells);
+	CGD_CHECK(grass->shellsForDistance(desc.cullDistance - 1.0f) == desc.minShells);
+	CGD_CHECK(grass->shellsForDistance(desc.cullDistance) == 0);
+
+	uint32_t previous = desc.maxShells;
+
+	for (float d = desc.lodNear; d <= desc.lodFar; d += 1.0f) {
+
+		uint32_t shells = grass->shellsForDistance(d);
+
+		CGD_CHECK(shells <= previous && shells >= desc.minShells);
+		previous = shells;
+	}
+
+	// distance is to the nearest point of the bounds
+	float inside[3] = { 0.0f, -2.0f, 0.0f };
+	float above[3] = { 0.0f, 8.0f, 0.0f };
+	float corner[3] = { 52.0f, -2.0f, 53.0f };
+
+	CGD_CHECK(grass->distance(inside) == 0.0f);
+	CGD_CHECK_NEAR(grass->distance(above), 10.0f, 1e-5);
+	CGD_CHECK_NEAR(grass->distance(corner), 5.0f, 1e-5);
+
+	grass->release();
+}
+
+
+CGD_TEST(ShellGrass, CullsBoxesAgainstTheFrustum) {
+
+	float eye[3] = { 0.0f, 0.0f, 0.0f };
+	float forward[3] = { 0.0f, 0.0f, 1.0f };
+	CGDSoftwareMatrix m = viewProj(eye, forward);
+	float planes[6][4];
+
+	CGDShellGrass::FrustumPlanes(&m.m[0][0], planes);
+
+	const float ahead[2][3] = { { -1.0f, -1.0f, 10.0f }, { 1.0f, 1.0f, 12.0f } };
+	const float behind[2][3] = { { -1.0f, -1.0f, -12.0f }, { 1.0f, 1.0f, -10.0f } };
+	const float beyondFar[2][3] = { { -1.0f, -1.0f, 1001.0f }, { 1.0f, 1.0f, 1002.0f } };
+	const float toTheSide[2][3] = { { 100.0f, -1.0f, 10.0f }, { 101.0f, 1.0f, 12.0f } };
+	const float spanning[2][3] = { { -100.0f, -1.0f, -100.0f }, { 100.0f, 1.0f, 100.0f } };
+
+	CGD_CHECK(CGDShellGrass::BoxInFrustum(planes, ahead[0], ahead[1]));
+	CGD_CHECK(!CGDShellGrass::BoxInFrustum(planes, behind[0], behind[1]));
+	CGD_CHECK(!CGDShellGrass::BoxInFrustum(planes, beyondFar[0], beyondFar[1]));
+	CGD_CHECK(!CGDShellGrass::BoxInFrustum(planes, toTheSide[0], toTheSide[1]));
+	CGD_CHECK(CGDShellGrass::BoxInFrustum(planes, spanning[0], spanning[1]));
+}
+
+
+CGD_TEST(ShellGrass, DrawsOnlyFrontFacingVisibleShells) {
+
+	CGDShellGrass *grass = CGDShellGrass::CreateShellGrass(sceneGrass());
+	CGD_REQUIRE(grass);
+
+	float down[3] = { 0.0f, -1.0f, 0.01f };
+	float up[3] = { 0.0f, 1.0f, 0.01f };
+
+	// looking down from well above the grass every shell is drawn
+	float high[3] = { 0.0f, 5.0f, 0.0f };
+	CGDSoftwareMatrix m = viewProj(high, down);
+	CGDShellRange range = grass->visibleShells(high, &m.m[0][0]);
+
+	CGD_CHECK(range.shellCount == 40);
+	CGD_CHECK(range.firstShell == 1);
+	CGD_CHECK(range.instanceCount == 40);
+
+	// from inside the grass only the shells below the eye face the camera - shell 20 is 0.1 above the ground
+	float low[3] = { 0.0f, -1.8975f, 0.0f };
+	float ahead[3] = { 0.0f, -0.1f, 1.0f };
+
+	m = viewProj(low, ahead);
+	range = grass->visibleShells(low, &m.m[0][0]);
+
+	CGD_CHECK(range.firstShell == 1);
+	CGD_CHECK(range.instanceCount == 20);
+
+	// nothing faces a camera below the ground, or one looking away from the grass
+	float below[3] = { 0.0f, -3.0f, 0.0f };
+
+	m = viewProj(below, up);
+	CGD_CHECK(grass->visibleShells(below, &m.m[0][0]).instanceCount == 0);
+
+	m = viewProj(high, up);
+	CGD_CHECK(grass->visibleShells(high, &m.m[0][0]).instanceCount == 0);
+
+	// or beyond the cull distance
+	float distant[3] = { 0.0f, 5.0f, 300.0f };
+	float back[3] = { 0.0f, -0.1f, -1.0f };
+
+	m = viewProj(distant, back);
+	range = grass->visibleShells(distant, &m.m[0][0]);
+
+	CGD_CHECK(range.shellCount == 0);
+	CGD_CHECK(range.instanceCount == 0);
+
+	grass->release();
+}
+
+
+CGD_TEST(ShellGrass, InstancedDrawReplacesOneDrawPerShell) {
+
+	CGDCameraPath *path = CGDCameraPath::LoadCameraPath("Resources/Benchmarks/flythrough.txt");
+	CGD_REQUIRE(path && path->keyframeCount() > 0);
+
+	CGDShellGrass *grass = CGDShellGrass::CreateShellGrass(sceneGrass());
+	const uint32_t maxShells = grass->getDesc().maxShells;
+
+	// [0] = one draw per shell, [1] = instanced
+	CGDRecordingContext *contexts[2];
+	CGDStateCache *stateCaches[2];
+	CGDRenderQueue *renderQueues[2];
+
+	for (int i = 0; i < 2; i++) {
+
+		contexts[i] = CGDRecordingContext::CreateRecordingContext();
+		stateCaches[i] = CGDStateCache::CreateStateCache(contexts[i]);
+		renderQueues[i] = CGDRenderQueue::CreateRenderQueue();
+	}
+
+	// Stand-in pipeline objects - the recording context only counts the calls made with them
+	static int effect, vertexShader, pixelShader, inputLayout, texture, sampler, vertexBuffer, indexBuffer, constantBuffers[41];
+
+	CGDDrawPacket packet;
+
+	memset(&packet, 0, sizeof(packet));
+
+	packet.vertexShader = &vertexShader;
+	packet.pixelShader = &pixelShader;
+	packet.inputLayout = &inputLayout;
+	packet.shaderResources[0] = &texture;
+	packet.numShaderResources = 1;
+	packet.sampler = &sampler;
+	packet.vertexBuffer = &vertexBuffer;
+	packet.vertexStride = 48;
+	packet.indexBuffer = &indexBuffer;
+	packet.topology = 4; // D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST
+	packet.indexCount = 99 * 99 * 6;
+
+	uint64_t shellsVisible = 0;
+	size_t frames = path->keyframeCount();
+
+	for (size_t i = 0; i < frames; i++) {
+
+		const CGDCameraKeyframe& k = path->keyframe(i);
+		CGDSoftwareMatrix viewProjMatrix = viewProj(k.position, k.direction);
+
+		// Each frame is recorded on a fresh context
+		for (int j = 0; j < 2; j++)
+			stateCaches[j]->invalidate();
+
+		uint64_t instancedDraws = contexts[1]->drawCount();
+
+		// Every shell with its own constant buffer (updated per pass with the shell height)
+		for (uint32_t s = 1; s <= maxShells; s++) {
+
+			packet.constants.buffer = &constantBuffers[s];
+			packet.instanceCount = 0;
+			renderQueues[0]->submit(renderQueues[0]->makeKey(1, &effect, &texture, &vertexBuffer, 0.0f), packet);
+		}
+
+		renderQueues[0]->execute(stateCaches[0]);
+
+		// The visible shells in one draw with one constant buffer
+		CGDShellRange range = grass->visibleShells(k.position, &viewProjMatrix.m[0][0]);
+
+		CGD_CHECK(range.instanceCount <= range.shellCount);
+
+		if (range.instanceCount > 0) {
+
+			packet.constants.buffer = &constantBuffers[0];
+			packet.instanceCount = range.instanceCount;
+			renderQueues[1]->submit(renderQueues[1]->makeKey(1, &effect, &texture, &vertexBuffer, 0.0f), packet);
+		}
+
+		renderQueues[1]->execute(stateCaches[1]);
+
+		CGD_CHECK(contexts[1]->drawCount() - instancedDraws == ((range.instanceCount > 0) ? 1u : 0u));
+
+		shellsVisible += range.instanceCount;
+	}
+
+	// the path flies over the grass
+	CGD_CHECK(shellsVisible > 0);
+
+	CGD_CHECK(contexts[0]->drawCount() == frames * maxShells);
+	CGD_CHECK(contexts[0]->instanceCount() == frames * maxShells);
+	CGD_CHECK(contexts[1]->drawCount() <= frames);
+	CGD_CHECK(contexts[1]->instanceCount() == shellsVisible);
+
+	// the vertex and pixel shader constant buffers are bound for every shell against at most once a frame, and there are fewer state calls overall
+	CGD_CHECK(contexts[0]->callCount(CGDRenderCall::CONSTANT_BUFFERS) == frames * maxShells * 2);
+	CGD_CHECK(contexts[1]->callCount(CGDRenderCall::CONSTANT_BUFFERS) <= frames * 2);
+	CGD_CHECK(contexts[1]->stateCallCount() < contexts[0]->stateCallCount());
+
+	for (int i = 0; i < 2; i++) {
+
+		renderQueues[i]->release();
+		stateCaches[i]->release();
+		contexts[i]->release();
+	}
+
+	grass->release();
+	path->release();
+}
@@ -0,0 +1,467 @@
+
+//
+// CGDSimulationTests.cpp
+//
+
+// CGDFixedStepLoop, CGDVirtualClock, CGDTripleBuffer and CGDSimulation run headless against a virtual clock.  Step and frame times are multiples of 1/1024 s so the accumulator is exact and step counts can be compared for equality.
+
+#include <stdafx.h>
+#include <CGDFixedStepLoop.h>
+#include <CGDTimeSource.h>
+#include <CGDTripleBuffer.h>
+#include <CGDSimulation.h>
+#include "CGDTest.h"
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+
+namespace {
+
+	const gu_seconds		stepSize = 1.0 / 64.0;
+
+	// Simulated state - position moving at constant speed
+	struct State {
+
+		gu_seconds			time;
+		double				x;
+	};
+
+	// Snapshot handed from the simulation to rendering
+	struct Snapshot {
+
+		State				previous;
+		State				current;
+		uint64_t			sequence;
+	};
+
+	// Run frames through a loop and return the final state.  If rendered is not nullptr the interpolated position of each frame is appended
+	State runFrames(const vector<gu_seconds>& frames, uint32_t maxSteps, vector<double> *rendered) {
+
+		CGDFixedStepLoop *loop = CGDFixedStepLoop::CreateFixedStepLoop(stepSize, maxSteps);
+		State state = { 0.0, 0.0 }, previous = state;
+
+		for (size_t i = 0; i < frames.size(); i++) {
+
+			loop->advance(frames[i], [&](gu_seconds time, gu_seconds dt) {
+
+				previous = state;
+				state.time = time;
+				state.x += 3.0 * dt;
+			});
+
+			if (rendered)
+				rendered->push_back(previous.x + (state.x - previous.x) * loop->alpha());
+		}
+
+		loop->release();
+
+		return state;
+	}
+
+	// Frame times summing to exactly 10 s, each a multiple of 1/1024 s between 2 ms and 33 ms
+	vector<gu_seconds> jitteredFrames(uint32_t seed) {
+
+		mt19937 rng(seed);
+		vector<gu_seconds> frames;
+		uint32_t remaining = 10 * 1024;
+
+		while (remaining > 0) {
+
+			uint32_t ticks = 2 + rng() % 32;
+
+			if (ticks > remaining)
+				ticks = remaining;
+
+			frames.push_back(ticks / 1024.0);
+			remaining -= ticks;
+		}
+
+		return frames;
+	}
+
+	// Poll condition until it holds or timeout seconds pass
+	template <typename Condition>
+	bool waitFor(Condition condition, double timeout = 5.0) {
+
+		chrono::steady_clock::time_point end = chrono::steady_clock::now() + chrono::milliseconds((int)(timeout * 1000.0));
+
+		while (!condition()) {
+
+			if (chrono::steady_clock::now() > end)
+				return false;
+
+			this_thread::sleep_for(chrono::microseconds(200));
+		}
+
+		return true;
+	}
+}
+
+
+CGD_TEST(FixedStepLoop, RejectsInvalidArguments) {
+
+	CGD_CHECK(CGDFixedStepLoop::CreateFixedStepLoop(0.0) == nullptr);
+	CGD_CHECK(CGDFixedStepLoop::CreateFixedStepLoop(-1.0) == nullptr);
+	CGD_CHECK(CGDFixedStepLoop::CreateFixedStepLoop(stepSize, 0) == nullptr);
+
+	CGD_CHECK(CGDFixedStepLoop::InterpolationAlpha(1.0, 0.0, 0.0) == 1.0f);
+}
+
+
+CGD_TEST(FixedStepLoop, StepsDoNotDependOnFrameRate) {
+
+	vector<gu_seconds> frames32(320, 1.0 / 32.0), frames128(1280, 1.0 / 128.0), jittered = jitteredFrames(1);
+
+	State a = runFrames(frames32, 8, nullptr);
+	State b = runFrames(frames128, 8, nullptr);
+	State c = runFrames(jittered, 8, nullptr);
+
+	// 10 s at 64 Hz
+	CGD_CHECK(a.time == 10.0 && b.time == 10.0 && c.time == 10.0);
+	CGD_CHECK(a.x == b.x && b.x == c.x);
+	CGD_CHECK_NEAR(a.x, 30.0, 1.0e-9);
+}
+
+
+CGD_TEST(FixedStepLoop, InterpolationIsSmooth) {
+
+	vector<gu_seconds> frames = jitteredFrames(2);
+	vector<double> rendered;
+
+	runFrames(frames, 8, &rendered);
+
+	// rendering runs one step behind real time at the same constant speed
+	gu_seconds renderTime = 0.0;
+	uint32_t nonMonotonic = 0;
+	double maxError = 0.0;
+
+	for (size_t i = 0; i < frames.size(); i++) {
+
+		renderTime += frames[i];
+
+		if (i > 0 && rendered[i] < rendered[i - 1])
+			nonMonotonic++;
+
+		if (renderTime >= stepSize)
+			maxError = max(maxError, fabs(rendered[i] - 3.0 * (renderTime - stepSize)));
+	}
+
+	CGD_CHECK(nonMonotonic == 0);
+	CGD_CHECK(maxError < 1.0e-5);
+
+	// alpha matches InterpolationAlpha against the last simulated state
+	CGDFixedStepLoop *loop = CGDFixedStepLoop::CreateFixedStepLoop(stepSize);
+	uint32_t alphaMismatches = 0;
+
+	renderTime = 0.0;
+
+	for (size_t i = 0; i < frames.size(); i++) {
+
+		renderTime += frames[i];
+
+		gu_seconds lastTime = 0.0;
+		uint32_t steps = loop->advance(frames[i], [&](gu_seconds time, gu_seconds) { lastTime = time; });
+
+		float alpha = loop->alpha();
+
+		if (alpha < 0.0f || alpha >= 1.0f || fabs(alpha - CGDFixedStepLoop::InterpolationAlpha(renderTime, loop->simulationTime(), stepSize)) > 1.0e-6f)
+			alphaMismatches++;
+
+		if (steps > 0 && lastTime != loop->simulationTime())
+			alphaMismatches++;
+	}
+
+	CGD_CHECK(alphaMismatches == 0);
+	CGD_CHECK(loop->simulationTime() == (gu_seconds)loop->stepCount() * stepSize);
+
+	CGD_CHECK(CGDFixedStepLoop::InterpolationAlpha(0.0, 1.0, stepSize) == 0.0f);
+	CGD_CHECK(CGDFixedStepLoop::InterpolationAlpha(2.0, 1.0, stepSize) == 1.0f);
+
+	loop->release();
+}
+
+
+CGD_TEST(FixedStepLoop, DropsTimeAfterAStall) {
+
+	CGDFixedStepLoop *loop = CGDFixedStepLoop::CreateFixedStepLoop(stepSize, 4);
+	CGD_REQUIRE(loop);
+
+	// a 1 s stall runs 4 steps and drops the remaining whole steps but keeps the fraction of a step
+	uint32_t steps = loop->advance(1.0 + 0.25 * stepSize, [](gu_seconds, gu_seconds) {});
+
+	CGD_CHECK(steps == 4);
+	CGD_CHECK(loop->clampedAdvanceCount() == 1);
+	CGD_CHECK_NEAR(loop->timeDropped(), 1.0 - 4.0 * stepSize, 1.0e-12);
+	CGD_CHECK_NEAR(loop->alpha(), 0.25, 1.0e-6);
+
+	// the next frame is back to normal
+	CGD_CHECK(loop->advance(stepSize, [](gu_seconds, gu_seconds) {}) == 1);
+	CGD_CHECK(loop->clampedAdvanceCount() == 1);
+
+	// negative frame times are ignored
+	CGD_CHECK(loop->advance(-1.0, [](gu_seconds, gu_seconds) {}) == 0);
+	CGD_CHECK_NEAR(loop->alpha(), 0.25, 1.0e-6);
+
+	loop->reset();
+
+	CGD_CHECK(loop->stepCount() == 0 && loop->simulationTime() == 0.0 && loop->accumulatedTime() == 0.0);
+
+	loop->release();
+}
+
+
+CGD_TEST(Simulation, VirtualClockWakesWaiters) {
+
+	CGDVirtualClock *clock = CGDVirtualClock::CreateVirtualClock(5.0);
+	CGD_REQUIRE(clock);
+
+	CGD_CHECK(clock->now() == 5.0);
+
+	clock->advance(-1.0);
+	clock->advance(0.5);
+
+	CGD_CHECK(clock->now() == 5.5);
+
+	// waitUntil returns immediately for a time that has passed
+	clock->waitUntil(5.0);
+
+	// and blocks until another thread advances the clock far enough
+	atomic<bool> woken(false);
+
+	thread waiter([&]() {
+
+		clock->waitUntil(7.0);
+		woken = true;
+	});
+
+	clock->advance(1.0);
+	this_thread::sleep_for(chrono::milliseconds(10));
+
+	CGD_CHECK(!woken);
+
+	clock->advance(1.0);
+	waiter.join();
+
+	CGD_CHECK(woken);
+
+	// interrupt releases current and future waiters
+	thread interrupted([&]() { clock->waitUntil(100.0); });
+
+	clock->interrupt();
+	interrupted.join();
+
+	clock->waitUntil(100.0);
+
+	clock->release();
+}
+
+
+CGD_TEST(Simulation, TripleBufferHandsOffLatestValue) {
+
+	CGDTripleBuffer<uint64_t> buffer;
+
+	buffer.reset(0);
+
+	CGD_CHECK(!buffer.acquire());
+	CGD_CHECK(buffer.readBuffer() == 0);
+
+	// values published between two acquires are skipped
+	for (uint64_t v = 1; v <= 3; v++) {
+
+		buffer.writeBuffer() = v;
+		buffer.publish();
+	}
+
+	CGD_CHECK(buffer.acquire());
+	CGD_CHECK(buffer.readBuffer() == 3);
+	CGD_CHECK(!buffer.acquire());
+
+	// producer and consumer threads - the consumer sees increasing, untorn values
+	CGDTripleBuffer<Snapshot> snapshots;
+	Snapshot zero = { { 0.0, 0.0 }, { 0.0, 0.0 }, 0 };
+
+	snapshots.reset(zero);
+
+	const uint64_t count = 200000;
+
+	thread producer([&]() {
+
+		for (uint64_t i = 1; i <= count; i++) {
+
+			Snapshot& s = snapshots.writeBuffer();
+
+			s.previous.time = (double)(i - 1);
+			s.previous.x = (double)(i - 1) * 2.0;
+			s.current.time = (double)i;
+			s.current.x = (double)i * 2.0;
+			s.sequence = i;
+
+			snapshots.publish();
+		}
+	});
+
+	uint64_t last = 0, bad = 0;
+
+	while (last < count) {
+
+		if (!snapshots.acquire())
+			continue;
+
+		const Snapshot& s = snapshots.readBuffer();
+
+		if (s.sequence <= last || s.current.time != (double)s.sequence || s.current.x != 2.0 * s.current.time || s.previous.time != s.current.time - 1.0)
+			bad++;
+
+		last = s.sequence;
+	}
+
+	producer.join();
+
+	CGD_CHECK(bad == 0);
+	CGD_CHECK(last == count);
+}
+
+
+CGD_TEST(Simulation, InlineStepsFollowTheClock) {
+
+	CGDVirtualClock *clock = CGDVirtualClock::CreateVirtualClock();
+
+	CGD_CHECK(CGDSimulation::CreateSimulation(nullptr, stepSize, [](gu_seconds, gu_seconds) {}, false) == nullptr);
+	CGD_CHECK(CGDSimulation::CreateSimulation(clock, 0.0, [](gu_seconds, gu_seconds) {}, false) == nullptr);
+
+	thread::id mainThread = this_thread::get_id();
+	uint32_t offThread = 0;
+	gu_seconds lastTime = 0.0;
+
+	CGDSimulation *simulation = CGDSimulation::CreateSimulation(clock, stepSize, [&](gu_seconds time, gu_seconds) {
+
+		if (this_thread::get_id() != mainThread)
+			offThread++;
+
+		lastTime = time;
+
+	}, false);
+
+	CGD_REQUIRE(simulation);
+	CGD_CHECK(!simulation->isThreaded());
+	CGD_CHECK(simulation->getStepSize() == stepSize);
+
+	// 256 Hz frames - a step every 4 frames
+	for (int frame = 1; frame <= 256; frame++) {
+
+		clock->advance(1.0 / 256.0);
+		simulation->update();
+
+		CGD_CHECK(simulation->stepCount() == (uint64_t)(frame / 4));
+	}
+
+	CGD_CHECK(lastTime == 1.0);
+	CGD_CHECK(offThread == 0);
+
+	// a paused clock (not advanced) takes no steps
+	simulation->update();
+	simulation->update();
+
+	CGD_CHECK(simulation->stepCount() == 64);
+
+	// a stall larger than maxStepsPerUpdate steps is clamped
+	clock->advance(1.0);
+	simulation->update();
+
+	CGD_CHECK(simulation->stepCount() == 64 + 8);
+	CGD_CHECK(simulation->clampedUpdateCount() == 1);
+
+	simulation->release();
+	clock->release();
+}
+
+
+CGD_TEST(Simulation, ThreadedStepsHandOffSnapshots) {
+
+	CGDVirtualClock *clock = CGDVirtualClock::CreateVirtualClock();
+
+	CGDTripleBuffer<Snapshot> snapshots;
+	Snapshot zero = { { 0.0, 0.0 }, { 0.0, 0.0 }, 0 };
+
+	snapshots.reset(zero);
+
+	State state = { 0.0, 0.0 };
+	uint64_t sequence = 0;
+	thread::id mainThread = this_thread::get_id();
+	atomic<uint32_t> onMainThread(0);
+
+	// a large step limit so a simulation thread that falls behind catches up instead of dropping time
+	CGDSimulation *simulation = CGDSimulation::CreateSimulation(clock, stepSize, [&](gu_seconds time, gu_seconds dt) {
+
+		if (this_thread::get_id() == mainThread)
+			onMainThread++;
+
+		Snapshot& s = snapshots.writeBuffer();
+
+		s.previous = state;
+		state.time = time;
+		state.x += dt;
+		s.current = state;
+		s.sequence = ++sequence;
+
+		snapshots.publish();
+
+	}, true, 1000000);
+
+	CGD_REQUIRE(simulation);
+	CGD_CHECK(simulation->isThreaded());
+
+	// update does nothing on a threaded simulation
+	clock->advance(stepSize);
+	simulation->update();
+
+	CGD_CHECK(waitFor([&]() { return simulation->stepCount() == 1; }));
+
+	uint64_t lastSequence = 0;
+	uint32_t bad = 0;
+
+	// 16 s of 256 Hz frames, consuming the latest snapshot each frame
+	for (int frame = 0; frame < 16 * 256; frame++) {
+
+		clock->advance(1.0 / 256.0);
+
+		if (snapshots.acquire()) {
+
+			const Snapshot& s = snapshots.readBuffer();
+
+			if (s.sequence < lastSequence || s.current.time != (gu_seconds)s.sequence * stepSize || s.current.x - s.previous.x != stepSize)
+				bad++;
+
+			lastSequence = s.sequence;
+		}
+
+		if (frame % 64 == 0)
+			this_thread::yield();
+	}
+
+	// the simulation catches up with the clock and then waits for it
+	uint64_t expected = 1 + 16 * 64;
+
+	CGD_CHECK(waitFor([&]() { return simulation->stepCount() == expected; }));
+
+	this_thread::sleep_for(chrono::milliseconds(20));
+
+	CGD_CHECK(simulation->stepCount() == expected);
+	CGD_CHECK(simulation->clampedUpdateCount() == 0);
+
+	CGD_CHECK(bad == 0);
+	CGD_CHECK(onMainThread == 0);
+
+	// the destructor interrupts the clock to stop the thread
+	simulation->release();
+
+	CGD_CHECK(sequence == expected);
+	CGD_CHECK(state.time == (gu_seconds)expected * stepSize);
+
+	clock->release();
+}
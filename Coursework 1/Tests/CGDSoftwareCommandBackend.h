@@ -0,0 +1,157 @@
+//
+// CGDSoftwareCommandBackend.h
+//
+
+// Command list recording backend for testing CGDPassScheduler without a device.  A context is a list of integer commands.  Commands recorded on the immediate context go straight into the submitted stream, which models the GPU's command queue, and executing a command list appends its commands to the same stream - so the submitted stream of a frame is comparable between serial and parallel execution.  The backend counts the misuse the scheduler must avoid: two threads recording into one context at the same time, immediate context or command list use off the thread that created the backend, and command lists that are never released.  finishRecording can be made to fail to model a device that cannot close a command list.
+
+#pragma once
+
+#include <CGDPassScheduler.h>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+
+class CGDSoftwareCommandBackend : public CGDCommandBackend {
+
+public:
+
+	// Recording context
+	struct Context {
+
+		std::vector<uint32_t>		commands;
+		std::atomic<bool>			recording;
+		std::atomic<uint64_t>		overlaps; // Record calls made while another thread was recording into the context
+
+		Context() : recording(false), overlaps(0) {}
+	};
+
+private:
+
+	std::vector<Context*>			contexts;
+	Context							immediate;
+	std::thread::id					ownerThread;
+
+	std::atomic<uint64_t>			wrongThreadCalls;
+	std::atomic<int64_t>			liveLists;
+	std::atomic<uint64_t>			listsFinished;
+	std::atomic<uint32_t>			failEvery; // 0 = never fail, n = every n-th finishRecording returns nullptr
+
+
+	// Constructor - called internally by the CreateSoftwareCommandBackend factory method
+	CGDSoftwareCommandBackend(uint32_t numContexts) : ownerThread(std::this_thread::get_id()), wrongThreadCalls(0), liveLists(0), listsFinished(0), failEvery(0) {
+
+		for (uint32_t i = 0; i < numContexts; i++)
+			contexts.push_back(new Context());
+	}
+
+	void checkOwnerThread() {
+
+		if (std::this_thread::get_id() != ownerThread)
+			wrongThreadCalls++;
+	}
+
+public:
+
+	// Software backend factory method.  numContexts = 0 models a device without command list support.  The calling thread owns the immediate context
+	static CGDSoftwareCommandBackend* CreateSoftwareCommandBackend(uint32_t numContexts) {
+
+		return new CGDSoftwareCommandBackend(numContexts);
+	}
+
+	// Destructor
+	~CGDSoftwareCommandBackend() {
+
+		for (size_t i = 0; i < contexts.size(); i++)
+			delete contexts[i];
+	}
+
+	// Append command to context (called by pass functions with the context they are given)
+	static void Record(void *context, uint32_t command) {
+
+		Context *c = (Context*)context;
+
+		if (c->recording.exchange(true, std::memory_order_acquire)) {
+
+			c->overlaps++;
+			return;
+		}
+
+		c->commands.push_back(command);
+		c->recording.store(false, std::memory_order_release);
+	}
+
+	// Commands submitted to the immediate context (directly or by executing command lists) since the last clearSubmitted
+	const std::vector<uint32_t>& submitted() const { return immediate.commands; }
+	void clearSubmitted() { immediate.commands.clear(); }
+
+	// Make every n-th finishRecording fail (0 = never)
+	void setFailEvery(uint32_t n) { failEvery = n; }
+
+	// Query methods
+	uint64_t overlappingRecordCount() const {
+
+		uint64_t count = immediate.overlaps;
+
+		for (size_t i = 0; i < contexts.size(); i++)
+			count += contexts[i]->overlaps;
+
+		return count;
+	}
+
+	uint64_t wrongThreadCallCount() const { return wrongThreadCalls; }
+	int64_t liveCommandListCount() const { return liveLists; }
+	uint64_t finishedCommandListCount() const { return listsFinished; }
+
+
+	// CGDCommandBackend interface
+
+	uint32_t recordingContextCount() const { return (uint32_t)contexts.size(); }
+
+	void* recordingContext(uint32_t index) { return contexts[index]; }
+
+	void* immediateContext() {
+
+		checkOwnerThread();
+
+		return &immediate;
+	}
+
+	void* finishRecording(uint32_t index) {
+
+		uint64_t n = ++listsFinished;
+		uint32_t every = failEvery;
+
+		if (every && n % every == 0) {
+
+			contexts[index]->commands.clear();
+			return nullptr;
+		}
+
+		liveLists++;
+
+		std::vector<uint32_t> *list = new std::vector<uint32_t>();
+		list->swap(contexts[index]->commands);
+
+		return list;
+	}
+
+	void executeCommandList(void *commandList) {
+
+		checkOwnerThread();
+
+		const std::vector<uint32_t> *list = (const std::vector<uint32_t>*)commandList;
+
+		immediate.commands.insert(immediate.commands.end(), list->begin(), list->end());
+	}
+
+	void releaseCommandList(void *commandList) {
+
+		checkOwnerThread();
+
+		delete (std::vector<uint32_t>*)commandList;
+		liveLists--;
+	}
+};
+
@@ -0,0 +1,428 @@
+
+//
+// CGDSparseMatrixTests.cpp
+//
+
+#include <stdafx.h>
+#include <CoreStructures/matrix_sparse.h>
+#include "CGDTest.h"
+#include <atomic>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+using namespace std;
+using namespace CoreStructures;
+
+
+// (w x h) grid triangulated with 2 faces per quad
+static vector<int> gridFaces(unsigned int w, unsigned int h) {
+
+	vector<int> faces;
+
+	for (unsigned int j = 0; j + 1 < h; j++) {
+
+		for (unsigned int i = 0; i + 1 < w; i++) {
+
+			int v0 = int(j * w + i), v1 = v0 + 1, v2 = v0 + int(w), v3 = v2 + 1;
+
+			faces.push_back(v0); faces.push_back(v2); faces.push_back(v1);
+			faces.push_back(v1); faces.push_back(v2); faces.push_back(v3);
+		}
+	}
+
+	return faces;
+}
+
+
+// Uniform random number in [0, 1) (xorshift)
+static double randomValue(uint32_t& state) {
+
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+
+	return (double)(state >> 8) / 16777216.0;
+}
+
+
+// count random (i, j) elements of an (n x m) matrix with values in [-1, 1).  Some (i, j) repeat so duplicates are summed
+static vector<sparse_triplet<double> > randomTriplets(unsigned int n, unsigned int m, size_t count, uint32_t seed) {
+
+	vector<sparse_triplet<double> > t;
+	uint32_t state = seed;
+
+	for (size_t k = 0; k < count; k++) {
+
+		unsigned int i = (unsigned int)(randomValue(state) * n), j = (unsigned int)(randomValue(state) * m);
+
+		t.push_back(sparse_triplet<double>(i, j, randomValue(state) * 2.0 - 1.0));
+	}
+
+	return t;
+}
+
+
+// Random sparse symmetric matrix with off-diagonal values of mixed sign and magnitude, made positive-definite by a strictly dominant diagonal
+static sparse_matrix<double> randomSPD(unsigned int n, size_t offDiagonal, uint32_t seed) {
+
+	vector<sparse_triplet<double> > t;
+	vector<double> d(n, 0.0);
+	uint32_t state = seed;
+
+	for (size_t k = 0; k < offDiagonal; k++) {
+
+		unsigned int i = (unsigned int)(randomValue(state) * n), j = (unsigned int)(randomValue(state) * n);
+		double v = (randomValue(state) * 2.0 - 1.0) * ((k % 3 == 0) ? 100.0 : 1.0);
+
+		if (i == j)
+			continue;
+
+		t.push_back(sparse_triplet<double>(i, j, v));
+		t.push_back(sparse_triplet<double>(j, i, v));
+		d[i] += fabs(v);
+		d[j] += fabs(v);
+	}
+
+	for (unsigned int i = 0; i < n; i++)
+		t.push_back(sparse_triplet<double>(i, i, d[i] + 0.01 + randomValue(state)));
+
+	return sparse_matrix<double>::from_triplets(n, n, t);
+}
+
+
+// ||Ax - b|| / ||b||
+static double relativeResidual(const sparse_matrix<double>& A, const vector<double>& x, const vector<double>& b) {
+
+	vector<double> r = b;
+	double rr = 0.0, bb = 0.0;
+
+	A.spmv(x.data(), r.data(), -1.0, 1.0);
+
+	for (size_t i = 0; i < b.size(); i++) {
+
+		rr += r[i] * r[i];
+		bb += b[i] * b[i];
+	}
+
+	return sqrt(rr / bb);
+}
+
+
+// Return true if P holds each of 0..n-1 once
+static bool isPermutation(const vector<unsigned int>& P, unsigned int n) {
+
+	vector<bool> seen(n, false);
+
+	if (P.size() != n)
+		return false;
+
+	for (unsigned int k : P) {
+
+		if (k >= n || seen[k])
+			return false;
+
+		seen[k] = true;
+	}
+
+	return true;
+}
+
+
+CGD_TEST(SparseMatrix, SubtractingItselfStoresNothing) {
+
+	vector<sparse_triplet<double> > t;
+	t.push_back(sparse_triplet<double>(0, 0, 2.0));
+	t.push_back(sparse_triplet<double>(0, 2, -1.0));
+	t.push_back(sparse_triplet<double>(1, 1, 3.0));
+	t.push_back(sparse_triplet<double>(2, 0, 4.0));
+
+	sparse_matrix<double> A = sparse_matrix<double>::from_triplets(3, 3, t);
+	sparse_matrix<double> B = sparse_matrix<double>::from_triplets(3, 3, t, gu_sparse_csc);
+
+	CGD_CHECK(A.nnz() == 4);
+	CGD_CHECK((A - A).nnz() == 0);
+	CGD_CHECK((A - B).nnz() == 0);
+	CGD_CHECK((A + A).nnz() == 4);
+}
+
+
+CGD_TEST(SparseMatrix, LaplacianRowsSumToZero) {
+
+	vector<int> faces = gridFaces(8, 6);
+	sparse_matrix<double> L = uniform_laplacian<double>(48, faces.data(), (unsigned int)(faces.size() / 3));
+
+	vector<double> ones(48, 1.0), y(48, 1.0);
+	L.spmv(ones.data(), y.data());
+
+	for (size_t i = 0; i < y.size(); i++)
+		CGD_CHECK_NEAR(y[i], 0.0, 1.0e-12);
+
+	CGD_CHECK(L.is_symmetric());
+}
+
+
+CGD_TEST(SparseMatrix, SolversAgreeOnSmoothingSystem) {
+
+	const unsigned int w = 20, h = 15, n = w * h;
+
+	vector<int> faces = gridFaces(w, h);
+	sparse_matrix<double> A = smoothing_system(uniform_laplacian<double>(n, faces.data(), (unsigned int)(faces.size() / 3)), 0.5);
+
+	vector<double> xTrue(n), b(n, 0.0);
+
+	for (unsigned int i = 0; i < n; i++)
+		xTrue[i] = double(i % 7) - 3.0;
+
+	A.spmv(xTrue.data(), b.data());
+
+	vector<double> xp;
+	unsigned int iterations = 0;
+	CGD_REQUIRE(pcg_solve(A, b, &xp, gu_precond_jacobi, 1.0e-12, 1000, &iterations) == gu_pcg_converged);
+
+	sparse_cholesky<double> chol;
+	CGD_REQUIRE(chol.compute(A, true) == gu_cholesky_okay);
+
+	vector<double> xc = chol.solve(b);
+	CGD_REQUIRE(xc.size() == n);
+
+	for (unsigned int i = 0; i < n; i++) {
+
+		CGD_CHECK_NEAR(xp[i], xTrue[i], 1.0e-8);
+		CGD_CHECK_NEAR(xc[i], xTrue[i], 1.0e-9);
+	}
+}
+
+
+CGD_TEST(SparseMatrix, PoolRunsEveryBlockOnce) {
+
+	gu_parallel_pool pool(4);
+	const size_t numBlocks = 257;
+	unique_ptr<atomic<int>[]> runs(new atomic<int>[numBlocks]);
+	bool exact = true;
+
+	// the same workers run operation after operation
+	for (int k = 0; k < 200; k++) {
+
+		for (size_t b = 0; b < numBlocks; b++)
+			runs[b] = 0;
+
+		CGD_CHECK(pool.run(numBlocks, [&](size_t b) { runs[b]++; }));
+
+		for (size_t b = 0; b < numBlocks; b++)
+			exact = exact && runs[b] == 1;
+	}
+
+	CGD_CHECK(exact);
+	CGD_CHECK(pool.thread_count() == 4);
+
+	// a pool without workers runs nothing
+	gu_parallel_pool single(1);
+
+	CGD_CHECK(!single.run(numBlocks, [&](size_t b) { runs[b]++; }));
+}
+
+
+CGD_TEST(SparseMatrix, PoolRefusesNestedOperations) {
+
+	gu_parallel_pool pool(3);
+	atomic<int> nestedRuns(0), blocks(0);
+
+	CGD_CHECK(pool.run(16, [&](size_t) {
+
+		if (pool.run(4, [&](size_t) { blocks++; }))
+			nestedRuns++;
+
+		blocks++;
+	}));
+
+	CGD_CHECK(nestedRuns == 0);
+	CGD_CHECK(blocks == 16);
+}
+
+
+CGD_TEST(SparseMatrix, TransposeAndConversionRoundTrip) {
+
+	vector<sparse_triplet<double> > t = randomTriplets(7, 11, 40, 1);
+
+	for (int f = 0; f < 2; f++) {
+
+		gu_sparse_format format = (f == 0) ? gu_sparse_csr : gu_sparse_csc, other = (f == 0) ? gu_sparse_csc : gu_sparse_csr;
+		sparse_matrix<double> A = sparse_matrix<double>::from_triplets(7, 11, t, format);
+		sparse_matrix<double> At = A.transpose(), Att = At.transpose(), C = A.convert(other).convert(format);
+
+		CGD_CHECK(At.rows() == 11 && At.columns() == 7 && At.storage_format() == format);
+
+		for (unsigned int i = 0; i < 7; i++)
+			for (unsigned int j = 0; j < 11; j++)
+				CGD_CHECK(At(j, i) == A(i, j));
+
+		// round trips give back the same storage, not just the same elements
+		CGD_CHECK(Att.pointers() == A.pointers() && Att.indices() == A.indices() && Att.values() == A.values());
+		CGD_CHECK(C.pointers() == A.pointers() && C.indices() == A.indices() && C.values() == A.values());
+		CGD_CHECK(A.convert(other).storage_format() == other);
+	}
+}
+
+
+CGD_TEST(SparseMatrix, SpmvMatchesDenseReference) {
+
+	const double alpha = 2.5, beta = -0.5;
+
+	// Small rectangular matrices (on the calling thread) and a large one above parallel_nnz_threshold
+	const unsigned int orders[2][2] = { { 40, 25 }, { 30000, 20000 } };
+	const size_t counts[2] = { 300, 3 * sparse_matrix<double>::parallel_nnz_threshold };
+
+	for (int s = 0; s < 2; s++) {
+
+		unsigned int n = orders[s][0], m = orders[s][1];
+		vector<sparse_triplet<double> > t = randomTriplets(n, m, counts[s], 2 + s);
+		vector<double> x(m), y0(n), yRef(n);
+		uint32_t state = 9;
+
+		for (unsigned int j = 0; j < m; j++)
+			x[j] = randomValue(state) * 2.0 - 1.0;
+
+		for (unsigned int i = 0; i < n; i++)
+			yRef[i] = beta * (y0[i] = randomValue(state));
+
+		// the reference is a dense product for the small matrix and sums the triplets directly for the large one
+		if (s == 0) {
+
+			vector<double> D(n * m, 0.0);
+
+			for (const auto& e : t)
+				D[e.i * m + e.j] += e.value;
+
+			for (unsigned int i = 0; i < n; i++)
+				for (unsigned int j = 0; j < m; j++)
+					yRef[i] += alpha * D[i * m + j] * x[j];
+
+		} else {
+
+			for (const auto& e : t)
+				yRef[e.i] += alpha * e.value * x[e.j];
+		}
+
+		for (int f = 0; f < 2; f++) {
+
+			sparse_matrix<double> A = sparse_matrix<double>::from_triplets(n, m, t, (f == 0) ? gu_sparse_csr : gu_sparse_csc);
+			vector<double> y = y0;
+			double worst = 0.0;
+
+			A.spmv(x.data(), y.data(), alpha, beta);
+
+			for (unsigned int i = 0; i < n; i++)
+				worst = max(worst, fabs(y[i] - yRef[i]));
+
+			CGD_CHECK(worst <= 1.0e-12);
+			CGD_CHECK((s == 1) == (A.nnz() >= sparse_matrix<double>::parallel_nnz_threshold));
+		}
+	}
+}
+
+
+CGD_TEST(SparseMatrix, AMDOrderingReducesGridFill) {
+
+	const unsigned int w = 30, h = 30, n = w * h;
+
+	vector<int> faces = gridFaces(w, h);
+	sparse_matrix<double> A = smoothing_system(uniform_laplacian<double>(n, faces.data(), (unsigned int)(faces.size() / 3)), 1.0);
+
+	CGD_CHECK(isPermutation(amd_ordering(A), n));
+
+	sparse_cholesky<double> amd, natural;
+
+	CGD_REQUIRE(amd.compute(A, true) == gu_cholesky_okay);
+	CGD_REQUIRE(natural.compute(A, false) == gu_cholesky_okay);
+
+	CGD_CHECK(isPermutation(amd.permutation(), n));
+	CGD_CHECK(amd.nnz_L() <= natural.nnz_L());
+}
+
+
+CGD_TEST(SparseMatrix, CholeskySolvesRandomSPDSystem) {
+
+	const unsigned int n = 600;
+
+	sparse_matrix<double> A = randomSPD(n, 3000, 5);
+	CGD_REQUIRE(A.is_symmetric());
+
+	vector<double> b(n);
+	uint32_t state = 11;
+
+	for (unsigned int i = 0; i < n; i++)
+		b[i] = randomValue(state) * 10.0 - 5.0;
+
+	for (int useAMD = 0; useAMD < 2; useAMD++) {
+
+		sparse_cholesky<double> chol;
+		CGD_REQUIRE(chol.compute(A, useAMD != 0) == gu_cholesky_okay);
+
+		vector<double> x = chol.solve(b);
+		CGD_REQUIRE(x.size() == n);
+
+		CGD_CHECK(relativeResidual(A, x, b) <= 1.0e-12);
+	}
+}
+
+
+CGD_TEST(SparseMatrix, PCGStopsAtIterationCap) {
+
+	const unsigned int w = 40, h = 40, n = w * h;
+
+	vector<int> faces = gridFaces(w, h);
+	sparse_matrix<double> A = smoothing_system(uniform_laplacian<double>(n, faces.data(), (unsigned int)(faces.size() / 3)), 10.0);
+	vector<double> b(n);
+	uint32_t state = 13;
+
+	for (unsigned int i = 0; i < n; i++)
+		b[i] = randomValue(state);
+
+	vector<double> x;
+	unsigned int iterations = 0;
+	double residual = 0.0;
+
+	// too few iterations to converge - the cap is honoured and the residual reported is the real one
+	CGD_CHECK(pcg_solve(A, b, &x, gu_precond_none, 1.0e-10, 5, &iterations, &residual) == gu_pcg_max_iterations);
+	CGD_CHECK(iterations == 5);
+	CGD_CHECK(residual > 1.0e-10);
+	CGD_CHECK_NEAR(relativeResidual(A, x, b), residual, 1.0e-8);
+
+	// enough iterations - converges within the cap
+	x.clear();
+
+	CGD_CHECK(pcg_solve(A, b, &x, gu_precond_jacobi, 1.0e-10, 1000, &iterations, &residual) == gu_pcg_converged);
+	CGD_CHECK(iterations > 5 && iterations < 1000);
+	CGD_CHECK(residual <= 1.0e-10);
+	CGD_CHECK(relativeResidual(A, x, b) <= 1.0e-9);
+}
+
+
+CGD_TEST(SparseMatrix, FactoriseRejectsNonSPDMatrices) {
+
+	// Symmetric but indefinite (eigenvalues 3 and -1)
+	vector<sparse_triplet<double> > t;
+	t.push_back(sparse_triplet<double>(0, 0, 1.0));
+	t.push_back(sparse_triplet<double>(0, 1, 2.0));
+	t.push_back(sparse_triplet<double>(1, 0, 2.0));
+	t.push_back(sparse_triplet<double>(1, 1, 1.0));
+
+	sparse_matrix<double> indefinite = sparse_matrix<double>::from_triplets(2, 2, t);
+	sparse_cholesky<double> chol;
+
+	CGD_CHECK(chol.compute(indefinite) == gu_cholesky_not_pd);
+	CGD_CHECK(chol.solve(vector<double>(2, 1.0)).empty());
+
+	// The symbolic analysis of an SPD matrix is reused for a negative-definite matrix with the same pattern
+	sparse_matrix<double> A = randomSPD(200, 800, 7);
+
+	CGD_REQUIRE(chol.compute(A) == gu_cholesky_okay);
+	CGD_CHECK(!chol.solve(vector<double>(200, 1.0)).empty());
+
+	CGD_CHECK(chol.factorise(A * -1.0) == gu_cholesky_not_pd);
+	CGD_CHECK(chol.solve(vector<double>(200, 1.0)).empty());
+
+	// a non-square matrix is not factorised
+	CGD_CHECK(chol.compute(sparse_matrix<double>::from_triplets(3, 2, t)) != gu_cholesky_okay);
+}
@@ -0,0 +1,120 @@
+//
+// CGDStubPipelineDevice.h
+//
+
+// Pipeline object source for testing CGDPipelineCache without a device.  Objects are small heap records that remember their type, creation descriptor and bytecode and carry a reference count, so tests can check how many objects were created, that every reference the cache takes is released and that objects referenced elsewhere outlive a purge.  Creation of a given object type can be made to fail to model invalid descriptors.
+
+#pragma once
+
+#include <CGDPipelineCache.h>
+#include <cstdint>
+#include <set>
+
+
+class CGDStubPipelineDevice : public CGDPipelineDevice {
+
+public:
+
+	// Object returned by createObject
+	struct Object {
+
+		CGDPipelineObjectType		type;
+		const void					*desc;
+		const CGDShaderBytecode		*bytecode;
+		int							refCount;
+	};
+
+private:
+
+	std::set<Object*>			liveObjects;
+	uint32_t					created[(int)CGDPipelineObjectType::NUM_TYPES];
+	bool						failing[(int)CGDPipelineObjectType::NUM_TYPES];
+	uint64_t					invalidReferences = 0; // retain / release of objects that were not created here or have been destroyed
+
+
+	// Constructor - called internally by the CreateStubPipelineDevice factory method
+	CGDStubPipelineDevice() {
+
+		for (int t = 0; t < (int)CGDPipelineObjectType::NUM_TYPES; t++) {
+
+			created[t] = 0;
+			failing[t] = false;
+		}
+	}
+
+public:
+
+	// Stub device factory method
+	static CGDStubPipelineDevice* CreateStubPipelineDevice() {
+
+		return new CGDStubPipelineDevice();
+	}
+
+	// Destructor.  Objects still referenced are destroyed
+	~CGDStubPipelineDevice() {
+
+		for (auto object : liveObjects)
+			delete object;
+	}
+
+	// Make creation of the given object type fail (createObject returns nullptr)
+	void setFailing(CGDPipelineObjectType type, bool fail) { failing[(int)type] = fail; }
+
+	// Query methods
+	uint32_t createdCount(CGDPipelineObjectType type) const { return created[(int)type]; }
+	size_t liveObjectCount() const { return liveObjects.size(); }
+	uint64_t invalidReferenceCount() const { return invalidReferences; }
+
+	bool isLive(void *object) const { return liveObjects.count((Object*)object) > 0; }
+
+	int refCount(void *object) const { return isLive(object) ? ((Object*)object)->refCount : 0; }
+
+
+	// CGDPipelineDevice interface
+
+	void* createObject(CGDPipelineObjectType type, const void *desc, const CGDShaderBytecode *bytecode) {
+
+		if (failing[(int)type])
+			return nullptr;
+
+		Object *object = new Object();
+
+		object->type = type;
+		object->desc = desc;
+		object->bytecode = bytecode;
+		object->refCount = 1;
+
+		liveObjects.insert(object);
+		created[(int)type]++;
+
+		return object;
+	}
+
+	void retainObject(void *object) {
+
+		if (!isLive(object)) {
+
+			invalidReferences++;
+			return;
+		}
+
+		((Object*)object)->refCount++;
+	}
+
+	void releaseObject(void *object) {
+
+		if (!isLive(object)) {
+
+			invalidReferences++;
+			return;
+		}
+
+		Object *o = (Object*)object;
+
+		if (--o->refCount == 0) {
+
+			liveObjects.erase(o);
+			delete o;
+		}
+	}
+};
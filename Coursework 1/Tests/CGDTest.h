@@ -0,0 +1,51 @@
+//
+// CGDTest.h
+//
+
+// Minimal unit test framework for the portable build (see CMakeLists.txt).  Tests are declared with CGD_TEST(suite, name) and register themselves during static initialisation.  CGD_CHECK records a failure and carries on with the test, CGD_REQUIRE records a failure and returns from the test.  CGDTestMain.cpp runs the tests of the suites named on the command line (or every test) and returns the number of failed tests as the process exit code.
+
+#pragma once
+
+#include <cstdint>
+#include <cmath>
+#include <vector>
+
+
+typedef void(*CGDTestFunction)();
+
+
+struct CGDTestCase {
+
+	const char				*suite;
+	const char				*name;
+	CGDTestFunction			run;
+};
+
+
+// Registered tests
+std::vector<CGDTestCase>& CGDTests();
+
+// Record a failed check in the current test
+void CGDTestFail(const char *file, int line, const char *expression);
+
+
+struct CGDTestRegistrar {
+
+	CGDTestRegistrar(const char *suite, const char *name, CGDTestFunction run) {
+
+		CGDTestCase test = { suite, name, run };
+
+		CGDTests().push_back(test);
+	}
+};
+
+
+#define CGD_TEST(suite, name)		static void suite##_##name(); \
+									static CGDTestRegistrar suite##_##name##_registrar(#suite, #name, suite##_##name); \
+									static void suite##_##name()
+
+#define CGD_CHECK(expression)		do { if (!(expression)) CGDTestFail(__FILE__, __LINE__, #expression); } while (0)
+
+#define CGD_CHECK_NEAR(a, b, tolerance)		do { if (!(std::fabs((double)(a) - (double)(b)) <= (double)(tolerance))) CGDTestFail(__FILE__, __LINE__, #a " == " #b " +- " #tolerance); } while (0)
+
+#define CGD_REQUIRE(expression)		do { if (!(expression)) { CGDTestFail(__FILE__, __LINE__, #expression); return; } } while (0)
@@ -0,0 +1,68 @@
+
+//
+// CGDTestMain.cpp
+//
+
+// Unit test runner.  CGDTests [suite...] runs the tests of the given suites (or every test if no suite is given) and returns the number of failed tests
+
+#include <stdafx.h>
+#include "CGDTest.h"
+#include <cstring>
+
+using namespace std;
+
+
+static uint32_t		currentFailures = 0;
+
+
+vector<CGDTestCase>& CGDTests() {
+
+	static vector<CGDTestCase> tests;
+
+	return tests;
+}
+
+
+void CGDTestFail(const char *file, int line, const char *expression) {
+
+	cout << "  " << file << ":" << line << ": check failed: " << expression << endl;
+	currentFailures++;
+}
+
+
+int main(int argc, char **argv) {
+
+	uint32_t run = 0, failed = 0;
+
+	for (const CGDTestCase& test : CGDTests()) {
+
+		bool selected = (argc < 2);
+
+		for (int i = 1; i < argc && !selected; i++)
+			selected = (strcmp(argv[i], test.suite) == 0);
+
+		if (!selected)
+			continue;
+
+		cout << "[ RUN  ] " << test.suite << "." << test.name << endl;
+
+		currentFailures = 0;
+		test.run();
+		run++;
+
+		if (currentFailures > 0)
+			failed++;
+
+		cout << ((currentFailures > 0) ? "[ FAIL ] " : "[  OK  ] ") << test.suite << "." << test.name << endl;
+	}
+
+	cout << "\n" << run << " tests run, " << failed << " failed" << endl;
+
+	if (run == 0) {
+
+		cout << "No tests match the given suites\n";
+		return 1;
+	}
+
+	return (int)min(failed, 125u);
+}
@@ -0,0 +1,270 @@
+
+//
+// CGDTextureCompressorTests.cpp
+//
+
+// CGDTextureCompressor format selection, block compression quality and DDS layout.  Images are generated so the expected quality does not depend on the scene's textures.
+
+#include <stdafx.h>
+#include <CGDTextureCompressor.h>
+#include <CGDJobSystem.h>
+#include <GUBlockCompression.h>
+#include <GUPNGWriter.h>
+#include "CGDTest.h"
+#include <cstdio>
+#include <vector>
+
+using namespace std;
+
+
+namespace {
+
+	// width x height RGBA8 image with smooth colour gradients and alpha
+	vector<uint8_t> gradientImage(uint32_t width, uint32_t height) {
+
+		vector<uint8_t> rgba((size_t)width * height * 4);
+
+		for (uint32_t y = 0; y < height; y++) {
+
+			for (uint32_t x = 0; x < width; x++) {
+
+				uint8_t *t = &rgba[((size_t)y * width + x) * 4];
+
+				t[0] = (uint8_t)(x * 255 / max(width - 1, 1u));
+				t[1] = (uint8_t)(y * 255 / max(height - 1, 1u));
+				t[2] = (uint8_t)((x + y) * 255 / max(width + height - 2, 1u));
+				t[3] = (uint8_t)(255 - y * 255 / max(height - 1, 1u));
+			}
+		}
+
+		return rgba;
+	}
+
+	// PSNR of mip 0 of image compressed to format
+	double compressedPSNR(CGDTextureCompressor *compressor, uint32_t format, uint32_t width, uint32_t height, const vector<uint8_t>& rgba) {
+
+		gu_dds_info info;
+		vector<uint8_t> data;
+		CGDTextureCompressionStats stats;
+
+		if (!compressor->compress(format, width, height, rgba.data(), nullptr, info, data, &stats))
+			return 0.0;
+
+		return stats.psnr;
+	}
+
+	const uint32_t		formats[5] = { GU_DXGI_FORMAT_BC1_UNORM, GU_DXGI_FORMAT_BC3_UNORM, GU_DXGI_FORMAT_BC4_UNORM, GU_DXGI_FORMAT_BC5_UNORM, GU_DXGI_FORMAT_BC7_UNORM };
+}
+
+
+CGD_TEST(TextureCompressor, ParsesFormatNames) {
+
+	CGD_CHECK(CGDTextureCompressor::ParseFormat("bc1") == GU_DXGI_FORMAT_BC1_UNORM);
+	CGD_CHECK(CGDTextureCompressor::ParseFormat("BC3") == GU_DXGI_FORMAT_BC3_UNORM);
+	CGD_CHECK(CGDTextureCompressor::ParseFormat("bc4") == GU_DXGI_FORMAT_BC4_UNORM);
+	CGD_CHECK(CGDTextureCompressor::ParseFormat("Bc5") == GU_DXGI_FORMAT_BC5_UNORM);
+	CGD_CHECK(CGDTextureCompressor::ParseFormat("bc7") == GU_DXGI_FORMAT_BC7_UNORM);
+	CGD_CHECK(CGDTextureCompressor::ParseFormat("bc2") == GU_DXGI_FORMAT_UNKNOWN);
+	CGD_CHECK(CGDTextureCompressor::ParseFormat("out.dds") == GU_DXGI_FORMAT_UNKNOWN);
+
+	for (uint32_t format : formats)
+		CGD_CHECK(CGDTextureCompressor::ParseFormat(CGDTextureCompressor::FormatName(format)) == format);
+}
+
+
+CGD_TEST(TextureCompressor, ChoosesFormatsFromContent) {
+
+	vector<uint8_t> rgba(16 * 16 * 4, 255);
+
+	CGD_CHECK(CGDTextureCompressor::ChooseFormat("grey.png", 16, 16, rgba.data()) == GU_DXGI_FORMAT_BC4_UNORM);
+	CGD_CHECK(CGDTextureCompressor::ChooseFormat("Textures/NormalMap.png", 16, 16, rgba.data()) == GU_DXGI_FORMAT_BC5_UNORM);
+
+	rgba[0] = 0;
+
+	CGD_CHECK(CGDTextureCompressor::ChooseFormat("colour.png", 16, 16, rgba.data()) == GU_DXGI_FORMAT_BC1_UNORM);
+
+	rgba[7] = 128;
+
+	CGD_CHECK(CGDTextureCompressor::ChooseFormat("cutout.png", 16, 16, rgba.data()) == GU_DXGI_FORMAT_BC3_UNORM);
+}
+
+
+CGD_TEST(TextureCompressor, EncodesSolidColours) {
+
+	CGDTextureCompressor *compressor = CGDTextureCompressor::CreateTextureCompressor();
+	CGD_REQUIRE(compressor);
+
+	// magenta and grey 0x42 are exactly representable in 5:6:5 so every format but BC7 reproduces them.  BC7 mode 6 shares an endpoint's low bit (p-bit) between its channels so it can only come close
+	const uint8_t colours[2][4] = { { 255, 0, 255, 255 }, { 66, 65, 66, 200 } };
+
+	for (int c = 0; c < 2; c++) {
+
+		vector<uint8_t> rgba(32 * 32 * 4);
+
+		for (size_t i = 0; i < rgba.size(); i++)
+			rgba[i] = colours[c][i % 4];
+
+		for (uint32_t format : formats) {
+
+			// BC1 stores no alpha so only the opaque colour is exact
+			if (format == GU_DXGI_FORMAT_BC1_UNORM && c == 1)
+				continue;
+
+			CGD_CHECK(compressedPSNR(compressor, format, 32, 32, rgba) >= ((format == GU_DXGI_FORMAT_BC7_UNORM) ? 50.0 : 60.0));
+		}
+	}
+
+	compressor->release();
+}
+
+
+CGD_TEST(TextureCompressor, CompressesGradients) {
+
+	CGDTextureCompressor *compressor = CGDTextureCompressor::CreateTextureCompressor();
+	CGD_REQUIRE(compressor);
+
+	vector<uint8_t> rgba = gradientImage(128, 96), opaque = rgba;
+
+	// BC1 stores texels with alpha below 128 as transparent black so it is measured on an opaque copy
+	for (size_t i = 3; i < opaque.size(); i += 4)
+		opaque[i] = 255;
+
+	double bc1 = compressedPSNR(compressor, GU_DXGI_FORMAT_BC1_UNORM, 128, 96, opaque);
+	double bc3 = compressedPSNR(compressor, GU_DXGI_FORMAT_BC3_UNORM, 128, 96, rgba);
+	double bc4 = compressedPSNR(compressor, GU_DXGI_FORMAT_BC4_UNORM, 128, 96, rgba);
+	double bc5 = compressedPSNR(compressor, GU_DXGI_FORMAT_BC5_UNORM, 128, 96, rgba);
+	double bc7 = compressedPSNR(compressor, GU_DXGI_FORMAT_BC7_UNORM, 128, 96, rgba);
+
+	CGD_CHECK(bc1 >= 35.0);
+	CGD_CHECK(bc3 >= 35.0);
+	CGD_CHECK(bc4 >= 45.0);
+	CGD_CHECK(bc5 >= 45.0);
+	CGD_CHECK(bc7 >= 40.0);
+
+	// BC7 spends its extra bits on quality
+	CGD_CHECK(bc7 > bc1);
+
+	compressor->release();
+}
+
+
+CGD_TEST(TextureCompressor, LaysOutTheMipChain) {
+
+	CGDTextureCompressor *compressor = CGDTextureCompressor::CreateTextureCompressor();
+	CGD_REQUIRE(compressor);
+
+	// sizes that are not multiples of the block size are padded to whole blocks
+	const uint32_t sizes[3][2] = { { 64, 64 }, { 30, 18 }, { 1, 5 } };
+
+	for (int s = 0; s < 3; s++) {
+
+		uint32_t width = sizes[s][0], height = sizes[s][1];
+		vector<uint8_t> rgba = gradientImage(width, height);
+
+		for (uint32_t format : formats) {
+
+			gu_mip_options options;
+			gu_dds_info info;
+			vector<uint8_t> data;
+			CGDTextureCompressionStats stats;
+
+			CGD_REQUIRE(compressor->compress(format, width, height, rgba.data(), &options, info, data, &stats));
+
+			CGD_CHECK(info.width == width);
+			CGD_CHECK(info.height == height);
+			CGD_CHECK(info.format == format);
+			CGD_CHECK(info.mipCount == gu_mip_count(width, height));
+			CGD_CHECK(stats.mipCount == info.mipCount);
+
+			size_t bytes = 0;
+
+			for (uint32_t m = 0; m < info.mipCount; m++) {
+
+				uint32_t blocks = ((max(width >> m, 1u) + 3) / 4) * ((max(height >> m, 1u) + 3) / 4);
+
+				CGD_CHECK(gu_dds_mip_size(info, m) == blocks * gu_bc_block_bytes(format));
+				bytes += gu_dds_mip_size(info, m);
+			}
+
+			CGD_CHECK(data.size() == bytes);
+			CGD_CHECK(stats.compressedBytes == bytes);
+		}
+	}
+
+	// formats the compressor does not encode are rejected
+	vector<uint8_t> rgba = gradientImage(8, 8);
+	gu_dds_info info;
+	vector<uint8_t> data;
+
+	CGD_CHECK(!compressor->compress(GU_DXGI_FORMAT_UNKNOWN, 8, 8, rgba.data(), nullptr, info, data));
+	CGD_CHECK(!compressor->compress(GU_DXGI_FORMAT_BC1_UNORM, 0, 8, rgba.data(), nullptr, info, data));
+
+	compressor->release();
+}
+
+
+CGD_TEST(TextureCompressor, ParallelMatchesSerial) {
+
+	CGDJobSystem *jobSystem = CGDJobSystem::CreateJobSystem(3);
+	CGD_REQUIRE(jobSystem);
+
+	CGDTextureCompressor *serial = CGDTextureCompressor::CreateTextureCompressor();
+	CGDTextureCompressor *parallel = CGDTextureCompressor::CreateTextureCompressor(jobSystem, 1);
+	vector<uint8_t> rgba = gradientImage(100, 60);
+	gu_mip_options options;
+
+	for (uint32_t format : formats) {
+
+		gu_dds_info serialInfo, parallelInfo;
+		vector<uint8_t> serialData, parallelData;
+
+		CGD_CHECK(serial->compress(format, 100, 60, rgba.data(), &options, serialInfo, serialData));
+		CGD_CHECK(parallel->compress(format, 100, 60, rgba.data(), &options, parallelInfo, parallelData));
+		CGD_CHECK(serialData == parallelData);
+	}
+
+	serial->release();
+	parallel->release();
+	jobSystem->release();
+}
+
+
+CGD_TEST(TextureCompressor, WritesReadableDDSFiles) {
+
+	const char *imageName = "texture_compressor_test.png";
+	const char *ddsName = "texture_compressor_test.dds";
+
+	vector<uint8_t> rgba = gradientImage(40, 24);
+
+	CGD_REQUIRE(gu_png_write(imageName, 40, 24, rgba.data(), 40 * 4));
+
+	CGDTextureCompressor *compressor = CGDTextureCompressor::CreateTextureCompressor();
+	CGDTextureCompressionStats stats;
+
+	// the gradient has transparent texels so BC3 is chosen
+	CGD_CHECK(compressor->compressFile(imageName, ddsName, GU_DXGI_FORMAT_UNKNOWN, &stats));
+	CGD_CHECK(stats.format == GU_DXGI_FORMAT_BC3_UNORM);
+
+	gu_dds_info info;
+
+	CGD_CHECK(gu_dds_read_info(ddsName, info));
+	CGD_CHECK(info.width == 40 && info.height == 24);
+	CGD_CHECK(info.format == GU_DXGI_FORMAT_BC3_UNORM);
+	CGD_CHECK(info.mipCount == gu_mip_count(40, 24));
+
+	// mip 0 decodes to the image within the measured error
+	vector<uint8_t> mip0, decoded(40 * 24 * 4);
+
+	CGD_CHECK(gu_dds_read_mips(ddsName, info, 0, 0, mip0));
+	CGD_CHECK(gu_bc_decompress(info.format, 40, 24, mip0.data(), decoded.data()));
+	CGD_CHECK_NEAR(CGDTextureCompressor::PSNR(info.format, 40, 24, rgba.data(), decoded.data()), stats.psnr, 1e-9);
+
+	// missing inputs fail without writing anything
+	CGD_CHECK(!compressor->compressFile("no_such_image.png", "no_such_image.dds"));
+	CGD_CHECK(!gu_dds_read_info("no_such_image.dds", info));
+
+	compressor->release();
+
+	remove(imageName);
+	remove(ddsName);
+}
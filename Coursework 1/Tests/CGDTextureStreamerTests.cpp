@@ -0,0 +1,394 @@
+
+//
+// CGDTextureStreamerTests.cpp
+//
+
+// CGDTextureStreamer residency and budget decisions against CGDFakeStreamingBackend.  Textures are 256 x 256 with a byte per texel so mips 0 - 8 use 65536, 16384, 4096, 1024, 256, 64, 16, 4 and 1 bytes, and with a tail size of 16 the always resident tail is mips 4 - 8 (341 bytes).
+
+#include <stdafx.h>
+#include <CGDTextureStreamer.h>
+#include <CGDJobSystem.h>
+#include "CGDFakeStreamingBackend.h"
+#include "CGDTest.h"
+#include <chrono>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+
+namespace {
+
+	const size_t		tailBytes = 341;
+	const size_t		fullBytes = 87381;
+
+	// Bytes of mips [firstMip, 4) - the streamed part of a test texture
+	size_t streamedBytes(uint32_t firstMip) {
+
+		static const size_t mipBytes[4] = { 65536, 16384, 4096, 1024 };
+		size_t bytes = 0;
+
+		for (uint32_t m = firstMip; m < 4; m++)
+			bytes += mipBytes[m];
+
+		return bytes;
+	}
+
+	// Register count test textures with streamer
+	vector<uint32_t> registerTextures(CGDTextureStreamer *streamer, CGDFakeStreamingBackend *backend, uint32_t count) {
+
+		vector<uint32_t> ids;
+
+		for (uint32_t i = 0; i < count; i++) {
+
+			CGDStreamedTextureDesc desc;
+			void *texture = backend->createTexture(256, 256, 1, desc);
+
+			ids.push_back(streamer->registerTexture(desc, texture));
+		}
+
+		return ids;
+	}
+}
+
+
+CGD_TEST(TextureStreamer, RejectsInvalidTextures) {
+
+	CGD_CHECK(CGDTextureStreamer::CreateTextureStreamer(nullptr, 1024) == nullptr);
+
+	CGDFakeStreamingBackend *backend = CGDFakeStreamingBackend::CreateFakeStreamingBackend();
+	CGDTextureStreamer *streamer = CGDTextureStreamer::CreateTextureStreamer(backend, 1 << 20, nullptr, 16);
+	CGD_REQUIRE(streamer);
+
+	CGDStreamedTextureDesc desc;
+	void *texture = backend->createTexture(256, 256, 1, desc);
+
+	CGD_CHECK(streamer->registerTexture(desc, nullptr) == CGD_INVALID_STREAMED_TEXTURE);
+
+	CGDStreamedTextureDesc noMips = desc;
+	noMips.mipCount = 0;
+
+	CGD_CHECK(streamer->registerTexture(noMips, texture) == CGD_INVALID_STREAMED_TEXTURE);
+
+	// a texture whose tail cannot be loaded is not registered
+	backend->texture(texture)->failLoads = true;
+
+	CGD_CHECK(streamer->registerTexture(desc, texture) == CGD_INVALID_STREAMED_TEXTURE);
+	CGD_CHECK(streamer->getStats().textures == 0);
+	CGD_CHECK(streamer->getStats().residentBytes == 0);
+
+	streamer->release();
+	backend->release();
+}
+
+
+CGD_TEST(TextureStreamer, KeepsOnlyTheTailUntilRequested) {
+
+	CGDFakeStreamingBackend *backend = CGDFakeStreamingBackend::CreateFakeStreamingBackend();
+	CGDTextureStreamer *streamer = CGDTextureStreamer::CreateTextureStreamer(backend, 1 << 20, nullptr, 16);
+	CGD_REQUIRE(streamer);
+
+	vector<uint32_t> ids = registerTextures(streamer, backend, 3);
+
+	for (uint32_t id : ids) {
+
+		CGD_REQUIRE(id != CGD_INVALID_STREAMED_TEXTURE);
+		CGD_CHECK(streamer->residentMip(id) == 4);
+	}
+
+	// unrequested textures are left alone
+	for (int frame = 0; frame < 3; frame++)
+		CGD_CHECK(streamer->update() == 0);
+
+	CGDTextureStreamerStats stats = streamer->getStats();
+
+	CGD_CHECK(stats.textures == 3);
+	CGD_CHECK(stats.residentBytes == 3 * tailBytes);
+	CGD_CHECK(stats.fullResidencyBytes == 3 * fullBytes);
+	CGD_CHECK(stats.loadsStarted == 0);
+	CGD_CHECK(backend->residentBytes() == stats.residentBytes);
+	CGD_CHECK(backend->protocolErrorCount() == 0);
+
+	streamer->release();
+	backend->release();
+}
+
+
+CGD_TEST(TextureStreamer, LoadsRequestedMips) {
+
+	CGDFakeStreamingBackend *backend = CGDFakeStreamingBackend::CreateFakeStreamingBackend();
+	CGDTextureStreamer *streamer = CGDTextureStreamer::CreateTextureStreamer(backend, 1 << 20, nullptr, 16);
+	CGD_REQUIRE(streamer);
+
+	vector<uint32_t> ids = registerTextures(streamer, backend, 2);
+
+	// the most detailed of several requests in a frame wins
+	streamer->requestMip(ids[0], 3);
+	streamer->requestMip(ids[0], 1);
+	streamer->requestMip(ids[0], 2);
+
+	// requests for mips in the tail need nothing
+	streamer->requestMip(ids[1], 6);
+
+	CGD_CHECK(streamer->update() == 1);
+	CGD_CHECK(streamer->idle());
+	CGD_CHECK(streamer->residentMip(ids[0]) == 1);
+	CGD_CHECK(streamer->residentMip(ids[1]) == 4);
+
+	// more detail is loaded on top of what is resident
+	streamer->requestMip(ids[0], 0);
+
+	CGD_CHECK(streamer->update() == 1);
+	CGD_CHECK(streamer->residentMip(ids[0]) == 0);
+
+	CGDTextureStreamerStats stats = streamer->getStats();
+
+	CGD_CHECK(stats.loadsCompleted == 2);
+	CGD_CHECK(stats.bytesLoaded == streamedBytes(0));
+	CGD_CHECK(stats.residentBytes == fullBytes + tailBytes);
+	CGD_CHECK(stats.evictions == 0);
+	CGD_CHECK(backend->residentBytes() == stats.residentBytes);
+	CGD_CHECK(backend->protocolErrorCount() == 0);
+
+	streamer->release();
+	backend->release();
+}
+
+
+CGD_TEST(TextureStreamer, EvictsLeastRecentlyRequestedFirst) {
+
+	// room for the tails and one texture at mip 2
+	CGDFakeStreamingBackend *backend = CGDFakeStreamingBackend::CreateFakeStreamingBackend();
+	CGDTextureStreamer *streamer = CGDTextureStreamer::CreateTextureStreamer(backend, 3 * tailBytes + streamedBytes(2), nullptr, 16);
+	CGD_REQUIRE(streamer);
+
+	vector<uint32_t> ids = registerTextures(streamer, backend, 3);
+
+	streamer->requestMip(ids[0], 2);
+	streamer->update();
+
+	CGD_CHECK(streamer->residentMip(ids[0]) == 2);
+
+	// a newer request takes the memory of the older one
+	streamer->requestMip(ids[1], 2);
+	streamer->update();
+
+	CGD_CHECK(streamer->residentMip(ids[0]) == 4);
+	CGD_CHECK(streamer->residentMip(ids[1]) == 2);
+
+	// textures requested in the same frame do not evict each other
+	for (int frame = 0; frame < 4; frame++) {
+
+		streamer->requestMip(ids[0], 2);
+		streamer->requestMip(ids[1], 2);
+		streamer->update();
+
+		CGD_CHECK(streamer->residentMip(ids[0]) == 4);
+		CGD_CHECK(streamer->residentMip(ids[1]) == 2);
+	}
+
+	// a request that cannot fit loads as much as the budget allows
+	streamer->requestMip(ids[2], 0);
+	streamer->update();
+
+	CGD_CHECK(streamer->residentMip(ids[1]) == 4);
+	CGD_CHECK(streamer->residentMip(ids[2]) == 2);
+
+	CGDTextureStreamerStats stats = streamer->getStats();
+
+	CGD_CHECK(stats.peakResidentBytes <= stats.budgetBytes);
+	CGD_CHECK(stats.evictions == 4);
+	CGD_CHECK(backend->residentBytes() == stats.residentBytes);
+	CGD_CHECK(backend->protocolErrorCount() == 0);
+
+	streamer->release();
+	backend->release();
+}
+
+
+CGD_TEST(TextureStreamer, EnforcesAReducedBudget) {
+
+	CGDFakeStreamingBackend *backend = CGDFakeStreamingBackend::CreateFakeStreamingBackend();
+	CGDTextureStreamer *streamer = CGDTextureStreamer::CreateTextureStreamer(backend, 1 << 20, nullptr, 16);
+	CGD_REQUIRE(streamer);
+
+	vector<uint32_t> ids = registerTextures(streamer, backend, 2);
+
+	for (uint32_t id : ids)
+		streamer->requestMip(id, 0);
+
+	streamer->update();
+
+	CGD_CHECK(streamer->getStats().residentBytes == 2 * fullBytes);
+
+	// the budget is enforced without requests, down to (but never into) the tails
+	streamer->setBudget(fullBytes);
+
+	CGD_CHECK(streamer->getBudget() == fullBytes);
+	CGD_CHECK(streamer->update() > 0);
+	CGD_CHECK(streamer->getStats().residentBytes <= fullBytes);
+
+	streamer->setBudget(0);
+	streamer->update();
+
+	for (uint32_t id : ids)
+		CGD_CHECK(streamer->residentMip(id) == 4);
+
+	CGD_CHECK(streamer->getStats().residentBytes == 2 * tailBytes);
+	CGD_CHECK(backend->residentBytes() == 2 * tailBytes);
+	CGD_CHECK(backend->protocolErrorCount() == 0);
+
+	streamer->release();
+	backend->release();
+}
+
+
+CGD_TEST(TextureStreamer, FailedLoadsKeepTheResidency) {
+
+	CGDFakeStreamingBackend *backend = CGDFakeStreamingBackend::CreateFakeStreamingBackend();
+	CGDTextureStreamer *streamer = CGDTextureStreamer::CreateTextureStreamer(backend, 1 << 20, nullptr, 16);
+	CGD_REQUIRE(streamer);
+
+	CGDStreamedTextureDesc desc;
+	void *texture = backend->createTexture(256, 256, 1, desc);
+	uint32_t id = streamer->registerTexture(desc, texture);
+	CGD_REQUIRE(id != CGD_INVALID_STREAMED_TEXTURE);
+
+	backend->texture(texture)->failLoads = true;
+
+	streamer->requestMip(id, 0);
+
+	CGD_CHECK(streamer->update() == 0);
+	CGD_CHECK(streamer->idle());
+	CGD_CHECK(streamer->residentMip(id) == 4);
+	CGD_CHECK(streamer->getStats().loadsFailed == 1);
+	CGD_CHECK(streamer->getStats().residentBytes == tailBytes);
+
+	// the next request retries
+	backend->texture(texture)->failLoads = false;
+
+	streamer->requestMip(id, 0);
+
+	CGD_CHECK(streamer->update() == 1);
+	CGD_CHECK(streamer->residentMip(id) == 0);
+	CGD_CHECK(backend->residentBytes() == fullBytes);
+	CGD_CHECK(backend->protocolErrorCount() == 0);
+
+	streamer->release();
+	backend->release();
+}
+
+
+CGD_TEST(TextureStreamer, LoadsAsynchronously) {
+
+	// 2 ms loads on the job system, at most 2 in flight
+	CGDJobSystem *jobSystem = CGDJobSystem::CreateJobSystem(2);
+	CGD_REQUIRE(jobSystem);
+
+	CGDFakeStreamingBackend *backend = CGDFakeStreamingBackend::CreateFakeStreamingBackend(2000);
+	CGDTextureStreamer *streamer = CGDTextureStreamer::CreateTextureStreamer(backend, 1 << 20, jobSystem, 16, 2);
+	CGD_REQUIRE(streamer);
+
+	vector<uint32_t> ids = registerTextures(streamer, backend, 6);
+	bool allResident = false;
+	uint32_t changes = 0;
+
+	for (int frame = 0; frame < 2000 && !allResident; frame++) {
+
+		for (uint32_t id : ids)
+			streamer->requestMip(id, 0);
+
+		changes += streamer->update();
+
+		allResident = true;
+
+		for (uint32_t id : ids)
+			allResident = allResident && streamer->residentMip(id) == 0;
+
+		this_thread::sleep_for(chrono::microseconds(500));
+	}
+
+	CGDTextureStreamerStats stats = streamer->getStats();
+
+	CGD_CHECK(allResident);
+	CGD_CHECK(streamer->idle());
+	CGD_CHECK(changes == 6);
+	CGD_CHECK(stats.loadsCompleted == 6);
+	CGD_CHECK(stats.bytesLoaded == 6 * streamedBytes(0));
+	CGD_CHECK(stats.meanLoadLatency >= 2.0);
+	CGD_CHECK(stats.maxLoadLatency >= stats.meanLoadLatency);
+	CGD_CHECK(backend->maxConcurrentLoads() <= 2);
+	CGD_CHECK(backend->residentBytes() == stats.residentBytes);
+	CGD_CHECK(backend->protocolErrorCount() == 0);
+
+	streamer->release();
+	backend->release();
+	jobSystem->release();
+}
+
+
+CGD_TEST(TextureStreamer, UnregistersTexturesWithLoadsInFlight) {
+
+	CGDJobSystem *jobSystem = CGDJobSystem::CreateJobSystem(2);
+	CGD_REQUIRE(jobSystem);
+
+	CGDFakeStreamingBackend *backend = CGDFakeStreamingBackend::CreateFakeStreamingBackend(5000);
+	CGDTextureStreamer *streamer = CGDTextureStreamer::CreateTextureStreamer(backend, 1 << 20, jobSystem, 16);
+	CGD_REQUIRE(streamer);
+
+	vector<uint32_t> ids = registerTextures(streamer, backend, 3);
+
+	for (uint32_t id : ids)
+		streamer->requestMip(id, 0);
+
+	streamer->update();
+
+	CGD_CHECK(!streamer->idle());
+
+	streamer->unregisterTexture(ids[1]);
+
+	CGDTextureStreamerStats stats = streamer->getStats();
+
+	CGD_CHECK(stats.textures == 2);
+	CGD_CHECK(stats.fullResidencyBytes == 2 * fullBytes);
+
+	// the free slot is reused
+	CGDStreamedTextureDesc desc;
+	void *texture = backend->createTexture(256, 256, 1, desc);
+
+	CGD_CHECK(streamer->registerTexture(desc, texture) == ids[1]);
+
+	// the destructor waits for the remaining loads
+	streamer->release();
+
+	CGD_CHECK(backend->protocolErrorCount() == 0);
+
+	backend->release();
+	jobSystem->release();
+}
+
+
+CGD_TEST(TextureStreamer, EstimatesMipsFromCoverage) {
+
+	CGD_CHECK(CGDTextureStreamer::MipForScreenSize(1024, 1024, 1024.0f, 1024.0f) == 0);
+	CGD_CHECK(CGDTextureStreamer::MipForScreenSize(1024, 1024, 2048.0f, 2048.0f) == 0);
+	CGD_CHECK(CGDTextureStreamer::MipForScreenSize(1024, 1024, 256.0f, 256.0f) == 2);
+	CGD_CHECK(CGDTextureStreamer::MipForScreenSize(1024, 1024, 100.0f, 100.0f) == 3);
+	CGD_CHECK(CGDTextureStreamer::MipForScreenSize(2048, 512, 256.0f, 256.0f) == 3);
+	CGD_CHECK(CGDTextureStreamer::MipForScreenSize(1024, 1024, 0.0f, 0.0f) == CGD_MAX_TEXTURE_MIPS - 1);
+
+	// 10 units seen from 36 units away through a 90 degree field of view on a 720 pixel viewport covers 100 pixels
+	CGD_CHECK(CGDTextureStreamer::MipForDistance(1024, 1024, 10.0f, 36.0f, 1.5707963f, 720.0f) == 3);
+	CGD_CHECK(CGDTextureStreamer::MipForDistance(1024, 1024, 10.0f, 0.0f, 1.5707963f, 720.0f) == 0);
+
+	// further away never needs more detail
+	uint32_t previous = 0;
+
+	for (float distance = 1.0f; distance < 10000.0f; distance *= 1.5f) {
+
+		uint32_t mip = CGDTextureStreamer::MipForDistance(1024, 1024, 10.0f, distance, 1.5707963f, 720.0f);
+
+		CGD_CHECK(mip >= previous);
+		previous = mip;
+	}
+}